@@ -18,3 +18,7 @@ if (INCLUDE_STRINGS_H)
 else()
 #  check_symbol_exists (strncasecmp "" HAVE_STRNCASECMP)
 endif()
+
+# we use mmap(2) to read large files (e.g., OBJ models) when it is available
+#
+check_include_file(sys/mman.h HAVE_SYS_MMAN_H)
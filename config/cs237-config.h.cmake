@@ -29,6 +29,9 @@ extern "C" {
 //! is strncasecmp available?
 #cmakedefine HAVE_STRNCASECMP
 
+//! is <sys/mman.h> (i.e., mmap) available?
+#cmakedefine HAVE_SYS_MMAN_H
+
 //! flag for windows build
 #cmakedefine CS237_WINDOWS
 
@@ -0,0 +1,232 @@
+/*! \file image-bench.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * A benchmark for the pixel-format conversion kernels.  It measures the
+ * throughput of each of the common conversions (channel expansion, swizzles,
+ * 8/16-bit, U8/F32, and sRGB encoding and decoding) on a synthetic image, as well
+ * as vertical flips, and compares the RGB to RGBA conversion with the original
+ * scalar loop.  When more than one thread is requested, it also measures the
+ * parallel versions of `Image2D::convert` and `Image2D::flip`.  The reported
+ * rates count both the bytes read and the bytes written.
+ *
+ *      usage: image-bench [ -n <runs> ] [ -t <threads> ] [ <wid> <ht> ]
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "pixel-convert.hpp"
+#include <chrono>
+#include <functional>
+#include <cstring>
+#include <random>
+
+using Clock = std::chrono::steady_clock;
+using cs237::Channels;
+using cs237::ChannelTy;
+using cs237::__detail::PixelFormat;
+
+/// time a function
+/// \param fn     the function to time
+/// \param nRuns  the number of times to run the function
+/// \return the best elapsed time in seconds
+static double timeIt (std::function<void()> const &fn, int nRuns)
+{
+    double best = 0.0;
+    for (int run = 0;  run < nRuns;  ++run) {
+        auto start = Clock::now();
+        fn();
+        std::chrono::duration<double> t = Clock::now() - start;
+        best = (run == 0) ? t.count() : std::min(best, t.count());
+    }
+    return best;
+
+}
+
+/// fill an image with random pixels; float images get values in 0..1
+static void fillImage (cs237::Image2D *img)
+{
+    std::mt19937 rng(17);
+    if (img->type() == ChannelTy::F32) {
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        float *p = static_cast<float *>(img->data());
+        for (size_t i = 0;  i < img->nBytes() / sizeof(float);  ++i) {
+            p[i] = dist(rng);
+        }
+    } else {
+        uint8_t *p = static_cast<uint8_t *>(img->data());
+        for (size_t i = 0;  i < img->nBytes();  ++i) {
+            p[i] = uint8_t(rng());
+        }
+    }
+
+}
+
+/// a conversion to benchmark
+struct Conversion {
+    const char *name;
+    PixelFormat src;
+    PixelFormat dst;
+};
+
+static const Conversion kConversions[] = {
+        { "RGB8 -> RGBA8",          { Channels::RGB, ChannelTy::U8, true },
+                                    { Channels::RGBA, ChannelTy::U8, true } },
+        { "BGR8 -> RGBA8",          { Channels::BGR, ChannelTy::U8, true },
+                                    { Channels::RGBA, ChannelTy::U8, true } },
+        { "BGRA8 -> RGBA8",         { Channels::BGRA, ChannelTy::U8, true },
+                                    { Channels::RGBA, ChannelTy::U8, true } },
+        { "R8 -> RGBA8",            { Channels::R, ChannelTy::U8, false },
+                                    { Channels::RGBA, ChannelTy::U8, false } },
+        { "RGB16 -> RGBA16",        { Channels::RGB, ChannelTy::U16, false },
+                                    { Channels::RGBA, ChannelTy::U16, false } },
+        { "RGBA8 -> RGBA16",        { Channels::RGBA, ChannelTy::U8, false },
+                                    { Channels::RGBA, ChannelTy::U16, false } },
+        { "RGBA16 -> RGBA8",        { Channels::RGBA, ChannelTy::U16, false },
+                                    { Channels::RGBA, ChannelTy::U8, false } },
+        { "RGBA8 -> RGBA32F",       { Channels::RGBA, ChannelTy::U8, false },
+                                    { Channels::RGBA, ChannelTy::F32, false } },
+        { "RGBA32F -> RGBA8",       { Channels::RGBA, ChannelTy::F32, false },
+                                    { Channels::RGBA, ChannelTy::U8, false } },
+        { "sRGBA8 -> RGBA32F",      { Channels::RGBA, ChannelTy::U8, true },
+                                    { Channels::RGBA, ChannelTy::F32, false } },
+        { "RGBA32F -> sRGBA8",      { Channels::RGBA, ChannelTy::F32, false },
+                                    { Channels::RGBA, ChannelTy::U8, true } },
+        { "sRGB8 -> RGBA16",        { Channels::RGB, ChannelTy::U8, true },
+                                    { Channels::RGBA, ChannelTy::U16, false } },
+    };
+
+/// the scalar RGB to RGBA loop that `addAlphaChannel` used to use
+static void scalarAddAlpha (const uint8_t *srcP, uint8_t *dstP, size_t nPixels)
+{
+    for (size_t i = 0;  i < nPixels;  ++i) {
+        dstP[0] = srcP[0];
+        dstP[1] = srcP[1];
+        dstP[2] = srcP[2];
+        dstP[3] = 0xff;
+        dstP += 4;
+        srcP += 3;
+    }
+
+}
+
+/// report a time and rate
+static void report (const char *name, double t, size_t nBytes, double baseline = 0.0)
+{
+    std::cout << "  " << name << ": " << 1000.0 * t << " ms ("
+        << double(nBytes) / (1024.0 * 1024.0 * t) << " MB/s";
+    if (baseline > 0.0) {
+        std::cout << "; " << baseline / t << "x";
+    }
+    std::cout << ")\n";
+
+}
+
+static void usage ()
+{
+    std::cerr << "usage: image-bench [ -n <runs> ] [ -t <threads> ] [ <wid> <ht> ]\n";
+    exit (1);
+
+}
+
+int main (int argc, char **argv)
+{
+    int nRuns = 5;
+    int nThreads = std::thread::hardware_concurrency();
+    uint32_t wid = 4096, ht = 4096;
+    int i = 1;
+    while ((i + 1 < argc) && (argv[i][0] == '-')) {
+        if (std::strcmp(argv[i], "-n") == 0) {
+            nRuns = std::atoi(argv[i+1]);
+        } else if (std::strcmp(argv[i], "-t") == 0) {
+            nThreads = std::atoi(argv[i+1]);
+        } else {
+            usage();
+        }
+        i += 2;
+    }
+    if (i + 2 == argc) {
+        wid = std::atoi(argv[i]);
+        ht = std::atoi(argv[i+1]);
+    } else if (i != argc) {
+        usage();
+    }
+    if ((nRuns < 1) || (nThreads < 1) || (wid < 1) || (ht < 1)) {
+        usage();
+    }
+
+    size_t nPixels = size_t(wid) * size_t(ht);
+    std::cout << "image-bench: " << wid << "x" << ht << " pixels\n";
+
+    // the thread count includes the calling thread
+    cs237::JobSystem *jobs = (nThreads > 1) ? new cs237::JobSystem(nThreads - 1) : nullptr;
+
+    for (auto const &conv : kConversions) {
+        cs237::Image2D src(wid, ht, conv.src.chans, conv.src.ty, conv.src.sRGB);
+        cs237::Image2D dst(wid, ht, conv.dst.chans, conv.dst.ty, conv.dst.sRGB);
+        fillImage (&src);
+        size_t nBytes = src.nBytes() + dst.nBytes();
+        std::cout << conv.name << "\n";
+
+        double base = 0.0;
+        if ((conv.src.chans == Channels::RGB) && (conv.src.ty == ChannelTy::U8)
+        && (conv.dst.chans == Channels::RGBA) && (conv.dst.ty == ChannelTy::U8)) {
+            base = timeIt (
+                [&] () {
+                    scalarAddAlpha (
+                        static_cast<const uint8_t *>(src.data()),
+                        static_cast<uint8_t *>(dst.data()), nPixels);
+                },
+                nRuns);
+            report ("scalar loop  ", base, nBytes);
+        }
+
+        double t = timeIt (
+            [&] () {
+                cs237::__detail::convertPixels (
+                    conv.src, src.data(), conv.dst, dst.data(), nPixels);
+            },
+            nRuns);
+        report ("convertPixels", t, nBytes, base);
+
+        // `convert` allocates the new image, so we compare the parallel version
+        // with the sequential one
+        if (jobs != nullptr) {
+            double tSeq = timeIt (
+                [&] () {
+                    delete src.convert (conv.dst.chans, conv.dst.ty, conv.dst.sRGB);
+                },
+                nRuns);
+            report ("convert      ", tSeq, nBytes);
+            double tPar = timeIt (
+                [&] () {
+                    delete src.convert (conv.dst.chans, conv.dst.ty, conv.dst.sRGB, jobs);
+                },
+                nRuns);
+            report ("convert (par)", tPar, nBytes, tSeq);
+        }
+    }
+
+    {
+        cs237::Image2D img(wid, ht, Channels::RGBA, ChannelTy::U8);
+        fillImage (&img);
+        std::cout << "flip RGBA8\n";
+        double t = timeIt ([&] () { img.flip(); }, nRuns);
+        report ("flip         ", t, 2 * img.nBytes());
+        if (jobs != nullptr) {
+            double tPar = timeIt ([&] () { img.flip(jobs); }, nRuns);
+            report ("flip (par)   ", tPar, 2 * img.nBytes(), t);
+        }
+    }
+
+    delete jobs;
+
+    return 0;
+
+}
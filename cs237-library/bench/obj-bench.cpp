@@ -0,0 +1,323 @@
+/*! \file obj-bench.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * A benchmark that compares the single-pass OBJ reader with the original
+ * two-pass reader, and measures how the parallel version of the reader scales
+ * with the number of threads.  It also measures the cost of building an
+ * `OBJ::Model`, which adds the vertex-deduplication pass to the read, and the
+ * cost and effect (in terms of the vertex-cache miss ratio) of optimizing the
+ * model's meshes for rendering.  For each
+ * file on the command line, we check that the readers produce the same model and
+ * report the best time over several runs.
+ *
+ *      usage: obj-bench [ -n <runs> ] [ -t <max-threads> ] file.obj ...
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "obj.hpp"
+#include "obj-reader.hpp"
+#include <chrono>
+#include <functional>
+#include <cstring>
+
+using Clock = std::chrono::steady_clock;
+
+using Reader = std::function<OBJmodel *(const char *)>;
+
+/// time a reader
+/// \param reader  the reader function
+/// \param file    the file to read
+/// \param nRuns   the number of times to run the reader
+/// \param[out] model  set to the model that was read by the first run
+/// \return the best elapsed time in seconds
+static double timeReader (Reader const &reader, const char *file, int nRuns, OBJmodel *&model)
+{
+    double best = 0.0;
+    model = nullptr;
+    for (int run = 0;  run < nRuns;  ++run) {
+        auto start = Clock::now();
+        OBJmodel *m = reader(file);
+        std::chrono::duration<double> t = Clock::now() - start;
+        if (model == nullptr) {
+            model = m;
+            best = t.count();
+        } else {
+            delete m;
+            best = std::min(best, t.count());
+        }
+    }
+    return best;
+
+}
+
+/// time building an `OBJ::Model` from a file; the model cache should be disabled
+/// \param file    the file to read
+/// \param nRuns   the number of times to build the model
+/// \return the best elapsed time in seconds
+static double timeModel (const char *file, int nRuns)
+{
+    double best = 0.0;
+    for (int run = 0;  run < nRuns;  ++run) {
+        auto start = Clock::now();
+        {
+            OBJ::Model model(file);
+        }
+        std::chrono::duration<double> t = Clock::now() - start;
+        best = (run == 0) ? t.count() : std::min(best, t.count());
+    }
+    return best;
+
+}
+
+/// optimize copies of the groups of a model for rendering
+/// \param model       the model
+/// \param[out] stats  the triangle-weighted average of the groups' statistics
+/// \return the elapsed time in seconds
+static double timeOptimize (OBJ::Model const &model, cs237::mesh::Stats &stats)
+{
+    stats = { 0.0f, 0.0f, 0.0f, 0.0f };
+    double t = 0.0;
+    uint32_t nTris = 0;
+    for (auto grp = model.beginGroups();  grp != model.endGroups();  ++grp) {
+        std::vector<glm::vec3> verts(grp->verts, grp->verts + grp->nVerts);
+        std::vector<glm::vec3> norms;
+        std::vector<glm::vec2> txtCoords;
+        if (grp->norms != nullptr) {
+            norms.assign (grp->norms, grp->norms + grp->nVerts);
+        }
+        if (grp->txtCoords != nullptr) {
+            txtCoords.assign (grp->txtCoords, grp->txtCoords + grp->nVerts);
+        }
+        std::vector<uint32_t> indices(grp->indices, grp->indices + grp->nIndices);
+
+        auto start = Clock::now();
+        cs237::mesh::Stats s = cs237::mesh::optimize (
+            grp->nVerts, grp->nIndices, verts.data(),
+            norms.empty() ? nullptr : norms.data(),
+            txtCoords.empty() ? nullptr : txtCoords.data(),
+            indices.data());
+        std::chrono::duration<double> dt = Clock::now() - start;
+        t += dt.count();
+
+        float w = float(grp->nIndices / 3);
+        stats.acmrBefore += w * s.acmrBefore;
+        stats.acmrAfter += w * s.acmrAfter;
+        stats.atvrBefore += w * s.atvrBefore;
+        stats.atvrAfter += w * s.atvrAfter;
+        nTris += grp->nIndices / 3;
+    }
+    if (nTris > 0) {
+        stats.acmrBefore /= float(nTris);
+        stats.acmrAfter /= float(nTris);
+        stats.atvrBefore /= float(nTris);
+        stats.atvrAfter /= float(nTris);
+    }
+    return t;
+
+}
+
+/// compare two optional C strings
+static bool sameString (const char *a, const char *b)
+{
+    if ((a == nullptr) || (b == nullptr)) {
+        return (a == b);
+    }
+    return (std::strcmp(a, b) == 0);
+
+}
+
+/// compare the models produced by two readers.  The legacy reader does not
+/// initialize the normal/texture-coordinate indices of faces that do not have
+/// them, whereas the new reader sets them to zero, so when comparing against
+/// the legacy reader (`exact` is false), we only compare those indices when the
+/// second model's index is nonzero.
+/// \return an empty string if the models are the same; otherwise a description
+///         of the first difference
+static std::string compareModels (OBJmodel const *a, OBJmodel const *b, bool exact)
+{
+    if (! sameString(a->mtllibname, b->mtllibname)) {
+        return "mtllib names differ";
+    }
+    if (a->numvertices != b->numvertices) {
+        return "vertex counts differ";
+    }
+    if (std::memcmp(a->vertices + 1, b->vertices + 1, a->numvertices * sizeof(glm::vec3)) != 0) {
+        return "vertices differ";
+    }
+    if (a->numnormals != b->numnormals) {
+        return "normal counts differ";
+    }
+    if ((a->numnormals > 0)
+    && (std::memcmp(a->normals + 1, b->normals + 1, a->numnormals * sizeof(glm::vec3)) != 0)) {
+        return "normals differ";
+    }
+    if (a->numtexcoords != b->numtexcoords) {
+        return "texture-coordinate counts differ";
+    }
+    if ((a->numtexcoords > 0)
+    && (std::memcmp(a->texcoords + 1, b->texcoords + 1, a->numtexcoords * sizeof(glm::vec2)) != 0)) {
+        return "texture coordinates differ";
+    }
+    if (a->numtriangles != b->numtriangles) {
+        return "triangle counts differ";
+    }
+    if (exact) {
+        if ((a->numtriangles > 0)
+        && (std::memcmp(a->triangles, b->triangles, a->numtriangles * sizeof(OBJtriangle)) != 0)) {
+            return "triangles differ";
+        }
+    }
+    else for (uint32_t i = 0;  i < a->numtriangles;  ++i) {
+        OBJtriangle const &ta = a->triangles[i];
+        OBJtriangle const &tb = b->triangles[i];
+        for (int j = 0;  j < 3;  ++j) {
+            if ((ta.vindices[j] != tb.vindices[j])
+            || ((tb.nindices[j] != 0) && (ta.nindices[j] != tb.nindices[j]))
+            || ((tb.tindices[j] != 0) && (ta.tindices[j] != tb.tindices[j]))) {
+                return "triangle " + std::to_string(i) + " differs";
+            }
+        }
+    }
+    if (a->numgroups != b->numgroups) {
+        return "group counts differ";
+    }
+    for (OBJgroup *ga = a->groups, *gb = b->groups;  ga != nullptr;  ga = ga->next, gb = gb->next) {
+        if (! sameString(ga->name, gb->name)) {
+            return "group names differ";
+        }
+        if (! sameString(ga->material, gb->material)) {
+            return std::string("materials differ for group '") + ga->name + "'";
+        }
+        if ((ga->numtriangles != gb->numtriangles)
+        || ((ga->numtriangles > 0)
+            && (std::memcmp(ga->triangles, gb->triangles, ga->numtriangles * sizeof(uint32_t)) != 0))) {
+            return std::string("triangles differ for group '") + ga->name + "'";
+        }
+    }
+
+    return "";
+
+}
+
+static void usage ()
+{
+    std::cerr << "usage: obj-bench [ -n <runs> ] [ -t <max-threads> ] file.obj ...\n";
+    exit (1);
+
+}
+
+int main (int argc, char **argv)
+{
+    int nRuns = 5;
+    int maxThreads = std::thread::hardware_concurrency();
+    int i = 1;
+    while ((i + 1 < argc) && (argv[i][0] == '-')) {
+        if (std::strcmp(argv[i], "-n") == 0) {
+            nRuns = std::atoi(argv[i+1]);
+        } else if (std::strcmp(argv[i], "-t") == 0) {
+            maxThreads = std::atoi(argv[i+1]);
+        } else {
+            usage();
+        }
+        i += 2;
+    }
+    if ((i >= argc) || (nRuns < 1) || (maxThreads < 1)) {
+        usage();
+    }
+
+    // the thread counts to test: 1, 2, 4, ..., maxThreads
+    std::vector<int> nThreads;
+    for (int n = 1;  n < maxThreads;  n *= 2) {
+        nThreads.push_back(n);
+    }
+    nThreads.push_back(maxThreads);
+
+    // we want to measure the cost of building the model from the OBJ file
+    OBJ::Model::setCacheEnabled (false);
+
+    bool ok = true;
+    for (;  i < argc;  ++i) {
+        const char *file = argv[i];
+        double mb;
+        {
+            cs237::MappedFile f(file);
+            if (! f.isValid()) {
+                std::cerr << file << ": unable to open file\n";
+                ok = false;
+                continue;
+            }
+            mb = double(f.size()) / (1024.0 * 1024.0);
+        }
+
+        OBJmodel *oldModel, *newModel;
+        double tOld = timeReader (OBJReadOBJLegacy, file, nRuns, oldModel);
+        double tNew = timeReader (
+            [] (const char *f) { return OBJReadOBJ(f); },
+            file, nRuns, newModel);
+        std::cout << file << ": " << newModel->numvertices << " vertices, "
+            << newModel->numtriangles << " triangles, "
+            << newModel->numgroups << " groups\n";
+        std::string diff = compareModels (oldModel, newModel, false);
+        if (! diff.empty()) {
+            std::cerr << file << ": single-pass model differs: " << diff << "\n";
+            ok = false;
+        }
+        std::cout << "  two-pass reader:    " << 1000.0 * tOld << " ms ("
+            << mb / tOld << " MB/s)\n"
+            << "  single-pass reader: " << 1000.0 * tNew << " ms ("
+            << mb / tNew << " MB/s; " << tOld / tNew << "x)\n";
+
+        // the model constructor uses the single-pass reader, so the difference in
+        // times is the cost of deduplicating the vertices and building the groups
+        double tModel = timeModel (file, nRuns);
+        double tDedup = std::max(tModel - tNew, 1.0e-6);
+        std::cout << "  OBJ::Model build:   " << 1000.0 * tModel << " ms (dedup "
+            << 1000.0 * tDedup << " ms; "
+            << 3.0e-6 * double(newModel->numtriangles) / tDedup << " M corners/s)\n";
+
+        {
+            OBJ::Model model(file);
+            cs237::mesh::Stats stats;
+            double tOpt = timeOptimize (model, stats);
+            std::cout << "  mesh optimization:  " << 1000.0 * tOpt << " ms ("
+                << 1.0e-6 * double(newModel->numtriangles) / tOpt << " M triangles/s); ACMR "
+                << stats.acmrBefore << " -> " << stats.acmrAfter << ", ATVR "
+                << stats.atvrBefore << " -> " << stats.atvrAfter << "\n";
+        }
+
+        // the parallel reader with n threads uses n-1 workers plus the calling thread
+        for (int n : nThreads) {
+            if (n < 2) {
+                continue;
+            }
+            cs237::JobSystem jobs(n - 1);
+            OBJmodel *parModel;
+            double tPar = timeReader (
+                [&jobs] (const char *f) { return OBJReadOBJ(f, &jobs); },
+                file, nRuns, parModel);
+            diff = compareModels (newModel, parModel, true);
+            if (! diff.empty()) {
+                std::cerr << file << ": parallel model (" << n << " threads) differs: "
+                    << diff << "\n";
+                ok = false;
+            }
+            std::cout << "  parallel reader (" << n << " threads): " << 1000.0 * tPar
+                << " ms (" << mb / tPar << " MB/s; " << tNew / tPar << "x)\n";
+            delete parModel;
+        }
+
+        delete oldModel;
+        delete newModel;
+    }
+
+    return ok ? 0 : 1;
+
+}
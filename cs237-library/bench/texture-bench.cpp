@@ -0,0 +1,171 @@
+/*! \file texture-bench.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * A benchmark that compares the two ways of uploading texture data: copying it
+ * directly from host memory (when the device supports VK_EXT_host_image_copy)
+ * and copying it through a staging buffer using the graphics queue.  It measures
+ * the time to create a texture from an image and from an image with a pre-built
+ * chain of mipmap levels.  The reported rates count the bytes uploaded.
+ *
+ *      usage: texture-bench [ -n <runs> ] [ <wid> <ht> ]
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include <chrono>
+#include <functional>
+#include <cstring>
+#include <random>
+
+using Clock = std::chrono::steady_clock;
+
+/// time a function
+/// \param fn     the function to time
+/// \param nRuns  the number of times to run the function
+/// \return the best elapsed time in seconds
+static double timeIt (std::function<void()> const &fn, int nRuns)
+{
+    double best = 0.0;
+    for (int run = 0;  run < nRuns;  ++run) {
+        auto start = Clock::now();
+        fn();
+        std::chrono::duration<double> t = Clock::now() - start;
+        best = (run == 0) ? t.count() : std::min(best, t.count());
+    }
+    return best;
+
+}
+
+/// report a time and rate
+static void report (const char *name, double t, size_t nBytes, double baseline = 0.0)
+{
+    std::cout << "  " << name << ": " << 1000.0 * t << " ms ("
+        << double(nBytes) / (1024.0 * 1024.0 * t) << " MB/s";
+    if (baseline > 0.0) {
+        std::cout << "; " << baseline / t << "x";
+    }
+    std::cout << ")\n";
+
+}
+
+/// an application that times texture uploads; the `-no-host-copy` option
+/// forces the staging-buffer path
+class BenchApp : public cs237::Application {
+public:
+    BenchApp (std::vector<std::string> const &args, cs237::Image2D const *img, int nRuns)
+      : cs237::Application (args, "texture-bench"), _img(img), _nRuns(nRuns),
+        _tBase(0.0), _tMips(0.0)
+    { }
+
+    void run () override
+    {
+        // the mipmap levels are built once, so we only measure the upload
+        std::vector<cs237::Image2D *> mips = cs237::generateMipLevels (this->_img);
+        std::vector<cs237::Image2D const *> chain(mips.begin(), mips.end());
+
+        // create one texture first, so that the timings do not include any
+        // one-time driver setup
+        delete new cs237::Texture2D (this, this->_img);
+
+        this->_tBase = timeIt (
+            [this] () { delete new cs237::Texture2D (this, this->_img); },
+            this->_nRuns);
+        this->_tMips = timeIt (
+            [this, &chain] () { delete new cs237::Texture2D (this, this->_img, chain); },
+            this->_nRuns);
+
+        for (auto lvl : mips) {
+            delete lvl;
+        }
+    }
+
+    double baseTime () const { return this->_tBase; }
+    double mipsTime () const { return this->_tMips; }
+
+private:
+    cs237::Image2D const *_img;
+    int _nRuns;
+    double _tBase;              ///< best time to upload the base level
+    double _tMips;              ///< best time to upload the mipmap chain
+};
+
+static void usage ()
+{
+    std::cerr << "usage: texture-bench [ -n <runs> ] [ <wid> <ht> ]\n";
+    exit (1);
+
+}
+
+int main (int argc, char **argv)
+{
+    int nRuns = 10;
+    uint32_t wid = 2048, ht = 2048;
+    int i = 1;
+    while ((i + 1 < argc) && (argv[i][0] == '-')) {
+        if (std::strcmp(argv[i], "-n") == 0) {
+            nRuns = std::atoi(argv[i+1]);
+        } else {
+            usage();
+        }
+        i += 2;
+    }
+    if (i + 2 == argc) {
+        wid = std::atoi(argv[i]);
+        ht = std::atoi(argv[i+1]);
+    } else if (i != argc) {
+        usage();
+    }
+    if ((nRuns < 1) || (wid < 1) || (ht < 1)) {
+        usage();
+    }
+
+    cs237::Image2D img(wid, ht, cs237::Channels::RGBA, cs237::ChannelTy::U8);
+    std::mt19937 rng(17);
+    uint8_t *p = static_cast<uint8_t *>(img.data());
+    for (size_t j = 0;  j < img.nBytes();  ++j) {
+        p[j] = uint8_t(rng());
+    }
+    // the size of the mipmap chain
+    size_t chainBytes = 0;
+    for (uint32_t lvl = 0;  lvl < cs237::numMipLevels(wid, ht);  ++lvl) {
+        chainBytes += size_t(std::max(wid >> lvl, 1u)) * size_t(std::max(ht >> lvl, 1u)) * 4;
+    }
+
+    std::cout << "texture-bench: " << wid << "x" << ht << " RGBA8\n";
+
+    double tBase, tMips;
+    {
+        BenchApp app(std::vector<std::string>{"texture-bench", "-no-host-copy"}, &img, nRuns);
+        app.run();
+        tBase = app.baseTime();
+        tMips = app.mipsTime();
+    }
+
+    BenchApp app(std::vector<std::string>{"texture-bench"}, &img, nRuns);
+    if (app.hostImageCopy()) {
+        app.run();
+    }
+
+    std::cout << "base level\n";
+    report ("staged   ", tBase, img.nBytes());
+    if (app.hostImageCopy()) {
+        report ("host copy", app.baseTime(), img.nBytes(), tBase);
+    }
+    std::cout << "mipmap chain\n";
+    report ("staged   ", tMips, chainBytes);
+    if (app.hostImageCopy()) {
+        report ("host copy", app.mipsTime(), chainBytes, tMips);
+    } else {
+        std::cout << "host image copies are not supported by the device\n";
+    }
+
+    return 0;
+
+}
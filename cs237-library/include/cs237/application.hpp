@@ -33,6 +33,7 @@ friend class Texture2D;
 friend class DepthBuffer;
 friend class Attachment;
 friend class DepthAttachment;
+friend class VirtualTexture;
 
 public:
 
@@ -83,6 +84,12 @@ public:
     /// \brief get the logical device
     vk::Device device () const { return this->_device; }
 
+    /// \brief are textures uploaded directly from host memory?
+    ///
+    /// This is true when the device supports `VK_EXT_host_image_copy` and the
+    /// `-no-host-copy` command-line option was not given.
+    bool hostImageCopy () const { return this->_hostImageCopy; }
+
     /// get the physical-device properties pointer
     const vk::PhysicalDeviceProperties *props () const
     {
@@ -215,6 +222,8 @@ public:
     /// \param blending    color-blending information
     /// \param dynamic     vector that specifies which parts of the pipeline can be
     ///                    dynamically set during the
+    /// \param patchSize   the number of control points per patch when `prim` is
+    ///                    `ePatchList` (ignored otherwise)
     /// \return the created pipeline
     ///
     /// This function creates a pipeline with the following properties:
@@ -242,7 +251,8 @@ public:
         vk::RenderPass renderPass,
         uint32_t subPass,
         vk::PipelineColorBlendStateCreateInfo const &blending,
-        vk::ArrayProxy<vk::DynamicState> const &dynamic);
+        vk::ArrayProxy<vk::DynamicState> const &dynamic,
+        uint32_t patchSize = 0);
 
     /// \brief Allocate a graphics pipeline
     /// \param shaders     shaders for the pipeline
@@ -261,6 +271,8 @@ public:
     ///                    will be used
     /// \param dynamic     vector that specifies which parts of the pipeline can be
     ///                    dynamically set during the
+    /// \param patchSize   the number of control points per patch when `prim` is
+    ///                    `ePatchList` (ignored otherwise)
     /// \return the created pipeline
     ///
     /// This function creates a pipeline with the following properties:
@@ -289,7 +301,8 @@ public:
         vk::PipelineLayout layout,
         vk::RenderPass renderPass,
         uint32_t subPass,
-        vk::ArrayProxy<vk::DynamicState> const &dynamic);
+        vk::ArrayProxy<vk::DynamicState> const &dynamic,
+        uint32_t patchSize = 0);
 
     /// \brief Allocate a graphics pipeline using common defaults
     /// \param shaders     shaders for the pipeline
@@ -306,6 +319,8 @@ public:
     ///                    will be used
     /// \param dynamic     vector that specifies which parts of the pipeline can be
     ///                    dynamically set during the
+    /// \param patchSize   the number of control points per patch when `prim` is
+    ///                    `ePatchList` (ignored otherwise)
     /// \return the created pipeline
     ///
     /// This function creates a pipeline with the following properties:
@@ -334,7 +349,8 @@ public:
         vk::PipelineLayout layout,
         vk::RenderPass renderPass,
         uint32_t subPass,
-        vk::ArrayProxy<vk::DynamicState> const &dynamic)
+        vk::ArrayProxy<vk::DynamicState> const &dynamic,
+        uint32_t patchSize = 0)
     {
         return this->createPipeline(
             shaders,
@@ -350,7 +366,8 @@ public:
             layout,
             renderPass,
             subPass,
-            dynamic);
+            dynamic,
+            patchSize);
     }
 
 /* TODO: define a ComputeShader class, since compute shaders
@@ -435,6 +452,8 @@ protected:
     vk::DebugUtilsMessageSeverityFlagsEXT _messages;
                                 ///< set to the message severity level
     bool _debug;                ///< set when validation layers should be enabled
+    bool _hostImageCopy;        ///< set when textures can be copied directly from
+                                ///  host memory (VK_EXT_host_image_copy)
     vk::Instance _instance;     ///< the Vulkan instance used by the application
     vk::PhysicalDevice _gpu;    ///< the graphics card (aka device) that we are using
     mutable vk::PhysicalDeviceProperties *_propsCache;
@@ -444,6 +463,12 @@ protected:
     Queues<uint32_t> _qIdxs;    ///< the queue family indices
     Queues<vk::Queue> _queues;  ///< the device queues that we are using
     vk::CommandPool _cmdPool;   ///< pool for allocating command buffers
+#ifdef VK_EXT_host_image_copy
+    PFN_vkTransitionImageLayoutEXT _vkTransitionImageLayout;
+                                ///< host-side image-layout transitions
+    PFN_vkCopyMemoryToImageEXT _vkCopyMemoryToImage;
+                                ///< host-to-image copies
+#endif
 
     /// \brief A helper function to create and initialize the Vulkan instance
     /// used by the application.
@@ -519,6 +544,8 @@ protected:
     /// \param usage    flags specifying the usage of the image
     /// \param layout   the image layout
     /// \param mipLvls  number of mipmap levels for the image (default = 1)
+    /// \param nLayers  number of array layers for the image (default = 1)
+    /// \param flags    image-creation flags (e.g., `eCubeCompatible` for cube maps)
     /// \return the created image
     vk::Image _createImage (
         uint32_t wid,
@@ -527,7 +554,9 @@ protected:
         vk::ImageTiling tiling,
         vk::ImageUsageFlags usage,
         vk::ImageLayout layout,
-        uint32_t mipLvls = 1);
+        uint32_t mipLvls = 1,
+        uint32_t nLayers = 1,
+        vk::ImageCreateFlags flags = {});
 
     /// \brief A helper function for creating a Vulkan image that can be used for
     ///        textures or depth buffers
@@ -537,6 +566,8 @@ protected:
     /// \param tiling   the tiling method for the pixels (device optimal vs linear)
     /// \param usage    flags specifying the usage of the image
     /// \param mipLvls  number of mipmap levels for the image
+    /// \param nLayers  number of array layers for the image (default = 1)
+    /// \param flags    image-creation flags (e.g., `eCubeCompatible` for cube maps)
     /// \return the created image
     vk::Image _createImage (
         uint32_t wid,
@@ -544,12 +575,14 @@ protected:
         vk::Format format,
         vk::ImageTiling tiling,
         vk::ImageUsageFlags usage,
-        uint32_t mipLvls = 1)
+        uint32_t mipLvls = 1,
+        uint32_t nLayers = 1,
+        vk::ImageCreateFlags flags = {})
     {
         return this->_createImage (
             wid, ht, format, tiling, usage,
             vk::ImageLayout::eUndefined,
-            mipLvls);
+            mipLvls, nLayers, flags);
     }
 
     /// \brief A helper function for allocating and binding device memory for an image
@@ -567,16 +600,59 @@ protected:
     vk::ImageView _createImageView (
         vk::Image img, vk::Format fmt, vk::ImageAspectFlags aspectFlags);
 
+    /// \brief A helper function for creating a Vulkan image view object that
+    ///        covers all of the mipmap levels and layers of an image
+    /// \param img          the image on which the view is created
+    /// \param fmt          the format and type used to interpret image texels
+    /// \param aspectFlags  a bitmask specifying which aspect(s) of the image are
+    ///                     included in the view.
+    /// \param viewType     the type of the view (e.g., `e2DArray` or `eCube`)
+    /// \param nLevels      the number of mipmap levels in the image
+    /// \param nLayers      the number of array layers in the image
+    /// \return the image view
+    vk::ImageView _createImageView (
+        vk::Image img, vk::Format fmt, vk::ImageAspectFlags aspectFlags,
+        vk::ImageViewType viewType, uint32_t nLevels, uint32_t nLayers);
+
     /// \brief A helper function for changing the layout of an image
     /// \param img        the image to change
     /// \param fmt        the image's format
     /// \param oldLayout  the current layout of `img`
     /// \param newLayout  the new layout of `img`
+    /// \param nLevels    the number of mipmap levels to change, starting with the
+    ///                   base level (default 1)
+    /// \param nLayers    the number of array layers to change (default 1)
     void _transitionImageLayout (
         vk::Image img,
         vk::Format fmt,
         vk::ImageLayout oldLayout,
-        vk::ImageLayout newLayout);
+        vk::ImageLayout newLayout,
+        uint32_t nLevels = 1,
+        uint32_t nLayers = 1);
+
+    /// \brief can an optimal-tiling image be initialized by copying directly from
+    ///        host memory?
+    /// \param fmt    the image's format
+    /// \param usage  the usage of the image (not including `eHostTransferEXT`)
+    /// \param flags  the image-creation flags
+    /// \return true if host image copies are enabled, the format supports them,
+    ///         and the device's access to the image will not be slowed by them
+    bool _canHostCopy (vk::Format fmt, vk::ImageUsageFlags usage, vk::ImageCreateFlags flags);
+
+    /// \brief initialize the mipmap levels of an image by copying them directly
+    ///        from host memory.  The image must have been created with the
+    ///        `eHostTransferEXT` usage (see `_canHostCopy`); it is left in the
+    ///        eShaderReadOnlyOptimal layout.  No command buffers are used.
+    /// \param img      the destination image
+    /// \param wid      the width of the image's base level
+    /// \param ht       the height of the image's base level
+    /// \param nLevels  the number of mipmap levels in the image
+    /// \param nLayers  the number of array layers in the image
+    /// \param levels   the data for each level; the levels of layer 0 come first,
+    ///                 followed by the levels of layer 1, etc.
+    void _copyHostToImage (
+        vk::Image img, uint32_t wid, uint32_t ht, uint32_t nLevels, uint32_t nLayers,
+        std::vector<const void *> const &levels);
 
     /// \brief create a vk::Buffer object
     /// \param size   the size of the buffer in bytes
@@ -597,16 +673,18 @@ protected:
     /// \param size   the size (in bytes) of data to copy
     void _copyBuffer (vk::Buffer dstBuf, vk::Buffer srcBuf, size_t offset, size_t size);
 
-    /// \brief copy data from a buffer to an image
-    /// \param dstImg the destination image
-    /// \param srcBuf the source buffer
-    /// \param size   the size (in bytes) of data to copy
-    /// \param wid    the image width
-    /// \param ht     the image height (default 1)
-    /// \param depth  the image depth (default 1)
+    /// \brief copy data from a buffer to the base level of an image
+    /// \param dstImg   the destination image
+    /// \param srcBuf   the source buffer
+    /// \param size     the size (in bytes) of data to copy
+    /// \param wid      the image width
+    /// \param ht       the image height (default 1)
+    /// \param depth    the image depth (default 1)
+    /// \param nLayers  the number of array layers, which are packed one after
+    ///                 the other in the buffer (default 1)
     void _copyBufferToImage (
         vk::Image dstImg, vk::Buffer srcBuf, size_t size,
-        uint32_t wid, uint32_t ht=1, uint32_t depth=1);
+        uint32_t wid, uint32_t ht=1, uint32_t depth=1, uint32_t nLayers=1);
 
     /* debug-message support */
     VkDebugUtilsMessengerEXT _debugMessenger;
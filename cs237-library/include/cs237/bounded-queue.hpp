@@ -0,0 +1,134 @@
+/*! \file bounded-queue.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * A fixed-capacity queue for passing values between threads.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_BOUNDED_QUEUE_HPP_
+#define _CS237_BOUNDED_QUEUE_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237/bounded-queue.hpp should not be included directly"
+#endif
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace cs237 {
+
+/// A thread-safe FIFO queue with a fixed capacity.  Producers block in `push`
+/// while the queue is full, which provides back-pressure when the consumer
+/// falls behind.  Once the queue is closed, `push` fails immediately and
+/// the consumer can drain any remaining items.
+template <typename T>
+class BoundedQueue {
+public:
+
+    /// create an empty queue
+    /// \param capacity  the maximum number of items in the queue
+    explicit BoundedQueue (size_t capacity)
+      : _capacity(capacity), _closed(false)
+    {
+        assert (capacity > 0);
+    }
+
+    BoundedQueue (BoundedQueue const &) = delete;
+    BoundedQueue &operator= (BoundedQueue const &) = delete;
+
+    /// the maximum number of items in the queue
+    size_t capacity () const { return this->_capacity; }
+
+    /// \brief add an item to the end of the queue, waiting for space if the queue is full
+    /// \param item  the item to add
+    /// \return true if the item was added and false if the queue has been closed
+    bool push (T const &item)
+    {
+        std::unique_lock<std::mutex> lk(this->_mu);
+        this->_notFull.wait(lk, [this] () {
+            return this->_closed || (this->_items.size() < this->_capacity);
+        });
+        if (this->_closed) {
+            return false;
+        }
+        this->_items.push_back(item);
+        lk.unlock();
+        this->_notEmpty.notify_one();
+        return true;
+    }
+
+    /// \brief remove the item at the front of the queue without blocking
+    /// \param[out] item  set to the removed item
+    /// \return true if an item was removed and false if the queue was empty
+    bool tryPop (T &item)
+    {
+        std::unique_lock<std::mutex> lk(this->_mu);
+        if (this->_items.empty()) {
+            return false;
+        }
+        item = this->_items.front();
+        this->_items.pop_front();
+        lk.unlock();
+        this->_notFull.notify_one();
+        return true;
+    }
+
+    /// \brief remove the item at the front of the queue, waiting for one to
+    ///        arrive if the queue is empty
+    /// \param[out] item  set to the removed item
+    /// \return true if an item was removed and false if the queue is closed and empty
+    bool pop (T &item)
+    {
+        std::unique_lock<std::mutex> lk(this->_mu);
+        this->_notEmpty.wait(lk, [this] () {
+            return this->_closed || !this->_items.empty();
+        });
+        if (this->_items.empty()) {
+            return false;
+        }
+        item = this->_items.front();
+        this->_items.pop_front();
+        lk.unlock();
+        this->_notFull.notify_one();
+        return true;
+    }
+
+    /// close the queue; blocked producers and consumers are woken up
+    void close ()
+    {
+        {
+            std::lock_guard<std::mutex> lk(this->_mu);
+            this->_closed = true;
+        }
+        this->_notFull.notify_all();
+        this->_notEmpty.notify_all();
+    }
+
+    /// is the queue currently empty?
+    bool isEmpty ()
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+        return this->_items.empty();
+    }
+
+private:
+    size_t _capacity;                   ///< the maximum number of items
+    bool _closed;                       ///< set when the queue has been closed
+    std::mutex _mu;                     ///< lock protecting the queue state
+    std::condition_variable _notFull;   ///< signaled when an item is removed
+    std::condition_variable _notEmpty;  ///< signaled when an item is added
+    std::deque<T> _items;               ///< the items in the queue
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_BOUNDED_QUEUE_HPP_
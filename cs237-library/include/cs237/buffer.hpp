@@ -86,6 +86,64 @@ protected:
 
 };
 
+/// A view of a range of a buffer's memory as an array of `T` that is mapped
+/// into the host's address space, which allows the buffer's contents to be
+/// built in place instead of being copied from a temporary array.  The memory
+/// is unmapped when the writer is destroyed, so a buffer can only have one
+/// writer at a time.  Buffer memory is host coherent, so the writes do not
+/// need to be flushed, but it may be write combined, so the contents should be
+/// written sequentially and not read back.
+template <typename T>
+class BufferWriter {
+public:
+
+    /// constructor
+    /// \param mem    the buffer's memory object
+    /// \param first  the index of the first element of the range
+    /// \param n      the number of elements in the range
+    BufferWriter (MemoryObj *mem, size_t first, size_t n)
+      : _mem(mem), _n(n), _ptr(nullptr)
+    {
+        if (n > 0) {
+            this->_ptr = static_cast<T *>(mem->map(first * sizeof(T), n * sizeof(T)));
+        }
+    }
+
+    BufferWriter (BufferWriter &&w) : _mem(w._mem), _n(w._n), _ptr(w._ptr)
+    {
+        w._ptr = nullptr;
+    }
+
+    BufferWriter (BufferWriter const &) = delete;
+    BufferWriter &operator= (BufferWriter const &) = delete;
+
+    /// destructor unmaps the memory
+    ~BufferWriter ()
+    {
+        if (this->_ptr != nullptr) {
+            this->_mem->unmap();
+        }
+    }
+
+    /// the number of elements in the range
+    size_t size () const { return this->_n; }
+
+    /// the host address of the first element of the range
+    T *data () const { return this->_ptr; }
+
+    /// access the i'th element of the range for writing
+    T &operator[] (size_t i) const
+    {
+        assert ((i < this->_n) && "index out of range");
+        return this->_ptr[i];
+    }
+
+private:
+    MemoryObj *_mem;
+    size_t _n;
+    T *_ptr;
+};
+
 /// Buffer class for vertex data; the type parameter `V` is the type of an
 /// individual vertex.
 template <typename V>
@@ -102,7 +160,8 @@ public:
     /// This constructor creates the vertex buffer and allocates GPU-side memory
     /// for it.
     VertexBuffer (Application *app, uint32_t nVerts)
-      : Buffer (app, vk::BufferUsageFlagBits::eVertexBuffer, nVerts*sizeof(V))
+      : Buffer (app, vk::BufferUsageFlagBits::eVertexBuffer, nVerts*sizeof(V)),
+        _nVerts(nVerts)
     { }
 
     /// constructor with initialization
@@ -135,6 +194,15 @@ public:
         this->_copyTo(src.data(), offset*sizeof(V), src.size()*sizeof(V));
     }
 
+    /// get the number of vertices in the buffer
+    uint32_t nVerts () const { return this->_nVerts; }
+
+    /// map the buffer's vertices for writing them in place
+    BufferWriter<V> map () { return BufferWriter<V>(this->_mem, 0, this->_nVerts); }
+
+private:
+    uint32_t _nVerts;
+
 };
 
 /// Buffer class for index data; the type parameter `I` is the index type.
@@ -183,6 +251,9 @@ public:
         this->_copyTo(src.data(), offset*sizeof(I), src.size()*sizeof(I));
     }
 
+    /// map the buffer's indices for writing them in place
+    BufferWriter<I> map () { return BufferWriter<I>(this->_mem, 0, this->_nIndices); }
+
 private:
     uint32_t _nIndices;
 
@@ -309,7 +380,7 @@ public:
     StorageBuffer (Application *app, vk::ArrayProxy<S> const &src)
     : Buffer (app, vk::BufferUsageFlagBits::eStorageBuffer, src.size()*sizeof(S))
     {
-        this->copyTo(src.data());
+        this->copyTo(src);
     }
 
     /// copy the buffer data to the device memory object
@@ -346,6 +417,49 @@ public:
 
 };
 
+/// An `IndirectBuffer<C>` holds the commands for indirect draws (or dispatches),
+/// where `C` is the command type (e.g., `vk::DrawIndexedIndirectCommand`).  The
+/// buffer is also a storage buffer, so that the commands can be written by a
+/// compute shader.
+template <typename C>
+class IndirectBuffer : public Buffer {
+public:
+
+    /// the type of the commands
+    using CommandType = C;
+
+    /// constructor
+    /// \param app    the owning application object
+    /// \param nCmds  the number of commands in the buffer
+    IndirectBuffer (Application *app, uint32_t nCmds)
+    : Buffer (app,
+        vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+        nCmds*sizeof(C)),
+      _nCmds(nCmds)
+    { }
+
+    /// get the number of commands in the buffer
+    uint32_t nCmds () const { return this->_nCmds; }
+
+    /// copy commands to the device memory object
+    /// \param src  the array of commands that are copied to the buffer
+    void copyTo (vk::ArrayProxy<C> const &src)
+    {
+        assert ((src.size() * sizeof(C) <= this->_mem->size()) && "src is too large");
+        this->_copyTo(src.data(), 0, src.size()*sizeof(C));
+    }
+
+    /// get the buffer-descriptor info for using this buffer as a storage buffer
+    vk::DescriptorBufferInfo descInfo ()
+    {
+        return vk::DescriptorBufferInfo(this->_buf, 0, VK_WHOLE_SIZE);
+    }
+
+private:
+    uint32_t _nCmds;
+
+};
+
 } // namespace cs237
 
 #endif // !_CS237_BUFFER_HPP_
@@ -0,0 +1,140 @@
+/*! \file compressed-image.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Block-compressed (BCn) images with their mipmap levels.  Compressed images
+ * can be loaded from DDS or KTX2 files, or they can be produced from `Image2D`
+ * levels by the CPU encoder, which is meant to be run once as part of building
+ * a cache of assets (it is much slower than loading a PNG file).
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_COMPRESSED_IMAGE_HPP_
+#define _CS237_COMPRESSED_IMAGE_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237/compressed-image.hpp should not be included directly"
+#endif
+
+#include <ostream>
+
+namespace cs237 {
+
+class JobSystem;
+
+//! the block-compression formats.  All of the formats encode 4x4 blocks of pixels.
+enum class BlockFormat {
+    BC1,            //!< RGB with an optional 1-bit alpha; 8 bytes per block
+    BC3,            //!< RGBA with an interpolated alpha; 16 bytes per block
+    BC5,            //!< two-channel (RG) data, such as normal maps; 16 bytes per block
+    BC7             //!< high-quality RGB(A) data, such as albedo maps; 16 bytes per block
+};
+
+//! convert a BlockFormat value to a printable string
+std::string to_string (BlockFormat fmt);
+
+//! A 2D image with a chain of mipmap levels that are compressed using one of the
+//! `BlockFormat` formats.  The levels of the chain follow the usual rule: level i+1
+//! is half the size of level i (rounded down, but at least 1).
+class CompressedImage2D {
+  public:
+  //! load a compressed image from a DDS or KTX2 file; the kind of file is determined
+  //! by its contents.
+  //! \param file the name of the file
+    explicit CompressedImage2D (std::string const &file);
+
+  //! create a compressed image from the contents of a DDS or KTX2 file that are
+  //! in memory.  The image refers to the data without copying it, so the data
+  //! must outlive the image; this constructor is useful for images that live in
+  //! a memory-mapped file.
+  //! \param data the file contents
+  //! \param sz the size of the data in bytes
+  //! \param name the name of the data used in error messages
+    CompressedImage2D (const void *data, size_t sz, std::string const &name);
+
+  //! compress a chain of mipmap levels.  The levels must have 8-bit channels; the
+  //! BC5 format uses the first two channels and the other formats use the RGB(A)
+  //! channels of the levels.  The sRGB flag of the compressed image is taken from
+  //! level 0 (BC5 images are never sRGB).
+  //! \param fmt the block format to use
+  //! \param levels the mipmap levels, starting with the base level
+  //! \param jobs if non-null, the blocks are compressed in parallel using the
+  //!        job system
+    CompressedImage2D (
+        BlockFormat fmt,
+        std::vector<Image2D const *> const &levels,
+        JobSystem *jobs = nullptr);
+
+    CompressedImage2D (CompressedImage2D const &) = delete;
+    CompressedImage2D &operator= (CompressedImage2D const &) = delete;
+
+  //! the block format of the image
+    BlockFormat blockFormat () const { return this->_blkFmt; }
+  //! should the image be interpreted as an sRGB encoded image?
+    bool isSRGB () const { return this->_sRGB; }
+  //! return the vulkan format of the image data
+    vk::Format format () const;
+  //! the size of a 4x4 block in bytes
+    size_t blockSize () const { return (this->_blkFmt == BlockFormat::BC1) ? 8 : 16; }
+
+  //! return the width of the base level
+    uint32_t width () const { return this->_wid; }
+  //! return the height of the base level
+    uint32_t height () const { return this->_ht; }
+  //! the number of mipmap levels
+    uint32_t nLevels () const { return this->_levels.size(); }
+
+  //! the width of a mipmap level
+    uint32_t levelWidth (uint32_t lvl) const { return std::max(this->_wid >> lvl, 1u); }
+  //! the height of a mipmap level
+    uint32_t levelHeight (uint32_t lvl) const { return std::max(this->_ht >> lvl, 1u); }
+  //! the compressed data for a mipmap level
+    const void *levelData (uint32_t lvl) const { return this->_levels[lvl]; }
+  //! the size in bytes of the compressed data for a mipmap level
+    size_t levelSize (uint32_t lvl) const;
+  //! the total number of bytes of compressed data
+    size_t nBytes () const;
+
+  //! decode a mipmap level.  The result is an RGBA image for the BC1, BC3, and BC7
+  //! formats and an RG image for BC5; in both cases the channels are unsigned bytes.
+  //! This function is used to load textures on devices that do not support the
+  //! block format.
+  //! \param lvl the level to decode
+  //! \return the decoded image, which is owned by the caller
+    Image2D *decode (uint32_t lvl) const;
+
+  //! write the image to a file in DDS format
+  //! \param file the name of the DDS file
+  //! \return true if successful, false otherwise
+    bool write (std::string const &file) const;
+
+  //! write the image to an output stream in DDS format
+  //! \param outS the output stream
+  //! \return true if successful, false otherwise
+    bool write (std::ostream &outS) const;
+
+  private:
+    BlockFormat _blkFmt;                //!< the block format
+    bool _sRGB;                         //!< should the image be interpreted as sRGB?
+    uint32_t _wid;                      //!< the width of the base level in pixels
+    uint32_t _ht;                       //!< the height of the base level in pixels
+    std::vector<const uint8_t *> _levels; //!< the data for the levels
+    std::vector<uint8_t> _storage;      //!< storage for images that own their data
+
+  //! initialize the image from the contents of a DDS or KTX2 file
+    void _parse (const uint8_t *data, size_t sz, std::string const &name);
+  //! parse the contents of a DDS file
+    bool _parseDDS (const uint8_t *data, size_t sz);
+  //! parse the contents of a KTX2 file
+    bool _parseKTX2 (const uint8_t *data, size_t sz);
+};
+
+} /* namespace cs237 */
+
+#endif /* !_CS237_COMPRESSED_IMAGE_HPP_ */
@@ -21,10 +21,12 @@
 #include <cstdint>
 #include <cassert>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <array>
 
 /* GLM include files; we include the extensions, such as transforms,
  * and enable the experimental support for `to_string`.
@@ -69,13 +71,26 @@ inline void ReportError (const char *file, int line, std::string const &msg)
 #include "cs237/memory-obj.hpp"
 #include "cs237/buffer.hpp"
 #include "cs237/image.hpp"
+#include "cs237/compressed-image.hpp"
+#include "cs237/texture-atlas.hpp"
 #include "cs237/texture.hpp"
 #include "cs237/attachment.hpp"
 #include "cs237/depth-buffer.hpp"
+#include "cs237/mapped-file.hpp"
+
+/* parallelism support */
+#include "cs237/job-system.hpp"
+#include "cs237/bounded-queue.hpp"
+
+/* virtual textures (uses the mapped-file and queue support) */
+#include "cs237/virtual-texture.hpp"
 
 /* geometric types */
 #include "cs237/aabb.hpp"
 #include "cs237/plane.hpp"
+#include "cs237/mesh-opt.hpp"
+#include "cs237/meshlet.hpp"
+#include "cs237/mesh-simplify.hpp"
 #include "cs237/gobjects.hpp"
 
 /***** a wrapper for printing GLM vectors *****/
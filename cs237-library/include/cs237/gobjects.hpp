@@ -149,6 +149,25 @@ Obj *cone (
     uint32_t slices,
     uint32_t stacks);
 
+/// reorder the triangles and vertices of an object for better vertex-cache and
+/// fetch locality and less overdraw (see `cs237::mesh::optimize`)
+/// \param obj  the object to optimize, which is modified in place
+/// \return the vertex-cache statistics of the object before and after optimization
+inline mesh::Stats optimize (Obj *obj)
+{
+    return mesh::optimize (
+        obj->nVerts, obj->nIndices,
+        obj->verts, obj->norms, obj->txtCoords, obj->indices);
+}
+
+/// split an object into meshlets (see `cs237::mesh::buildMeshlets`)
+/// \param obj  the object to split
+/// \return the meshlets of the object
+inline mesh::Meshlets buildMeshlets (Obj const *obj)
+{
+    return mesh::buildMeshlets (obj->nIndices, obj->indices, obj->verts, obj->nVerts);
+}
+
 } // namespace gobj
 } // namespace cs237
 
@@ -21,6 +21,8 @@
 
 namespace cs237 {
 
+class JobSystem;
+
 //! the channels of an image
 enum class Channels {
     UNKNOWN,        //!< unknown
@@ -63,6 +65,9 @@ namespace __detail {
         Channels channels () const { return this->_chans; }
         //! returns the type of the channels
         ChannelTy type () const { return this->_type; }
+        //! should the image be interpreted as an sRGB encoded image?
+        bool isSRGB () const { return this->_sRGB; }
+
         //! return the vulkan format of the image data
         vk::Format format () const { return toVkFormat(this->_chans, this->_type, this->_sRGB); }
         //! the data pointer
@@ -76,10 +81,10 @@ namespace __detail {
         //! the number of bytes per pixel
         size_t nBytesPerPixel () const;
 
-        //! add an opaque alpha channel to the imag
+        //! add an opaque alpha channel to the image
         //!
         //! This operation only works on images with RGB or BGR pixel format;
-        //! and is a no-op for other formats.
+        //! and is a no-op for other formats.  All channel types are supported.
         //! It is necessary, because many Vulkan implementations do not
         //! support 24-bit pixels.
         void addAlphaChannel ();
@@ -91,16 +96,25 @@ namespace __detail {
         bool _sRGB;             //!< should the image be interpreted as an sRGB encoded image?
         size_t _nBytes;         //!< size in bytes of image data
         void *_data;            //!< the raw image data
+        bool _ownsData;         //!< true if `_data` is freed by the destructor; it is
+                                //!  false for images that refer to memory owned by
+                                //!  someone else (e.g., a memory-mapped file)
 
         explicit ImageBase ()
           : _nDims(0), _chans(Channels::UNKNOWN), _type(ChannelTy::UNKNOWN), _sRGB(false),
-            _nBytes(0), _data(nullptr)
+            _nBytes(0), _data(nullptr), _ownsData(true)
         { }
         explicit ImageBase (uint32_t nd)
           : _nDims(nd), _chans(Channels::UNKNOWN), _type(ChannelTy::UNKNOWN), _sRGB(false),
-            _nBytes(0), _data(nullptr)
+            _nBytes(0), _data(nullptr), _ownsData(true)
+        { }
+        explicit ImageBase (uint32_t nd, Channels chans, ChannelTy ty, size_t nPixels)
+          : ImageBase (nd, chans, ty, false, nPixels)
         { }
-        explicit ImageBase (uint32_t nd, Channels chans, ChannelTy ty, size_t nPixels);
+        explicit ImageBase (uint32_t nd, Channels chans, ChannelTy ty, bool sRGB, size_t nPixels);
+        explicit ImageBase (
+            uint32_t nd, Channels chans, ChannelTy ty, bool sRGB, size_t nPixels,
+            void *data);
 
         virtual ~ImageBase ();
 
@@ -145,6 +159,25 @@ class Image2D : public __detail::ImageBase {
   //! \param ty the type of the elements
     Image2D (uint32_t wid, uint32_t ht, Channels chans, ChannelTy ty);
 
+  //! create and allocate space for an uninitialized image with the given encoding
+  //! \param wid the width of the image
+  //! \param ht the height of the image
+  //! \param chans the image format
+  //! \param ty the type of the elements
+  //! \param sRGB should the image be interpreted as an sRGB encoded image?
+    Image2D (uint32_t wid, uint32_t ht, Channels chans, ChannelTy ty, bool sRGB);
+
+  //! create an image that refers to existing pixel data without copying it.  The
+  //! data is not freed by the image, so it must outlive the image; this constructor
+  //! is useful for images that live in a memory-mapped file.
+  //! \param wid the width of the image
+  //! \param ht the height of the image
+  //! \param chans the image format
+  //! \param ty the type of the elements
+  //! \param sRGB should the image be interpreted as an sRGB encoded image?
+  //! \param data the pixel data
+    Image2D (uint32_t wid, uint32_t ht, Channels chans, ChannelTy ty, bool sRGB, void *data);
+
   //! create and initialize an image from a PNG file.
   //! \param file the name of the PNG file
   //! \param flip set to true if the image should be flipped vertically to match OpenGL
@@ -192,6 +225,26 @@ class Image2D : public __detail::ImageBase {
   //! format and sample type.
     void bitblt (Image2D const &src, uint32_t row, uint32_t col);
 
+  //! create a copy of this image with a different pixel format
+  //! \param chans the channels of the new image
+  //! \param ty the channel type of the new image
+  //! \param sRGB should the new image be sRGB encoded?
+  //! \param jobs if non-null, large images are converted in parallel using the
+  //!        job system
+  //! \return the new image, which is owned by the caller
+  //!
+  //! Channels are added, dropped, or reordered as necessary; a missing alpha
+  //! channel is opaque, a single-channel image is treated as gray, and other
+  //! missing channels are zero.  The channel type can only be changed between
+  //! U8, U16, and F32 (F32 values are normalized to 0..1), and changing the sRGB
+  //! encoding (which does not apply to alpha) requires one of those types.
+    Image2D *convert (Channels chans, ChannelTy ty, bool sRGB, JobSystem *jobs = nullptr) const;
+
+  //! flip the image vertically in place
+  //! \param jobs if non-null, large images are flipped in parallel using the
+  //!        job system
+    void flip (JobSystem *jobs = nullptr);
+
   protected:
     uint32_t _wid;      //!< the width of the image in pixels
     uint32_t _ht;       //!< the height of the image in pixels
@@ -233,6 +286,49 @@ class DataImage2D : public Image2D {
 
 };
 
+//! return the number of levels in a complete mipmap chain for an image, which is
+//! floor(log2(max(wid, ht))) + 1.  The size of the image does not have to be a power
+//! of two; level i+1 is half the size of level i (rounded down, but at least 1).
+//! \param wid the width of the base level
+//! \param ht the height of the base level
+//! \return the number of levels, including the base level
+uint32_t numMipLevels (uint32_t wid, uint32_t ht);
+
+//! generate the mipmap levels that follow an image on the CPU.  The levels are
+//! computed using a box filter that correctly weights the pixels of odd-sized
+//! levels, and sRGB images are filtered in linear space.  Integer data is rounded
+//! to the nearest value, and 32-bit integer data is filtered at single precision.
+//! \param img the base level
+//! \param jobs if non-null, the rows of each level are computed in parallel using
+//!        the job system
+//! \return the levels (not including `img`), which are owned by the caller
+std::vector<Image2D *> generateMipLevels (Image2D const *img, JobSystem *jobs = nullptr);
+
+//! copy a square tile of texels from an image, where texels outside the image are
+//! clamped to its edges.  This is used to cut images into tiles that have a border
+//! (or apron) of texels from their neighbors.  The texel type is a template
+//! parameter (e.g., `uint32_t` for RGBA8 texels or `uint16_t` for R16 samples).
+//! \param src the texels of the image in row-major order
+//! \param wid the width of the image
+//! \param ht the height of the image
+//! \param x0 the column of the first texel of the tile, which may be outside the image
+//! \param y0 the row of the first texel of the tile, which may be outside the image
+//! \param size the number of texels along a side of the tile
+//! \param dst the destination for the `size*size` texels of the tile
+template <typename T>
+void copyClampedTile (
+    const T *src, uint32_t wid, uint32_t ht,
+    int32_t x0, int32_t y0, uint32_t size,
+    T *dst)
+{
+    for (int32_t r = 0;  r < int32_t(size);  ++r) {
+        const T *row = src + size_t(std::clamp(y0 + r, 0, int32_t(ht) - 1)) * size_t(wid);
+        for (int32_t c = 0;  c < int32_t(size);  ++c) {
+            *dst++ = row[std::clamp(x0 + c, 0, int32_t(wid) - 1)];
+        }
+    }
+}
+
 } /* namespace cs237 */
 
 #endif /* !_CS237_IMAGE_HPP_ */
@@ -0,0 +1,170 @@
+/*! \file job-system.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * A simple work-stealing job system for running CPU-side tasks (e.g.,
+ * loading assets) in parallel.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_JOB_SYSTEM_HPP_
+#define _CS237_JOB_SYSTEM_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237/job-system.hpp should not be included directly"
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace cs237 {
+
+class JobSystem;
+
+/// a unit of work that has been submitted to a `JobSystem`.  Jobs are
+/// allocated and owned by the job system; a pointer to a job remains
+/// valid until the next call to `JobSystem::waitAll` (or until the job
+/// system is destroyed).
+class Job {
+    friend class JobSystem;
+
+public:
+
+    /// has the job finished running?
+    bool isDone () const { return this->_done.load(std::memory_order_acquire); }
+
+    /// did the job fail?  A job fails when its function raises an exception or
+    /// when one of its dependencies fails, in which case its function is not run.
+    /// The result is only meaningful once the job is done.
+    bool failed () const { return this->_failed.load(std::memory_order_acquire); }
+
+private:
+    std::function<void()> _fn;          ///< the work to be done
+    std::atomic<int> _nPending;         ///< the number of unfinished dependencies plus
+                                        ///  one while the job is being set up
+    std::atomic<bool> _done;            ///< set once `_fn` has returned
+    std::atomic<bool> _failed;          ///< set if `_fn` raised an exception or a
+                                        ///  dependency failed
+    std::mutex _mu;                     ///< protects `_succs` and `_exn`
+    std::exception_ptr _exn;            ///< the exception that caused the job to
+                                        ///  fail, which is inherited from the failed
+                                        ///  dependency if `_fn` was not run
+    std::vector<Job *> _succs;          ///< jobs that are waiting on this job
+
+    explicit Job (std::function<void()> const &fn)
+      : _fn(fn), _nPending(1), _done(false), _failed(false)
+    { }
+};
+
+/// A pool of worker threads that run jobs.  Each worker has its own
+/// double-ended queue of ready jobs; a worker pushes and pops jobs at the
+/// back of its own queue and, when its queue is empty, steals jobs from the
+/// front of the other workers' queues.  Jobs may be spawned from any thread,
+/// including from inside other jobs, and may depend on previously spawned jobs.
+///
+/// If a job raises an exception, the failure propagates to the jobs that depend
+/// on the failed job, which are marked as failed and finish without running.
+/// Waiting on a failed job rethrows the exception that caused its failure (i.e.,
+/// its own exception or that of the dependency that failed), while `waitAll`
+/// rethrows the first exception raised by any job since the previous `waitAll`.
+class JobSystem {
+public:
+
+    /// create a job system
+    /// \param nWorkers  the number of worker threads; if this value is zero (the
+    ///                  default), then one worker per hardware thread is created.
+    explicit JobSystem (unsigned int nWorkers = 0);
+
+    JobSystem (JobSystem const &) = delete;
+    JobSystem &operator= (JobSystem const &) = delete;
+
+    /// destructor; waits for any outstanding jobs and then shuts down the workers
+    ~JobSystem ();
+
+    /// the number of worker threads
+    unsigned int numWorkers () const { return this->_workers.size(); }
+
+    /// \brief spawn a new job
+    /// \param fn    the function to run
+    /// \param deps  jobs that must finish before `fn` is run (`nullptr` entries
+    ///              are ignored)
+    /// \return a pointer to the new job
+    Job *spawn (std::function<void()> const &fn, std::vector<Job *> const &deps = {});
+
+    /// \brief wait for a job to finish.  If the job failed, then the exception
+    ///        that caused the failure is rethrown.
+    /// \param job  the job to wait for
+    ///
+    /// The calling thread helps by running ready jobs while it waits.
+    void wait (Job *job);
+
+    /// \brief wait for all of the spawned jobs to finish.  Once this function
+    ///        returns, the job objects are deallocated.  If any of the jobs
+    ///        raised an exception, then the first one is rethrown.
+    ///
+    /// The calling thread helps by running ready jobs while it waits.
+    void waitAll ();
+
+private:
+    /// the per-worker queue of ready jobs
+    struct Queue {
+        std::mutex mu;
+        std::deque<Job *> jobs;
+    };
+
+    std::vector<std::thread> _workers;  ///< the worker threads
+    std::vector<Queue *> _queues;       ///< the per-worker queues
+    std::atomic<unsigned int> _nextQ;   ///< round-robin index used to distribute
+                                        ///  jobs that are spawned by non-worker threads
+    std::atomic<int> _nReady;           ///< the number of jobs in the queues
+    std::atomic<int> _nUnfinished;      ///< the number of jobs that have not finished
+    bool _shutdown;                     ///< set when the workers should exit
+    std::mutex _mu;                     ///< lock for `_cv`, `_shutdown`, `_jobs`,
+                                        ///  and `_exn`
+    std::condition_variable _cv;        ///< signaled when a job becomes ready
+                                        ///  or finishes
+    std::vector<Job *> _jobs;           ///< all of the jobs spawned since the last
+                                        ///  `waitAll`
+    std::exception_ptr _exn;            ///< the first exception raised by a job
+                                        ///  since the last `waitAll`
+
+    /// the main loop for a worker thread
+    void _workerLoop (unsigned int id);
+
+    /// add a ready job to a queue
+    void _enqueue (Job *job);
+
+    /// find a ready job, trying the queue `id` first and then stealing from the others
+    /// \return the job or nullptr if there were no ready jobs
+    Job *_findJob (unsigned int id);
+
+    /// run a job (unless one of its dependencies failed) and then release its
+    /// successors, which inherit its failure
+    void _run (Job *job);
+
+    /// mark a job as failed because of the exception `exn`; only the first
+    /// exception is recorded
+    static void _fail (Job *job, std::exception_ptr const &exn);
+
+    /// wake up the sleeping threads
+    void _notify ();
+
+    /// rethrow the first exception raised since the last `waitAll` (if any)
+    void _checkError ();
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_JOB_SYSTEM_HPP_
@@ -0,0 +1,84 @@
+/*! \file mapped-file.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Read-only access to the contents of a file that has been mapped into memory,
+ * plus a helper for writing files that are read this way.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_MAPPED_FILE_HPP_
+#define _CS237_MAPPED_FILE_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237/mapped-file.hpp should not be included directly"
+#endif
+
+#include <functional>
+#include <iosfwd>
+
+namespace cs237 {
+
+/// The contents of a file mapped read-only into the address space of the
+/// program.  On systems that do not support `mmap`, the file is read into
+/// a heap-allocated buffer instead.
+class MappedFile {
+public:
+
+    /// map a file into memory
+    /// \param path  the path to the file
+    ///
+    /// If the file cannot be opened or mapped, then the resulting object
+    /// is invalid (see `isValid`).
+    explicit MappedFile (std::string const &path);
+
+    MappedFile (MappedFile const &) = delete;
+    MappedFile &operator= (MappedFile const &) = delete;
+
+    /// destructor; unmaps the file
+    ~MappedFile ();
+
+    /// was the file successfully mapped?
+    bool isValid () const { return this->_valid; }
+
+    /// the address of the first byte of the file's contents (nullptr for
+    /// empty or invalid files)
+    const char *data () const { return this->_data; }
+
+    /// the size of the file in bytes
+    size_t size () const { return this->_sz; }
+
+    /// the address just past the end of the file's contents
+    const char *end () const { return this->_data + this->_sz; }
+
+private:
+    const char *_data;          ///< the file's contents
+    size_t _sz;                 ///< the size of the file
+    bool _valid;                ///< true if the file was successfully mapped
+    bool _isMapped;             ///< true if `_data` was mapped (as opposed to
+                                ///  allocated by `new[]`)
+
+};
+
+/// \brief write a file atomically.  The contents are written to a temporary
+///        file in the same directory, which is then renamed to `path`, so a
+///        reader never sees a partially written file and concurrent writers
+///        of the same file do not interfere with each other.
+/// \param path   the path of the file
+/// \param write  the function that writes the contents to the (binary) output
+///               stream, which may seek; it returns false on failure
+/// \return true if the file was written and false otherwise, in which case the
+///         original file (if any) is unchanged
+bool writeFileAtomically (
+    std::string const &path,
+    std::function<bool(std::ofstream &)> const &write);
+
+} // namespace cs237
+
+#endif // !_CS237_MAPPED_FILE_HPP_
@@ -33,22 +33,32 @@ public:
     /// \param sz      size in bytes of the data to copy
     void copyTo (const void *src, size_t offset, size_t sz)
     {
-        assert (offset + sz <= this->_sz);
-
-        auto dev = this->_app->_device;
-
         // first we need to map the object into our address space
-        auto dst = dev.mapMemory(this->_mem, offset, this->_sz, {});
+        auto dst = this->map(offset, sz);
         // copy the data
         memcpy(dst, src, sz);
         // unmap the object
-        this->_app->_device.unmapMemory (this->_mem);
+        this->unmap();
     }
 
     /// copy data to the device memory object
     /// \param src  address of data to copy
     void copyTo (const void *src) { this->copyTo(src, 0, this->_sz); }
 
+    /// map a subrange of the device memory object into the host's address space.
+    /// A memory object can only have one mapping at a time.
+    /// \param offset  offset from the beginning of the memory object
+    /// \param sz      size in bytes of the range to map
+    /// \return the host address of the start of the range
+    void *map (size_t offset, size_t sz)
+    {
+        assert (offset + sz <= this->_sz);
+        return this->_app->_device.mapMemory(this->_mem, offset, sz, {});
+    }
+
+    /// unmap the device memory object
+    void unmap () { this->_app->_device.unmapMemory (this->_mem); }
+
     /// the size of the memory object in bytes
     size_t size () const { return this->_sz; }
 
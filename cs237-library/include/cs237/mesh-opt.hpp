@@ -0,0 +1,151 @@
+/*! \file mesh-opt.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Optimization of indexed triangle meshes for the GPU.  The main entry point
+ * is `optimize`, which reorders the triangles of a mesh to make good use of the
+ * post-transform vertex cache (using the "Tipsify" algorithm), reorders clusters
+ * of triangles to reduce overdraw, and then renumbers the vertices so that they
+ * are fetched in order.  The individual passes are also exposed.
+ *
+ * The algorithms are from "Fast Triangle Reordering for Vertex Locality and
+ * Reduced Overdraw" by Sander, Nehab, and Barczak (SIGGRAPH 2007).
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_MESH_OPT_HPP_
+#define _CS237_MESH_OPT_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237/mesh-opt.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+namespace mesh {
+
+/// the size of the FIFO vertex cache that we optimize for
+constexpr uint32_t kVertexCacheSize = 16;
+
+/// the default bound on how much the overdraw pass can increase the ACMR
+/// (as a fraction of the ACMR produced by the vertex-cache pass)
+constexpr float kOverdrawThreshold = 1.05f;
+
+/// statistics about the vertex-cache behavior of a mesh
+struct Stats {
+    float acmrBefore;           ///< average cache-miss ratio (transformed vertices
+                                ///  per triangle) before optimization
+    float acmrAfter;            ///< average cache-miss ratio after optimization
+    float atvrBefore;           ///< average transformed-vertex ratio (transformed
+                                ///  vertices per mesh vertex) before optimization
+    float atvrAfter;            ///< average transformed-vertex ratio after optimization
+};
+
+/// \brief compute the average cache-miss ratio (ACMR) of a mesh, which is the
+///        number of vertices transformed per triangle assuming a FIFO cache.
+/// \param nIndices   the number of indices (3 * number of triangles)
+/// \param indices    the index array
+/// \param nVerts     the number of vertices
+/// \param cacheSize  the size of the simulated vertex cache
+/// \return the ACMR, which ranges from 0.5 (for large regular meshes) to 3.0
+float acmr (
+    uint32_t nIndices,
+    const uint32_t *indices,
+    uint32_t nVerts,
+    uint32_t cacheSize = kVertexCacheSize);
+
+/// \brief reorder the triangles of a mesh to improve vertex-cache locality
+/// \param nIndices   the number of indices (3 * number of triangles)
+/// \param indices    the index array, which is reordered in place
+/// \param nVerts     the number of vertices
+/// \param cacheSize  the size of the vertex cache to optimize for
+/// \param clusters   if not null, then this vector is set to the index of the
+///                   first triangle of each cluster; clusters start at the points
+///                   where the reordering has to jump to a new part of the mesh,
+///                   which are the places where the triangles can be reordered
+///                   without disturbing the vertex cache (see `optimizeOverdraw`).
+void optimizeVertexCache (
+    uint32_t nIndices,
+    uint32_t *indices,
+    uint32_t nVerts,
+    uint32_t cacheSize = kVertexCacheSize,
+    std::vector<uint32_t> *clusters = nullptr);
+
+/// \brief reorder the clusters of a mesh to reduce overdraw.  The clusters are
+///        first split into smaller pieces as long as that does not increase the
+///        ACMR by more than the given threshold, and then sorted so that the
+///        clusters that face away from the center of the mesh (and thus are
+///        likely to occlude the rest of the mesh) are drawn first.
+/// \param nIndices   the number of indices (3 * number of triangles)
+/// \param indices    the index array, which is reordered in place
+/// \param verts      the vertex positions
+/// \param nVerts     the number of vertices
+/// \param clusters   the cluster starts produced by `optimizeVertexCache`
+/// \param threshold  the allowed growth in ACMR
+/// \param cacheSize  the size of the vertex cache
+void optimizeOverdraw (
+    uint32_t nIndices,
+    uint32_t *indices,
+    const glm::vec3 *verts,
+    uint32_t nVerts,
+    std::vector<uint32_t> const &clusters,
+    float threshold = kOverdrawThreshold,
+    uint32_t cacheSize = kVertexCacheSize);
+
+/// \brief renumber the vertices of a mesh in the order that they are first used
+///        by the index array, which makes vertex fetches mostly sequential.
+///        Vertices that are not referenced are moved to the end.
+/// \param nIndices   the number of indices (3 * number of triangles)
+/// \param indices    the index array, which is updated in place
+/// \param nVerts     the number of vertices
+/// \return the remapping vector, which maps old vertex indices to new ones;
+///         use `remapVertices` to apply it to the vertex attribute arrays
+std::vector<uint32_t> optimizeVertexFetch (
+    uint32_t nIndices,
+    uint32_t *indices,
+    uint32_t nVerts);
+
+/// \brief apply a vertex remapping to an attribute array
+/// \param remap  the mapping from old to new vertex indices
+/// \param data   the attribute array (may be null)
+template <typename T>
+void remapVertices (std::vector<uint32_t> const &remap, T *data)
+{
+    if (data == nullptr) {
+        return;
+    }
+    std::vector<T> tmp(data, data + remap.size());
+    for (uint32_t i = 0;  i < remap.size();  ++i) {
+        data[remap[i]] = tmp[i];
+    }
+}
+
+/// \brief optimize a mesh for rendering by running the vertex-cache, overdraw,
+///        and vertex-fetch passes.  The arrays are updated in place; the
+///        number of vertices and indices do not change.  If the reordered
+///        triangles do not have a lower ACMR than the original ones, then
+///        the original triangle order is kept.
+/// \param nVerts     the number of vertices
+/// \param nIndices   the number of indices (3 * number of triangles)
+/// \param verts      the vertex positions
+/// \param norms      the vertex normals (or nullptr)
+/// \param txtCoords  the vertex texture coordinates (or nullptr)
+/// \param indices    the index array
+/// \return the ACMR and ATVR of the mesh before and after optimization
+Stats optimize (
+    uint32_t nVerts,
+    uint32_t nIndices,
+    glm::vec3 *verts,
+    glm::vec3 *norms,
+    glm::vec2 *txtCoords,
+    uint32_t *indices);
+
+} // namespace mesh
+} // namespace cs237
+
+#endif // !_CS237_MESH_OPT_HPP_
@@ -0,0 +1,97 @@
+/*! \file mesh-simplify.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Simplification of indexed triangle meshes using quadric error metrics (see
+ * "Surface Simplification Using Quadric Error Metrics" by Garland and Heckbert,
+ * SIGGRAPH 1997) and the construction of chains of levels of detail (LODs).
+ *
+ * The simplifier only collapses edges onto existing vertices, so a simplified
+ * mesh is just a new index array over the original vertex arrays.  Thus all of
+ * the levels of detail of a mesh can share a single vertex buffer.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_MESH_SIMPLIFY_HPP_
+#define _CS237_MESH_SIMPLIFY_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237/mesh-simplify.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+namespace mesh {
+
+/// the default maximum number of simplified levels in a LOD chain
+constexpr uint32_t kMaxLODs = 6;
+
+/// we do not build levels of detail with fewer triangles than this
+constexpr uint32_t kMinLODTris = 64;
+
+/// a simplified level of detail of a mesh
+struct LOD {
+    uint32_t firstIndex;        ///< the offset of the level's triangles in the
+                                ///  LOD index array
+    uint32_t nIndices;          ///< the number of indices (3 * number of triangles)
+    float error;                ///< an estimate of the geometric error of the level
+                                ///  (i.e., its distance from the original surface)
+                                ///  in the units of the mesh's coordinates
+};
+
+/// \brief simplify a mesh by collapsing edges in order of increasing quadric
+///        error.  Vertices that have the same position are treated as a single
+///        vertex, but a vertex on an attribute seam can only be collapsed along
+///        the seam, which preserves texture coordinates and normals.  Borders and
+///        seams are also protected by extra quadric terms.
+/// \param nIndices     the number of indices (3 * number of triangles)
+/// \param indices      the index array
+/// \param verts        the vertex positions
+/// \param nVerts       the number of vertices
+/// \param targetIndices  the desired number of indices in the result
+/// \param maxError     simplification stops before a collapse whose error exceeds
+///                     this distance (in the units of the mesh's coordinates)
+/// \param[out] resultError  if not null, then set to the largest error of the
+///                     collapses that were performed
+/// \return the index array of the simplified mesh, which refers to the original
+///         vertices and may have more than `targetIndices` indices when the mesh
+///         cannot be simplified further without exceeding `maxError`
+std::vector<uint32_t> simplify (
+    uint32_t nIndices,
+    const uint32_t *indices,
+    const glm::vec3 *verts,
+    uint32_t nVerts,
+    uint32_t targetIndices,
+    float maxError = std::numeric_limits<float>::max(),
+    float *resultError = nullptr);
+
+/// \brief build a chain of levels of detail for a mesh.  Each level is produced
+///        by simplifying the previous one to about half as many triangles and
+///        then optimizing it for the vertex cache.  The chain stops when a level
+///        would have fewer than `kMinLODTris` triangles or when the mesh cannot be
+///        simplified much further.
+/// \param nIndices     the number of indices (3 * number of triangles)
+/// \param indices      the index array of the full-resolution mesh
+/// \param verts        the vertex positions
+/// \param nVerts       the number of vertices
+/// \param[out] lodIndices  the index arrays of the levels, one after the other
+/// \param maxLevels    the maximum number of levels to build
+/// \return the simplified levels, ordered from finest to coarsest (the
+///         full-resolution mesh is not included)
+std::vector<LOD> buildLODs (
+    uint32_t nIndices,
+    const uint32_t *indices,
+    const glm::vec3 *verts,
+    uint32_t nVerts,
+    std::vector<uint32_t> &lodIndices,
+    uint32_t maxLevels = kMaxLODs);
+
+} // namespace mesh
+} // namespace cs237
+
+#endif // !_CS237_MESH_SIMPLIFY_HPP_
@@ -0,0 +1,111 @@
+/*! \file meshlet.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Splitting of indexed triangle meshes into meshlets, which are small clusters
+ * of triangles with a bounded number of vertices.  Each meshlet has a bounding
+ * sphere and a normal cone, which can be used to cull meshlets that are outside
+ * the view frustum or that face away from the viewer.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_MESHLET_HPP_
+#define _CS237_MESHLET_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237/meshlet.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+namespace mesh {
+
+/// the default maximum number of vertices in a meshlet
+constexpr uint32_t kMaxMeshletVerts = 64;
+
+/// the default maximum number of triangles in a meshlet
+constexpr uint32_t kMaxMeshletTris = 124;
+
+/// a cluster of triangles in a mesh
+struct Meshlet {
+    uint32_t firstVert;         ///< index of the meshlet's first vertex in
+                                ///  `Meshlets::verts`
+    uint32_t firstTri;          ///< index of the meshlet's first triangle in
+                                ///  `Meshlets::tris` (the local indices of
+                                ///  triangle i are at tris[3*i .. 3*i+2])
+    uint32_t nVerts;            ///< the number of vertices in the meshlet
+    uint32_t nTris;             ///< the number of triangles in the meshlet
+    glm::vec3 center;           ///< the center of the meshlet's bounding sphere
+    float radius;               ///< the radius of the meshlet's bounding sphere
+    glm::vec3 coneAxis;         ///< the axis of the meshlet's normal cone
+    float coneCutoff;           ///< the sine of the normal cone's half angle (or
+                                ///  1 if the cone is too wide to be useful)
+
+    /// \brief is the meshlet completely back facing?  This test is conservative.
+    /// \param eye  the position of the viewer in the mesh's coordinate space
+    /// \return true if all of the meshlet's triangles face away from `eye`
+    bool isBackFacing (glm::vec3 eye) const
+    {
+        glm::vec3 dir = this->center - eye;
+        return glm::dot(dir, this->coneAxis)
+            >= this->coneCutoff * glm::length(dir) + this->radius;
+    }
+
+};
+
+/// the meshlets of a mesh
+struct Meshlets {
+    std::vector<Meshlet> meshlets;      ///< the meshlets
+    std::vector<uint32_t> verts;        ///< the mesh vertex indices of the meshlets'
+                                        ///  vertices
+    std::vector<uint8_t> tris;          ///< the meshlets' triangles, where each
+                                        ///  triangle is three indices into the
+                                        ///  meshlet's vertices
+
+    /// the number of meshlets
+    uint32_t size () const { return this->meshlets.size(); }
+
+    /// \brief get the mesh's triangles as an index array in meshlet order, where
+    ///        the indices of meshlet i start at `3 * meshlets[i].firstTri`.  Since
+    ///        every triangle belongs to exactly one meshlet, this array is a
+    ///        reordering of the mesh's original triangles.
+    std::vector<uint32_t> indices () const;
+
+    /// \brief write the mesh's triangles as an index array in meshlet order (see
+    ///        above) to `dst`, which must have room for `tris.size()` indices.
+    ///        This version is useful for writing the indices directly into a
+    ///        mapped index buffer.
+    void indices (uint32_t *dst) const;
+
+};
+
+/// \brief split a mesh into meshlets.  Meshlets are grown greedily from a seed
+///        triangle by adding the adjacent triangle that requires the fewest new
+///        vertices, until either the vertex or the triangle limit is reached.
+///        The seeds are taken in the order of the index array, so this function
+///        works best on meshes that have been optimized for the vertex cache
+///        (see `optimizeVertexCache`).
+/// \param nIndices  the number of indices (3 * number of triangles)
+/// \param indices   the index array
+/// \param verts     the vertex positions
+/// \param nVerts    the number of vertices
+/// \param maxVerts  the maximum number of vertices per meshlet (at most 256)
+/// \param maxTris   the maximum number of triangles per meshlet
+/// \return the meshlets of the mesh
+Meshlets buildMeshlets (
+    uint32_t nIndices,
+    const uint32_t *indices,
+    const glm::vec3 *verts,
+    uint32_t nVerts,
+    uint32_t maxVerts = kMaxMeshletVerts,
+    uint32_t maxTris = kMaxMeshletTris);
+
+} // namespace mesh
+} // namespace cs237
+
+#endif // !_CS237_MESHLET_HPP_
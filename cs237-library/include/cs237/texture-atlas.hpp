@@ -0,0 +1,143 @@
+/*! \file texture-atlas.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Texture atlases, which pack many small images into a few large images (the
+ * pages of the atlas), so that objects that use different images can share a
+ * texture (and thus a descriptor set).  Each image is surrounded by a gutter
+ * that replicates its edge pixels, and the images are aligned so that they do
+ * not bleed into each other in the first few mipmap levels of a page.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_TEXTURE_ATLAS_HPP_
+#define _CS237_TEXTURE_ATLAS_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237/texture-atlas.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+class JobSystem;
+
+//! A builder for texture atlases.  Images are added to the atlas and then the
+//! `build` method packs them into pages using a skyline bottom-left packer and
+//! copies them into the pages.  Texture coordinates in the range [0,1] for an
+//! image are mapped to the page using the image's `Entry::uvXform`; coordinates
+//! outside that range (i.e., images that are meant to repeat) are not supported.
+class TextureAtlas {
+  public:
+
+  //! options that control the layout of the atlas
+    struct Options {
+        uint32_t pageSize;      //!< the maximum width and height of a page
+        uint32_t gutter;        //!< the number of pixels around each image that are
+                                //!  filled by extending the image's edges
+        uint32_t nMipLevels;    //!< the number of mipmap levels of a page (including
+                                //!  the base level) in which the images are kept
+                                //!  separate; images are aligned to multiples of
+                                //!  2^(nMipLevels-1) pixels
+
+        Options () : pageSize(2048), gutter(4), nMipLevels(3) { }
+    };
+
+  //! the location of an image in the atlas
+    struct Entry {
+        uint32_t page;          //!< the page that holds the image
+        uint32_t x;             //!< the column of the image's first pixel in the page
+        uint32_t y;             //!< the row of the image's first pixel in the page
+        uint32_t wid;           //!< the width of the image
+        uint32_t ht;            //!< the height of the image
+        glm::vec4 uvXform;      //!< maps the image's texture coordinates to the
+                                //!  page's coordinates: uv * xy + zw
+
+      //! map a texture coordinate for the image to the page
+        glm::vec2 remap (glm::vec2 uv) const
+        {
+            return uv * glm::vec2(this->uvXform.x, this->uvXform.y)
+                + glm::vec2(this->uvXform.z, this->uvXform.w);
+        }
+    };
+
+  //! create an empty atlas
+  //! \param chans the channels of the atlas pages
+  //! \param ty the channel type of the atlas pages
+  //! \param sRGB are the atlas pages sRGB encoded?
+  //! \param opts the layout options
+    TextureAtlas (Channels chans, ChannelTy ty, bool sRGB, Options const &opts = Options());
+
+    TextureAtlas (TextureAtlas const &) = delete;
+    TextureAtlas &operator= (TextureAtlas const &) = delete;
+
+    ~TextureAtlas ();
+
+  //! add an image to the atlas.  The image is not copied until `build` is called,
+  //! so it must not be deleted before then.  Images that have a different format
+  //! than the atlas are converted (see `Image2D::convert`).
+  //! \param img the image to add
+  //! \return the ID of the image in the atlas, or -1 if the image (with its gutter)
+  //!         does not fit on a page
+    int add (Image2D const *img);
+
+  //! pack the images into pages and copy them into place
+  //! \param jobs if non-null, the images are copied in parallel using the job system
+    void build (JobSystem *jobs = nullptr);
+
+  //! has the atlas been built?
+    bool isBuilt () const { return this->_built; }
+
+  //! the number of images that have been added to the atlas
+    uint32_t numImages () const { return this->_imgs.size(); }
+
+  //! the location of an image in the atlas (the atlas must have been built)
+  //! \param id the ID returned by `add`
+    Entry const &entry (int id) const;
+
+  //! the number of pages in the atlas (zero until the atlas is built)
+    uint32_t numPages () const { return this->_pages.size(); }
+
+  //! get a page of the atlas; the page is owned by the atlas
+    Image2D const *page (uint32_t i) const { return this->_pages[i]; }
+
+  //! the number of mipmap levels of a page (including the base level) in which
+  //! the images do not bleed into each other
+  //! \param i the page
+    uint32_t numMipLevels (uint32_t i) const;
+
+  //! the fraction of the area of the pages that is covered by images (not
+  //! including their gutters)
+    double occupancy () const;
+
+  private:
+    Channels _chans;                    //!< the channels of the pages
+    ChannelTy _type;                    //!< the channel type of the pages
+    bool _sRGB;                         //!< are the pages sRGB encoded?
+    Options _opts;                      //!< the layout options
+    uint32_t _align;                    //!< the alignment of the images' cells
+    bool _built;                        //!< has `build` been called?
+    std::vector<Image2D const *> _imgs; //!< the images in the order that they were added
+    std::vector<Entry> _entries;        //!< the locations of the images
+    std::vector<Image2D *> _pages;      //!< the pages
+
+  //! the size of an image's cell (the image plus its gutter rounded up to the
+  //! alignment) along one axis
+    uint32_t _cellSize (uint32_t sz) const
+    {
+        return (sz + 2 * this->_opts.gutter + this->_align - 1) & ~(this->_align - 1);
+    }
+
+  //! copy an image with its gutter into its page
+    void _copyImage (int id);
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_TEXTURE_ATLAS_HPP_
@@ -38,12 +38,24 @@ protected:
     uint32_t _wid;              ///< texture width
     uint32_t _ht;               ///< teture height (1 for 1D textures)
     uint32_t _nMipLevels;       ///< number of mipmap levels
+    uint32_t _nLayers;          ///< number of array layers (1 except for array and
+                                ///  cube-map textures)
     vk::Format _fmt;            ///< the texel format
+    bool _hostCopy;             ///< is the texture's data copied directly from host
+                                ///  memory (instead of using a staging buffer)?
 
     TextureBase (
         Application *app,
         uint32_t wid, uint32_t ht, uint32_t mipLvls,
-        cs237::__detail::ImageBase const *img);
+        cs237::__detail::ImageBase const *img)
+      : TextureBase (app, wid, ht, mipLvls, img->format())
+    { }
+    TextureBase (
+        Application *app,
+        uint32_t wid, uint32_t ht, uint32_t mipLvls,
+        vk::Format fmt,
+        uint32_t nLayers = 1,
+        vk::ImageViewType viewType = vk::ImageViewType::e2D);
     ~TextureBase ();
 
     /// \brief create a vk::Buffer object
@@ -64,10 +76,32 @@ protected:
         return this->_app->_allocBufferMemory (buf, props);
     }
 
-    /// \brief initialize a texture by copying data into it using a staging buffer.
+    /// \brief initialize a texture by copying data into it using a staging buffer
+    ///        (or directly from the image when host image copies are supported).
     /// \param img  the source of the data
     void _init (cs237::__detail::ImageBase const *img);
 
+    /// \brief upload the data for the first `nLevels` mipmap levels of each layer
+    ///        using a single staging buffer and command buffer.
+    /// \param levels   the data for each level, which must be in the texture's
+    ///                 format; the levels of layer 0 come first, followed by the
+    ///                 levels of layer 1, etc.
+    /// \param sizes    the size in bytes of each level's data
+    /// \param nLevels  the number of levels per layer; if this number is less
+    ///                 than the number of mipmap levels, then the uploaded levels
+    ///                 are left in the eTransferDstOptimal layout (see `_blitMipMaps`);
+    ///                 otherwise the levels are copied directly from host memory
+    ///                 when host image copies are supported
+    void _uploadLevels (
+        std::vector<const void *> const &levels,
+        std::vector<size_t> const &sizes,
+        uint32_t nLevels);
+
+    /// \brief generate the mipmap levels of each layer from its base level using
+    ///        linear-filtered blits; the base levels must be in the
+    ///        eTransferDstOptimal layout
+    void _blitMipMaps ();
+
 };
 
 } // namespace __detail
@@ -91,13 +125,119 @@ public:
     /// \param app     the owning application
     /// \param img     the source image for the texture
     /// \param mipmap  if true, generate mipmap levels for the texture.
+    ///
+    /// The image does not have to have power-of-two dimensions.  The mipmap levels
+    /// are generated on the device using linear-filtered blits when the format
+    /// supports them; otherwise, they are generated using a compute shader (if
+    /// the format can be used as a storage image) or on the CPU.
     Texture2D (Application *app, Image2D const *img, bool mipmap = false);
 
+    /// \brief Construct a 2D texture from an image and a pre-built chain of mipmap
+    ///        levels, which are uploaded using a single staging buffer and
+    ///        command buffer.
+    /// \param app     the owning application
+    /// \param img     the source image for the base level of the texture
+    /// \param mips    the images for the remaining mipmap levels; level i+1 must be
+    ///                half the size of level i (rounded down, but at least 1) and
+    ///                all of the levels must have the same format as `img`.
+    Texture2D (
+        Application *app,
+        Image2D const *img,
+        std::vector<Image2D const *> const &mips);
+
+    /// \brief Construct a 2D texture from a block-compressed image and its mipmap
+    ///        levels.  If the device does not support the image's block format,
+    ///        then the levels are decoded and the texture is uncompressed.
+    /// \param app     the owning application
+    /// \param img     the source image for the texture
+    Texture2D (Application *app, CompressedImage2D const *img);
+
 private:
     /// helper function for generating the mipmap levels; the number of levels
     /// is determined by the size of the image.
     void _generateMipMaps (cs237::Image2D const *img);
 
+    /// helper function for copying the base level into the texture; the level is
+    /// left in the eTransferDstOptimal layout
+    void _uploadBaseLevel (cs237::Image2D const *img);
+
+    /// helper function for generating the mipmap levels from the base level using a
+    /// compute shader
+    /// \param img  the base-level image, which determines the variant of the shader
+    void _computeMipMaps (cs237::Image2D const *img);
+
+    /// helper function for uploading a pre-built mipmap chain
+    void _initMipChain (cs237::Image2D const *img, std::vector<Image2D const *> const &mips);
+
+};
+
+// 2D Array Textures
+//
+// An array texture holds a number of images of the same size and format (the
+// layers), which are selected by a layer index in the shader (i.e., a
+// `sampler2DArray`).  Materials whose maps have the same size and format can
+// share an array texture, and thus a descriptor, by passing the layer index
+// in a uniform or push constant.
+class Texture2DArray : public __detail::TextureBase {
+public:
+
+    /// \brief Construct a 2D array texture from a vector of images
+    /// \param app     the owning application
+    /// \param layers  the images for the layers, which must all have the same size
+    ///                and format
+    /// \param mipmap  if true, generate mipmap levels for each layer.
+    ///
+    /// The mipmap levels of all of the layers are generated on the device using
+    /// linear-filtered blits when the format supports them; otherwise, they are
+    /// generated on the CPU.
+    Texture2DArray (
+        Application *app,
+        std::vector<Image2D const *> const &layers,
+        bool mipmap = false);
+
+    /// \brief Construct a 2D array texture from pre-built chains of mipmap levels,
+    ///        which are uploaded using a single staging buffer and command buffer.
+    /// \param app     the owning application
+    /// \param levels  `levels[i]` is the chain of levels for layer i, starting with
+    ///                its base level.  The chains must have the same length, level
+    ///                j+1 must be half the size of level j (rounded down, but at
+    ///                least 1), and all of the levels must have the same format.
+    Texture2DArray (
+        Application *app,
+        std::vector<std::vector<Image2D const *>> const &levels);
+
+    /// return the number of layers in the texture
+    uint32_t nLayers () const { return this->_nLayers; }
+
+protected:
+
+    /// \brief Construct a layered texture with the given view type (used for cube maps)
+    Texture2DArray (
+        Application *app,
+        std::vector<Image2D const *> const &layers,
+        bool mipmap,
+        vk::ImageViewType viewType);
+
+private:
+    /// helper function for uploading the layers and generating their mipmap levels
+    void _initLayers (std::vector<Image2D const *> const &layers, bool mipmap);
+
+};
+
+// Cube-map Textures
+class TextureCube : public Texture2DArray {
+public:
+
+    /// \brief Construct a cube-map texture from the images for its six faces
+    /// \param app     the owning application
+    /// \param faces   the images for the +X, -X, +Y, -Y, +Z, and -Z faces (in that
+    ///                order), which must be square and have the same size and format
+    /// \param mipmap  if true, generate mipmap levels for each face
+    TextureCube (
+        Application *app,
+        std::array<Image2D const *, 6> const &faces,
+        bool mipmap = false);
+
 };
 
 } // namespace cs237
@@ -0,0 +1,345 @@
+/*! \file virtual-texture.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.  Virtual textures, which allow
+ * very large images (e.g., the color maps of height fields) to be used as
+ * textures without keeping the whole image in device memory.
+ *
+ * A virtual texture is split into square tiles at each of its mipmap levels.
+ * The tiles are stored in a page file on disk, and only the tiles that are
+ * needed to render the current view are kept in a fixed-size cache texture
+ * on the device.  A page table (one texel per tile at each level) maps the
+ * tiles to their location in the cache; tiles that are not resident map to
+ * the location of their nearest resident ancestor.  The fragment shader
+ * records the tiles that it wants in a feedback buffer, which is read back
+ * by the host each frame to request missing tiles from a background
+ * streaming thread.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_VIRTUAL_TEXTURE_HPP_
+#define _CS237_VIRTUAL_TEXTURE_HPP_
+
+#ifndef _CS237_HPP_
+#  error "cs237/virtual-texture.hpp should not be included directly"
+#endif
+
+#include <thread>
+
+namespace cs237 {
+
+class JobSystem;
+
+/// A page file holds the tiles of a virtual texture.  The file starts with a
+/// header that describes the texture, which is followed by the tiles of each
+/// mipmap level (finest level first) in row-major order.  Each tile is stored
+/// with a border of texels copied from its neighbors (or clamped at the edges
+/// of the level) so that bilinear filtering in the cache does not bleed
+/// between tiles.  The texels are always RGBA8.  The file is memory mapped,
+/// so tiles are read on demand by the operating system.
+class VTPageFile {
+public:
+
+    /// the default number of texels along the side of a tile (not including
+    /// the border)
+    static constexpr uint32_t kTileSize = 128;
+
+    /// the default width of the border around each tile
+    static constexpr uint32_t kBorder = 4;
+
+    /// \brief build a page file from an image
+    /// \param img       the source image; images that are not RGBA8 are converted
+    /// \param file      the path of the page file
+    /// \param tileSize  the number of texels along the side of a tile
+    /// \param border    the width of the border around each tile
+    /// \param jobs      if non-null, the mipmap levels and tiles are computed in
+    ///                  parallel using the job system
+    /// \return true if the file was written and false on error
+    static bool build (
+        Image2D const *img,
+        std::string const &file,
+        uint32_t tileSize = kTileSize,
+        uint32_t border = kBorder,
+        JobSystem *jobs = nullptr);
+
+    /// \brief open a page file
+    /// \param file  the path of the page file
+    ///
+    /// If the file cannot be opened or is not a valid page file, then the
+    /// resulting object is invalid (see `isValid`).
+    explicit VTPageFile (std::string const &file);
+
+    VTPageFile (VTPageFile const &) = delete;
+    VTPageFile &operator= (VTPageFile const &) = delete;
+
+    ~VTPageFile ();
+
+    /// was the file successfully opened?
+    bool isValid () const { return this->_tiles != nullptr; }
+
+    /// the width of the base level of the texture
+    uint32_t width () const { return this->_wid; }
+
+    /// the height of the base level of the texture
+    uint32_t height () const { return this->_ht; }
+
+    /// the number of texels along the side of a tile (not including the border)
+    uint32_t tileSize () const { return this->_tileSize; }
+
+    /// the width of the border around each tile
+    uint32_t border () const { return this->_border; }
+
+    /// the number of texels along the side of a tile, including its border
+    uint32_t paddedTileSize () const { return this->_tileSize + 2*this->_border; }
+
+    /// the size in bytes of a tile's data
+    size_t tileBytes () const
+    {
+        return 4 * size_t(this->paddedTileSize()) * size_t(this->paddedTileSize());
+    }
+
+    /// the number of mipmap levels; the last level fits in a single tile
+    uint32_t numLevels () const { return this->_nLevels; }
+
+    /// the Vulkan format of the texels
+    vk::Format format () const { return this->_fmt; }
+
+    /// the total number of tiles in all of the levels
+    uint32_t numTiles () const { return this->_levelStart.back(); }
+
+    /// the number of tiles in each row of a level
+    uint32_t tilesWide (uint32_t lvl) const { return this->_tilesWide[lvl]; }
+
+    /// the number of rows of tiles in a level
+    uint32_t tilesHigh (uint32_t lvl) const { return this->_tilesHigh[lvl]; }
+
+    /// the index of the first tile of a level; the tiles of each level are
+    /// numbered in row-major order
+    uint32_t levelStart (uint32_t lvl) const { return this->_levelStart[lvl]; }
+
+    /// the index of the tile at position (`x`, `y`) in level `lvl`
+    uint32_t tileId (uint32_t lvl, uint32_t x, uint32_t y) const
+    {
+        return this->_levelStart[lvl] + y * this->_tilesWide[lvl] + x;
+    }
+
+    /// the data for a tile
+    const uint8_t *tileData (uint32_t id) const
+    {
+        assert (id < this->numTiles());
+        return this->_tiles + size_t(id) * this->tileBytes();
+    }
+
+private:
+    MappedFile *_file;                  ///< the mapped file
+    const uint8_t *_tiles;              ///< the start of the tile data in the file
+                                        ///  (nullptr if the file is invalid)
+    uint32_t _wid;                      ///< the width of the base level
+    uint32_t _ht;                       ///< the height of the base level
+    uint32_t _tileSize;                 ///< the tile size (not including borders)
+    uint32_t _border;                   ///< the width of the tile borders
+    uint32_t _nLevels;                  ///< the number of mipmap levels
+    vk::Format _fmt;                    ///< the texel format
+    std::vector<uint32_t> _tilesWide;   ///< the width of each level in tiles
+    std::vector<uint32_t> _tilesHigh;   ///< the height of each level in tiles
+    std::vector<uint32_t> _levelStart;  ///< the index of the first tile of each
+                                        ///  level, plus the total number of tiles
+
+};
+
+/// A virtual texture streams the tiles of a page file into a cache texture.
+/// A shader that renders with a virtual texture is given the following
+/// descriptors for the current frame:
+///
+///   - a uniform buffer with the texture's parameters (`uboInfo`), whose
+///     layout is given by the `UB` struct below
+///   - the page table (`pageTableInfo`), which is an `RGBA8UI` texture with
+///     one mipmap level per level of the virtual texture.  The entry for a
+///     tile holds the (x, y) position of a tile in the cache (in tiles) and
+///     the level of that tile, which is coarser than the requested level
+///     when the requested tile is not resident.
+///   - the cache texture (`cacheInfo`)
+///   - the feedback buffer (`feedbackInfo`), which is a storage buffer with
+///     one word per tile (numbered as in the page file) that the shader sets
+///     to a non-zero value when it needs the tile.  To limit the number of
+///     stores, only the pixels whose position (mod 4) matches the `jitter`
+///     parameter need to write feedback.
+///
+/// The page table, cache, and per-frame resources are updated by the `update`
+/// method, which must be called once per frame before the render pass that
+/// uses the texture.
+class VirtualTexture {
+public:
+
+    /// \brief create a virtual texture
+    /// \param app         the owning application
+    /// \param pages       the page file that holds the tiles, which must outlive
+    ///                    the virtual texture
+    /// \param cacheTiles  the number of tiles along the side of the square cache
+    ///                    texture; the cache size bounds the amount of device memory
+    ///                    used by the texture independent of the size of the image
+    ///
+    /// The device must support stores to storage buffers from fragment shaders
+    /// (the `fragmentStoresAndAtomics` feature).
+    VirtualTexture (Application *app, VTPageFile const *pages, uint32_t cacheTiles);
+
+    VirtualTexture (VirtualTexture const &) = delete;
+    VirtualTexture &operator= (VirtualTexture const &) = delete;
+
+    /// destructor; stops the streaming thread and frees the Vulkan resources
+    ~VirtualTexture ();
+
+    /// \brief return a suitable number of cache tiles for a screen of the given size
+    /// \param pages  the page file for the texture
+    /// \param wid    the width of the screen in pixels
+    /// \param ht     the height of the screen in pixels
+    ///
+    /// Each pixel needs at most one tile at one or two levels, so a cache that
+    /// covers about four times the screen area is usually sufficient.
+    static uint32_t cacheSizeFor (VTPageFile const *pages, uint32_t wid, uint32_t ht);
+
+    /// \brief update the texture for a frame.
+    /// \param cmdBuf    the command buffer for the frame; the copies to the cache
+    ///                  and page table are recorded into it
+    /// \param frameIdx  the index of the frame (`0..kMaxFrames-1`), whose previous
+    ///                  use must have completed
+    ///
+    /// This method reads the feedback from the last use of the frame's resources,
+    /// requests any tiles that are not resident, and uploads the tiles that have
+    /// been loaded since the last update (evicting the least-recently used tiles
+    /// from the cache when necessary).
+    void update (vk::CommandBuffer cmdBuf, uint32_t frameIdx);
+
+    /// \brief make the feedback of a frame visible to the host.
+    /// \param cmdBuf    the command buffer for the frame
+    /// \param frameIdx  the index of the frame (`0..kMaxFrames-1`)
+    ///
+    /// This method must be recorded after the last draw that samples the texture
+    /// (i.e., after the render pass), since the fragment shader's writes to the
+    /// feedback buffer are not visible to the host (when `update` reads them)
+    /// without a memory dependency, even once the frame's fence has signaled.
+    void feedbackBarrier (vk::CommandBuffer cmdBuf, uint32_t frameIdx) const;
+
+    /// the descriptor info for the parameter buffer of a frame
+    vk::DescriptorBufferInfo uboInfo (uint32_t frameIdx) const;
+
+    /// the descriptor info for the feedback buffer of a frame
+    vk::DescriptorBufferInfo feedbackInfo (uint32_t frameIdx) const;
+
+    /// the descriptor info for the page table
+    vk::DescriptorImageInfo pageTableInfo () const
+    {
+        return vk::DescriptorImageInfo(
+            this->_ptSampler, this->_ptView, vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+
+    /// the descriptor info for the cache texture
+    vk::DescriptorImageInfo cacheInfo () const
+    {
+        return vk::DescriptorImageInfo(
+            this->_cacheSampler, this->_cacheView, vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+
+    /// the number of tiles that are currently resident in the cache
+    uint32_t numResident () const { return this->_nResident; }
+
+private:
+    /// the layout of the parameter buffer
+    struct UB {
+        alignas(8) glm::vec2 size;      ///< the size of the base level in texels
+        alignas(8) glm::vec2 cacheScale; ///< 1 / the size of the cache in texels
+        uint32_t tileSize;              ///< tile size (not including the border)
+        uint32_t border;                ///< the tile border
+        uint32_t nLevels;               ///< the number of levels
+        uint32_t jitter;                ///< selects the pixels that write feedback
+        alignas(16) glm::uvec4 levelStart[4]; ///< the index of the first tile of
+                                        ///  each level (packed four per vector)
+    };
+
+    /// the maximum number of levels supported by the parameter buffer
+    static constexpr uint32_t kMaxLevels = 16;
+
+    /// a tile that has been read by the streaming thread
+    struct LoadedTile {
+        uint32_t id;                    ///< the tile
+        uint8_t *data;                  ///< the tile's data (allocated by `new[]`)
+    };
+
+    /// the per-frame resources
+    struct FrameData {
+        UniformBuffer<UB> *ubo;         ///< the parameter buffer
+        StorageBuffer<uint32_t> *feedback; ///< the feedback buffer
+        vk::Buffer staging;             ///< staging buffer for tile and page-table
+                                        ///  uploads
+        vk::DeviceMemory stagingMem;    ///< memory for the staging buffer
+        uint8_t *stagingPtr;            ///< the mapped staging memory
+    };
+
+    static constexpr int32_t kNone = -1;
+
+    Application *_app;                  ///< the owning application
+    VTPageFile const *_pages;           ///< the source of the tiles
+    uint32_t _cacheTiles;               ///< the size of the cache in tiles (per side)
+    uint32_t _maxUploads;               ///< the maximum number of tiles uploaded
+                                        ///  per frame
+    vk::Image _cacheImg;                ///< the cache texture
+    vk::DeviceMemory _cacheMem;
+    vk::ImageView _cacheView;
+    vk::Sampler _cacheSampler;
+    vk::Image _ptImg;                   ///< the page table
+    vk::DeviceMemory _ptMem;
+    vk::ImageView _ptView;
+    vk::Sampler _ptSampler;
+    std::array<FrameData, kMaxFrames> _frames;
+    UB _params;                         ///< the texture's parameters (the jitter
+                                        ///  is set by `update`)
+    uint64_t _frameNum;                 ///< counts calls to `update`
+
+    // cache state (only accessed by the rendering thread)
+    std::vector<int32_t> _slotOf;       ///< the cache slot for each tile (or kNone)
+    std::vector<int32_t> _tileIn;       ///< the tile in each cache slot (or kNone)
+    std::vector<uint64_t> _lastUsed;    ///< the frame when each slot was last used
+    std::vector<bool> _pending;         ///< has a tile been requested, but not
+                                        ///  uploaded?
+    uint32_t _nPending;                 ///< the number of pending requests
+    uint32_t _nResident;                ///< the number of resident tiles
+    std::vector<uint32_t> _table;       ///< the page-table entries for all levels
+
+    // the streaming thread and its queues
+    BoundedQueue<uint32_t> _requests;   ///< tiles to load
+    BoundedQueue<LoadedTile> _loaded;   ///< tiles that have been loaded
+    std::thread _streamer;
+
+    /// the main loop of the streaming thread
+    void _stream ();
+
+    /// find a free cache slot (evicting the least-recently used tile that was
+    /// not used in the current frame if necessary)
+    /// \return the slot or kNone if every slot is in use
+    int32_t _allocSlot ();
+
+    /// rebuild the page-table entries from the coarsest level to the finest
+    void _buildPageTable ();
+
+    /// record the copies of the staged tiles and page table into the textures
+    /// \param cmdBuf     the command buffer
+    /// \param staging    the staging buffer, which holds `slots.size()` tiles
+    ///                   followed by the page table
+    /// \param slots      the cache slots for the staged tiles
+    /// \param oldLayout  the layout of the textures before the copies
+    void _recordCopies (
+        vk::CommandBuffer cmdBuf,
+        vk::Buffer staging,
+        std::vector<int32_t> const &slots,
+        vk::ImageLayout oldLayout);
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_VIRTUAL_TEXTURE_HPP_
@@ -21,8 +21,18 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <map>
+#include <optional>
+#include <initializer_list>
+#include <type_traits>
+#include <limits>
 #include <cstdint>
+#include <cassert>
+
+namespace cs237 {
+    class MappedFile;
+}
 
 namespace json {
 
@@ -46,8 +56,15 @@ namespace json {
     class String;
     class Bool;
     class Null;
-
-  // parse a JSON file; this returns nullptr if there is a parsing error
+    class Node;
+    struct Member;
+    class Document;
+    class Reader;
+
+  // parse a JSON file; this returns nullptr if there is a parsing error.  The
+  // result is a tree of individually allocated values, which is freed by deleting
+  // the root.  This function is a compatibility layer on top of `Document`, which
+  // should be used in new code.
     Value *parseFile (std::string filename);
 
   // virtual base class of JSON values
@@ -134,11 +151,11 @@ namespace json {
 
       //! return the value corresponding to the given key.
       //! \returns nil if the key is not defined in the object
-        Value *operator[] (std::string key) const;
+        Value *operator[] (std::string_view key) const;
 
       //! return an object-valued field
       //! \returns nullptr if the field is not present or is not an object
-        const Object *fieldAsObject (std::string key) const
+        const Object *fieldAsObject (std::string_view key) const
         {
             const Value *v = (*this)[key];
             return (v != nullptr) ? v->asObject() : nullptr;
@@ -146,7 +163,7 @@ namespace json {
 
       //! return an array-valued field
       //! \returns nullptr if the field is not present or is not an array
-        const Array *fieldAsArray (std::string key) const
+        const Array *fieldAsArray (std::string_view key) const
         {
             const Value *v = (*this)[key];
             return (v != nullptr) ? v->asArray() : nullptr;
@@ -154,7 +171,7 @@ namespace json {
 
       //! return a number-valued field
       //! \returns nullptr if the field is not present or is not a number
-        const Number *fieldAsNumber (std::string key) const
+        const Number *fieldAsNumber (std::string_view key) const
         {
             const Value *v = (*this)[key];
             return (v != nullptr) ? v->asNumber() : nullptr;
@@ -162,7 +179,7 @@ namespace json {
 
       //! return an integer-valued field
       //! \returns nullptr if the field is not present or is not an integer
-        const Integer *fieldAsInteger (std::string key) const
+        const Integer *fieldAsInteger (std::string_view key) const
         {
             const Value *v = (*this)[key];
             return (v != nullptr) ? v->asInteger() : nullptr;
@@ -170,7 +187,7 @@ namespace json {
 
       //! return an real-valued field
       //! \returns nullptr if the field is not present or is not a real
-        const Real *fieldAsReal (std::string key) const
+        const Real *fieldAsReal (std::string_view key) const
         {
             const Value *v = (*this)[key];
             return (v != nullptr) ? v->asReal() : nullptr;
@@ -178,7 +195,7 @@ namespace json {
 
       //! return an string-valued field
       //! \returns nullptr if the field is not present or is not a string
-        const String *fieldAsString (std::string key) const
+        const String *fieldAsString (std::string_view key) const
         {
             const Value *v = (*this)[key];
             return (v != nullptr) ? v->asString() : nullptr;
@@ -186,7 +203,7 @@ namespace json {
 
       //! return an bool-valued field
       //! \returns nullptr if the field is not present or is not a bool
-        const Bool *fieldAsBool (std::string key) const
+        const Bool *fieldAsBool (std::string_view key) const
         {
             const Value *v = (*this)[key];
             return (v != nullptr) ? v->asBool() : nullptr;
@@ -195,7 +212,7 @@ namespace json {
         std::string toString();
 
       private:
-        std::map<std::string, Value *> _value;
+        std::map<std::string, Value *, std::less<>> _value;
     };
 
   //! JSON arrays
@@ -290,6 +307,563 @@ namespace json {
 
     };
 
+/***** Arena-allocated JSON documents *****/
+
+  //! A JSON value in a `Document`.  Nodes are small tagged values that live in
+  //! the document's arena; the members of an object and the elements of an array
+  //! are stored in flat arrays, and strings (including object keys) are views
+  //! into the document's copy of the input text.  Thus none of the accessors
+  //! allocate memory.  Nodes are only valid for the lifetime of their document.
+    class Node {
+      public:
+
+      //! return the type of this JSON value
+        Type type() const { return this->_ty; }
+
+        bool isObject() const { return (this->_ty == T_OBJECT); }
+        bool isArray() const { return (this->_ty == T_ARRAY); }
+        bool isNumber() const { return (this->_ty == T_REAL) || (this->_ty == T_INTEGER); }
+        bool isInteger() const { return (this->_ty == T_INTEGER); }
+        bool isReal() const { return (this->_ty == T_REAL); }
+        bool isString() const { return (this->_ty == T_STRING); }
+        bool isBool() const { return (this->_ty == T_BOOL); }
+        bool isNull() const { return (this->_ty == T_NULL); }
+
+      //! the value of an integer node
+        int64_t intVal () const
+        {
+            assert (this->isInteger());
+            return this->_u.i;
+        }
+
+      //! the value of a number node as a double
+        double realVal () const
+        {
+            assert (this->isNumber());
+            return this->isInteger() ? static_cast<double>(this->_u.i) : this->_u.r;
+        }
+
+      //! the value of a string node
+        std::string_view strVal () const
+        {
+            assert (this->isString());
+            return std::string_view(this->_u.s, this->_n);
+        }
+
+      //! the value of a boolean node
+        bool boolVal () const
+        {
+            assert (this->isBool());
+            return this->_u.b;
+        }
+
+      //! the number of members of an object node or elements of an array node
+        uint32_t size () const
+        {
+            assert (this->isObject() || this->isArray());
+            return this->_n;
+        }
+
+      //! the members of an object node in order of increasing key
+        const Member *begin () const;
+        const Member *end () const;
+
+      //! the i'th element of an array node
+        const Node &operator[] (uint32_t i) const
+        {
+            assert (this->isArray() && (i < this->_n));
+            return this->_u.elems[i];
+        }
+
+      //! return the value of an object's field
+      //! \returns nullptr if this node is not an object or the field is not present
+        const Node *field (std::string_view key) const;
+
+      //! return an object-valued field
+      //! \returns nullptr if the field is not present or is not an object
+        const Node *fieldAsObject (std::string_view key) const
+        {
+            return this->_fieldOfType (key, T_OBJECT);
+        }
+
+      //! return an array-valued field
+      //! \returns nullptr if the field is not present or is not an array
+        const Node *fieldAsArray (std::string_view key) const
+        {
+            return this->_fieldOfType (key, T_ARRAY);
+        }
+
+      //! return a number-valued field
+      //! \returns nullptr if the field is not present or is not a number
+        const Node *fieldAsNumber (std::string_view key) const
+        {
+            const Node *v = this->field(key);
+            return ((v != nullptr) && v->isNumber()) ? v : nullptr;
+        }
+
+      //! return an integer-valued field
+      //! \returns nullptr if the field is not present or is not an integer
+        const Node *fieldAsInteger (std::string_view key) const
+        {
+            return this->_fieldOfType (key, T_INTEGER);
+        }
+
+      //! return a string-valued field
+      //! \returns nullptr if the field is not present or is not a string
+        const Node *fieldAsString (std::string_view key) const
+        {
+            return this->_fieldOfType (key, T_STRING);
+        }
+
+      //! return a bool-valued field
+      //! \returns nullptr if the field is not present or is not a bool
+        const Node *fieldAsBool (std::string_view key) const
+        {
+            return this->_fieldOfType (key, T_BOOL);
+        }
+
+      private:
+        friend class Parser;
+
+        const Node *_fieldOfType (std::string_view key, Type ty) const
+        {
+            const Node *v = this->field(key);
+            return ((v != nullptr) && (v->_ty == ty)) ? v : nullptr;
+        }
+
+        Type _ty;
+        uint32_t _n;            //!< string length, or number of members/elements
+        union {
+            int64_t i;
+            double r;
+            bool b;
+            const char *s;
+            const Member *members;
+            const Node *elems;
+        } _u;
+    };
+
+  //! a member of a JSON object
+    struct Member {
+        std::string_view key;   //!< the member's key (a view into the document's text)
+        Node value;             //!< the member's value
+    };
+
+    inline const Member *Node::begin () const
+    {
+        assert (this->isObject());
+        return this->_u.members;
+    }
+
+    inline const Member *Node::end () const
+    {
+        assert (this->isObject());
+        return this->_u.members + this->_n;
+    }
+
+  //! A parsed JSON file.  The document owns the (memory-mapped) text of the file
+  //! and a single arena that holds all of its nodes and decoded strings, so the
+  //! whole tree is freed at once when the document is destroyed.
+    class Document {
+      public:
+
+      //! parse a JSON file
+      //! \param filename  the file to parse
+        explicit Document (std::string const &filename);
+
+        Document (Document const &) = delete;
+        Document &operator= (Document const &) = delete;
+
+        ~Document ();
+
+      //! return the root of the document
+      //! \returns nullptr if there was an error reading or parsing the file
+        const Node *root () const { return this->_ok ? &this->_root : nullptr; }
+
+      private:
+        friend class Parser;
+
+      //! allocate `n` bytes (which must be a multiple of 8) from the arena
+        void *_alloc (size_t n);
+
+        cs237::MappedFile *_file;       //!< the JSON file; strings without escapes
+                                        //!  are views into its contents
+        std::vector<char *> _chunks;    //!< the arena's chunks
+        char *_next;                    //!< the next free byte in the current chunk
+        size_t _avail;                  //!< the number of free bytes in the current chunk
+        Node _root;                     //!< the root of the document
+        bool _ok;                       //!< true if the document was parsed successfully
+    };
+
+/***** Streaming JSON input *****/
+
+  //! the events produced by a `Reader`
+    enum Event {
+        E_BEGIN_OBJECT,         //!< the start of an object
+        E_END_OBJECT,           //!< the end of an object
+        E_BEGIN_ARRAY,          //!< the start of an array
+        E_END_ARRAY,            //!< the end of an array
+        E_KEY,                  //!< the key of an object member
+        E_INTEGER,              //!< an integer value
+        E_REAL,                 //!< a real-number value
+        E_STRING,               //!< a string value
+        E_BOOL,                 //!< a boolean value
+        E_NULL,                 //!< the null value
+        E_EOF,                  //!< the end of the input
+        E_ERROR                 //!< a syntax or binding error (already reported)
+    };
+
+    class Field;
+
+  //! \brief A pull parser for JSON.  The reader produces a stream of events
+  //!        (see `Event`) without building a tree.  The input file is mapped
+  //!        into memory, strings without escape sequences are returned as views
+  //!        of the input, and numbers are converted without a round trip through
+  //!        the C library in the common case.
+  //!
+  //! The reader is always positioned at an event; the constructor reads the first
+  //! event of the input.  The value-reading functions below (`readObject`,
+  //! `readArray`, and the `Binder` specializations) expect the reader to be
+  //! positioned at the first event of a value, and they leave it positioned at
+  //! the last event of the value.
+    class Reader {
+      public:
+
+      //! create a reader for a JSON file
+      //! \param filename  the file to read
+        explicit Reader (std::string const &filename);
+
+      //! create a reader for JSON text in memory
+      //! \param data  the text; it must remain valid for the lifetime of the reader
+      //! \param len   the length of the text in bytes
+      //! \param name  the name of the input for error messages
+        Reader (const char *data, size_t len, std::string const &name);
+
+        Reader (Reader const &) = delete;
+        Reader &operator= (Reader const &) = delete;
+
+        ~Reader ();
+
+      //! advance to the next event
+        Event next ();
+
+      //! the current event
+        Event event () const { return this->_ev; }
+
+      //! has there been an error?
+        bool failed () const { return this->_ev == E_ERROR; }
+
+      //! is the current event a number?
+        bool isNumber () const { return (this->_ev == E_INTEGER) || (this->_ev == E_REAL); }
+
+      //! the text of the current key or string; the view is only valid until
+      //! the next call to `next`
+        std::string_view strVal () const
+        {
+            assert ((this->_ev == E_KEY) || (this->_ev == E_STRING));
+            return this->_str;
+        }
+
+      //! the value of the current integer
+        int64_t intVal () const
+        {
+            assert (this->_ev == E_INTEGER);
+            return this->_u.i;
+        }
+
+      //! the value of the current number as a double
+        double realVal () const
+        {
+            assert (this->isNumber());
+            return (this->_ev == E_INTEGER) ? static_cast<double>(this->_u.i) : this->_u.r;
+        }
+
+      //! the value of the current boolean
+        bool boolVal () const
+        {
+            assert (this->_ev == E_BOOL);
+            return this->_u.b;
+        }
+
+      //! skip the value that starts at the current event
+      //! \return false if there was an error
+        bool skip ();
+
+      //! \brief read the object that starts at the current event, binding its
+      //!        members to the given fields.  Members that do not match a field
+      //!        are skipped, and if a key occurs more than once, then only its
+      //!        first occurrence is used.
+      //! \param fields  the fields of the object (at most 64)
+      //! \return false if there was an error or a required field was missing
+        bool readObject (std::initializer_list<Field> fields);
+
+      //! \brief read the array that starts at the current event.
+      //! \param elem  a function that is called with the reader positioned at the
+      //!              first event of each element, which it must read; it returns
+      //!              false if there is an error
+      //! \return false if there was an error
+        template <typename F>
+        bool readArray (F &&elem)
+        {
+            if (this->_ev != E_BEGIN_ARRAY) {
+                this->error ("expected an array");
+                return false;
+            }
+            while (this->next() != E_END_ARRAY) {
+                if ((this->_ev == E_ERROR) || ! elem(*this)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+      //! report an error at the current position and put the reader into the
+      //! error state.  Only the first error is reported.
+        void error (std::string_view msg);
+
+      //! the current line number
+        uint32_t line () const { return this->_lnum; }
+
+      private:
+        enum State : uint8_t {
+            S_VALUE,            //!< expecting a value
+            S_FIRST_KEY,        //!< expecting a key or the end of an object
+            S_KEY,              //!< expecting a key
+            S_FIRST_ELEM,       //!< expecting a value or the end of an array
+            S_AFTER_VALUE,      //!< expecting ',' or the end of the enclosing value
+            S_DONE              //!< at the end of the input
+        };
+
+        cs237::MappedFile *_file;       //!< the input file (nullptr for in-memory input)
+        std::string _name;              //!< the name of the input
+        const char *_p;                 //!< the current position in the input
+        const char *_end;               //!< the end of the input
+        uint32_t _lnum;                 //!< the current line number
+        Event _ev;                      //!< the current event
+        State _state;                   //!< the parsing state
+        std::vector<bool> _nest;        //!< the enclosing values (true for objects)
+        std::string_view _str;          //!< the current key or string
+        std::string _scratch;           //!< buffer for decoding strings with escapes
+        union {
+            int64_t i;
+            double r;
+            bool b;
+        } _u;
+
+        void _init ();
+        void _skipWhitespace ();
+        Event _value ();
+        bool _string ();
+        Event _number ();
+        Event _literal (std::string_view lit, Event ev);
+    };
+
+  //! \brief the binding of values of type `T` to JSON values.  Specializations
+  //!        define a function
+  //!
+  //!            static bool read (Reader &r, T &v);
+  //!
+  //!        that reads the value that starts at the reader's current event into
+  //!        `v` and returns false (after reporting the error) if the value does
+  //!        not have the right form.
+    template <typename T> struct Binder;
+
+  //! \brief a field of an object for `Reader::readObject`.  A field binds a key to
+  //!        a destination, which is read using `Binder`, a custom read function,
+  //!        or, if the destination is callable as `bool (Reader &)`, by calling
+  //!        it.  Fields whose destination is a `std::optional` may be omitted;
+  //!        all other fields are required.
+    class Field {
+      public:
+        template <typename T>
+        Field (std::string_view key, T &&dst)
+          : _key(key), _dst(const_cast<void *>(static_cast<const void *>(&dst))),
+            _fn(nullptr), _read(&Field::_bind<std::remove_reference_t<T>>),
+            _required(! _IsOptional<std::remove_cv_t<std::remove_reference_t<T>>>::value)
+        { }
+
+        template <typename T>
+        Field (std::string_view key, T &dst, bool (*read)(Reader &, T &))
+          : _key(key), _dst(&dst), _fn(reinterpret_cast<void (*)()>(read)),
+            _read(&Field::_call<T>), _required(true)
+        { }
+
+      private:
+        friend class Reader;
+
+        template <typename T> struct _IsOptional : std::false_type { };
+        template <typename T> struct _IsOptional<std::optional<T>> : std::true_type { };
+
+        template <typename T>
+        static bool _bind (Reader &r, void *dst, void (*)())
+        {
+            if constexpr (std::is_invocable_r_v<bool, T &, Reader &>) {
+                return (*static_cast<T *>(dst))(r);
+            } else {
+                return Binder<T>::read (r, *static_cast<T *>(dst));
+            }
+        }
+
+        template <typename T>
+        static bool _call (Reader &r, void *dst, void (*fn)())
+        {
+            return reinterpret_cast<bool (*)(Reader &, T &)>(fn) (r, *static_cast<T *>(dst));
+        }
+
+        std::string_view _key;
+        void *_dst;
+        void (*_fn)();
+        bool (*_read)(Reader &, void *, void (*)());
+        bool _required;
+    };
+
+    template <>
+    struct Binder<double> {
+        static bool read (Reader &r, double &v)
+        {
+            if (! r.isNumber()) {
+                r.error ("expected a number");
+                return false;
+            }
+            v = r.realVal();
+            return true;
+        }
+    };
+
+    template <>
+    struct Binder<float> {
+        static bool read (Reader &r, float &v)
+        {
+            if (! r.isNumber()) {
+                r.error ("expected a number");
+                return false;
+            }
+            v = static_cast<float>(r.realVal());
+            return true;
+        }
+    };
+
+    template <>
+    struct Binder<int64_t> {
+        static bool read (Reader &r, int64_t &v)
+        {
+            if (r.event() != E_INTEGER) {
+                r.error ("expected an integer");
+                return false;
+            }
+            v = r.intVal();
+            return true;
+        }
+    };
+
+    template <>
+    struct Binder<int32_t> {
+        static bool read (Reader &r, int32_t &v)
+        {
+            if ((r.event() != E_INTEGER)
+            || (r.intVal() < std::numeric_limits<int32_t>::min())
+            || (r.intVal() > std::numeric_limits<int32_t>::max())) {
+                r.error ("expected a 32-bit integer");
+                return false;
+            }
+            v = static_cast<int32_t>(r.intVal());
+            return true;
+        }
+    };
+
+    template <>
+    struct Binder<uint32_t> {
+        static bool read (Reader &r, uint32_t &v)
+        {
+            if ((r.event() != E_INTEGER)
+            || (r.intVal() < 0)
+            || (r.intVal() > std::numeric_limits<uint32_t>::max())) {
+                r.error ("expected a non-negative 32-bit integer");
+                return false;
+            }
+            v = static_cast<uint32_t>(r.intVal());
+            return true;
+        }
+    };
+
+    template <>
+    struct Binder<bool> {
+        static bool read (Reader &r, bool &v)
+        {
+            if (r.event() != E_BOOL) {
+                r.error ("expected a boolean");
+                return false;
+            }
+            v = r.boolVal();
+            return true;
+        }
+    };
+
+    template <>
+    struct Binder<std::string> {
+        static bool read (Reader &r, std::string &v)
+        {
+            if (r.event() != E_STRING) {
+                r.error ("expected a string");
+                return false;
+            }
+            v.assign (r.strVal());
+            return true;
+        }
+    };
+
+  //! optional values; a null value is treated as a missing value
+    template <typename T>
+    struct Binder<std::optional<T>> {
+        static bool read (Reader &r, std::optional<T> &v)
+        {
+            if (r.event() == E_NULL) {
+                v.reset();
+                return true;
+            }
+            T x{};
+            if (! Binder<T>::read (r, x)) {
+                return false;
+            }
+            v = std::move(x);
+            return true;
+        }
+    };
+
+  //! variable-length arrays
+    template <typename T>
+    struct Binder<std::vector<T>> {
+        static bool read (Reader &r, std::vector<T> &v)
+        {
+            v.clear();
+            return r.readArray ([&v] (Reader &r) {
+                v.emplace_back();
+                return Binder<T>::read (r, v.back());
+            });
+        }
+    };
+
+  //! fixed-length arrays
+    template <typename T, size_t N>
+    struct Binder<T[N]> {
+        static bool read (Reader &r, T (&v)[N])
+        {
+            size_t i = 0;
+            bool ok = r.readArray ([&v, &i] (Reader &r) {
+                if (i == N) {
+                    r.error ("too many array elements");
+                    return false;
+                }
+                return Binder<T>::read (r, v[i++]);
+            });
+            if (ok && (i < N)) {
+                r.error ("too few array elements");
+                return false;
+            }
+            return ok;
+        }
+    };
+
 } // namespace json
 
 #endif // !_JSON_HPP_
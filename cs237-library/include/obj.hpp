@@ -67,7 +67,9 @@ struct Material {
 
 /// A Group is a connected mesh that has a single material.  It is represented
 /// by per-vertex data (position, normal, and texture coordinate) and an index
-/// array that defines a list of triangles.
+/// array that defines a list of triangles.  A group may also have a chain of
+/// simplified levels of detail, which are index arrays over the same vertices
+/// (see `Model::setBuildLODs`).
 struct Group {
     std::string         name;           ///< name of this group
     int                 material;       ///< index to material for group (-1 for no material)
@@ -78,23 +80,85 @@ struct Group {
     glm::vec2           *txtCoords;     ///< array of nVerts texture coordinates (or nullptr)
     uint32_t            *indices;       ///< array of nIndices element indices that can be used
                                         ///  to render the group
-
-    Group () : verts(nullptr), norms(nullptr), txtCoords(nullptr), indices(nullptr) { }
+    uint32_t            nLODs;          ///< the number of simplified levels of detail
+    uint32_t            nLODIndices;    ///< the total number of indices in the levels of detail
+    cs237::mesh::LOD    *lods;          ///< array of nLODs levels of detail, from finest
+                                        ///  to coarsest (or nullptr)
+    uint32_t            *lodIndices;    ///< array of nLODIndices indices for the levels of
+                                        ///  detail (or nullptr)
+
+    Group ()
+      : verts(nullptr), norms(nullptr), txtCoords(nullptr), indices(nullptr),
+        nLODs(0), nLODIndices(0), lods(nullptr), lodIndices(nullptr)
+    { }
 
     // note that deallocation of the group's memory is handled by the Model destructor
     ~Group () { }
 
 }; // struct Group
 
-/// A model from an OBJ file
+/// split a group into meshlets (see `cs237::mesh::buildMeshlets`)
+/// \param grp  the group to split
+/// \return the meshlets of the group
+inline cs237::mesh::Meshlets buildMeshlets (Group const &grp)
+{
+    return cs237::mesh::buildMeshlets (grp.nIndices, grp.indices, grp.verts, grp.nVerts);
+}
+
+/// A model from an OBJ file.
+///
+/// Loading a model from an OBJ file requires parsing the file and identifying
+/// the unique vertices of each group.  To avoid this work, the resulting group
+/// data is saved in a binary cache file (the OBJ file's path with ".cache" appended)
+/// that is used instead of the OBJ file on subsequent loads.  The cache is invalid
+/// if the OBJ file or its material library have changed, which we detect by
+/// comparing sizes and modification times (and, when the times differ, content
+/// hashes).  A model that is loaded from the cache refers directly to the
+/// memory-mapped cache file, so its group arrays must be treated as read only.
+///
+/// Optionally, the triangles and vertices of each group can be reordered for
+/// better use of the GPU's vertex cache and less overdraw (see `cs237::mesh::optimize`),
+/// and a chain of simplified levels of detail can be built for each group (see
+/// `cs237::mesh::buildLODs`).  Since this work is done before the cache file is
+/// written, it does not slow down subsequent loads.
 class Model {
   public:
 
-  /// create a Model by loading it from the specified OBJ file
+  /// create a Model by loading it from the specified OBJ file (or its cache)
   /// \param filename the path of the OBJ file to be loaded
-    Model (std::string filename);
+  /// \param jobs     optional job system used to parse large files in parallel
+    Model (std::string filename, cs237::JobSystem *jobs = nullptr);
+
+  /// create a Model from the contents of a cache file that are already in memory
+  /// (e.g., an entry in a bundle of scene assets).  The model refers directly to
+  /// the data, which must outlive it, and the data is not checked against the
+  /// model's source files.
+  /// \param name  the name of the model (used in error messages)
+  /// \param data  the cache-file contents, which must be 16-byte aligned
+  /// \param sz    the size of the data in bytes
+    Model (std::string const &name, const char *data, size_t sz);
+
     ~Model ();
 
+  /// enable or disable the use of mesh cache files (they are enabled by default)
+    static void setCacheEnabled (bool enable) { Model::_cacheEnabled = enable; }
+
+  /// enable or disable optimizing the order of the groups' triangles and vertices
+  /// for rendering (it is disabled by default)
+    static void setOptimizeMeshes (bool enable) { Model::_optimizeMeshes = enable; }
+
+  /// enable or disable building levels of detail for the groups (it is disabled
+  /// by default)
+    static void setBuildLODs (bool enable) { Model::_buildLODs = enable; }
+
+  /// was this model loaded from a cache file (or from in-memory cache data)?
+    bool isCached () const { return (this->_cache != nullptr) || this->_borrowed; }
+
+  /// get the contents of the model's cache file
+  /// \param[out] data  set to the cache-file contents
+  /// \return false if the model's source files could not be read
+    bool cacheData (std::string &data) const;
+
   /// the model's axis-aligned bounding box
     const cs237::AABBf_t &bounds () const { return this->_bbox; }
 
@@ -119,10 +183,29 @@ class Model {
 
     std::vector<OBJ::Material> _materials;
     std::vector<OBJ::Group> _groups;
+    cs237::MappedFile   *_cache;        ///< the cache file that the groups' data
+                                        ///  lives in (nullptr if not cached)
+    bool                _borrowed;      ///< true if the groups' data lives in memory
+                                        ///  that is owned by someone else
+
+    static bool _cacheEnabled;          ///< should cache files be used?
+    static bool _optimizeMeshes;        ///< should the group meshes be optimized?
+    static bool _buildLODs;             ///< should levels of detail be built for the groups?
 
   // read a material library
     bool readMaterial (std::string m);
 
+  // try to load the model from a cache file; returns true on success
+    bool _readCache (std::string const &cacheFile);
+  // load the model from cache data; the sources are only checked if `checkSources`
+  // is true.  Returns true on success.
+    bool _loadCache (
+        const char *data, size_t sz,
+        std::string const &cacheFile,
+        bool checkSources);
+  // write the model to a cache file
+    void _writeCache (std::string const &cacheFile) const;
+
 }; // class Model
 
 } // namespace OBJ
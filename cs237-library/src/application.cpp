@@ -39,6 +39,7 @@ Application::Application (std::vector<std::string> const &args, std::string cons
   : _name(name),
     _messages(vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning),
     _debug(0),
+    _hostImageCopy(true),
     _gpu(nullptr),
     _propsCache(nullptr),
     _featuresCache(nullptr)
@@ -50,6 +51,8 @@ Application::Application (std::vector<std::string> const &args, std::string cons
             this->_debug = true;
         } else if (it == "-verbose") {
             this->_messages = vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose;
+        } else if (it == "-no-host-copy") {
+            this->_hostImageCopy = false;
         }
     }
 
@@ -300,6 +303,44 @@ static bool extInList (const char *name, std::vector<vk::ExtensionProperties> co
     return false;
 }
 
+#ifdef VK_EXT_host_image_copy
+// check if a device supports copying textures directly from host memory.  We
+// require a Vulkan 1.3 device (which provides the extension's dependencies) and
+// that images can be copied in the layout in which they are sampled, so that
+// no further transitions are needed.
+static bool hasHostImageCopy (vk::PhysicalDevice gpu)
+{
+    if (gpu.getProperties().apiVersion < VK_API_VERSION_1_3) {
+        return false;
+    }
+
+    vk::PhysicalDeviceHostImageCopyFeaturesEXT hostCopyFeatures{};
+    vk::PhysicalDeviceFeatures2 features{};
+    features.pNext = &hostCopyFeatures;
+    gpu.getFeatures2 (&features);
+    if (! hostCopyFeatures.hostImageCopy) {
+        return false;
+    }
+
+    // the first query gets the number of layouts and the second gets the layouts
+    vk::PhysicalDeviceHostImageCopyPropertiesEXT hostCopyProps{};
+    vk::PhysicalDeviceProperties2 props{};
+    props.pNext = &hostCopyProps;
+    gpu.getProperties2 (&props);
+    std::vector<vk::ImageLayout> dstLayouts(hostCopyProps.copyDstLayoutCount);
+    hostCopyProps.copySrcLayoutCount = 0;
+    hostCopyProps.pCopyDstLayouts = dstLayouts.data();
+    gpu.getProperties2 (&props);
+    for (auto layout : dstLayouts) {
+        if (layout == vk::ImageLayout::eShaderReadOnlyOptimal) {
+            return true;
+        }
+    }
+    return false;
+
+}
+#endif
+
 void Application::_createLogicalDevice ()
 {
     // set up the device queues info struct; the graphics and presentation queues may
@@ -342,12 +383,44 @@ void Application::_createLogicalDevice ()
     vk::PhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.fillModeNonSolid = VK_TRUE;
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // multiple indirect draws per command are supported by most devices, but
+    // are optional, so we only enable them when available
+    deviceFeatures.multiDrawIndirect = this->features()->multiDrawIndirect;
+    // block-compressed textures are supported by desktop GPUs; textures fall
+    // back to uncompressed formats when they are not available
+    deviceFeatures.textureCompressionBC = this->features()->textureCompressionBC;
+    // the compute shader that generates mipmap levels for formats that cannot be
+    // blitted writes storage images without a format qualifier
+    deviceFeatures.shaderStorageImageWriteWithoutFormat =
+        this->features()->shaderStorageImageWriteWithoutFormat;
+    // virtual textures record the tiles that they need from the fragment shader
+    deviceFeatures.fragmentStoresAndAtomics = this->features()->fragmentStoresAndAtomics;
+    // tessellation shaders are optional, so renderers that use them must check
+    // for support
+    deviceFeatures.tessellationShader = this->features()->tessellationShader;
 
     // allow descriptor sets to have undefined descriptors (as long as they
     // are not dynamically used)
     vk::PhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
     indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
 
+    // textures can be uploaded without staging buffers or command submissions
+    // when the device supports host image copies (software implementations
+    // usually do)
+#ifdef VK_EXT_host_image_copy
+    vk::PhysicalDeviceHostImageCopyFeaturesEXT hostCopyFeatures{};
+    this->_hostImageCopy = this->_hostImageCopy
+        && extInList(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME, supportedExts)
+        && hasHostImageCopy(this->_gpu);
+    if (this->_hostImageCopy) {
+        kDeviceExts.push_back(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+        hostCopyFeatures.hostImageCopy = VK_TRUE;
+        indexingFeatures.pNext = &hostCopyFeatures;
+    }
+#else
+    this->_hostImageCopy = false;
+#endif
+
     // initialize the create info
     vk::DeviceCreateInfo createInfo(
         {}, /* flags */
@@ -367,6 +440,20 @@ void Application::_createLogicalDevice ()
     this->_queues.present = this->_device.getQueue(this->_qIdxs.present, 0);
     this->_queues.compute = this->_device.getQueue(this->_qIdxs.compute, 0);
 
+#ifdef VK_EXT_host_image_copy
+    // get the host-image-copy functions
+    if (this->_hostImageCopy) {
+        this->_vkTransitionImageLayout = (PFN_vkTransitionImageLayoutEXT) vkGetDeviceProcAddr (
+            this->_device,
+            "vkTransitionImageLayoutEXT");
+        this->_vkCopyMemoryToImage = (PFN_vkCopyMemoryToImageEXT) vkGetDeviceProcAddr (
+            this->_device,
+            "vkCopyMemoryToImageEXT");
+        this->_hostImageCopy = (this->_vkTransitionImageLayout != nullptr)
+            && (this->_vkCopyMemoryToImage != nullptr);
+    }
+#endif
+
 }
 
 // create a Vulkan image; used for textures, depth buffers, etc.
@@ -377,15 +464,17 @@ vk::Image Application::_createImage (
     vk::ImageTiling tiling,
     vk::ImageUsageFlags usage,
     vk::ImageLayout layout,
-    uint32_t mipLvls)
+    uint32_t mipLvls,
+    uint32_t nLayers,
+    vk::ImageCreateFlags flags)
 {
     vk::ImageCreateInfo imageInfo(
-        {}, /* flags */
+        flags, /* flags */
         vk::ImageType::e2D,
         format,
         { wid, ht, 1 }, /* extend: wid, ht, depth */
         mipLvls, /* mip levels */
-        1, /* array layers */
+        nLayers, /* array layers */
         vk::SampleCountFlagBits::e1, /* samples */
         tiling,
         usage,
@@ -415,21 +504,124 @@ vk::ImageView Application::_createImageView (
     vk::Image img,
     vk::Format fmt,
     vk::ImageAspectFlags aspectFlags)
+{
+    return this->_createImageView (img, fmt, aspectFlags, vk::ImageViewType::e2D, 1, 1);
+
+}
+
+vk::ImageView Application::_createImageView (
+    vk::Image img,
+    vk::Format fmt,
+    vk::ImageAspectFlags aspectFlags,
+    vk::ImageViewType viewType,
+    uint32_t nLevels,
+    uint32_t nLayers)
 {
     assert (img);
 
     vk::ImageViewCreateInfo viewInfo(
         {}, /* flags */
         img,
-        vk::ImageViewType::e2D,
+        viewType,
         fmt,
         {}, /* component mapping */
-        { aspectFlags, 0, 1, 0, 1 });
+        { aspectFlags, 0, nLevels, 0, nLayers });
 
     return this->_device.createImageView(viewInfo);
 
 }
 
+bool Application::_canHostCopy (
+    vk::Format fmt,
+    vk::ImageUsageFlags usage,
+    vk::ImageCreateFlags flags)
+{
+#ifdef VK_EXT_host_image_copy
+    if (! this->_hostImageCopy) {
+        return false;
+    }
+
+    auto fmtProps = this->_gpu.getFormatProperties2<vk::FormatProperties2, vk::FormatProperties3>(fmt);
+    if (! (fmtProps.get<vk::FormatProperties3>().optimalTilingFeatures
+            & vk::FormatFeatureFlagBits2::eHostImageTransferEXT)) {
+        return false;
+    }
+
+    // an image that supports host copies may have a different memory layout,
+    // which can make sampling it slower, so we only use host copies when the
+    // device reports that its access to the image is still optimal
+    vk::PhysicalDeviceImageFormatInfo2 info(
+        fmt,
+        vk::ImageType::e2D,
+        vk::ImageTiling::eOptimal,
+        usage | vk::ImageUsageFlagBits::eHostTransferEXT,
+        flags);
+    vk::HostImageCopyDevicePerformanceQueryEXT perf{};
+    vk::ImageFormatProperties2 props{};
+    props.pNext = &perf;
+    if (this->_gpu.getImageFormatProperties2(&info, &props) != vk::Result::eSuccess) {
+        return false;
+    }
+    return perf.optimalDeviceAccess;
+#else
+    return false;
+#endif
+
+}
+
+void Application::_copyHostToImage (
+    vk::Image img,
+    uint32_t wid,
+    uint32_t ht,
+    uint32_t nLevels,
+    uint32_t nLayers,
+    std::vector<const void *> const &levels)
+{
+#ifdef VK_EXT_host_image_copy
+    assert (this->_hostImageCopy);
+    assert (levels.size() == nLevels * nLayers);
+
+    // host transitions take effect immediately, so the copy does not need
+    // any synchronization with the device
+    VkHostImageLayoutTransitionInfoEXT transition{};
+    transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+    transition.image = static_cast<VkImage>(img);
+    transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    transition.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    transition.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, nLevels, 0, nLayers };
+    auto sts = this->_vkTransitionImageLayout (
+        static_cast<VkDevice>(this->_device), 1, &transition);
+    if (sts != VK_SUCCESS) {
+        ERROR("unable to transition image layout on the host");
+    }
+
+    std::vector<VkMemoryToImageCopyEXT> regions(levels.size());
+    for (uint32_t layer = 0;  layer < nLayers;  layer++) {
+        for (uint32_t i = 0;  i < nLevels;  i++) {
+            VkMemoryToImageCopyEXT &region = regions[layer * nLevels + i];
+            region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+            region.pHostPointer = levels[layer * nLevels + i];
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, layer, 1 };
+            region.imageExtent = { std::max(wid >> i, 1u), std::max(ht >> i, 1u), 1 };
+        }
+    }
+
+    VkCopyMemoryToImageInfoEXT info{};
+    info.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+    info.dstImage = static_cast<VkImage>(img);
+    info.dstImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    info.regionCount = regions.size();
+    info.pRegions = regions.data();
+    sts = this->_vkCopyMemoryToImage (static_cast<VkDevice>(this->_device), &info);
+    if (sts != VK_SUCCESS) {
+        ERROR("unable to copy image data from the host");
+    }
+#else
+    ERROR("host image copies are not supported");
+#endif
+
+}
+
 vk::Buffer Application::_createBuffer (size_t size, vk::BufferUsageFlags usage)
 {
     vk::BufferCreateInfo bufferInfo(
@@ -462,7 +654,9 @@ void Application::_transitionImageLayout (
     vk::Image image,
     vk::Format format,
     vk::ImageLayout oldLayout,
-    vk::ImageLayout newLayout)
+    vk::ImageLayout newLayout,
+    uint32_t nLevels,
+    uint32_t nLayers)
 {
     vk::CommandBuffer cmdBuf = this->newCommandBuf();
 
@@ -476,7 +670,7 @@ void Application::_transitionImageLayout (
         VK_QUEUE_FAMILY_IGNORED,
         VK_QUEUE_FAMILY_IGNORED,
         image,
-        { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
+        { vk::ImageAspectFlagBits::eColor, 0, nLevels, 0, nLayers });
 
     vk::PipelineStageFlags srcStage;
     vk::PipelineStageFlags dstStage;
@@ -548,7 +742,7 @@ void Application::_copyBuffer (
 
 void Application::_copyBufferToImage (
         vk::Image dstImg, vk::Buffer srcBuf, size_t size,
-        uint32_t wid, uint32_t ht, uint32_t depth)
+        uint32_t wid, uint32_t ht, uint32_t depth, uint32_t nLayers)
 {
     vk::CommandBuffer cmdBuf = this->newCommandBuf();
 
@@ -558,7 +752,7 @@ void Application::_copyBufferToImage (
         0, /* offset */
         0, /* row length */
         0, /* image height */
-        { vk::ImageAspectFlagBits::eColor, 0, 0, 1 },
+        { vk::ImageAspectFlagBits::eColor, 0, 0, nLayers },
         { 0, 0, 0 },
         { wid, ht, depth });
 
@@ -599,7 +793,7 @@ vk::Sampler Application::createSampler (Application::SamplerInfo const &info)
         VK_FALSE, /* compare enable */
         vk::CompareOp::eNever, /* compare op */
         0, /* min LOD */
-        0, /* max LOD */
+        VK_LOD_CLAMP_NONE, /* max LOD */
         info.borderColor, /* borderColor */
         VK_FALSE); /* unnormalized coordinates */
 
@@ -647,13 +841,19 @@ vk::Pipeline Application::createPipeline (
     vk::RenderPass renderPass,
     uint32_t subPass,
     vk::PipelineColorBlendStateCreateInfo const &blending,
-    vk::ArrayProxy<vk::DynamicState> const &dynamic)
+    vk::ArrayProxy<vk::DynamicState> const &dynamic,
+    uint32_t patchSize)
 {
     vk::PipelineInputAssemblyStateCreateInfo asmInfo(
         {}, /* flags */
         prim, /* topology */
         primRestart ? VK_TRUE : VK_FALSE); /* primitive restart */
 
+    // the tessellation state is only needed for patch lists
+    vk::PipelineTessellationStateCreateInfo tessState(
+        {}, /* flags */
+        patchSize); /* patch control points */
+
     vk::PipelineViewportStateCreateInfo viewportState(
         {}, /* flags */
         viewports, /* viewport */
@@ -691,7 +891,7 @@ vk::Pipeline Application::createPipeline (
         shaders->stages(), /* stages */
         &vertexInfo, /* vertex-input state */
         &asmInfo, /* input-assembly state */
-        {}, /* tesselation state */
+        (prim == vk::PrimitiveTopology::ePatchList) ? &tessState : nullptr, /* tessellation state */
         &viewportState, /* viewport state */
         &rasterizer, /* rasterization state */
         &multisampling, /* multisample state */
@@ -727,7 +927,8 @@ vk::Pipeline Application::createPipeline (
     vk::PipelineLayout layout,
     vk::RenderPass renderPass,
     uint32_t subPass,
-    vk::ArrayProxy<vk::DynamicState> const &dynamic)
+    vk::ArrayProxy<vk::DynamicState> const &dynamic,
+    uint32_t patchSize)
 {
     vk::PipelineColorBlendAttachmentState colorBlendAttachment(
         VK_FALSE, /* blend enable */
@@ -759,7 +960,8 @@ vk::Pipeline Application::createPipeline (
         renderPass,
         subPass,
         colorBlending,
-        dynamic);
+        dynamic,
+        patchSize);
 
 }
 
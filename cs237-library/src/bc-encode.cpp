@@ -0,0 +1,679 @@
+/*! \file bc-encode.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * A CPU encoder for the BC1, BC3, BC5, and BC7 block-compression formats.
+ * The encoder fits the endpoints of each block to the principal axis of the
+ * block's pixels and then refines them with a least-squares fit to the
+ * chosen indices.  BC7 blocks are encoded using mode 6 (a single subset with
+ * 7-bit RGBA endpoints and 4-bit indices), which is the mode that works best
+ * for most smooth and photographic content.
+ *
+ * The inner loop of the encoder (choosing the palette entry for each pixel)
+ * uses SSE2 when it is available.  Blocks are independent, so the rows of
+ * blocks are encoded in parallel when a job system is provided.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "bc-util.hpp"
+#include <cfloat>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cs237 {
+
+namespace __detail {
+
+// the number of rows of blocks that are encoded by a single job
+constexpr uint32_t kRowsPerJob = 8;
+
+// a 4x4 block of pixels in structure-of-arrays form; ch[c][i] is the value
+// (0..255) of channel c of pixel i, where the pixels are in row-major order
+struct Block {
+    alignas(16) float ch[4][16];
+};
+
+// a simple writer for the bit fields of a 128-bit block; fields are stored
+// least-significant bit first
+class BitWriter {
+  public:
+    explicit BitWriter (uint8_t *blk) : _blk(blk), _pos(0)
+    {
+        std::memset (blk, 0, 16);
+    }
+
+    void put (uint32_t v, uint32_t nBits)
+    {
+        for (uint32_t i = 0;  i < nBits;  ++i, ++this->_pos) {
+            this->_blk[this->_pos >> 3] |= uint8_t(((v >> i) & 1) << (this->_pos & 7));
+        }
+    }
+
+  private:
+    uint8_t *_blk;
+    uint32_t _pos;
+};
+
+// load the 4x4 block with upper-left pixel (x0, y0) from an image with 8-bit
+// channels.  Pixels outside the image are replaced by the nearest pixel inside
+// it, and the channels are converted to RGBA order (missing color channels are
+// zero and a missing alpha channel is 255).
+static void loadBlock (Image2D const *img, uint32_t x0, uint32_t y0, Block &blk)
+{
+    const uint32_t wid = img->width(), ht = img->height();
+    const uint32_t nc = img->nChannels();
+    const uint8_t *data = static_cast<const uint8_t *>(img->data());
+    const bool bgr = (img->channels() == Channels::BGR) || (img->channels() == Channels::BGRA);
+    for (uint32_t y = 0;  y < 4;  ++y) {
+        const uint8_t *row = data + size_t(std::min(y0 + y, ht - 1)) * wid * nc;
+        for (uint32_t x = 0;  x < 4;  ++x) {
+            const uint8_t *p = row + std::min(x0 + x, wid - 1) * nc;
+            uint32_t i = 4*y + x;
+            blk.ch[0][i] = float(p[(bgr && nc >= 3) ? 2 : 0]);
+            blk.ch[1][i] = (nc >= 2) ? float(p[1]) : 0.0f;
+            blk.ch[2][i] = (nc >= 3) ? float(p[bgr ? 0 : 2]) : 0.0f;
+            blk.ch[3][i] = (nc == 4) ? float(p[3]) : 255.0f;
+        }
+    }
+}
+
+// choose the closest palette entry for each pixel of a block, where we only
+// consider the NCh channels starting at channel `first`.
+// \return the total squared error
+template <int NCh>
+static float selectIndices (
+    Block const &blk, uint32_t first,
+    const float pal[][4], uint32_t nPal,
+    uint8_t idx[16])
+{
+#if defined(__SSE2__)
+    __m128 total = _mm_setzero_ps();
+    for (uint32_t i = 0;  i < 16;  i += 4) {
+        __m128 px[NCh];
+        for (int c = 0;  c < NCh;  ++c) {
+            px[c] = _mm_load_ps(&blk.ch[first + c][i]);
+        }
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128i bestIdx = _mm_setzero_si128();
+        for (uint32_t k = 0;  k < nPal;  ++k) {
+            __m128 d = _mm_sub_ps(px[0], _mm_set1_ps(pal[k][0]));
+            __m128 err = _mm_mul_ps(d, d);
+            for (int c = 1;  c < NCh;  ++c) {
+                d = _mm_sub_ps(px[c], _mm_set1_ps(pal[k][c]));
+                err = _mm_add_ps(err, _mm_mul_ps(d, d));
+            }
+            // select the new index in the lanes where the error is smaller
+            __m128i less = _mm_castps_si128(_mm_cmplt_ps(err, best));
+            bestIdx = _mm_or_si128(
+                _mm_and_si128(less, _mm_set1_epi32(int(k))),
+                _mm_andnot_si128(less, bestIdx));
+            best = _mm_min_ps(err, best);
+        }
+        total = _mm_add_ps(total, best);
+        alignas(16) int32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes), bestIdx);
+        for (int j = 0;  j < 4;  ++j) {
+            idx[i+j] = uint8_t(lanes[j]);
+        }
+    }
+    alignas(16) float sums[4];
+    _mm_store_ps(sums, total);
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#else
+    float total = 0.0f;
+    for (uint32_t i = 0;  i < 16;  ++i) {
+        float best = FLT_MAX;
+        uint8_t bestIdx = 0;
+        for (uint32_t k = 0;  k < nPal;  ++k) {
+            float err = 0.0f;
+            for (int c = 0;  c < NCh;  ++c) {
+                float d = blk.ch[first + c][i] - pal[k][c];
+                err += d * d;
+            }
+            if (err < best) {
+                best = err;
+                bestIdx = uint8_t(k);
+            }
+        }
+        idx[i] = bestIdx;
+        total += best;
+    }
+    return total;
+#endif
+}
+
+// compute the mean and the principal axis of the first nCh channels of a
+// block's pixels.  The axis is the dominant eigenvector of the covariance
+// matrix, which we compute using power iteration; it is zero when all of the
+// pixels are the same.
+static void principalAxis (Block const &blk, int nCh, float mean[4], float axis[4])
+{
+    for (int c = 0;  c < 4;  ++c) {
+        float sum = 0.0f;
+        for (int i = 0;  (c < nCh) && (i < 16);  ++i) {
+            sum += blk.ch[c][i];
+        }
+        mean[c] = sum / 16.0f;
+        axis[c] = 0.0f;
+    }
+
+    float cov[4][4] = {};
+    for (int i = 0;  i < 16;  ++i) {
+        for (int r = 0;  r < nCh;  ++r) {
+            float dr = blk.ch[r][i] - mean[r];
+            for (int c = r;  c < nCh;  ++c) {
+                cov[r][c] += dr * (blk.ch[c][i] - mean[c]);
+            }
+        }
+    }
+    for (int r = 0;  r < nCh;  ++r) {
+        for (int c = 0;  c < r;  ++c) {
+            cov[r][c] = cov[c][r];
+        }
+    }
+
+    // start with the row of the channel that has the largest variance, which
+    // cannot be orthogonal to the dominant eigenvector
+    int maxC = 0;
+    for (int c = 1;  c < nCh;  ++c) {
+        if (cov[c][c] > cov[maxC][maxC]) {
+            maxC = c;
+        }
+    }
+    if (cov[maxC][maxC] < 1.0e-3f) {
+        return;
+    }
+    float v[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int c = 0;  c < nCh;  ++c) {
+        v[c] = cov[maxC][c];
+    }
+    for (int iter = 0;  iter < 8;  ++iter) {
+        float w[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float maxW = 0.0f;
+        for (int r = 0;  r < nCh;  ++r) {
+            for (int c = 0;  c < nCh;  ++c) {
+                w[r] += cov[r][c] * v[c];
+            }
+            maxW = std::max(maxW, std::fabs(w[r]));
+        }
+        if (maxW == 0.0f) {
+            break;
+        }
+        for (int c = 0;  c < nCh;  ++c) {
+            v[c] = w[c] / maxW;
+        }
+    }
+
+    float len = 0.0f;
+    for (int c = 0;  c < nCh;  ++c) {
+        len += v[c] * v[c];
+    }
+    len = std::sqrt(len);
+    for (int c = 0;  (len > 0.0f) && (c < nCh);  ++c) {
+        axis[c] = v[c] / len;
+    }
+
+}
+
+// compute initial endpoints for a block by projecting its pixels onto the
+// principal axis
+static void axisEndpoints (Block const &blk, int nCh, float e0[4], float e1[4])
+{
+    float mean[4], axis[4];
+    principalAxis (blk, nCh, mean, axis);
+    float tMin = 0.0f, tMax = 0.0f;
+    for (int i = 0;  i < 16;  ++i) {
+        float t = 0.0f;
+        for (int c = 0;  c < nCh;  ++c) {
+            t += (blk.ch[c][i] - mean[c]) * axis[c];
+        }
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    for (int c = 0;  c < 4;  ++c) {
+        e0[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+        e1[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+    }
+}
+
+// compute the endpoints that minimize the squared error for the given indices,
+// where `wts[k]` is the fraction of the way from e0 to e1 for index k.
+// \return false if the indices do not determine the endpoints (e.g., when
+//         they are all the same)
+static bool fitEndpoints (
+    Block const &blk, uint32_t first, int nCh,
+    const uint8_t idx[16], const float *wts,
+    float e0[4], float e1[4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float xa[4] = {0.0f, 0.0f, 0.0f, 0.0f}, xb[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0;  i < 16;  ++i) {
+        float b = wts[idx[i]];
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0;  c < nCh;  ++c) {
+            xa[c] += a * blk.ch[first + c][i];
+            xb[c] += b * blk.ch[first + c][i];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1.0e-6f) {
+        return false;
+    }
+    float s = 1.0f / det;
+    for (int c = 0;  c < nCh;  ++c) {
+        e0[c] = std::clamp((bb * xa[c] - ab * xb[c]) * s, 0.0f, 255.0f);
+        e1[c] = std::clamp((aa * xb[c] - ab * xa[c]) * s, 0.0f, 255.0f);
+    }
+    return true;
+
+}
+
+/***** BC1 *****/
+
+// quantize a color to 5-6-5 bits
+static uint16_t pack565 (const float c[4])
+{
+    uint32_t r = uint32_t(c[0] * (31.0f / 255.0f) + 0.5f);
+    uint32_t g = uint32_t(c[1] * (63.0f / 255.0f) + 0.5f);
+    uint32_t b = uint32_t(c[2] * (31.0f / 255.0f) + 0.5f);
+    return uint16_t((std::min(r, 31u) << 11) | (std::min(g, 63u) << 5) | std::min(b, 31u));
+}
+
+// encode the color part of a block in BC1 format.  If `transparent` is true, then
+// the block uses the three-color mode and the pixels with alpha < 128 are
+// encoded as transparent black.
+static void encodeBC1 (Block const &src, bool transparent, uint8_t *out)
+{
+    // the position of each palette entry between the endpoints
+    static const float kWts4[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    static const float kWts3[3] = { 0.0f, 1.0f, 0.5f };
+    const float *wts = transparent ? kWts3 : kWts4;
+    const uint32_t nPal = transparent ? 3 : 4;
+
+    // the transparent pixels are replaced by the average of the opaque pixels,
+    // so that they do not affect the choice of endpoints
+    Block blk = src;
+    if (transparent) {
+        float sum[3] = {0.0f, 0.0f, 0.0f};
+        int nOpaque = 0;
+        for (int i = 0;  i < 16;  ++i) {
+            if (src.ch[3][i] >= 128.0f) {
+                for (int c = 0;  c < 3;  ++c) {
+                    sum[c] += src.ch[c][i];
+                }
+                nOpaque++;
+            }
+        }
+        if (nOpaque == 0) {
+            // the whole block is transparent
+            std::memset (out, 0, 4);
+            std::memset (out + 4, 0xff, 4);
+            return;
+        }
+        for (int i = 0;  i < 16;  ++i) {
+            if (src.ch[3][i] < 128.0f) {
+                for (int c = 0;  c < 3;  ++c) {
+                    blk.ch[c][i] = sum[c] / float(nOpaque);
+                }
+            }
+        }
+    }
+
+    float e0[4], e1[4];
+    axisEndpoints (blk, 3, e0, e1);
+
+    // encode the block for a pair of endpoints
+    uint16_t c0, c1;
+    uint8_t idx[16];
+    auto encode = [&] (uint16_t a, uint16_t b, uint8_t ix[16]) {
+        // we use the four-color palette to choose indices; for the three-color
+        // palette, we just ignore the fourth entry
+        uint8_t pal8[4][4];
+        bc1Palette (a, b, true, pal8);
+        if (transparent) {
+            for (int k = 0;  k < 3;  ++k) {
+                pal8[2][k] = uint8_t((pal8[0][k] + pal8[1][k] + 1) / 2);
+            }
+        }
+        float pal[4][4];
+        for (int k = 0;  k < 4;  ++k) {
+            for (int c = 0;  c < 4;  ++c) {
+                pal[k][c] = float(pal8[k][c]);
+            }
+        }
+        return selectIndices<3> (blk, 0, pal, nPal, ix);
+    };
+
+    c0 = pack565 (e0);
+    c1 = pack565 (e1);
+    float err = encode (c0, c1, idx);
+
+    // refine the endpoints using the indices
+    for (int iter = 0;  iter < 2;  ++iter) {
+        uint8_t newIdx[16];
+        if (! fitEndpoints (blk, 0, 3, idx, wts, e0, e1)) {
+            break;
+        }
+        uint16_t n0 = pack565 (e0), n1 = pack565 (e1);
+        float newErr = encode (n0, n1, newIdx);
+        if (newErr >= err) {
+            break;
+        }
+        c0 = n0;
+        c1 = n1;
+        err = newErr;
+        std::memcpy (idx, newIdx, 16);
+    }
+
+    // put the endpoints in the order that selects the mode
+    if (transparent) {
+        if (c0 > c1) {
+            std::swap (c0, c1);
+            for (int i = 0;  i < 16;  ++i) {
+                idx[i] = (idx[i] == 2) ? 2 : (idx[i] ^ 1);
+            }
+        }
+        for (int i = 0;  i < 16;  ++i) {
+            if (blk.ch[3][i] < 128.0f) {
+                idx[i] = 3;
+            }
+        }
+    } else if (c0 < c1) {
+        std::swap (c0, c1);
+        for (int i = 0;  i < 16;  ++i) {
+            idx[i] ^= 1;
+        }
+    } else if (c0 == c1) {
+        // all of the palette entries are the same
+        std::memset (idx, 0, 16);
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0;  i < 16;  ++i) {
+        bits |= uint32_t(idx[i]) << (2*i);
+    }
+    out[0] = uint8_t(c0);
+    out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1);
+    out[3] = uint8_t(c1 >> 8);
+    std::memcpy (out + 4, &bits, 4);
+
+}
+
+/***** BC4 *****/
+
+// encode channel `ch` of a block in BC4 format (used for the alpha of BC3
+// and for the channels of BC5).  We always use the eight-value mode.
+static void encodeBC4 (Block const &blk, uint32_t ch, uint8_t *out)
+{
+    // the position of each palette entry between the endpoints
+    static const float kWts[8] = {
+            0.0f, 1.0f, 1.0f/7.0f, 2.0f/7.0f, 3.0f/7.0f, 4.0f/7.0f, 5.0f/7.0f, 6.0f/7.0f
+        };
+
+    float lo = 255.0f, hi = 0.0f;
+    for (int i = 0;  i < 16;  ++i) {
+        lo = std::min(lo, blk.ch[ch][i]);
+        hi = std::max(hi, blk.ch[ch][i]);
+    }
+    uint8_t a0 = uint8_t(hi + 0.5f), a1 = uint8_t(lo + 0.5f);
+    uint8_t idx[16] = {};
+
+    // encode the block for a pair of endpoints, where a > b
+    auto encode = [&] (uint8_t a, uint8_t b, uint8_t ix[16]) {
+        uint8_t pal8[8];
+        bc4Palette (a, b, pal8);
+        float pal[8][4];
+        for (int k = 0;  k < 8;  ++k) {
+            pal[k][0] = float(pal8[k]);
+        }
+        return selectIndices<1> (blk, ch, pal, 8, ix);
+    };
+
+    if (a0 > a1) {
+        float err = encode (a0, a1, idx);
+        uint8_t newIdx[16];
+        float e0[4], e1[4];
+        if (fitEndpoints (blk, ch, 1, idx, kWts, e0, e1)) {
+            uint8_t n0 = uint8_t(e0[0] + 0.5f), n1 = uint8_t(e1[0] + 0.5f);
+            if ((n0 > n1) && (encode (n0, n1, newIdx) < err)) {
+                a0 = n0;
+                a1 = n1;
+                std::memcpy (idx, newIdx, 16);
+            }
+        }
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0;  i < 16;  ++i) {
+        bits |= uint64_t(idx[i]) << (3*i);
+    }
+    out[0] = a0;
+    out[1] = a1;
+    for (int i = 0;  i < 6;  ++i) {
+        out[2+i] = uint8_t(bits >> (8*i));
+    }
+
+}
+
+/***** BC7 *****/
+
+// quantize an endpoint to the 7-bit values plus a P-bit of BC7 mode 6; the
+// P-bit is forced to one when `opaque` is true, since that is the only way to
+// represent an alpha of 255.
+static void quantizeMode6 (const float e[4], bool opaque, uint32_t q[4], uint32_t &p)
+{
+    float bestErr = FLT_MAX;
+    for (uint32_t pb = (opaque ? 1 : 0);  pb < 2;  ++pb) {
+        uint32_t qv[4];
+        float err = 0.0f;
+        for (int c = 0;  c < 4;  ++c) {
+            int v = int(std::floor((e[c] - float(pb)) * 0.5f + 0.5f));
+            qv[c] = uint32_t(std::clamp(v, 0, 127));
+            float d = float((qv[c] << 1) | pb) - e[c];
+            err += d * d;
+        }
+        if (err < bestErr) {
+            bestErr = err;
+            std::memcpy (q, qv, sizeof(qv));
+            p = pb;
+        }
+    }
+}
+
+// encode a block in BC7 mode 6
+static void encodeBC7 (Block const &blk, uint8_t *out)
+{
+    // the position of each palette entry between the endpoints
+    float wts[16];
+    for (int k = 0;  k < 16;  ++k) {
+        wts[k] = float(kBC7Weights4[k]) / 64.0f;
+    }
+
+    bool opaque = true;
+    for (int i = 0;  i < 16;  ++i) {
+        opaque = opaque && (blk.ch[3][i] == 255.0f);
+    }
+
+    float e0[4], e1[4];
+    axisEndpoints (blk, 4, e0, e1);
+
+    // encode the block for a pair of endpoints
+    uint32_t q0[4], q1[4], p0, p1;
+    uint8_t idx[16];
+    auto encode = [&] (const uint32_t a[4], uint32_t pa, const uint32_t b[4], uint32_t pb,
+        uint8_t ix[16])
+    {
+        float pal[16][4];
+        for (int c = 0;  c < 4;  ++c) {
+            uint32_t va = (a[c] << 1) | pa, vb = (b[c] << 1) | pb;
+            for (int k = 0;  k < 16;  ++k) {
+                pal[k][c] = float(bc7Interp (va, vb, kBC7Weights4[k]));
+            }
+        }
+        return selectIndices<4> (blk, 0, pal, 16, ix);
+    };
+
+    quantizeMode6 (e0, opaque, q0, p0);
+    quantizeMode6 (e1, opaque, q1, p1);
+    float err = encode (q0, p0, q1, p1, idx);
+
+    // refine the endpoints using the indices
+    for (int iter = 0;  iter < 2;  ++iter) {
+        if (! fitEndpoints (blk, 0, 4, idx, wts, e0, e1)) {
+            break;
+        }
+        uint32_t n0[4], n1[4], np0, np1;
+        uint8_t newIdx[16];
+        quantizeMode6 (e0, opaque, n0, np0);
+        quantizeMode6 (e1, opaque, n1, np1);
+        float newErr = encode (n0, np0, n1, np1, newIdx);
+        if (newErr >= err) {
+            break;
+        }
+        std::memcpy (q0, n0, sizeof(n0));
+        std::memcpy (q1, n1, sizeof(n1));
+        p0 = np0;
+        p1 = np1;
+        err = newErr;
+        std::memcpy (idx, newIdx, 16);
+    }
+
+    // the high bit of the anchor index (pixel 0) is implicitly zero, so we
+    // may have to swap the endpoints
+    if (idx[0] & 8) {
+        std::swap (q0, q1);
+        std::swap (p0, p1);
+        for (int i = 0;  i < 16;  ++i) {
+            idx[i] = 15 - idx[i];
+        }
+    }
+
+    BitWriter bits(out);
+    bits.put (1 << 6, 7);
+    for (int c = 0;  c < 4;  ++c) {
+        bits.put (q0[c], 7);
+        bits.put (q1[c], 7);
+    }
+    bits.put (p0, 1);
+    bits.put (p1, 1);
+    bits.put (idx[0], 3);
+    for (int i = 1;  i < 16;  ++i) {
+        bits.put (idx[i], 4);
+    }
+
+}
+
+// encode the rows of blocks [row0, row1) of an image
+static void encodeRows (
+    BlockFormat fmt, Image2D const *img,
+    uint32_t row0, uint32_t row1,
+    uint8_t *dst)
+{
+    const bool hasAlpha = (img->channels() == Channels::RGBA)
+        || (img->channels() == Channels::BGRA);
+    const size_t blkSz = (fmt == BlockFormat::BC1) ? 8 : 16;
+    Block blk;
+    for (uint32_t by = row0;  by < row1;  ++by) {
+        for (uint32_t bx = 0;  bx < img->width();  bx += 4) {
+            loadBlock (img, bx, 4*by, blk);
+            switch (fmt) {
+            case BlockFormat::BC1:
+                {
+                    bool transparent = false;
+                    for (int i = 0;  hasAlpha && (i < 16);  ++i) {
+                        transparent = transparent || (blk.ch[3][i] < 128.0f);
+                    }
+                    encodeBC1 (blk, transparent, dst);
+                }
+                break;
+            case BlockFormat::BC3:
+                encodeBC4 (blk, 3, dst);
+                encodeBC1 (blk, false, dst + 8);
+                break;
+            case BlockFormat::BC5:
+                encodeBC4 (blk, 0, dst);
+                encodeBC4 (blk, 1, dst + 8);
+                break;
+            case BlockFormat::BC7:
+                encodeBC7 (blk, dst);
+                break;
+            }
+            dst += blkSz;
+        }
+    }
+}
+
+} // namespace __detail
+
+CompressedImage2D::CompressedImage2D (
+    BlockFormat fmt,
+    std::vector<Image2D const *> const &levels,
+    JobSystem *jobs)
+  : _blkFmt(fmt), _sRGB(false), _wid(0), _ht(0)
+{
+    if (levels.empty()) {
+        ERROR("no levels for compressed image");
+    }
+    this->_wid = levels[0]->width();
+    this->_ht = levels[0]->height();
+    this->_sRGB = (fmt != BlockFormat::BC5) && levels[0]->isSRGB();
+
+    // check the levels and allocate the storage
+    std::vector<size_t> offsets;
+    size_t nBytes = 0;
+    for (uint32_t lvl = 0;  lvl < levels.size();  ++lvl) {
+        Image2D const *img = levels[lvl];
+        if ((img->width() != this->levelWidth(lvl))
+        || (img->height() != this->levelHeight(lvl))) {
+            ERROR("invalid mipmap level for compressed image");
+        }
+        if ((img->type() != ChannelTy::U8) || (img->channels() == Channels::UNKNOWN)) {
+            ERROR("block compression requires 8-bit channels");
+        }
+        offsets.push_back (nBytes);
+        nBytes += this->levelSize(lvl);
+    }
+    this->_storage.resize (nBytes);
+    for (auto offset : offsets) {
+        this->_levels.push_back (this->_storage.data() + offset);
+    }
+
+    // encode the levels in chunks of rows of blocks
+    std::vector<Job *> pending;
+    for (uint32_t lvl = 0;  lvl < levels.size();  ++lvl) {
+        uint32_t nRows = (this->levelHeight(lvl) + 3) / 4;
+        size_t rowSz = this->levelSize(lvl) / nRows;
+        for (uint32_t row = 0;  row < nRows;  row += __detail::kRowsPerJob) {
+            uint32_t endRow = std::min(row + __detail::kRowsPerJob, nRows);
+            uint8_t *dst = this->_storage.data() + offsets[lvl] + row * rowSz;
+            Image2D const *img = levels[lvl];
+            auto encode = [fmt, img, row, endRow, dst] () {
+                __detail::encodeRows (fmt, img, row, endRow, dst);
+            };
+            if (jobs != nullptr) {
+                pending.push_back (jobs->spawn (encode));
+            } else {
+                encode ();
+            }
+        }
+    }
+    for (auto job : pending) {
+        jobs->wait (job);
+    }
+
+}
+
+} /* namespace cs237 */
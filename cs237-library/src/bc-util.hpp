@@ -0,0 +1,92 @@
+/*! \file bc-util.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Internal helpers shared by the block-compression code (compressed-image.cpp
+ * and bc-encode.cpp).
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _BC_UTIL_HPP_
+#define _BC_UTIL_HPP_
+
+#include "cs237/cs237.hpp"
+
+namespace cs237 {
+namespace __detail {
+
+// the interpolation weights (out of 64) for BC7 indices of 2, 3, and 4 bits
+constexpr uint8_t kBC7Weights2[4] = { 0, 21, 43, 64 };
+constexpr uint8_t kBC7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+constexpr uint8_t kBC7Weights4[16] = {
+        0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+    };
+
+// interpolate between two BC7 endpoint values
+inline uint8_t bc7Interp (uint32_t e0, uint32_t e1, uint32_t w)
+{
+    return uint8_t(((64 - w) * e0 + w * e1 + 32) >> 6);
+}
+
+// expand a 5-6-5 packed color to 8-bit RGB
+inline void unpack565 (uint16_t c, uint8_t rgb[3])
+{
+    uint32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = uint8_t((r << 3) | (r >> 2));
+    rgb[1] = uint8_t((g << 2) | (g >> 4));
+    rgb[2] = uint8_t((b << 3) | (b >> 2));
+}
+
+// compute the palette of a BC1 color block, where the interpolated colors are
+// rounded to the nearest value.  When `fourColor` is false and c0 <= c1, the
+// block uses three colors plus transparent black; the color part of a BC3 block
+// always uses four colors.
+inline void bc1Palette (uint16_t c0, uint16_t c1, bool fourColor, uint8_t pal[4][4])
+{
+    unpack565 (c0, pal[0]);
+    unpack565 (c1, pal[1]);
+    pal[0][3] = pal[1][3] = 255;
+    if (fourColor || (c0 > c1)) {
+        for (int k = 0;  k < 3;  ++k) {
+            pal[2][k] = uint8_t((2 * pal[0][k] + pal[1][k] + 1) / 3);
+            pal[3][k] = uint8_t((pal[0][k] + 2 * pal[1][k] + 1) / 3);
+        }
+        pal[2][3] = pal[3][3] = 255;
+    } else {
+        for (int k = 0;  k < 3;  ++k) {
+            pal[2][k] = uint8_t((pal[0][k] + pal[1][k] + 1) / 2);
+            pal[3][k] = 0;
+        }
+        pal[2][3] = 255;
+        pal[3][3] = 0;
+    }
+}
+
+// compute the palette of a BC4 block (the alpha part of BC3 and the channels of BC5)
+inline void bc4Palette (uint8_t a0, uint8_t a1, uint8_t pal[8])
+{
+    pal[0] = a0;
+    pal[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1;  i < 7;  ++i) {
+            pal[i+1] = uint8_t(((7 - i) * a0 + i * a1 + 3) / 7);
+        }
+    } else {
+        for (int i = 1;  i < 5;  ++i) {
+            pal[i+1] = uint8_t(((5 - i) * a0 + i * a1 + 2) / 5);
+        }
+        pal[6] = 0;
+        pal[7] = 255;
+    }
+}
+
+} // namespace __detail
+} // namespace cs237
+
+#endif // !_BC_UTIL_HPP_
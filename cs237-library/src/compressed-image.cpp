@@ -0,0 +1,716 @@
+/*! \file compressed-image.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Loading, decoding, and writing of block-compressed images.  The encoder is
+ * in bc-encode.cpp.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "bc-util.hpp"
+#include <cstring>
+#include <fstream>
+
+namespace cs237 {
+
+/***** DDS and KTX2 file formats *****/
+
+namespace __detail {
+
+// make a "four-character code" for a DDS file
+constexpr uint32_t fourCC (char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8)
+        | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
+
+// the magic number at the start of a DDS file
+constexpr uint32_t kDDSMagic = fourCC('D', 'D', 'S', ' ');
+
+// DDS flags that we use
+constexpr uint32_t kDDSDCaps = 0x1;
+constexpr uint32_t kDDSDHeight = 0x2;
+constexpr uint32_t kDDSDWidth = 0x4;
+constexpr uint32_t kDDSDPixelFormat = 0x1000;
+constexpr uint32_t kDDSDMipMapCount = 0x20000;
+constexpr uint32_t kDDSDLinearSize = 0x80000;
+constexpr uint32_t kDDPFFourCC = 0x4;
+constexpr uint32_t kDDSCapsComplex = 0x8;
+constexpr uint32_t kDDSCapsTexture = 0x1000;
+constexpr uint32_t kDDSCapsMipMap = 0x400000;
+constexpr uint32_t kDDSCaps2CubeMap = 0x200;
+constexpr uint32_t kDDSCaps2Volume = 0x200000;
+constexpr uint32_t kD3D10Texture2D = 3;
+
+// the DXGI formats that we support
+constexpr uint32_t kDXGIBC1 = 71;
+constexpr uint32_t kDXGIBC1SRGB = 72;
+constexpr uint32_t kDXGIBC3 = 77;
+constexpr uint32_t kDXGIBC3SRGB = 78;
+constexpr uint32_t kDXGIBC5 = 83;
+constexpr uint32_t kDXGIBC7 = 98;
+constexpr uint32_t kDXGIBC7SRGB = 99;
+
+struct DDSPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rMask, gMask, bMask, aMask;
+};
+
+struct DDSHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat ddspf;
+    uint32_t caps, caps2, caps3, caps4;
+    uint32_t reserved2;
+};
+
+struct DDSHeaderDX10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+// the identifier at the start of a KTX2 file
+constexpr uint8_t kKTX2Id[12] = {
+        0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+    };
+
+struct KTX2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct KTX2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// the maximum number of levels in an image
+constexpr uint32_t kMaxLevels = 32;
+
+/***** decoding *****/
+
+// a simple reader for the bit fields of a 128-bit block; fields are stored
+// least-significant bit first
+class BitReader {
+  public:
+    explicit BitReader (const uint8_t *blk) : _blk(blk), _pos(0) { }
+
+    uint32_t get (uint32_t nBits)
+    {
+        uint32_t v = 0;
+        for (uint32_t i = 0;  i < nBits;  ++i, ++this->_pos) {
+            v |= uint32_t((this->_blk[this->_pos >> 3] >> (this->_pos & 7)) & 1) << i;
+        }
+        return v;
+    }
+
+  private:
+    const uint8_t *_blk;
+    uint32_t _pos;
+};
+
+// decode a BC1 block (or the color part of a BC3 block) to RGBA
+static void decodeBC1 (const uint8_t *blk, bool fourColor, uint8_t out[16][4])
+{
+    uint16_t c0 = uint16_t(blk[0] | (blk[1] << 8));
+    uint16_t c1 = uint16_t(blk[2] | (blk[3] << 8));
+    uint8_t pal[4][4];
+    bc1Palette (c0, c1, fourColor, pal);
+    uint32_t bits = uint32_t(blk[4]) | (uint32_t(blk[5]) << 8)
+        | (uint32_t(blk[6]) << 16) | (uint32_t(blk[7]) << 24);
+    for (int i = 0;  i < 16;  ++i) {
+        std::memcpy (out[i], pal[(bits >> (2*i)) & 3], 4);
+    }
+}
+
+// decode a BC4 block into channel `ch` of the output pixels
+static void decodeBC4 (const uint8_t *blk, int ch, uint8_t out[16][4])
+{
+    uint8_t pal[8];
+    bc4Palette (blk[0], blk[1], pal);
+    uint64_t bits = 0;
+    for (int i = 0;  i < 6;  ++i) {
+        bits |= uint64_t(blk[2+i]) << (8*i);
+    }
+    for (int i = 0;  i < 16;  ++i) {
+        out[i][ch] = pal[(bits >> (3*i)) & 7];
+    }
+}
+
+// the BC7 partitions for two subsets; bit i is set when pixel i is in subset 1
+static const uint16_t kBC7Partitions2[64] = {
+        0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+        0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+        0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+        0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+        0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+        0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+        0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+        0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+    };
+
+// the BC7 partitions for three subsets
+static const uint8_t kBC7Partitions3[64][16] = {
+        {0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2}, {0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1},
+        {0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1}, {0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1},
+        {0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2}, {0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2},
+        {0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1}, {0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1},
+        {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2}, {0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2},
+        {0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2}, {0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2},
+        {0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2}, {0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2},
+        {0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2}, {0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0},
+        {0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2}, {0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0},
+        {0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2}, {0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1},
+        {0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2}, {0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1},
+        {0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2}, {0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0},
+        {0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0}, {0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2},
+        {0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0}, {0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1},
+        {0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2}, {0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2},
+        {0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1}, {0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1},
+        {0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2}, {0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1},
+        {0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2}, {0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0},
+        {0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0}, {0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0},
+        {0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0}, {0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1},
+        {0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1}, {0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2},
+        {0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1}, {0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2},
+        {0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1}, {0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1},
+        {0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1}, {0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1},
+        {0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2}, {0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1},
+        {0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2}, {0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2},
+        {0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2}, {0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2},
+        {0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2}, {0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2},
+        {0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2}, {0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2},
+        {0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2}, {0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2},
+        {0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1}, {0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2},
+        {0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2}, {0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0}
+    };
+
+// the anchor pixel of subset 1 for the two-subset partitions
+static const uint8_t kBC7Anchors2[64] = {
+        15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15,
+        15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+        15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,
+         6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15
+    };
+
+// the anchor pixels of subsets 1 and 2 for the three-subset partitions
+static const uint8_t kBC7Anchors3a[64] = {
+         3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,
+         3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+         8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,
+         3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3
+    };
+static const uint8_t kBC7Anchors3b[64] = {
+        15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8,
+        15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+        15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8,
+        15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8
+    };
+
+// the properties of the eight BC7 modes
+struct BC7Mode {
+    uint8_t nSubsets;           // number of subsets
+    uint8_t partBits;           // number of partition bits
+    uint8_t rotBits;            // number of rotation bits
+    uint8_t selBits;            // number of index-selection bits
+    uint8_t colorBits;          // number of bits per color component
+    uint8_t alphaBits;          // number of bits per alpha component
+    uint8_t epBits;             // true if there is one P-bit per endpoint
+    uint8_t spBits;             // true if there is one P-bit per subset
+    uint8_t idxBits;            // number of bits per primary index
+    uint8_t idxBits2;           // number of bits per secondary index
+};
+
+static const BC7Mode kBC7Modes[8] = {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+    };
+
+// get the interpolation weights for an index size
+static const uint8_t *bc7Weights (uint32_t nBits)
+{
+    return (nBits == 2) ? kBC7Weights2 : (nBits == 3) ? kBC7Weights3 : kBC7Weights4;
+}
+
+// decode a BC7 block to RGBA
+static void decodeBC7 (const uint8_t *blk, uint8_t out[16][4])
+{
+    // the mode is the number of zero bits before the first one bit
+    uint32_t mode = 0;
+    while ((mode < 8) && !(blk[0] & (1 << mode))) {
+        mode++;
+    }
+    if (mode == 8) {
+        // reserved mode, which decodes to transparent black
+        std::memset (out, 0, 64);
+        return;
+    }
+    BC7Mode const &m = kBC7Modes[mode];
+    BitReader bits(blk);
+    bits.get (mode + 1);
+
+    uint32_t part = bits.get (m.partBits);
+    uint32_t rot = bits.get (m.rotBits);
+    uint32_t sel = bits.get (m.selBits);
+
+    // the endpoints; ep[2*s+i] is endpoint i of subset s
+    uint32_t nEndpoints = 2 * m.nSubsets;
+    uint32_t ep[6][4];
+    for (uint32_t c = 0;  c < 3;  ++c) {
+        for (uint32_t e = 0;  e < nEndpoints;  ++e) {
+            ep[e][c] = bits.get (m.colorBits);
+        }
+    }
+    for (uint32_t e = 0;  e < nEndpoints;  ++e) {
+        ep[e][3] = (m.alphaBits > 0) ? bits.get (m.alphaBits) : 255;
+    }
+
+    // add the P-bits and expand the endpoints to 8 bits
+    uint32_t cBits = m.colorBits, aBits = m.alphaBits;
+    if (m.epBits || m.spBits) {
+        uint32_t pBits[6];
+        if (m.epBits) {
+            for (uint32_t e = 0;  e < nEndpoints;  ++e) {
+                pBits[e] = bits.get (1);
+            }
+        } else {
+            for (uint32_t s = 0;  s < m.nSubsets;  ++s) {
+                pBits[2*s] = pBits[2*s+1] = bits.get (1);
+            }
+        }
+        for (uint32_t e = 0;  e < nEndpoints;  ++e) {
+            for (uint32_t c = 0;  c < 4;  ++c) {
+                if ((c < 3) || (aBits > 0)) {
+                    ep[e][c] = (ep[e][c] << 1) | pBits[e];
+                }
+            }
+        }
+        cBits++;
+        if (aBits > 0) {
+            aBits++;
+        }
+    }
+    for (uint32_t e = 0;  e < nEndpoints;  ++e) {
+        for (uint32_t c = 0;  c < 4;  ++c) {
+            uint32_t nb = (c < 3) ? cBits : aBits;
+            if ((nb > 0) && (nb < 8)) {
+                ep[e][c] = (ep[e][c] << (8 - nb)) | (ep[e][c] >> (2*nb - 8));
+            }
+        }
+    }
+
+    // the subset of each pixel and the anchor pixels of the subsets
+    uint8_t subset[16];
+    uint32_t anchors[3] = { 0, 0, 0 };
+    for (int i = 0;  i < 16;  ++i) {
+        if (m.nSubsets == 2) {
+            subset[i] = (kBC7Partitions2[part] >> i) & 1;
+        } else if (m.nSubsets == 3) {
+            subset[i] = kBC7Partitions3[part][i];
+        } else {
+            subset[i] = 0;
+        }
+    }
+    if (m.nSubsets == 2) {
+        anchors[1] = kBC7Anchors2[part];
+    } else if (m.nSubsets == 3) {
+        anchors[1] = kBC7Anchors3a[part];
+        anchors[2] = kBC7Anchors3b[part];
+    }
+
+    // the indices; the anchor index of each subset has an implicit high bit of zero
+    uint8_t idx[16], idx2[16];
+    for (int i = 0;  i < 16;  ++i) {
+        bool anchor = (i == 0) || (i == int(anchors[1]) && m.nSubsets > 1)
+            || (i == int(anchors[2]) && m.nSubsets > 2);
+        idx[i] = uint8_t(bits.get (anchor ? m.idxBits - 1 : m.idxBits));
+    }
+    if (m.idxBits2 > 0) {
+        for (int i = 0;  i < 16;  ++i) {
+            idx2[i] = uint8_t(bits.get ((i == 0) ? m.idxBits2 - 1 : m.idxBits2));
+        }
+    }
+
+    // interpolate the pixels
+    const uint8_t *cWts = bc7Weights(m.idxBits);
+    const uint8_t *aWts = cWts;
+    const uint8_t *cIdx = idx, *aIdx = idx;
+    if (m.idxBits2 > 0) {
+        aWts = bc7Weights(m.idxBits2);
+        aIdx = idx2;
+        if (sel) {
+            std::swap (cWts, aWts);
+            std::swap (cIdx, aIdx);
+        }
+    }
+    for (int i = 0;  i < 16;  ++i) {
+        uint32_t const *e0 = ep[2*subset[i]];
+        uint32_t const *e1 = ep[2*subset[i]+1];
+        for (int c = 0;  c < 3;  ++c) {
+            out[i][c] = bc7Interp (e0[c], e1[c], cWts[cIdx[i]]);
+        }
+        out[i][3] = bc7Interp (e0[3], e1[3], aWts[aIdx[i]]);
+        if (rot > 0) {
+            std::swap (out[i][rot-1], out[i][3]);
+        }
+    }
+
+}
+
+} // namespace __detail
+
+/***** class CompressedImage2D member functions *****/
+
+CompressedImage2D::CompressedImage2D (std::string const &file)
+{
+    std::ifstream inS(file, std::ifstream::in | std::ifstream::binary);
+    if (inS.fail()) {
+        ERROR("unable to open compressed image \"" + file + "\"");
+    }
+    this->_storage.assign (
+        std::istreambuf_iterator<char>(inS),
+        std::istreambuf_iterator<char>());
+    this->_parse (this->_storage.data(), this->_storage.size(), file);
+
+}
+
+CompressedImage2D::CompressedImage2D (const void *data, size_t sz, std::string const &name)
+{
+    this->_parse (static_cast<const uint8_t *>(data), sz, name);
+
+}
+
+void CompressedImage2D::_parse (const uint8_t *data, size_t sz, std::string const &name)
+{
+    bool ok;
+    if ((sz >= sizeof(__detail::kKTX2Id))
+    && (std::memcmp(data, __detail::kKTX2Id, sizeof(__detail::kKTX2Id)) == 0)) {
+        ok = this->_parseKTX2 (data, sz);
+    } else {
+        ok = this->_parseDDS (data, sz);
+    }
+    if (! ok) {
+        ERROR("invalid or unsupported compressed image \"" + name + "\"");
+    }
+
+}
+
+bool CompressedImage2D::_parseDDS (const uint8_t *data, size_t sz)
+{
+    using namespace __detail;
+
+    uint32_t magic;
+    DDSHeader hdr;
+    if (sz < sizeof(magic) + sizeof(hdr)) {
+        return false;
+    }
+    std::memcpy (&magic, data, sizeof(magic));
+    std::memcpy (&hdr, data + sizeof(magic), sizeof(hdr));
+    if ((magic != kDDSMagic) || (hdr.size != sizeof(DDSHeader))
+    || !(hdr.ddspf.flags & kDDPFFourCC)
+    || (hdr.caps2 & (kDDSCaps2CubeMap | kDDSCaps2Volume))) {
+        return false;
+    }
+    size_t offset = sizeof(magic) + sizeof(hdr);
+
+    this->_sRGB = false;
+    switch (hdr.ddspf.fourCC) {
+    case fourCC('D', 'X', 'T', '1'): this->_blkFmt = BlockFormat::BC1; break;
+    case fourCC('D', 'X', 'T', '5'): this->_blkFmt = BlockFormat::BC3; break;
+    case fourCC('A', 'T', 'I', '2'):
+    case fourCC('B', 'C', '5', 'U'): this->_blkFmt = BlockFormat::BC5; break;
+    case fourCC('D', 'X', '1', '0'):
+        {
+            DDSHeaderDX10 dx10;
+            if (sz < offset + sizeof(dx10)) {
+                return false;
+            }
+            std::memcpy (&dx10, data + offset, sizeof(dx10));
+            offset += sizeof(dx10);
+            if ((dx10.resourceDimension != kD3D10Texture2D) || (dx10.arraySize > 1)) {
+                return false;
+            }
+            switch (dx10.dxgiFormat) {
+            case kDXGIBC1SRGB: this->_sRGB = true; [[fallthrough]];
+            case kDXGIBC1: this->_blkFmt = BlockFormat::BC1; break;
+            case kDXGIBC3SRGB: this->_sRGB = true; [[fallthrough]];
+            case kDXGIBC3: this->_blkFmt = BlockFormat::BC3; break;
+            case kDXGIBC5: this->_blkFmt = BlockFormat::BC5; break;
+            case kDXGIBC7SRGB: this->_sRGB = true; [[fallthrough]];
+            case kDXGIBC7: this->_blkFmt = BlockFormat::BC7; break;
+            default: return false;
+            }
+        }
+        break;
+    default:
+        return false;
+    }
+
+    this->_wid = hdr.width;
+    this->_ht = hdr.height;
+    uint32_t nLevels = (hdr.flags & kDDSDMipMapCount) ? std::max(hdr.mipMapCount, 1u) : 1;
+    if ((this->_wid == 0) || (this->_ht == 0) || (nLevels > kMaxLevels)) {
+        return false;
+    }
+
+    // the levels follow the headers with no padding
+    for (uint32_t lvl = 0;  lvl < nLevels;  ++lvl) {
+        size_t lvlSz = this->levelSize(lvl);
+        if (lvlSz > sz - offset) {
+            return false;
+        }
+        this->_levels.push_back (data + offset);
+        offset += lvlSz;
+    }
+
+    return true;
+
+}
+
+bool CompressedImage2D::_parseKTX2 (const uint8_t *data, size_t sz)
+{
+    using namespace __detail;
+
+    KTX2Header hdr;
+    if (sz < sizeof(hdr)) {
+        return false;
+    }
+    std::memcpy (&hdr, data, sizeof(hdr));
+    // we only support single 2D images without supercompression
+    if ((hdr.pixelDepth > 0) || (hdr.layerCount > 1) || (hdr.faceCount != 1)
+    || (hdr.supercompressionScheme != 0)) {
+        return false;
+    }
+
+    this->_sRGB = false;
+    switch (static_cast<vk::Format>(hdr.vkFormat)) {
+    case vk::Format::eBc1RgbSrgbBlock:
+    case vk::Format::eBc1RgbaSrgbBlock: this->_sRGB = true; [[fallthrough]];
+    case vk::Format::eBc1RgbUnormBlock:
+    case vk::Format::eBc1RgbaUnormBlock: this->_blkFmt = BlockFormat::BC1; break;
+    case vk::Format::eBc3SrgbBlock: this->_sRGB = true; [[fallthrough]];
+    case vk::Format::eBc3UnormBlock: this->_blkFmt = BlockFormat::BC3; break;
+    case vk::Format::eBc5UnormBlock: this->_blkFmt = BlockFormat::BC5; break;
+    case vk::Format::eBc7SrgbBlock: this->_sRGB = true; [[fallthrough]];
+    case vk::Format::eBc7UnormBlock: this->_blkFmt = BlockFormat::BC7; break;
+    default: return false;
+    }
+
+    this->_wid = hdr.pixelWidth;
+    this->_ht = hdr.pixelHeight;
+    // a level count of zero means that the loader should generate the mipmaps,
+    // which we do not do for compressed images
+    uint32_t nLevels = std::max(hdr.levelCount, 1u);
+    if ((this->_wid == 0) || (this->_ht == 0) || (nLevels > kMaxLevels)
+    || (nLevels * sizeof(KTX2Level) > sz - sizeof(hdr))) {
+        return false;
+    }
+
+    // the level index comes right after the header
+    for (uint32_t lvl = 0;  lvl < nLevels;  ++lvl) {
+        KTX2Level index;
+        std::memcpy (&index, data + sizeof(hdr) + lvl * sizeof(KTX2Level), sizeof(index));
+        if ((index.byteLength != this->levelSize(lvl))
+        || (index.byteOffset > sz) || (index.byteLength > sz - index.byteOffset)) {
+            return false;
+        }
+        this->_levels.push_back (data + index.byteOffset);
+    }
+
+    return true;
+
+}
+
+vk::Format CompressedImage2D::format () const
+{
+    switch (this->_blkFmt) {
+    case BlockFormat::BC1:
+        return this->_sRGB ? vk::Format::eBc1RgbaSrgbBlock : vk::Format::eBc1RgbaUnormBlock;
+    case BlockFormat::BC3:
+        return this->_sRGB ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+    case BlockFormat::BC5:
+        return vk::Format::eBc5UnormBlock;
+    case BlockFormat::BC7:
+        return this->_sRGB ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+    }
+    ERROR("unknown block format");
+
+}
+
+size_t CompressedImage2D::levelSize (uint32_t lvl) const
+{
+    size_t nBlksX = (this->levelWidth(lvl) + 3) / 4;
+    size_t nBlksY = (this->levelHeight(lvl) + 3) / 4;
+    return nBlksX * nBlksY * this->blockSize();
+
+}
+
+size_t CompressedImage2D::nBytes () const
+{
+    size_t n = 0;
+    for (uint32_t lvl = 0;  lvl < this->nLevels();  ++lvl) {
+        n += this->levelSize(lvl);
+    }
+    return n;
+
+}
+
+Image2D *CompressedImage2D::decode (uint32_t lvl) const
+{
+    uint32_t wid = this->levelWidth(lvl);
+    uint32_t ht = this->levelHeight(lvl);
+    uint32_t nChans = (this->_blkFmt == BlockFormat::BC5) ? 2 : 4;
+    Image2D *img = new Image2D(
+        wid, ht,
+        (nChans == 2) ? Channels::RG : Channels::RGBA,
+        ChannelTy::U8,
+        this->_sRGB);
+
+    const uint8_t *blk = this->_levels[lvl];
+    uint8_t *dst = static_cast<uint8_t *>(img->data());
+    uint8_t pixels[16][4];
+    for (uint32_t by = 0;  by < ht;  by += 4) {
+        for (uint32_t bx = 0;  bx < wid;  bx += 4) {
+            switch (this->_blkFmt) {
+            case BlockFormat::BC1:
+                __detail::decodeBC1 (blk, false, pixels);
+                break;
+            case BlockFormat::BC3:
+                __detail::decodeBC1 (blk + 8, true, pixels);
+                __detail::decodeBC4 (blk, 3, pixels);
+                break;
+            case BlockFormat::BC5:
+                __detail::decodeBC4 (blk, 0, pixels);
+                __detail::decodeBC4 (blk + 8, 1, pixels);
+                break;
+            case BlockFormat::BC7:
+                __detail::decodeBC7 (blk, pixels);
+                break;
+            }
+            blk += this->blockSize();
+            // copy the pixels that are inside the image
+            for (uint32_t y = 0;  (y < 4) && (by + y < ht);  ++y) {
+                for (uint32_t x = 0;  (x < 4) && (bx + x < wid);  ++x) {
+                    std::memcpy (
+                        dst + ((by + y) * wid + bx + x) * nChans,
+                        pixels[4*y + x],
+                        nChans);
+                }
+            }
+        }
+    }
+
+    return img;
+
+}
+
+bool CompressedImage2D::write (std::string const &file) const
+{
+    std::ofstream outS(file, std::ofstream::out | std::ofstream::binary);
+    if (outS.fail()) {
+#ifndef NDEBUG
+        std::cerr << "CompressedImage2D::write: unable to open \"" << file << "\"" << std::endl;
+#endif
+        return false;
+    }
+    bool sts = this->write (outS);
+    outS.close();
+    return sts && !outS.fail();
+
+}
+
+bool CompressedImage2D::write (std::ostream &outS) const
+{
+    using namespace __detail;
+
+    // we always use the DX10 extension header, since it is the only way to
+    // record BC7 and sRGB formats
+    uint32_t magic = kDDSMagic;
+    DDSHeader hdr{};
+    hdr.size = sizeof(DDSHeader);
+    hdr.flags = kDDSDCaps | kDDSDHeight | kDDSDWidth | kDDSDPixelFormat
+        | kDDSDMipMapCount | kDDSDLinearSize;
+    hdr.height = this->_ht;
+    hdr.width = this->_wid;
+    hdr.pitchOrLinearSize = this->levelSize(0);
+    hdr.mipMapCount = this->nLevels();
+    hdr.ddspf.size = sizeof(DDSPixelFormat);
+    hdr.ddspf.flags = kDDPFFourCC;
+    hdr.ddspf.fourCC = fourCC('D', 'X', '1', '0');
+    hdr.caps = kDDSCapsTexture;
+    if (this->nLevels() > 1) {
+        hdr.caps |= kDDSCapsComplex | kDDSCapsMipMap;
+    }
+
+    DDSHeaderDX10 dx10{};
+    switch (this->_blkFmt) {
+    case BlockFormat::BC1: dx10.dxgiFormat = this->_sRGB ? kDXGIBC1SRGB : kDXGIBC1; break;
+    case BlockFormat::BC3: dx10.dxgiFormat = this->_sRGB ? kDXGIBC3SRGB : kDXGIBC3; break;
+    case BlockFormat::BC5: dx10.dxgiFormat = kDXGIBC5; break;
+    case BlockFormat::BC7: dx10.dxgiFormat = this->_sRGB ? kDXGIBC7SRGB : kDXGIBC7; break;
+    }
+    dx10.resourceDimension = kD3D10Texture2D;
+    dx10.arraySize = 1;
+
+    outS.write (reinterpret_cast<const char *>(&magic), sizeof(magic));
+    outS.write (reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    outS.write (reinterpret_cast<const char *>(&dx10), sizeof(dx10));
+    for (uint32_t lvl = 0;  lvl < this->nLevels();  ++lvl) {
+        outS.write (reinterpret_cast<const char *>(this->_levels[lvl]), this->levelSize(lvl));
+    }
+
+    return !outS.fail();
+
+}
+
+std::string to_string (BlockFormat fmt)
+{
+    switch (fmt) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC5: return "BC5";
+    case BlockFormat::BC7: return "BC7";
+    }
+}
+
+} /* namespace cs237 */
@@ -13,6 +13,7 @@
  */
 
 #include "cs237/cs237.hpp"
+#include "pixel-convert.hpp"
 #include "png.h"
 #include <fstream>
 
@@ -480,16 +481,24 @@ vk::Format toVkFormat (Channels chans, ChannelTy ty, bool isRGB)
 
 /***** virtual base class __detail::ImageBase member functions *****/
 
-ImageBase::ImageBase (uint32_t nd, Channels chans, ChannelTy ty, size_t npixels)
-  : _nDims(nd), _chans(chans), _type(ty),
-    _nBytes(numChannels(chans) * npixels * sizeOfType(ty))
+ImageBase::ImageBase (uint32_t nd, Channels chans, ChannelTy ty, bool sRGB, size_t npixels)
+  : _nDims(nd), _chans(chans), _type(ty), _sRGB(sRGB),
+    _nBytes(numChannels(chans) * npixels * sizeOfType(ty)), _ownsData(true)
 {
     this->_data = std::malloc(this->_nBytes);
 }
 
+ImageBase::ImageBase (
+    uint32_t nd, Channels chans, ChannelTy ty, bool sRGB, size_t npixels,
+    void *data)
+  : _nDims(nd), _chans(chans), _type(ty), _sRGB(sRGB),
+    _nBytes(numChannels(chans) * npixels * sizeOfType(ty)), _data(data),
+    _ownsData(false)
+{ }
+
 ImageBase::~ImageBase ()
 {
-    if (this->_data != nullptr) {
+    if ((this->_data != nullptr) && this->_ownsData) {
         std::free(this->_data);
     }
 }
@@ -501,59 +510,36 @@ unsigned int ImageBase::nChannels () const
 
 size_t ImageBase::nBytesPerPixel () const
 {
-    return sizeOfType (this->_type);
+    return numChannels (this->_chans) * sizeOfType (this->_type);
 }
 
 void ImageBase::addAlphaChannel ()
 {
+    Channels chans;
     if (this->_chans == Channels::RGB) {
-        this->_chans = Channels::RGBA;
+        chans = Channels::RGBA;
     }
-    else if (this->_chans != Channels::BGR) {
-        this->_chans = Channels::BGRA;
+    else if (this->_chans == Channels::BGR) {
+        chans = Channels::BGRA;
     }
     else {
         return;
     }
 
-    switch (this->_type) {
-    case ChannelTy::U8: {
-            uint32_t nPixels = this->_nBytes / 3;
-            uint8_t *newImg = (uint8_t *) std::malloc (4 * nPixels);
-            uint8_t *dstP = newImg;
-            uint8_t *srcP = reinterpret_cast<uint8_t *>(this->_data);
-            for (int i = 0;  i < nPixels;  ++i) {
-                dstP[0] = srcP[0];
-                dstP[1] = srcP[1];
-                dstP[2] = srcP[2];
-                dstP[3] = 0xff;
-                dstP += 4;
-                srcP += 3;
-            }
-            std::free(this->_data);
-            this->_data = newImg;
-            this->_nBytes = 4 * nPixels;
-        } break;
-    case ChannelTy::U16: {
-            uint32_t nPixels = this->_nBytes / 6;
-            uint16_t *newImg = (uint16_t *) std::malloc (8 * nPixels);
-            uint16_t *dstP = newImg;
-            uint16_t *srcP = reinterpret_cast<uint16_t *>(this->_data);
-            for (int i = 0;  i < nPixels;  ++i) {
-                dstP[0] = srcP[0];
-                dstP[1] = srcP[1];
-                dstP[2] = srcP[2];
-                dstP[3] = 0xffff;
-                dstP += 4;
-                srcP += 3;
-            }
-            std::free(this->_data);
-            this->_data = newImg;
-            this->_nBytes = 8 * nPixels;
-        } break;
-    default:
-        ERROR ("unsupported channel type");
+    size_t nPixels = this->_nBytes / this->nBytesPerPixel();
+    size_t nBytes = nPixels * 4 * sizeOfType(this->_type);
+    void *newImg = std::malloc (nBytes);
+    convertPixels (
+        PixelFormat{this->_chans, this->_type, this->_sRGB}, this->_data,
+        PixelFormat{chans, this->_type, this->_sRGB}, newImg,
+        nPixels);
+    if (this->_ownsData) {
+        std::free(this->_data);
     }
+    this->_chans = chans;
+    this->_data = newImg;
+    this->_ownsData = true;
+    this->_nBytes = nBytes;
 
 }
 
@@ -622,6 +608,16 @@ Image2D::Image2D (uint32_t wid, uint32_t ht, Channels chans, ChannelTy ty)
     : __detail::ImageBase (2, chans, ty, wid * ht), _wid(wid), _ht(ht)
 { }
 
+Image2D::Image2D (uint32_t wid, uint32_t ht, Channels chans, ChannelTy ty, bool sRGB)
+    : __detail::ImageBase (2, chans, ty, sRGB, wid * ht), _wid(wid), _ht(ht)
+{ }
+
+Image2D::Image2D (
+    uint32_t wid, uint32_t ht, Channels chans, ChannelTy ty, bool sRGB,
+    void *data)
+    : __detail::ImageBase (2, chans, ty, sRGB, wid * ht, data), _wid(wid), _ht(ht)
+{ }
+
 Image2D::Image2D (std::string const &file, bool flip)
     : __detail::ImageBase (2)
 {
@@ -727,6 +723,76 @@ void Image2D::bitblt (Image2D const &src, uint32_t row, uint32_t col)
     }
 }
 
+// the number of pixels converted by a single job
+constexpr size_t kConvertPixelsPerJob = 64 * 1024;
+
+// run `fn` on blocks of rows [y, endY); the blocks are run in parallel using
+// the job system when it is available and the image is large enough
+template <typename F>
+static void forEachRowBlock (uint32_t wid, uint32_t ht, JobSystem *jobs, F fn)
+{
+    uint32_t rowsPerJob = std::max(uint32_t(kConvertPixelsPerJob / std::max(wid, 1u)), 1u);
+    if ((jobs == nullptr) || (ht <= rowsPerJob)) {
+        fn (0, ht);
+        return;
+    }
+    std::vector<Job *> pending;
+    for (uint32_t y = 0;  y < ht;  y += rowsPerJob) {
+        uint32_t endY = std::min(y + rowsPerJob, ht);
+        pending.push_back (jobs->spawn ([&fn, y, endY] () { fn (y, endY); }));
+    }
+    for (auto job : pending) {
+        jobs->wait (job);
+    }
+}
+
+// convert the image to a different pixel format
+Image2D *Image2D::convert (Channels chans, ChannelTy ty, bool sRGB, JobSystem *jobs) const
+{
+    __detail::PixelFormat srcFmt{this->_chans, this->_type, this->_sRGB};
+    __detail::PixelFormat dstFmt{chans, ty, sRGB};
+    if (! __detail::canConvertPixels (srcFmt, dstFmt)) {
+        ERROR("Image2D::convert: unsupported conversion from " + to_string(this->_chans)
+            + "/" + to_string(this->_type) + " to " + to_string(chans) + "/" + to_string(ty));
+    }
+
+    Image2D *dst = new Image2D (this->_wid, this->_ht, chans, ty, sRGB);
+    size_t srcStride = this->_wid * this->nBytesPerPixel();
+    size_t dstStride = this->_wid * dst->nBytesPerPixel();
+    const char *srcP = static_cast<const char *>(this->_data);
+    char *dstP = static_cast<char *>(dst->_data);
+    uint32_t wid = this->_wid;
+    forEachRowBlock (this->_wid, this->_ht, jobs,
+        [=] (uint32_t y, uint32_t endY) {
+            __detail::convertPixels (
+                srcFmt, srcP + y * srcStride,
+                dstFmt, dstP + y * dstStride,
+                size_t(endY - y) * wid);
+        });
+
+    return dst;
+}
+
+// flip the image vertically
+void Image2D::flip (JobSystem *jobs)
+{
+    size_t stride = this->_wid * this->nBytesPerPixel();
+    char *data = static_cast<char *>(this->_data);
+    uint32_t ht = this->_ht;
+    // each block swaps rows y..endY-1 of the top half with their mirror images
+    forEachRowBlock (this->_wid, ht / 2, jobs,
+        [=] (uint32_t y, uint32_t endY) {
+            std::vector<char> tmp(stride);
+            for (;  y < endY;  ++y) {
+                char *top = data + size_t(y) * stride;
+                char *bot = data + size_t(ht - 1 - y) * stride;
+                std::memcpy (tmp.data(), top, stride);
+                std::memcpy (top, bot, stride);
+                std::memcpy (bot, tmp.data(), stride);
+            }
+        });
+}
+
 std::string to_string (Channels ch)
 {
     switch (ch) {
@@ -0,0 +1,306 @@
+/*! \file job-system.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+
+namespace cs237 {
+
+// the job system and worker index of the current thread; these are only set
+// for worker threads.
+static thread_local JobSystem *tlJobSys = nullptr;
+static thread_local unsigned int tlWorkerId = 0;
+
+JobSystem::JobSystem (unsigned int nWorkers)
+  : _nextQ(0), _nReady(0), _nUnfinished(0), _shutdown(false)
+{
+    if (nWorkers == 0) {
+        nWorkers = std::thread::hardware_concurrency();
+        if (nWorkers == 0) {
+            nWorkers = 1;
+        }
+    }
+
+    this->_queues.reserve(nWorkers);
+    for (unsigned int i = 0;  i < nWorkers;  ++i) {
+        this->_queues.push_back(new Queue);
+    }
+    this->_workers.reserve(nWorkers);
+    for (unsigned int i = 0;  i < nWorkers;  ++i) {
+        this->_workers.emplace_back(&JobSystem::_workerLoop, this, i);
+    }
+
+}
+
+JobSystem::~JobSystem ()
+{
+    // finish any outstanding work, but do not throw from the destructor
+    try {
+        this->waitAll();
+    } catch (...) { }
+
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+        this->_shutdown = true;
+    }
+    this->_cv.notify_all();
+    for (auto &thd : this->_workers) {
+        thd.join();
+    }
+    for (auto q : this->_queues) {
+        delete q;
+    }
+
+}
+
+Job *JobSystem::spawn (std::function<void()> const &fn, std::vector<Job *> const &deps)
+{
+    Job *job = new Job(fn);
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+        this->_jobs.push_back(job);
+    }
+    this->_nUnfinished.fetch_add(1, std::memory_order_relaxed);
+
+    // register the job with its dependencies; the initial pending count of one
+    // keeps the job from being scheduled until all of them have been processed
+    for (auto dep : deps) {
+        if (dep == nullptr) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lk(dep->_mu);
+        if (! dep->isDone()) {
+            job->_nPending.fetch_add(1, std::memory_order_relaxed);
+            dep->_succs.push_back(job);
+        } else if (dep->failed()) {
+            JobSystem::_fail (job, dep->_exn);
+        }
+    }
+    if (job->_nPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        this->_enqueue(job);
+    }
+
+    return job;
+
+}
+
+void JobSystem::wait (Job *job)
+{
+    unsigned int id = (tlJobSys == this) ? tlWorkerId : 0;
+    while (! job->isDone()) {
+        Job *other = this->_findJob(id);
+        if (other != nullptr) {
+            this->_run(other);
+        } else {
+            std::unique_lock<std::mutex> lk(this->_mu);
+            this->_cv.wait(lk, [this, job] () {
+                return job->isDone() || (this->_nReady.load() > 0);
+            });
+        }
+    }
+
+    // rethrow the job's own failure (not that of some unrelated job)
+    std::exception_ptr exn;
+    {
+        std::lock_guard<std::mutex> lk(job->_mu);
+        exn = job->_exn;
+    }
+    if (exn) {
+        std::rethrow_exception(exn);
+    }
+
+}
+
+void JobSystem::waitAll ()
+{
+    unsigned int id = (tlJobSys == this) ? tlWorkerId : 0;
+    while (this->_nUnfinished.load(std::memory_order_acquire) > 0) {
+        Job *other = this->_findJob(id);
+        if (other != nullptr) {
+            this->_run(other);
+        } else {
+            std::unique_lock<std::mutex> lk(this->_mu);
+            this->_cv.wait(lk, [this] () {
+                return (this->_nUnfinished.load() == 0) || (this->_nReady.load() > 0);
+            });
+        }
+    }
+
+    // reclaim the job objects
+    std::vector<Job *> jobs;
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+        jobs.swap(this->_jobs);
+    }
+    for (auto job : jobs) {
+        delete job;
+    }
+
+    this->_checkError();
+
+}
+
+void JobSystem::_workerLoop (unsigned int id)
+{
+    tlJobSys = this;
+    tlWorkerId = id;
+
+    while (true) {
+        Job *job = this->_findJob(id);
+        if (job != nullptr) {
+            this->_run(job);
+        } else {
+            std::unique_lock<std::mutex> lk(this->_mu);
+            this->_cv.wait(lk, [this] () {
+                return this->_shutdown || (this->_nReady.load() > 0);
+            });
+            if (this->_shutdown) {
+                return;
+            }
+        }
+    }
+
+}
+
+void JobSystem::_enqueue (Job *job)
+{
+    // jobs spawned by a worker go on its own queue; otherwise we distribute
+    // them round-robin
+    unsigned int id;
+    if (tlJobSys == this) {
+        id = tlWorkerId;
+    } else {
+        id = this->_nextQ.fetch_add(1, std::memory_order_relaxed) % this->_queues.size();
+    }
+    {
+        Queue *q = this->_queues[id];
+        std::lock_guard<std::mutex> lk(q->mu);
+        q->jobs.push_back(job);
+    }
+    this->_nReady.fetch_add(1, std::memory_order_release);
+    this->_notify();
+
+}
+
+Job *JobSystem::_findJob (unsigned int id)
+{
+    if (this->_nReady.load(std::memory_order_acquire) <= 0) {
+        return nullptr;
+    }
+
+    // first check our own queue, taking the most recently pushed job
+    {
+        Queue *q = this->_queues[id];
+        std::lock_guard<std::mutex> lk(q->mu);
+        if (! q->jobs.empty()) {
+            Job *job = q->jobs.back();
+            q->jobs.pop_back();
+            this->_nReady.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    // then try to steal the oldest job from some other queue
+    unsigned int n = this->_queues.size();
+    for (unsigned int i = 1;  i < n;  ++i) {
+        Queue *q = this->_queues[(id + i) % n];
+        std::lock_guard<std::mutex> lk(q->mu);
+        if (! q->jobs.empty()) {
+            Job *job = q->jobs.front();
+            q->jobs.pop_front();
+            this->_nReady.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    return nullptr;
+
+}
+
+void JobSystem::_run (Job *job)
+{
+    // a job whose dependency failed is skipped, since its inputs were never
+    // produced; the dependency's exception has already been captured
+    if (! job->failed()) {
+        try {
+            job->_fn();
+        } catch (...) {
+            std::exception_ptr exn = std::current_exception();
+            JobSystem::_fail (job, exn);
+            std::lock_guard<std::mutex> lk(this->_mu);
+            if (! this->_exn) {
+                this->_exn = exn;
+            }
+        }
+    }
+    // release the closure's resources now, since the job object lives on
+    // until the next `waitAll`
+    job->_fn = nullptr;
+
+    // mark the job as done and grab its successors
+    std::exception_ptr exn;
+    std::vector<Job *> succs;
+    {
+        std::lock_guard<std::mutex> lk(job->_mu);
+        job->_done.store(true, std::memory_order_release);
+        succs.swap(job->_succs);
+        exn = job->_exn;
+    }
+    for (auto succ : succs) {
+        if (exn) {
+            JobSystem::_fail (succ, exn);
+        }
+        if (succ->_nPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->_enqueue(succ);
+        }
+    }
+
+    this->_nUnfinished.fetch_sub(1, std::memory_order_acq_rel);
+    this->_notify();
+
+}
+
+void JobSystem::_fail (Job *job, std::exception_ptr const &exn)
+{
+    std::lock_guard<std::mutex> lk(job->_mu);
+    if (! job->_exn) {
+        job->_exn = exn;
+    }
+    job->_failed.store(true, std::memory_order_release);
+
+}
+
+void JobSystem::_notify ()
+{
+    // we acquire the lock so that a thread that has just tested its wait
+    // condition cannot miss the notification
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+    }
+    this->_cv.notify_all();
+
+}
+
+void JobSystem::_checkError ()
+{
+    std::exception_ptr exn;
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+        exn = this->_exn;
+        this->_exn = nullptr;
+    }
+    if (exn) {
+        std::rethrow_exception(exn);
+    }
+
+}
+
+} // namespace cs237
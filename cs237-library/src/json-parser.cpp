@@ -15,485 +15,219 @@
  * All rights reserved.
  */
 
-#include "cs237/config.h"
+#include "cs237/cs237.hpp"
 #include "json.hpp"
-#include <filesystem>
+#include <algorithm>
 #include <iostream>
-#include <fstream>
-#include <cctype>
-#include <locale>
-#ifdef INCLUDE_STRINGS_H
-#include INCLUDE_STRINGS_H
-#endif
-
-#ifndef HAVE_STRNCASECMP
-static int strncasecmp (const char *s1, const char *s2, size_t n)
-{
-    for (int i = 0;  i < n;  ++i) {
-        int c1 = tolower(s1[i]);
-        int c2 = tolower(s2[i]);
-        if ((c1 == 0) || (c2 == 0)) {
-            // if s1 is longer than s2, then c2 == 0, so c1 - c2 > 0, whereas
-            // if s1 is shorter, then c1 == 0, so c1 - c2 < 0.
-            return (c1 - c2);
-        } else if (c1 != c2) {
-            return (c1 - c2);
-        }
-    }
-}
-#endif // !HAVE_STRNCASECMP
+#include <cstring>
 
 namespace json {
 
-// a wrapper class around file input that reads the entire file in one go.
-class Input {
+// The parser builds the nodes of a document from the events produced by a
+// `Reader`.  The members of the object (resp. elements of the array) that is
+// being parsed are accumulated on a scratch stack, which is shared by all of the
+// nested objects (resp. arrays), and are copied into the document's arena once
+// the object is complete.  Thus the only allocation per object or array is a
+// single block in the arena.
+class Parser {
   public:
-    Input (std::string filename);
-    ~Input () { delete this->_buffer; }
-
-    Input const &operator++ (int _unused) {
-        if (this->_buffer[this->_i++] == '\n') this->_lnum++;
-        return *this;
-    }
-    Input const &operator += (int n) { this->_i += n;  return *this; }
-    const char *operator() () const { return &(this->_buffer[this->_i]); }
-    char operator[] (int j) const { return this->_buffer[this->_i + j]; }
-    char operator* () const { return this->_buffer[this->_i]; }
-    int avail () const { return this->_len - this->_i; }
-    bool eof () const { return this->_i >= this->_len; }
+    Parser (Reader &rdr, Document &doc, const char *text, size_t len)
+      : _rdr(rdr), _doc(doc), _text(text), _len(len)
+    { }
 
-    /// get the filename as a std::string
-    std::string filename () const
-    {
-        return this->_path.string();
-    }
+    // parse the value that starts at the reader's current event; returns false
+    // if there is an error
+    bool parse (Node &node);
 
-    void error (std::string msg)
+  private:
+    Reader &_rdr;
+    Document &_doc;
+    const char *_text;                  // the document's text
+    size_t _len;
+    std::vector<Member> _members;       // scratch stack of object members
+    std::vector<Node> _elems;           // scratch stack of array elements
+
+    // return a view of the reader's current string that lives as long as the
+    // document.  Strings without escapes are already views of the document's
+    // text; decoded strings are copied into the arena.
+    std::string_view _intern (std::string_view s)
     {
-        std::cerr << "json::parseFile(" << this->filename() << "): " << msg
-            << " at line " << this->_lnum << std::endl;
-        std::cerr << "    input = \"";
-        int n = this->avail();
-        if (20 < n) n = 20;
-        for (int i = 0;  (i < 20);  i++) {
-            if (isprint(this->_buffer[this->_i+i]))
-                std::cerr << this->_buffer[this->_i+i];
-            else
-                std::cerr << ".";
+        if ((this->_text <= s.data()) && (s.data() + s.size() <= this->_text + this->_len)) {
+            return s;
         }
-        std::cerr << " ...\n" << std::endl;
+        char *p = static_cast<char *>(this->_doc._alloc((s.size() + 7) & ~size_t(7)));
+        std::memcpy (p, s.data(), s.size());
+        return std::string_view(p, s.size());
     }
 
-  private:
-    std::filesystem::path _path;
-    char        *_buffer;
-    int         _i;     // character index
-    int         _lnum;  // current line number
-    int         _len;   // buffer size
-
+    bool _parseObject (Node &node);
+    bool _parseArray (Node &node);
 };
 
-Input::Input (std::string filename)
-  : _path(filename, std::filesystem::path::generic_format),
-    _buffer(nullptr), _i(0), _lnum(0), _len(0)
+bool Parser::parse (Node &node)
 {
-    // figure out the size of the file
-    auto length = std::filesystem::file_size(this->_path);
-
-    // open the json file for reading
-    std::ifstream inS(this->_path.c_str(), std::ios::in);
-    if (inS.fail()) {
-        return;
-    }
-
-    // read length bytes
-    this->_lnum = 1;
-    this->_buffer = new char[length];
-    inS.read (this->_buffer, length);
-
-// it has been reported that inS.fail() is true on Windows even if the read was
-// successful, so we skip the check for now.
-#ifndef CS237_WINDOWS
-    if (inS.fail()) {
-        delete this->_buffer;
-        this->_buffer = 0;
-        return;
+    Reader &rdr = this->_rdr;
+
+    node._n = 0;
+    switch (rdr.event()) {
+    case E_BEGIN_OBJECT:
+        return this->_parseObject (node);
+    case E_BEGIN_ARRAY:
+        return this->_parseArray (node);
+    case E_INTEGER:
+        node._ty = T_INTEGER;
+        node._u.i = rdr.intVal();
+        return true;
+    case E_REAL:
+        node._ty = T_REAL;
+        node._u.r = rdr.realVal();
+        return true;
+    case E_STRING: {
+            std::string_view str = this->_intern (rdr.strVal());
+            node._ty = T_STRING;
+            node._n = static_cast<uint32_t>(str.size());
+            node._u.s = str.data();
+            return true;
+        }
+    case E_BOOL:
+        node._ty = T_BOOL;
+        node._u.b = rdr.boolVal();
+        return true;
+    case E_NULL:
+        node._ty = T_NULL;
+        node._u.i = 0;
+        return true;
+    default:
+        // errors have already been reported by the reader
+        return false;
     }
-#endif
 
-    this->_len = length;
 }
 
-// forward decls
-static bool skipWhitespace (Input &datap);
-static Value *parse (Input &datap);
-
-// parse a json file; this returns nullptr if there is a parsing error
-Value *parseFile (std::string filename)
+bool Parser::_parseObject (Node &node)
 {
-  // open the json file for reading
-    Input datap(filename);
-    if (datap.eof()) {
-        std::cerr << "json::parseFile: unable to read \"" << filename << "\"" << std::endl;
-        return nullptr;
+    Reader &rdr = this->_rdr;
+    size_t base = this->_members.size();
+
+    while (rdr.next() == E_KEY) {
+        Member mem;
+        mem.key = this->_intern (rdr.strVal());
+        rdr.next();
+        if (! this->parse(mem.value)) {
+            return false;
+        }
+        this->_members.push_back(mem);
     }
-
-    if (! skipWhitespace (datap)) {
-        return nullptr;
+    if (rdr.event() != E_END_OBJECT) {
+        return false;
     }
 
-    Value *value = parse (datap);
-
-    return value;
-
-}
+    // copy the members of the object from the scratch stack to the arena and
+    // sort them by key.  The sort is stable, so that lookups find the first
+    // definition of a duplicated key.
+    uint32_t n = static_cast<uint32_t>(this->_members.size() - base);
+    Member *members = nullptr;
+    if (n > 0) {
+        members = static_cast<Member *>(this->_doc._alloc(n * sizeof(Member)));
+        std::copy (this->_members.begin() + base, this->_members.end(), members);
+        std::stable_sort (members, members + n,
+            [] (Member const &a, Member const &b) { return a.key < b.key; });
+        this->_members.resize(base);
+    }
+    node._ty = T_OBJECT;
+    node._n = n;
+    node._u.members = members;
 
-static bool skipWhitespace (Input &datap)
-{
-    while ((! datap.eof()) && isspace(*datap))
-        datap++;
+    return true;
 
-    if (datap.eof()) {
-        datap.error("unexpected eof");
-        return false;
-    }
-    else
-        return true;
 }
 
-static bool extractString (Input &datap, std::string &str)
+bool Parser::_parseArray (Node &node)
 {
-    str = "";
-
-    if (*datap != '\"')
-        return false;
-    datap++;
-
-    while (! datap.eof()) {
-        // Save the char so we can change it if need be
-        char nextChar = *datap;
+    Reader &rdr = this->_rdr;
+    size_t base = this->_elems.size();
 
-        // Escaping something?
-        if (nextChar == '\\') {
-            // Move over the escape char
-            datap++;
-            // Deal with the escaped char
-            switch (*datap) {
-                case '"': nextChar = '"'; break;
-                case '\\': nextChar = '\\'; break;
-                case '/': nextChar = '/'; break;
-                case 'b': nextChar = '\b'; break;
-                case 'f': nextChar = '\f'; break;
-                case 'n': nextChar = '\n'; break;
-                case 'r': nextChar = '\r'; break;
-                case 't': nextChar = '\t'; break;
-                case 'u': /* no UNICODE support */
-                // By the spec, only the above cases are allowed
-                default:
-                    datap.error("invalid escape sequence in string");
-                    return false;
-            }
-        }
-      // End of the string?
-        else if (nextChar == '"') {
-            datap++;
-            str.reserve(); // Remove unused capacity
-            return true;
+    while (true) {
+        Event ev = rdr.next();
+        if (ev == E_END_ARRAY) {
+            break;
         }
-      // Disallowed char?
-        else if (! isprint(nextChar) && (nextChar != '\t')) {
-          // SPEC Violation: Allow tabs due to real world cases
-            datap.error("invalid character in string");
+        Node elem;
+        if (! this->parse(elem)) {
             return false;
         }
-      // Add the next char
-        str += nextChar;
-      // Move on
-        datap++;
+        this->_elems.push_back(elem);
     }
 
-  // If we're here, the string ended incorrectly
-    return false;
-}
-
-static int64_t parseInt (Input &datap)
-{
-    int64_t n = 0;
-    while (*datap != 0 && isdigit(*datap)) {
-        n = n * 10 + (*datap - '0');
-        datap++;
+    // copy the elements of the array from the scratch stack to the arena
+    uint32_t n = static_cast<uint32_t>(this->_elems.size() - base);
+    Node *elems = nullptr;
+    if (n > 0) {
+        elems = static_cast<Node *>(this->_doc._alloc(n * sizeof(Node)));
+        std::copy (this->_elems.begin() + base, this->_elems.end(), elems);
+        this->_elems.resize(base);
     }
+    node._ty = T_ARRAY;
+    node._n = n;
+    node._u.elems = elems;
 
-    return n;
-}
-
-static double parseDecimal (Input &datap)
-{
-    double decimal = 0.0;
-    double factor = 0.1;
+    return true;
 
-    while ((! datap.eof()) && isdigit(*datap)) {
-        int digit = (*datap - '0');
-        decimal = decimal + digit * factor;
-        factor *= 0.1;
-        datap++;
-    }
-    return decimal;
 }
 
-static Value *parse (Input &datap)
-{
-    if (datap.eof()) {
-        datap.error("unexpected end of file");
-        return nullptr;
-    }
+/***** class Document member functions *****/
 
-  // Is it a string?
-    if (*datap == '"') {
-        std::string str;
-        if (! extractString(datap, str))
-            return nullptr;
-        else
-            return new String(str);
-    }
-  // Is it a boolean?
-    else if ((datap.avail() >= 4) && strncasecmp(datap(), "true", 4) == 0) {
-        datap += 4;
-        return new Bool(true);
-    }
-    else if ((datap.avail() >=  5) && strncasecmp(datap(), "false", 5) == 0) {
-        datap += 5;
-        return new Bool(false);
-    }
-  // Is it a null?
-    else if ((datap.avail() >=  4) && strncasecmp(datap(), "null", 4) == 0) {
-        datap += 4;
-        return new Null();
+Document::Document (std::string const &filename)
+  : _file(new cs237::MappedFile(filename)), _next(nullptr), _avail(0), _root(), _ok(false)
+{
+    if (! this->_file->isValid()) {
+        std::cerr << "json::parseFile: unable to read \"" << filename << "\"" << std::endl;
+        return;
     }
-  // Is it a number?
-    else if (*datap == '-' || isdigit(*datap)) {
-      // Negative?
-        bool neg = *datap == '-';
-        bool isReal = false;
-        if (neg) datap++;
 
-        int64_t whole = 0;
+    Reader rdr(this->_file->data(), this->_file->size(), filename);
+    Parser parser(rdr, *this, this->_file->data(), this->_file->size());
+    this->_ok = parser.parse (this->_root) && (rdr.next() == E_EOF);
 
-      // parse the whole part of the number - only if it wasn't 0
-        if (*datap == '0')
-            datap++;
-        else if (isdigit(*datap))
-            whole = parseInt(datap);
-        else {
-            datap.error("invalid number");
-            return nullptr;
-        }
-
-        double r;
-
-      // Could be a decimal now...
-        if (*datap == '.') {
-            r = (double)whole;
-            isReal = true;
-            datap++;
-
-            // Not get any digits?
-            if (! isdigit(*datap)) {
-                datap.error("invalid number");
-                return nullptr;
-            }
-
-            // Find the decimal and sort the decimal place out
-            // Use parseDecimal as parseInt won't work with decimals less than 0.1
-            // thanks to Javier Abadia for the report & fix
-            double decimal = parseDecimal(datap);
-
-            // Save the number
-            r += decimal;
-        }
-
-        // Could be an exponent now...
-        if (*datap == 'E' || *datap == 'e') {
-            if (!isReal) {
-                r = (double)whole;
-                isReal = true;
-            }
-            datap++;
-
-            // Check signage of expo
-            bool neg_expo = false;
-            if (*datap == '-' || *datap == '+') {
-                neg_expo = *datap == '-';
-                datap++;
-            }
+}
 
-            // Not get any digits?
-            if (! isdigit(*datap)) {
-                datap.error("invalid number");
-                return nullptr;
-            }
+/***** Compatibility layer *****/
 
-            // Sort the expo out
-            double expo = parseInt(datap);
-            for (double i = 0.0; i < expo; i++) {
-                r = neg_expo ? (r / 10.0) : (r * 10.0);
+// convert a document node to a heap-allocated value
+static Value *toValue (Node const &node)
+{
+    switch (node.type()) {
+    case T_OBJECT: {
+            Object *obj = new Object();
+            for (auto const &mem : node) {
+                obj->insert (std::string(mem.key), toValue(mem.value));
             }
+            return obj;
         }
-
-        if (isReal) {
-            return new Real (neg ? -r : r);
-        }
-        else {
-            return new Integer (neg ? -whole : whole);
-        }
-    }
-  // An object?
-    else if (*datap == '{') {
-        Object *object = new Object();
-
-        datap++;
-
-        while (!datap.eof()) {
-          // Whitespace at the start?
-            if (! skipWhitespace(datap)) {
-                delete object;
-                return nullptr;
-            }
-
-          // Special case: empty object
-            if ((object->size() == 0) && (*datap == '}')) {
-                datap++;
-                return object;
-            }
-
-          // We want a string now...
-            std::string name;
-// CHECK: do we need to look for "?
-            if (! extractString(datap, name)) {
-                datap.error("expected label");
-                delete object;
-                return nullptr;
-            }
-
-          // More whitespace?
-            if (! skipWhitespace(datap)) {
-                delete object;
-                return nullptr;
-            }
-
-          // Need a : now
-            if (*datap != ':') {
-                datap.error("expected ':'");
-                delete object;
-                return nullptr;
-            }
-            datap++;
-
-          // More whitespace?
-            if (! skipWhitespace(datap)) {
-                delete object;
-                return nullptr;
-            }
-
-          // The value is here
-            Value *value = parse(datap);
-            if (value == nullptr) {
-                delete object;
-                return nullptr;
-            }
-
-          // Add the name:value
-            object->insert(name, value);
-
-          // More whitespace?
-            if (! skipWhitespace(datap)) {
-                delete object;
-                return nullptr;
-            }
-
-            // End of object?
-            if (*datap == '}') {
-                datap++;
-                return object;
-            }
-
-            // Want a , now
-            if (*datap != ',') {
-                datap.error("expected ','");
-                delete object;
-                return nullptr;
+    case T_ARRAY: {
+            Array *arr = new Array();
+            for (uint32_t i = 0;  i < node.size();  ++i) {
+                arr->add (toValue(node[i]));
             }
-
-            datap++;
+            return arr;
         }
-
-      // Only here if we ran out of data
-        datap.error("unexpected eof");
-        delete object;
-        return nullptr;
+    case T_INTEGER: return new Integer(node.intVal());
+    case T_REAL: return new Real(node.realVal());
+    case T_STRING: return new String(std::string(node.strVal()));
+    case T_BOOL: return new Bool(node.boolVal());
+    case T_NULL: return new Null();
     }
+    return nullptr;
+}
 
-    // An array?
-    else if (*datap == '[') {
-        Array *array = new Array();
-
-        datap++;
-
-        while (! datap.eof()) {
-          // Whitespace at the start?
-            if (! skipWhitespace(datap)) {
-                delete array;
-                return nullptr;
-            }
-
-          // Special case - empty array
-            if ((array->length() == 0) && (*datap == ']')) {
-                datap++;
-                return array;
-            }
-
-          // Get the value
-            Value *value = parse(datap);
-            if (value == nullptr) {
-                delete array;
-                return nullptr;
-            }
-
-          // Add the value
-            array->add(value);
-
-          // More whitespace?
-            if (! skipWhitespace(datap)) {
-                delete array;
-                return nullptr;
-            }
-
-          // End of array?
-            if (*datap == ']') {
-                datap++;
-                return array;
-            }
-
-            // Want a , now
-            if (*datap != ',') {
-                datap.error("expected ','");
-                delete array;
-                return nullptr;
-            }
+// parse a json file; this returns nullptr if there is a parsing error
+Value *parseFile (std::string filename)
+{
+    Document doc(filename);
+    const Node *root = doc.root();
 
-            datap++;
-        }
+    return (root == nullptr) ? nullptr : toValue (*root);
 
-      // Only here if we ran out of data
-        datap.error("unexpected eof");
-        delete array;
-        return nullptr;
-    }
-  // Ran out of possibilites, it's bad!
-    else {
-        datap.error("bogus input");
-        return nullptr;
-    }
 }
 
 } // namespace json
@@ -0,0 +1,575 @@
+/*! \file json-reader.cpp
+ *
+ * A streaming (pull) parser for JSON files.
+ *
+ * CMSC 23740 Autumn 2024.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "json.hpp"
+#include <iostream>
+#include <charconv>
+#include <cstring>
+#include <cstdlib>
+
+namespace json {
+
+namespace __detail {
+
+// exact powers of ten that are representable as doubles
+static const double kPow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+// the largest mantissa that is exactly representable as a double
+constexpr uint64_t kMaxExactMantissa = uint64_t(1) << 53;
+
+// the number of decimal digits that always fit in a uint64_t
+constexpr int kMaxMantissaDigits = 19;
+
+inline bool isDigit (char c) { return (c >= '0') && (c <= '9'); }
+
+// convert the text of a real number using the C++ library.  This is only used
+// when the fast path in `Reader::_number` cannot produce a correctly rounded
+// result, which does not happen for typical scene files.  As with `strtod`,
+// values that are too large map to `HUGE_VAL` and values that are too small
+// map to zero (or a denormal).
+static double slowStrToD (const char *start, const char *end)
+{
+    double r = 0.0;
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+    auto res = std::from_chars (start, end, r);
+    if (res.ec == std::errc::result_out_of_range) {
+        // `from_chars` does not set `r` when the value is out of range, so we
+        // let `strtod` choose between overflow and underflow
+        std::string s(start, end);
+        r = std::strtod (s.c_str(), nullptr);
+    }
+#else
+    std::string s(start, end);
+    r = std::strtod (s.c_str(), nullptr);
+#endif
+    return r;
+}
+
+// append the UTF-8 encoding of a code point to a string
+static void appendUTF8 (std::string &s, uint32_t cp)
+{
+    if (cp < 0x80) {
+        s.push_back (char(cp));
+    } else if (cp < 0x800) {
+        s.push_back (char(0xc0 | (cp >> 6)));
+        s.push_back (char(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+        s.push_back (char(0xe0 | (cp >> 12)));
+        s.push_back (char(0x80 | ((cp >> 6) & 0x3f)));
+        s.push_back (char(0x80 | (cp & 0x3f)));
+    } else {
+        s.push_back (char(0xf0 | (cp >> 18)));
+        s.push_back (char(0x80 | ((cp >> 12) & 0x3f)));
+        s.push_back (char(0x80 | ((cp >> 6) & 0x3f)));
+        s.push_back (char(0x80 | (cp & 0x3f)));
+    }
+}
+
+// parse four hex digits; returns ~0 on error
+static uint32_t hex4 (const char *p, const char *end)
+{
+    if (end - p < 4) {
+        return ~0u;
+    }
+    uint32_t n = 0;
+    for (int i = 0;  i < 4;  ++i) {
+        char c = p[i];
+        n <<= 4;
+        if (isDigit(c)) n |= uint32_t(c - '0');
+        else if ((c >= 'a') && (c <= 'f')) n |= uint32_t(c - 'a' + 10);
+        else if ((c >= 'A') && (c <= 'F')) n |= uint32_t(c - 'A' + 10);
+        else return ~0u;
+    }
+    return n;
+}
+
+} // namespace __detail
+
+/***** class Reader member functions *****/
+
+Reader::Reader (std::string const &filename)
+  : _file(new cs237::MappedFile(filename)), _name(filename),
+    _p(nullptr), _end(nullptr), _lnum(1), _ev(E_EOF), _state(S_VALUE)
+{
+    if (! this->_file->isValid()) {
+        std::cerr << "json::Reader: unable to read \"" << filename << "\"" << std::endl;
+        this->_ev = E_ERROR;
+        return;
+    }
+    this->_p = this->_file->data();
+    this->_end = this->_file->end();
+    this->_init ();
+}
+
+Reader::Reader (const char *data, size_t len, std::string const &name)
+  : _file(nullptr), _name(name),
+    _p(data), _end(data + len), _lnum(1), _ev(E_EOF), _state(S_VALUE)
+{
+    this->_init ();
+}
+
+Reader::~Reader ()
+{
+    delete this->_file;
+}
+
+void Reader::_init ()
+{
+    // skip a UTF-8 byte-order mark
+    if ((this->_end - this->_p >= 3) && (std::memcmp(this->_p, "\xef\xbb\xbf", 3) == 0)) {
+        this->_p += 3;
+    }
+    this->next ();
+}
+
+void Reader::error (std::string_view msg)
+{
+    if (this->_ev == E_ERROR) {
+        return;
+    }
+    this->_ev = E_ERROR;
+
+    std::cerr << "json::Reader(" << this->_name << "): " << msg
+        << " at line " << this->_lnum << std::endl;
+    std::cerr << "    input = \"";
+    for (const char *q = this->_p;  (q < this->_end) && (q < this->_p + 20);  ++q) {
+        if (isprint(*q))
+            std::cerr << *q;
+        else
+            std::cerr << ".";
+    }
+    std::cerr << " ...\n" << std::endl;
+}
+
+void Reader::_skipWhitespace ()
+{
+    const char *p = this->_p;
+    const char *end = this->_end;
+    while (p < end) {
+        char c = *p;
+        if (c == '\n') {
+            this->_lnum++;
+        } else if ((c != ' ') && (c != '\t') && (c != '\r')) {
+            break;
+        }
+        ++p;
+    }
+    this->_p = p;
+}
+
+Event Reader::next ()
+{
+    if (this->_ev == E_ERROR) {
+        return E_ERROR;
+    }
+
+    while (true) {
+        this->_skipWhitespace ();
+        switch (this->_state) {
+        case S_VALUE:
+            return this->_ev = this->_value();
+
+        case S_FIRST_KEY:
+            if ((this->_p < this->_end) && (*this->_p == '}')) {
+                this->_p++;
+                this->_nest.pop_back();
+                this->_state = this->_nest.empty() ? S_DONE : S_AFTER_VALUE;
+                return this->_ev = E_END_OBJECT;
+            }
+            [[fallthrough]];
+        case S_KEY:
+            if ((this->_p >= this->_end) || (*this->_p != '"')) {
+                this->error ("expected label");
+                return E_ERROR;
+            }
+            if (! this->_string()) {
+                return E_ERROR;
+            }
+            this->_skipWhitespace ();
+            if ((this->_p >= this->_end) || (*this->_p != ':')) {
+                this->error ("expected ':'");
+                return E_ERROR;
+            }
+            this->_p++;
+            this->_state = S_VALUE;
+            return this->_ev = E_KEY;
+
+        case S_FIRST_ELEM:
+            if ((this->_p < this->_end) && (*this->_p == ']')) {
+                this->_p++;
+                this->_nest.pop_back();
+                this->_state = this->_nest.empty() ? S_DONE : S_AFTER_VALUE;
+                return this->_ev = E_END_ARRAY;
+            }
+            return this->_ev = this->_value();
+
+        case S_AFTER_VALUE: {
+                if (this->_p >= this->_end) {
+                    this->error ("unexpected eof");
+                    return E_ERROR;
+                }
+                bool inObj = this->_nest.back();
+                char c = *this->_p++;
+                if (c == ',') {
+                    this->_state = inObj ? S_KEY : S_VALUE;
+                    continue;
+                } else if (c == (inObj ? '}' : ']')) {
+                    this->_nest.pop_back();
+                    this->_state = this->_nest.empty() ? S_DONE : S_AFTER_VALUE;
+                    return this->_ev = (inObj ? E_END_OBJECT : E_END_ARRAY);
+                } else {
+                    this->_p--;
+                    this->error ("expected ','");
+                    return E_ERROR;
+                }
+            }
+
+        case S_DONE:
+            // only trailing whitespace is allowed after the root value
+            if (this->_p < this->_end) {
+                this->error ("unexpected input after value");
+                return E_ERROR;
+            }
+            return this->_ev = E_EOF;
+        }
+    }
+
+}
+
+// parse the start of a value
+Event Reader::_value ()
+{
+    if (this->_p >= this->_end) {
+        this->error ("unexpected eof");
+        return E_ERROR;
+    }
+
+    // the state after a scalar value
+    State after = this->_nest.empty() ? S_DONE : S_AFTER_VALUE;
+
+    char c = *this->_p;
+    Event ev;
+    if (c == '{') {
+        this->_p++;
+        this->_nest.push_back(true);
+        this->_state = S_FIRST_KEY;
+        return E_BEGIN_OBJECT;
+    } else if (c == '[') {
+        this->_p++;
+        this->_nest.push_back(false);
+        this->_state = S_FIRST_ELEM;
+        return E_BEGIN_ARRAY;
+    } else if (c == '"') {
+        ev = this->_string() ? E_STRING : E_ERROR;
+    } else if ((c == '-') || __detail::isDigit(c)) {
+        ev = this->_number();
+    } else if ((c | 0x20) == 't') {
+        this->_u.b = true;
+        ev = this->_literal ("true", E_BOOL);
+    } else if ((c | 0x20) == 'f') {
+        this->_u.b = false;
+        ev = this->_literal ("false", E_BOOL);
+    } else if ((c | 0x20) == 'n') {
+        ev = this->_literal ("null", E_NULL);
+    } else {
+        this->error ("bogus input");
+        return E_ERROR;
+    }
+
+    this->_state = after;
+    return ev;
+
+}
+
+// match a literal; like the original parser, we ignore case
+Event Reader::_literal (std::string_view lit, Event ev)
+{
+    if (size_t(this->_end - this->_p) < lit.size()) {
+        this->error ("bogus input");
+        return E_ERROR;
+    }
+    for (size_t i = 0;  i < lit.size();  ++i) {
+        if ((this->_p[i] | 0x20) != lit[i]) {
+            this->error ("bogus input");
+            return E_ERROR;
+        }
+    }
+    this->_p += lit.size();
+    return ev;
+}
+
+// parse a string; on success, `_str` is set to its contents.  The common case
+// of a string without escape sequences is handled by searching for the closing
+// quote and returning a view of the input.
+bool Reader::_string ()
+{
+    const char *start = ++this->_p;
+
+    // scan for the closing quote, stopping at escapes and control characters;
+    // we allow tabs in strings (a spec violation, but one that occurs in
+    // real-world files)
+    const char *q = start;
+    while (q < this->_end) {
+        unsigned char c = static_cast<unsigned char>(*q);
+        if (c == '"') {
+            this->_str = std::string_view(start, q - start);
+            this->_p = q + 1;
+            return true;
+        } else if ((c == '\\') || ((c < 0x20) && (c != '\t'))) {
+            break;
+        }
+        ++q;
+    }
+
+    // slow path: decode the string into the scratch buffer
+    std::string &buf = this->_scratch;
+    buf.clear();
+    const char *p = start;
+    while (p < this->_end) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"') {
+            this->_p = p + 1;
+            this->_str = std::string_view(buf);
+            return true;
+        } else if (c == '\\') {
+            if (++p >= this->_end) {
+                break;
+            }
+            switch (*p++) {
+                case '"': buf.push_back('"'); break;
+                case '\\': buf.push_back('\\'); break;
+                case '/': buf.push_back('/'); break;
+                case 'b': buf.push_back('\b'); break;
+                case 'f': buf.push_back('\f'); break;
+                case 'n': buf.push_back('\n'); break;
+                case 'r': buf.push_back('\r'); break;
+                case 't': buf.push_back('\t'); break;
+                case 'u': {
+                        uint32_t cp = __detail::hex4 (p, this->_end);
+                        p += 4;
+                        if ((cp >= 0xd800) && (cp < 0xdc00)
+                        && (this->_end - p >= 6) && (p[0] == '\\') && (p[1] == 'u')) {
+                            // a surrogate pair
+                            uint32_t lo = __detail::hex4 (p + 2, this->_end);
+                            if ((lo >= 0xdc00) && (lo < 0xe000)) {
+                                cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                                p += 6;
+                            }
+                        }
+                        if ((cp == ~0u) || ((cp >= 0xd800) && (cp < 0xe000))) {
+                            this->_p = p;
+                            this->error ("invalid unicode escape in string");
+                            return false;
+                        }
+                        __detail::appendUTF8 (buf, cp);
+                    } break;
+                default:
+                    this->_p = p - 1;
+                    this->error ("invalid escape sequence in string");
+                    return false;
+            }
+        } else if ((c < 0x20) && (c != '\t')) {
+            this->_p = p;
+            this->error ("invalid character in string");
+            return false;
+        } else {
+            buf.push_back(char(c));
+            ++p;
+        }
+    }
+
+    this->_p = p;
+    this->error ("unterminated string");
+    return false;
+
+}
+
+// parse a number.  We accumulate up to 19 significant decimal digits in an integer
+// mantissa and track the decimal exponent.  If the mantissa is exactly representable
+// as a double and the exponent is small, then the product (or quotient) of the
+// mantissa and the exact power of ten is correctly rounded (this is Clinger's fast
+// path); otherwise we fall back to the library conversion.
+Event Reader::_number ()
+{
+    using __detail::isDigit;
+
+    const char *start = this->_p;
+    const char *p = start;
+    const char *end = this->_end;
+
+    bool neg = (*p == '-');
+    if (neg) ++p;
+
+    uint64_t m = 0;             // the mantissa
+    int nDigits = 0;            // the number of significant digits in m
+    int exp10 = 0;              // the decimal exponent
+    bool inexact = false;       // true if non-zero digits were dropped
+    bool isReal = false;
+
+    // add a digit to the mantissa; returns false if the digit was dropped
+    auto addDigit = [&] (int d) {
+        if (nDigits < __detail::kMaxMantissaDigits) {
+            m = 10 * m + d;
+            if (m != 0) nDigits++;
+            return true;
+        } else {
+            inexact |= (d != 0);
+            return false;
+        }
+    };
+
+    // the whole part of the number
+    if ((p < end) && (*p == '0')) {
+        ++p;
+    } else if ((p < end) && isDigit(*p)) {
+        while ((p < end) && isDigit(*p)) {
+            if (! addDigit(*p - '0')) exp10++;
+            ++p;
+        }
+    } else {
+        this->_p = p;
+        this->error ("invalid number");
+        return E_ERROR;
+    }
+
+    // the fractional part
+    if ((p < end) && (*p == '.')) {
+        isReal = true;
+        ++p;
+        if ((p >= end) || ! isDigit(*p)) {
+            this->_p = p;
+            this->error ("invalid number");
+            return E_ERROR;
+        }
+        while ((p < end) && isDigit(*p)) {
+            if (addDigit(*p - '0')) exp10--;
+            ++p;
+        }
+    }
+
+    // the exponent
+    if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+        isReal = true;
+        ++p;
+        bool negExp = false;
+        if ((p < end) && ((*p == '-') || (*p == '+'))) {
+            negExp = (*p == '-');
+            ++p;
+        }
+        if ((p >= end) || ! isDigit(*p)) {
+            this->_p = p;
+            this->error ("invalid number");
+            return E_ERROR;
+        }
+        int e = 0;
+        while ((p < end) && isDigit(*p)) {
+            if (e < 100000) e = 10 * e + (*p - '0');
+            ++p;
+        }
+        exp10 += negExp ? -e : e;
+    }
+    this->_p = p;
+
+    if (! isReal && (exp10 == 0)
+    && (m <= uint64_t(std::numeric_limits<int64_t>::max()) + uint64_t(neg))) {
+        this->_u.i = neg ? int64_t(0 - m) : int64_t(m);
+        return E_INTEGER;
+    }
+
+    double r;
+    if (m == 0) {
+        r = 0.0;
+    } else if (! inexact && (m <= __detail::kMaxExactMantissa)
+    && (-22 <= exp10) && (exp10 <= 22)) {
+        r = static_cast<double>(m);
+        r = (exp10 < 0) ? r / __detail::kPow10[-exp10] : r * __detail::kPow10[exp10];
+    } else {
+        r = __detail::slowStrToD (neg ? start + 1 : start, p);
+    }
+    this->_u.r = neg ? -r : r;
+    return E_REAL;
+
+}
+
+bool Reader::skip ()
+{
+    if ((this->_ev == E_BEGIN_OBJECT) || (this->_ev == E_BEGIN_ARRAY)) {
+        size_t depth = this->_nest.size();
+        // read until the enclosing value is closed
+        while (this->_nest.size() >= depth) {
+            if (this->next() == E_ERROR) {
+                return false;
+            }
+        }
+    }
+    return (this->_ev != E_ERROR);
+
+}
+
+bool Reader::readObject (std::initializer_list<Field> fields)
+{
+    assert (fields.size() <= 64);
+
+    if (this->_ev != E_BEGIN_OBJECT) {
+        this->error ("expected an object");
+        return false;
+    }
+
+    uint64_t seen = 0;
+    while (this->next() != E_END_OBJECT) {
+        if (this->_ev != E_KEY) {
+            return false;
+        }
+        // find the field; the view of the key is only valid until we advance
+        const Field *fld = nullptr;
+        uint64_t bit = 1;
+        for (auto const &f : fields) {
+            if (f._key == this->_str) {
+                if ((seen & bit) == 0) {
+                    fld = &f;
+                }
+                break;
+            }
+            bit <<= 1;
+        }
+        this->next();
+        if (fld != nullptr) {
+            seen |= bit;
+            if (! fld->_read(*this, fld->_dst, fld->_fn)) {
+                return false;
+            }
+        } else if (! this->skip()) {
+            return false;
+        }
+    }
+
+    // check that the required fields were present
+    uint64_t bit = 1;
+    for (auto const &f : fields) {
+        if (f._required && ((seen & bit) == 0)) {
+            this->error ("missing field \"" + std::string(f._key) + "\"");
+            return false;
+        }
+        bit <<= 1;
+    }
+
+    return true;
+
+}
+
+} // namespace json
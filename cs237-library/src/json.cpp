@@ -12,7 +12,9 @@
  * All rights reserved.
  */
 
+#include "cs237/cs237.hpp"
 #include "json.hpp"
+#include <algorithm>
 
 namespace json {
 
@@ -59,17 +61,22 @@ const Bool *Value::asBool () const
 
 Object::~Object ()
 {
-  // need to delete contents
+    for (auto &it : this->_value) {
+        delete it.second;
+    }
 }
 
 void Object::insert (std::string key, Value *val)
 {
-    this->_value.insert (std::pair<std::string, Value *>(key, val));
+    // the first definition of a key wins
+    if (! this->_value.insert (std::pair<std::string, Value *>(key, val)).second) {
+        delete val;
+    }
 }
 
-Value *Object::operator[] (std::string key) const
+Value *Object::operator[] (std::string_view key) const
 {
-    std::map<std::string, Value *>::const_iterator got = this->_value.find(key);
+    auto got = this->_value.find(key);
     if (got == this->_value.end())
         return nullptr;
     else
@@ -82,7 +89,9 @@ std::string Object::toString() { return std::string("<object>"); }
 
 Array::~Array ()
 {
-  // need to delete contents
+    for (auto v : this->_value) {
+        delete v;
+    }
 }
 
 std::string Array::toString() { return std::string("<array>"); }
@@ -128,4 +137,58 @@ Null::~Null () { }
 
 std::string Null::toString() { return std::string("null"); }
 
+/***** class Node member functions *****/
+
+const Node *Node::field (std::string_view key) const
+{
+    if (! this->isObject()) {
+        return nullptr;
+    }
+
+    // the members are sorted by key, so we can use binary search
+    const Member *mem = std::lower_bound (this->begin(), this->end(), key,
+        [] (Member const &m, std::string_view k) { return m.key < k; });
+    if ((mem != this->end()) && (mem->key == key)) {
+        return &mem->value;
+    } else {
+        return nullptr;
+    }
+
+}
+
+/***** class Document member functions *****/
+
+// the minimum size of an arena chunk
+constexpr size_t kMinChunkSize = 4096;
+
+Document::~Document ()
+{
+    for (auto chunk : this->_chunks) {
+        delete[] chunk;
+    }
+    delete this->_file;
+}
+
+void *Document::_alloc (size_t n)
+{
+    assert ((n & 7) == 0);
+
+    if (n > this->_avail) {
+        // allocate a new chunk that is at least twice the size of the previous one
+        size_t sz = this->_chunks.empty()
+            ? kMinChunkSize
+            : 2 * (this->_next + this->_avail - this->_chunks.back());
+        sz = std::max(sz, n);
+        this->_chunks.push_back (new char[sz]);
+        this->_next = this->_chunks.back();
+        this->_avail = sz;
+    }
+
+    void *p = this->_next;
+    this->_next += n;
+    this->_avail -= n;
+    return p;
+
+}
+
 } // namespace json
@@ -0,0 +1,133 @@
+/*! \file mapped-file.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace cs237 {
+
+MappedFile::MappedFile (std::string const &path)
+  : _data(nullptr), _sz(0), _valid(false), _isMapped(false)
+{
+#ifdef HAVE_SYS_MMAN_H
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if ((::fstat(fd, &st) < 0) || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return;
+    }
+    this->_sz = static_cast<size_t>(st.st_size);
+    if (this->_sz > 0) {
+        void *addr = ::mmap(nullptr, this->_sz, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            this->_sz = 0;
+            return;
+        }
+        // we mostly scan files from front to back
+        ::madvise(addr, this->_sz, MADV_SEQUENTIAL);
+        this->_data = static_cast<const char *>(addr);
+        this->_isMapped = true;
+    }
+    // the mapping remains valid after the file is closed
+    ::close(fd);
+    this->_valid = true;
+#else
+    std::ifstream inS(path, std::ios::in | std::ios::binary);
+    if (! inS.is_open()) {
+        return;
+    }
+    inS.seekg(0, std::ios::end);
+    this->_sz = static_cast<size_t>(inS.tellg());
+    inS.seekg(0, std::ios::beg);
+    if (this->_sz > 0) {
+        char *buf = new char[this->_sz];
+        inS.read(buf, this->_sz);
+        if (inS.fail()) {
+            delete[] buf;
+            this->_sz = 0;
+            return;
+        }
+        this->_data = buf;
+    }
+    this->_valid = true;
+#endif
+
+}
+
+MappedFile::~MappedFile ()
+{
+    if (this->_data != nullptr) {
+#ifdef HAVE_SYS_MMAN_H
+        if (this->_isMapped) {
+            ::munmap(const_cast<char *>(this->_data), this->_sz);
+            return;
+        }
+#endif
+        delete[] this->_data;
+    }
+
+}
+
+bool writeFileAtomically (
+    std::string const &path,
+    std::function<bool(std::ofstream &)> const &write)
+{
+    // the name of the temporary file is unique to the thread and time
+    std::ostringstream tmpName;
+    tmpName << path << ".tmp" << std::this_thread::get_id()
+        << "-" << std::chrono::steady_clock::now().time_since_epoch().count();
+    std::string tmpFile = tmpName.str();
+
+    bool ok;
+    {
+        std::ofstream outS(tmpFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (! outS.is_open()) {
+            return false;
+        }
+        try {
+            ok = write (outS);
+        } catch (...) {
+            outS.close();
+            std::remove (tmpFile.c_str());
+            throw;
+        }
+        outS.close();
+        ok = ok && !outS.fail();
+    }
+
+    if (ok) {
+        ok = (std::rename (tmpFile.c_str(), path.c_str()) == 0);
+    }
+    if (! ok) {
+        std::remove (tmpFile.c_str());
+    }
+
+    return ok;
+
+}
+
+} // namespace cs237
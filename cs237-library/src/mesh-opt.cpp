@@ -0,0 +1,357 @@
+/*! \file mesh-opt.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Triangle reordering for vertex-cache locality and reduced overdraw, and vertex
+ * reordering for fetch locality.  See "Fast Triangle Reordering for Vertex Locality
+ * and Reduced Overdraw" by Sander, Nehab, and Barczak (SIGGRAPH 2007).
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "mesh-util.hpp"
+
+namespace cs237 {
+namespace mesh {
+
+namespace __detail {
+
+// a simulated FIFO vertex cache.  Rather than keeping a queue, we count the
+// cache misses and record the count at which each vertex was last loaded; a
+// vertex is in the cache if fewer than `cacheSize` vertices have been loaded
+// since then.
+class FIFOCache {
+public:
+    FIFOCache (uint32_t nVerts, uint32_t cacheSize)
+      : _stamps(nVerts, 0), _size(cacheSize), _time(cacheSize + 1), _misses(0)
+    { }
+
+    // access a vertex; returns true if it was a cache miss
+    bool access (uint32_t v)
+    {
+        if (this->_time - this->_stamps[v] < this->_size) {
+            return false;
+        }
+        this->_stamps[v] = ++this->_time;
+        this->_misses++;
+        return true;
+    }
+
+    // access the vertices of triangle i; returns the number of misses
+    uint32_t accessTri (const uint32_t *indices, uint32_t i)
+    {
+        return uint32_t(this->access(indices[3*i]))
+            + uint32_t(this->access(indices[3*i+1]))
+            + uint32_t(this->access(indices[3*i+2]));
+    }
+
+    // empty the cache
+    void flush () { this->_time += this->_size + 1; }
+
+    // the number of misses so far
+    uint32_t misses () const { return this->_misses; }
+
+private:
+    std::vector<uint32_t> _stamps;
+    uint32_t _size;
+    uint32_t _time;
+    uint32_t _misses;
+};
+
+} // namespace __detail
+
+float acmr (uint32_t nIndices, const uint32_t *indices, uint32_t nVerts, uint32_t cacheSize)
+{
+    uint32_t nTris = nIndices / 3;
+    if (nTris == 0) {
+        return 0.0f;
+    }
+    __detail::FIFOCache cache(nVerts, cacheSize);
+    for (uint32_t i = 0;  i < nTris;  ++i) {
+        cache.accessTri (indices, i);
+    }
+    return float(cache.misses()) / float(nTris);
+
+}
+
+/* The Tipsify algorithm.  We build triangle fans around a "fanning" vertex,
+ * emitting all of its remaining triangles.  The next fanning vertex is picked
+ * from the vertices of the fan that was just emitted, preferring the one that
+ * entered the cache earliest, as long as its remaining triangles will be emitted
+ * before it is evicted.  If none of them have any triangles left, then we are at
+ * a dead end, and we pick a vertex from the stack of recently used vertices or,
+ * failing that, the next unfinished vertex in input order.
+ */
+void optimizeVertexCache (
+    uint32_t nIndices,
+    uint32_t *indices,
+    uint32_t nVerts,
+    uint32_t cacheSize,
+    std::vector<uint32_t> *clusters)
+{
+    uint32_t nTris = nIndices / 3;
+    if (clusters != nullptr) {
+        clusters->clear();
+    }
+    if (nTris == 0) {
+        return;
+    }
+
+    __detail::Adjacency adj(nIndices, indices, nVerts);
+
+    std::vector<uint32_t> live(nVerts);         // number of unemitted triangles per vertex
+    for (uint32_t v = 0;  v < nVerts;  ++v) {
+        live[v] = adj.degree(v);
+    }
+    std::vector<uint32_t> stamps(nVerts, 0);    // the time when each vertex entered the cache
+    std::vector<bool> emitted(nTris, false);
+    std::vector<uint32_t> deadEnd;              // stack of recently used vertices
+    std::vector<uint32_t> candidates;           // the vertices of the last fan
+    std::vector<uint32_t> out;
+    out.reserve(nIndices);
+
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;                        // for scanning for unfinished vertices
+
+    // find the next vertex to fan around after a dead end; returns ~0 when done
+    auto skipDeadEnd = [&] () -> uint32_t {
+        while (! deadEnd.empty()) {
+            uint32_t d = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[d] > 0) {
+                return d;
+            }
+        }
+        while (cursor < nVerts) {
+            if (live[cursor] > 0) {
+                return cursor;
+            }
+            cursor++;
+        }
+        return ~0u;
+    };
+
+    uint32_t fan = skipDeadEnd();
+    while (fan != ~0u) {
+        // emit the remaining triangles around the fanning vertex
+        candidates.clear();
+        for (uint32_t j = adj.offsets[fan];  j < adj.offsets[fan+1];  ++j) {
+            uint32_t tri = adj.tris[j];
+            if (emitted[tri]) {
+                continue;
+            }
+            for (int k = 0;  k < 3;  ++k) {
+                uint32_t v = indices[3*tri + k];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - stamps[v] > cacheSize) {
+                    stamps[v] = time++;
+                }
+            }
+            emitted[tri] = true;
+        }
+
+        // pick the next fanning vertex from the candidates
+        uint32_t next = ~0u;
+        int best = -1;
+        for (auto v : candidates) {
+            if (live[v] > 0) {
+                // prefer the oldest vertex that will still be in the cache after
+                // its remaining triangles have been emitted
+                int priority = 0;
+                if (time - stamps[v] + 2 * live[v] <= cacheSize) {
+                    priority = int(time - stamps[v]);
+                }
+                if (priority > best) {
+                    best = priority;
+                    next = v;
+                }
+            }
+        }
+        if (next == ~0u) {
+            next = skipDeadEnd();
+            // a dead end is where a new cluster starts
+            if ((clusters != nullptr) && (next != ~0u)) {
+                clusters->push_back(uint32_t(out.size() / 3));
+            }
+        }
+        fan = next;
+    }
+    assert (out.size() == 3 * nTris);
+
+    std::copy (out.begin(), out.end(), indices);
+    if (clusters != nullptr) {
+        clusters->insert(clusters->begin(), 0);
+    }
+
+}
+
+void optimizeOverdraw (
+    uint32_t nIndices,
+    uint32_t *indices,
+    const glm::vec3 *verts,
+    uint32_t nVerts,
+    std::vector<uint32_t> const &clusters,
+    float threshold,
+    uint32_t cacheSize)
+{
+    uint32_t nTris = nIndices / 3;
+    if ((nTris == 0) || clusters.empty()) {
+        return;
+    }
+
+    // split the clusters at points where the ACMR of the part of the cluster
+    // before the split is within the threshold of the ACMR of the whole cluster,
+    // which means that a cache flush at the split point does not cost much.
+    // We keep the pieces from getting too small, since the sort below is only
+    // useful for pieces that cover a reasonable part of the surface.
+    const uint32_t kMinClusterSize = 8;
+    std::vector<uint32_t> starts;
+    __detail::FIFOCache cache(nVerts, cacheSize);
+    for (size_t c = 0;  c < clusters.size();  ++c) {
+        uint32_t start = clusters[c];
+        uint32_t end = (c + 1 < clusters.size()) ? clusters[c+1] : nTris;
+        cache.flush();
+        uint32_t misses0 = cache.misses();
+        for (uint32_t i = start;  i < end;  ++i) {
+            cache.accessTri (indices, i);
+        }
+        float limit = threshold * float(cache.misses() - misses0) / float(end - start);
+
+        starts.push_back(start);
+        cache.flush();
+        misses0 = cache.misses();
+        uint32_t pieceStart = start;
+        for (uint32_t i = start;  i < end;  ++i) {
+            cache.accessTri (indices, i);
+            uint32_t n = i + 1 - pieceStart;
+            if ((n >= kMinClusterSize) && (end - i - 1 >= kMinClusterSize)
+            && (float(cache.misses() - misses0) <= limit * float(n))) {
+                pieceStart = i + 1;
+                starts.push_back(pieceStart);
+                cache.flush();
+                misses0 = cache.misses();
+            }
+        }
+    }
+    uint32_t nClusters = starts.size();
+    starts.push_back(nTris);
+
+    // compute the area-weighted centroid and normal of each cluster, and
+    // the centroid of the whole mesh
+    std::vector<glm::vec3> centroids(nClusters, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(nClusters, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (uint32_t c = 0;  c < nClusters;  ++c) {
+        float area = 0.0f;
+        for (uint32_t i = starts[c];  i < starts[c+1];  ++i) {
+            glm::vec3 p0 = verts[indices[3*i]];
+            glm::vec3 p1 = verts[indices[3*i+1]];
+            glm::vec3 p2 = verts[indices[3*i+2]];
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float a = glm::length(n);
+            centroids[c] += a * (p0 + p1 + p2);
+            normals[c] += n;
+            area += a;
+        }
+        meshCentroid += centroids[c];
+        meshArea += area;
+        if (area > 0.0f) {
+            centroids[c] /= 3.0f * area;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= 3.0f * meshArea;
+    }
+
+    // sort the clusters so that those that face away from the center of the mesh,
+    // which are likely to occlude other parts of the mesh, are drawn first
+    std::vector<float> sortKey(nClusters);
+    std::vector<uint32_t> order(nClusters);
+    for (uint32_t c = 0;  c < nClusters;  ++c) {
+        float len = glm::length(normals[c]);
+        sortKey[c] = (len > 0.0f)
+            ? glm::dot(centroids[c] - meshCentroid, normals[c] / len)
+            : 0.0f;
+        order[c] = c;
+    }
+    std::stable_sort (order.begin(), order.end(),
+        [&sortKey] (uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> out;
+    out.reserve(nIndices);
+    for (auto c : order) {
+        out.insert(out.end(), indices + 3*starts[c], indices + 3*starts[c+1]);
+    }
+    std::copy (out.begin(), out.end(), indices);
+
+}
+
+std::vector<uint32_t> optimizeVertexFetch (uint32_t nIndices, uint32_t *indices, uint32_t nVerts)
+{
+    std::vector<uint32_t> remap(nVerts, ~0u);
+    uint32_t next = 0;
+    for (uint32_t i = 0;  i < nIndices;  ++i) {
+        uint32_t &r = remap[indices[i]];
+        if (r == ~0u) {
+            r = next++;
+        }
+        indices[i] = r;
+    }
+    // unused vertices go at the end
+    for (auto &r : remap) {
+        if (r == ~0u) {
+            r = next++;
+        }
+    }
+    return remap;
+
+}
+
+Stats optimize (
+    uint32_t nVerts,
+    uint32_t nIndices,
+    glm::vec3 *verts,
+    glm::vec3 *norms,
+    glm::vec2 *txtCoords,
+    uint32_t *indices)
+{
+    Stats stats;
+    stats.acmrBefore = acmr (nIndices, indices, nVerts);
+
+    // the reordering passes are heuristics, so they can make a mesh that is
+    // already in a good order worse; in that case we keep the original order
+    std::vector<uint32_t> original(indices, indices + nIndices);
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache (nIndices, indices, nVerts, kVertexCacheSize, &clusters);
+    optimizeOverdraw (nIndices, indices, verts, nVerts, clusters);
+    if (acmr (nIndices, indices, nVerts) >= stats.acmrBefore) {
+        std::copy (original.begin(), original.end(), indices);
+    }
+
+    // renumbering the vertices does not change the ACMR
+    std::vector<uint32_t> remap = optimizeVertexFetch (nIndices, indices, nVerts);
+    remapVertices (remap, verts);
+    remapVertices (remap, norms);
+    remapVertices (remap, txtCoords);
+
+    stats.acmrAfter = acmr (nIndices, indices, nVerts);
+    float tris = float(nIndices / 3);
+    stats.atvrBefore = (nVerts > 0) ? stats.acmrBefore * tris / float(nVerts) : 0.0f;
+    stats.atvrAfter = (nVerts > 0) ? stats.acmrAfter * tris / float(nVerts) : 0.0f;
+
+    return stats;
+
+}
+
+} // namespace mesh
+} // namespace cs237
@@ -0,0 +1,520 @@
+/*! \file mesh-simplify.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Mesh simplification using quadric error metrics and the construction of
+ * level-of-detail chains.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include <queue>
+
+namespace cs237 {
+namespace mesh {
+
+namespace __detail {
+
+// the weight of the quadric terms that protect borders and attribute seams
+// relative to the weight of the triangle planes
+constexpr double kBorderWeight = 10.0;
+
+// a collapse is rejected if it rotates the normal of any of the remaining
+// triangles by more than about 75 degrees (i.e., the cosine of the angle
+// between the old and new normals must be at least this value)
+constexpr float kMinNormalCos = 0.25f;
+
+// a symmetric quadric error function Q(p) = p^T A p + 2 b^T p + c, which
+// is the weighted sum of squared distances from p to a set of planes.  We also
+// track the total weight of the planes, so that the error can be converted to
+// a mean squared distance.  We use doubles, since the sums are ill conditioned.
+struct Quadric {
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double w;
+
+    Quadric ()
+      : a00(0), a01(0), a02(0), a11(0), a12(0), a22(0),
+        b0(0), b1(0), b2(0), c(0), w(0)
+    { }
+
+    // the quadric for the plane dot(n, p) + d = 0 (n is a unit vector) with
+    // weight wt
+    Quadric (glm::dvec3 n, double d, double wt)
+      : a00(wt*n.x*n.x), a01(wt*n.x*n.y), a02(wt*n.x*n.z),
+        a11(wt*n.y*n.y), a12(wt*n.y*n.z), a22(wt*n.z*n.z),
+        b0(wt*d*n.x), b1(wt*d*n.y), b2(wt*d*n.z), c(wt*d*d), w(wt)
+    { }
+
+    Quadric &operator+= (Quadric const &q)
+    {
+        this->a00 += q.a00; this->a01 += q.a01; this->a02 += q.a02;
+        this->a11 += q.a11; this->a12 += q.a12; this->a22 += q.a22;
+        this->b0 += q.b0; this->b1 += q.b1; this->b2 += q.b2;
+        this->c += q.c;
+        this->w += q.w;
+        return *this;
+    }
+
+    // the weighted sum of squared distances from p to the planes
+    double eval (glm::vec3 p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double q = x * (this->a00*x + 2.0*(this->a01*y + this->a02*z + this->b0))
+            + y * (this->a11*y + 2.0*(this->a12*z + this->b1))
+            + z * (this->a22*z + 2.0*this->b2)
+            + this->c;
+        return std::max(q, 0.0);
+    }
+
+};
+
+// a candidate collapse of the vertex with position class `from` onto the
+// vertex with position class `to`.  The stamps are used to discard candidates
+// whose classes have changed since the candidate was computed.
+struct Collapse {
+    float cost;                 // the mean squared distance error of the collapse
+    uint32_t from, to;
+    uint32_t fromStamp, toStamp;
+
+    bool operator> (Collapse const &other) const { return this->cost > other.cost; }
+};
+
+// the distance from p to the triangle abc (see "Real-Time Collision Detection"
+// by Ericson, Section 5.1.5)
+static float pointTriDistance (glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c)
+{
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if ((d1 <= 0.0f) && (d2 <= 0.0f)) {
+        return glm::distance(p, a);
+    }
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if ((d3 >= 0.0f) && (d4 <= d3)) {
+        return glm::distance(p, b);
+    }
+    float vc = d1*d4 - d3*d2;
+    if ((vc <= 0.0f) && (d1 >= 0.0f) && (d3 <= 0.0f)) {
+        return glm::distance(p, a + ab * (d1 / (d1 - d3)));
+    }
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if ((d6 >= 0.0f) && (d5 <= d6)) {
+        return glm::distance(p, c);
+    }
+    float vb = d5*d2 - d1*d6;
+    if ((vb <= 0.0f) && (d2 >= 0.0f) && (d6 <= 0.0f)) {
+        return glm::distance(p, a + ac * (d2 / (d2 - d6)));
+    }
+    float va = d3*d6 - d5*d4;
+    if ((va <= 0.0f) && (d4 - d3 >= 0.0f) && (d5 - d6 >= 0.0f)) {
+        return glm::distance(p, b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+    }
+    float denom = 1.0f / (va + vb + vc);
+    return glm::distance(p, a + ab * (vb * denom) + ac * (vc * denom));
+
+}
+
+// group the vertices that have the same position; returns the class of each
+// vertex (which is the smallest index of a vertex with that position)
+static std::vector<uint32_t> weldVertices (const glm::vec3 *verts, uint32_t nVerts)
+{
+    std::vector<uint32_t> order(nVerts);
+    for (uint32_t v = 0;  v < nVerts;  ++v) {
+        order[v] = v;
+    }
+    auto less = [verts] (uint32_t a, uint32_t b) {
+        if (verts[a].x != verts[b].x) return verts[a].x < verts[b].x;
+        if (verts[a].y != verts[b].y) return verts[a].y < verts[b].y;
+        if (verts[a].z != verts[b].z) return verts[a].z < verts[b].z;
+        return a < b;
+    };
+    std::sort (order.begin(), order.end(), less);
+
+    std::vector<uint32_t> cls(nVerts);
+    for (uint32_t i = 0;  i < nVerts;  ) {
+        uint32_t j = i + 1;
+        while ((j < nVerts) && (verts[order[j]] == verts[order[i]])) {
+            ++j;
+        }
+        // order[i] is the smallest index in the run
+        for (uint32_t k = i;  k < j;  ++k) {
+            cls[order[k]] = order[i];
+        }
+        i = j;
+    }
+    return cls;
+
+}
+
+} // namespace __detail
+
+/* The simplifier works on the "welded" mesh, where the vertices that have the
+ * same position are treated as a single vertex (which we call a class).  A
+ * collapse moves all of the vertices of one class onto the position of an
+ * adjacent class.  Each vertex of the collapsed class is replaced by a vertex
+ * of the target class that it shares a triangle with, so that the attributes
+ * are taken from the same side of any seam; if some vertex of the collapsed
+ * class does not share a triangle with the target, then the collapse would
+ * tear the mesh along a seam and it is rejected.
+ */
+std::vector<uint32_t> simplify (
+    uint32_t nIndices,
+    const uint32_t *indices,
+    const glm::vec3 *verts,
+    uint32_t nVerts,
+    uint32_t targetIndices,
+    float maxError,
+    float *resultError)
+{
+    using __detail::Quadric;
+    using __detail::Collapse;
+
+    uint32_t nTris = nIndices / 3;
+    std::vector<uint32_t> tris(indices, indices + 3 * nTris);
+    if (resultError != nullptr) {
+        *resultError = 0.0f;
+    }
+    if (3 * nTris <= targetIndices) {
+        return tris;
+    }
+
+    std::vector<uint32_t> cls = __detail::weldVertices (verts, nVerts);
+
+    // the quadrics of the classes, which are the sums of the planes of the
+    // triangles around them weighted by area
+    std::vector<Quadric> quadrics(nVerts);
+    for (uint32_t t = 0;  t < nTris;  ++t) {
+        glm::dvec3 p0 = verts[tris[3*t]];
+        glm::dvec3 p1 = verts[tris[3*t+1]];
+        glm::dvec3 p2 = verts[tris[3*t+2]];
+        glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+        double len = glm::length(n);
+        if (len > 0.0) {
+            n /= len;
+            Quadric q(n, -glm::dot(n, p0), 0.5 * len);
+            for (int i = 0;  i < 3;  ++i) {
+                quadrics[cls[tris[3*t+i]]] += q;
+            }
+        }
+    }
+
+    // an edge that belongs to only one triangle, when we use the vertex indices
+    // instead of the classes, is either on a border of the mesh or on an
+    // attribute seam.  We protect these edges by adding the plane that contains
+    // the edge and is perpendicular to the triangle to the quadrics of its ends.
+    {
+        std::vector<std::pair<uint64_t, uint32_t>> edges;
+        edges.reserve(3 * nTris);
+        for (uint32_t t = 0;  t < nTris;  ++t) {
+            for (int i = 0;  i < 3;  ++i) {
+                uint64_t a = tris[3*t+i], b = tris[3*t+(i+1)%3];
+                edges.push_back({ (std::min(a, b) << 32) | std::max(a, b), 3*t+i });
+            }
+        }
+        std::sort (edges.begin(), edges.end());
+        for (size_t i = 0;  i < edges.size();  ) {
+            size_t j = i + 1;
+            while ((j < edges.size()) && (edges[j].first == edges[i].first)) {
+                ++j;
+            }
+            if (j == i + 1) {
+                uint32_t corner = edges[i].second;
+                uint32_t t = corner / 3;
+                glm::dvec3 p0 = verts[tris[corner]];
+                glm::dvec3 p1 = verts[tris[3*t + (corner+1)%3]];
+                glm::dvec3 p2 = verts[tris[3*t + (corner+2)%3]];
+                glm::dvec3 e = p1 - p0;
+                glm::dvec3 n = glm::cross(glm::cross(e, p2 - p0), e);
+                double len = glm::length(n);
+                if (len > 0.0) {
+                    n /= len;
+                    Quadric q(n, -glm::dot(n, p0), __detail::kBorderWeight * glm::dot(e, e));
+                    quadrics[cls[tris[corner]]] += q;
+                    quadrics[cls[tris[3*t + (corner+1)%3]]] += q;
+                }
+            }
+            i = j;
+        }
+    }
+
+    // the live triangles around each class
+    std::vector<std::vector<uint32_t>> classTris(nVerts);
+    for (uint32_t t = 0;  t < nTris;  ++t) {
+        for (int i = 0;  i < 3;  ++i) {
+            auto &ct = classTris[cls[tris[3*t+i]]];
+            if (ct.empty() || (ct.back() != t)) {
+                ct.push_back(t);
+            }
+        }
+    }
+
+    std::vector<uint8_t> triAlive(nTris, 1);
+    std::vector<uint8_t> classAlive(nVerts, 1);
+    std::vector<uint32_t> stamps(nVerts, 0);
+    std::vector<uint32_t> into(nVerts);         // the class that a class was
+                                                // collapsed into (or itself)
+    for (uint32_t v = 0;  v < nVerts;  ++v) {
+        into[v] = v;
+    }
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+    auto cost = [&] (uint32_t from, uint32_t to) {
+        Quadric q = quadrics[from];
+        q += quadrics[to];
+        return (q.w > 0.0) ? float(q.eval(verts[to]) / q.w) : 0.0f;
+    };
+    auto push = [&] (uint32_t from, uint32_t to) {
+        heap.push(Collapse{ cost(from, to), from, to, stamps[from], stamps[to] });
+    };
+
+    for (uint32_t t = 0;  t < nTris;  ++t) {
+        for (int i = 0;  i < 3;  ++i) {
+            uint32_t a = cls[tris[3*t+i]], b = cls[tris[3*t+(i+1)%3]];
+            if (a != b) {
+                push (a, b);
+                push (b, a);
+            }
+        }
+    }
+
+    uint32_t nLive = nTris;
+    float maxErr2 = (maxError < std::sqrt(std::numeric_limits<float>::max()))
+        ? maxError * maxError
+        : std::numeric_limits<float>::max();
+    std::vector<std::pair<uint32_t, uint32_t>> remap;   // vertex substitutions
+    std::vector<uint32_t> neighbors;
+
+    while ((3 * nLive > targetIndices) && !heap.empty()) {
+        Collapse c = heap.top();
+        heap.pop();
+        if (!classAlive[c.from] || !classAlive[c.to]
+        || (stamps[c.from] != c.fromStamp) || (stamps[c.to] != c.toStamp)) {
+            continue;   // stale candidate
+        }
+        if (c.cost > maxErr2) {
+            break;
+        }
+
+        // find the substitute for each vertex of the collapsed class from the
+        // triangles that contain both classes
+        remap.clear();
+        for (uint32_t t : classTris[c.from]) {
+            if (!triAlive[t]) {
+                continue;
+            }
+            for (int i = 0;  i < 3;  ++i) {
+                uint32_t v = tris[3*t+i];
+                if (cls[v] != c.from) {
+                    continue;
+                }
+                for (int j = 0;  j < 3;  ++j) {
+                    uint32_t w = tris[3*t+j];
+                    if (cls[w] == c.to) {
+                        auto it = std::find_if (remap.begin(), remap.end(),
+                            [v] (std::pair<uint32_t, uint32_t> const &p) { return p.first == v; });
+                        if (it == remap.end()) {
+                            remap.push_back({v, w});
+                        }
+                    }
+                }
+            }
+        }
+
+        // check that every vertex has a substitute and that no triangle flips
+        bool ok = !remap.empty();
+        glm::vec3 target = verts[c.to];
+        for (uint32_t t : classTris[c.from]) {
+            if (!ok) {
+                break;
+            }
+            if (!triAlive[t]) {
+                continue;
+            }
+            int k = -1;         // the corner that is in the collapsed class
+            bool shared = false;
+            for (int i = 0;  i < 3;  ++i) {
+                uint32_t ci = cls[tris[3*t+i]];
+                if (ci == c.from) {
+                    k = i;
+                } else if (ci == c.to) {
+                    shared = true;
+                }
+            }
+            if (shared) {
+                continue;       // this triangle will be removed
+            }
+            uint32_t v = tris[3*t+k];
+            if (std::none_of (remap.begin(), remap.end(),
+                [v] (std::pair<uint32_t, uint32_t> const &p) { return p.first == v; }))
+            {
+                ok = false;     // collapsing would tear a seam
+                break;
+            }
+            glm::vec3 p1 = verts[tris[3*t+(k+1)%3]];
+            glm::vec3 p2 = verts[tris[3*t+(k+2)%3]];
+            glm::vec3 n0 = glm::cross(p1 - verts[v], p2 - verts[v]);
+            glm::vec3 n1 = glm::cross(p1 - target, p2 - target);
+            if (glm::dot(n0, n1) < __detail::kMinNormalCos * glm::length(n0) * glm::length(n1)) {
+                ok = false;     // the triangle would flip or fold over
+            }
+        }
+        if (!ok) {
+            continue;
+        }
+
+        // perform the collapse
+        auto &toTris = classTris[c.to];
+        for (uint32_t t : classTris[c.from]) {
+            if (!triAlive[t]) {
+                continue;
+            }
+            bool shared = false;
+            for (int i = 0;  i < 3;  ++i) {
+                shared = shared || (cls[tris[3*t+i]] == c.to);
+            }
+            if (shared) {
+                triAlive[t] = 0;
+                --nLive;
+                continue;
+            }
+            for (int i = 0;  i < 3;  ++i) {
+                uint32_t v = tris[3*t+i];
+                if (cls[v] == c.from) {
+                    for (auto const &p : remap) {
+                        if (p.first == v) {
+                            tris[3*t+i] = p.second;
+                        }
+                    }
+                }
+            }
+            toTris.push_back(t);
+        }
+        quadrics[c.to] += quadrics[c.from];
+        classAlive[c.from] = 0;
+        into[c.from] = c.to;
+        classTris[c.from] = std::vector<uint32_t>();
+        stamps[c.to]++;
+
+        // remove the dead triangles from the target's list and update the
+        // candidates for the edges around it
+        neighbors.clear();
+        uint32_t n = 0;
+        for (uint32_t t : toTris) {
+            if (triAlive[t]) {
+                toTris[n++] = t;
+                for (int i = 0;  i < 3;  ++i) {
+                    uint32_t ci = cls[tris[3*t+i]];
+                    if (ci != c.to) {
+                        neighbors.push_back(ci);
+                    }
+                }
+            }
+        }
+        toTris.resize(n);
+        std::sort (neighbors.begin(), neighbors.end());
+        neighbors.erase (std::unique (neighbors.begin(), neighbors.end()), neighbors.end());
+        for (uint32_t nb : neighbors) {
+            push (c.to, nb);
+            push (nb, c.to);
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(3 * nLive);
+    for (uint32_t t = 0;  t < nTris;  ++t) {
+        if (triAlive[t]) {
+            result.insert(result.end(), &tris[3*t], &tris[3*t+3]);
+        }
+    }
+    // the quadric errors are only useful for ordering the collapses, since they
+    // average over the planes, so we measure the error of the result as the
+    // largest distance from a removed vertex to the triangles within two rings of
+    // the class that it was collapsed into.  This value is an upper bound on the
+    // distance from the removed vertex to the simplified surface.
+    if (resultError != nullptr) {
+        float err = 0.0f;
+        for (uint32_t v = 0;  v < nVerts;  ++v) {
+            if ((cls[v] != v) || classAlive[v]) {
+                continue;   // v is not a class or it was not removed
+            }
+            uint32_t r = into[v];
+            while (into[r] != r) {
+                r = into[r];
+            }
+            into[v] = r;
+            float d = std::numeric_limits<float>::max();
+            for (uint32_t t : classTris[r]) {
+                if (! triAlive[t]) {
+                    continue;
+                }
+                for (int i = 0;  i < 3;  ++i) {
+                    for (uint32_t u : classTris[cls[tris[3*t+i]]]) {
+                        if (triAlive[u]) {
+                            d = std::min(d, __detail::pointTriDistance(verts[v],
+                                verts[tris[3*u]], verts[tris[3*u+1]], verts[tris[3*u+2]]));
+                        }
+                    }
+                }
+            }
+            if (d < std::numeric_limits<float>::max()) {
+                err = std::max(err, d);
+            }
+        }
+        *resultError = err;
+    }
+
+    return result;
+
+}
+
+std::vector<LOD> buildLODs (
+    uint32_t nIndices,
+    const uint32_t *indices,
+    const glm::vec3 *verts,
+    uint32_t nVerts,
+    std::vector<uint32_t> &lodIndices,
+    uint32_t maxLevels)
+{
+    std::vector<LOD> lods;
+    lodIndices.clear();
+
+    std::vector<uint32_t> prev(indices, indices + nIndices);
+    float prevError = 0.0f;
+    for (uint32_t level = 0;  level < maxLevels;  ++level) {
+        uint32_t target = (prev.size() / 6) * 3;
+        if (target < 3 * kMinLODTris) {
+            break;
+        }
+        float err;
+        std::vector<uint32_t> next = simplify (
+            prev.size(), prev.data(), verts, nVerts, target,
+            std::numeric_limits<float>::max(), &err);
+        // stop when the simplifier gets stuck, since the level would not save
+        // enough to be worth its memory
+        if (5 * next.size() > 4 * prev.size()) {
+            break;
+        }
+        optimizeVertexCache (next.size(), next.data(), nVerts);
+        // the error of a level is relative to the previous level, so we
+        // accumulate it to bound the error relative to the original mesh
+        prevError += err;
+        lods.push_back(LOD{ uint32_t(lodIndices.size()), uint32_t(next.size()), prevError });
+        lodIndices.insert(lodIndices.end(), next.begin(), next.end());
+        prev = std::move(next);
+    }
+
+    return lods;
+
+}
+
+} // namespace mesh
+} // namespace cs237
@@ -0,0 +1,54 @@
+/*! \file mesh-util.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Internal helpers shared by the mesh-processing code (mesh-opt.cpp and
+ * meshlet.cpp).
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _MESH_UTIL_HPP_
+#define _MESH_UTIL_HPP_
+
+#include "cs237/cs237.hpp"
+
+namespace cs237 {
+namespace mesh {
+namespace __detail {
+
+// the vertex-to-triangle adjacency of a mesh in compressed-row form: the
+// triangles that use vertex v are tris[offsets[v] .. offsets[v+1]-1].
+struct Adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> tris;
+
+    Adjacency (uint32_t nIndices, const uint32_t *indices, uint32_t nVerts)
+      : offsets(nVerts + 1, 0), tris(nIndices)
+    {
+        for (uint32_t i = 0;  i < nIndices;  ++i) {
+            assert ((indices[i] < nVerts) && "invalid vertex index");
+            this->offsets[indices[i] + 1]++;
+        }
+        for (uint32_t v = 0;  v < nVerts;  ++v) {
+            this->offsets[v + 1] += this->offsets[v];
+        }
+        std::vector<uint32_t> next(this->offsets.begin(), this->offsets.end() - 1);
+        for (uint32_t i = 0;  i < nIndices;  ++i) {
+            this->tris[next[indices[i]]++] = i / 3;
+        }
+    }
+
+    uint32_t degree (uint32_t v) const { return this->offsets[v+1] - this->offsets[v]; }
+};
+
+} // namespace __detail
+} // namespace mesh
+} // namespace cs237
+
+#endif // !_MESH_UTIL_HPP_
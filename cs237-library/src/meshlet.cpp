@@ -0,0 +1,312 @@
+/*! \file meshlet.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Splitting of triangle meshes into meshlets and the computation of the
+ * meshlets' bounding spheres and normal cones.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "mesh-util.hpp"
+#include <limits>
+
+namespace cs237 {
+namespace mesh {
+
+namespace __detail {
+
+// marks a vertex that is not in the current meshlet, or a missing triangle
+constexpr uint32_t kNone = 0xffffffff;
+
+// the number of unemitted triangles that we look at when the current meshlet
+// has no adjacent triangles left
+constexpr uint32_t kDeadEndWindow = 32;
+
+// compute the bounding sphere of a meshlet using Ritter's algorithm, which
+// produces a sphere that is at most a few percent larger than the optimal one.
+static void computeSphere (Meshlet &m, const uint32_t *mVerts, const glm::vec3 *verts)
+{
+    // find an approximate diameter by picking the vertex that is farthest from
+    // the first vertex and then the vertex that is farthest from that one
+    auto farthest = [&] (glm::vec3 p) {
+        glm::vec3 q = p;
+        float maxD2 = -1.0f;
+        for (uint32_t i = 0;  i < m.nVerts;  ++i) {
+            glm::vec3 d = verts[mVerts[i]] - p;
+            float d2 = glm::dot(d, d);
+            if (d2 > maxD2) {
+                maxD2 = d2;
+                q = verts[mVerts[i]];
+            }
+        }
+        return q;
+    };
+    glm::vec3 a = farthest(verts[mVerts[0]]);
+    glm::vec3 b = farthest(a);
+    glm::vec3 center = 0.5f * (a + b);
+    float radius = 0.5f * glm::distance(a, b);
+
+    // grow the sphere to include any vertices that are outside it
+    for (uint32_t i = 0;  i < m.nVerts;  ++i) {
+        glm::vec3 p = verts[mVerts[i]];
+        float d = glm::distance(p, center);
+        if (d > radius) {
+            float newR = 0.5f * (radius + d);
+            center += (p - center) * ((newR - radius) / d);
+            radius = newR;
+        }
+    }
+
+    m.center = center;
+    m.radius = radius;
+
+}
+
+// compute the normal cone of a meshlet from its triangles' unit normals
+static void computeCone (Meshlet &m, const glm::vec3 *triNorms)
+{
+    glm::vec3 sum(0.0f);
+    for (uint32_t i = 0;  i < m.nTris;  ++i) {
+        sum += triNorms[i];
+    }
+    float len = glm::length(sum);
+    if (len < 1.0e-6f) {
+        // the normals cancel out, so the cone is useless
+        m.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        m.coneCutoff = 1.0f;
+        return;
+    }
+    m.coneAxis = sum / len;
+
+    // the cone's half angle is determined by the normal that is farthest
+    // from the axis; we ignore degenerate triangles, which have a zero normal
+    float minDot = 1.0f;
+    for (uint32_t i = 0;  i < m.nTris;  ++i) {
+        if (triNorms[i] != glm::vec3(0.0f)) {
+            minDot = std::min(minDot, glm::dot(triNorms[i], m.coneAxis));
+        }
+    }
+
+    // a meshlet whose normals span (nearly) a hemisphere can never be culled
+    // as a whole, so we disable the test for it.  Otherwise, the meshlet is
+    // back facing when the angle between the view direction and the axis is
+    // less than 90 degrees minus the half angle, so the cutoff is the sine of
+    // the half angle.
+    if (minDot <= 0.1f) {
+        m.coneCutoff = 1.0f;
+    } else {
+        m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+}
+
+} // namespace __detail
+
+std::vector<uint32_t> Meshlets::indices () const
+{
+    std::vector<uint32_t> result(this->tris.size());
+    this->indices (result.data());
+    return result;
+
+}
+
+void Meshlets::indices (uint32_t *dst) const
+{
+    for (auto const &m : this->meshlets) {
+        const uint8_t *tri = this->tris.data() + 3 * m.firstTri;
+        for (uint32_t i = 0;  i < 3 * m.nTris;  ++i) {
+            *dst++ = this->verts[m.firstVert + tri[i]];
+        }
+    }
+
+}
+
+Meshlets buildMeshlets (
+    uint32_t nIndices,
+    const uint32_t *indices,
+    const glm::vec3 *verts,
+    uint32_t nVerts,
+    uint32_t maxVerts,
+    uint32_t maxTris)
+{
+    using __detail::kNone;
+    using __detail::kDeadEndWindow;
+
+    assert ((3 <= maxVerts) && (maxVerts <= 256) && "invalid vertex limit");
+    assert ((maxTris > 0) && "invalid triangle limit");
+
+    Meshlets result;
+    uint32_t nTris = nIndices / 3;
+    if (nTris == 0) {
+        return result;
+    }
+
+    __detail::Adjacency adj(nIndices, indices, nVerts);
+
+    // the unit normals of the triangles (zero for degenerate triangles)
+    std::vector<glm::vec3> triNorms(nTris);
+    for (uint32_t t = 0;  t < nTris;  ++t) {
+        glm::vec3 n = glm::cross(
+            verts[indices[3*t+1]] - verts[indices[3*t]],
+            verts[indices[3*t+2]] - verts[indices[3*t]]);
+        float len = glm::length(n);
+        triNorms[t] = (len > 0.0f) ? n / len : glm::vec3(0.0f);
+    }
+
+    // the centroids of the triangles
+    std::vector<glm::vec3> centroids(nTris);
+    for (uint32_t t = 0;  t < nTris;  ++t) {
+        centroids[t] = (verts[indices[3*t]] + verts[indices[3*t+1]] + verts[indices[3*t+2]])
+            * (1.0f / 3.0f);
+    }
+
+    std::vector<uint8_t> emitted(nTris, 0);
+    std::vector<uint32_t> local(nVerts, kNone); // local index of vertices in the
+                                                // current meshlet
+    std::vector<uint32_t> candidates;           // unemitted triangles that are
+                                                // adjacent to the current meshlet
+                                                // (may contain emitted triangles
+                                                // and duplicates)
+    std::vector<glm::vec3> curNorms;            // normals of the current meshlet's
+                                                // triangles
+    glm::vec3 normSum(0.0f);                    // sum of `curNorms`
+    glm::vec3 centroidSum(0.0f);                // sum of the current meshlet's
+                                                // triangle centroids
+    uint32_t seed = 0;                          // lower bound on the first
+                                                // unemitted triangle
+
+    Meshlet cur{};
+
+    // the number of vertices that adding triangle t would add to the meshlet
+    auto newVerts = [&] (uint32_t t) {
+        return uint32_t(local[indices[3*t]] == kNone)
+            + uint32_t(local[indices[3*t+1]] == kNone)
+            + uint32_t(local[indices[3*t+2]] == kNone);
+    };
+
+    // add triangle t to the current meshlet
+    auto add = [&] (uint32_t t) {
+        for (int i = 0;  i < 3;  ++i) {
+            uint32_t v = indices[3*t+i];
+            if (local[v] == kNone) {
+                local[v] = cur.nVerts++;
+                result.verts.push_back(v);
+                // the triangles that share the new vertex are now candidates
+                for (uint32_t j = adj.offsets[v];  j < adj.offsets[v+1];  ++j) {
+                    if (!emitted[adj.tris[j]]) {
+                        candidates.push_back(adj.tris[j]);
+                    }
+                }
+            }
+            result.tris.push_back(uint8_t(local[v]));
+        }
+        cur.nTris++;
+        emitted[t] = 1;
+        curNorms.push_back(triNorms[t]);
+        normSum += triNorms[t];
+        centroidSum += centroids[t];
+    };
+
+    // finish the current meshlet (if it is not empty) and start a new one
+    auto finish = [&] () {
+        if (cur.nTris > 0) {
+            const uint32_t *mVerts = result.verts.data() + cur.firstVert;
+            for (uint32_t i = 0;  i < cur.nVerts;  ++i) {
+                local[mVerts[i]] = kNone;
+            }
+            __detail::computeSphere (cur, mVerts, verts);
+            __detail::computeCone (cur, curNorms.data());
+            result.meshlets.push_back(cur);
+        }
+        cur = Meshlet{};
+        cur.firstVert = result.verts.size();
+        cur.firstTri = result.tris.size() / 3;
+        candidates.clear();
+        curNorms.clear();
+        normSum = glm::vec3(0.0f);
+        centroidSum = glm::vec3(0.0f);
+    };
+
+    for (uint32_t nEmitted = 0;  nEmitted < nTris;  ++nEmitted) {
+        if (cur.nTris == maxTris) {
+            finish();
+        }
+
+        uint32_t best = kNone;
+        if (cur.nTris > 0) {
+            float len = glm::length(normSum);
+            glm::vec3 axis = (len > 0.0f) ? normSum / len : glm::vec3(0.0f);
+            glm::vec3 center = centroidSum / float(cur.nTris);
+            // pick the candidate that adds the fewest vertices, breaking ties by
+            // distance from the center of the meshlet (which keeps the meshlet
+            // compact) and by orientation (which keeps the normal cone narrow).
+            // We also remove the emitted triangles from the candidate list.
+            uint32_t bestNV = 4;
+            float bestScore = std::numeric_limits<float>::max();
+            uint32_t n = 0;
+            for (uint32_t t : candidates) {
+                if (emitted[t]) {
+                    continue;
+                }
+                candidates[n++] = t;
+                uint32_t nv = newVerts(t);
+                if ((cur.nVerts + nv > maxVerts) || (nv > bestNV)) {
+                    continue;
+                }
+                glm::vec3 d = centroids[t] - center;
+                float score = glm::dot(d, d) * (2.0f - glm::dot(triNorms[t], axis));
+                if ((nv < bestNV) || (score < bestScore)) {
+                    best = t;
+                    bestNV = nv;
+                    bestScore = score;
+                }
+            }
+            candidates.resize(n);
+
+            // at a dead end (e.g., where the mesh is disconnected), we look for
+            // the closest of the next few unemitted triangles in input order
+            if ((best == kNone) && (cur.nVerts + 3 <= maxVerts)) {
+                while (emitted[seed]) {
+                    seed++;
+                }
+                for (uint32_t t = seed, k = 0;  (t < nTris) && (k < kDeadEndWindow);  ++t) {
+                    if (!emitted[t]) {
+                        glm::vec3 d = centroids[t] - center;
+                        float score = glm::dot(d, d);
+                        if (score < bestScore) {
+                            best = t;
+                            bestScore = score;
+                        }
+                        ++k;
+                    }
+                }
+            }
+        }
+
+        if (best == kNone) {
+            // no triangle can be added to the meshlet, so we start a new one
+            // from the next unemitted triangle in input order
+            finish();
+            while (emitted[seed]) {
+                seed++;
+            }
+            best = seed;
+        }
+
+        add (best);
+    }
+    finish();
+
+    return result;
+
+}
+
+} // namespace mesh
+} // namespace cs237
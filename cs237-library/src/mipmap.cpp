@@ -0,0 +1,334 @@
+/*! \file mipmap.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * A CPU generator for mipmap levels.  The levels are computed with a box
+ * filter whose footprint is the area of the source image covered by the
+ * destination pixel, which gives correct weights for odd (and otherwise
+ * non-power-of-two) sizes: a destination pixel covers two source pixels
+ * per axis when the source size is even and up to three (with fractional
+ * weights) when it is odd.
+ *
+ * The filter is separable.  Each source row is converted to floats (sRGB
+ * data is converted to linear values) and filtered horizontally once, and
+ * then the filtered rows are combined vertically using SSE2 when it is
+ * available.  The rows of a level are filtered in parallel when a job
+ * system is provided.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "pixel-convert.hpp"
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cs237 {
+
+namespace __detail {
+
+// the number of destination rows that are computed by a single job
+constexpr uint32_t kMipRowsPerJob = 16;
+
+// the source pixels that contribute to a destination pixel along one axis;
+// there are at most three of them, since the source is less than three times
+// the size of the destination.
+struct Taps {
+    uint32_t first;     // the index of the first source pixel
+    uint32_t n;         // the number of source pixels (1..3)
+    float wt[3];        // the normalized weights of the source pixels
+};
+
+// compute the taps for each destination pixel along an axis
+static std::vector<Taps> computeTaps (uint32_t srcSz, uint32_t dstSz)
+{
+    std::vector<Taps> taps(dstSz);
+    double scale = double(srcSz) / double(dstSz);
+    for (uint32_t i = 0;  i < dstSz;  ++i) {
+        double lo = double(i) * scale;
+        double hi = double(i + 1) * scale;
+        uint32_t first = uint32_t(lo);
+        uint32_t last = std::min(uint32_t(std::ceil(hi)), srcSz);
+        taps[i].first = first;
+        taps[i].n = last - first;
+        assert ((0 < taps[i].n) && (taps[i].n <= 3));
+        for (uint32_t k = 0;  k < taps[i].n;  ++k) {
+            double pixLo = std::max(lo, double(first + k));
+            double pixHi = std::min(hi, double(first + k + 1));
+            taps[i].wt[k] = float((pixHi - pixLo) / scale);
+        }
+    }
+    return taps;
+}
+
+// convert a row of pixels to floats
+template <typename T>
+static void loadRow (const T *src, size_t n, float *dst)
+{
+    for (size_t i = 0;  i < n;  ++i) {
+        dst[i] = float(src[i]);
+    }
+}
+
+// convert a row of floats to pixels by rounding and clamping
+template <typename T>
+static void storeRow (const float *src, size_t n, T *dst)
+{
+    constexpr double lo = double(std::numeric_limits<T>::lowest());
+    constexpr double hi = double(std::numeric_limits<T>::max());
+    for (size_t i = 0;  i < n;  ++i) {
+        double v = std::round(double(src[i]));
+        dst[i] = T(std::min(std::max(v, lo), hi));
+    }
+}
+
+template <>
+void storeRow<float> (const float *src, size_t n, float *dst)
+{
+    std::memcpy (dst, src, n * sizeof(float));
+}
+
+// the state for computing one mipmap level from the previous level
+struct MipLevelBuilder {
+    Image2D const *src;
+    Image2D *dst;
+    uint32_t nCh;               // number of channels
+    int alphaCh;                // index of the alpha channel or -1
+    bool sRGB;                  // true for U8 sRGB data
+    std::vector<Taps> colTaps;  // horizontal taps for each destination column
+    std::vector<Taps> rowTaps;  // vertical taps for each destination row
+
+    MipLevelBuilder (Image2D const *s, Image2D *d)
+      : src(s), dst(d), nCh(s->nChannels()),
+        sRGB(s->isSRGB() && (s->type() == ChannelTy::U8)),
+        colTaps(computeTaps(s->width(), d->width())),
+        rowTaps(computeTaps(s->height(), d->height()))
+    {
+        Channels ch = s->channels();
+        this->alphaCh = ((ch == Channels::RGBA) || (ch == Channels::BGRA)) ? 3 : -1;
+    }
+
+    // load source row `y` as floats
+    void loadSrcRow (uint32_t y, float *row) const;
+
+    // filter a source row horizontally
+    void filterRow (const float *in, float *out) const;
+
+    // store a filtered row as destination row `y`
+    void storeDstRow (uint32_t y, const float *row) const;
+
+    // compute the destination rows [y0..y1)
+    void buildRows (uint32_t y0, uint32_t y1) const;
+};
+
+void MipLevelBuilder::loadSrcRow (uint32_t y, float *row) const
+{
+    size_t n = size_t(this->src->width()) * this->nCh;
+    const char *p = static_cast<const char *>(this->src->data())
+        + size_t(y) * this->src->width() * this->src->nBytesPerPixel();
+    switch (this->src->type()) {
+    case ChannelTy::U8:
+        if (this->sRGB) {
+            auto const &tbl = srgbTables().toLinear;
+            const uint8_t *px = reinterpret_cast<const uint8_t *>(p);
+            for (size_t i = 0;  i < n;  ++i) {
+                row[i] = ((i % this->nCh) == uint32_t(this->alphaCh))
+                    ? float(px[i]) / 255.0f
+                    : tbl[px[i]];
+            }
+        } else {
+            loadRow (reinterpret_cast<const uint8_t *>(p), n, row);
+        }
+        break;
+    case ChannelTy::S8: loadRow (reinterpret_cast<const int8_t *>(p), n, row); break;
+    case ChannelTy::U16: loadRow (reinterpret_cast<const uint16_t *>(p), n, row); break;
+    case ChannelTy::S16: loadRow (reinterpret_cast<const int16_t *>(p), n, row); break;
+    case ChannelTy::U32: loadRow (reinterpret_cast<const uint32_t *>(p), n, row); break;
+    case ChannelTy::S32: loadRow (reinterpret_cast<const int32_t *>(p), n, row); break;
+    case ChannelTy::F32: loadRow (reinterpret_cast<const float *>(p), n, row); break;
+    default:
+        ERROR("unknown channel type");
+    }
+}
+
+void MipLevelBuilder::filterRow (const float *in, float *out) const
+{
+    uint32_t nCh = this->nCh;
+    uint32_t wid = this->dst->width();
+#if defined(__SSE2__)
+    if (nCh == 4) {
+        // one pixel per SSE register
+        for (uint32_t x = 0;  x < wid;  ++x) {
+            Taps const &t = this->colTaps[x];
+            const float *px = in + 4 * t.first;
+            __m128 sum = _mm_mul_ps(_mm_loadu_ps(px), _mm_set1_ps(t.wt[0]));
+            for (uint32_t k = 1;  k < t.n;  ++k) {
+                sum = _mm_add_ps(sum,
+                    _mm_mul_ps(_mm_loadu_ps(px + 4 * k), _mm_set1_ps(t.wt[k])));
+            }
+            _mm_storeu_ps(out + 4 * x, sum);
+        }
+        return;
+    }
+#endif
+    for (uint32_t x = 0;  x < wid;  ++x) {
+        Taps const &t = this->colTaps[x];
+        const float *px = in + nCh * t.first;
+        for (uint32_t c = 0;  c < nCh;  ++c) {
+            float sum = t.wt[0] * px[c];
+            for (uint32_t k = 1;  k < t.n;  ++k) {
+                sum += t.wt[k] * px[nCh * k + c];
+            }
+            out[nCh * x + c] = sum;
+        }
+    }
+}
+
+void MipLevelBuilder::storeDstRow (uint32_t y, const float *row) const
+{
+    size_t n = size_t(this->dst->width()) * this->nCh;
+    char *p = static_cast<char *>(this->dst->data())
+        + size_t(y) * this->dst->width() * this->dst->nBytesPerPixel();
+    switch (this->dst->type()) {
+    case ChannelTy::U8:
+        if (this->sRGB) {
+            auto const &tbl = srgbTables().fromLinear;
+            uint8_t *px = reinterpret_cast<uint8_t *>(p);
+            for (size_t i = 0;  i < n;  ++i) {
+                float v = std::min(std::max(row[i], 0.0f), 1.0f);
+                if ((i % this->nCh) == uint32_t(this->alphaCh)) {
+                    px[i] = uint8_t(std::lround(255.0f * v));
+                } else {
+                    px[i] = tbl[std::lround(v * float(kLinearToSRGBSz - 1))];
+                }
+            }
+        } else {
+            storeRow (row, n, reinterpret_cast<uint8_t *>(p));
+        }
+        break;
+    case ChannelTy::S8: storeRow (row, n, reinterpret_cast<int8_t *>(p)); break;
+    case ChannelTy::U16: storeRow (row, n, reinterpret_cast<uint16_t *>(p)); break;
+    case ChannelTy::S16: storeRow (row, n, reinterpret_cast<int16_t *>(p)); break;
+    case ChannelTy::U32: storeRow (row, n, reinterpret_cast<uint32_t *>(p)); break;
+    case ChannelTy::S32: storeRow (row, n, reinterpret_cast<int32_t *>(p)); break;
+    case ChannelTy::F32: storeRow (row, n, reinterpret_cast<float *>(p)); break;
+    default:
+        ERROR("unknown channel type");
+    }
+}
+
+void MipLevelBuilder::buildRows (uint32_t y0, uint32_t y1) const
+{
+    // the range of source rows that contribute to the destination rows
+    uint32_t srcY0 = this->rowTaps[y0].first;
+    uint32_t srcY1 = this->rowTaps[y1-1].first + this->rowTaps[y1-1].n;
+
+    // load and horizontally filter the source rows
+    size_t srcN = size_t(this->src->width()) * this->nCh;
+    size_t dstN = size_t(this->dst->width()) * this->nCh;
+    std::vector<float> srcRow(srcN);
+    std::vector<float> filtered((srcY1 - srcY0) * dstN);
+    for (uint32_t y = srcY0;  y < srcY1;  ++y) {
+        this->loadSrcRow (y, srcRow.data());
+        this->filterRow (srcRow.data(), &filtered[(y - srcY0) * dstN]);
+    }
+
+    // combine the filtered rows vertically
+    std::vector<float> out(dstN);
+    for (uint32_t y = y0;  y < y1;  ++y) {
+        Taps const &t = this->rowTaps[y];
+        const float *rows[3];
+        for (uint32_t k = 0;  k < t.n;  ++k) {
+            rows[k] = &filtered[(t.first + k - srcY0) * dstN];
+        }
+        size_t i = 0;
+#if defined(__SSE2__)
+        __m128 w0 = _mm_set1_ps(t.wt[0]);
+        __m128 w1 = _mm_set1_ps((t.n > 1) ? t.wt[1] : 0.0f);
+        __m128 w2 = _mm_set1_ps((t.n > 2) ? t.wt[2] : 0.0f);
+        if (t.n == 3) {
+            for (;  i + 4 <= dstN;  i += 4) {
+                __m128 sum = _mm_add_ps(
+                    _mm_add_ps(
+                        _mm_mul_ps(_mm_loadu_ps(rows[0] + i), w0),
+                        _mm_mul_ps(_mm_loadu_ps(rows[1] + i), w1)),
+                    _mm_mul_ps(_mm_loadu_ps(rows[2] + i), w2));
+                _mm_storeu_ps(&out[i], sum);
+            }
+        } else if (t.n == 2) {
+            for (;  i + 4 <= dstN;  i += 4) {
+                __m128 sum = _mm_add_ps(
+                    _mm_mul_ps(_mm_loadu_ps(rows[0] + i), w0),
+                    _mm_mul_ps(_mm_loadu_ps(rows[1] + i), w1));
+                _mm_storeu_ps(&out[i], sum);
+            }
+        }
+#endif
+        for (;  i < dstN;  ++i) {
+            float sum = t.wt[0] * rows[0][i];
+            for (uint32_t k = 1;  k < t.n;  ++k) {
+                sum += t.wt[k] * rows[k][i];
+            }
+            out[i] = sum;
+        }
+        this->storeDstRow (y, out.data());
+    }
+}
+
+} // namespace __detail
+
+uint32_t numMipLevels (uint32_t wid, uint32_t ht)
+{
+    uint32_t n = 1;
+    for (uint32_t sz = std::max(wid, ht);  sz > 1;  sz >>= 1) {
+        n++;
+    }
+    return n;
+}
+
+std::vector<Image2D *> generateMipLevels (Image2D const *img, JobSystem *jobs)
+{
+    if ((img->type() == ChannelTy::UNKNOWN) || (img->channels() == Channels::UNKNOWN)) {
+        ERROR("unable to generate mipmap levels for image of unknown format");
+    }
+
+    std::vector<Image2D *> levels;
+    Image2D const *src = img;
+    while ((src->width() > 1) || (src->height() > 1)) {
+        uint32_t wid = std::max(uint32_t(src->width()) >> 1, 1u);
+        uint32_t ht = std::max(uint32_t(src->height()) >> 1, 1u);
+        Image2D *dst = new Image2D (wid, ht, img->channels(), img->type(), img->isSRGB());
+        __detail::MipLevelBuilder bldr(src, dst);
+
+        // each level depends on the previous one, so we wait for the rows of a
+        // level to be finished before starting the next level
+        std::vector<Job *> pending;
+        for (uint32_t y = 0;  y < ht;  y += __detail::kMipRowsPerJob) {
+            uint32_t endY = std::min(y + __detail::kMipRowsPerJob, ht);
+            if ((jobs != nullptr) && (ht > __detail::kMipRowsPerJob)) {
+                pending.push_back (jobs->spawn (
+                    [&bldr, y, endY] () { bldr.buildRows (y, endY); }));
+            } else {
+                bldr.buildRows (y, endY);
+            }
+        }
+        for (auto job : pending) {
+            jobs->wait (job);
+        }
+
+        levels.push_back (dst);
+        src = dst;
+    }
+
+    return levels;
+
+}
+
+} /* namespace cs237 */
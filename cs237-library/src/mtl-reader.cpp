@@ -22,10 +22,14 @@ namespace OBJ {
 
 namespace __details {
 
-// return the directory part of a pathname
-static std::string dirName (std::string const &path)
+// the path of a file that is relative to the directory of `path`
+static std::string relPath (std::string const &path, std::string const &file)
 {
-    return path.substr(0, path.find_last_of('/'));
+    size_t pos = path.find_last_of('/');
+    if (pos == std::string::npos) {
+        return file;
+    }
+    return path.substr(0, pos) + "/" + file;
 }
 
 // scan one or more floats from a string
@@ -73,7 +77,7 @@ bool ReadMaterial (
     std::string const &m,
     std::vector<Material> &materials)
 {
-    std::string file = dirName(path) + "/" + m;
+    std::string file = relPath(path, m);
     int lnum = 0;
     std::ifstream inS(file);
     if (inS.fail()) {
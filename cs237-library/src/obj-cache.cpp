@@ -0,0 +1,567 @@
+/*! \file obj-cache.cpp
+ *
+ * Binary cache files for OBJ models.
+ *
+ * A cache file holds the data for an `OBJ::Model` (i.e., the bounding box, the
+ * materials, and the de-duplicated vertex and index arrays for each group) in
+ * a form that can be used directly from a memory-mapped file.  The file has the
+ * following layout, where strings are represented by a 32-bit length followed
+ * by the characters:
+ *
+ *      header          magic number, version, sizes of the vector types, and
+ *                      flags that record how the model was built
+ *      stamps          the size, modification time, and hash of the OBJ file
+ *                      and of its material library
+ *      mtllib name
+ *      bounding box
+ *      materials
+ *      group table     name, material, counts, and the offsets of the arrays
+ *      group data      the vertex, normal, texture-coordinate, and index arrays,
+ *                      followed by the level-of-detail table and index array
+ *                      (if any); each array is aligned to a 16-byte boundary.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "obj.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace OBJ {
+
+namespace __details {
+
+static const char kMagic[8] = { 'O', 'B', 'J', 'C', 'A', 'C', 'H', 'E' };
+static const uint32_t kVersion = 4;
+static const size_t kAlign = 16;
+
+// flags in the header
+static const uint32_t kOptimized = 1;   // the group meshes have been optimized
+static const uint32_t kLODs = 2;        // levels of detail have been built
+
+// flags for the optional group arrays
+static const uint32_t kHasNorms = 1;
+static const uint32_t kHasTxtCoords = 2;
+
+// the identity of a source file; a cache is valid if the stamps of its sources
+// match the current state of the files.
+struct FileStamp {
+    uint64_t size;              // the size of the file in bytes
+    int64_t mtime;              // the modification time in file-clock ticks
+    uint64_t hash;              // hash of the file's contents
+};
+
+// a fast 64-bit hash of a block of memory; this is used to detect changes in
+// the contents of files, not for hash tables.
+static uint64_t hashBytes (const char *data, size_t sz)
+{
+    const uint64_t k0 = 0x9e3779b97f4a7c15ull;
+    const uint64_t k1 = 0xbf58476d1ce4e5b9ull;
+    uint64_t h = k0 ^ (sz * k1);
+    size_t i = 0;
+    for (;  i + 8 <= sz;  i += 8) {
+        uint64_t w;
+        std::memcpy (&w, data + i, 8);
+        w *= k1;
+        w ^= w >> 31;
+        h = (h ^ w) * k0;
+    }
+    if (i < sz) {
+        uint64_t w = 0;
+        std::memcpy (&w, data + i, sz - i);
+        w *= k1;
+        w ^= w >> 31;
+        h = (h ^ w) * k0;
+    }
+    h ^= h >> 29;
+    h *= k1;
+    h ^= h >> 32;
+    return h;
+}
+
+// get the size and modification time of a file
+static bool statFile (std::string const &file, FileStamp &stamp)
+{
+    std::error_code ec;
+    auto sz = std::filesystem::file_size (file, ec);
+    if (ec) {
+        return false;
+    }
+    auto t = std::filesystem::last_write_time (file, ec);
+    if (ec) {
+        return false;
+    }
+    stamp.size = sz;
+    stamp.mtime = t.time_since_epoch().count();
+    stamp.hash = 0;
+    return true;
+}
+
+// compute the stamp for a file, including the hash of its contents
+static bool stampFile (std::string const &file, FileStamp &stamp)
+{
+    if (! statFile (file, stamp)) {
+        return false;
+    }
+    cs237::MappedFile f(file);
+    if (! f.isValid() || (f.size() != stamp.size)) {
+        return false;
+    }
+    stamp.hash = hashBytes (f.data(), f.size());
+    return true;
+}
+
+// the size recorded for a material library that does not exist
+static const uint64_t kMissing = ~uint64_t(0);
+
+// check a file against its stamp in the cache.  The modification time is
+// checked first; if it differs, then we fall back to comparing the hash of
+// the contents, since copying or checking out a file changes its time but
+// not its contents.  If the file matches, then `cur` is set to its current
+// stamp, which differs from `stamp` when only the time has changed.
+static bool checkStamp (std::string const &file, FileStamp const &stamp, FileStamp &cur)
+{
+    if (! statFile (file, cur)) {
+        cur = stamp;
+        return (stamp.size == kMissing);
+    }
+    if (cur.size != stamp.size) {
+        return false;
+    }
+    if (cur.mtime == stamp.mtime) {
+        cur.hash = stamp.hash;
+        return true;
+    }
+    return stampFile (file, cur) && (cur.hash == stamp.hash);
+}
+
+// check that the indices of a mesh are in range
+static bool checkIndices (const uint32_t *indices, uint32_t n, uint32_t nVerts)
+{
+    for (uint32_t i = 0;  i < n;  i++) {
+        if (indices[i] >= nVerts) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the path of a model's material library, which is relative to the directory
+// of the OBJ file (see ReadMaterial)
+static std::string mtlPath (std::string const &objFile, std::string const &mtlLib)
+{
+    size_t pos = objFile.find_last_of('/');
+    if (pos == std::string::npos) {
+        return mtlLib;
+    }
+    return objFile.substr(0, pos) + "/" + mtlLib;
+}
+
+// helper class for reading the metadata from a mapped cache file; all reads are
+// bounds checked, since the file might be truncated or corrupted.
+class CacheReader {
+public:
+    CacheReader (const char *data, size_t sz) : _data(data), _sz(sz), _pos(0), _ok(true) { }
+
+    bool ok () const { return this->_ok; }
+
+    // the offset of the next read
+    size_t pos () const { return this->_pos; }
+
+    // mark the data as invalid
+    void fail () { this->_ok = false; }
+
+    template <typename T>
+    T get ()
+    {
+        T v{};
+        if (this->_ok && (this->_pos + sizeof(T) <= this->_sz)) {
+            std::memcpy (&v, this->_data + this->_pos, sizeof(T));
+            this->_pos += sizeof(T);
+        } else {
+            this->_ok = false;
+        }
+        return v;
+    }
+
+    std::string getString ()
+    {
+        uint32_t len = this->get<uint32_t>();
+        if (this->_ok && (this->_pos + len <= this->_sz)) {
+            std::string s(this->_data + this->_pos, len);
+            this->_pos += len;
+            return s;
+        }
+        this->_ok = false;
+        return std::string();
+    }
+
+    // get a pointer to an array of n elements at the given offset
+    template <typename T>
+    T *getArray (uint64_t offset, uint32_t n)
+    {
+        if (! this->_ok
+        || (offset % kAlign != 0)
+        || (offset > this->_sz)
+        || (uint64_t(n) * sizeof(T) > this->_sz - offset)) {
+            this->_ok = false;
+            return nullptr;
+        }
+        return reinterpret_cast<T *>(const_cast<char *>(this->_data + offset));
+    }
+
+private:
+    const char *_data;
+    size_t _sz;
+    size_t _pos;
+    bool _ok;
+};
+
+// helper class for building the contents of a cache file
+class CacheWriter {
+public:
+    template <typename T>
+    void put (T const &v)
+    {
+        this->_buf.append (reinterpret_cast<const char *>(&v), sizeof(T));
+    }
+
+    void putString (std::string const &s)
+    {
+        this->put (static_cast<uint32_t>(s.size()));
+        this->_buf.append (s);
+    }
+
+    // reserve space for a 64-bit offset that will be filled in later
+    size_t reserveOffset ()
+    {
+        size_t pos = this->_buf.size();
+        this->put (uint64_t(0));
+        return pos;
+    }
+
+    // append an array at the next aligned offset and patch the offset at `pos`
+    void putArray (size_t pos, const void *data, size_t sz)
+    {
+        if (data == nullptr) {
+            return;
+        }
+        this->_buf.resize ((this->_buf.size() + kAlign - 1) & ~(kAlign - 1), '\0');
+        uint64_t offset = this->_buf.size();
+        std::memcpy (&this->_buf[pos], &offset, sizeof(offset));
+        this->_buf.append (static_cast<const char *>(data), sz);
+    }
+
+    std::string const &contents () const { return this->_buf; }
+
+private:
+    std::string _buf;
+};
+
+static void putMaterial (CacheWriter &w, Material const &m)
+{
+    w.putString (m.name);
+    w.put (static_cast<int32_t>(m.illum));
+    w.put (static_cast<int32_t>(m.ambientC));
+    w.put (static_cast<int32_t>(m.emissiveC));
+    w.put (static_cast<int32_t>(m.diffuseC));
+    w.put (static_cast<int32_t>(m.specularC));
+    w.put (m.ambient);
+    w.put (m.emissive);
+    w.put (m.diffuse);
+    w.put (m.specular);
+    w.put (m.shininess);
+    w.putString (m.ambientMap);
+    w.putString (m.emissiveMap);
+    w.putString (m.diffuseMap);
+    w.putString (m.specularMap);
+    w.putString (m.normalMap);
+}
+
+static Material getMaterial (CacheReader &r)
+{
+    Material m;
+    m.name = r.getString();
+    m.illum = r.get<int32_t>();
+    m.ambientC = r.get<int32_t>();
+    m.emissiveC = r.get<int32_t>();
+    m.diffuseC = r.get<int32_t>();
+    m.specularC = r.get<int32_t>();
+    m.ambient = r.get<glm::vec3>();
+    m.emissive = r.get<glm::vec3>();
+    m.diffuse = r.get<glm::vec3>();
+    m.specular = r.get<glm::vec3>();
+    m.shininess = r.get<float>();
+    m.ambientMap = r.getString();
+    m.emissiveMap = r.getString();
+    m.diffuseMap = r.getString();
+    m.specularMap = r.getString();
+    m.normalMap = r.getString();
+    return m;
+}
+
+} // namespace __details
+
+bool Model::_readCache (std::string const &cacheFile)
+{
+    cs237::MappedFile *f = new cs237::MappedFile (cacheFile);
+    if (! f->isValid() || ! this->_loadCache (f->data(), f->size(), cacheFile, true)) {
+        delete f;
+        return false;
+    }
+    this->_cache = f;
+
+    return true;
+
+}
+
+bool Model::_loadCache (
+    const char *data, size_t sz,
+    std::string const &cacheFile,
+    bool checkSources)
+{
+    using namespace __details;
+
+    CacheReader r(data, sz);
+
+  // check the header
+    char magic[8];
+    for (int i = 0;  i < 8;  i++) {
+        magic[i] = r.get<char>();
+    }
+    if (!r.ok()
+    || (std::memcmp(magic, kMagic, 8) != 0)
+    || (r.get<uint32_t>() != kVersion)
+    || (r.get<uint32_t>() != sizeof(glm::vec3))
+    || (r.get<uint32_t>() != sizeof(glm::vec2))) {
+        return false;
+    }
+    uint32_t buildFlags = r.get<uint32_t>();
+    if (checkSources
+    && (buildFlags != ((Model::_optimizeMeshes ? kOptimized : 0)
+            | (Model::_buildLODs ? kLODs : 0)))) {
+        return false;
+    }
+
+  // check that the sources have not changed
+    size_t objStampPos = r.pos();
+    FileStamp objStamp = r.get<FileStamp>();
+    std::string mtlLibName = r.getString();
+    size_t mtlStampPos = r.pos();
+    FileStamp mtlStamp = r.get<FileStamp>();
+    if (!r.ok()) {
+        return false;
+    }
+    bool restamp = false;
+    if (checkSources) {
+        FileStamp cur;
+        if (!checkStamp (this->_path, objStamp, cur)) {
+            return false;
+        }
+        restamp = (cur.mtime != objStamp.mtime);
+        objStamp = cur;
+        if (!mtlLibName.empty()) {
+            if (!checkStamp (mtlPath(this->_path, mtlLibName), mtlStamp, cur)) {
+                return false;
+            }
+            restamp = restamp || (cur.mtime != mtlStamp.mtime);
+            mtlStamp = cur;
+        }
+    }
+
+  // the bounding box
+    cs237::AABBf_t bbox;
+    bool bboxEmpty = (r.get<uint32_t>() != 0);
+    glm::vec3 bbMin = r.get<glm::vec3>();
+    glm::vec3 bbMax = r.get<glm::vec3>();
+    if (! bboxEmpty) {
+        bbox = cs237::AABBf_t(bbMin, bbMax);
+    }
+
+  // the materials
+    std::vector<Material> materials;
+    uint32_t nMaterials = r.get<uint32_t>();
+    for (uint32_t i = 0;  r.ok() && (i < nMaterials);  i++) {
+        materials.push_back (getMaterial (r));
+    }
+
+  // the groups
+    std::vector<Group> groups;
+    uint32_t nGroups = r.get<uint32_t>();
+    for (uint32_t i = 0;  r.ok() && (i < nGroups);  i++) {
+        Group g;
+        g.name = r.getString();
+        g.material = r.get<int32_t>();
+        // -1 marks a group whose material was not found (see Model::Model)
+        if ((g.material < -1) || (g.material >= int32_t(materials.size()))) {
+            r.fail();
+        }
+        g.nVerts = r.get<uint32_t>();
+        g.nIndices = r.get<uint32_t>();
+        g.nLODs = r.get<uint32_t>();
+        g.nLODIndices = r.get<uint32_t>();
+        uint32_t flags = r.get<uint32_t>();
+        uint64_t vertsOffset = r.get<uint64_t>();
+        uint64_t normsOffset = r.get<uint64_t>();
+        uint64_t txtCoordsOffset = r.get<uint64_t>();
+        uint64_t indicesOffset = r.get<uint64_t>();
+        uint64_t lodsOffset = r.get<uint64_t>();
+        uint64_t lodIndicesOffset = r.get<uint64_t>();
+        g.verts = r.getArray<glm::vec3>(vertsOffset, g.nVerts);
+        if (flags & kHasNorms) {
+            g.norms = r.getArray<glm::vec3>(normsOffset, g.nVerts);
+        }
+        if (flags & kHasTxtCoords) {
+            g.txtCoords = r.getArray<glm::vec2>(txtCoordsOffset, g.nVerts);
+        }
+        g.indices = r.getArray<uint32_t>(indicesOffset, g.nIndices);
+        if (r.ok() && !checkIndices (g.indices, g.nIndices, g.nVerts)) {
+            r.fail();
+        }
+        if (g.nLODs > 0) {
+            g.lods = r.getArray<cs237::mesh::LOD>(lodsOffset, g.nLODs);
+            g.lodIndices = r.getArray<uint32_t>(lodIndicesOffset, g.nLODIndices);
+            for (uint32_t j = 0;  r.ok() && (j < g.nLODs);  j++) {
+                if (uint64_t(g.lods[j].firstIndex) + g.lods[j].nIndices > g.nLODIndices) {
+                    r.fail();
+                }
+            }
+            if (r.ok() && !checkIndices (g.lodIndices, g.nLODIndices, g.nVerts)) {
+                r.fail();
+            }
+        }
+        groups.push_back (g);
+    }
+    if (! r.ok()) {
+        std::cerr << "Warning: ignoring corrupted cache file \"" << cacheFile << "\"\n";
+        return false;
+    }
+
+    this->_mtlLibName = mtlLibName;
+    this->_bbox = bbox;
+    this->_materials = std::move(materials);
+    this->_groups = std::move(groups);
+
+  // the sources were touched without being changed, so we update their stamps
+  // in the cache; otherwise every load would have to hash the sources.  The
+  // cache is replaced atomically, so our mapping of it remains valid.
+    if (restamp) {
+        std::string contents(data, sz);
+        std::memcpy (&contents[objStampPos], &objStamp, sizeof(FileStamp));
+        std::memcpy (&contents[mtlStampPos], &mtlStamp, sizeof(FileStamp));
+        cs237::writeFileAtomically (cacheFile, [&contents] (std::ofstream &outS) {
+            outS.write (contents.data(), contents.size());
+            return !outS.fail();
+        });
+    }
+
+    return true;
+
+}
+
+bool Model::cacheData (std::string &data) const
+{
+    using namespace __details;
+
+    FileStamp objStamp, mtlStamp = { 0, 0, 0 };
+    if (! stampFile (this->_path, objStamp)) {
+        return false;
+    }
+    if (!this->_mtlLibName.empty()
+    && !stampFile (mtlPath(this->_path, this->_mtlLibName), mtlStamp)) {
+        // the model was loaded without its material library
+        mtlStamp = { kMissing, 0, 0 };
+    }
+
+    CacheWriter w;
+
+  // header
+    for (int i = 0;  i < 8;  i++) {
+        w.put (kMagic[i]);
+    }
+    w.put (kVersion);
+    w.put (static_cast<uint32_t>(sizeof(glm::vec3)));
+    w.put (static_cast<uint32_t>(sizeof(glm::vec2)));
+    w.put ((Model::_optimizeMeshes ? kOptimized : 0) | (Model::_buildLODs ? kLODs : 0));
+
+  // sources
+    w.put (objStamp);
+    w.putString (this->_mtlLibName);
+    w.put (mtlStamp);
+
+  // bounding box
+    w.put (static_cast<uint32_t>(this->_bbox.isEmpty() ? 1 : 0));
+    w.put (this->_bbox.isEmpty() ? glm::vec3(0.0f) : this->_bbox.min());
+    w.put (this->_bbox.isEmpty() ? glm::vec3(0.0f) : this->_bbox.max());
+
+  // materials
+    w.put (static_cast<uint32_t>(this->_materials.size()));
+    for (auto const &m : this->_materials) {
+        putMaterial (w, m);
+    }
+
+  // group table
+    struct Offsets { size_t verts, norms, txtCoords, indices, lods, lodIndices; };
+    std::vector<Offsets> offsets;
+    w.put (static_cast<uint32_t>(this->_groups.size()));
+    for (auto const &g : this->_groups) {
+        w.putString (g.name);
+        w.put (static_cast<int32_t>(g.material));
+        w.put (g.nVerts);
+        w.put (g.nIndices);
+        w.put (g.nLODs);
+        w.put (g.nLODIndices);
+        uint32_t flags = 0;
+        if (g.norms != nullptr) { flags |= kHasNorms; }
+        if (g.txtCoords != nullptr) { flags |= kHasTxtCoords; }
+        w.put (flags);
+        Offsets offs;
+        offs.verts = w.reserveOffset();
+        offs.norms = w.reserveOffset();
+        offs.txtCoords = w.reserveOffset();
+        offs.indices = w.reserveOffset();
+        offs.lods = w.reserveOffset();
+        offs.lodIndices = w.reserveOffset();
+        offsets.push_back (offs);
+    }
+
+  // group data
+    for (size_t i = 0;  i < this->_groups.size();  i++) {
+        Group const &g = this->_groups[i];
+        w.putArray (offsets[i].verts, g.verts, g.nVerts * sizeof(glm::vec3));
+        w.putArray (offsets[i].norms, g.norms, g.nVerts * sizeof(glm::vec3));
+        w.putArray (offsets[i].txtCoords, g.txtCoords, g.nVerts * sizeof(glm::vec2));
+        w.putArray (offsets[i].indices, g.indices, g.nIndices * sizeof(uint32_t));
+        w.putArray (offsets[i].lods, g.lods, g.nLODs * sizeof(cs237::mesh::LOD));
+        w.putArray (offsets[i].lodIndices, g.lodIndices, g.nLODIndices * sizeof(uint32_t));
+    }
+
+    data = w.contents();
+    return true;
+
+}
+
+void Model::_writeCache (std::string const &cacheFile) const
+{
+    std::string data;
+    if (! this->cacheData (data)) {
+        return;
+    }
+
+  // the cache is written atomically, so concurrent loads never see a partially
+  // written cache.  Failure is not an error, since the model's directory might
+  // not be writable.
+    cs237::writeFileAtomically (cacheFile, [&data] (std::ofstream &outS) {
+        outS.write (data.data(), data.size());
+        return !outS.fail();
+    });
+
+}
+
+} // namespace OBJ
@@ -0,0 +1,462 @@
+/*
+      obj-reader-legacy.cxx
+
+      This code was ported from a C program written by Nate Robins.
+
+      Nate Robins, 1997, 2000
+      nate@pobox.com, http://www.pobox.com/~nate
+
+      The original two-pass OBJ reader, which uses stdio to scan the file
+      once to size the arrays and a second time to fill them in.  It has
+      been replaced by the single-pass reader in obj-reader.cxx, but is
+      kept as a reference for testing and benchmarking the new reader.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "obj-reader.hpp"
+
+#define T(x) (model->triangles[(x)])
+
+/* OBJCopyString: returns a copy of a string allocated with `new[]` */
+static char*
+OBJCopyString(const char* s)
+{
+    size_t n = strlen(s);
+    char* copy = new char[n+1];
+    memcpy(copy, s, n+1);
+    return copy;
+}
+
+/* OBJFindGroup: Find a group in the model */
+static OBJgroup*
+OBJFindGroup(OBJmodel* model, const char* name)
+{
+    OBJgroup* group;
+
+    assert(model);
+
+    group = model->groups;
+    while(group) {
+        if (!strcmp(name, group->name))
+            break;
+        group = group->next;
+    }
+
+    return group;
+}
+
+/* OBJAddGroup: Add a group to the model */
+static OBJgroup*
+OBJAddGroup(OBJmodel* model, const char* name)
+{
+    OBJgroup* group;
+
+    group = OBJFindGroup(model, name);
+    if (!group) {
+        group = new OBJgroup;
+        group->name = OBJCopyString(name);
+        group->material = 0;
+        group->numtriangles = 0;
+        group->triangles = NULL;
+        group->next = model->groups;
+        model->groups = group;
+        model->numgroups++;
+    }
+
+    return group;
+}
+
+
+/* OBJFirstPass: first pass at a Wavefront OBJ file that gets all the
+ * statistics of the model (such as #vertices, #normals, etc)
+ *
+ * model - properly initialized OBJmodel structure
+ * file  - (fopen'd) file descriptor
+ */
+static void
+OBJFirstPass(OBJmodel* model, FILE* file)
+{
+    uint32_t numvertices;        /* number of vertices in model */
+    uint32_t numnormals;         /* number of normals in model */
+    uint32_t numtexcoords;       /* number of texcoords in model */
+    uint32_t numtriangles;       /* number of triangles in model */
+    OBJgroup* group = 0;         /* current group */
+    int v, n, t;
+    char buf[1024];
+    char *dummy;
+
+    numvertices = numnormals = numtexcoords = numtriangles = 0;
+    while(fscanf(file, "%s", buf) != EOF) {
+        switch(buf[0]) {
+        case '#':               /* comment */
+            /* eat up rest of line */
+            dummy = fgets(buf, sizeof(buf), file);
+            break;
+        case 'v':               /* v, vn, vt */
+            if (group == 0) {
+              /* make a default group */
+                group = OBJAddGroup(model, "default");
+            }
+            switch(buf[1]) {
+            case '\0':          /* vertex */
+                /* eat up rest of line */
+                dummy = fgets(buf, sizeof(buf), file);
+                numvertices++;
+                break;
+            case 'n':           /* normal */
+                /* eat up rest of line */
+                dummy = fgets(buf, sizeof(buf), file);
+                numnormals++;
+                break;
+            case 't':           /* texcoord */
+                /* eat up rest of line */
+                dummy = fgets(buf, sizeof(buf), file);
+                numtexcoords++;
+                break;
+            default:
+                printf("OBJFirstPass(): Unknown token \"%s\".\n", buf);
+                exit(1);
+                break;
+            }
+            break;
+        case 'm':
+            dummy = fgets(buf, sizeof(buf), file);
+            sscanf(buf, "%s %s", buf, buf);
+            model->mtllibname = OBJCopyString(buf);
+            break;
+        case 'u':
+            if (group == 0) {
+              /* make a default group */
+                group = OBJAddGroup(model, "default");
+            }
+            /* eat up rest of line */
+            dummy = fgets(buf, sizeof(buf), file);
+            break;
+        case 'g':               /* group */
+            /* eat up rest of line */
+            dummy = fgets(buf, sizeof(buf), file);
+#if SINGLE_STRING_GROUP_NAMES
+            sscanf(buf, "%s", buf);
+#else
+            buf[strlen(buf)-1] = '\0';  /* nuke '\n' */
+#endif
+            group = OBJAddGroup(model, buf);
+            break;
+        case 'f':               /* face */
+            if (group == 0) {
+              /* make a default group */
+                group = OBJAddGroup(model, "default");
+            }
+            v = n = t = 0;
+            fscanf(file, "%s", buf);
+            /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
+            if (strstr(buf, "//")) {
+                /* v//n */
+                sscanf(buf, "%d//%d", &v, &n);
+                fscanf(file, "%d//%d", &v, &n);
+                fscanf(file, "%d//%d", &v, &n);
+                numtriangles++;
+                group->numtriangles++;
+                while(fscanf(file, "%d//%d", &v, &n) > 0) {
+                    numtriangles++;
+                    group->numtriangles++;
+                }
+            } else if (sscanf(buf, "%d/%d/%d", &v, &t, &n) == 3) {
+                /* v/t/n */
+                fscanf(file, "%d/%d/%d", &v, &t, &n);
+                fscanf(file, "%d/%d/%d", &v, &t, &n);
+                numtriangles++;
+                group->numtriangles++;
+                while(fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
+                    numtriangles++;
+                    group->numtriangles++;
+                }
+            } else if (sscanf(buf, "%d/%d", &v, &t) == 2) {
+                /* v/t */
+                fscanf(file, "%d/%d", &v, &t);
+                fscanf(file, "%d/%d", &v, &t);
+                numtriangles++;
+                group->numtriangles++;
+                while(fscanf(file, "%d/%d", &v, &t) > 0) {
+                    numtriangles++;
+                    group->numtriangles++;
+                }
+            } else {
+                /* v */
+                fscanf(file, "%d", &v);
+                fscanf(file, "%d", &v);
+                numtriangles++;
+                group->numtriangles++;
+                while(fscanf(file, "%d", &v) > 0) {
+                    numtriangles++;
+                    group->numtriangles++;
+                }
+            }
+            break;
+
+        default:
+            /* eat up rest of line */
+            dummy = fgets(buf, sizeof(buf), file);
+            break;
+        }
+  }
+
+  /* set the stats in the model structure */
+  model->numvertices  = numvertices;
+  model->numnormals   = numnormals;
+  model->numtexcoords = numtexcoords;
+  model->numtriangles = numtriangles;
+
+  /* allocate memory for the triangles in each group */
+  group = model->groups;
+  while(group) {
+      group->triangles = new uint32_t[group->numtriangles];
+      group->numtriangles = 0;
+      group = group->next;
+  }
+}
+
+/* OBJSecondPass: second pass at a Wavefront OBJ file that gets all
+ * the data.
+ *
+ * model - properly initialized OBJmodel structure
+ * file  - (fopen'd) file descriptor
+ */
+static void
+OBJSecondPass (OBJmodel* model, FILE* file)
+{
+    uint32_t numvertices;       /* number of vertices in model */
+    uint32_t numnormals;        /* number of normals in model */
+    uint32_t numtexcoords;      /* number of texcoords in model */
+    uint32_t numtriangles;      /* number of triangles in model */
+    glm::vec3 *vertices;     /* array of vertices  */
+    glm::vec3 *normals;      /* array of normals */
+    glm::vec2 *texcoords;    /* array of texture coordinates */
+    OBJgroup* group;            /* current group pointer */
+    char* material;             /* current material */
+    int v, n, t;
+    char buf[512];
+    char *dummy;
+
+    /* set the pointer shortcuts */
+    vertices    = model->vertices;
+    normals     = model->normals;
+    texcoords   = model->texcoords;
+    group       = model->groups;
+
+    /* on the second pass through the file, read all the data into the
+    allocated arrays */
+    numvertices = numnormals = numtexcoords = 1;
+    numtriangles = 0;
+    material = nullptr;
+    while (fscanf(file, "%s", buf) != EOF) {
+        switch (buf[0]) {
+        case '#':               /* comment */
+            /* eat up rest of line */
+            dummy = fgets(buf, sizeof(buf), file);
+            break;
+        case 'v':               /* v, vn, vt */
+            switch (buf[1]) {
+            case '\0':          /* vertex */
+                fscanf(file, "%f %f %f",
+                    &(vertices[numvertices][0]),
+                    &(vertices[numvertices][1]),
+                    &(vertices[numvertices][2]));
+                numvertices++;
+                break;
+            case 'n':           /* normal */
+                fscanf(file, "%f %f %f",
+                    &(normals[numnormals][0]),
+                    &(normals[numnormals][1]),
+                    &(normals[numnormals][2]));
+                numnormals++;
+                break;
+            case 't':           /* texcoord */
+                fscanf(file, "%f %f",
+                    &(texcoords[numtexcoords][0]),
+                    &(texcoords[numtexcoords][1]));
+                numtexcoords++;
+                break;
+            }
+            break;
+            case 'u':
+                dummy = fgets(buf, sizeof(buf), file);
+                sscanf(buf, "%s %s", buf, buf);
+                material = OBJCopyString(buf);
+              // if there is already a material associated with this group, then we
+              // ignore this material.
+/* QUESION: will this work for multiple groups with shared and different materials? */
+                if (group->material == nullptr) {
+                    group->material = material;
+                }
+                break;
+            case 'g':               /* group */
+                /* eat up rest of line */
+                dummy = fgets(buf, sizeof(buf), file);
+#if SINGLE_STRING_GROUP_NAMES
+                sscanf(buf, "%s", buf);
+#else
+                buf[strlen(buf)-1] = '\0';  /* nuke '\n' */
+#endif
+                group = OBJFindGroup(model, buf);
+                group->material = (material != nullptr) ? OBJCopyString(material) : nullptr;
+                break;
+            case 'f':               /* face */
+                v = n = t = 0;
+                fscanf(file, "%s", buf);
+                /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
+                if (strstr(buf, "//")) {
+                    /* v//n */
+                    sscanf(buf, "%d//%d", &v, &n);
+                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).nindices[0] = n < 0 ? n + numnormals : n;
+                    fscanf(file, "%d//%d", &v, &n);
+                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).nindices[1] = n < 0 ? n + numnormals : n;
+                    fscanf(file, "%d//%d", &v, &n);
+                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
+                    group->triangles[group->numtriangles++] = numtriangles;
+                    numtriangles++;
+                    while(fscanf(file, "%d//%d", &v, &n) > 0) {
+                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
+                        T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
+                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
+                        T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
+                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
+                        T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
+                        group->triangles[group->numtriangles++] = numtriangles;
+                        numtriangles++;
+                    }
+                } else if (sscanf(buf, "%d/%d/%d", &v, &t, &n) == 3) {
+                    /* v/t/n */
+                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).tindices[0] = t < 0 ? t + numtexcoords : t;
+                    T(numtriangles).nindices[0] = n < 0 ? n + numnormals : n;
+                    fscanf(file, "%d/%d/%d", &v, &t, &n);
+                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).tindices[1] = t < 0 ? t + numtexcoords : t;
+                    T(numtriangles).nindices[1] = n < 0 ? n + numnormals : n;
+                    fscanf(file, "%d/%d/%d", &v, &t, &n);
+                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
+                    T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
+                    group->triangles[group->numtriangles++] = numtriangles;
+                    numtriangles++;
+                    while(fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
+                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
+                        T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
+                        T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
+                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
+                        T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
+                        T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
+                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
+                        T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
+                        T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
+                        group->triangles[group->numtriangles++] = numtriangles;
+                        numtriangles++;
+                    }
+                } else if (sscanf(buf, "%d/%d", &v, &t) == 2) {
+                    /* v/t */
+                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).tindices[0] = t < 0 ? t + numtexcoords : t;
+                    fscanf(file, "%d/%d", &v, &t);
+                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).tindices[1] = t < 0 ? t + numtexcoords : t;
+                    fscanf(file, "%d/%d", &v, &t);
+                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
+                    T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
+                    group->triangles[group->numtriangles++] = numtriangles;
+                    numtriangles++;
+                    while(fscanf(file, "%d/%d", &v, &t) > 0) {
+                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
+                        T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
+                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
+                        T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
+                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
+                        T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
+                        group->triangles[group->numtriangles++] = numtriangles;
+                        numtriangles++;
+                    }
+                } else {
+                    /* v */
+                    sscanf(buf, "%d", &v);
+                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
+                    fscanf(file, "%d", &v);
+                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
+                    fscanf(file, "%d", &v);
+                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
+                    group->triangles[group->numtriangles++] = numtriangles;
+                    numtriangles++;
+                    while(fscanf(file, "%d", &v) > 0) {
+                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
+                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
+                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
+                        group->triangles[group->numtriangles++] = numtriangles;
+                        numtriangles++;
+                    }
+                }
+                break;
+
+            default:
+                /* eat up rest of line */
+                dummy = fgets(buf, sizeof(buf), file);
+                break;
+        }
+    }
+
+}
+
+
+
+/* OBJReadOBJLegacy: Reads a model description from a Wavefront .OBJ file
+ * using the original two-pass reader.
+ * Returns a pointer to the created object which should be free'd with
+ * `delete`.
+ *
+ * filename - name of the file containing the Wavefront .OBJ format data.
+ */
+OBJmodel*
+OBJReadOBJLegacy (const char* filename)
+{
+    FILE* file;
+
+    /* open the file */
+    file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "OBJReadOBJLegacy() failed: can't open data file \"%s\".\n",
+            filename);
+        exit(1);
+    }
+
+    /* allocate a new model */
+    OBJmodel* model = new OBJmodel();
+
+    /* make a first pass through the file to get a count of the number
+    of vertices, normals, texcoords & triangles */
+    OBJFirstPass (model, file);
+
+    /* allocate memory */
+    model->vertices = new glm::vec3[model->numvertices + 1];
+    model->triangles = new OBJtriangle[model->numtriangles];
+    if (model->numnormals > 0) {
+        model->normals = new glm::vec3[model->numnormals + 1];
+    }
+    if (model->numtexcoords > 0) {
+        model->texcoords = new glm::vec2[model->numtexcoords + 1];
+    }
+
+    /* rewind to beginning of file and read in the data this pass */
+    rewind(file);
+
+    OBJSecondPass(model, file);
+
+    /* close the file */
+    fclose(file);
+
+    return model;
+}
@@ -12,18 +12,36 @@
       preservation of edges, welding redundant vertices & texture
       coordinate generation (spheremap and planar projections) + more.
 
+      The original reader made two passes over the file using stdio
+      (one to count and one to fill in the arrays).  This version maps
+      the file into memory and reads it in a single pass using hand-written
+      number parsing, growable arrays, and a hash table for the groups.
+      It produces the same OBJmodel as the original reader, which is still
+      available as OBJReadOBJLegacy (see obj-reader-legacy.cxx).
+
+      Large files can be read in parallel: the file is split into chunks at
+      line boundaries, each chunk is parsed into its own arrays, and the
+      results are then concatenated, with relative indices adjusted by the
+      sizes of the preceding chunks.  Since the group state depends on the
+      preceding lines, chunks record the "g", "usemtl", and "mtllib" lines
+      (and runs of faces) as events, which are replayed in file order.
+
 */
 
-#include <math.h>
+#include "cs237/cs237.hpp"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
 #include "obj-reader.hpp"
 
-#define FREE(p)         std::free(p)
-
-#define T(x) (model->triangles[(x)])
+/* files are only split into chunks for parallel parsing when each chunk
+ * would be at least this large
+ */
+static const size_t kOBJMinChunkSize = 256 * 1024;
 
 /* OBJAbs: returns the absolute value of a float */
 static inline float OBJAbs(float f)
@@ -31,386 +49,865 @@ static inline float OBJAbs(float f)
     if (f < 0) return -f; else return f;
 }
 
-/* OBJFindGroup: Find a group in the model */
-OBJgroup*
-OBJFindGroup(OBJmodel* model, const char* name)
+/* OBJCopyString: returns a copy of the first n characters of s allocated
+ * with `new[]`
+ */
+static char*
+OBJCopyString(const char* s, size_t n)
 {
-    OBJgroup* group;
+    char* copy = new char[n+1];
+    memcpy(copy, s, n);
+    copy[n] = '\0';
+    return copy;
+}
 
-    assert(model);
+/* OBJIsSpace: the characters that separate tokens (same as isspace in the C locale) */
+static inline bool OBJIsSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n')
+        || (c == '\r') || (c == '\v') || (c == '\f');
+}
 
-    group = model->groups;
-    while(group) {
-        if (!strcmp(name, group->name))
-            break;
-        group = group->next;
+/* OBJIsDigit: is c a decimal digit? */
+static inline bool OBJIsDigit(char c)
+{
+    return ('0' <= c) && (c <= '9');
+}
+
+/* OBJArray: a growable array whose storage is allocated with `new[]`, so
+ * that it can be handed off to the OBJmodel structure.  The element type
+ * must be trivially copyable.
+ */
+template <typename T>
+struct OBJArray {
+    T*          elems;
+    uint32_t    size;
+    uint32_t    capacity;
+
+    OBJArray () : elems(nullptr), size(0), capacity(0) { }
+    OBJArray (OBJArray const &) = delete;
+    OBJArray &operator= (OBJArray const &) = delete;
+    ~OBJArray () { delete[] this->elems; }
+
+    /* add an element to the end of the array and return a reference to it */
+    T& push ()
+    {
+        if (this->size == this->capacity) {
+            this->grow ();
+        }
+        return this->elems[this->size++];
+    }
+
+    /* transfer ownership of the storage to the caller; the array is left empty */
+    T* release ()
+    {
+        T* elems = this->elems;
+        this->elems = nullptr;
+        this->size = this->capacity = 0;
+        return elems;
     }
 
-    return group;
+    void swap (OBJArray& other)
+    {
+        std::swap (this->elems, other.elems);
+        std::swap (this->size, other.size);
+        std::swap (this->capacity, other.capacity);
+    }
+
+    void grow ()
+    {
+        uint32_t cap = (this->capacity < 64) ? 64 : 2 * this->capacity;
+        T* elems = new T[cap];
+        if (this->size > 0) {
+            memcpy (elems, this->elems, this->size * sizeof(T));
+        }
+        delete[] this->elems;
+        this->elems = elems;
+        this->capacity = cap;
+    }
+};
+
+/* OBJParseInt: parse a decimal integer (with optional sign) at p, which is
+ * advanced past the number.  This function has the same behavior as the
+ * "%d" conversion of scanf, except that it does not skip leading newlines.
+ * Returns false if there is no number at p.
+ */
+static inline bool
+OBJParseInt(const char*& p, const char* end, int& result)
+{
+    const char* s = p;
+    while ((s < end) && (*s != '\n') && OBJIsSpace(*s)) {
+        s++;
+    }
+    bool neg = false;
+    if ((s < end) && ((*s == '-') || (*s == '+'))) {
+        neg = (*s == '-');
+        s++;
+    }
+    if ((s == end) || !OBJIsDigit(*s)) {
+        return false;
+    }
+    uint32_t n = 0;
+    do {
+        n = 10 * n + static_cast<uint32_t>(*s - '0');
+        s++;
+    } while ((s < end) && OBJIsDigit(*s));
+    result = static_cast<int>(neg ? -n : n);
+    p = s;
+    return true;
 }
 
-/* OBJAddGroup: Add a group to the model */
-OBJgroup*
-OBJAddGroup(OBJmodel* model, const char* name)
+/* OBJParseFloatSlow: parse a float using strtof; this function is used for
+ * the numbers that OBJParseFloat cannot handle exactly.
+ */
+static bool
+OBJParseFloatSlow(const char*& p, const char* end, float& result)
 {
-    OBJgroup* group;
+    char buf[128];
+    size_t n = 0;
+    while ((p + n < end) && !OBJIsSpace(p[n]) && (n < sizeof(buf)-1)) {
+        buf[n] = p[n];
+        n++;
+    }
+    buf[n] = '\0';
+    char* stop;
+    float f = strtof (buf, &stop);
+    if (stop == buf) {
+        return false;
+    }
+    result = f;
+    p += (stop - buf);
+    return true;
+}
+
+/* OBJParseFloat: parse a floating-point number at p, which is advanced past
+ * the number.  The result is the correctly rounded value (i.e., the same
+ * value as the "%f" conversion of scanf).  Returns false if there is no
+ * number at p.
+ *
+ * The common case of a decimal number with at most 19 significant digits
+ * and a small exponent is handled by computing the exact significand as an
+ * integer and scaling it by an exact power of ten in double precision, which
+ * gives the correctly rounded double.  Rounding that to float is correct unless
+ * the double lies exactly halfway between two floats, in which case (and for
+ * all other unusual inputs) we fall back to strtof.
+ */
+static inline bool
+OBJParseFloat(const char*& p, const char* end, float& result)
+{
+    static const double kPow10[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9, 1e10,
+            1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
 
-    group = OBJFindGroup(model, name);
-    if (!group) {
-        group = new OBJgroup;
-        group->name = strdup(name);
-        group->material = 0;
-        group->numtriangles = 0;
-        group->triangles = NULL;
-        group->next = model->groups;
-        model->groups = group;
-        model->numgroups++;
+    while ((p < end) && (*p != '\n') && OBJIsSpace(*p)) {
+        p++;
     }
 
-    return group;
+    const char* s = p;
+    bool neg = false;
+    if ((s < end) && ((*s == '-') || (*s == '+'))) {
+        neg = (*s == '-');
+        s++;
+    }
+
+    uint64_t mant = 0;          /* the significant digits as an integer */
+    int nSig = 0;               /* the number of significant digits */
+    int exp10 = 0;              /* the decimal exponent */
+    bool sawDigit = false;
+    while ((s < end) && OBJIsDigit(*s)) {
+        if ((mant != 0) || (*s != '0')) {
+            if (++nSig > 19) return OBJParseFloatSlow (p, end, result);
+        }
+        mant = 10 * mant + static_cast<uint64_t>(*s - '0');
+        sawDigit = true;
+        s++;
+    }
+    if ((s < end) && (*s == '.')) {
+        s++;
+        while ((s < end) && OBJIsDigit(*s)) {
+            if ((mant != 0) || (*s != '0')) {
+                if (++nSig > 19) return OBJParseFloatSlow (p, end, result);
+            }
+            mant = 10 * mant + static_cast<uint64_t>(*s - '0');
+            exp10--;
+            sawDigit = true;
+            s++;
+        }
+    }
+    if (! sawDigit) {
+        /* "inf", "nan", or not a number */
+        return OBJParseFloatSlow (p, end, result);
+    }
+    if ((s < end) && ((*s == 'e') || (*s == 'E'))) {
+        s++;
+        bool negExp = false;
+        if ((s < end) && ((*s == '-') || (*s == '+'))) {
+            negExp = (*s == '-');
+            s++;
+        }
+        if ((s == end) || !OBJIsDigit(*s)) {
+            return OBJParseFloatSlow (p, end, result);
+        }
+        int e = 0;
+        while ((s < end) && OBJIsDigit(*s)) {
+            if (e < 10000) e = 10 * e + (*s - '0');
+            s++;
+        }
+        exp10 += negExp ? -e : e;
+    }
+    if ((s < end) && !OBJIsSpace(*s)) {
+        /* something unexpected, such as a hex float */
+        return OBJParseFloatSlow (p, end, result);
+    }
+
+    if (mant == 0) {
+        result = neg ? -0.0f : 0.0f;
+    }
+    else if ((mant <= (uint64_t(1) << 53)) && (-22 <= exp10) && (exp10 <= 22)) {
+        double d = static_cast<double>(mant);
+        d = (exp10 < 0) ? d / kPow10[-exp10] : d * kPow10[exp10];
+        /* check for a double that is exactly halfway between two floats, which
+         * is the only case where rounding twice can give the wrong answer.
+         */
+        uint64_t bits;
+        memcpy (&bits, &d, sizeof(bits));
+        if ((bits & 0x1fffffff) == 0x10000000) {
+            return OBJParseFloatSlow (p, end, result);
+        }
+        float f = static_cast<float>(d);
+        result = neg ? -f : f;
+    }
+    else {
+        return OBJParseFloatSlow (p, end, result);
+    }
+
+    p = s;
+    return true;
+}
+
+/* OBJParseFloats: parse up to n floats into dst, stopping at the first failure
+ * (as scanf does)
+ */
+static inline void
+OBJParseFloats(const char*& p, const char* end, float* dst, int n)
+{
+    for (int i = 0;  i < n;  i++) {
+        if (! OBJParseFloat (p, end, dst[i])) {
+            return;
+        }
+    }
 }
 
+/* the four kinds of vertex references in a face */
+enum OBJFaceFormat {
+    OBJ_V,              /* %d */
+    OBJ_VT,             /* %d/%d */
+    OBJ_VTN,            /* %d/%d/%d */
+    OBJ_VN              /* %d//%d */
+};
 
-/* OBJFirstPass: first pass at a Wavefront OBJ file that gets all the
- * statistics of the model (such as #vertices, #normals, etc)
- *
- * model - properly initialized OBJmodel structure
- * file  - (fopen'd) file descriptor
+/* OBJScanRef: scan a vertex reference in the given format.  Like scanf, the
+ * components that are successfully scanned are assigned and the number of
+ * assignments is returned.
  */
-static void
-OBJFirstPass(OBJmodel* model, FILE* file)
+static inline int
+OBJScanRef(const char*& p, const char* end, OBJFaceFormat fmt, int& v, int& t, int& n)
 {
-    uint32_t numvertices;        /* number of vertices in model */
-    uint32_t numnormals;         /* number of normals in model */
-    uint32_t numtexcoords;       /* number of texcoords in model */
-    uint32_t numtriangles;       /* number of triangles in model */
-    OBJgroup* group = 0;         /* current group */
-    int v, n, t;
-    char buf[1024];
-    char *dummy;
-
-    numvertices = numnormals = numtexcoords = numtriangles = 0;
-    while(fscanf(file, "%s", buf) != EOF) {
-        switch(buf[0]) {
-        case '#':               /* comment */
-            /* eat up rest of line */
-            dummy = fgets(buf, sizeof(buf), file);
+    if (! OBJParseInt (p, end, v)) return 0;
+    switch (fmt) {
+    case OBJ_V:
+        return 1;
+    case OBJ_VN:
+        if ((end - p < 2) || (p[0] != '/') || (p[1] != '/')) return 1;
+        p += 2;
+        return OBJParseInt (p, end, n) ? 2 : 1;
+    default: /* OBJ_VT or OBJ_VTN */
+        if ((p == end) || (*p != '/')) return 1;
+        p++;
+        if (! OBJParseInt (p, end, t)) return 1;
+        if (fmt == OBJ_VT) return 2;
+        if ((p == end) || (*p != '/')) return 2;
+        p++;
+        return OBJParseInt (p, end, n) ? 3 : 2;
+    }
+}
+
+/* OBJScanName: returns the name from the rest of a "mtllib" or "usemtl" line.
+ * This mimics `sscanf(buf, "%s %s", buf, buf)` in the original reader, which
+ * gives the second word when there are at least two and the first otherwise.
+ */
+static std::string_view
+OBJScanName(std::string_view line)
+{
+    std::string_view words[2];
+    size_t i = 0;
+    for (int k = 0;  k < 2;  k++) {
+        while ((i < line.size()) && OBJIsSpace(line[i])) {
+            i++;
+        }
+        size_t start = i;
+        while ((i < line.size()) && !OBJIsSpace(line[i])) {
+            i++;
+        }
+        if (i == start) {
             break;
-        case 'v':               /* v, vn, vt */
-            if (group == 0) {
-              /* make a default group */
-                group = OBJAddGroup(model, "default");
+        }
+        words[k] = line.substr(start, i - start);
+    }
+    if (! words[1].empty()) {
+        return words[1];
+    }
+    else if (! words[0].empty()) {
+        return words[0];
+    }
+    else {
+        return line;
+    }
+}
+
+/* OBJEvent: a change to the group state of the reader (or a run of faces).
+ * The events are recorded in file order, so that the parts of a file can be
+ * read independently and the group structure reconstructed afterwards.
+ */
+struct OBJEvent {
+    enum Kind {
+        ENSURE_GROUP,           /* make a default group if there are no groups */
+        GROUP,                  /* "g" line */
+        USEMTL,                 /* "usemtl" line */
+        MTLLIB,                 /* "mtllib" line */
+        FACES                   /* a run of triangles */
+    };
+    Kind                kind;
+    std::string_view    name;   /* the name for GROUP, USEMTL, and MTLLIB events */
+    uint32_t            count;  /* the number of triangles for FACES events */
+};
+
+/* bits in the per-triangle mask of relative indices */
+#define OBJ_REL_V(i)    (1 << (i))
+#define OBJ_REL_T(i)    (1 << (3+(i)))
+#define OBJ_REL_N(i)    (1 << (6+(i)))
+
+/* OBJChunk: the data read from a range of complete lines of a file.  The
+ * vertex data and triangles are collected in local arrays and the changes
+ * to the group state are recorded as events.  Relative (negative) indices
+ * are resolved against the local counts and flagged in `relative`, so that
+ * they can be adjusted once the sizes of the preceding chunks are known.
+ */
+struct OBJChunk {
+    const char*                 p;              /* the current position */
+    const char*                 end;            /* the end of the chunk */
+    OBJArray<glm::vec3>         vertices;
+    OBJArray<glm::vec3>         normals;
+    OBJArray<glm::vec2>         texcoords;
+    OBJArray<OBJtriangle>       triangles;
+    OBJArray<uint16_t>          relative;       /* per-triangle masks of relative indices */
+    std::vector<OBJEvent>       events;
+    bool                        hasGroup;       /* true once there must be a group */
+
+    OBJChunk (const char* start, const char* stop, bool isFirst)
+      : p(start), end(stop), hasGroup(false)
+    {
+        /* the vertex, normal, and texcoord arrays are 1-based, so the first
+         * chunk starts with a dummy element
+         */
+        if (isFirst) {
+            this->vertices.push() = glm::vec3(0.0f);
+            this->normals.push() = glm::vec3(0.0f);
+            this->texcoords.push() = glm::vec2(0.0f);
+        }
+    }
+
+    void parse ();
+
+    /* skip to the beginning of the next line */
+    void skipLine ()
+    {
+        const char* nl = static_cast<const char*>(
+            memchr (this->p, '\n', this->end - this->p));
+        this->p = (nl == nullptr) ? this->end : nl + 1;
+    }
+
+    /* return the rest of the line (including the newline) and advance to the
+     * next line
+     */
+    std::string_view restOfLine ()
+    {
+        const char* start = this->p;
+        this->skipLine ();
+        return std::string_view(start, this->p - start);
+    }
+
+    void ensureGroup ()
+    {
+        if (! this->hasGroup) {
+            this->events.push_back(OBJEvent{OBJEvent::ENSURE_GROUP, {}, 0});
+            this->hasGroup = true;
+        }
+    }
+
+    void addTriangle (OBJtriangle const &tri, uint16_t rel)
+    {
+        this->triangles.push() = tri;
+        this->relative.push() = rel;
+        if (!this->events.empty() && (this->events.back().kind == OBJEvent::FACES)) {
+            this->events.back().count++;
+        } else {
+            this->events.push_back(OBJEvent{OBJEvent::FACES, {}, 1});
+        }
+    }
+
+    void readFace ();
+};
+
+/* OBJChunk::readFace: read the vertex references of an "f" line and add its
+ * triangles (as a fan)
+ */
+void
+OBJChunk::readFace ()
+{
+    int v = 0, n = 0, t = 0;
+    OBJFaceFormat fmt;
+
+    /* the format is determined by the first reference */
+    while ((this->p < this->end) && (*this->p != '\n') && OBJIsSpace(*this->p)) {
+        this->p++;
+    }
+    const char* tok = this->p;
+    while ((this->p < this->end) && !OBJIsSpace(*this->p)) {
+        this->p++;
+    }
+    std::string_view first(tok, this->p - tok);
+    if (first.empty()) {
+        return;
+    }
+    if (first.find("//") != std::string_view::npos) {
+        fmt = OBJ_VN;
+        const char* s = first.data();
+        OBJScanRef (s, s + first.size(), OBJ_VN, v, t, n);
+    }
+    else {
+        const char* s = first.data();
+        if (OBJScanRef (s, s + first.size(), OBJ_VTN, v, t, n) == 3) {
+            fmt = OBJ_VTN;
+        }
+        else {
+            s = first.data();
+            if (OBJScanRef (s, s + first.size(), OBJ_VT, v, t, n) == 2) {
+                fmt = OBJ_VT;
             }
-            switch(buf[1]) {
-            case '\0':          /* vertex */
-                /* eat up rest of line */
-                dummy = fgets(buf, sizeof(buf), file);
-                numvertices++;
-                break;
-            case 'n':           /* normal */
-                /* eat up rest of line */
-                dummy = fgets(buf, sizeof(buf), file);
-                numnormals++;
-                break;
-            case 't':           /* texcoord */
-                /* eat up rest of line */
-                dummy = fgets(buf, sizeof(buf), file);
-                numtexcoords++;
-                break;
-            default:
-                printf("OBJFirstPass(): Unknown token \"%s\".\n", buf);
-                exit(1);
-                break;
+            else {
+                fmt = OBJ_V;
+                s = first.data();
+                OBJScanRef (s, s + first.size(), OBJ_V, v, t, n);
             }
+        }
+    }
+    bool hasT = (fmt == OBJ_VT) || (fmt == OBJ_VTN);
+    bool hasN = (fmt == OBJ_VN) || (fmt == OBJ_VTN);
+
+    /* relative (negative) indices are relative to the next element */
+    uint32_t nv = this->vertices.size;
+    uint32_t nn = this->normals.size;
+    uint32_t nt = this->texcoords.size;
+
+    /* set the i'th corner of a triangle from the current reference */
+    auto setCorner = [&] (OBJtriangle& tri, uint16_t& rel, int i) {
+        tri.vindices[i] = v < 0 ? v + nv : v;
+        if (v < 0) rel |= OBJ_REL_V(i);
+        if (hasT) {
+            tri.tindices[i] = t < 0 ? t + nt : t;
+            if (t < 0) rel |= OBJ_REL_T(i);
+        }
+        if (hasN) {
+            tri.nindices[i] = n < 0 ? n + nn : n;
+            if (n < 0) rel |= OBJ_REL_N(i);
+        }
+    };
+
+    /* the first triangle uses the first three references */
+    OBJtriangle tri;
+    uint16_t rel = 0;
+    memset (&tri, 0, sizeof(OBJtriangle));
+    for (int i = 0;  i < 3;  i++) {
+        if (i > 0) {
+            OBJScanRef (this->p, this->end, fmt, v, t, n);
+        }
+        setCorner (tri, rel, i);
+    }
+    this->addTriangle (tri, rel);
+
+    /* the remaining references each add a triangle to the fan */
+    while (OBJScanRef (this->p, this->end, fmt, v, t, n) > 0) {
+        OBJtriangle next;
+        memset (&next, 0, sizeof(OBJtriangle));
+        next.vindices[0] = tri.vindices[0];
+        next.vindices[1] = tri.vindices[2];
+        next.tindices[0] = tri.tindices[0];
+        next.tindices[1] = tri.tindices[2];
+        next.nindices[0] = tri.nindices[0];
+        next.nindices[1] = tri.nindices[2];
+        uint16_t nextRel = (rel & (OBJ_REL_V(0) | OBJ_REL_T(0) | OBJ_REL_N(0)))
+            | ((rel & (OBJ_REL_V(2) | OBJ_REL_T(2) | OBJ_REL_N(2))) >> 1);
+        setCorner (next, nextRel, 2);
+        this->addTriangle (next, nextRel);
+        tri = next;
+        rel = nextRel;
+    }
+
+}
+
+/* OBJChunk::parse: read the lines of the chunk */
+void
+OBJChunk::parse ()
+{
+    while (true) {
+        /* find the start of the next token */
+        while ((this->p < this->end) && OBJIsSpace(*this->p)) {
+            this->p++;
+        }
+        if (this->p == this->end) {
             break;
-        case 'm':
-            dummy = fgets(buf, sizeof(buf), file);
-            sscanf(buf, "%s %s", buf, buf);
-            model->mtllibname = strdup(buf);
-            break;
-        case 'u':
-            if (group == 0) {
-              /* make a default group */
-                group = OBJAddGroup(model, "default");
+        }
+        const char* tok = this->p;
+        while ((this->p < this->end) && !OBJIsSpace(*this->p)) {
+            this->p++;
+        }
+        size_t tokLen = this->p - tok;
+
+        switch (tok[0]) {
+        case 'v': {             /* v, vn, vt */
+            this->ensureGroup();
+            char kind = (tokLen > 1) ? tok[1] : '\0';
+            if (kind == '\0') {         /* vertex */
+                glm::vec3& vert = this->vertices.push();
+                vert = glm::vec3(0.0f);
+                OBJParseFloats (this->p, this->end, &vert[0], 3);
             }
-            /* eat up rest of line */
-            dummy = fgets(buf, sizeof(buf), file);
+            else if (kind == 'n') {     /* normal */
+                glm::vec3& norm = this->normals.push();
+                norm = glm::vec3(0.0f);
+                OBJParseFloats (this->p, this->end, &norm[0], 3);
+            }
+            else if (kind == 't') {     /* texcoord */
+                glm::vec2& tc = this->texcoords.push();
+                tc = glm::vec2(0.0f);
+                OBJParseFloats (this->p, this->end, &tc[0], 2);
+            }
+            else {
+                printf("OBJReadOBJ(): Unknown token \"%.*s\".\n", int(tokLen), tok);
+                exit(1);
+            }
+            this->skipLine();
+          } break;
+        case 'm':               /* mtllib */
+            this->events.push_back(
+                OBJEvent{OBJEvent::MTLLIB, OBJScanName(this->restOfLine()), 0});
             break;
-        case 'g':               /* group */
-            /* eat up rest of line */
-            dummy = fgets(buf, sizeof(buf), file);
-#if SINGLE_STRING_GROUP_NAMES
-            sscanf(buf, "%s", buf);
-#else
-            buf[strlen(buf)-1] = '\0';  /* nuke '\n' */
-#endif
-            group = OBJAddGroup(model, buf);
+        case 'u':               /* usemtl */
+            this->ensureGroup();
+            this->events.push_back(
+                OBJEvent{OBJEvent::USEMTL, OBJScanName(this->restOfLine()), 0});
             break;
-        case 'f':               /* face */
-            if (group == 0) {
-              /* make a default group */
-                group = OBJAddGroup(model, "default");
-            }
-            v = n = t = 0;
-            fscanf(file, "%s", buf);
-            /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
-            if (strstr(buf, "//")) {
-                /* v//n */
-                sscanf(buf, "%d//%d", &v, &n);
-                fscanf(file, "%d//%d", &v, &n);
-                fscanf(file, "%d//%d", &v, &n);
-                numtriangles++;
-                group->numtriangles++;
-                while(fscanf(file, "%d//%d", &v, &n) > 0) {
-                    numtriangles++;
-                    group->numtriangles++;
-                }
-            } else if (sscanf(buf, "%d/%d/%d", &v, &t, &n) == 3) {
-                /* v/t/n */
-                fscanf(file, "%d/%d/%d", &v, &t, &n);
-                fscanf(file, "%d/%d/%d", &v, &t, &n);
-                numtriangles++;
-                group->numtriangles++;
-                while(fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
-                    numtriangles++;
-                    group->numtriangles++;
+        case 'g': {             /* group */
+            std::string_view name = this->restOfLine();
+#if SINGLE_STRING_GROUP_NAMES
+            {
+                size_t start = 0;
+                while ((start < name.size()) && OBJIsSpace(name[start])) {
+                    start++;
                 }
-            } else if (sscanf(buf, "%d/%d", &v, &t) == 2) {
-                /* v/t */
-                fscanf(file, "%d/%d", &v, &t);
-                fscanf(file, "%d/%d", &v, &t);
-                numtriangles++;
-                group->numtriangles++;
-                while(fscanf(file, "%d/%d", &v, &t) > 0) {
-                    numtriangles++;
-                    group->numtriangles++;
+                size_t stop = start;
+                while ((stop < name.size()) && !OBJIsSpace(name[stop])) {
+                    stop++;
                 }
-            } else {
-                /* v */
-                fscanf(file, "%d", &v);
-                fscanf(file, "%d", &v);
-                numtriangles++;
-                group->numtriangles++;
-                while(fscanf(file, "%d", &v) > 0) {
-                    numtriangles++;
-                    group->numtriangles++;
+                if (stop > start) {
+                    name = name.substr(start, stop - start);
                 }
             }
+#else
+            if (! name.empty()) {
+                name.remove_suffix(1);  /* nuke '\n' */
+            }
+#endif
+            this->events.push_back(OBJEvent{OBJEvent::GROUP, name, 0});
+            this->hasGroup = true;
+          } break;
+        case 'f':               /* face */
+            this->ensureGroup();
+            this->readFace();
+            this->skipLine();
             break;
-
+        case '#':               /* comment */
         default:
             /* eat up rest of line */
-            dummy = fgets(buf, sizeof(buf), file);
+            this->skipLine();
             break;
         }
-  }
-
-  /* set the stats in the model structure */
-  model->numvertices  = numvertices;
-  model->numnormals   = numnormals;
-  model->numtexcoords = numtexcoords;
-  model->numtriangles = numtriangles;
-
-  /* allocate memory for the triangles in each group */
-  group = model->groups;
-  while(group) {
-      group->triangles = new uint32_t[group->numtriangles];
-      group->numtriangles = 0;
-      group = group->next;
-  }
+    }
+
 }
 
-/* OBJSecondPass: second pass at a Wavefront OBJ file that gets all
- * the data.
+/* OBJGroupInfo: the per-group state used while building the model */
+struct OBJGroupInfo {
+    OBJgroup*           group;          /* the group */
+    OBJArray<uint32_t>  triangles;      /* the group's triangle indices */
+    bool                named;          /* true if there is a "g" line for the group */
+
+    explicit OBJGroupInfo (OBJgroup* grp) : group(grp), named(false) { }
+};
+
+/* OBJGroupBuilder: builds the model's groups by replaying the events of the
+ * chunks in file order.
  *
- * model - properly initialized OBJmodel structure
- * file  - (fopen'd) file descriptor
+ * The original reader assigned the faces and materials that precede the first
+ * "g" line to the group at the head of the group list at the end of the first
+ * pass.  Since we do not know which group that is until the end of the file,
+ * we collect them separately and assign them in finish().
  */
-static void
-OBJSecondPass (OBJmodel* model, FILE* file)
+struct OBJGroupBuilder {
+    OBJmodel*                   model;
+    std::deque<OBJGroupInfo>    groups;         /* the groups in order of creation */
+    std::unordered_map<std::string_view, OBJGroupInfo*> groupIndex;
+    OBJGroupInfo*               group;          /* the current group; nullptr
+                                                 * before the first "g" line */
+    OBJArray<uint32_t>          headTriangles;  /* triangles before the first "g" */
+    std::string                 headMaterial;   /* material before the first "g" */
+    bool                        hasHeadMaterial;
+    std::string                 material;       /* the current material */
+    bool                        hasMaterial;
+
+    explicit OBJGroupBuilder (OBJmodel* m)
+      : model(m), group(nullptr), hasHeadMaterial(false), hasMaterial(false)
+    { }
+
+    OBJGroupInfo* addGroup (std::string_view name);
+    void replay (OBJChunk const &chunk, uint32_t firstTri);
+    void finish ();
+};
+
+/* OBJGroupBuilder::addGroup: find the named group or add a new one to the
+ * front of the model's group list
+ */
+OBJGroupInfo*
+OBJGroupBuilder::addGroup (std::string_view name)
 {
-    uint32_t numvertices;       /* number of vertices in model */
-    uint32_t numnormals;        /* number of normals in model */
-    uint32_t numtexcoords;      /* number of texcoords in model */
-    uint32_t numtriangles;      /* number of triangles in model */
-    glm::vec3 *vertices;     /* array of vertices  */
-    glm::vec3 *normals;      /* array of normals */
-    glm::vec2 *texcoords;    /* array of texture coordinates */
-    OBJgroup* group;            /* current group pointer */
-    char* material;             /* current material */
-    int v, n, t;
-    char buf[512];
-    char *dummy;
-
-    /* set the pointer shortcuts */
-    vertices    = model->vertices;
-    normals     = model->normals;
-    texcoords   = model->texcoords;
-    group       = model->groups;
-
-    /* on the second pass through the file, read all the data into the
-    allocated arrays */
-    numvertices = numnormals = numtexcoords = 1;
-    numtriangles = 0;
-    material = nullptr;
-    while (fscanf(file, "%s", buf) != EOF) {
-        switch (buf[0]) {
-        case '#':               /* comment */
-            /* eat up rest of line */
-            dummy = fgets(buf, sizeof(buf), file);
-            break;
-        case 'v':               /* v, vn, vt */
-            switch (buf[1]) {
-            case '\0':          /* vertex */
-                fscanf(file, "%f %f %f",
-                    &(vertices[numvertices][0]),
-                    &(vertices[numvertices][1]),
-                    &(vertices[numvertices][2]));
-                numvertices++;
-                break;
-            case 'n':           /* normal */
-                fscanf(file, "%f %f %f",
-                    &(normals[numnormals][0]),
-                    &(normals[numnormals][1]),
-                    &(normals[numnormals][2]));
-                numnormals++;
-                break;
-            case 't':           /* texcoord */
-                fscanf(file, "%f %f",
-                    &(texcoords[numtexcoords][0]),
-                    &(texcoords[numtexcoords][1]));
-                numtexcoords++;
-                break;
+    auto it = this->groupIndex.find(name);
+    if (it != this->groupIndex.end()) {
+        return it->second;
+    }
+
+    OBJgroup* grp = new OBJgroup;
+    grp->name = OBJCopyString(name.data(), name.size());
+    grp->material = nullptr;
+    grp->numtriangles = 0;
+    grp->triangles = nullptr;
+    grp->next = this->model->groups;
+    this->model->groups = grp;
+    this->model->numgroups++;
+
+    this->groups.emplace_back(grp);
+    OBJGroupInfo* info = &this->groups.back();
+    this->groupIndex.insert({ std::string_view(grp->name, name.size()), info });
+
+    return info;
+}
+
+/* OBJGroupBuilder::replay: process the events of a chunk, whose first triangle
+ * has the index firstTri in the model
+ */
+void
+OBJGroupBuilder::replay (OBJChunk const &chunk, uint32_t firstTri)
+{
+    uint32_t nextTri = firstTri;
+    for (auto const &ev : chunk.events) {
+        switch (ev.kind) {
+        case OBJEvent::ENSURE_GROUP:
+            if (this->groups.empty()) {
+                this->addGroup ("default");
             }
             break;
-            case 'u':
-                dummy = fgets(buf, sizeof(buf), file);
-                sscanf(buf, "%s %s", buf, buf);
-                material = strdup(buf);
-              // if there is already a material associated with this group, then we
-              // ignore this material.
-/* QUESION: will this work for multiple groups with shared and different materials? */
-                if (group->material == nullptr) {
-                    group->material = material;
+        case OBJEvent::GROUP: {
+            this->group = this->addGroup(ev.name);
+            this->group->named = true;
+            OBJgroup* grp = this->group->group;
+            delete[] grp->material;
+            grp->material = this->hasMaterial
+                ? OBJCopyString(this->material.data(), this->material.size())
+                : nullptr;
+          } break;
+        case OBJEvent::USEMTL:
+            this->material = ev.name;
+            this->hasMaterial = true;
+            // if there is already a material associated with this group, then we
+            // ignore this material.
+            if (this->group == nullptr) {
+                if (! this->hasHeadMaterial) {
+                    this->headMaterial = this->material;
+                    this->hasHeadMaterial = true;
                 }
-                break;
-            case 'g':               /* group */
-                /* eat up rest of line */
-                dummy = fgets(buf, sizeof(buf), file);
-#if SINGLE_STRING_GROUP_NAMES
-                sscanf(buf, "%s", buf);
-#else
-                buf[strlen(buf)-1] = '\0';  /* nuke '\n' */
-#endif
-                group = OBJFindGroup(model, buf);
-                group->material = (material != nullptr) ? strdup(material) : nullptr;
-                break;
-            case 'f':               /* face */
-                v = n = t = 0;
-                fscanf(file, "%s", buf);
-                /* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
-                if (strstr(buf, "//")) {
-                    /* v//n */
-                    sscanf(buf, "%d//%d", &v, &n);
-                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).nindices[0] = n < 0 ? n + numnormals : n;
-                    fscanf(file, "%d//%d", &v, &n);
-                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).nindices[1] = n < 0 ? n + numnormals : n;
-                    fscanf(file, "%d//%d", &v, &n);
-                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-                    group->triangles[group->numtriangles++] = numtriangles;
-                    numtriangles++;
-                    while(fscanf(file, "%d//%d", &v, &n) > 0) {
-                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-                        T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
-                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-                        T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
-                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                        T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-                        group->triangles[group->numtriangles++] = numtriangles;
-                        numtriangles++;
-                    }
-                } else if (sscanf(buf, "%d/%d/%d", &v, &t, &n) == 3) {
-                    /* v/t/n */
-                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[0] = t < 0 ? t + numtexcoords : t;
-                    T(numtriangles).nindices[0] = n < 0 ? n + numnormals : n;
-                    fscanf(file, "%d/%d/%d", &v, &t, &n);
-                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[1] = t < 0 ? t + numtexcoords : t;
-                    T(numtriangles).nindices[1] = n < 0 ? n + numnormals : n;
-                    fscanf(file, "%d/%d/%d", &v, &t, &n);
-                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-                    T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-                    group->triangles[group->numtriangles++] = numtriangles;
-                    numtriangles++;
-                    while(fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
-                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-                        T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
-                        T(numtriangles).nindices[0] = T(numtriangles-1).nindices[0];
-                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-                        T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
-                        T(numtriangles).nindices[1] = T(numtriangles-1).nindices[2];
-                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                        T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-                        T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-                        group->triangles[group->numtriangles++] = numtriangles;
-                        numtriangles++;
-                    }
-                } else if (sscanf(buf, "%d/%d", &v, &t) == 2) {
-                    /* v/t */
-                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[0] = t < 0 ? t + numtexcoords : t;
-                    fscanf(file, "%d/%d", &v, &t);
-                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[1] = t < 0 ? t + numtexcoords : t;
-                    fscanf(file, "%d/%d", &v, &t);
-                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                    T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-                    group->triangles[group->numtriangles++] = numtriangles;
-                    numtriangles++;
-                    while(fscanf(file, "%d/%d", &v, &t) > 0) {
-                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-                        T(numtriangles).tindices[0] = T(numtriangles-1).tindices[0];
-                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-                        T(numtriangles).tindices[1] = T(numtriangles-1).tindices[2];
-                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                        T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-                        group->triangles[group->numtriangles++] = numtriangles;
-                        numtriangles++;
-                    }
-                } else {
-                    /* v */
-                    sscanf(buf, "%d", &v);
-                    T(numtriangles).vindices[0] = v < 0 ? v + numvertices : v;
-                    fscanf(file, "%d", &v);
-                    T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
-                    fscanf(file, "%d", &v);
-                    T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                    group->triangles[group->numtriangles++] = numtriangles;
-                    numtriangles++;
-                    while(fscanf(file, "%d", &v) > 0) {
-                        T(numtriangles).vindices[0] = T(numtriangles-1).vindices[0];
-                        T(numtriangles).vindices[1] = T(numtriangles-1).vindices[2];
-                        T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-                        group->triangles[group->numtriangles++] = numtriangles;
-                        numtriangles++;
-                    }
-                }
-                break;
+            }
+            else if (this->group->group->material == nullptr) {
+                this->group->group->material =
+                    OBJCopyString(this->material.data(), this->material.size());
+            }
+            break;
+        case OBJEvent::MTLLIB:
+            delete[] this->model->mtllibname;
+            this->model->mtllibname = OBJCopyString(ev.name.data(), ev.name.size());
+            break;
+        case OBJEvent::FACES: {
+            OBJArray<uint32_t>& tris = (this->group != nullptr)
+                ? this->group->triangles
+                : this->headTriangles;
+            for (uint32_t i = 0;  i < ev.count;  i++) {
+                tris.push() = nextTri++;
+            }
+          } break;
+        }
+    }
+
+}
 
-            default:
-                /* eat up rest of line */
-                dummy = fgets(buf, sizeof(buf), file);
-                break;
+/* OBJGroupBuilder::finish: assign any faces and material that preceded the
+ * first "g" line to the head of the group list and then transfer the triangle
+ * arrays to the groups
+ */
+void
+OBJGroupBuilder::finish ()
+{
+    if (this->model->groups != nullptr) {
+        OBJGroupInfo* head = this->groupIndex[std::string_view(this->model->groups->name)];
+        if (this->headTriangles.size > 0) {
+            OBJArray<uint32_t> tris;
+            for (uint32_t i = 0;  i < this->headTriangles.size;  i++) {
+                tris.push() = this->headTriangles.elems[i];
+            }
+            for (uint32_t i = 0;  i < head->triangles.size;  i++) {
+                tris.push() = head->triangles.elems[i];
+            }
+            head->triangles.swap (tris);
         }
+        if (this->hasHeadMaterial && !head->named) {
+            head->group->material =
+                OBJCopyString(this->headMaterial.data(), this->headMaterial.size());
+        }
+    }
+
+    for (auto& info : this->groups) {
+        info.group->numtriangles = info.triangles.size;
+        info.group->triangles = info.triangles.release();
     }
 
 }
 
+/* OBJCopyTriangles: copy a chunk's triangles to dst, adjusting the relative
+ * indices by the number of vertices (nv), texcoords (nt), and normals (nn)
+ * in the preceding chunks
+ */
+static void
+OBJCopyTriangles(OBJChunk const &chunk, OBJtriangle* dst,
+    uint32_t nv, uint32_t nt, uint32_t nn)
+{
+    const OBJtriangle* src = chunk.triangles.elems;
+    const uint16_t* rel = chunk.relative.elems;
+    for (uint32_t i = 0;  i < chunk.triangles.size;  i++) {
+        dst[i] = src[i];
+        if (rel[i] != 0) {
+            for (int j = 0;  j < 3;  j++) {
+                if (rel[i] & OBJ_REL_V(j)) dst[i].vindices[j] += nv;
+                if (rel[i] & OBJ_REL_T(j)) dst[i].tindices[j] += nt;
+                if (rel[i] & OBJ_REL_N(j)) dst[i].nindices[j] += nn;
+            }
+        }
+    }
+}
+
+/* OBJBuildModel: fill in the model from the chunks, which have been parsed.
+ * If there is more than one chunk, the vertex data and triangles are copied
+ * in parallel using the job system.
+ */
+static void
+OBJBuildModel(OBJmodel* model, std::vector<std::unique_ptr<OBJChunk>> &chunks,
+    cs237::JobSystem* jobs)
+{
+    /* the groups */
+    OBJGroupBuilder builder(model);
+    uint32_t nTris = 0;
+    for (auto& chunk : chunks) {
+        builder.replay (*chunk, nTris);
+        nTris += chunk->triangles.size;
+    }
+    builder.finish ();
+
+    if (chunks.size() == 1) {
+        /* we can just take the chunk's arrays */
+        OBJChunk* chunk = chunks[0].get();
+        model->numvertices = chunk->vertices.size - 1;
+        model->vertices = chunk->vertices.release();
+        model->numnormals = chunk->normals.size - 1;
+        if (model->numnormals > 0) {
+            model->normals = chunk->normals.release();
+        }
+        model->numtexcoords = chunk->texcoords.size - 1;
+        if (model->numtexcoords > 0) {
+            model->texcoords = chunk->texcoords.release();
+        }
+        model->numtriangles = chunk->triangles.size;
+        model->triangles = chunk->triangles.release();
+        return;
+    }
+
+    /* compute the totals; note that the first chunk includes the dummy elements */
+    uint32_t nv = 0, nn = 0, nt = 0;
+    for (auto& chunk : chunks) {
+        nv += chunk->vertices.size;
+        nn += chunk->normals.size;
+        nt += chunk->texcoords.size;
+    }
+    model->numvertices = nv - 1;
+    model->vertices = new glm::vec3[nv];
+    model->numnormals = nn - 1;
+    if (model->numnormals > 0) {
+        model->normals = new glm::vec3[nn];
+    }
+    model->numtexcoords = nt - 1;
+    if (model->numtexcoords > 0) {
+        model->texcoords = new glm::vec2[nt];
+    }
+    model->numtriangles = nTris;
+    model->triangles = new OBJtriangle[nTris];
+
+    /* copy the chunks' data into place */
+    std::vector<cs237::Job*> copyJobs;
+    nv = nn = nt = nTris = 0;
+    for (auto& chunkPtr : chunks) {
+        OBJChunk* chunk = chunkPtr.get();
+        copyJobs.push_back(jobs->spawn([=] () {
+            if (chunk->vertices.size > 0) {
+                memcpy (model->vertices + nv, chunk->vertices.elems,
+                    chunk->vertices.size * sizeof(glm::vec3));
+            }
+            if ((model->normals != nullptr) && (chunk->normals.size > 0)) {
+                memcpy (model->normals + nn, chunk->normals.elems,
+                    chunk->normals.size * sizeof(glm::vec3));
+            }
+            if ((model->texcoords != nullptr) && (chunk->texcoords.size > 0)) {
+                memcpy (model->texcoords + nt, chunk->texcoords.elems,
+                    chunk->texcoords.size * sizeof(glm::vec2));
+            }
+            OBJCopyTriangles (*chunk, model->triangles + nTris, nv, nt, nn);
+        }));
+        nv += chunk->vertices.size;
+        nn += chunk->normals.size;
+        nt += chunk->texcoords.size;
+        nTris += chunk->triangles.size;
+    }
+    for (auto job : copyJobs) {
+        jobs->wait (job);
+    }
+
+}
 
 /* public functions */
 
@@ -462,44 +959,72 @@ OBJDimensions(OBJmodel* model, float* dimensions)
  * `delete`.
  *
  * filename - name of the file containing the Wavefront .OBJ format data.
+ * jobs     - optional job system; if it is provided and the file is large,
+ *            then the file is split into chunks at line boundaries, which
+ *            are parsed in parallel.  The result is the same as reading the
+ *            file serially.
  */
 OBJmodel*
-OBJReadOBJ (const char* filename)
+OBJReadOBJ (const char* filename, cs237::JobSystem* jobs)
 {
-    FILE* file;
-
-    /* open the file */
-    file = fopen(filename, "r");
-    if (!file) {
+    /* map the file into memory */
+    cs237::MappedFile file(filename);
+    if (! file.isValid()) {
         fprintf(stderr, "OBJReadOBJ() failed: can't open data file \"%s\".\n",
             filename);
         exit(1);
     }
 
-    /* allocate a new model */
-    OBJmodel* model = new OBJmodel();
+    /* decide how many chunks to split the file into; we use several chunks
+     * per thread to balance the load, since the density of faces and vertices
+     * can vary across the file.
+     */
+    size_t nChunks = 1;
+    if (jobs != nullptr) {
+        nChunks = std::min(
+            file.size() / kOBJMinChunkSize,
+            size_t(4 * (jobs->numWorkers() + 1)));
+        if (nChunks < 1) {
+            nChunks = 1;
+        }
+    }
 
-    /* make a first pass through the file to get a count of the number
-    of vertices, normals, texcoords & triangles */
-    OBJFirstPass (model, file);
+    /* split the file at line boundaries */
+    std::vector<std::unique_ptr<OBJChunk>> chunks;
+    const char* start = file.data();
+    for (size_t i = 0;  i < nChunks;  i++) {
+        const char* stop = file.end();
+        if (i+1 < nChunks) {
+            stop = file.data() + ((i+1) * file.size()) / nChunks;
+            if (stop < start) {
+                stop = start;
+            }
+            const char* nl = static_cast<const char*>(
+                memchr (stop, '\n', file.end() - stop));
+            stop = (nl == nullptr) ? file.end() : nl + 1;
+        }
+        chunks.push_back(std::make_unique<OBJChunk>(start, stop, i == 0));
+        start = stop;
+    }
 
-    /* allocate memory */
-    model->vertices = new glm::vec3[model->numvertices + 1];
-    model->triangles = new OBJtriangle[model->numtriangles];
-    if (model->numnormals > 0) {
-        model->normals = new glm::vec3[model->numnormals + 1];
+    /* parse the chunks */
+    if (chunks.size() == 1) {
+        chunks[0]->parse();
     }
-    if (model->numtexcoords > 0) {
-        model->texcoords = new glm::vec2[model->numtexcoords + 1];
+    else {
+        std::vector<cs237::Job*> parseJobs;
+        for (auto& chunk : chunks) {
+            OBJChunk* c = chunk.get();
+            parseJobs.push_back(jobs->spawn([c] () { c->parse(); }));
+        }
+        for (auto job : parseJobs) {
+            jobs->wait (job);
+        }
     }
 
-    /* rewind to beginning of file and read in the data this pass */
-    rewind(file);
-
-    OBJSecondPass(model, file);
-
-    /* close the file */
-    fclose(file);
+    /* allocate a new model and fill it in */
+    OBJmodel* model = new OBJmodel();
+    OBJBuildModel (model, chunks, jobs);
 
     return model;
 }
@@ -526,7 +1051,7 @@ OBJmodel::~OBJmodel ()
         delete[] group->name;
         if (group->material) { delete[] group->material; }
         delete[] group->triangles;
-        delete[] group;
+        delete group;
     }
 
 }
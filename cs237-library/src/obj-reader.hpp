@@ -5,6 +5,10 @@
 #ifndef _OBJ_READER_HXX_
 #define _OBJ_READER_HXX_
 
+namespace cs237 {
+class JobSystem;
+}
+
 #ifndef GLM_SETUP_INCLUDED
 #include "glm/glm.hpp"
 #endif
@@ -55,10 +59,16 @@ struct OBJmodel {
 
 /* OBJReadOBJ: Reads a model description from a Wavefront .OBJ file.
  * Returns a pointer to the created object which should be free'd with
- * OBJDelete().
+ * `delete`.
  *
  * filename - name of the file containing the Wavefront .OBJ format data.
+ * jobs     - an optional job system for parsing large files in parallel.
+ */
+OBJmodel *OBJReadOBJ (const char* filename, cs237::JobSystem* jobs = nullptr);
+
+/* OBJReadOBJLegacy: the original two-pass reader, which produces the same
+ * model as OBJReadOBJ.  It is only used to test and benchmark OBJReadOBJ.
  */
-OBJmodel *OBJReadOBJ (const char* filename);
+OBJmodel *OBJReadOBJLegacy (const char* filename);
 
 #endif /*! _OBJ_READER_HXX_ */
@@ -12,7 +12,6 @@
 
 #include "obj.hpp"
 #include "obj-reader.hpp"
-#include <unordered_map>
 #include <cstdlib>
 
 namespace OBJ {
@@ -30,31 +29,141 @@ struct VInfo {
 
     VInfo (uint32_t v, uint32_t n, uint32_t t) : _v(v), _n(n), _t(t) { }
 
-    struct Hash {
-        std::size_t operator() (VInfo const &v) const
-        {
-            return static_cast<std::size_t>(
-                v._v +
-                (v._n << 5) * 101 +
-                (v._t << 10) * 101);
+    bool operator== (VInfo const &other) const
+    {
+        return (this->_v == other._v) && (this->_n == other._n) && (this->_t == other._t);
+    }
+
+}; // VInfo
+
+// A map from v/n/t triples to vertex indices that is implemented as a flat
+// open-addressing hash table with linear probing.  The entries are stored
+// inline, so a lookup usually touches a single cache line.
+class VertexMap {
+  public:
+    VertexMap () : _mask(0), _size(0), _relN(false), _relT(false) { }
+
+  // clear the map and make sure that it can hold n entries without growing.  The
+  // sample triangle is used to choose how the attribute indices are hashed (see _hash).
+    void reset (uint32_t n, OBJtriangle const *sample)
+    {
+        size_t cap = 16;
+        while (cap * kMaxLoadNum < size_t(n) * kMaxLoadDenom) {
+            cap *= 2;
         }
-    };
-    struct Equal {
-        bool operator()(VInfo const &v1, VInfo const &v2) const
-        {
-            return (v1._v == v2._v) && (v1._n == v2._n) && (v1._t == v2._t);
+        if (cap == this->_entries.size()) {
+            std::fill (this->_entries.begin(), this->_entries.end(), Entry());
+        }
+        else {
+            this->_entries.assign (cap, Entry());
+            this->_mask = cap - 1;
+        }
+        this->_size = 0;
+        this->_relN = this->_relT = true;
+        for (int j = 0;  j < 3;  j++) {
+            this->_relN &= (sample->nindices[j] == sample->vindices[j]);
+            this->_relT &= (sample->tindices[j] == sample->vindices[j]);
+        }
+    }
+
+  // return the index for v, adding it with index `idx` if it is not in the map
+    uint32_t findOrInsert (VInfo const &v, uint32_t idx)
+    {
+        if ((this->_size + 1) * kMaxLoadDenom > this->_entries.size() * kMaxLoadNum) {
+            this->_grow();
         }
+        size_t i = this->_hash(v) & this->_mask;
+        while (true) {
+            Entry &e = this->_entries[i];
+            if (e.idx == kEmpty) {
+                e.key = v;
+                e.idx = idx;
+                this->_size++;
+                return idx;
+            }
+            else if (e.key == v) {
+                return e.idx;
+            }
+            i = (i + 1) & this->_mask;
+        }
+    }
+
+  private:
+    static const uint32_t kEmpty = ~0u;
+    // the maximum load factor is kMaxLoadNum / kMaxLoadDenom
+    static const size_t kMaxLoadNum = 7;
+    static const size_t kMaxLoadDenom = 10;
+
+    struct Entry {
+        VInfo key;
+        uint32_t idx;           // the vertex index; kEmpty for unused entries
+        Entry () : key(0, 0, 0), idx(kEmpty) { }
     };
 
-}; // VInfo
+    std::vector<Entry> _entries;
+    size_t _mask;               // _entries.size() - 1
+    uint32_t _size;             // the number of entries in use
+    bool _relN;                 // hash normal indices relative to the vertex index?
+    bool _relT;                 // hash texture-coordinate indices relative to the
+                                // vertex index?
 
-typedef std::unordered_map<VInfo,uint32_t,VInfo::Hash,VInfo::Equal> VertexMap_t;
+  // hash a triple.  The normal and texture-coordinate indices are mixed using
+  // the 64-bit finalizer from MurmurHash3, which scatters arbitrary attribute
+  // combinations across the table, while the vertex index is added unmixed so
+  // that consecutive vertices land in nearby entries.  To preserve this locality,
+  // the attribute indices need to be (nearly) constant across the mesh, so we
+  // use them as offsets from the vertex index when the mesh has per-vertex
+  // attributes (e.g., "f 1/1/1 2/2/2 3/3/3") and as-is otherwise (e.g., for
+  // shared or missing attributes).  Since the corners of a triangle have distinct
+  // vertices, checking all three corners of the sample triangle is enough to
+  // tell the cases apart.
+    uint64_t _hash (VInfo const &v) const
+    {
+        uint32_t n = this->_relN ? v._n - v._v : v._n;
+        uint32_t t = this->_relT ? v._t - v._v : v._t;
+        uint64_t h = (uint64_t(n) << 32) | t;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return 2 * uint64_t(v._v) + h;
+    }
 
-Model::Model (std::string file)
-    : _path(file), _bbox()
+    void _grow ()
+    {
+        std::vector<Entry> old;
+        old.swap (this->_entries);
+        size_t cap = (old.size() == 0) ? 16 : 2 * old.size();
+        this->_entries.assign (cap, Entry());
+        this->_mask = cap - 1;
+        for (auto const &e : old) {
+            if (e.idx != kEmpty) {
+                size_t i = this->_hash(e.key) & this->_mask;
+                while (this->_entries[i].idx != kEmpty) {
+                    i = (i + 1) & this->_mask;
+                }
+                this->_entries[i] = e;
+            }
+        }
+    }
+
+}; // VertexMap
+
+bool Model::_cacheEnabled = true;
+bool Model::_optimizeMeshes = false;
+bool Model::_buildLODs = false;
+
+Model::Model (std::string file, cs237::JobSystem *jobs)
+    : _path(file), _bbox(), _cache(nullptr), _borrowed(false)
 {
+    std::string cacheFile = file + ".cache";
+    if (Model::_cacheEnabled && this->_readCache (cacheFile)) {
+        return;
+    }
+
   // read the file
-    OBJmodel *model = OBJReadOBJ (file.c_str());
+    OBJmodel *model = OBJReadOBJ (file.c_str(), jobs);
     if (model == 0) {
         std::cerr << "unable to read model \"" << file << "\"" << std::endl;
         exit (1);
@@ -80,28 +189,33 @@ Model::Model (std::string file)
 
   // build mesh data structures for the groups.  We need to identify unique v/n/t
   // triplets
-    VertexMap_t map;
+    VertexMap map;
     std::vector<VInfo> verts;
     std::vector<uint32_t> indices;
-    uint32_t idx;
     for (OBJgroup *grp = model->groups;  grp != nullptr;  grp = grp->next) {
         if (grp->numtriangles == 0) {
             std::cout << "Warning [" << file << "]: skipping empty group '"
                 << grp->name << "'\n";
             continue;
         }
+      // size the map for the expected number of unique vertices, which is
+      // bounded by the number of triangle corners; we also use the number of
+      // distinct attribute values in the model as an estimate, since meshes
+      // usually share most of their corners.
+        uint32_t nCorners = 3 * grp->numtriangles;
+        uint32_t expected = std::max(model->numvertices,
+            std::max(model->numnormals, model->numtexcoords));
+        expected = std::min(nCorners, expected);
+        map.reset (expected, &(model->triangles[grp->triangles[0]]));
+        verts.reserve (expected);
+        indices.reserve (nCorners);
         for (uint32_t i = 0;  i < grp->numtriangles;  i++) {
             for (int j = 0;  j < 3;  j++) {
-                OBJtriangle *tri = &(model->triangles[i]);
+                OBJtriangle *tri = &(model->triangles[grp->triangles[i]]);
                 VInfo v(tri->vindices[j], tri->nindices[j], tri->tindices[j]);
-                VertexMap_t::const_iterator got = map.find (v);
-                if (got == map.end()) {
-                    idx = verts.size();
+                uint32_t idx = map.findOrInsert (v, verts.size());
+                if (idx == verts.size()) {
                     verts.push_back (v);
-                    map.insert (std::pair<VInfo,uint32_t>(v, idx));
-                }
-                else {
-                    idx = got->second;
                 }
                 indices.push_back(idx);
             }
@@ -176,20 +290,64 @@ Model::Model (std::string file)
         for (uint32_t i = 0;  i < g.nIndices;  i++) {
             g.indices[i] = indices[i];
         }
+      // reorder the triangles and vertices for rendering
+        if (Model::_optimizeMeshes) {
+            cs237::mesh::optimize (
+                g.nVerts, g.nIndices, g.verts, g.norms, g.txtCoords, g.indices);
+        }
+      // build the levels of detail; this step must follow the optimization pass,
+      // since that pass renumbers the vertices
+        if (Model::_buildLODs) {
+            std::vector<uint32_t> lodIndices;
+            std::vector<cs237::mesh::LOD> lods = cs237::mesh::buildLODs (
+                g.nIndices, g.indices, g.verts, g.nVerts, lodIndices);
+            if (! lods.empty()) {
+                g.nLODs = lods.size();
+                g.lods = new cs237::mesh::LOD[g.nLODs];
+                std::copy (lods.begin(), lods.end(), g.lods);
+                g.nLODIndices = lodIndices.size();
+                g.lodIndices = new uint32_t[g.nLODIndices];
+                std::copy (lodIndices.begin(), lodIndices.end(), g.lodIndices);
+            }
+        }
       // add to this model
         this->_groups.push_back (g);
       // cleanup
-        map.clear();
         verts.clear();
         indices.clear();
     }
 
     delete model;
 
+    if (Model::_cacheEnabled) {
+        this->_writeCache (cacheFile);
+    }
+
+} // Model::Model
+
+Model::Model (std::string const &name, const char *data, size_t sz)
+    : _path(name), _bbox(), _cache(nullptr), _borrowed(true)
+{
+    if ((reinterpret_cast<uintptr_t>(data) % 16 != 0)
+    || ! this->_loadCache (data, sz, name, false)) {
+        std::cerr << "invalid model data for \"" << name << "\"" << std::endl;
+        exit (1);
+    }
+
 } // Model::Model
 
 Model::~Model ()
 {
+  // if the group data lives in a cache file, then we just need to unmap it
+    if (this->_cache != nullptr) {
+        delete this->_cache;
+        return;
+    }
+  // if the group data is owned by someone else, then there is nothing to do
+    if (this->_borrowed) {
+        return;
+    }
+
   // free the storage for the groups
     for (uint32_t i = 0;  i < this->_groups.size();  i++) {
         assert (this->_groups[i].verts != nullptr);
@@ -202,6 +360,10 @@ Model::~Model ()
         }
         assert (this->_groups[i].indices != nullptr);
         delete[] this->_groups[i].indices;
+        if (this->_groups[i].lods != nullptr) {
+            delete[] this->_groups[i].lods;
+            delete[] this->_groups[i].lodIndices;
+        }
     }
 } // Model::~Model
 
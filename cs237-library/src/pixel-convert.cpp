@@ -0,0 +1,652 @@
+/*! \file pixel-convert.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Kernels for converting pixels between formats: adding and removing channels,
+ * swizzling (e.g., BGRA to RGBA), converting between 8-bit, 16-bit, and float
+ * channels, and encoding and decoding sRGB data.  The common conversions have
+ * vectorized kernels that use SSE2, SSSE3, or AVX2 (depending on the target
+ * instruction set); the other conversions go through a general path that
+ * converts blocks of pixels to normalized floats.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "pixel-convert.hpp"
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cs237 {
+namespace __detail {
+
+/***** sRGB tables *****/
+
+SRGBTables::SRGBTables ()
+{
+    for (int i = 0;  i < 256;  ++i) {
+        float c = float(i) / 255.0f;
+        this->toLinear[i] = (c <= 0.04045f)
+            ? c / 12.92f
+            : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (uint32_t i = 0;  i < kLinearToSRGBSz;  ++i) {
+        float l = float(i) / float(kLinearToSRGBSz - 1);
+        float c = (l <= 0.0031308f)
+            ? 12.92f * l
+            : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+        this->fromLinear[i] = uint8_t(std::lround(255.0f * c));
+    }
+}
+
+SRGBTables const &srgbTables ()
+{
+    static SRGBTables tables;
+    return tables;
+}
+
+// convert sRGB-encoded and linear values in 0..1 (for channel types other than U8)
+static float decodeSRGB (float c)
+{
+    return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+static float encodeSRGB (float l)
+{
+    return (l <= 0.0031308f) ? 12.92f * l : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+}
+
+/***** channel mapping *****/
+
+// special values in a channel map
+constexpr int kZero = -1;       // the channel is set to zero
+constexpr int kOne = -2;        // the channel is set to one (i.e., opaque alpha)
+
+// the meaning of each channel of a format (0 = red, 1 = green, 2 = blue, and 3 = alpha)
+// \return the number of channels
+static int channelSemantics (Channels chans, int sem[4])
+{
+    switch (chans) {
+    case Channels::R: sem[0] = 0; return 1;
+    case Channels::RG: sem[0] = 0; sem[1] = 1; return 2;
+    case Channels::RGB: sem[0] = 0; sem[1] = 1; sem[2] = 2; return 3;
+    case Channels::BGR: sem[0] = 2; sem[1] = 1; sem[2] = 0; return 3;
+    case Channels::RGBA: sem[0] = 0; sem[1] = 1; sem[2] = 2; sem[3] = 3; return 4;
+    case Channels::BGRA: sem[0] = 2; sem[1] = 1; sem[2] = 0; sem[3] = 3; return 4;
+    default:
+        ERROR("unknown channels");
+        return 0;
+    }
+}
+
+// the number of channels in a format
+static int numChannels (Channels chans)
+{
+    int sem[4];
+    return channelSemantics (chans, sem);
+}
+
+// the size in bytes of a channel
+static size_t sizeOfType (ChannelTy ty)
+{
+    switch (ty) {
+    case ChannelTy::U8: case ChannelTy::S8: return 1;
+    case ChannelTy::U16: case ChannelTy::S16: return 2;
+    case ChannelTy::U32: case ChannelTy::S32: case ChannelTy::F32: return 4;
+    default:
+        ERROR("unknown channel type");
+        return 0;
+    }
+}
+
+// is channel `c` of a format an alpha channel?
+static bool isAlpha (Channels chans, int c)
+{
+    return (c == 3) && ((chans == Channels::RGBA) || (chans == Channels::BGRA));
+}
+
+// compute the source channel for each destination channel; a single-channel
+// source is treated as gray, so it is replicated into the color channels,
+// missing alpha is opaque, and other missing channels are zero.
+// \return the number of destination channels
+static int channelMap (Channels src, Channels dst, int map[4])
+{
+    int srcSem[4], dstSem[4];
+    int nSrc = channelSemantics (src, srcSem);
+    int nDst = channelSemantics (dst, dstSem);
+    for (int i = 0;  i < nDst;  ++i) {
+        map[i] = (dstSem[i] == 3) ? kOne : ((src == Channels::R) ? 0 : kZero);
+        for (int j = 0;  j < nSrc;  ++j) {
+            if (srcSem[j] == dstSem[i]) {
+                map[i] = j;
+            }
+        }
+    }
+    return nDst;
+}
+
+// the value used for an opaque alpha channel
+template <typename T> constexpr T oneValue () { return std::numeric_limits<T>::max(); }
+template <> constexpr float oneValue<float> () { return 1.0f; }
+
+// remap the channels of pixels with a fixed number of source and destination
+// channels; `idx` maps destination channels to slots in a buffer that holds the
+// source pixel followed by zero and one, so that the inner loops have no branches.
+template <typename T, int NSrc, int NDst>
+static void remapFixed (const T *src, T *dst, const int idx[4], size_t n)
+{
+    T px[NSrc + 2];
+    px[NSrc] = T(0);
+    px[NSrc + 1] = oneValue<T>();
+    for (size_t i = 0;  i < n;  ++i) {
+        for (int c = 0;  c < NSrc;  ++c) {
+            px[c] = src[c];
+        }
+        for (int c = 0;  c < NDst;  ++c) {
+            dst[c] = px[idx[c]];
+        }
+        src += NSrc;
+        dst += NDst;
+    }
+}
+
+template <typename T, int NSrc>
+static void remapFrom (const T *src, T *dst, int nDst, const int idx[4], size_t n)
+{
+    switch (nDst) {
+    case 1: remapFixed<T, NSrc, 1> (src, dst, idx, n); break;
+    case 2: remapFixed<T, NSrc, 2> (src, dst, idx, n); break;
+    case 3: remapFixed<T, NSrc, 3> (src, dst, idx, n); break;
+    default: remapFixed<T, NSrc, 4> (src, dst, idx, n); break;
+    }
+}
+
+// remap the channels of pixels without changing the channel type
+template <typename T>
+static void remapChannels (
+    const T *src, int nSrc, T *dst, int nDst, const int map[4], size_t n)
+{
+    int idx[4];
+    for (int c = 0;  c < nDst;  ++c) {
+        idx[c] = (map[c] >= 0) ? map[c] : ((map[c] == kZero) ? nSrc : nSrc + 1);
+    }
+    switch (nSrc) {
+    case 1: remapFrom<T, 1> (src, dst, nDst, idx, n); break;
+    case 2: remapFrom<T, 2> (src, dst, nDst, idx, n); break;
+    case 3: remapFrom<T, 3> (src, dst, nDst, idx, n); break;
+    default: remapFrom<T, 4> (src, dst, nDst, idx, n); break;
+    }
+}
+
+/***** vectorized kernels *****/
+
+// add an opaque alpha channel to three-channel 8-bit pixels, where the template
+// parameters select the source channel of the destination's first three channels
+template <int C0, int C1, int C2>
+static void expandU8To4 (const uint8_t *src, uint8_t *dst, size_t n)
+{
+    for (size_t i = 0;  i < n;  ++i) {
+        dst[0] = src[C0];
+        dst[1] = src[C1];
+        dst[2] = src[C2];
+        dst[3] = 0xff;
+        src += 3;
+        dst += 4;
+    }
+}
+
+// remap the channels of 8-bit pixels to four channels
+static void remapU8To4 (const uint8_t *src, int nSrc, uint8_t *dst, const int map[4], size_t n)
+{
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // shuffle four pixels at a time; the shuffle mask selects the source byte for
+    // each destination byte (or zero) and the `ones` mask fills in opaque alpha
+    alignas(16) uint8_t shuf[16];
+    alignas(16) uint8_t ones[16];
+    for (int p = 0;  p < 4;  ++p) {
+        for (int c = 0;  c < 4;  ++c) {
+            int k = map[c];
+            shuf[4*p + c] = (k >= 0) ? uint8_t(nSrc*p + k) : 0x80;
+            ones[4*p + c] = (k == kOne) ? 0xff : 0;
+        }
+    }
+    __m128i shufV = _mm_load_si128(reinterpret_cast<const __m128i *>(shuf));
+    __m128i onesV = _mm_load_si128(reinterpret_cast<const __m128i *>(ones));
+# if defined(__AVX2__)
+    if (nSrc == 4) {
+        // the shuffle works within 128-bit lanes, so we can do eight pixels at a time
+        __m256i shufV2 = _mm256_broadcastsi128_si256(shufV);
+        __m256i onesV2 = _mm256_broadcastsi128_si256(onesV);
+        for (;  i + 8 <= n;  i += 8) {
+            __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4*i));
+            px = _mm256_or_si256(_mm256_shuffle_epi8(px, shufV2), onesV2);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4*i), px);
+        }
+    }
+# endif
+    // each iteration loads 16 bytes, so we stop when that would read past the end
+    for (;  i * nSrc + 16 <= n * nSrc;  i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + nSrc*i));
+        px = _mm_or_si128(_mm_shuffle_epi8(px, shufV), onesV);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4*i), px);
+    }
+#elif defined(__SSE2__)
+    if ((nSrc == 4) && (map[0] == 2) && (map[1] == 1) && (map[2] == 0) && (map[3] == 3)) {
+        // swap the red and blue channels of four pixels at a time
+        const __m128i ag = _mm_set1_epi32(0xff00ff00);
+        const __m128i lo = _mm_set1_epi32(0x000000ff);
+        for (;  i + 4 <= n;  i += 4) {
+            __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4*i));
+            __m128i rb = _mm_or_si128(
+                _mm_and_si128(_mm_srli_epi32(px, 16), lo),
+                _mm_slli_epi32(_mm_and_si128(px, lo), 16));
+            px = _mm_or_si128(_mm_and_si128(px, ag), rb);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4*i), px);
+        }
+    }
+#endif
+#if !defined(__SSSE3__)
+    // without a byte shuffle, the common three-channel expansions are fastest
+    // as unrolled copies
+    if ((nSrc == 3) && (map[1] == 1) && (map[3] == kOne)) {
+        if ((map[0] == 0) && (map[2] == 2)) {
+            expandU8To4<0, 1, 2> (src, dst, n);
+            return;
+        }
+        else if ((map[0] == 2) && (map[2] == 0)) {
+            expandU8To4<2, 1, 0> (src, dst, n);
+            return;
+        }
+    }
+#endif
+    remapChannels (src + nSrc*i, nSrc, dst + 4*i, 4, map, n - i);
+}
+
+// convert 8-bit channels to 16-bit channels (v * 257)
+static void convertU8ToU16 (const uint8_t *src, uint16_t *dst, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i k257 = _mm256_set1_epi16(257);
+    for (;  i + 16 <= n;  i += 16) {
+        __m256i v = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i *>(dst + i),
+            _mm256_mullo_epi16(v, k257));
+    }
+#elif defined(__SSE2__)
+    for (;  i + 16 <= n;  i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(v, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(v, v));
+    }
+#endif
+    for (;  i < n;  ++i) {
+        dst[i] = uint16_t(src[i]) * 257;
+    }
+}
+
+// convert 16-bit channels to 8-bit channels with rounding (i.e., round(v / 257));
+// we compute t = min(v + 128, 65535) and then (t - (t >> 8)) >> 8, which is exact
+// for all 16-bit values
+static void convertU16ToU8 (const uint16_t *src, uint8_t *dst, size_t n)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i k128 = _mm256_set1_epi16(128);
+    for (;  i + 32 <= n;  i += 32) {
+        __m256i a = _mm256_adds_epu16(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)), k128);
+        __m256i b = _mm256_adds_epu16(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 16)), k128);
+        a = _mm256_srli_epi16(_mm256_sub_epi16(a, _mm256_srli_epi16(a, 8)), 8);
+        b = _mm256_srli_epi16(_mm256_sub_epi16(b, _mm256_srli_epi16(b, 8)), 8);
+        // the pack works within 128-bit lanes, so we have to put the lanes back in order
+        __m256i v = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), v);
+    }
+#elif defined(__SSE2__)
+    const __m128i k128 = _mm_set1_epi16(128);
+    for (;  i + 16 <= n;  i += 16) {
+        __m128i a = _mm_adds_epu16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), k128);
+        __m128i b = _mm_adds_epu16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8)), k128);
+        a = _mm_srli_epi16(_mm_sub_epi16(a, _mm_srli_epi16(a, 8)), 8);
+        b = _mm_srli_epi16(_mm_sub_epi16(b, _mm_srli_epi16(b, 8)), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(a, b));
+    }
+#endif
+    for (;  i < n;  ++i) {
+        uint32_t t = std::min(uint32_t(src[i]) + 128, 65535u);
+        dst[i] = uint8_t((t - (t >> 8)) >> 8);
+    }
+}
+
+// convert 8-bit channels to normalized floats; if `decode` is true, then the
+// color channels are converted from sRGB to linear.  `nCh` is the number of
+// channels per pixel and `alpha` is the index of the alpha channel (or -1).
+static void convertU8ToF32 (
+    const uint8_t *src, float *dst, size_t n, int nCh, int alpha, bool decode)
+{
+    size_t i = 0;
+    const float *tbl = srgbTables().toLinear;
+#if defined(__AVX2__)
+    const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+    if (! decode) {
+        for (;  i + 8 <= n;  i += 8) {
+            __m256i v = _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+        }
+    }
+    else if ((nCh == 4) || (alpha < 0)) {
+        // look up the color channels in the table (using a gather) and blend in
+        // the linearly scaled alpha channels
+        const int alphaMask = (alpha < 0) ? 0 : ((1 << alpha) | (1 << (alpha + 4)));
+        for (;  i + 8 <= n;  i += 8) {
+            __m256i v = _mm256_cvtepu8_epi32(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+            __m256 lin = _mm256_i32gather_ps(tbl, v, 4);
+            if (alphaMask != 0) {
+                __m256 a = _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale);
+                // the blend mask must be a constant, and alpha is always channel 3
+                lin = _mm256_blend_ps(lin, a, 0x88);
+            }
+            _mm256_storeu_ps(dst + i, lin);
+        }
+    }
+#elif defined(__SSE2__)
+    if (! decode) {
+        const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+        const __m128i zero = _mm_setzero_si128();
+        for (;  i + 16 <= n;  i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            __m128i w[4] = {
+                    _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                    _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+                };
+            for (int k = 0;  k < 4;  ++k) {
+                _mm_storeu_ps(dst + i + 4*k, _mm_mul_ps(_mm_cvtepi32_ps(w[k]), scale));
+            }
+        }
+    }
+#endif
+    for (int c = int(i % nCh);  i < n;  ++i) {
+        dst[i] = (decode && (c != alpha)) ? tbl[src[i]] : float(src[i]) / 255.0f;
+        c = (c + 1 == nCh) ? 0 : c + 1;
+    }
+}
+
+// convert normalized floats to 8-bit channels with rounding; if `encode` is true,
+// then the color channels are converted from linear to sRGB.
+static void convertF32ToU8 (
+    const float *src, uint8_t *dst, size_t n, int nCh, int alpha, bool encode)
+{
+    size_t i = 0;
+    SRGBTables const &tbls = srgbTables();
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    if (! encode) {
+        const __m128 scale = _mm_set1_ps(255.0f);
+        for (;  i + 16 <= n;  i += 16) {
+            __m128i w[4];
+            for (int k = 0;  k < 4;  ++k) {
+                __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4*k), zero), one);
+                w[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+            }
+            __m128i lo = _mm_packs_epi32(w[0], w[1]);
+            __m128i hi = _mm_packs_epi32(w[2], w[3]);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+        }
+    }
+    else {
+        // compute the table indices four at a time and then look them up; when
+        // there is an alpha channel, there are four channels, so it is the last
+        // of each group of four values
+        const __m128 scale = _mm_set1_ps(float(kLinearToSRGBSz - 1));
+        alignas(16) int32_t idx[4];
+        for (;  i + 4 <= n;  i += 4) {
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), one);
+            _mm_store_si128(
+                reinterpret_cast<__m128i *>(idx),
+                _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+            dst[i] = tbls.fromLinear[idx[0]];
+            dst[i+1] = tbls.fromLinear[idx[1]];
+            dst[i+2] = tbls.fromLinear[idx[2]];
+            dst[i+3] = (alpha < 0)
+                ? tbls.fromLinear[idx[3]]
+                : uint8_t(255.0f * std::min(std::max(src[i+3], 0.0f), 1.0f) + 0.5f);
+        }
+    }
+#endif
+    for (int c = int(i % nCh);  i < n;  ++i) {
+        float v = std::min(std::max(src[i], 0.0f), 1.0f);
+        dst[i] = (encode && (c != alpha)) ? tbls.encode(v) : uint8_t(255.0f * v + 0.5f);
+        c = (c + 1 == nCh) ? 0 : c + 1;
+    }
+}
+
+/***** the general conversion path *****/
+
+// the number of pixels converted at a time by the general path
+constexpr size_t kChunkSz = 256;
+
+// load pixels as normalized floats
+static void loadNormalized (PixelFormat fmt, const void *src, size_t n, float *dst)
+{
+    size_t nVals = n * numChannels(fmt.chans);
+    switch (fmt.ty) {
+    case ChannelTy::U8: {
+            const uint8_t *p = static_cast<const uint8_t *>(src);
+            for (size_t i = 0;  i < nVals;  ++i) {
+                dst[i] = float(p[i]) / 255.0f;
+            }
+        } break;
+    case ChannelTy::U16: {
+            const uint16_t *p = static_cast<const uint16_t *>(src);
+            for (size_t i = 0;  i < nVals;  ++i) {
+                dst[i] = float(p[i]) / 65535.0f;
+            }
+        } break;
+    case ChannelTy::F32:
+        std::memcpy (dst, src, nVals * sizeof(float));
+        break;
+    default:
+        ERROR("unsupported channel type for conversion");
+    }
+}
+
+// store normalized floats as pixels
+static void storeNormalized (PixelFormat fmt, const float *src, size_t n, void *dst)
+{
+    size_t nVals = n * numChannels(fmt.chans);
+    switch (fmt.ty) {
+    case ChannelTy::U8: {
+            uint8_t *p = static_cast<uint8_t *>(dst);
+            for (size_t i = 0;  i < nVals;  ++i) {
+                p[i] = uint8_t(255.0f * std::min(std::max(src[i], 0.0f), 1.0f) + 0.5f);
+            }
+        } break;
+    case ChannelTy::U16: {
+            uint16_t *p = static_cast<uint16_t *>(dst);
+            for (size_t i = 0;  i < nVals;  ++i) {
+                p[i] = uint16_t(65535.0f * std::min(std::max(src[i], 0.0f), 1.0f) + 0.5f);
+            }
+        } break;
+    case ChannelTy::F32:
+        std::memcpy (dst, src, nVals * sizeof(float));
+        break;
+    default:
+        ERROR("unsupported channel type for conversion");
+    }
+}
+
+// convert pixels by way of normalized floats
+static void convertGeneral (
+    PixelFormat srcFmt, const void *src, PixelFormat dstFmt, void *dst, size_t n)
+{
+    int map[4];
+    int nSrc = numChannels(srcFmt.chans);
+    int nDst = channelMap (srcFmt.chans, dstFmt.chans, map);
+    bool decode = srcFmt.sRGB && !dstFmt.sRGB;
+    bool encode = !srcFmt.sRGB && dstFmt.sRGB;
+    size_t srcPixSz = nSrc * sizeOfType(srcFmt.ty);
+    size_t dstPixSz = nDst * sizeOfType(dstFmt.ty);
+    float in[4 * kChunkSz], out[4 * kChunkSz];
+    for (size_t i = 0;  i < n;  i += kChunkSz) {
+        size_t m = std::min(kChunkSz, n - i);
+        const void *srcP = static_cast<const char *>(src) + i * srcPixSz;
+        if (decode && (srcFmt.ty == ChannelTy::U8)) {
+            convertU8ToF32 (
+                static_cast<const uint8_t *>(srcP), in, m * nSrc, nSrc,
+                isAlpha(srcFmt.chans, 3) ? 3 : -1, true);
+        } else {
+            loadNormalized (srcFmt, srcP, m, in);
+            if (decode) {
+                for (size_t j = 0;  j < m * nSrc;  ++j) {
+                    if (! isAlpha(srcFmt.chans, j % nSrc)) {
+                        in[j] = decodeSRGB (in[j]);
+                    }
+                }
+            }
+        }
+        remapChannels (in, nSrc, out, nDst, map, m);
+        void *dstP = static_cast<char *>(dst) + i * dstPixSz;
+        if (encode && (dstFmt.ty == ChannelTy::U8)) {
+            convertF32ToU8 (
+                out, static_cast<uint8_t *>(dstP), m * nDst, nDst,
+                isAlpha(dstFmt.chans, 3) ? 3 : -1, true);
+        } else {
+            if (encode) {
+                for (size_t j = 0;  j < m * nDst;  ++j) {
+                    if (! isAlpha(dstFmt.chans, j % nDst)) {
+                        out[j] = encodeSRGB (std::min(std::max(out[j], 0.0f), 1.0f));
+                    }
+                }
+            }
+            storeNormalized (dstFmt, out, m, dstP);
+        }
+    }
+}
+
+/***** dispatch *****/
+
+// is a channel type one that we can convert to and from normalized floats?
+static bool isNormalizable (ChannelTy ty)
+{
+    return (ty == ChannelTy::U8) || (ty == ChannelTy::U16) || (ty == ChannelTy::F32);
+}
+
+bool canConvertPixels (PixelFormat srcFmt, PixelFormat dstFmt)
+{
+    if ((srcFmt.chans == Channels::UNKNOWN) || (dstFmt.chans == Channels::UNKNOWN)
+    || (srcFmt.ty == ChannelTy::UNKNOWN) || (dstFmt.ty == ChannelTy::UNKNOWN)) {
+        return false;
+    }
+    else if ((srcFmt.ty == dstFmt.ty) && (srcFmt.sRGB == dstFmt.sRGB)) {
+        return true;
+    }
+    else {
+        return isNormalizable(srcFmt.ty) && isNormalizable(dstFmt.ty);
+    }
+}
+
+// remap the channels of pixels of type T
+template <typename T>
+static void remapPixels (
+    PixelFormat srcFmt, const void *src, PixelFormat dstFmt, void *dst, size_t n)
+{
+    int map[4];
+    int nDst = channelMap (srcFmt.chans, dstFmt.chans, map);
+    remapChannels (
+        static_cast<const T *>(src), numChannels(srcFmt.chans),
+        static_cast<T *>(dst), nDst, map, n);
+}
+
+void convertPixels (PixelFormat srcFmt, const void *src, PixelFormat dstFmt, void *dst, size_t n)
+{
+    if (! canConvertPixels (srcFmt, dstFmt)) {
+        ERROR("unsupported pixel conversion from " + to_string(srcFmt.chans) + "/"
+            + to_string(srcFmt.ty) + " to " + to_string(dstFmt.chans) + "/"
+            + to_string(dstFmt.ty));
+    }
+
+    size_t nCh = numChannels(srcFmt.chans);
+    bool sameChans = (srcFmt.chans == dstFmt.chans);
+    bool sameEnc = (srcFmt.sRGB == dstFmt.sRGB);
+    int alpha = isAlpha(srcFmt.chans, 3) ? 3 : -1;
+
+    if ((srcFmt.ty == dstFmt.ty) && sameEnc) {
+        // only the channels change
+        if (sameChans) {
+            std::memcpy (dst, src, n * nCh * sizeOfType(srcFmt.ty));
+            return;
+        }
+        switch (srcFmt.ty) {
+        case ChannelTy::U8:
+            if (numChannels(dstFmt.chans) == 4) {
+                int map[4];
+                channelMap (srcFmt.chans, dstFmt.chans, map);
+                remapU8To4 (
+                    static_cast<const uint8_t *>(src), nCh,
+                    static_cast<uint8_t *>(dst), map, n);
+            } else {
+                remapPixels<uint8_t> (srcFmt, src, dstFmt, dst, n);
+            }
+            break;
+        case ChannelTy::S8: remapPixels<int8_t> (srcFmt, src, dstFmt, dst, n); break;
+        case ChannelTy::U16: remapPixels<uint16_t> (srcFmt, src, dstFmt, dst, n); break;
+        case ChannelTy::S16: remapPixels<int16_t> (srcFmt, src, dstFmt, dst, n); break;
+        case ChannelTy::U32: remapPixels<uint32_t> (srcFmt, src, dstFmt, dst, n); break;
+        case ChannelTy::S32: remapPixels<int32_t> (srcFmt, src, dstFmt, dst, n); break;
+        case ChannelTy::F32: remapPixels<float> (srcFmt, src, dstFmt, dst, n); break;
+        default:
+            ERROR("unknown channel type");
+        }
+    }
+    else if (sameChans && sameEnc
+    && (srcFmt.ty == ChannelTy::U8) && (dstFmt.ty == ChannelTy::U16)) {
+        convertU8ToU16 (
+            static_cast<const uint8_t *>(src), static_cast<uint16_t *>(dst), n * nCh);
+    }
+    else if (sameChans && sameEnc
+    && (srcFmt.ty == ChannelTy::U16) && (dstFmt.ty == ChannelTy::U8)) {
+        convertU16ToU8 (
+            static_cast<const uint16_t *>(src), static_cast<uint8_t *>(dst), n * nCh);
+    }
+    else if (sameChans && (srcFmt.ty == ChannelTy::U8) && (dstFmt.ty == ChannelTy::F32)
+    && (sameEnc || srcFmt.sRGB)) {
+        convertU8ToF32 (
+            static_cast<const uint8_t *>(src), static_cast<float *>(dst), n * nCh,
+            nCh, alpha, !sameEnc);
+    }
+    else if (sameChans && (srcFmt.ty == ChannelTy::F32) && (dstFmt.ty == ChannelTy::U8)
+    && (sameEnc || dstFmt.sRGB)) {
+        convertF32ToU8 (
+            static_cast<const float *>(src), static_cast<uint8_t *>(dst), n * nCh,
+            nCh, alpha, !sameEnc);
+    }
+    else {
+        convertGeneral (srcFmt, src, dstFmt, dst, n);
+    }
+
+}
+
+} // namespace __detail
+} // namespace cs237
@@ -0,0 +1,64 @@
+/*! \file pixel-convert.hpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Internal definitions for the pixel-format conversion kernels (pixel-convert.cpp),
+ * which are used by the image code.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _PIXEL_CONVERT_HPP_
+#define _PIXEL_CONVERT_HPP_
+
+#include "cs237/cs237.hpp"
+
+namespace cs237 {
+namespace __detail {
+
+// the size of the table used to convert linear values to sRGB
+constexpr uint32_t kLinearToSRGBSz = 16384;
+
+// conversion tables for 8-bit sRGB data
+struct SRGBTables {
+    float toLinear[256];                        // sRGB byte to linear value in 0..1
+    uint8_t fromLinear[kLinearToSRGBSz];        // quantized linear value to sRGB byte
+
+    SRGBTables ();
+
+    // convert a linear value to an sRGB byte
+    uint8_t encode (float v) const
+    {
+        v = std::min(std::max(v, 0.0f), 1.0f);
+        return this->fromLinear[int(v * float(kLinearToSRGBSz - 1) + 0.5f)];
+    }
+};
+
+// the shared conversion tables
+SRGBTables const &srgbTables ();
+
+// the layout and encoding of pixel data
+struct PixelFormat {
+    Channels chans;
+    ChannelTy ty;
+    bool sRGB;
+};
+
+// can pixels be converted from one format to another?  Any change of channels
+// is supported, but the channel type can only change between U8, U16, and F32
+// (where F32 values are normalized to 0..1), and changes of the sRGB encoding
+// require U8, U16, or F32 channels.
+bool canConvertPixels (PixelFormat srcFmt, PixelFormat dstFmt);
+
+// convert `n` pixels from one format to another
+void convertPixels (PixelFormat srcFmt, const void *src, PixelFormat dstFmt, void *dst, size_t n);
+
+} // namespace __detail
+} // namespace cs237
+
+#endif // !_PIXEL_CONVERT_HPP_
@@ -0,0 +1,315 @@
+/*! \file texture-atlas.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * The texture-atlas builder.  Images are packed into pages using the skyline
+ * bottom-left heuristic, where the packer tracks the top edge of the occupied
+ * area of a page as a list of horizontal segments and places each image at the
+ * lowest position where it fits (breaking ties by the narrowest segment).
+ * Images are placed tallest first, which keeps the skyline flat.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include <cstring>
+
+namespace cs237 {
+
+namespace __detail {
+
+// a segment of the skyline of a page; the occupied area of the columns
+// x..x+wid-1 extends to row y
+struct SkylineNode {
+    uint32_t x;
+    uint32_t y;
+    uint32_t wid;
+};
+
+// a skyline packer for one page
+class SkylinePacker {
+  public:
+    SkylinePacker (uint32_t wid, uint32_t ht)
+      : _wid(wid), _ht(ht), _usedWid(0), _usedHt(0), _nodes{{0, 0, wid}}
+    { }
+
+    // find a place for a rectangle; returns false if there is no room
+    bool insert (uint32_t w, uint32_t h, uint32_t &x, uint32_t &y);
+
+    // the extent of the occupied area of the page
+    uint32_t usedWidth () const { return this->_usedWid; }
+    uint32_t usedHeight () const { return this->_usedHt; }
+
+  private:
+    uint32_t _wid, _ht;
+    uint32_t _usedWid, _usedHt;
+    std::vector<SkylineNode> _nodes;
+
+    static constexpr uint32_t kNoFit = std::numeric_limits<uint32_t>::max();
+
+    // the row at which a rectangle would rest if its left edge were at the start
+    // of node `i`, or kNoFit if it does not fit
+    uint32_t _fit (size_t i, uint32_t w, uint32_t h) const;
+};
+
+uint32_t SkylinePacker::_fit (size_t i, uint32_t w, uint32_t h) const
+{
+    if (this->_nodes[i].x + w > this->_wid) {
+        return kNoFit;
+    }
+    // the rectangle rests on the highest segment that it spans
+    uint32_t y = 0;
+    for (uint32_t left = w;  left > 0;  ++i) {
+        y = std::max(y, this->_nodes[i].y);
+        if (y + h > this->_ht) {
+            return kNoFit;
+        }
+        left -= std::min(left, this->_nodes[i].wid);
+    }
+    return y;
+}
+
+bool SkylinePacker::insert (uint32_t w, uint32_t h, uint32_t &x, uint32_t &y)
+{
+    size_t best = this->_nodes.size();
+    uint32_t bestTop = kNoFit;
+    uint32_t bestWid = kNoFit;
+    for (size_t i = 0;  i < this->_nodes.size();  ++i) {
+        uint32_t yi = this->_fit (i, w, h);
+        if ((yi != kNoFit)
+        && ((yi + h < bestTop) || ((yi + h == bestTop) && (this->_nodes[i].wid < bestWid)))) {
+            best = i;
+            bestTop = yi + h;
+            bestWid = this->_nodes[i].wid;
+        }
+    }
+    if (best == this->_nodes.size()) {
+        return false;
+    }
+
+    x = this->_nodes[best].x;
+    y = bestTop - h;
+    this->_usedWid = std::max(this->_usedWid, x + w);
+    this->_usedHt = std::max(this->_usedHt, bestTop);
+
+    // add the new segment and trim the segments that it covers
+    this->_nodes.insert (this->_nodes.begin() + best, SkylineNode{x, bestTop, w});
+    for (size_t i = best + 1;  i < this->_nodes.size();  ) {
+        SkylineNode &node = this->_nodes[i];
+        if (node.x >= x + w) {
+            break;
+        }
+        uint32_t overlap = x + w - node.x;
+        if (node.wid <= overlap) {
+            this->_nodes.erase (this->_nodes.begin() + i);
+        } else {
+            node.x += overlap;
+            node.wid -= overlap;
+            break;
+        }
+    }
+    // merge adjacent segments at the same height
+    for (size_t i = 0;  i + 1 < this->_nodes.size();  ) {
+        if (this->_nodes[i].y == this->_nodes[i+1].y) {
+            this->_nodes[i].wid += this->_nodes[i+1].wid;
+            this->_nodes.erase (this->_nodes.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+
+    return true;
+}
+
+} // namespace __detail
+
+TextureAtlas::TextureAtlas (Channels chans, ChannelTy ty, bool sRGB, Options const &opts)
+  : _chans(chans), _type(ty), _sRGB(sRGB), _opts(opts), _built(false)
+{
+    if ((opts.nMipLevels == 0) || (opts.nMipLevels > 16)) {
+        ERROR("TextureAtlas: invalid number of mipmap levels");
+    }
+    this->_align = 1u << (opts.nMipLevels - 1);
+    if (opts.pageSize < this->_align) {
+        ERROR("TextureAtlas: page size is smaller than the alignment");
+    }
+}
+
+TextureAtlas::~TextureAtlas ()
+{
+    for (auto pg : this->_pages) {
+        delete pg;
+    }
+}
+
+int TextureAtlas::add (Image2D const *img)
+{
+    if (this->_built) {
+        ERROR("TextureAtlas::add: atlas has already been built");
+    }
+    if ((this->_cellSize(img->width()) > this->_opts.pageSize)
+    || (this->_cellSize(img->height()) > this->_opts.pageSize)) {
+        return -1;
+    }
+    this->_imgs.push_back (img);
+    return int(this->_imgs.size()) - 1;
+}
+
+TextureAtlas::Entry const &TextureAtlas::entry (int id) const
+{
+    if (! this->_built) {
+        ERROR("TextureAtlas::entry: atlas has not been built");
+    }
+    return this->_entries[id];
+}
+
+uint32_t TextureAtlas::numMipLevels (uint32_t i) const
+{
+    Image2D const *pg = this->_pages[i];
+    return std::min(this->_opts.nMipLevels, cs237::numMipLevels(pg->width(), pg->height()));
+}
+
+double TextureAtlas::occupancy () const
+{
+    double imgArea = 0.0;
+    double pageArea = 0.0;
+    for (auto const &e : this->_entries) {
+        imgArea += double(e.wid) * double(e.ht);
+    }
+    for (auto pg : this->_pages) {
+        pageArea += double(pg->width()) * double(pg->height());
+    }
+    return (pageArea > 0.0) ? imgArea / pageArea : 0.0;
+}
+
+void TextureAtlas::build (JobSystem *jobs)
+{
+    if (this->_built) {
+        ERROR("TextureAtlas::build: atlas has already been built");
+    }
+
+    // pack the cells tallest first (then widest first)
+    std::vector<int> order(this->_imgs.size());
+    for (int i = 0;  i < int(order.size());  ++i) {
+        order[i] = i;
+    }
+    std::stable_sort (order.begin(), order.end(), [this] (int a, int b) {
+        uint32_t ha = this->_cellSize(this->_imgs[a]->height());
+        uint32_t hb = this->_cellSize(this->_imgs[b]->height());
+        if (ha != hb) {
+            return ha > hb;
+        }
+        return this->_cellSize(this->_imgs[a]->width())
+            > this->_cellSize(this->_imgs[b]->width());
+    });
+
+    // each image is placed on the first page that has room for it
+    std::vector<__detail::SkylinePacker> packers;
+    this->_entries.resize (this->_imgs.size());
+    uint32_t g = this->_opts.gutter;
+    for (int id : order) {
+        Image2D const *img = this->_imgs[id];
+        uint32_t cw = this->_cellSize(img->width());
+        uint32_t ch = this->_cellSize(img->height());
+        uint32_t x, y;
+        uint32_t pg = 0;
+        while ((pg < packers.size()) && !packers[pg].insert (cw, ch, x, y)) {
+            ++pg;
+        }
+        if (pg == packers.size()) {
+            packers.push_back (__detail::SkylinePacker(this->_opts.pageSize, this->_opts.pageSize));
+            packers.back().insert (cw, ch, x, y);
+        }
+        Entry &e = this->_entries[id];
+        e.page = pg;
+        e.x = x + g;
+        e.y = y + g;
+        e.wid = img->width();
+        e.ht = img->height();
+    }
+
+    // the pages are trimmed to their occupied area, which is a multiple of the
+    // alignment, so the first `nMipLevels` levels of a page are exact halvings
+    for (auto const &pk : packers) {
+        Image2D *pg = new Image2D (
+            pk.usedWidth(), pk.usedHeight(), this->_chans, this->_type, this->_sRGB);
+        std::memset (pg->data(), 0, pg->nBytes());
+        this->_pages.push_back (pg);
+    }
+    for (auto &e : this->_entries) {
+        float pw = float(this->_pages[e.page]->width());
+        float ph = float(this->_pages[e.page]->height());
+        e.uvXform = glm::vec4(
+            float(e.wid) / pw, float(e.ht) / ph,
+            float(e.x) / pw, float(e.y) / ph);
+    }
+
+    // copy the images; each image only writes its own cell, so they can be
+    // copied in parallel
+    std::vector<Job *> pending;
+    for (int id = 0;  id < int(this->_imgs.size());  ++id) {
+        if (jobs != nullptr) {
+            pending.push_back (jobs->spawn ([this, id] () { this->_copyImage (id); }));
+        } else {
+            this->_copyImage (id);
+        }
+    }
+    for (auto job : pending) {
+        jobs->wait (job);
+    }
+
+    this->_built = true;
+
+}
+
+void TextureAtlas::_copyImage (int id)
+{
+    Entry const &e = this->_entries[id];
+    Image2D const *img = this->_imgs[id];
+    Image2D *pg = this->_pages[e.page];
+
+    // convert the image to the format of the page (if necessary)
+    std::unique_ptr<Image2D> converted;
+    if ((img->channels() != this->_chans) || (img->type() != this->_type)
+    || (img->isSRGB() != this->_sRGB)) {
+        converted.reset (img->convert (this->_chans, this->_type, this->_sRGB));
+        img = converted.get();
+    }
+
+    pg->bitblt (*img, e.y, e.x);
+
+    // fill the gutter by extending the edges of the image to the cell boundary
+    size_t pixSz = pg->nBytesPerPixel();
+    size_t stride = pg->width() * pixSz;
+    char *data = static_cast<char *>(pg->data());
+    uint32_t g = this->_opts.gutter;
+    uint32_t x0 = e.x - g, x1 = x0 + this->_cellSize(e.wid);
+    uint32_t y0 = e.y - g, y1 = y0 + this->_cellSize(e.ht);
+    for (uint32_t y = e.y;  y < e.y + e.ht;  ++y) {
+        char *row = data + y * stride;
+        for (uint32_t x = x0;  x < e.x;  ++x) {
+            std::memcpy (row + x * pixSz, row + e.x * pixSz, pixSz);
+        }
+        for (uint32_t x = e.x + e.wid;  x < x1;  ++x) {
+            std::memcpy (row + x * pixSz, row + (e.x + e.wid - 1) * pixSz, pixSz);
+        }
+    }
+    size_t cellBytes = (x1 - x0) * pixSz;
+    for (uint32_t y = y0;  y < e.y;  ++y) {
+        std::memcpy (data + y * stride + x0 * pixSz, data + e.y * stride + x0 * pixSz, cellBytes);
+    }
+    for (uint32_t y = e.y + e.ht;  y < y1;  ++y) {
+        std::memcpy (
+            data + y * stride + x0 * pixSz,
+            data + (e.y + e.ht - 1) * stride + x0 * pixSz,
+            cellBytes);
+    }
+
+}
+
+} // namespace cs237
@@ -11,32 +11,96 @@
  */
 
 #include "cs237/cs237.hpp"
+#include <array>
+
+// the SPIR-V code for the variants of the compute shader that downsamples
+// mipmap levels (see shaders/mip-downsample.comp); these headers are generated
+// by the build
+#include "mip-downsample-float.spv.h"
+#include "mip-downsample-uint.spv.h"
+#include "mip-downsample-int.spv.h"
 
 namespace cs237 {
 
 namespace __detail {
 
+// the ways that the mipmap levels of a texture can be generated
+enum class MipmapMethod {
+    eBlit,              // linear-filtered blits from each level to the next
+    eCompute,           // a compute shader that downsamples each level to the next
+    eCPU                // generate the levels on the CPU and upload them
+};
+
+// determine how to generate the mipmap levels for a texture format; we prefer
+// blits, but many 16-bit and integer formats do not support linear filtering,
+// in which case we use a compute shader if the format can be used as a storage
+// image and otherwise fall back to the CPU.
+static MipmapMethod mipmapMethod (Application *app, vk::Format fmt)
+{
+    vk::FormatFeatureFlags features = app->formatProps(fmt).optimalTilingFeatures;
+    vk::FormatFeatureFlags blit = vk::FormatFeatureFlagBits::eBlitSrc
+        | vk::FormatFeatureFlagBits::eBlitDst
+        | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    vk::FormatFeatureFlags compute = vk::FormatFeatureFlagBits::eSampledImage
+        | vk::FormatFeatureFlagBits::eStorageImage;
+    if ((features & blit) == blit) {
+        return MipmapMethod::eBlit;
+    }
+    else if (((features & compute) == compute)
+    && app->features()->shaderStorageImageWriteWithoutFormat) {
+        return MipmapMethod::eCompute;
+    }
+    else {
+        return MipmapMethod::eCPU;
+    }
+}
+
 TextureBase::TextureBase (
     Application *app,
     uint32_t wid, uint32_t ht, uint32_t mipLvls,
-    cs237::__detail::ImageBase const *img)
-  : _app(app), _wid(wid), _ht(ht), _nMipLevels(mipLvls), _fmt(img->format())
+    vk::Format fmt,
+    uint32_t nLayers,
+    vk::ImageViewType viewType)
+  : _app(app), _wid(wid), _ht(ht), _nMipLevels(mipLvls), _nLayers(nLayers), _fmt(fmt)
 {
-    vk::ImageUsageFlags usage = (mipLvls > 1)
-        ? vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled
-            | vk::ImageUsageFlagBits::eTransferSrc
-        : vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst
+        | vk::ImageUsageFlagBits::eSampled;
+    if (mipLvls > 1) {
+        // the mipmap levels may be generated by blits or by a compute shader
+        usage |= vk::ImageUsageFlagBits::eTransferSrc;
+        if (mipmapMethod(app, fmt) == MipmapMethod::eCompute) {
+            usage |= vk::ImageUsageFlagBits::eStorage;
+        }
+    }
+    vk::ImageCreateFlags flags;
+    if ((viewType == vk::ImageViewType::eCube) || (viewType == vk::ImageViewType::eCubeArray)) {
+        flags = vk::ImageCreateFlagBits::eCubeCompatible;
+    }
+    // when the device supports it, we copy the data directly into the image
+    // instead of using a staging buffer
+#ifdef VK_EXT_host_image_copy
+    this->_hostCopy = app->_canHostCopy (fmt, usage, flags);
+    if (this->_hostCopy) {
+        usage |= vk::ImageUsageFlagBits::eHostTransferEXT;
+    }
+#else
+    this->_hostCopy = false;
+#endif
     this->_img = app->_createImage (
         wid, ht, this->_fmt,
         vk::ImageTiling::eOptimal,
         usage,
-        mipLvls);
+        mipLvls,
+        nLayers,
+        flags);
     this->_mem = app->_allocImageMemory(
         this->_img,
         vk::MemoryPropertyFlagBits::eDeviceLocal);
+    // the view covers all of the mipmap levels and layers
     this->_view = app->_createImageView(
         this->_img, this->_fmt,
-        vk::ImageAspectFlagBits::eColor);
+        vk::ImageAspectFlagBits::eColor,
+        viewType, mipLvls, nLayers);
 
 }
 
@@ -54,6 +118,11 @@ void TextureBase::_init (cs237::__detail::ImageBase const *img)
     size_t nBytes = img->nBytes();
     auto device = this->_app->_device;
 
+    if (this->_hostCopy) {
+        this->_app->_copyHostToImage (this->_img, this->_wid, this->_ht, 1, 1, { data });
+        return;
+    }
+
     // create a staging buffer for copying the image
     vk::Buffer stagingBuf = this->_createBuffer (
         nBytes, vk::BufferUsageFlagBits::eTransferSrc);
@@ -84,101 +153,123 @@ void TextureBase::_init (cs237::__detail::ImageBase const *img)
 
 }
 
-} // namespce __detail
-
-/******************** class Texture1D methods ********************/
-
-Texture1D::Texture1D (Application *app, Image1D const *img)
-  : __detail::TextureBase(app, img->width(), 1, 1, img)
+// helper function for uploading the data for the mipmap levels of the layers
+void TextureBase::_uploadLevels (
+    std::vector<const void *> const &levels,
+    std::vector<size_t> const &sizes,
+    uint32_t nLevels)
 {
-    this->_init(img);
-}
-
-/******************** class Texture2D methods ********************/
-
-// return the integer log2 of n; if n is not a power of 2, then return -1.
-static int32_t ilog2 (uint32_t n)
-{
-    uint32_t k = 0, two_k = 1;
-    while (two_k < n) {
-        k++;
-        two_k *= 2;
-        if (two_k == n) {
-            return k;
-        }
-    }
-    return -1;
-
-}
-
-// compute the number of mipmap levels for an image.  This value is log2 of
-// the larger dimension plus one for the base level image.  We require that
-// both dimensions be a power of 2.
-static uint32_t mipLevels (Image2D const *img, bool mipmap)
-{
-    if (mipmap) {
-        int32_t log2Wid = ilog2(img->width());
-        int32_t log2Ht = ilog2(img->height());
-        if ((log2Wid < 0) || (log2Ht < 0)) {
-            ERROR("texture size not a power of 2");
-        }
-        return std::max(log2Wid, log2Ht) + 1;
-    }
-    else {
-        return 1;
-    }
-}
+    assert (levels.size() == nLevels * this->_nLayers);
 
-Texture2D::Texture2D (Application *app, Image2D const *img, bool mipmap)
-  : __detail::TextureBase(app, img->width(), img->height(), mipLevels(img, mipmap), img)
-{
-    if (mipmap) {
-        this->_generateMipMaps (img);
-    } else {
-        this->_init (img);
+    if (this->_hostCopy && (nLevels == this->_nMipLevels)) {
+        this->_app->_copyHostToImage (
+            this->_img, this->_wid, this->_ht, nLevels, this->_nLayers, levels);
+        return;
     }
-}
 
-// helper function for generating the mipmaps for a texture
-void Texture2D::_generateMipMaps (Image2D const *img)
-{
-    // Check if image format supports linear blitting
-    vk::FormatProperties props = this->_app->formatProps(this->_fmt);
-    if (!(props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear)) {
-        ERROR("texture-image format does not support linear blitting!");
+    // the offsets of the levels in the staging buffer; we align the levels to
+    // 16 bytes, which satisfies the texel-alignment requirements of copies
+    // (including copies of compressed blocks)
+    std::vector<size_t> offsets(levels.size());
+    size_t nBytes = 0;
+    for (size_t i = 0;  i < levels.size();  i++) {
+        offsets[i] = nBytes;
+        nBytes = (nBytes + sizes[i] + 15) & ~size_t(15);
     }
 
-/** FIXME: we should really use a single set of commands for both copying the data
- ** to the image buffer and for generating the mipmaps.
- **/
-    void *data = img->data();
-    size_t nBytes = img->nBytes();
     auto device = this->_app->_device;
 
-    // create a staging buffer for copying the image
+    // create a staging buffer for copying the levels
     vk::Buffer stagingBuf = this->_createBuffer (
-        nBytes,
-        vk::BufferUsageFlagBits::eTransferSrc);
+        nBytes, vk::BufferUsageFlagBits::eTransferSrc);
     vk::DeviceMemory stagingBufMem = this->_allocBufferMemory(
         stagingBuf,
         vk::MemoryPropertyFlagBits::eHostVisible
             | vk::MemoryPropertyFlagBits::eHostCoherent);
 
-    // copy the image data to the staging buffer
-    void *stagingData = device.mapMemory(stagingBufMem, 0, nBytes, {});
-    memcpy(stagingData, data, nBytes);
+    // copy the level data to the staging buffer and record the copy regions
+    std::vector<vk::BufferImageCopy> regions;
+    regions.reserve(levels.size());
+    char *stagingData = static_cast<char *>(device.mapMemory(stagingBufMem, 0, nBytes, {}));
+    for (uint32_t layer = 0;  layer < this->_nLayers;  layer++) {
+        for (uint32_t i = 0;  i < nLevels;  i++) {
+            size_t k = layer * nLevels + i;
+            ::memcpy(stagingData + offsets[k], levels[k], sizes[k]);
+            regions.push_back(vk::BufferImageCopy(
+                offsets[k], /* offset */
+                0, /* row length */
+                0, /* image height */
+                { vk::ImageAspectFlagBits::eColor, i, layer, 1 },
+                { 0, 0, 0 },
+                { std::max(this->_wid >> i, 1u), std::max(this->_ht >> i, 1u), 1 }));
+        }
+    }
     device.unmapMemory(stagingBufMem);
 
-    this->_app->_transitionImageLayout(
-        this->_img, this->_fmt,
-        vk::ImageLayout::eUndefined,
-        vk::ImageLayout::eTransferDstOptimal);
-    this->_app->_copyBufferToImage(this->_img, stagingBuf, nBytes, this->_wid, this->_ht);
+    vk::CommandBuffer cmdBuf = this->_app->newCommandBuf();
+
+    this->_app->beginCommands(cmdBuf, true);
+
+    vk::ImageMemoryBarrier barrier(
+        {}, /* src access mask */
+        vk::AccessFlagBits::eTransferWrite, /* dst access mask */
+        vk::ImageLayout::eUndefined, /* old layout */
+        vk::ImageLayout::eTransferDstOptimal, /* new layout */
+        VK_QUEUE_FAMILY_IGNORED, /* src queue family index */
+        VK_QUEUE_FAMILY_IGNORED, /* dst queue family index */
+        this->_img, /* image */
+        vk::ImageSubresourceRange(
+            vk::ImageAspectFlagBits::eColor, /* aspect mask */
+            0, /* base mip level */
+            nLevels, /* level count */
+            0, /* base array layer */
+            this->_nLayers)); /* layer count */
+
+    cmdBuf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe, /* src stage */
+        vk::PipelineStageFlagBits::eTransfer, /* dst stage */
+        {}, /* dependency flags */
+        nullptr, /* memory barriers */
+        nullptr, /* buffer-memory barriers */
+        barrier); /* image barriers */
+
+    cmdBuf.copyBufferToImage(
+        stagingBuf, this->_img,
+        vk::ImageLayout::eTransferDstOptimal,
+        regions);
+
+    // when only some of the levels are uploaded, the rest are generated from them,
+    // so we leave them in the transfer layout
+    if (nLevels == this->_nMipLevels) {
+        barrier
+            .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+            .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+        cmdBuf.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer, /* src stage */
+            vk::PipelineStageFlagBits::eFragmentShader, /* dst stage */
+            {}, /* dependency flags */
+            nullptr, /* memory barriers */
+            nullptr, /* buffer-memory barriers */
+            barrier); /* image barriers */
+    }
+
+    this->_app->endCommands(cmdBuf);
+    this->_app->submitCommands(cmdBuf);
+    this->_app->freeCommandBuf(cmdBuf);
 
     // free up the staging buffer
     device.freeMemory(stagingBufMem);
     device.destroyBuffer(stagingBuf);
 
+}
+
+// helper function for generating the mipmap levels by blitting each level to the
+// next; each blit covers all of the layers
+void TextureBase::_blitMipMaps ()
+{
     vk::CommandBuffer cmdBuf = this->_app->newCommandBuf();
 
     this->_app->beginCommands(cmdBuf, true);
@@ -196,7 +287,7 @@ void Texture2D::_generateMipMaps (Image2D const *img)
             0, /* base mip level */
             1, /* level count */
             0, /* base array layer */
-            1)); /* layer count */
+            this->_nLayers)); /* layer count */
 
     cmdBuf.pipelineBarrier(
         vk::PipelineStageFlagBits::eTransfer, /* src stage */
@@ -234,13 +325,13 @@ void Texture2D::_generateMipMaps (Image2D const *img)
                 vk::ImageAspectFlagBits::eColor, /* aspect mask */
                 i - 1, /* mip level */
                 0, /* base array level */
-                1), /* layer count */
+                this->_nLayers), /* layer count */
             { vk::Offset3D(0, 0, 0), vk::Offset3D(mipWid, mipHt, 1) },
             vk::ImageSubresourceLayers( /* dst subresource */
                 vk::ImageAspectFlagBits::eColor, /* aspect mask */
                 i, /* mip level */
                 0, /* base array level */
-                1), /* layer count */
+                this->_nLayers), /* layer count */
             { vk::Offset3D(0, 0, 0), vk::Offset3D(nextWid, nextHt, 1) });
 
         cmdBuf.blitImage(
@@ -292,4 +383,570 @@ void Texture2D::_generateMipMaps (Image2D const *img)
 
 }
 
+} // namespce __detail
+
+/******************** class Texture1D methods ********************/
+
+Texture1D::Texture1D (Application *app, Image1D const *img)
+  : __detail::TextureBase(app, img->width(), 1, 1, img)
+{
+    this->_init(img);
+}
+
+/******************** class Texture2D methods ********************/
+
+// compute the number of mipmap levels for an image.  This value is log2 of
+// the larger dimension (rounded down) plus one for the base level image; the
+// dimensions do not have to be powers of 2.
+static uint32_t mipLevels (Image2D const *img, bool mipmap)
+{
+    return mipmap ? numMipLevels(img->width(), img->height()) : 1;
+}
+
+Texture2D::Texture2D (Application *app, Image2D const *img, bool mipmap)
+  : __detail::TextureBase(app, img->width(), img->height(), mipLevels(img, mipmap), img)
+{
+    if (mipmap) {
+        this->_generateMipMaps (img);
+    } else {
+        this->_init (img);
+    }
+}
+
+Texture2D::Texture2D (
+    Application *app,
+    Image2D const *img,
+    std::vector<Image2D const *> const &mips)
+  : __detail::TextureBase(app, img->width(), img->height(), mips.size() + 1, img)
+{
+    this->_initMipChain (img, mips);
+}
+
+// the format of a texture for a compressed image, which is the image's format
+// when the device supports it and the format of the decoded levels otherwise
+static vk::Format textureFormat (Application *app, CompressedImage2D const *img)
+{
+    vk::FormatFeatureFlags needed = vk::FormatFeatureFlagBits::eSampledImage
+        | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    if (app->features()->textureCompressionBC
+    && ((app->formatProps(img->format()).optimalTilingFeatures & needed) == needed)) {
+        return img->format();
+    }
+    else if (img->blockFormat() == BlockFormat::BC5) {
+        return vk::Format::eR8G8Unorm;
+    }
+    else {
+        return img->isSRGB() ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+    }
+}
+
+Texture2D::Texture2D (Application *app, CompressedImage2D const *img)
+  : __detail::TextureBase(
+        app, img->width(), img->height(), img->nLevels(),
+        textureFormat(app, img))
+{
+    std::vector<const void *> levels;
+    std::vector<size_t> sizes;
+    if (this->_fmt == img->format()) {
+        for (uint32_t i = 0;  i < this->_nMipLevels;  i++) {
+            levels.push_back (img->levelData(i));
+            sizes.push_back (img->levelSize(i));
+        }
+        this->_uploadLevels (levels, sizes, this->_nMipLevels);
+    }
+    else {
+        // the device does not support the block format, so we upload the
+        // decoded levels
+        std::vector<Image2D *> decoded;
+        for (uint32_t i = 0;  i < this->_nMipLevels;  i++) {
+            decoded.push_back (img->decode(i));
+            levels.push_back (decoded.back()->data());
+            sizes.push_back (decoded.back()->nBytes());
+        }
+        this->_uploadLevels (levels, sizes, this->_nMipLevels);
+        for (auto lvl : decoded) {
+            delete lvl;
+        }
+    }
+}
+
+// helper function for uploading a pre-built chain of mipmap levels
+void Texture2D::_initMipChain (
+    Image2D const *img,
+    std::vector<Image2D const *> const &mips)
+{
+    std::vector<const void *> levels(this->_nMipLevels);
+    std::vector<size_t> sizes(this->_nMipLevels);
+    uint32_t wid = this->_wid;
+    uint32_t ht = this->_ht;
+    for (uint32_t i = 0;  i < this->_nMipLevels;  i++) {
+        Image2D const *lvl = (i == 0) ? img : mips[i-1];
+        if ((lvl->width() != wid) || (lvl->height() != ht)
+        || (lvl->format() != this->_fmt)) {
+            ERROR("invalid mipmap level for texture");
+        }
+        levels[i] = lvl->data();
+        sizes[i] = lvl->nBytes();
+        wid = std::max(wid >> 1, 1u);
+        ht = std::max(ht >> 1, 1u);
+    }
+
+    this->_uploadLevels (levels, sizes, this->_nMipLevels);
+
+}
+
+// helper function for generating the mipmaps for a texture
+void Texture2D::_generateMipMaps (Image2D const *img)
+{
+    switch (__detail::mipmapMethod(this->_app, this->_fmt)) {
+    case __detail::MipmapMethod::eBlit:
+        this->_uploadBaseLevel (img);
+        this->_blitMipMaps ();
+        break;
+    case __detail::MipmapMethod::eCompute:
+        this->_uploadBaseLevel (img);
+        this->_computeMipMaps (img);
+        break;
+    case __detail::MipmapMethod::eCPU: {
+            // the device cannot filter this format, so we compute the levels on
+            // the CPU and upload the complete chain
+            std::vector<Image2D *> mips = generateMipLevels (img);
+            this->_initMipChain (img, std::vector<Image2D const *>(mips.begin(), mips.end()));
+            for (auto lvl : mips) {
+                delete lvl;
+            }
+        } break;
+    }
+
+}
+
+// helper function for copying the base level of a texture into the image; the
+// base level is left in the eTransferDstOptimal layout
+void Texture2D::_uploadBaseLevel (Image2D const *img)
+{
+/** FIXME: we should really use a single set of commands for both copying the data
+ ** to the image buffer and for generating the mipmaps.
+ **/
+    void *data = img->data();
+    size_t nBytes = img->nBytes();
+    auto device = this->_app->_device;
+
+    // create a staging buffer for copying the image
+    vk::Buffer stagingBuf = this->_createBuffer (
+        nBytes,
+        vk::BufferUsageFlagBits::eTransferSrc);
+    vk::DeviceMemory stagingBufMem = this->_allocBufferMemory(
+        stagingBuf,
+        vk::MemoryPropertyFlagBits::eHostVisible
+            | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    // copy the image data to the staging buffer
+    void *stagingData = device.mapMemory(stagingBufMem, 0, nBytes, {});
+    memcpy(stagingData, data, nBytes);
+    device.unmapMemory(stagingBufMem);
+
+    this->_app->_transitionImageLayout(
+        this->_img, this->_fmt,
+        vk::ImageLayout::eUndefined,
+        vk::ImageLayout::eTransferDstOptimal);
+    this->_app->_copyBufferToImage(this->_img, stagingBuf, nBytes, this->_wid, this->_ht);
+
+    // free up the staging buffer
+    device.freeMemory(stagingBufMem);
+    device.destroyBuffer(stagingBuf);
+
+}
+
+// the SPIR-V code for the variant of the downsampling shader that matches the
+// sample type (float, unsigned, or signed integer) of an image's format
+static vk::ArrayProxy<const uint32_t> downsampleShader (Image2D const *img)
+{
+    switch (img->type()) {
+    case ChannelTy::U8:
+        // 8-bit color images have normalized formats, but 8-bit R and RG images
+        // use integer formats (see `toVkFormat`)
+        if ((img->channels() == Channels::R) || (img->channels() == Channels::RG)) {
+            return kMipDownsampleUint;
+        } else {
+            return kMipDownsampleFloat;
+        }
+    case ChannelTy::U16:
+    case ChannelTy::U32:
+        return kMipDownsampleUint;
+    case ChannelTy::S8:
+    case ChannelTy::S16:
+    case ChannelTy::S32:
+        return kMipDownsampleInt;
+    default:
+        return kMipDownsampleFloat;
+    }
+}
+
+// helper function for generating the mipmap levels using a compute shader; each
+// dispatch reads level i-1 as a sampled image and writes level i as a storage image
+void Texture2D::_computeMipMaps (Image2D const *img)
+{
+    auto device = this->_app->_device;
+    uint32_t nSets = this->_nMipLevels - 1;
+
+    // the pipeline for the downsampling shader
+    vk::ArrayProxy<const uint32_t> code = downsampleShader (img);
+    vk::ShaderModule shader = device.createShaderModule(
+        vk::ShaderModuleCreateInfo(
+            {}, /* flags */
+            code.size() * sizeof(uint32_t), /* code size */
+            code.data())); /* code */
+
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+            vk::DescriptorSetLayoutBinding(
+                0, /* binding */
+                vk::DescriptorType::eSampledImage, /* descriptor type */
+                1, /* descriptor count */
+                vk::ShaderStageFlagBits::eCompute, /* stages */
+                nullptr), /* samplers */
+            vk::DescriptorSetLayoutBinding(
+                1, /* binding */
+                vk::DescriptorType::eStorageImage, /* descriptor type */
+                1, /* descriptor count */
+                vk::ShaderStageFlagBits::eCompute, /* stages */
+                nullptr) /* samplers */
+        };
+    vk::DescriptorSetLayout dsLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo({}, bindings));
+
+    // the push constants are the sizes of the source and destination levels
+    vk::PushConstantRange pcRange(
+        vk::ShaderStageFlagBits::eCompute, /* stages */
+        0, /* offset */
+        4 * sizeof(int32_t)); /* size */
+    vk::PipelineLayout layout = this->_app->createPipelineLayout(dsLayout, pcRange);
+
+    vk::ComputePipelineCreateInfo pipelineInfo(
+        {}, /* flags */
+        vk::PipelineShaderStageCreateInfo(
+            {}, /* flags */
+            vk::ShaderStageFlagBits::eCompute, /* stage */
+            shader, /* module */
+            "main"), /* entry point */
+        layout, /* layout */
+        nullptr, /* base pipeline */
+        -1); /* base pipeline index */
+    auto pipes = device.createComputePipelines(nullptr, pipelineInfo);
+    if (pipes.result != vk::Result::eSuccess) {
+        ERROR("unable to create mipmap compute pipeline!");
+    }
+    vk::Pipeline pipeline = pipes.value[0];
+
+    // a view of each mipmap level and a descriptor set for each dispatch
+    std::vector<vk::ImageView> views(this->_nMipLevels);
+    for (uint32_t i = 0;  i < this->_nMipLevels;  i++) {
+        views[i] = device.createImageView(
+            vk::ImageViewCreateInfo(
+                {}, /* flags */
+                this->_img, /* image */
+                vk::ImageViewType::e2D, /* view type */
+                this->_fmt, /* format */
+                {}, /* component mapping */
+                { vk::ImageAspectFlagBits::eColor, i, 1, 0, 1 })); /* subresource range */
+    }
+
+    std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+            vk::DescriptorPoolSize(vk::DescriptorType::eSampledImage, nSets),
+            vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, nSets)
+        };
+    vk::DescriptorPool pool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo(
+            {}, /* flags */
+            nSets, /* max sets */
+            poolSizes)); /* pool sizes */
+    std::vector<vk::DescriptorSetLayout> dsLayouts(nSets, dsLayout);
+    std::vector<vk::DescriptorSet> descSets = device.allocateDescriptorSets(
+        vk::DescriptorSetAllocateInfo(pool, dsLayouts));
+
+    for (uint32_t i = 0;  i < nSets;  i++) {
+        vk::DescriptorImageInfo srcInfo(
+            nullptr, /* sampler */
+            views[i], /* image view */
+            vk::ImageLayout::eShaderReadOnlyOptimal); /* layout */
+        vk::DescriptorImageInfo dstInfo(
+            nullptr, /* sampler */
+            views[i+1], /* image view */
+            vk::ImageLayout::eGeneral); /* layout */
+        std::array<vk::WriteDescriptorSet, 2> descWrites = {
+                vk::WriteDescriptorSet(
+                    descSets[i], /* descriptor set */
+                    0, /* binding */
+                    0, /* array element */
+                    vk::DescriptorType::eSampledImage, /* descriptor type */
+                    srcInfo, /* image info */
+                    nullptr, /* buffer info */
+                    nullptr), /* texel buffer view */
+                vk::WriteDescriptorSet(
+                    descSets[i], /* descriptor set */
+                    1, /* binding */
+                    0, /* array element */
+                    vk::DescriptorType::eStorageImage, /* descriptor type */
+                    dstInfo, /* image info */
+                    nullptr, /* buffer info */
+                    nullptr) /* texel buffer view */
+            };
+        device.updateDescriptorSets(descWrites, nullptr);
+    }
+
+    vk::CommandBuffer cmdBuf = this->_app->newCommandBuf();
+
+    this->_app->beginCommands(cmdBuf, true);
+
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+
+    // the base level is the source for the first dispatch
+    vk::ImageMemoryBarrier barrier(
+        vk::AccessFlagBits::eTransferWrite, /* src access mask */
+        vk::AccessFlagBits::eShaderRead, /* dst access mask */
+        vk::ImageLayout::eTransferDstOptimal, /* old layout */
+        vk::ImageLayout::eShaderReadOnlyOptimal, /* new layout */
+        VK_QUEUE_FAMILY_IGNORED, /* src queue family index */
+        VK_QUEUE_FAMILY_IGNORED, /* dst queue family index */
+        this->_img, /* image */
+        vk::ImageSubresourceRange(
+            vk::ImageAspectFlagBits::eColor, /* aspect mask */
+            0, /* base mip level */
+            1, /* level count */
+            0, /* base array layer */
+            1)); /* layer count */
+
+    cmdBuf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, /* src stage */
+        vk::PipelineStageFlagBits::eComputeShader, /* dst stage */
+        {}, /* dependency flags */
+        nullptr, /* memory barriers */
+        nullptr, /* buffer-memory barriers */
+        barrier); /* image barriers */
+
+    // the other levels are in the general layout while they are being written
+    barrier
+        .setOldLayout(vk::ImageLayout::eUndefined)
+        .setNewLayout(vk::ImageLayout::eGeneral)
+        .setSrcAccessMask({})
+        .setDstAccessMask(vk::AccessFlagBits::eShaderWrite);
+    barrier.subresourceRange
+        .setBaseMipLevel(1)
+        .setLevelCount(nSets);
+
+    cmdBuf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe, /* src stage */
+        vk::PipelineStageFlagBits::eComputeShader, /* dst stage */
+        {}, /* dependency flags */
+        nullptr, /* memory barriers */
+        nullptr, /* buffer-memory barriers */
+        barrier); /* image barriers */
+
+    barrier.subresourceRange.setLevelCount(1);
+    barrier
+        .setOldLayout(vk::ImageLayout::eGeneral)
+        .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+        .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+        .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+    int32_t mipWid = this->_wid;
+    int32_t mipHt = this->_ht;
+    for (uint32_t i = 1;  i < this->_nMipLevels;  i++) {
+        int32_t nextWid = (mipWid > 1) ? (mipWid >> 1) : 1;
+        int32_t nextHt = (mipHt > 1) ? (mipHt >> 1) : 1;
+        int32_t sizes[4] = { mipWid, mipHt, nextWid, nextHt };
+
+        cmdBuf.bindDescriptorSets(
+            vk::PipelineBindPoint::eCompute,
+            layout,
+            0, /* first set */
+            descSets[i-1], /* descriptor sets */
+            nullptr); /* dynamic offsets */
+        cmdBuf.pushConstants(
+            layout,
+            vk::ShaderStageFlagBits::eCompute,
+            0,
+            sizeof(sizes),
+            sizes);
+        // the shader uses 8x8 workgroups
+        cmdBuf.dispatch((nextWid + 7) / 8, (nextHt + 7) / 8, 1);
+
+        // level i is the source for the next dispatch and is read by the
+        // fragment shader once the texture is in use
+        barrier.subresourceRange.setBaseMipLevel(i);
+        cmdBuf.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader, /* src stage */
+            vk::PipelineStageFlagBits::eComputeShader
+                | vk::PipelineStageFlagBits::eFragmentShader, /* dst stage */
+            {}, /* dependency flags */
+            nullptr, /* memory barriers */
+            nullptr, /* buffer-memory barriers */
+            barrier); /* image barriers */
+
+        mipWid = nextWid;
+        mipHt = nextHt;
+    }
+
+    this->_app->endCommands(cmdBuf);
+    this->_app->submitCommands(cmdBuf);
+    this->_app->freeCommandBuf(cmdBuf);
+
+    // free up the temporary objects
+    device.destroyDescriptorPool(pool);
+    for (auto view : views) {
+        device.destroyImageView(view);
+    }
+    device.destroyPipeline(pipeline);
+    device.destroyPipelineLayout(layout);
+    device.destroyDescriptorSetLayout(dsLayout);
+    device.destroyShaderModule(shader);
+
+}
+
+/******************** class Texture2DArray methods ********************/
+
+// get the first layer of an array texture, which determines its size and format
+static Image2D const *firstLayer (std::vector<Image2D const *> const &layers)
+{
+    if (layers.empty()) {
+        ERROR("array texture without layers");
+    }
+    return layers[0];
+}
+
+// get the base level of the first layer of an array texture
+static Image2D const *firstLayer (std::vector<std::vector<Image2D const *>> const &levels)
+{
+    if (levels.empty() || levels[0].empty()) {
+        ERROR("array texture without layers");
+    }
+    return levels[0][0];
+}
+
+// get the number of mipmap levels of the layers of an array texture
+static uint32_t numLevels (std::vector<std::vector<Image2D const *>> const &levels)
+{
+    return (firstLayer(levels) != nullptr) ? levels[0].size() : 0;
+}
+
+Texture2DArray::Texture2DArray (
+    Application *app,
+    std::vector<Image2D const *> const &layers,
+    bool mipmap)
+  : Texture2DArray(app, layers, mipmap, vk::ImageViewType::e2DArray)
+{ }
+
+Texture2DArray::Texture2DArray (
+    Application *app,
+    std::vector<Image2D const *> const &layers,
+    bool mipmap,
+    vk::ImageViewType viewType)
+  : __detail::TextureBase(
+        app,
+        firstLayer(layers)->width(), firstLayer(layers)->height(),
+        mipLevels(firstLayer(layers), mipmap),
+        firstLayer(layers)->format(),
+        layers.size(),
+        viewType)
+{
+    this->_initLayers (layers, mipmap);
+}
+
+Texture2DArray::Texture2DArray (
+    Application *app,
+    std::vector<std::vector<Image2D const *>> const &levels)
+  : __detail::TextureBase(
+        app,
+        firstLayer(levels)->width(), firstLayer(levels)->height(),
+        numLevels(levels),
+        firstLayer(levels)->format(),
+        levels.size(),
+        vk::ImageViewType::e2DArray)
+{
+    std::vector<const void *> data;
+    std::vector<size_t> sizes;
+    for (auto const &chain : levels) {
+        if (chain.size() != this->_nMipLevels) {
+            ERROR("the layers of an array texture must have the same number of levels");
+        }
+        uint32_t wid = this->_wid;
+        uint32_t ht = this->_ht;
+        for (auto lvl : chain) {
+            if ((lvl->width() != wid) || (lvl->height() != ht)
+            || (lvl->format() != this->_fmt)) {
+                ERROR("invalid mipmap level for array texture");
+            }
+            data.push_back (lvl->data());
+            sizes.push_back (lvl->nBytes());
+            wid = std::max(wid >> 1, 1u);
+            ht = std::max(ht >> 1, 1u);
+        }
+    }
+
+    this->_uploadLevels (data, sizes, this->_nMipLevels);
+
+}
+
+void Texture2DArray::_initLayers (std::vector<Image2D const *> const &layers, bool mipmap)
+{
+    for (auto layer : layers) {
+        if ((layer->width() != this->_wid) || (layer->height() != this->_ht)
+        || (layer->format() != this->_fmt)) {
+            ERROR("the layers of an array texture must have the same size and format");
+        }
+    }
+
+    std::vector<const void *> data;
+    std::vector<size_t> sizes;
+    if ((this->_nMipLevels == 1)
+    || (__detail::mipmapMethod(this->_app, this->_fmt) == __detail::MipmapMethod::eBlit)) {
+        // upload the base level of each layer; the rest of the levels (if any)
+        // are generated on the device
+        for (auto layer : layers) {
+            data.push_back (layer->data());
+            sizes.push_back (layer->nBytes());
+        }
+        this->_uploadLevels (data, sizes, 1);
+        if (this->_nMipLevels > 1) {
+            this->_blitMipMaps ();
+        }
+    } else {
+        // the device cannot blit this format, so we compute the levels of each
+        // layer on the CPU and upload all of them at once
+        std::vector<Image2D *> mips;
+        for (auto layer : layers) {
+            std::vector<Image2D *> layerMips = generateMipLevels (layer);
+            data.push_back (layer->data());
+            sizes.push_back (layer->nBytes());
+            for (auto lvl : layerMips) {
+                data.push_back (lvl->data());
+                sizes.push_back (lvl->nBytes());
+            }
+            mips.insert (mips.end(), layerMips.begin(), layerMips.end());
+        }
+        this->_uploadLevels (data, sizes, this->_nMipLevels);
+        for (auto lvl : mips) {
+            delete lvl;
+        }
+    }
+
+}
+
+/******************** class TextureCube methods ********************/
+
+// check that the faces of a cube map are square and return them as a vector
+static std::vector<Image2D const *> cubeFaces (std::array<Image2D const *, 6> const &faces)
+{
+    if (faces[0]->width() != faces[0]->height()) {
+        ERROR("the faces of a cube-map texture must be square");
+    }
+    return std::vector<Image2D const *>(faces.begin(), faces.end());
+}
+
+TextureCube::TextureCube (
+    Application *app,
+    std::array<Image2D const *, 6> const &faces,
+    bool mipmap)
+  : Texture2DArray(app, cubeFaces(faces), mipmap, vk::ImageViewType::eCube)
+{ }
+
 } // namespace cs237
@@ -0,0 +1,709 @@
+/*! \file virtual-texture.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Virtual textures.  The page file has the following layout:
+ *
+ *      header          magic number, version, size of the base level, tile
+ *                      size, border width, number of levels, and sRGB flag
+ *      tiles           starting at offset kDataOffset, the tiles of each level
+ *                      (finest first) in row-major order; each tile is
+ *                      (tileSize+2*border)^2 RGBA8 texels.
+ *
+ * The cache is managed by the rendering thread, which reads the feedback
+ * buffer of a frame once the frame has finished, sends requests for missing
+ * tiles to the streaming thread, and copies the tiles that the streaming
+ * thread has loaded into free (or least-recently used) slots of the cache.
+ * The root tile (i.e., the single tile of the coarsest level) is pinned in
+ * slot 0, so every lookup in the page table finds a resident tile.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include <cstring>
+#include <fstream>
+
+namespace cs237 {
+
+namespace __detail {
+
+static const char kVTMagic[8] = { 'C', 'S', '2', '3', '7', 'V', 'T', '\0' };
+static const uint32_t kVTVersion = 1;
+static const size_t kDataOffset = 64;
+
+// the page-file header
+struct VTHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t wid;               // size of the base level
+    uint32_t ht;
+    uint32_t tileSize;          // tile size (not including the border)
+    uint32_t border;            // width of the tile border
+    uint32_t nLevels;           // number of levels
+    uint32_t sRGB;              // non-zero for sRGB color data
+};
+
+// the maximum number of outstanding tile requests
+static const size_t kMaxPending = 64;
+
+// the maximum number of tiles that are uploaded per frame
+static const uint32_t kMaxUploadsPerFrame = 16;
+
+// the number of levels of a virtual texture; the last level fits in a single tile
+static uint32_t numVTLevels (uint32_t wid, uint32_t ht, uint32_t tileSize)
+{
+    uint32_t n = 1;
+    while (std::max(wid >> (n-1), ht >> (n-1)) > tileSize) {
+        n++;
+    }
+    return n;
+}
+
+// compute the number of tiles in each level and the index of the first tile of
+// each level
+static void tileLayout (
+    uint32_t wid, uint32_t ht, uint32_t tileSize, uint32_t nLevels,
+    std::vector<uint32_t> &tilesWide,
+    std::vector<uint32_t> &tilesHigh,
+    std::vector<uint32_t> &levelStart)
+{
+    tilesWide.resize(nLevels);
+    tilesHigh.resize(nLevels);
+    levelStart.resize(nLevels + 1);
+    levelStart[0] = 0;
+    for (uint32_t lvl = 0;  lvl < nLevels;  ++lvl) {
+        tilesWide[lvl] = (std::max(wid >> lvl, 1u) + tileSize - 1) / tileSize;
+        tilesHigh[lvl] = (std::max(ht >> lvl, 1u) + tileSize - 1) / tileSize;
+        levelStart[lvl+1] = levelStart[lvl] + tilesWide[lvl] * tilesHigh[lvl];
+    }
+}
+
+// the smallest power of two that is >= n
+static uint32_t ceilPow2 (uint32_t n)
+{
+    uint32_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+} // namespace __detail
+
+/******************** class VTPageFile ********************/
+
+bool VTPageFile::build (
+    Image2D const *img,
+    std::string const &file,
+    uint32_t tileSize,
+    uint32_t border,
+    JobSystem *jobs)
+{
+    if ((tileSize == 0) || (img->width() == 0) || (img->height() == 0)) {
+        return false;
+    }
+
+    // the tiles are always RGBA8
+    Image2D *rgba = nullptr;
+    Image2D const *base = img;
+    if ((img->channels() != Channels::RGBA) || (img->type() != ChannelTy::U8)) {
+        rgba = img->convert (Channels::RGBA, ChannelTy::U8, img->isSRGB(), jobs);
+        base = rgba;
+    }
+
+    uint32_t wid = base->width();
+    uint32_t ht = base->height();
+    uint32_t nLevels = __detail::numVTLevels (wid, ht, tileSize);
+    std::vector<uint32_t> tilesWide, tilesHigh, levelStart;
+    __detail::tileLayout (wid, ht, tileSize, nLevels, tilesWide, tilesHigh, levelStart);
+
+    std::vector<Image2D *> mips;
+    if (nLevels > 1) {
+        mips = generateMipLevels (base, jobs);
+    }
+
+    __detail::VTHeader hdr;
+    std::memcpy (hdr.magic, __detail::kVTMagic, sizeof(hdr.magic));
+    hdr.version = __detail::kVTVersion;
+    hdr.wid = wid;
+    hdr.ht = ht;
+    hdr.tileSize = tileSize;
+    hdr.border = border;
+    hdr.nLevels = nLevels;
+    hdr.sRGB = base->isSRGB() ? 1 : 0;
+
+    // write the header followed by the tiles of each level
+    bool ok = writeFileAtomically (file, [&] (std::ofstream &outS) {
+        char pad[__detail::kDataOffset] = {};
+        std::memcpy (pad, &hdr, sizeof(hdr));
+        outS.write (pad, sizeof(pad));
+
+        uint32_t p = tileSize + 2*border;
+        size_t tileTexels = size_t(p) * size_t(p);
+        for (uint32_t lvl = 0;  lvl < nLevels;  ++lvl) {
+            Image2D const *src = (lvl == 0) ? base : mips[lvl-1];
+            const uint32_t *texels = static_cast<const uint32_t *>(src->data());
+            uint32_t tw = tilesWide[lvl];
+            uint32_t th = tilesHigh[lvl];
+            std::vector<uint32_t> tiles(size_t(tw) * size_t(th) * tileTexels);
+            auto cutRow = [&] (uint32_t ty) {
+                for (uint32_t tx = 0;  tx < tw;  ++tx) {
+                    copyClampedTile (
+                        texels, src->width(), src->height(),
+                        int32_t(tx * tileSize) - int32_t(border),
+                        int32_t(ty * tileSize) - int32_t(border),
+                        p,
+                        tiles.data() + (size_t(ty) * tw + tx) * tileTexels);
+                }
+            };
+            std::vector<Job *> pending;
+            for (uint32_t ty = 0;  ty < th;  ++ty) {
+                if ((jobs != nullptr) && (th > 1)) {
+                    pending.push_back (jobs->spawn ([&cutRow, ty] () { cutRow (ty); }));
+                } else {
+                    cutRow (ty);
+                }
+            }
+            for (auto job : pending) {
+                jobs->wait (job);
+            }
+            outS.write (
+                reinterpret_cast<const char *>(tiles.data()),
+                tiles.size() * sizeof(uint32_t));
+            if (outS.fail()) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    for (auto lvl : mips) {
+        delete lvl;
+    }
+    delete rgba;
+
+    return ok;
+
+}
+
+VTPageFile::VTPageFile (std::string const &file)
+  : _file(new MappedFile(file)), _tiles(nullptr),
+    _wid(0), _ht(0), _tileSize(0), _border(0), _nLevels(0),
+    _fmt(vk::Format::eUndefined), _levelStart{0}
+{
+    if (! this->_file->isValid() || (this->_file->size() < __detail::kDataOffset)) {
+        return;
+    }
+
+    __detail::VTHeader hdr;
+    std::memcpy (&hdr, this->_file->data(), sizeof(hdr));
+    if ((std::memcmp(hdr.magic, __detail::kVTMagic, sizeof(hdr.magic)) != 0)
+    || (hdr.version != __detail::kVTVersion)
+    || (hdr.tileSize == 0) || (hdr.wid == 0) || (hdr.ht == 0)
+    || (hdr.nLevels != __detail::numVTLevels(hdr.wid, hdr.ht, hdr.tileSize))) {
+        return;
+    }
+
+    std::vector<uint32_t> tilesWide, tilesHigh, levelStart;
+    __detail::tileLayout (
+        hdr.wid, hdr.ht, hdr.tileSize, hdr.nLevels,
+        tilesWide, tilesHigh, levelStart);
+
+    size_t p = hdr.tileSize + 2*hdr.border;
+    size_t nBytes = __detail::kDataOffset + 4 * p * p * size_t(levelStart.back());
+    if (this->_file->size() != nBytes) {
+        return;
+    }
+
+    this->_wid = hdr.wid;
+    this->_ht = hdr.ht;
+    this->_tileSize = hdr.tileSize;
+    this->_border = hdr.border;
+    this->_nLevels = hdr.nLevels;
+    this->_fmt = __detail::toVkFormat (Channels::RGBA, ChannelTy::U8, hdr.sRGB != 0);
+    this->_tilesWide = std::move(tilesWide);
+    this->_tilesHigh = std::move(tilesHigh);
+    this->_levelStart = std::move(levelStart);
+    this->_tiles = reinterpret_cast<const uint8_t *>(this->_file->data())
+        + __detail::kDataOffset;
+
+}
+
+VTPageFile::~VTPageFile ()
+{
+    delete this->_file;
+}
+
+/******************** class VirtualTexture ********************/
+
+uint32_t VirtualTexture::cacheSizeFor (VTPageFile const *pages, uint32_t wid, uint32_t ht)
+{
+    // a cache with four times the area of the screen, plus some slack for
+    // the coarser levels
+    double side = 2.0 * std::sqrt(double(wid) * double(ht)) / double(pages->tileSize());
+    uint32_t n = uint32_t(std::ceil(side)) + 2;
+
+    // there is no point in having more slots than tiles
+    uint32_t maxN = uint32_t(std::ceil(std::sqrt(double(pages->numTiles()))));
+
+    // the page table uses 8 bits for each slot coordinate
+    return std::clamp(std::min(n, maxN), 2u, 256u);
+
+}
+
+VirtualTexture::VirtualTexture (
+    Application *app,
+    VTPageFile const *pages,
+    uint32_t cacheTiles)
+  : _app(app), _pages(pages), _cacheTiles(cacheTiles),
+    _maxUploads(__detail::kMaxUploadsPerFrame),
+    _frameNum(0), _nPending(0), _nResident(0),
+    _requests(__detail::kMaxPending), _loaded(__detail::kMaxPending)
+{
+    if (! pages->isValid()) {
+        ERROR("VirtualTexture: invalid page file");
+    }
+    if (pages->numLevels() > kMaxLevels) {
+        ERROR("VirtualTexture: too many levels");
+    }
+    if (! app->features()->fragmentStoresAndAtomics) {
+        ERROR("VirtualTexture: fragment-shader stores are not supported");
+    }
+
+    vk::Device device = app->_device;
+    uint32_t nLevels = pages->numLevels();
+    uint32_t nTiles = pages->numTiles();
+    uint32_t p = pages->paddedTileSize();
+    size_t tileBytes = pages->tileBytes();
+
+    // the cache must fit in an image and the slot coordinates must fit in a byte
+    this->_cacheTiles = std::clamp(
+        std::min(cacheTiles, app->limits()->maxImageDimension2D / p),
+        2u, 256u);
+    uint32_t nSlots = this->_cacheTiles * this->_cacheTiles;
+    uint32_t cacheSize = this->_cacheTiles * p;
+
+    // the cache texture
+    this->_cacheImg = app->_createImage (
+        cacheSize, cacheSize, pages->format(), vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled);
+    this->_cacheMem = app->_allocImageMemory (
+        this->_cacheImg,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    this->_cacheView = app->_createImageView (
+        this->_cacheImg, pages->format(), vk::ImageAspectFlagBits::eColor);
+
+    // the page table; the size of the base level is rounded up to a power of two,
+    // so that level i of the table covers the tiles of level i of the texture
+    uint32_t ptWid = __detail::ceilPow2 (pages->tilesWide(0));
+    uint32_t ptHt = __detail::ceilPow2 (pages->tilesHigh(0));
+    assert (nLevels <= numMipLevels(ptWid, ptHt));
+    this->_ptImg = app->_createImage (
+        ptWid, ptHt, vk::Format::eR8G8B8A8Uint, vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        nLevels);
+    this->_ptMem = app->_allocImageMemory (
+        this->_ptImg,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    this->_ptView = app->_createImageView (
+        this->_ptImg, vk::Format::eR8G8B8A8Uint, vk::ImageAspectFlagBits::eColor,
+        vk::ImageViewType::e2D, nLevels, 1);
+
+    // the cache is sampled with bilinear filtering inside a tile; anisotropic
+    // filtering would read across the tile borders.  The page table is only
+    // accessed using texelFetch.
+    vk::SamplerCreateInfo samplerInfo(
+        {}, /* flags */
+        vk::Filter::eLinear, /* mag filter */
+        vk::Filter::eLinear, /* min filter */
+        vk::SamplerMipmapMode::eNearest,
+        vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge,
+        vk::SamplerAddressMode::eClampToEdge,
+        0.0, /* mip LOD bias */
+        VK_FALSE, /* anisotropy enable */
+        1.0, /* max anisotropy */
+        VK_FALSE, /* compare enable */
+        vk::CompareOp::eNever, /* compare op */
+        0, /* min LOD */
+        0, /* max LOD */
+        vk::BorderColor::eIntOpaqueBlack, /* borderColor */
+        VK_FALSE); /* unnormalized coordinates */
+    this->_cacheSampler = device.createSampler(samplerInfo);
+    samplerInfo
+        .setMagFilter(vk::Filter::eNearest)
+        .setMinFilter(vk::Filter::eNearest)
+        .setMaxLod(VK_LOD_CLAMP_NONE);
+    this->_ptSampler = device.createSampler(samplerInfo);
+
+    // the parameters
+    this->_params.size = glm::vec2(pages->width(), pages->height());
+    this->_params.cacheScale = glm::vec2(1.0f / float(cacheSize));
+    this->_params.tileSize = pages->tileSize();
+    this->_params.border = pages->border();
+    this->_params.nLevels = nLevels;
+    this->_params.jitter = 0;
+    for (uint32_t lvl = 0;  lvl < kMaxLevels;  ++lvl) {
+        this->_params.levelStart[lvl / 4][lvl % 4] =
+            (lvl < nLevels) ? pages->levelStart(lvl) : nTiles;
+    }
+
+    // the per-frame resources
+    std::vector<uint32_t> zeros(nTiles, 0);
+    size_t stagingSize = this->_maxUploads * tileBytes + nTiles * sizeof(uint32_t);
+    for (auto &frame : this->_frames) {
+        frame.ubo = new UniformBuffer<UB>(app, this->_params);
+        frame.feedback = new StorageBuffer<uint32_t>(app, zeros);
+        frame.staging = app->_createBuffer (
+            stagingSize, vk::BufferUsageFlagBits::eTransferSrc);
+        frame.stagingMem = app->_allocBufferMemory(
+            frame.staging,
+            vk::MemoryPropertyFlagBits::eHostVisible
+                | vk::MemoryPropertyFlagBits::eHostCoherent);
+        frame.stagingPtr = static_cast<uint8_t *>(
+            device.mapMemory(frame.stagingMem, 0, stagingSize, {}));
+    }
+
+    // the cache state; the root tile is pinned in slot 0
+    uint32_t root = nTiles - 1;
+    this->_slotOf.resize(nTiles, kNone);
+    this->_tileIn.resize(nSlots, kNone);
+    this->_lastUsed.resize(nSlots, 0);
+    this->_pending.resize(nTiles, false);
+    this->_table.resize(nTiles, 0);
+    this->_slotOf[root] = 0;
+    this->_tileIn[0] = root;
+    this->_nResident = 1;
+    this->_buildPageTable ();
+
+    // upload the root tile and the initial page table
+    FrameData &frame = this->_frames[0];
+    std::memcpy (frame.stagingPtr, pages->tileData(root), tileBytes);
+    std::memcpy (frame.stagingPtr + tileBytes, this->_table.data(), nTiles * sizeof(uint32_t));
+    vk::CommandBuffer cmdBuf = app->newCommandBuf();
+    app->beginCommands(cmdBuf, true);
+    this->_recordCopies (cmdBuf, frame.staging, { 0 }, vk::ImageLayout::eUndefined);
+    app->endCommands(cmdBuf);
+    app->submitCommands(cmdBuf);
+    app->freeCommandBuf(cmdBuf);
+
+    // start the streaming thread
+    this->_streamer = std::thread(&VirtualTexture::_stream, this);
+
+}
+
+VirtualTexture::~VirtualTexture ()
+{
+    // stop the streaming thread and free any tiles that it has loaded
+    this->_requests.close();
+    this->_loaded.close();
+    this->_streamer.join();
+    LoadedTile tile;
+    while (this->_loaded.tryPop(tile)) {
+        delete[] tile.data;
+    }
+
+    vk::Device device = this->_app->_device;
+    for (auto &frame : this->_frames) {
+        delete frame.ubo;
+        delete frame.feedback;
+        device.unmapMemory(frame.stagingMem);
+        device.freeMemory(frame.stagingMem);
+        device.destroyBuffer(frame.staging);
+    }
+    device.destroySampler(this->_ptSampler);
+    device.destroyImageView(this->_ptView);
+    device.destroyImage(this->_ptImg);
+    device.freeMemory(this->_ptMem);
+    device.destroySampler(this->_cacheSampler);
+    device.destroyImageView(this->_cacheView);
+    device.destroyImage(this->_cacheImg);
+    device.freeMemory(this->_cacheMem);
+
+}
+
+vk::DescriptorBufferInfo VirtualTexture::uboInfo (uint32_t frameIdx) const
+{
+    return this->_frames[frameIdx].ubo->descInfo();
+}
+
+vk::DescriptorBufferInfo VirtualTexture::feedbackInfo (uint32_t frameIdx) const
+{
+    return vk::DescriptorBufferInfo(
+        this->_frames[frameIdx].feedback->vkBuffer(),
+        0,
+        this->_pages->numTiles() * sizeof(uint32_t));
+}
+
+void VirtualTexture::feedbackBarrier (vk::CommandBuffer cmdBuf, uint32_t frameIdx) const
+{
+    vk::BufferMemoryBarrier barrier(
+        vk::AccessFlagBits::eShaderWrite, /* src access */
+        vk::AccessFlagBits::eHostRead, /* dst access */
+        VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED,
+        this->_frames[frameIdx].feedback->vkBuffer(),
+        0, /* offset */
+        this->_pages->numTiles() * sizeof(uint32_t)); /* size */
+    cmdBuf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eFragmentShader, /* src stage */
+        vk::PipelineStageFlagBits::eHost, /* dst stage */
+        {}, /* dependency flags */
+        nullptr, /* memory barriers */
+        barrier, /* buffer-memory barriers */
+        nullptr); /* image barriers */
+
+}
+
+void VirtualTexture::update (vk::CommandBuffer cmdBuf, uint32_t frameIdx)
+{
+    FrameData &frame = this->_frames[frameIdx];
+    uint32_t nTiles = this->_pages->numTiles();
+    size_t tileBytes = this->_pages->tileBytes();
+
+    this->_frameNum++;
+
+    // read and clear the feedback from the last use of the frame's resources.
+    // The buffer memory may be write combined, so we copy it in one pass.
+    std::vector<uint32_t> feedback(nTiles);
+    MemoryObj *fbMem = frame.feedback->memory();
+    void *fbPtr = fbMem->map(0, nTiles * sizeof(uint32_t));
+    std::memcpy (feedback.data(), fbPtr, nTiles * sizeof(uint32_t));
+    std::memset (fbPtr, 0, nTiles * sizeof(uint32_t));
+    fbMem->unmap();
+
+    std::vector<uint32_t> missing;
+    for (uint32_t id = 0;  id < nTiles;  ++id) {
+        if (feedback[id] != 0) {
+            if ((this->_slotOf[id] == kNone) && !this->_pending[id]) {
+                missing.push_back(id);
+            }
+            // mark the slot that the page table maps the tile to (i.e., the tile
+            // or its resident ancestor) as used
+            uint32_t e = this->_table[id];
+            this->_lastUsed[(e & 0xff) + ((e >> 8) & 0xff) * this->_cacheTiles] =
+                this->_frameNum;
+        }
+    }
+
+    // request the missing tiles, coarsest first, since the coarser tiles are
+    // fallbacks for the finer ones.  The number of pending requests is limited
+    // by the capacity of the queues, so `push` does not block.
+    std::sort (missing.begin(), missing.end(), std::greater<uint32_t>());
+    for (auto id : missing) {
+        if (this->_nPending >= this->_requests.capacity()) {
+            break;
+        }
+        this->_pending[id] = true;
+        this->_nPending++;
+        this->_requests.push(id);
+    }
+
+    // stage the tiles that have been loaded
+    std::vector<int32_t> slots;
+    LoadedTile tile;
+    while ((slots.size() < this->_maxUploads) && this->_loaded.tryPop(tile)) {
+        this->_pending[tile.id] = false;
+        this->_nPending--;
+        int32_t slot = this->_allocSlot();
+        if (slot != kNone) {
+            std::memcpy (frame.stagingPtr + slots.size() * tileBytes, tile.data, tileBytes);
+            slots.push_back(slot);
+            this->_tileIn[slot] = tile.id;
+            this->_slotOf[tile.id] = slot;
+            this->_lastUsed[slot] = this->_frameNum;
+        }
+        // else the cache is full of tiles that are in use, so we drop the tile;
+        // it will be requested again if it is still needed
+        delete[] tile.data;
+    }
+
+    if (! slots.empty()) {
+        this->_buildPageTable ();
+        std::memcpy (
+            frame.stagingPtr + slots.size() * tileBytes,
+            this->_table.data(),
+            nTiles * sizeof(uint32_t));
+        this->_recordCopies (
+            cmdBuf, frame.staging, slots,
+            vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+
+    // cycle through the 16 pixels of each 4x4 block for feedback
+    this->_params.jitter = this->_frameNum & 15;
+    frame.ubo->copyTo(this->_params);
+
+}
+
+void VirtualTexture::_stream ()
+{
+    size_t nBytes = this->_pages->tileBytes();
+    uint32_t id;
+    while (this->_requests.pop(id)) {
+        // copying the tile out of the mapped file is where the file is actually read
+        uint8_t *data = new uint8_t[nBytes];
+        std::memcpy (data, this->_pages->tileData(id), nBytes);
+        if (! this->_loaded.push(LoadedTile{id, data})) {
+            delete[] data;
+            return;
+        }
+    }
+
+}
+
+int32_t VirtualTexture::_allocSlot ()
+{
+    int32_t victim = kNone;
+    uint64_t oldest = this->_frameNum;
+    // slot 0 holds the root tile
+    for (int32_t slot = 1;  slot < int32_t(this->_tileIn.size());  ++slot) {
+        if (this->_tileIn[slot] == kNone) {
+            this->_nResident++;
+            return slot;
+        }
+        else if (this->_lastUsed[slot] < oldest) {
+            victim = slot;
+            oldest = this->_lastUsed[slot];
+        }
+    }
+
+    if (victim != kNone) {
+        this->_slotOf[this->_tileIn[victim]] = kNone;
+        this->_tileIn[victim] = kNone;
+    }
+
+    return victim;
+
+}
+
+void VirtualTexture::_buildPageTable ()
+{
+    int32_t nLevels = this->_pages->numLevels();
+    for (int32_t lvl = nLevels-1;  lvl >= 0;  --lvl) {
+        uint32_t tw = this->_pages->tilesWide(lvl);
+        uint32_t th = this->_pages->tilesHigh(lvl);
+        for (uint32_t y = 0;  y < th;  ++y) {
+            for (uint32_t x = 0;  x < tw;  ++x) {
+                uint32_t id = this->_pages->tileId(lvl, x, y);
+                int32_t slot = this->_slotOf[id];
+                if (slot != kNone) {
+                    this->_table[id] = (slot % this->_cacheTiles)
+                        | ((slot / this->_cacheTiles) << 8)
+                        | (lvl << 16);
+                } else {
+                    // use the entry of the parent tile, which has already been set.
+                    // Because the levels are rounded down, the parent might not
+                    // cover all of the tile, so the shader looks up the tile at the
+                    // resident level again.
+                    assert (lvl+1 < nLevels);
+                    uint32_t px = std::min(x / 2, this->_pages->tilesWide(lvl+1) - 1);
+                    uint32_t py = std::min(y / 2, this->_pages->tilesHigh(lvl+1) - 1);
+                    this->_table[id] = this->_table[this->_pages->tileId(lvl+1, px, py)];
+                }
+            }
+        }
+    }
+
+}
+
+void VirtualTexture::_recordCopies (
+    vk::CommandBuffer cmdBuf,
+    vk::Buffer staging,
+    std::vector<int32_t> const &slots,
+    vk::ImageLayout oldLayout)
+{
+    uint32_t p = this->_pages->paddedTileSize();
+    size_t tileBytes = this->_pages->tileBytes();
+    uint32_t nLevels = this->_pages->numLevels();
+    bool initial = (oldLayout == vk::ImageLayout::eUndefined);
+
+    std::array<vk::ImageMemoryBarrier, 2> barriers = {
+            vk::ImageMemoryBarrier(
+                initial ? vk::AccessFlags() : vk::AccessFlagBits::eShaderRead,
+                vk::AccessFlagBits::eTransferWrite,
+                oldLayout,
+                vk::ImageLayout::eTransferDstOptimal,
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                this->_cacheImg,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)),
+            vk::ImageMemoryBarrier(
+                initial ? vk::AccessFlags() : vk::AccessFlagBits::eShaderRead,
+                vk::AccessFlagBits::eTransferWrite,
+                oldLayout,
+                vk::ImageLayout::eTransferDstOptimal,
+                VK_QUEUE_FAMILY_IGNORED,
+                VK_QUEUE_FAMILY_IGNORED,
+                this->_ptImg,
+                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, nLevels, 0, 1))
+        };
+    cmdBuf.pipelineBarrier(
+        initial
+            ? vk::PipelineStageFlagBits::eTopOfPipe
+            : vk::PipelineStageFlagBits::eFragmentShader, /* src stage */
+        vk::PipelineStageFlagBits::eTransfer, /* dst stage */
+        {}, /* dependency flags */
+        nullptr, /* memory barriers */
+        nullptr, /* buffer-memory barriers */
+        barriers); /* image barriers */
+
+    // the tiles
+    std::vector<vk::BufferImageCopy> regions;
+    regions.reserve(std::max(size_t(nLevels), slots.size()));
+    for (size_t i = 0;  i < slots.size();  ++i) {
+        int32_t sx = slots[i] % this->_cacheTiles;
+        int32_t sy = slots[i] / this->_cacheTiles;
+        regions.push_back(vk::BufferImageCopy(
+            i * tileBytes, /* offset */
+            0, /* row length */
+            0, /* image height */
+            { vk::ImageAspectFlagBits::eColor, 0, 0, 1 },
+            { sx * int32_t(p), sy * int32_t(p), 0 },
+            { p, p, 1 }));
+    }
+    cmdBuf.copyBufferToImage(
+        staging, this->_cacheImg,
+        vk::ImageLayout::eTransferDstOptimal,
+        regions);
+
+    // the page table, which follows the tiles in the staging buffer
+    regions.clear();
+    size_t tableOffset = slots.size() * tileBytes;
+    for (uint32_t lvl = 0;  lvl < nLevels;  ++lvl) {
+        regions.push_back(vk::BufferImageCopy(
+            tableOffset + this->_pages->levelStart(lvl) * sizeof(uint32_t), /* offset */
+            0, /* row length */
+            0, /* image height */
+            { vk::ImageAspectFlagBits::eColor, lvl, 0, 1 },
+            { 0, 0, 0 },
+            { this->_pages->tilesWide(lvl), this->_pages->tilesHigh(lvl), 1 }));
+    }
+    cmdBuf.copyBufferToImage(
+        staging, this->_ptImg,
+        vk::ImageLayout::eTransferDstOptimal,
+        regions);
+
+    for (auto &barrier : barriers) {
+        barrier
+            .setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+            .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+            .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    }
+    cmdBuf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, /* src stage */
+        vk::PipelineStageFlagBits::eFragmentShader, /* dst stage */
+        {}, /* dependency flags */
+        nullptr, /* memory barriers */
+        nullptr, /* buffer-memory barriers */
+        barriers); /* image barriers */
+
+}
+
+} // namespace cs237
@@ -0,0 +1,69 @@
+/*! \file json-test.cpp
+ *
+ * Support code for CMSC 23740 Autumn 2024.
+ *
+ * Tests for the conversion of numbers by the JSON pull parser, including the
+ * numbers that are out of the range of doubles.
+ *
+ *      usage: json-test
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "json.hpp"
+#include <cmath>
+#include <cstring>
+
+/// check that the JSON text `txt` reads as the real number `expected`
+/// \return true if the test passed
+static bool check (const char *txt, double expected)
+{
+    json::Reader r(txt, std::strlen(txt), "json-test");
+    if (! r.isNumber()) {
+        std::cerr << "FAIL: \"" << txt << "\" is not a number\n";
+        return false;
+    }
+    double v = r.realVal();
+    // compare the bits, so that we distinguish between 0 and -0
+    if ((std::memcmp(&v, &expected, sizeof(double)) != 0)) {
+        std::cerr << "FAIL: \"" << txt << "\" read as " << v
+            << "; expected " << expected << "\n";
+        return false;
+    }
+    return true;
+}
+
+int main ()
+{
+    int nFailed = 0;
+
+    // the fast path
+    nFailed += ! check ("0.5", 0.5);
+    nFailed += ! check ("-1.25e3", -1250.0);
+
+    // the slow path
+    nFailed += ! check ("1.7976931348623157e308", 1.7976931348623157e308);
+    nFailed += ! check ("0.1234567890123456789", 0.1234567890123456789);
+    nFailed += ! check ("4.9e-324", 4.9e-324);
+
+    // overflow and underflow
+    nFailed += ! check ("1e400", HUGE_VAL);
+    nFailed += ! check ("-1e400", -HUGE_VAL);
+    nFailed += ! check ("12345678901234567890e300", HUGE_VAL);
+    nFailed += ! check ("1e-400", 0.0);
+    nFailed += ! check ("-1e-400", -0.0);
+
+    if (nFailed > 0) {
+        std::cerr << nFailed << " tests failed\n";
+        return 1;
+    }
+    std::cout << "all tests passed\n";
+    return 0;
+
+}
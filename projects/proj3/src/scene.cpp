@@ -123,8 +123,8 @@ bool Scene::load (std::string const &path)
 
     std::string sceneDir = path + "/";
 
-    // load the scene description file
-    json::Value *root = json::parseFile(sceneDir + "scene.json");
+    // load the scene description file; the JSON tree is freed when we return
+    std::unique_ptr<json::Value> root(json::parseFile(sceneDir + "scene.json"));
 
     // check for errors
     if (root == nullptr) {
@@ -209,9 +209,26 @@ bool Scene::load (std::string const &path)
     // allocate space for the objects in the scene
     this->_objs.resize(objs->length());
 
+    // the job system used to load the scene's assets in parallel
+    cs237::JobSystem jobs;
+
+    // the jobs refer to the scene, so we must wait for them to finish before
+    // returning, even when there is an error; the job pointers in `_texJobs`
+    // are only valid until then
+    auto finishJobs = [this, &jobs] () {
+        try {
+            jobs.waitAll();
+        } catch (...) {
+            this->_texJobs.clear();
+            throw;
+        }
+        this->_texJobs.clear();
+    };
+
     // we use a map to keep track of which models have already been loaded
     std::map<std::string, int> objMap;
     std::map<std::string, int>::iterator it;
+    std::vector<std::string> modelFiles;
 
     // load the objects in the scene
     int numModels = 0;
@@ -220,6 +237,7 @@ bool Scene::load (std::string const &path)
         if (object == nullptr) {
             std::cerr << "Expected array of JSON objects for field 'objects' in \""
                 << path << "\"\n";
+            finishJobs();
             return true;
         }
         json::String const *file = object->fieldAsString("file");
@@ -232,6 +250,7 @@ bool Scene::load (std::string const &path)
         ||  loadVec3 (frame->fieldAsObject("z-axis"), zAxis)
         ||  loadColor (object->fieldAsObject("color"), this->_objs[i].color)) {
             std::cerr << "Invalid objects description in \"" << path << "\"\n";
+            finishJobs();
             return true;
         }
         // have we already loaded this model?
@@ -241,10 +260,9 @@ bool Scene::load (std::string const &path)
             modelId = it->second;
         }
         else {
-            // load the model from the file sytem and add it to the map
+            // add the model to the map; it gets loaded below
             modelId = numModels++;
-            OBJ::Model *model = new OBJ::Model (sceneDir + file->value());
-            this->_models.push_back(model);
+            modelFiles.push_back(file->value());
             objMap.insert (std::pair<std::string, int> (file->value(), modelId));
         }
         this->_objs[i].model = modelId;
@@ -256,14 +274,21 @@ bool Scene::load (std::string const &path)
             glm::vec4 (pos, 1.0f));
     }
 
-    // load the texture images used by the materials in the models
-    for (auto modIt = this->_models.begin();  modIt != this->_models.end();  modIt++) {
-        const OBJ::Model *model = *modIt;
-        for (auto grpIt = model->beginGroups();  grpIt != model->endGroups();  grpIt++) {
-            const OBJ::Material *mat = &model->material((*grpIt).material);
-            this->_loadTexture (sceneDir, mat->diffuseMap);
-            this->_loadTexture (sceneDir, mat->normalMap, true);
-        }
+    // Load the models in parallel.  The material library for a model is read
+    // as part of loading the model, so once a model's job has its materials,
+    // it spawns the jobs that load the texture images used by the materials.
+    this->_models.resize(modelFiles.size(), nullptr);
+    for (int id = 0;  id < modelFiles.size();  id++) {
+        std::string file = sceneDir + modelFiles[id];
+        jobs.spawn ([this, &jobs, sceneDir, file, id] () {
+            OBJ::Model *model = new OBJ::Model (file, &jobs);
+            this->_models[id] = model;
+            for (auto grpIt = model->beginGroups();  grpIt != model->endGroups();  grpIt++) {
+                const OBJ::Material *mat = &model->material((*grpIt).material);
+                this->_loadTexture (jobs, sceneDir, mat->diffuseMap);
+                this->_loadTexture (jobs, sceneDir, mat->normalMap, true);
+            }
+        });
     }
 
     // load the ground information (if present)
@@ -280,52 +305,78 @@ bool Scene::load (std::string const &path)
         ||  loadFloat (ground->fieldAsNumber ("v-scale"), vScale)
         ||  loadColor (ground->fieldAsObject("color"), color)) {
             std::cerr << "Invalid ground description in \"" << path << "\"\n";
+            finishJobs();
             return true;
         }
         // load the color-map and normal-map textures
-        this->_loadTexture (sceneDir, cmap->value());
-        cs237::Image2D *cmapImg = this->textureByName (cmap->value());
-        this->_loadTexture (sceneDir, nmap->value(), true);
-        cs237::Image2D *nmapImg = this->textureByName (nmap->value());
-        this->_hf = new HeightField (sceneDir + hf->value(), wid, ht, vScale, color, cmapImg, nmapImg);
+        std::string cmapName = cmap->value();
+        std::string nmapName = nmap->value();
+        std::vector<cs237::Job *> texJobs = {
+                this->_loadTexture (jobs, sceneDir, cmapName),
+                this->_loadTexture (jobs, sceneDir, nmapName, true)
+            };
+        // load the height field once its textures are available
+        std::string hfFile = sceneDir + hf->value();
+        jobs.spawn ([=] () {
+            cs237::Image2D *cmapImg = this->textureByName (cmapName);
+            cs237::Image2D *nmapImg = this->textureByName (nmapName);
+            this->_hf = new HeightField (hfFile, wid, ht, vScale, color, cmapImg, nmapImg);
+        }, texJobs);
     }
 
     if ((ground == nullptr) && (objs->length() == 0)) {
         std::cerr << "Invalid empty scene description in \"" << path << "\"\n";
+        finishJobs();
         return true;
     }
 
-    // free up the space used by the JSON object
-    delete root;
+    // wait for the models, textures, and height field to finish loading
+    finishJobs();
 
     return false;
 }
 
-void Scene::_loadTexture (std::string path, std::string name, bool nMap)
+cs237::Job *Scene::_loadTexture (
+    cs237::JobSystem &jobs,
+    std::string path,
+    std::string name,
+    bool nMap)
 {
     if (name.empty()) {
-        return;
-    }
-    // have we already loaded this texture?
-    if (this->_texs.find(name) != this->_texs.end()) {
-        return;
+        return nullptr;
     }
-    // load the image data;
-    cs237::Image2D *img;
-    if (nMap) {
-        // normal data should not be sRGB encoded!
-        img = new cs237::DataImage2D(path + name);
-    } else {
-        img = new cs237::Image2D(path + name);
+
+    std::lock_guard<std::mutex> lk(this->_texLock);
+
+    // have we already loaded (or started loading) this texture?
+    auto it = this->_texJobs.find(name);
+    if (it != this->_texJobs.end()) {
+        return it->second;
     }
-    // add to _texs map
-    this->_texs.insert (std::pair<std::string, cs237::Image2D *>(name, img));
+    // add a placeholder to the _texs map; the job fills it in
+    this->_texs.insert (std::pair<std::string, cs237::Image2D *>(name, nullptr));
+    // spawn a job to load the image data
+    cs237::Job *job = jobs.spawn ([this, path, name, nMap] () {
+        cs237::Image2D *img;
+        if (nMap) {
+            // normal data should not be sRGB encoded!
+            img = new cs237::DataImage2D(path + name);
+        } else {
+            img = new cs237::Image2D(path + name);
+        }
+        std::lock_guard<std::mutex> lk(this->_texLock);
+        this->_texs[name] = img;
+    });
+    this->_texJobs.insert (std::pair<std::string, cs237::Job *>(name, job));
+
+    return job;
 
 }
 
 cs237::Image2D *Scene::textureByName (std::string name) const
 {
     if (! name.empty()) {
+        std::lock_guard<std::mutex> lk(this->_texLock);
         auto it = this->_texs.find(name);
         if (it != this->_texs.end()) {
             return it->second;
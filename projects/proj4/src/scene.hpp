@@ -19,6 +19,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <mutex>
 #include "cs237/cs237.hpp"
 #include "obj.hpp"
 #include "height-field.hpp"
@@ -177,12 +178,23 @@ class Scene {
     std::vector<OBJ::Model const *> _models;            ///< the OBJ models in the scene
     std::vector<SceneObj> _objs;                        ///< the objects in the scene
     std::map<std::string, cs237::Image2D *> _texs;      ///< the textures keyed by name
-
-    /// helper function for loading textures into the _texs map
+    std::map<std::string, cs237::Job *> _texJobs;       ///< the texture-loading jobs keyed
+                                                        ///  by name (only used during `load`)
+    mutable std::mutex _texLock;                        ///< lock that protects `_texs` and
+                                                        ///  `_texJobs` during loading
+
+    /// helper function for loading textures into the _texs map.  The image is
+    /// loaded by a job, so this function may be called from other jobs.
+    /// \param jobs  the job system used to load the image
     /// \param path  the path to the directory containing the image file
     /// \param name  the name of the file
     /// \param nMap  optional argument specifying if the texture is a normal map (default false).
-    void _loadTexture (std::string path, std::string name, bool nMap = false);
+    /// \return the job that loads the texture or nullptr if `name` is empty
+    cs237::Job *_loadTexture (
+        cs237::JobSystem &jobs,
+        std::string path,
+        std::string name,
+        bool nMap = false);
 
 };
 
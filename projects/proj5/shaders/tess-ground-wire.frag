@@ -0,0 +1,26 @@
+/*! \file tess-ground-wire.frag
+ *
+ * \brief The fragment shader for the tessellated ground in wire-frame mode
+ *
+ * \author John Reppy
+ */
+
+/* CMSC23740 Project 5 sample code (Autumn 2024)
+ *
+ * COPYRIGHT (c) 2024 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/* Uniforms (see tess-ground.vert) */
+layout (push_constant) uniform PC {
+    layout (offset = 96) vec3 color;    ///< the ground color for wire-frame mode
+} pc;
+
+layout (location = 0) out vec4 fragColor;
+
+void main ()
+{
+    fragColor = vec4(pc.color, 1);
+}
@@ -0,0 +1,45 @@
+/*! \file tess-ground.vert
+ *
+ * \brief The vertex shader for the tessellated ground
+ *
+ * The ground is drawn as a grid of quad patches without any vertex buffers:
+ * the shader computes the position of a corner of a patch in the unit square
+ * that is covered by the height field from the vertex index.
+ *
+ * \author John Reppy
+ */
+
+/* CMSC23740 Project 5 sample code (Autumn 2024)
+ *
+ * COPYRIGHT (c) 2024 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/* Uniforms */
+layout (push_constant) uniform PC {
+    mat4 mvpM;          ///< model-view-projection transform
+    vec4 eye;           ///< the eye position in model space (xyz) and the number
+                        ///  of tessellated segments per unit of projected size (w)
+    vec4 extent;        ///< the width (x) and depth (y) of the ground and its
+                        ///  minimum (z) and maximum (w) elevation
+    vec3 color;         ///< the ground color for wire-frame mode
+    float vScale;       ///< the vertical scale of the height samples
+    uvec2 nPatches;     ///< the number of patches in the X and Z dimensions
+} pc;
+
+/* Outputs */
+layout (location = 0) out vec2 tcGrid;  ///< the corner's position in the unit square
+
+void main ()
+{
+    // the vertices of a patch are its corners in counterclockwise order
+    // starting from the corner with the smallest coordinates
+    uint patchId = gl_VertexIndex / 4;
+    uint corner = gl_VertexIndex % 4;
+    uvec2 p = uvec2(patchId % pc.nPatches.x, patchId / pc.nPatches.x);
+    uvec2 offset = uvec2(((corner == 1) || (corner == 2)) ? 1 : 0, (corner >= 2) ? 1 : 0);
+
+    tcGrid = vec2(p + offset) / vec2(pc.nPatches);
+}
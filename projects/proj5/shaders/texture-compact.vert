@@ -0,0 +1,54 @@
+/*! \file texture-compact.vert
+ *
+ * \brief The vertex shader for rendering meshes with compact vertices in
+ * texturing mode
+ *
+ * Compact vertices have quantized positions and texture coordinates, and
+ * octahedral-encoded normal and tangent vectors (see vertex.hpp).  The
+ * position decoding is folded into the model-view-projection transform.
+ *
+ * \author John Reppy
+ */
+
+/* CMSC23740 Project 5 sample code (Autumn 2024)
+ *
+ * COPYRIGHT (c) 2024 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/* Uniforms */
+layout (push_constant) uniform PC {
+    mat4 mvpM;          ///< model-view-projection transform
+    mat4 normM;         ///< to-world transform for normal vectors; the fourth
+                        ///  column holds the texture-coordinate scale (xy) and
+                        ///  offset (zw)
+} pc;
+
+/* Vertex attributes */
+layout (location = 0) in vec4 vPos;     ///< quantized vertex position (xyz) and
+                                        ///  tangent sign (w)
+layout (location = 1) in vec4 vNormTan; ///< octahedral-encoded normal (xy) and
+                                        ///  tangent (zw) (tangent is unused)
+layout (location = 2) in vec2 vTC;      ///< quantized texture coordinate
+
+/* Outputs */
+layout (location = 0) out vec3 fNorm;   ///< world-space vertex normal
+layout (location = 1) out vec2 fTC;     ///< texture coordinate
+
+/// decode an octahedral-encoded unit vector
+vec3 octDecode (vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += vec2((v.x >= 0.0) ? -t : t, (v.y >= 0.0) ? -t : t);
+    return normalize(v);
+}
+
+void main ()
+{
+    gl_Position = pc.mvpM * vec4(vPos.xyz, 1);
+    fNorm = mat3(pc.normM) * octDecode(vNormTan.xy);
+    fTC = vTC * pc.normM[3].xy + pc.normM[3].zw;
+}
@@ -0,0 +1,118 @@
+/*! \file texture-vt.frag
+ *
+ * \brief The fragment shader for rendering meshes whose color map is a virtual
+ *        texture in texturing mode.
+ *
+ * The lighting is the same as for texture.frag, but the albedo is sampled from
+ * the tiles of the virtual texture that are resident in the cache.  The shader
+ * also records the tiles that it needs in the feedback buffer, which is read
+ * by the host to stream in the missing tiles (see cs237/virtual-texture.hpp).
+ * Filtering is bilinear within the nearest level.
+ *
+ * \author John Reppy
+ */
+
+/* CMSC23740 Project 5 sample code (Autumn 2024)
+ *
+ * COPYRIGHT (c) 2024 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/* Uniforms */
+layout (set = 0, binding = 0) uniform LightingUB {
+    vec3 lightDir;              ///< unit vector pointing toward light
+    vec3 lightIntensity;        ///< intensity of directional light
+    vec3 ambIntensity;          ///< intensity of ambient light
+    float shadowFactor;         ///< scaling for shadowed fragments
+} lightingUBO;
+
+/* the virtual texture */
+layout (set = 2, binding = 0) uniform VTParamsUB {
+    vec2 size;                  ///< size of the base level in texels
+    vec2 cacheScale;            ///< 1 / size of the cache in texels
+    uint tileSize;              ///< tile size (not including the border)
+    uint border;                ///< width of the tile border
+    uint nLevels;               ///< number of levels
+    uint jitter;                ///< selects the pixel of each 4x4 block that
+                                ///  writes feedback
+    uvec4 levelStart[4];        ///< index of the first tile of each level
+} vt;
+
+layout (set = 2, binding = 1) uniform usampler2D pageTable;
+layout (set = 2, binding = 2) uniform sampler2D vtCache;
+layout (set = 2, binding = 3) buffer VTFeedback {
+    uint wanted[];              ///< set to 1 for the tiles that are needed
+} feedback;
+
+/* Inputs */
+layout (location = 0) in vec3 fNorm;    ///< world-space vertex normal
+layout (location = 1) in vec2 fTC;      ///< texture coordinate
+
+/* Outputs */
+layout (location = 0) out vec4 fragColor;
+
+// the size of a level in texels
+vec2 levelSize (uint lvl)
+{
+    return max(floor(vt.size / float(1 << lvl)), vec2(1));
+}
+
+// the tile that contains the texture coordinate at a level
+uvec2 tileAt (vec2 uv, uint lvl)
+{
+    vec2 p = uv * levelSize(lvl);
+    uvec2 nTiles = (uvec2(levelSize(lvl)) + vt.tileSize - 1u) / vt.tileSize;
+    return min(uvec2(p) / vt.tileSize, nTiles - 1u);
+}
+
+// sample the virtual texture
+vec4 sampleVT (vec2 uv)
+{
+    uv = clamp(uv, 0, 1);
+
+    // the level of detail; the derivatives are computed before any branches
+    vec2 dx = dFdx(uv * vt.size);
+    vec2 dy = dFdy(uv * vt.size);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    uint lvl = uint(clamp(lod + 0.5, 0.0, float(vt.nLevels - 1u)));
+
+    // request the tile, but only from one pixel of each 4x4 block per frame
+    uvec2 pix = uvec2(gl_FragCoord.xy) & 3u;
+    uvec2 tile = tileAt(uv, lvl);
+    if (pix.x + 4u * pix.y == vt.jitter) {
+        uint nTilesX = (uint(levelSize(lvl).x) + vt.tileSize - 1u) / vt.tileSize;
+        uint id = vt.levelStart[lvl / 4u][lvl % 4u] + tile.y * nTilesX + tile.x;
+        feedback.wanted[id] = 1u;
+    }
+
+    // find the resident tile; the page-table entry for a missing tile refers to
+    // a coarser level, at which we look up the tile that contains `uv` again
+    // until we reach a tile that is resident (the coarsest tile always is)
+    uvec4 entry = texelFetch(pageTable, ivec2(tile), int(lvl));
+    while (entry.z != lvl) {
+        lvl = entry.z;
+        tile = tileAt(uv, lvl);
+        entry = texelFetch(pageTable, ivec2(tile), int(lvl));
+    }
+
+    // the position in the cache
+    vec2 local = uv * levelSize(lvl) - vec2(tile * vt.tileSize);
+    vec2 pos = vec2(entry.xy * (vt.tileSize + 2u*vt.border) + vt.border) + local;
+    return textureLod(vtCache, pos * vt.cacheScale, 0.0);
+}
+
+void main ()
+{
+    // renormalize the surface normal
+    vec3 norm = normalize(fNorm);
+
+    // direct-lighting contribution
+    float lightFactor = max(dot(lightingUBO.lightDir, norm), 0.0);
+    vec3 intensity = lightingUBO.ambIntensity + lightFactor * lightingUBO.lightIntensity;
+
+    vec3 albedo = sampleVT(fTC).rgb;
+
+    fragColor = vec4(clamp (intensity * albedo, 0, 1), 1);
+}
@@ -0,0 +1,36 @@
+/*! \file wire-frame-compact.vert
+ *
+ * \brief The vertex shader for rendering meshes with compact vertices in
+ * wire-frame mode
+ *
+ * \author John Reppy
+ */
+
+/* CMSC23740 Project 5 sample code (Autumn 2024)
+ *
+ * COPYRIGHT (c) 2024 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/* Uniforms */
+layout (push_constant) uniform PC {
+    mat4 mvpM;          ///< model-view-projection transform (including the
+                        ///  decoding of the quantized positions)
+    vec3 color;         ///< object color
+} pc;
+
+/* Vertex attributes */
+layout (location = 0) in vec4 vPos;     ///< quantized vertex position
+layout (location = 1) in vec4 vNormTan; ///< encoded normal and tangent (unused)
+layout (location = 2) in vec2 vTC;      ///< quantized texture coordinate (unused)
+
+/* Outputs */
+layout (location = 0) out vec3 fColor;  // vertex color (out)
+
+void main ()
+{
+    gl_Position = pc.mvpM * vec4(vPos.xyz, 1);
+    fColor = pc.color;
+}
@@ -29,34 +29,83 @@ const std::string kDataDir = PROJ5_SOURCE_ROOT "/scenes/";
 
 static void usage (int sts)
 {
-    std::cerr << "usage: proj5 [options] <scene>\n";
+    std::cerr << "usage: proj5 [options] <scene>\n"
+        << "options:\n"
+        << "    -compact  use compact (quantized) vertices for the model meshes\n"
+        << "    -debug    enable Vulkan validation\n"
+        << "    -no-host-copy\n"
+        << "              upload textures through staging buffers even when the\n"
+        << "              device supports host image copies\n"
+        << "    -no-stream\n"
+        << "              load large height fields into memory instead of streaming\n"
+        << "              the ground mesh from a tiled height-field file\n"
+        << "    -no-vt    load large ground maps as regular textures instead of\n"
+        << "              virtual textures\n"
+        << "    -tess     render the ground using hardware tessellation (implies -no-vt\n"
+        << "              and -no-stream)\n"
+        << "    -verbose  enable verbose output\n";
     exit (sts);
 }
 
 Proj5::Proj5 (std::vector<std::string> const &args)
   : cs237::Application (args, "CS237 Project 5"),
-    _enableRain(false)
+    _compactMeshes(false), _tessGround(false), _enableRain(false)
 {
-    // the last argument is the name of the scene directory that we should render
+    // the last argument is the name of the scene directory (or bundle) that we
+    // should render
     if (args.size() < 2) {
         usage(EXIT_FAILURE);
     }
+    // process the project-specific options (the generic options are handled
+    // by the `Application` constructor).  Large ground maps are virtual
+    // textures, which require stores from fragment shaders.
+    bool virtTex = this->features()->fragmentStoresAndAtomics;
+    bool tiledHF = true;
+    for (int i = 1;  i < args.size() - 1;  ++i) {
+        if (args[i] == "-compact") {
+            this->_compactMeshes = true;
+        } else if (args[i] == "-no-stream") {
+            tiledHF = false;
+        } else if (args[i] == "-no-vt") {
+            virtTex = false;
+        } else if (args[i] == "-tess") {
+            if (this->features()->tessellationShader) {
+                this->_tessGround = true;
+            } else {
+                std::cerr << "proj5: tessellation is not supported; ignoring -tess\n";
+            }
+        }
+    }
+    // the tessellated ground samples its color map as a regular texture and
+    // its height field as a texture
+    if (this->_tessGround) {
+        virtTex = false;
+        tiledHF = false;
+    }
     std_fs::path scenePath = args.back();
     if (! scenePath.is_absolute()) {
         // assume relative to the data directory
         scenePath = kDataDir + std::string(scenePath);
     }
 
-    // verify that the scene path exists
+    // verify that the scene path exists; it is either a scene directory or
+    // a scene bundle produced by proj5-bake
     auto sts = std_fs::status(scenePath);
-    if (sts.type() != std_fs::file_type::directory) {
+    if ((sts.type() != std_fs::file_type::directory)
+    && (sts.type() != std_fs::file_type::regular)) {
         std::cerr << "proj5: scene '" << std::string(scenePath)
-            << "' is not a directory or does not exist\n";
+            << "' is not a directory or bundle, or does not exist\n";
         exit(EXIT_FAILURE);
     }
 
+    // reorder the models' meshes for the GPU's vertex cache and build their
+    // levels of detail; since this is done before the models' cache files are
+    // written, it only costs on the first run
+    OBJ::Model::setOptimizeMeshes (true);
+    OBJ::Model::setBuildLODs (true);
+
     // load the scene
-    if (this->_scene.load(scenePath)) {
+    if (this->_scene.load(scenePath, virtTex, tiledHF)) {
         std::cerr << "proj5: cannot load scene from '" << scenePath << "'\n";
         exit(EXIT_FAILURE);
     }
@@ -125,6 +174,8 @@ void Proj5::controlsHelpMessage ()
         << "#     'e' to toggle emissive lighting\n"
         << "#     's' to toggle shadows (extra credit)\n"
         << "#   Other controls\n"
+        << "#     'c' to toggle GPU culling of the meshlets of large meshes\n"
+        << "#     'o' to toggle level-of-detail selection for the models\n"
         << "#     'h' to display this message\n"
         << "#     'r' to toggle the particle system\n"
         << "#     left and right arrow keys to rotate view\n"
@@ -28,6 +28,9 @@ public:
     /// access function for the scene
     const Scene *scene () const { return &this->_scene; }
 
+    /// get the next scene asset that has finished loading (see `Scene::nextAsset`)
+    bool nextSceneAsset (SceneAsset &asset) { return this->_scene.nextAsset(asset); }
+
     /// a descriptor-set layout for the per-mesh samplers
     vk::DescriptorSetLayout meshDSLayout () const { return this->_meshDSLayout; }
 
@@ -35,6 +38,12 @@ public:
     /// per-frame descriptor sets
     vk::DescriptorSet allocMeshDS ();
 
+    /// should the model meshes use compact vertices?
+    bool compactMeshes () const { return this->_compactMeshes; }
+
+    /// should the ground be rendered using hardware tessellation?
+    bool tessGround () const { return this->_tessGround; }
+
     /// print the interface help message to standard out
     void controlsHelpMessage ();
 
@@ -76,6 +85,11 @@ protected:
     /// across meshes
     vk::DescriptorSetLayout _meshDSLayout;
 
+    bool _compactMeshes;                ///< when true, the model meshes use
+                                        ///  compact vertices (see vertex.hpp)
+    bool _tessGround;                   ///< when true, the ground is rendered using
+                                        ///  hardware tessellation (see tess-ground.hpp)
+
     /// rain simulation stuff
     bool _enableRain;                   ///< when true, simulate and render the
                                         ///  rain particles
@@ -0,0 +1,402 @@
+/*! \file bake.cpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5
+ *
+ * A tool that converts a scene directory into a scene bundle (see `bundle.hpp`),
+ * which can be loaded by `proj5` in place of the directory.  The bundle holds
+ * the scene description, the models in the format of the OBJ cache files (with
+ * optimized meshes and levels of detail), the textures with their mipmap levels
+ * (optionally block compressed), and the height field.  Optionally, small
+ * color textures are packed into texture atlases, so that meshes whose materials
+ * only differ in their textures can share the atlas and its descriptor set.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237/cs237.hpp"
+#include "json.hpp"
+#include "bundle.hpp"
+#include "scene.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <thread>
+
+static void usage (int sts)
+{
+    std::cerr << "usage: proj5-bake [options] <scene-dir> <bundle>\n"
+        << "options:\n"
+        << "    -bc       block compress the textures that have 8-bit channels\n"
+        << "              (BC7 for color maps and BC5 for normal maps; note that\n"
+        << "              BC5 only stores the X and Y components of normals, so\n"
+        << "              the shaders must reconstruct Z)\n"
+        << "    -atlas    pack small color textures into texture atlases (the\n"
+        << "              textures must not repeat; see `kMaxAtlasImageSize`)\n"
+        << "    -bench    compare the time to load the scene from the directory\n"
+        << "              and from the bundle (run after flushing the OS file\n"
+        << "              cache to measure a cold start)\n";
+    exit (sts);
+}
+
+/// textures that are at most this size in both dimensions are packed into atlases
+constexpr uint32_t kMaxAtlasImageSize = 512;
+
+/// the size of a texture-atlas page
+constexpr uint32_t kAtlasPageSize = 2048;
+
+/// the prefix of the names of the atlas pages in the bundle; the scene's textures
+/// are named by relative paths, which do not start with '@'
+const std::string kAtlasPagePrefix = "@atlas-";
+
+/// the parts of the ground description that name files
+struct BakeGround {
+    std::string hf;                     ///< the height-field file
+    std::string cmap;                   ///< the color-map file
+    std::optional<std::string> nmap;    ///< the normal-map file
+};
+
+namespace json {
+
+template <>
+struct Binder<BakeGround> {
+    static bool read (Reader &r, BakeGround &ground)
+    {
+        return r.readObject ({
+                {"height-field", ground.hf},
+                {"color-map", ground.cmap},
+                {"normal-map", ground.nmap}
+            });
+    }
+};
+
+} // namespace json
+
+/***** baking *****/
+
+/// can the textures of a group's material be mapped into a texture atlas?  The
+/// material must use a single color map (the emissive, diffuse, and specular
+/// maps share the texture coordinates, so they would all need to be in the same
+/// place) and no normal map, and the group's texture coordinates must not go
+/// outside the image, since atlas textures cannot repeat.
+static bool canUseAtlas (OBJ::Material const &mat, OBJ::Group const &grp)
+{
+    constexpr float kEps = 1.0e-3f;
+
+    if (!mat.normalMap.empty() || (grp.txtCoords == nullptr)) {
+        return false;
+    }
+    std::string map;
+    for (auto const &m : { mat.emissiveMap, mat.diffuseMap, mat.specularMap }) {
+        if (m.empty()) {
+            continue;
+        } else if (map.empty()) {
+            map = m;
+        } else if (m != map) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0;  i < grp.nVerts;  ++i) {
+        glm::vec2 tc = grp.txtCoords[i];
+        if ((tc.x < -kEps) || (tc.x > 1.0f + kEps) || (tc.y < -kEps) || (tc.y > 1.0f + kEps)) {
+            return false;
+        }
+    }
+    return true;
+
+}
+
+/// bake the scene in `dir` into the bundle file `file`
+/// \param dir       the scene directory
+/// \param file      the bundle file
+/// \param compress  if true, then textures with 8-bit channels are block compressed
+/// \param useAtlas  if true, then small color textures are packed into atlases
+/// \return true if there was an error
+static bool bake (std::string const &dir, std::string const &file, bool compress, bool useAtlas)
+{
+    // read the scene description, which is copied into the bundle as is
+    std::string sceneFile = dir + "scene.json";
+    cs237::MappedFile text(sceneFile);
+    if (! text.isValid()) {
+        std::cerr << "proj5-bake: unable to read \"" << sceneFile << "\"\n";
+        return true;
+    }
+
+    // get the names of the model and ground files; the rest of the description
+    // is checked when the bundle is loaded
+    std::vector<std::string> modelFiles;
+    std::set<std::string> seen;
+    std::optional<BakeGround> ground;
+    std::string objFile;
+    auto readObj = [&] (json::Reader &r) {
+        if (! r.readObject ({{"file", objFile}})) {
+            return false;
+        }
+        if (seen.insert(objFile).second) {
+            modelFiles.push_back (objFile);
+        }
+        return true;
+    };
+    json::Reader rdr(text.data(), text.size(), sceneFile);
+    if (rdr.failed()
+    || ! rdr.readObject ({
+            {"objects", [&readObj] (json::Reader &r) { return r.readArray (readObj); }},
+            {"ground", ground}
+        })
+    || (rdr.next() != json::E_EOF)) {
+        std::cerr << "proj5-bake: invalid scene description in \"" << sceneFile << "\"\n";
+        return true;
+    }
+
+    BundleWriter w(file);
+    if (! w.isOpen()) {
+        std::cerr << "proj5-bake: unable to create \"" << file << "\"\n";
+        return true;
+    }
+
+    w.add (BundleKind::eScene, "scene.json", text.data(), text.size());
+
+    // the textures in the order that they are first used, with a flag that
+    // marks normal maps
+    std::vector<std::pair<std::string, bool>> textures;
+    seen.clear();
+    auto addTexture = [&] (std::string const &name, bool nMap) {
+        if (!name.empty() && seen.insert(name).second) {
+            textures.push_back ({name, nMap});
+        }
+    };
+
+    // the textures that cannot be packed into an atlas, because some group that
+    // uses them is incompatible with the atlas (see `canUseAtlas`)
+    std::set<std::string> noAtlas;
+
+    // the models are built the same way that proj5 builds them
+    OBJ::Model::setOptimizeMeshes (true);
+    OBJ::Model::setBuildLODs (true);
+    for (auto const &name : modelFiles) {
+        OBJ::Model model(dir + name);
+        std::string data;
+        if (! model.cacheData (data)) {
+            std::cerr << "proj5-bake: unable to read model \"" << name << "\"\n";
+            return true;
+        }
+        w.add (BundleKind::eModel, name, data.data(), data.size());
+        for (auto grp = model.beginGroups();  grp != model.endGroups();  ++grp) {
+            OBJ::Material const &mat = model.material(grp->material);
+            addTexture (mat.emissiveMap, false);
+            addTexture (mat.diffuseMap, false);
+            addTexture (mat.specularMap, false);
+            addTexture (mat.normalMap, true);
+            if (! canUseAtlas (mat, *grp)) {
+                noAtlas.insert (mat.emissiveMap);
+                noAtlas.insert (mat.diffuseMap);
+                noAtlas.insert (mat.specularMap);
+            }
+        }
+    }
+
+    if (ground.has_value()) {
+        addTexture (ground->cmap, false);
+        // the ground's texture coordinates are computed by the shaders
+        noAtlas.insert (ground->cmap);
+        addTexture (ground->nmap.value_or(""), true);
+        // the height field is not flipped (see `HeightField`)
+        cs237::Image2D hf(dir + ground->hf, false);
+        w.addImage (BundleKind::eHeightField, ground->hf, {&hf});
+    }
+
+    // the mipmap generator and the encoder process the rows of the images in parallel
+    cs237::JobSystem jobs;
+
+    // add a texture with its mipmap levels, which are truncated to `nLevels`
+    auto addTextureLevels = [&] (
+        std::string const &name,
+        cs237::Image2D const *img,
+        bool nMap,
+        uint32_t nLevels)
+    {
+        std::vector<cs237::Image2D *> mips = cs237::generateMipLevels (img, &jobs);
+        std::vector<cs237::Image2D const *> levels = { img };
+        levels.insert (levels.end(), mips.begin(), mips.end());
+        levels.resize (std::min(size_t(nLevels), levels.size()));
+        if (compress && (img->type() == cs237::ChannelTy::U8)) {
+            cs237::CompressedImage2D cImg(
+                nMap ? cs237::BlockFormat::BC5 : cs237::BlockFormat::BC7,
+                levels,
+                &jobs);
+            w.addCompressedImage (name, &cImg);
+        } else {
+            w.addImage (BundleKind::eTexture, name, levels);
+        }
+        for (auto lvl : mips) {
+            delete lvl;
+        }
+    };
+
+    // the atlas pages are sRGB encoded, since they only hold color maps
+    cs237::TextureAtlas::Options atlasOpts;
+    atlasOpts.pageSize = kAtlasPageSize;
+    cs237::TextureAtlas atlas(cs237::Channels::RGBA, cs237::ChannelTy::U8, true, atlasOpts);
+    std::vector<std::pair<std::string, cs237::Image2D *>> atlasImgs;
+
+    for (auto const &tex : textures) {
+        cs237::Image2D *img;
+        if (tex.second) {
+            img = new cs237::DataImage2D(dir + tex.first);
+        } else {
+            img = new cs237::Image2D(dir + tex.first);
+        }
+        if (useAtlas && !tex.second && (noAtlas.count(tex.first) == 0)
+        && (img->type() == cs237::ChannelTy::U8)
+        && (img->width() <= kMaxAtlasImageSize) && (img->height() <= kMaxAtlasImageSize)
+        && (atlas.add (img) >= 0)) {
+            // the image is kept until the atlas is built
+            atlasImgs.push_back ({tex.first, img});
+            continue;
+        }
+        addTextureLevels (tex.first, img, tex.second, std::numeric_limits<uint32_t>::max());
+        delete img;
+    }
+
+    if (! atlasImgs.empty()) {
+        atlas.build (&jobs);
+        for (uint32_t i = 0;  i < atlas.numPages();  ++i) {
+            // the images are only kept apart in the first few levels of a page
+            addTextureLevels (
+                kAtlasPagePrefix + std::to_string(i), atlas.page(i), false,
+                atlas.numMipLevels(i));
+        }
+        for (int id = 0;  id < int(atlasImgs.size());  ++id) {
+            auto const &e = atlas.entry(id);
+            w.addAtlasEntry (
+                atlasImgs[id].first, kAtlasPagePrefix + std::to_string(e.page), e.uvXform);
+            delete atlasImgs[id].second;
+        }
+        std::cout << "proj5-bake: packed " << atlasImgs.size() << " textures into "
+            << atlas.numPages() << " atlas pages (" << int(100.0 * atlas.occupancy())
+            << "% occupancy)\n";
+    }
+
+    if (! w.finish()) {
+        std::cerr << "proj5-bake: error writing \"" << file << "\"\n";
+        return true;
+    }
+
+    return false;
+
+}
+
+/***** benchmarking *****/
+
+/// load a scene and copy its asset data, which is the CPU work that is done before
+/// the data can be uploaded to the GPU
+/// \return the time in seconds or a negative value if there was an error
+static double loadScene (std::string const &path)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    Scene scene;
+    if (scene.load (path)) {
+        return -1.0;
+    }
+    std::vector<char> staging;
+    auto copy = [&staging] (const void *data, size_t sz) {
+        if (data != nullptr) {
+            staging.resize (std::max(staging.size(), sz));
+            std::memcpy (staging.data(), data, sz);
+        }
+    };
+    SceneAsset asset;
+    while (scene.isLoading()) {
+        if (! scene.nextAsset (asset)) {
+            std::this_thread::yield();
+            continue;
+        }
+        switch (asset.kind) {
+        case SceneAsset::Kind::eGroup:
+            {
+                OBJ::Group const &grp = scene.model(asset.model)->group(asset.group);
+                copy (grp.verts, grp.nVerts * sizeof(glm::vec3));
+                copy (grp.norms, grp.nVerts * sizeof(glm::vec3));
+                copy (grp.txtCoords, grp.nVerts * sizeof(glm::vec2));
+                copy (grp.indices, grp.nIndices * sizeof(uint32_t));
+            }
+            break;
+        case SceneAsset::Kind::eTexture:
+            {
+                SceneTexture const *tex = scene.textureByName(asset.name);
+                if (tex->cImg != nullptr) {
+                    for (uint32_t i = 0;  i < tex->cImg->nLevels();  i++) {
+                        copy (tex->cImg->levelData(i), tex->cImg->levelSize(i));
+                    }
+                } else {
+                    copy (tex->img->data(), tex->img->nBytes());
+                    for (auto lvl : tex->mips) {
+                        copy (lvl->data(), lvl->nBytes());
+                    }
+                }
+            }
+            break;
+        case SceneAsset::Kind::eGround:
+            break;
+        }
+    }
+
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+    return t.count();
+
+}
+
+int main (int argc, char *argv[])
+{
+    std::vector<std::string> args(argv, argv + argc);
+    bool bench = false;
+    bool compress = false;
+    bool useAtlas = false;
+    size_t i = 1;
+    for (;  (i < args.size()) && (args[i][0] == '-');  ++i) {
+        if (args[i] == "-bc") {
+            compress = true;
+        } else if (args[i] == "-atlas") {
+            useAtlas = true;
+        } else if (args[i] == "-bench") {
+            bench = true;
+        } else {
+            usage (EXIT_FAILURE);
+        }
+    }
+    if (i + 2 != args.size()) {
+        usage (EXIT_FAILURE);
+    }
+    std::string dir = args[i];
+    std::string file = args[i+1];
+    if (dir.back() != '/') {
+        dir += "/";
+    }
+
+    try {
+        if (bench) {
+            double dirT = loadScene (dir);
+            double bundleT = loadScene (file);
+            if ((dirT < 0.0) || (bundleT < 0.0)) {
+                return EXIT_FAILURE;
+            }
+            std::cout << "directory: " << 1000.0 * dirT << " ms\n"
+                << "bundle:    " << 1000.0 * bundleT << " ms\n";
+        }
+        else if (bake (dir, file, compress, useAtlas)) {
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,346 @@
+/*! \file bundle.cpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5
+ *
+ * \author John Reppy
+ *
+ * This file implements the reading and writing of scene bundles.
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "bundle.hpp"
+#include <cstring>
+
+static const char kMagic[8] = { 'P', '5', 'B', 'U', 'N', 'D', 'L', 'E' };
+static const uint32_t kVersion = 1;
+static const uint64_t kAlign = 16;
+
+/// the header of a bundle file
+struct BundleHeader {
+    char magic[8];              ///< the magic number
+    uint32_t version;           ///< the version of the format
+    uint32_t nEntries;          ///< the number of entries
+    uint64_t tableOffset;       ///< the offset of the entry table
+};
+
+// the number of bytes per pixel for an image in a bundle
+static size_t bytesPerPixel (cs237::Channels chans, cs237::ChannelTy ty)
+{
+    size_t nChans;
+    switch (chans) {
+    case cs237::Channels::R: nChans = 1; break;
+    case cs237::Channels::RG: nChans = 2; break;
+    case cs237::Channels::RGB:
+    case cs237::Channels::BGR: nChans = 3; break;
+    case cs237::Channels::RGBA:
+    case cs237::Channels::BGRA: nChans = 4; break;
+    default: return 0;
+    }
+    switch (ty) {
+    case cs237::ChannelTy::U8:
+    case cs237::ChannelTy::S8: return nChans;
+    case cs237::ChannelTy::U16:
+    case cs237::ChannelTy::S16: return 2 * nChans;
+    case cs237::ChannelTy::U32:
+    case cs237::ChannelTy::S32:
+    case cs237::ChannelTy::F32: return 4 * nChans;
+    default: return 0;
+    }
+}
+
+/***** class Bundle member functions *****/
+
+Bundle::Bundle (std::string const &path)
+  : _file(path), _valid(false)
+{
+    if (! this->_file.isValid() || (this->_file.size() < sizeof(BundleHeader))) {
+        return;
+    }
+    BundleHeader hdr;
+    std::memcpy (&hdr, this->_file.data(), sizeof(hdr));
+    if ((std::memcmp(hdr.magic, kMagic, 8) != 0) || (hdr.version != kVersion)) {
+        return;
+    }
+
+    // check the entry table; the mapping is page aligned, so the table is
+    // suitably aligned for direct access
+    size_t sz = this->_file.size();
+    if ((hdr.tableOffset % kAlign != 0)
+    || (hdr.tableOffset > sz)
+    || (uint64_t(hdr.nEntries) * sizeof(BundleEntry) > sz - hdr.tableOffset)) {
+        return;
+    }
+    auto entries = reinterpret_cast<BundleEntry const *>(this->_file.data() + hdr.tableOffset);
+    for (uint32_t i = 0;  i < hdr.nEntries;  i++) {
+        BundleEntry const *e = &entries[i];
+        if ((e->nameOffset > sz) || (e->nameLen > sz - e->nameOffset)
+        || (e->offset % kAlign != 0) || (e->offset > sz) || (e->size > sz - e->offset)) {
+            return;
+        }
+        std::string_view name(this->_file.data() + e->nameOffset, e->nameLen);
+        this->_entries.insert ({{e->kind, name}, e});
+    }
+
+    this->_valid = true;
+
+}
+
+bool Bundle::isBundle (std::string const &path)
+{
+    std::ifstream inS(path, std::ios::in | std::ios::binary);
+    char magic[8];
+    return inS.read(magic, 8) && (std::memcmp(magic, kMagic, 8) == 0);
+
+}
+
+BundleEntry const *Bundle::_find (BundleKind kind, std::string_view name) const
+{
+    auto it = this->_entries.find({kind, name});
+    if (it != this->_entries.end()) {
+        return it->second;
+    }
+    return nullptr;
+
+}
+
+std::string_view Bundle::sceneText () const
+{
+    BundleEntry const *e = this->_find (BundleKind::eScene, "scene.json");
+    if (e == nullptr) {
+        return std::string_view();
+    }
+    return std::string_view(this->_file.data() + e->offset, e->size);
+
+}
+
+OBJ::Model *Bundle::model (std::string const &name) const
+{
+    BundleEntry const *e = this->_find (BundleKind::eModel, name);
+    if (e == nullptr) {
+        return nullptr;
+    }
+    return new OBJ::Model (name, this->_file.data() + e->offset, e->size);
+
+}
+
+bool Bundle::images (
+    BundleKind kind,
+    std::string const &name,
+    std::vector<cs237::Image2D *> &levels) const
+{
+    BundleEntry const *e = this->_find (kind, name);
+    if ((e == nullptr) || (e->size < sizeof(BundleImage))) {
+        return false;
+    }
+    const char *base = this->_file.data() + e->offset;
+    BundleImage hdr;
+    std::memcpy (&hdr, base, sizeof(hdr));
+    auto chans = static_cast<cs237::Channels>(hdr.chans);
+    auto ty = static_cast<cs237::ChannelTy>(hdr.type);
+    size_t bpp = bytesPerPixel (chans, ty);
+    if ((bpp == 0) || (hdr.nLevels == 0) || (hdr.nLevels > 32)
+    || (sizeof(BundleImage) + hdr.nLevels * sizeof(uint64_t) > e->size)) {
+        return false;
+    }
+
+    // check the levels before creating any images
+    const uint64_t *offsets = reinterpret_cast<const uint64_t *>(base + sizeof(BundleImage));
+    uint32_t wid = hdr.wid, ht = hdr.ht;
+    for (uint32_t i = 0;  i < hdr.nLevels;  i++) {
+        uint64_t nBytes = uint64_t(wid) * uint64_t(ht) * bpp;
+        if ((offsets[i] % kAlign != 0) || (offsets[i] > e->size)
+        || (nBytes > e->size - offsets[i])) {
+            return false;
+        }
+        wid = std::max(wid >> 1, 1u);
+        ht = std::max(ht >> 1, 1u);
+    }
+
+    levels.clear();
+    levels.reserve(hdr.nLevels);
+    wid = hdr.wid;
+    ht = hdr.ht;
+    for (uint32_t i = 0;  i < hdr.nLevels;  i++) {
+        // the image does not write to its data, so it is safe to refer to the
+        // read-only mapping
+        levels.push_back (new cs237::Image2D (
+            wid, ht, chans, ty, hdr.sRGB != 0,
+            const_cast<char *>(base + offsets[i])));
+        wid = std::max(wid >> 1, 1u);
+        ht = std::max(ht >> 1, 1u);
+    }
+
+    return true;
+
+}
+
+cs237::CompressedImage2D *Bundle::compressedImage (std::string const &name) const
+{
+    BundleEntry const *e = this->_find (BundleKind::eCompressedTexture, name);
+    if (e == nullptr) {
+        return nullptr;
+    }
+    return new cs237::CompressedImage2D (this->_file.data() + e->offset, e->size, name);
+
+}
+
+bool Bundle::atlasEntry (std::string const &name, std::string &page, glm::vec4 &uvXform) const
+{
+    BundleEntry const *e = this->_find (BundleKind::eAtlasEntry, name);
+    if ((e == nullptr) || (e->size < sizeof(BundleAtlasEntry))) {
+        return false;
+    }
+    const char *base = this->_file.data() + e->offset;
+    BundleAtlasEntry hdr;
+    std::memcpy (&hdr, base, sizeof(hdr));
+    if (hdr.pageLen > e->size - sizeof(BundleAtlasEntry)) {
+        return false;
+    }
+    page.assign (base + sizeof(BundleAtlasEntry), hdr.pageLen);
+    uvXform = glm::vec4(hdr.uvXform[0], hdr.uvXform[1], hdr.uvXform[2], hdr.uvXform[3]);
+    return true;
+
+}
+
+/***** class BundleWriter member functions *****/
+
+BundleWriter::BundleWriter (std::string const &path)
+  : _outS(path, std::ios::out | std::ios::binary | std::ios::trunc)
+{
+    if (this->_outS.is_open()) {
+        // write a placeholder header, which is filled in by `finish`
+        BundleHeader hdr{};
+        this->_outS.write (reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    }
+}
+
+uint64_t BundleWriter::_align ()
+{
+    static const char zeros[kAlign] = { 0 };
+    uint64_t pos = this->_outS.tellp();
+    uint64_t pad = (kAlign - pos % kAlign) % kAlign;
+    this->_outS.write (zeros, pad);
+    return pos + pad;
+
+}
+
+void BundleWriter::add (BundleKind kind, std::string const &name, const void *data, size_t sz)
+{
+    BundleEntry e;
+    e.kind = kind;
+    e.nameLen = name.size();
+    e.nameOffset = 0;
+    e.offset = this->_align();
+    e.size = sz;
+    this->_outS.write (static_cast<const char *>(data), sz);
+    this->_entries.push_back (e);
+    this->_names.push_back (name);
+
+}
+
+void BundleWriter::addImage (
+    BundleKind kind,
+    std::string const &name,
+    std::vector<cs237::Image2D const *> const &levels)
+{
+    assert (!levels.empty() && "image without levels");
+
+    BundleImage hdr;
+    hdr.wid = levels[0]->width();
+    hdr.ht = levels[0]->height();
+    hdr.chans = static_cast<uint32_t>(levels[0]->channels());
+    hdr.type = static_cast<uint32_t>(levels[0]->type());
+    hdr.sRGB = levels[0]->isSRGB() ? 1 : 0;
+    hdr.nLevels = levels.size();
+
+    // the level offsets are relative to the start of the entry
+    std::vector<uint64_t> offsets(levels.size());
+    uint64_t offset = sizeof(BundleImage) + levels.size() * sizeof(uint64_t);
+    for (size_t i = 0;  i < levels.size();  i++) {
+        offset = (offset + kAlign - 1) & ~(kAlign - 1);
+        offsets[i] = offset;
+        offset += levels[i]->nBytes();
+    }
+
+    BundleEntry e;
+    e.kind = kind;
+    e.nameLen = name.size();
+    e.nameOffset = 0;
+    e.offset = this->_align();
+    e.size = offset;
+    this->_outS.write (reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    this->_outS.write (
+        reinterpret_cast<const char *>(offsets.data()),
+        offsets.size() * sizeof(uint64_t));
+    for (size_t i = 0;  i < levels.size();  i++) {
+        this->_align();
+        this->_outS.write (static_cast<const char *>(levels[i]->data()), levels[i]->nBytes());
+    }
+    this->_entries.push_back (e);
+    this->_names.push_back (name);
+
+}
+
+void BundleWriter::addCompressedImage (
+    std::string const &name,
+    cs237::CompressedImage2D const *img)
+{
+    BundleEntry e;
+    e.kind = BundleKind::eCompressedTexture;
+    e.nameLen = name.size();
+    e.nameOffset = 0;
+    e.offset = this->_align();
+    img->write (this->_outS);
+    e.size = uint64_t(this->_outS.tellp()) - e.offset;
+    this->_entries.push_back (e);
+    this->_names.push_back (name);
+
+}
+
+void BundleWriter::addAtlasEntry (
+    std::string const &name,
+    std::string const &page,
+    glm::vec4 uvXform)
+{
+    BundleAtlasEntry hdr;
+    hdr.uvXform[0] = uvXform.x;
+    hdr.uvXform[1] = uvXform.y;
+    hdr.uvXform[2] = uvXform.z;
+    hdr.uvXform[3] = uvXform.w;
+    hdr.pageLen = page.size();
+    std::string data(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    data += page;
+    this->add (BundleKind::eAtlasEntry, name, data.data(), data.size());
+
+}
+
+bool BundleWriter::finish ()
+{
+    // write the names
+    for (size_t i = 0;  i < this->_entries.size();  i++) {
+        this->_entries[i].nameOffset = this->_outS.tellp();
+        this->_outS.write (this->_names[i].data(), this->_names[i].size());
+    }
+
+    // write the entry table
+    BundleHeader hdr;
+    std::memcpy (hdr.magic, kMagic, 8);
+    hdr.version = kVersion;
+    hdr.nEntries = this->_entries.size();
+    hdr.tableOffset = this->_align();
+    this->_outS.write (
+        reinterpret_cast<const char *>(this->_entries.data()),
+        this->_entries.size() * sizeof(BundleEntry));
+
+    // fill in the header
+    this->_outS.seekp (0);
+    this->_outS.write (reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+
+    this->_outS.close();
+    return !this->_outS.fail();
+
+}
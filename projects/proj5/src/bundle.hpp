@@ -0,0 +1,188 @@
+/*! \file bundle.hpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5
+ *
+ * \author John Reppy
+ *
+ * This file defines scene bundles, which hold all of the data for a scene in
+ * a single file that is used directly from memory (see `bake.cpp` for the tool
+ * that builds bundles).  A bundle has the following layout:
+ *
+ *      header          magic number, version, number of entries, and the
+ *                      offset of the entry table
+ *      entry data      the data for each entry; each entry starts at a
+ *                      16-byte boundary
+ *      names           the entry names
+ *      entry table     the kind, name, offset, and size of each entry
+ *
+ * There are six kinds of entries: the scene description (i.e., the contents of
+ * the `scene.json` file), models (in the format of the OBJ cache files), texture
+ * images with their pre-built mipmap levels, block-compressed textures (in the
+ * format of DDS files), height fields, and texture-atlas entries.  An atlas
+ * entry redirects a texture that was packed into a texture atlas to the atlas
+ * page (which is itself a texture entry) and records the transform from the
+ * texture's coordinates to the page's coordinates.
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _BUNDLE_HPP_
+#define _BUNDLE_HPP_
+
+#include "cs237/cs237.hpp"
+#include "obj.hpp"
+#include <fstream>
+#include <map>
+#include <string_view>
+
+/// the kinds of entries in a bundle
+enum class BundleKind : uint32_t {
+    eScene = 1,         ///< the scene description
+    eModel,             ///< an OBJ model
+    eTexture,           ///< a texture image with its mipmap levels
+    eHeightField,       ///< a height-field image
+    eCompressedTexture, ///< a block-compressed texture with its mipmap levels
+    eAtlasEntry         ///< the location of a texture in a texture atlas
+};
+
+/// an entry in the table of a bundle
+struct BundleEntry {
+    BundleKind kind;    ///< the kind of entry
+    uint32_t nameLen;   ///< the length of the entry's name
+    uint64_t nameOffset; ///< the offset of the entry's name in the file
+    uint64_t offset;    ///< the offset of the entry's data in the file
+    uint64_t size;      ///< the size of the entry's data in bytes
+};
+
+/// the header of an image entry, which is followed by the offsets of the
+/// image's levels (level 0 is the image itself)
+struct BundleImage {
+    uint32_t wid;       ///< the width of level 0
+    uint32_t ht;        ///< the height of level 0
+    uint32_t chans;     ///< the image's `cs237::Channels`
+    uint32_t type;      ///< the image's `cs237::ChannelTy`
+    uint32_t sRGB;      ///< non-zero for sRGB-encoded images
+    uint32_t nLevels;   ///< the number of levels
+};
+
+/// the data of an atlas entry, which is followed by the name of the atlas page
+struct BundleAtlasEntry {
+    float uvXform[4];   ///< maps the texture's coordinates to the page: uv * xy + zw
+    uint32_t pageLen;   ///< the length of the page's name
+};
+
+/// A scene bundle that has been mapped into memory.  The models and images that
+/// are created from a bundle refer directly to the mapped data, so the bundle
+/// must outlive them.
+class Bundle {
+  public:
+
+    /// map a bundle file into memory
+    /// \param path  the path to the bundle file
+    explicit Bundle (std::string const &path);
+
+    /// is the file a valid bundle?
+    bool isValid () const { return this->_valid; }
+
+    /// does the file at `path` start with the bundle magic number?
+    static bool isBundle (std::string const &path);
+
+    /// get the scene description
+    std::string_view sceneText () const;
+
+    /// create a model from a model entry
+    /// \param name  the name of the model's OBJ file in the scene description
+    /// \return the model or nullptr if there is no such entry
+    OBJ::Model *model (std::string const &name) const;
+
+    /// create images that refer to the levels of an image entry
+    /// \param kind   the kind of entry (`eTexture` or `eHeightField`)
+    /// \param name   the name of the image file in the scene description
+    /// \param[out] levels  set to the levels of the image
+    /// \return false if there is no such entry or if it is invalid
+    bool images (
+        BundleKind kind,
+        std::string const &name,
+        std::vector<cs237::Image2D *> &levels) const;
+
+    /// create a compressed image that refers to a compressed-texture entry
+    /// \param name  the name of the image file in the scene description
+    /// \return the image or nullptr if there is no such entry
+    cs237::CompressedImage2D *compressedImage (std::string const &name) const;
+
+    /// get the location of a texture that was packed into a texture atlas
+    /// \param name          the name of the image file in the scene description
+    /// \param[out] page     set to the name of the atlas page that holds the texture
+    /// \param[out] uvXform  set to the transform from the texture's coordinates
+    ///                      to the page's coordinates (uv * xy + zw)
+    /// \return false if the texture is not in an atlas
+    bool atlasEntry (std::string const &name, std::string &page, glm::vec4 &uvXform) const;
+
+  private:
+    cs237::MappedFile _file;    ///< the mapped bundle file
+    bool _valid;                ///< true if the file is a valid bundle
+    std::map<std::pair<BundleKind, std::string_view>, BundleEntry const *> _entries;
+                                ///< the entries keyed by kind and name
+
+    /// find an entry in the table
+    BundleEntry const *_find (BundleKind kind, std::string_view name) const;
+
+};
+
+/// A helper class for writing a bundle file
+class BundleWriter {
+  public:
+
+    /// open a bundle file for writing
+    /// \param path  the path to the bundle file
+    explicit BundleWriter (std::string const &path);
+
+    /// was the file opened successfully?
+    bool isOpen () const { return this->_outS.is_open(); }
+
+    /// add an entry to the bundle
+    /// \param kind  the kind of entry
+    /// \param name  the name of the entry
+    /// \param data  the entry's data
+    /// \param sz    the size of the data in bytes
+    void add (BundleKind kind, std::string const &name, const void *data, size_t sz);
+
+    /// add an image entry to the bundle
+    /// \param kind    the kind of entry (`eTexture` or `eHeightField`)
+    /// \param name    the name of the entry
+    /// \param levels  the levels of the image, which must all have the same format
+    void addImage (
+        BundleKind kind,
+        std::string const &name,
+        std::vector<cs237::Image2D const *> const &levels);
+
+    /// add a compressed-texture entry to the bundle
+    /// \param name  the name of the entry
+    /// \param img   the compressed image with its mipmap levels
+    void addCompressedImage (std::string const &name, cs237::CompressedImage2D const *img);
+
+    /// add an atlas entry to the bundle
+    /// \param name     the name of the texture that was packed into the atlas
+    /// \param page     the name of the texture entry for the atlas page
+    /// \param uvXform  the transform from the texture's coordinates to the page's
+    ///                 coordinates (uv * xy + zw)
+    void addAtlasEntry (std::string const &name, std::string const &page, glm::vec4 uvXform);
+
+    /// write the entry table and close the file
+    /// \return false if there was an error writing the file
+    bool finish ();
+
+  private:
+    std::ofstream _outS;                        ///< the output file
+    std::vector<BundleEntry> _entries;          ///< the entries written so far
+    std::vector<std::string> _names;            ///< the names of the entries
+
+    /// pad the file to the next 16-byte boundary and return the offset
+    uint64_t _align ();
+
+};
+
+#endif /* !_BUNDLE_HPP_ */
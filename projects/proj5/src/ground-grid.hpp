@@ -0,0 +1,99 @@
+/*! \file ground-grid.hpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5
+ *
+ * This file defines the helpers for computing the vertices of the ground from
+ * the elevations of a height field, which are shared by the ground mesh (see
+ * ground.cpp) and the streamed terrain tiles (see terrain-stream.cpp).
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _GROUND_GRID_HPP_
+#define _GROUND_GRID_HPP_
+
+#include "cs237/cs237.hpp"
+#include "vertex.hpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__SSE2__)
+/// convert four 32-bit integer samples to scaled elevations
+inline void storeHeights (float *dst, __m128i v, __m128 scale)
+{
+    _mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+}
+#endif
+
+/// convert a row of height-field samples to elevations.  The sample type is a
+/// template parameter, so the conversion is specialized for U8 and U16 images.
+template <typename T>
+inline void loadHeights (const T *src, uint32_t n, float scale, float *dst)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    __m128 s = _mm_set1_ps(scale);
+    __m128i zero = _mm_setzero_si128();
+    if constexpr (sizeof(T) == 1) {
+        for (;  i + 16 <= n;  i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            storeHeights (dst + i, _mm_unpacklo_epi16(lo, zero), s);
+            storeHeights (dst + i + 4, _mm_unpackhi_epi16(lo, zero), s);
+            storeHeights (dst + i + 8, _mm_unpacklo_epi16(hi, zero), s);
+            storeHeights (dst + i + 12, _mm_unpackhi_epi16(hi, zero), s);
+        }
+    } else {
+        for (;  i + 8 <= n;  i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            storeHeights (dst + i, _mm_unpacklo_epi16(v, zero), s);
+            storeHeights (dst + i + 4, _mm_unpackhi_epi16(v, zero), s);
+        }
+    }
+#endif
+    for (;  i < n;  ++i) {
+        dst[i] = scale * float(src[i]);
+    }
+}
+
+/// the grid of elevations that the vertices are computed from, which is either
+/// the whole height field or a window of it
+struct GroundGrid {
+    const float *heights;       ///< the elevations in row-major order
+    uint32_t nRows, nCols;      ///< the size of the grid
+    glm::vec2 origin;           ///< the XZ position of the first sample
+    glm::vec2 cellSize;         ///< the XZ distance between samples
+    uint32_t row0, col0;        ///< the position of the grid in the height field
+    uint32_t hfRows, hfCols;    ///< the size of the height field, which determines
+                                ///  the texture coordinates
+};
+
+/// per-job scratch space for computing the vertices of a row in
+/// structure-of-arrays form
+struct RowScratch {
+    std::vector<float> nx, ny, nz;      ///< the normals
+    std::vector<float> tx, ty, tz;      ///< the tangents
+
+    explicit RowScratch (uint32_t n)
+      : nx(n), ny(n), nz(n), tx(n), ty(n), tz(n)
+    { }
+};
+
+/// compute the vertices of a row of the grid.  The normals of the first and
+/// last rows and columns use one-sided differences, so the grid should include
+/// the neighbors of the samples whose normals must match those of the whole
+/// height field.
+/// \param g    the grid
+/// \param r    the row of the grid
+/// \param tmp  scratch space for at least `g.nCols` samples
+/// \param dst  the destination for the `g.nCols` vertices of the row
+void groundRow (GroundGrid const &g, uint32_t r, RowScratch &tmp, Vertex *dst);
+
+#endif // !_GROUND_GRID_HPP_
@@ -13,85 +13,99 @@
 
 #include "app.hpp"
 #include "cs237/cs237.hpp"
+#include "ground-grid.hpp"
 #include "mesh.hpp"
+#include "terrain.hpp"
 
-// helper function that computes the normal for a triangle; vertices should be in CCW order
-//
-inline glm::vec3 triNormal (glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+// the number of height-field samples that are processed by a single job
+constexpr size_t kGroundSamplesPerJob = 64 * 1024;
+
+// run `fn` on blocks of rows [r, endR); the blocks are run in parallel using
+// the job system when it is available and the grid is large enough
+template <typename F>
+static void forEachRowBlock (uint32_t wid, uint32_t ht, cs237::JobSystem *jobs, F fn)
 {
-    return glm::normalize(glm::cross(v1 - v0, v2 - v0));
+    uint32_t rowsPerJob = std::max(uint32_t(kGroundSamplesPerJob / std::max(wid, 1u)), 1u);
+    if ((jobs == nullptr) || (ht <= rowsPerJob)) {
+        fn (0, ht);
+        return;
+    }
+    std::vector<cs237::Job *> pending;
+    for (uint32_t r = 0;  r < ht;  r += rowsPerJob) {
+        uint32_t endR = std::min(r + rowsPerJob, ht);
+        pending.push_back (jobs->spawn ([&fn, r, endR] () { fn (r, endR); }));
+    }
+    for (auto job : pending) {
+        jobs->wait (job);
+    }
 }
 
-Mesh::Mesh (Proj5 *app, HeightField const *hf)
-: device(app->device()),
-  vBuf(nullptr), iBuf(nullptr), prim(vk::PrimitiveTopology::eTriangleList), aabb(),
-  albedoSrc(MtlPropertySrc::eNone), albedoTexture(),
-  emissiveSrc(MtlPropertySrc::eNone), emissiveTexture(),
-  specularSrc(MtlPropertySrc::eNone), specularTexture(),
-  nMap()
+// compute the vertices of row `r` of the height field.
+//
+// The normal at a sample is computed from the central differences of the
+// elevations (one-sided differences at the borders), which is the area-weighted
+// average of the normals of the four triangles formed with the sample's axis
+// neighbors.  Writing the slopes as a = -dh/dx and b = -dh/dz, the normal is
+// (a, 1, b) and the Gram-Schmidt orthogonalization of the X axis against the
+// normal is (1 + b^2, -a, -ab).  Since the normal always points up, the
+// bitangent is the negative Z axis and the sign of the tangent is -1.
+void groundRow (GroundGrid const &g, uint32_t r, RowScratch &tmp, Vertex *dst)
 {
-    uint32_t nr = hf->numRows();
-    uint32_t nc = hf->numCols();
-    uint32_t nVerts = hf->numVerts();
-    assert ((nr >= 2) && (nc >= 2));
-    uint32_t nTris = hf->numTris();
-
-    // since we are not using triangle strips, the number of indices will be 3*nTris
-    Vertex *verts = new Vertex[nVerts];
-    uint32_t *indices = new uint32_t[3*nTris];
-
-    /***** vertex positions *****/
-
-    for (int r = 0;  r < nr;  r++) {
-	for (int c = 0;  c < nc;  c++) {
-            auto pos = hf->posAt(r, c);
-	    verts[hf->indexOf(r, c)].pos = pos;
-            this->aabb.addPt(pos);
-	}
-    }
+    uint32_t nc = g.nCols;
+    uint32_t rU = (r > 0) ? r - 1 : r;
+    uint32_t rD = (r + 1 < g.nRows) ? r + 1 : r;
+    const float *hU = g.heights + size_t(rU) * nc;
+    const float *h = g.heights + size_t(r) * nc;
+    const float *hD = g.heights + size_t(rD) * nc;
+    float dzScale = 1.0f / (float(rD - rU) * g.cellSize.y);
+    float dxScale = 1.0f / (2.0f * g.cellSize.x);
 
-    /***** vertex normals *****/
-
-    // first compute the normals for the corner vertices of the height field
-    verts[hf->indexOf(0,    0)].norm =
-	triNormal(hf->posAt(0,0), hf->posAt(1,0), hf->posAt(0,1));
-    verts[hf->indexOf(0,    nc-1)].norm =
-	triNormal(hf->posAt(0,nc-1), hf->posAt(0,nc-2), hf->posAt(1,nc-1));
-    verts[hf->indexOf(nr-1, 0)].norm =
-	triNormal(hf->posAt(nr-1,0), hf->posAt(nr-1,1), hf->posAt(nr-2,1));
-    verts[hf->indexOf(nr-1, nc-1)].norm =
-	triNormal(hf->posAt(nr-1,nc-1), hf->posAt(nr-2,nc-1), hf->posAt(nr-1,nc-2));
-    // then compute the normals for the edge vertices of the height field
-    for (int r = 1;  r < nr-1;  r++) {
-	verts[hf->indexOf(r, 0)].norm = 0.5f * (
-	    triNormal(hf->posAt(r, 0), hf->posAt(r, 1), hf->posAt(r-1, 0)) +
-	    triNormal(hf->posAt(r, 0), hf->posAt(r+1, 0), hf->posAt(r, 1)));
-	verts[hf->indexOf(r, nc-1)].norm = 0.5f * (
-	    triNormal(hf->posAt(r, nc-1), hf->posAt(r-1, nc-1), hf->posAt(r, nc-2)) +
-	    triNormal(hf->posAt(r, nc-1), hf->posAt(r, nc-2), hf->posAt(r+1, nc-1)));
-    }
-    for (int c = 1;  c < nc-1;  c++) {
-	verts[hf->indexOf(0,    c)].norm = 0.5f * (
-	    triNormal(hf->posAt(0, c), hf->posAt(0, c-1), hf->posAt(1, c)) +
-	    triNormal(hf->posAt(0, c), hf->posAt(1, c), hf->posAt(0, c+1)));
-	verts[hf->indexOf(nr-1, c)].norm = 0.5f * (
-	    triNormal(hf->posAt(nr-1, c), hf->posAt(nr-2, c), hf->posAt(nr-1, c-1)) +
-	    triNormal(hf->posAt(nr-1, c), hf->posAt(nr-1, c+1), hf->posAt(nr-2, c)));
+    // the slopes and the normal and tangent vectors of the samples
+    auto sample = [&] (uint32_t c, float a, float b) {
+        float nLen = 1.0f / std::sqrt(1.0f + a*a + b*b);
+        tmp.nx[c] = a * nLen;
+        tmp.ny[c] = nLen;
+        tmp.nz[c] = b * nLen;
+        float tx = 1.0f + b*b, ty = -a, tz = -a*b;
+        float tLen = 1.0f / std::sqrt(tx*tx + ty*ty + tz*tz);
+        tmp.tx[c] = tx * tLen;
+        tmp.ty[c] = ty * tLen;
+        tmp.tz[c] = tz * tLen;
+    };
+    // the first and last columns use one-sided differences
+    sample (0, (h[0] - h[1]) / g.cellSize.x, (hU[0] - hD[0]) * dzScale);
+    sample (nc-1, (h[nc-2] - h[nc-1]) / g.cellSize.x, (hU[nc-1] - hD[nc-1]) * dzScale);
+    uint32_t c = 1;
+#if defined(__SSE2__)
+    {
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 xs = _mm_set1_ps(dxScale);
+        __m128 zs = _mm_set1_ps(dzScale);
+        for (;  c + 4 < nc;  c += 4) {
+            __m128 a = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(h + c - 1), _mm_loadu_ps(h + c + 1)), xs);
+            __m128 b = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(hU + c), _mm_loadu_ps(hD + c)), zs);
+            __m128 aa = _mm_mul_ps(a, a);
+            __m128 bb = _mm_mul_ps(b, b);
+            __m128 nLen = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(one, _mm_add_ps(aa, bb))));
+            _mm_storeu_ps(&tmp.nx[c], _mm_mul_ps(a, nLen));
+            _mm_storeu_ps(&tmp.ny[c], nLen);
+            _mm_storeu_ps(&tmp.nz[c], _mm_mul_ps(b, nLen));
+            // |(1 + b^2, -a, -ab)|^2 = (1 + b^2)^2 + a^2 (1 + b^2)
+            __m128 tx = _mm_add_ps(one, bb);
+            __m128 tLen = _mm_div_ps(one, _mm_sqrt_ps(_mm_mul_ps(tx, _mm_add_ps(tx, aa))));
+            _mm_storeu_ps(&tmp.tx[c], _mm_mul_ps(tx, tLen));
+            _mm_storeu_ps(&tmp.ty[c], _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), a), tLen));
+            _mm_storeu_ps(&tmp.tz[c], _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(a, b)), tLen));
+        }
     }
-    // finally compute the normals for the interior vertices
-    for (int r = 1;  r < nr-1;  r++) {
-	for (int c = 1;  c < nc-1;  c++) {
-	    verts[hf->indexOf(r, c)].norm = 0.25f * (
-		triNormal(hf->posAt(r,c), hf->posAt(r-1,c), hf->posAt(r,c-1)) +
-		triNormal(hf->posAt(r,c), hf->posAt(r,c+1), hf->posAt(r-1,c)) +
-		triNormal(hf->posAt(r,c), hf->posAt(r+1,c), hf->posAt(r,c+1)) +
-		triNormal(hf->posAt(r,c), hf->posAt(r,c-1), hf->posAt(r+1,c)));
-	}
+#endif
+    for (;  c + 1 < nc;  ++c) {
+        sample (c, (h[c-1] - h[c+1]) * dxScale, (hU[c] - hD[c]) * dzScale);
     }
 
-    /***** texture coordinates *****/
-
-    // we want the following mapping for the height-field corners:
+    // assemble the vertices.  The texture coordinates are relative to the
+    // whole height field; we want the following mapping from its corners to
+    // texture coordinates:
     //	(row,  col)		(x, y)
     //   --------------------------------
     //	(0,    0)		(0, 1)
@@ -99,77 +113,159 @@ Mesh::Mesh (Proj5 *app, HeightField const *hf)
     //	(nr-1, 0)		(0, 0)
     //	(nr-1, nc-1)		(1, 0)
     //
-    for (int r = 0;  r < nr;  r++) {
-	float y = float(nr - r - 1) / float(nr-1);
-	for (int c = 0;  c < nc;  c++) {
-	    float x = float(c) / float(nc-1);
-	    verts[hf->indexOf(r,c)].txtCoord = glm::vec2(x, y);
-	}
+    float z = g.origin.y + float(r) * g.cellSize.y;
+    float tcY = float(g.hfRows - (g.row0 + r) - 1) / float(g.hfRows - 1);
+    float tcXScale = 1.0f / float(g.hfCols - 1);
+    for (c = 0;  c < nc;  ++c) {
+        Vertex &v = dst[c];
+        v.pos = glm::vec3(g.origin.x + float(c) * g.cellSize.x, h[c], z);
+        v.norm = glm::vec3(tmp.nx[c], tmp.ny[c], tmp.nz[c]);
+        v.txtCoord = glm::vec2(float(g.col0 + c) * tcXScale, tcY);
+        v.tan = glm::vec4(tmp.tx[c], tmp.ty[c], tmp.tz[c], -1.0f);
     }
+}
 
-    /***** tangent vectors *****/
-
-    // compute the extended tangent vectors for normal-mapping mode
-    for (int r = 0;  r < nr;  r++) {
-	for (int c = 0;  c < nc;  c++) {
-	    int idx = hf->indexOf(r, c);
-	    glm::vec3 T(1.0f, 0.0f, 0.0f);
-	    glm::vec3 B(0.0f, 0.0f, 1.0f);
-	    glm::vec3 N = verts[idx].norm;
-	    // orthogonalize using Gram-Schmidt
-	    T = normalize (T - dot(T, N) * N);
-	    B = normalize (B - dot(B, N) * N - dot(B, T) * T);
-	    float Tw = dot(B, cross(N, T));
-	    verts[idx].tan = glm::vec4(T[0], T[1], T[2], (Tw < 0.0f) ? -1 : 1);
-	}
+void Mesh::_initGround (Proj5 *app, HeightField const *hf)
+{
+    uint32_t nr = hf->numRows();
+    uint32_t nc = hf->numCols();
+    assert ((nr >= 2) && (nc >= 2));
+
+    // large height fields are processed in parallel blocks of rows
+    cs237::JobSystem *jobs = (size_t(nr) * nc > kGroundSamplesPerJob)
+        ? new cs237::JobSystem
+        : nullptr;
+
+    /***** elevations *****/
+
+    // convert the samples to elevations once up front, since each of them is
+    // used by several vertices and by the chunk bounds
+    std::vector<float> heights(size_t(nr) * nc);
+    {
+        const void *samples = hf->image()->data();
+        bool isU8 = (hf->image()->type() == cs237::ChannelTy::U8);
+        float scale = hf->vScale();
+        forEachRowBlock (nc, nr, jobs, [&] (uint32_t r0, uint32_t r1) {
+            for (uint32_t r = r0;  r < r1;  ++r) {
+                size_t offset = size_t(r) * nc;
+                if (isU8) {
+                    loadHeights (static_cast<const uint8_t *>(samples) + offset, nc, scale,
+                        &heights[offset]);
+                } else {
+                    loadHeights (static_cast<const uint16_t *>(samples) + offset, nc, scale,
+                        &heights[offset]);
+                }
+            }
+        });
     }
 
+    GroundGrid grid;
+    grid.heights = heights.data();
+    grid.nRows = nr;
+    grid.nCols = nc;
+    grid.origin = glm::vec2(-0.5f * hf->width(), -0.5f * hf->height());
+    grid.cellSize = glm::vec2(hf->width() / float(nc - 1), hf->height() / float(nr - 1));
+    grid.row0 = 0;
+    grid.col0 = 0;
+    grid.hfRows = nr;
+    grid.hfCols = nc;
+
+    /***** chunks *****/
+
+    // the mesh is drawn as chunks (see terrain.hpp), whose vertex grid is the
+    // height field padded by repeating its last row and column
+    this->terrain = new Terrain(nr, nc, grid.origin, grid.cellSize, heights.data());
+    uint32_t gridRows = this->terrain->gridRows();
+    uint32_t gridCols = this->terrain->gridCols();
+
+    /***** vertices *****/
+
+    // each block of rows computes its vertices into a row buffer and then
+    // writes them directly into the vertex buffer; the padding vertices are
+    // copies of the last row or column
+    auto buildRows = [&] (auto &dst, auto const &encode) {
+        forEachRowBlock (gridCols, gridRows, jobs, [&] (uint32_t r0, uint32_t r1) {
+            RowScratch tmp(nc);
+            std::vector<Vertex> row(nc);
+            uint32_t rowR = ~0u;
+            for (uint32_t r = r0;  r < r1;  ++r) {
+                uint32_t hfR = std::min(r, nr - 1);
+                if (hfR != rowR) {
+                    groundRow (grid, hfR, tmp, row.data());
+                    rowR = hfR;
+                }
+                auto *out = dst.data() + size_t(r) * gridCols;
+                for (uint32_t c = 0;  c < gridCols;  ++c) {
+                    out[c] = encode(row[std::min(c, nc - 1)]);
+                }
+            }
+        });
+    };
+    if (this->isCompact()) {
+        // quantize the vertices relative to the bounds of the mesh
+        this->decode = VertexDecode(
+            this->aabb.min(), this->aabb.max(), glm::vec2(0.0f), glm::vec2(1.0f));
+        this->cvBuf = new cs237::VertexBuffer<CompactVertex>(app, this->terrain->numVerts());
+        auto dst = this->cvBuf->map();
+        buildRows (dst, [this] (Vertex const &v) { return CompactVertex(v, this->decode); });
+    } else {
+        this->vBuf = new cs237::VertexBuffer<Vertex>(app, this->terrain->numVerts());
+        auto dst = this->vBuf->map();
+        buildRows (dst, [] (Vertex const &v) { return v; });
+    }
+
+    delete jobs;
+
     /***** indices *****/
 
-    int idx = 0;
-    for (int r = 1;  r < nr;  r++) {
-	for (int c = 1;  c < nc;  c++) {
-	    if ((c & 1) == (r & 1)) {
-	      // triangulate from upper left to lower right
-		indices[idx + 0] = hf->indexOf(r,   c-1);
-		indices[idx + 1] = hf->indexOf(r,   c  );
-		indices[idx + 2] = hf->indexOf(r-1, c-1);
-		indices[idx + 3] = hf->indexOf(r-1, c  );
-		indices[idx + 4] = hf->indexOf(r-1, c-1);
-		indices[idx + 5] = hf->indexOf(r,   c  );
-	    }
-	    else {
-	      // triangulate from lower left to upper right
-		indices[idx + 0] = hf->indexOf(r,   c  );
-		indices[idx + 1] = hf->indexOf(r-1, c  );
-		indices[idx + 2] = hf->indexOf(r,   c-1);
-		indices[idx + 3] = hf->indexOf(r-1, c-1);
-		indices[idx + 4] = hf->indexOf(r,   c-1);
-		indices[idx + 5] = hf->indexOf(r-1, c  );
-	    }
-	    idx += 6;
-	}
+    // the index patterns of the chunks are written directly into the index
+    // buffer; since the mesh is drawn by chunks, the single level of detail is
+    // just the pattern of a full-resolution chunk
+    this->iBuf = new cs237::IndexBuffer<uint32_t>(app, this->terrain->numIndices());
+    {
+        auto dst = this->iBuf->map();
+        this->terrain->indices (dst.data());
     }
+    this->lods.push_back(cs237::mesh::LOD{ 0, 6 * kChunkQuads * kChunkQuads, 0.0f });
 
-    // create the Vulkan buffer objects
-    this->vBuf = new cs237::VertexBuffer<Vertex>(
-        app,
-        vk::ArrayProxy<Vertex>(nVerts, verts));
-    this->iBuf = new cs237::IndexBuffer<uint32_t>(
-        app,
-        vk::ArrayProxy<uint32_t>(3*nTris, indices));
+}
 
-    // free the temporary arrays
-    delete[] verts;
-    delete[] indices;
+Mesh::Mesh (Proj5 *app, HeightField const *hf, VertexFormat fmt)
+: device(app->device()),
+  vFormat(fmt), vBuf(nullptr), cvBuf(nullptr), iBuf(nullptr),
+  meshletBuf(nullptr), nMeshlets(0), terrain(nullptr), streamer(nullptr),
+  prim(vk::PrimitiveTopology::eTriangleList), aabb(hf->bbox()),
+  albedoSrc(MtlPropertySrc::eNone), albedoTexture(), albedoVT(nullptr),
+  emissiveSrc(MtlPropertySrc::eNone), emissiveTexture(),
+  specularSrc(MtlPropertySrc::eNone), specularTexture(),
+  nMap(), mtl(nullptr)
+{
+    if (hf->tiles() != nullptr) {
+        // the tiles of the mesh are streamed in around the camera
+        assert (this->isCompact());
+        this->streamer = new TerrainStreamer(app, hf);
+    } else {
+        this->_initGround (app, hf);
+    }
 
     this->albedoColor = hf->color();
     if (hf->colorMap() != nullptr) {
         this->albedoSrc = MtlPropertySrc::eTexture;
-        this->albedoTexture.define(app, hf->colorMap());
+        cs237::VTPageFile const *pages = hf->colorMap()->pages;
+        if (pages != nullptr) {
+            // the cache only has to hold the tiles that are visible, so its size
+            // depends on the size of the screen, not the size of the color map
+            this->albedoVT = new cs237::VirtualTexture(
+                app, pages,
+                cs237::VirtualTexture::cacheSizeFor (
+                    pages, app->scene()->width(), app->scene()->height()));
+        } else {
+            this->albedoTexture.define(app, hf->colorMap());
+        }
     }
     this->emissiveSrc = MtlPropertySrc::eNone;
     this->specularSrc = MtlPropertySrc::eNone;
+    // the ground's normal map is never a virtual texture (see Scene::load)
     if (hf->normalMap() != nullptr) {
         this->nMap.define(app, hf->normalMap());
     }
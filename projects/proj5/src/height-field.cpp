@@ -13,15 +13,28 @@
  */
 
 #include "height-field.hpp"
+#include "height-tiles.hpp"
 
 // construct a HeightField object
 HeightField::HeightField (
     std::string const &file,
     float width, float height, float vScale,
     glm::vec3 const &color,
-    cs237::Image2D *cmap,
-    cs237::Image2D *nmap)
-  : _img(new cs237::Image2D(file, false)),
+    SceneTexture const *cmap,
+    SceneTexture const *nmap)
+  : HeightField (
+        new cs237::Image2D(file, false),
+        width, height, vScale, color, cmap, nmap)
+{ }
+
+// construct a HeightField object from a loaded image
+HeightField::HeightField (
+    const cs237::Image2D *img,
+    float width, float height, float vScale,
+    glm::vec3 const &color,
+    SceneTexture const *cmap,
+    SceneTexture const *nmap)
+  : _img(img), _tiles(nullptr),
     _halfWid(0.5*width), _halfHt(0.5*height),
     _minHt(0), _maxHt(0),
     _scaleX(width / float(this->numCols() - 1)),
@@ -60,9 +73,50 @@ HeightField::HeightField (
 
 }
 
+// construct a HeightField object from a tile file
+HeightField::HeightField (
+    const HeightTileFile *tiles,
+    float width, float height, float vScale,
+    glm::vec3 const &color,
+    SceneTexture const *cmap,
+    SceneTexture const *nmap)
+  : _img(nullptr), _tiles(tiles),
+    _halfWid(0.5*width), _halfHt(0.5*height),
+    _minHt(vScale * float(tiles->minValue())),
+    _maxHt(vScale * float(tiles->maxValue())),
+    _scaleX(width / float(this->numCols() - 1)),
+    _scaleY(vScale),
+    _scaleZ(height / float(this->numRows() -1 )),
+    _color(color), _colorMap(cmap), _normMap(nmap)
+{
+  // validate the arguments
+    if ((width <= 0.0) || (height <= 0.0) || (vScale <= 0.0)) {
+        ERROR("HeightField::HeightField: invalid scaling");
+    }
+
+}
+
+HeightField::~HeightField ()
+{
+    delete this->_tiles;
+}
+
+uint32_t HeightField::numRows () const
+{
+    return (this->_img != nullptr) ? this->_img->height() : this->_tiles->numRows();
+}
+
+uint32_t HeightField::numCols () const
+{
+    return (this->_img != nullptr) ? this->_img->width() : this->_tiles->numCols();
+}
+
 // return the height-field value at the given row and column
 uint16_t HeightField::valueAt (uint32_t row, uint32_t col) const
 {
+    if (this->_tiles != nullptr) {
+        return this->_tiles->valueAt (row, col);
+    }
     uint32_t idx = this->indexOf (row, col);
     if (this->_img->type() == cs237::ChannelTy::U8) {
         return static_cast<uint16_t>(static_cast<uint8_t *>(this->_img->data())[idx]);
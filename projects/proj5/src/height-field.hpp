@@ -17,6 +17,9 @@
 
 #include "cs237/cs237.hpp"
 
+struct SceneTexture;
+class HeightTileFile;
+
 class HeightField {
   public:
 
@@ -28,14 +31,53 @@ class HeightField {
     ///                world-space coordinates
     /// \param vScale  the vertical scaling (Y dimension) factor
     /// \param color   the color for non-texturing modes
-    /// \param cmap    the color texture image for the ground
-    /// \param nmap    the normal-map texture image for the ground
+    /// \param cmap    the color texture for the ground
+    /// \param nmap    the normal-map texture for the ground
     HeightField (
         std::string const &file,
         float width, float height, float vScale,
         glm::vec3 const &color,
-        cs237::Image2D *cmap,
-        cs237::Image2D *nmap);
+        SceneTexture const *cmap,
+        SceneTexture const *nmap);
+
+    /// construct a HeightField object from an image that has already been loaded
+    /// (e.g., from a scene bundle)
+    /// \param img     the height-field image, which must have U8 or U16 samples
+    /// \param width   the width (X dimension) covered by the ground in
+    ///                world-space coordinates
+    /// \param height  the height (Z dimension) covered by the ground in
+    ///                world-space coordinates
+    /// \param vScale  the vertical scaling (Y dimension) factor
+    /// \param color   the color for non-texturing modes
+    /// \param cmap    the color texture for the ground
+    /// \param nmap    the normal-map texture for the ground
+    HeightField (
+        const cs237::Image2D *img,
+        float width, float height, float vScale,
+        glm::vec3 const &color,
+        SceneTexture const *cmap,
+        SceneTexture const *nmap);
+
+    /// construct a HeightField object from a tiled height-field file, which is
+    /// used for height fields that are too large to keep in memory (the ground
+    /// mesh is then streamed; see `TerrainStreamer`)
+    /// \param tiles   the mapped tile file, which is owned by the height field
+    /// \param width   the width (X dimension) covered by the ground in
+    ///                world-space coordinates
+    /// \param height  the height (Z dimension) covered by the ground in
+    ///                world-space coordinates
+    /// \param vScale  the vertical scaling (Y dimension) factor
+    /// \param color   the color for non-texturing modes
+    /// \param cmap    the color texture for the ground
+    /// \param nmap    the normal-map texture for the ground
+    HeightField (
+        const HeightTileFile *tiles,
+        float width, float height, float vScale,
+        glm::vec3 const &color,
+        SceneTexture const *cmap,
+        SceneTexture const *nmap);
+
+    ~HeightField ();
 
     /// the width of the ground object in world-space
     float width () const { return 2.0f * this->_halfWid; }
@@ -44,10 +86,10 @@ class HeightField {
     float height () const { return 2.0f * this->_halfHt; }
 
     /// the number of rows of data in the height-field
-    uint32_t numRows () const { return this->_img->height(); }
+    uint32_t numRows () const;
 
     /// the number of rows of data in the height-field
-    uint32_t numCols () const { return this->_img->width(); }
+    uint32_t numCols () const;
 
     /// the number of vertices in the mesh represented by the height field
     uint32_t numVerts () const { return this->numRows() * this->numCols(); }
@@ -75,6 +117,16 @@ class HeightField {
             this->_scaleZ * float(row) - this->_halfHt);
     }
 
+    /// the vertical scaling factor that maps height-field values to elevations
+    float vScale () const { return this->_scaleY; }
+
+    /// the underlying image data (nullptr for a tiled height field)
+    const cs237::Image2D *image () const { return this->_img; }
+
+    /// the tile file of a tiled height field (nullptr if the height field is
+    /// an image)
+    const HeightTileFile *tiles () const { return this->_tiles; }
+
     /// return the world-space AABB for the height field
     cs237::AABBf_t bbox () const {
         return cs237::AABBf_t(
@@ -85,14 +137,15 @@ class HeightField {
     /// return the color for the ground in wireframe and flat-shading rendering modes
     glm::vec3 const &color () const { return this->_color; }
 
-    /// return the color map image for the ground
-    cs237::Image2D *colorMap () const { return this->_colorMap; }
+    /// return the color map texture for the ground
+    SceneTexture const *colorMap () const { return this->_colorMap; }
 
-    /// return the normal map image for the ground
-    cs237::Image2D *normalMap () const { return this->_normMap; }
+    /// return the normal map texture for the ground
+    SceneTexture const *normalMap () const { return this->_normMap; }
 
   private:
     const cs237::Image2D *_img; ///< the underlying image data
+    const HeightTileFile *_tiles; ///< the tile file of a tiled height field
     const float _halfWid;       ///< half the width in world space
     const float _halfHt;        ///< half the height in world space
     float _minHt;               ///< the minimum elevation
@@ -102,9 +155,9 @@ class HeightField {
     const float _scaleZ;        ///< horizontal scaling factor in Z dimension
     const glm::vec3 _color;     ///< the color of the ground in wireframe, flat-shading,
                                 ///  or diffuse mode
-    cs237::Image2D *_colorMap;	///< the color texture image for the ground in
+    SceneTexture const *_colorMap; ///< the color texture for the ground in
                                 ///  texturing and normal-mapping modes
-    cs237::Image2D *_normMap;	///< the normal-map texture image for the ground in
+    SceneTexture const *_normMap; ///< the normal-map texture for the ground in
                                 ///  normal-mapping mode.
 
 };
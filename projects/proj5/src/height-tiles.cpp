@@ -0,0 +1,207 @@
+/*! \file height-tiles.cpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5.  This file implements the
+ * tiled height-field files.  A tile file has the following layout:
+ *
+ *      header          magic number, version, size of the height field, tile
+ *                      size (in quads), sample size, and sample range
+ *      tiles           starting at offset kDataOffset, the tiles in row-major
+ *                      order; each tile is (tileQuads+3)^2 samples.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "height-tiles.hpp"
+#include <cstring>
+#include <fstream>
+
+static const char kHTMagic[8] = { 'C', 'S', '2', '3', '7', 'H', 'T', '\0' };
+static const uint32_t kHTVersion = 1;
+static const size_t kDataOffset = 64;
+
+// the tile-file header
+struct HTHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nRows;             // size of the height field in samples
+    uint32_t nCols;
+    uint32_t tileQuads;         // tile size in quads (not including the apron)
+    uint32_t sampleBytes;       // 1 for U8 samples and 2 for U16 samples
+    uint16_t minVal;            // range of the sample values
+    uint16_t maxVal;
+};
+
+// the number of tiles needed to cover n samples
+static uint32_t tilesFor (uint32_t n, uint32_t tileQuads)
+{
+    return (n - 1 + tileQuads - 1) / tileQuads;
+}
+
+// the range of the samples in a tile
+template <typename T>
+static void tileRange (const T *tile, size_t n, uint16_t &minVal, uint16_t &maxVal)
+{
+    auto [lo, hi] = std::minmax_element (tile, tile + n);
+    minVal = *lo;
+    maxVal = *hi;
+}
+
+/******************** class HeightTileFile ********************/
+
+bool HeightTileFile::build (
+    cs237::Image2D const *img,
+    std::string const &file,
+    uint32_t tileQuads,
+    cs237::JobSystem *jobs)
+{
+    if ((tileQuads == 0) || (img->width() < 2) || (img->height() < 2)
+    || (img->channels() != cs237::Channels::R)
+    || ((img->type() != cs237::ChannelTy::U8) && (img->type() != cs237::ChannelTy::U16))) {
+        return false;
+    }
+
+    uint32_t nRows = img->height();
+    uint32_t nCols = img->width();
+    uint32_t tw = tilesFor (nCols, tileQuads);
+    uint32_t th = tilesFor (nRows, tileQuads);
+    uint32_t sampleBytes = (img->type() == cs237::ChannelTy::U8) ? 1 : 2;
+    uint32_t p = tileQuads + 3;
+    size_t tileBytes = sampleBytes * size_t(p) * size_t(p);
+
+    HTHeader hdr;
+    std::memcpy (hdr.magic, kHTMagic, sizeof(hdr.magic));
+    hdr.version = kHTVersion;
+    hdr.nRows = nRows;
+    hdr.nCols = nCols;
+    hdr.tileQuads = tileQuads;
+    hdr.sampleBytes = sampleBytes;
+    hdr.minVal = 0xffff;
+    hdr.maxVal = 0;
+
+    bool ok = cs237::writeFileAtomically (file, [&] (std::ofstream &outS) {
+        // the header is written last, since the sample range is not known
+        // until all of the tiles have been cut
+        char pad[kDataOffset] = {};
+        outS.write (pad, sizeof(pad));
+
+        // the tiles are written a row of tiles at a time, so the data that
+        // is held in memory is proportional to the width of the height field
+        std::vector<uint8_t> tiles(size_t(tw) * tileBytes);
+        std::vector<uint16_t> minVals(tw), maxVals(tw);
+        for (uint32_t ty = 0;  ty < th;  ++ty) {
+            // the tile at (tx, ty) starts at the sample before its first quad
+            auto cut = [&] (uint32_t tx) {
+                int32_t c0 = int32_t(tx * tileQuads) - 1;
+                int32_t r0 = int32_t(ty * tileQuads) - 1;
+                uint8_t *dst = tiles.data() + size_t(tx) * tileBytes;
+                if (sampleBytes == 1) {
+                    cs237::copyClampedTile (
+                        static_cast<const uint8_t *>(img->data()), nCols, nRows,
+                        c0, r0, p, dst);
+                    tileRange (dst, size_t(p) * p, minVals[tx], maxVals[tx]);
+                } else {
+                    uint16_t *dst16 = reinterpret_cast<uint16_t *>(dst);
+                    cs237::copyClampedTile (
+                        static_cast<const uint16_t *>(img->data()), nCols, nRows,
+                        c0, r0, p, dst16);
+                    tileRange (dst16, size_t(p) * p, minVals[tx], maxVals[tx]);
+                }
+            };
+            std::vector<cs237::Job *> pending;
+            for (uint32_t tx = 0;  tx < tw;  ++tx) {
+                if ((jobs != nullptr) && (tw > 1)) {
+                    pending.push_back (jobs->spawn ([&cut, tx] () { cut (tx); }));
+                } else {
+                    cut (tx);
+                }
+            }
+            for (auto job : pending) {
+                jobs->wait (job);
+            }
+            for (uint32_t tx = 0;  tx < tw;  ++tx) {
+                hdr.minVal = std::min(hdr.minVal, minVals[tx]);
+                hdr.maxVal = std::max(hdr.maxVal, maxVals[tx]);
+            }
+            outS.write (reinterpret_cast<const char *>(tiles.data()), tiles.size());
+            if (outS.fail()) {
+                return false;
+            }
+        }
+
+        std::memcpy (pad, &hdr, sizeof(hdr));
+        outS.seekp (0);
+        outS.write (pad, sizeof(pad));
+        return !outS.fail();
+    });
+
+    return ok;
+
+}
+
+HeightTileFile::HeightTileFile (std::string const &file)
+  : _file(new cs237::MappedFile(file)), _tiles(nullptr),
+    _nRows(0), _nCols(0), _type(cs237::ChannelTy::U8), _minVal(0), _maxVal(0),
+    _tileQuads(0), _tilesWide(0), _tilesHigh(0)
+{
+    if (! this->_file->isValid() || (this->_file->size() < kDataOffset)) {
+        return;
+    }
+
+    HTHeader hdr;
+    std::memcpy (&hdr, this->_file->data(), sizeof(hdr));
+    if ((std::memcmp(hdr.magic, kHTMagic, sizeof(hdr.magic)) != 0)
+    || (hdr.version != kHTVersion)
+    || (hdr.tileQuads == 0) || (hdr.nRows < 2) || (hdr.nCols < 2)
+    || ((hdr.sampleBytes != 1) && (hdr.sampleBytes != 2))
+    || (hdr.minVal > hdr.maxVal)) {
+        return;
+    }
+
+    uint32_t tw = tilesFor (hdr.nCols, hdr.tileQuads);
+    uint32_t th = tilesFor (hdr.nRows, hdr.tileQuads);
+    size_t p = hdr.tileQuads + 3;
+    size_t nBytes = kDataOffset + hdr.sampleBytes * p * p * size_t(tw) * size_t(th);
+    if (this->_file->size() != nBytes) {
+        return;
+    }
+
+    this->_nRows = hdr.nRows;
+    this->_nCols = hdr.nCols;
+    this->_type = (hdr.sampleBytes == 1) ? cs237::ChannelTy::U8 : cs237::ChannelTy::U16;
+    this->_minVal = hdr.minVal;
+    this->_maxVal = hdr.maxVal;
+    this->_tileQuads = hdr.tileQuads;
+    this->_tilesWide = tw;
+    this->_tilesHigh = th;
+    this->_tiles = reinterpret_cast<const uint8_t *>(this->_file->data()) + kDataOffset;
+
+}
+
+HeightTileFile::~HeightTileFile ()
+{
+    delete this->_file;
+}
+
+uint16_t HeightTileFile::valueAt (uint32_t row, uint32_t col) const
+{
+    assert ((row < this->_nRows) && (col < this->_nCols));
+
+    // the samples on the shared edges of tiles are in both tiles, so we can
+    // use the tile that starts at or before the sample
+    uint32_t tx = std::min(col / this->_tileQuads, this->_tilesWide - 1);
+    uint32_t ty = std::min(row / this->_tileQuads, this->_tilesHigh - 1);
+    size_t idx = size_t(row - ty * this->_tileQuads + 1) * this->tileSamples()
+        + size_t(col - tx * this->_tileQuads + 1);
+    const uint8_t *data = this->tileData (this->tileId (tx, ty));
+    if (this->_type == cs237::ChannelTy::U8) {
+        return data[idx];
+    }
+    else {
+        return reinterpret_cast<const uint16_t *>(data)[idx];
+    }
+}
@@ -0,0 +1,142 @@
+/*! \file height-tiles.hpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5
+ *
+ * This file defines the HeightTileFile class, which is a tiled, memory-mapped
+ * representation of a height field that is too large to keep in memory.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _HEIGHT_TILES_HPP_
+#define _HEIGHT_TILES_HPP_
+
+#include "cs237/cs237.hpp"
+
+/// A height-tile file holds the samples of a height field as a grid of square
+/// tiles, so that the samples of a region of the height field are contiguous in
+/// the file.  The file is built from a height-field image once (see `build`)
+/// and then mapped into memory, so the operating system pages in only the
+/// tiles that are read and can drop them again when memory is needed.
+///
+/// A tile covers `tileQuads` x `tileQuads` quads of the height field (i.e.,
+/// `tileQuads+1` samples along a side, which it shares with its neighbors),
+/// plus an apron of one sample on each side, so the normals along the edges of
+/// a tile can be computed from the tile alone.  Samples outside the height
+/// field are clamped to its edges.
+class HeightTileFile {
+public:
+
+    /// the default number of quads along the side of a tile
+    static constexpr uint32_t kTileQuads = 256;
+
+    /// \brief build a height-tile file from a height-field image
+    /// \param img        the height-field image, which must have U8 or U16 samples
+    /// \param file       the path of the tile file
+    /// \param tileQuads  the number of quads along the side of a tile
+    /// \param jobs       if non-null, the tiles are cut in parallel using the
+    ///                   job system
+    /// \return true if the file was written and false on error
+    static bool build (
+        cs237::Image2D const *img,
+        std::string const &file,
+        uint32_t tileQuads = kTileQuads,
+        cs237::JobSystem *jobs = nullptr);
+
+    /// \brief open a height-tile file
+    /// \param file  the path of the tile file
+    ///
+    /// If the file cannot be opened or is not a valid tile file, then the
+    /// resulting object is invalid (see `isValid`).
+    explicit HeightTileFile (std::string const &file);
+
+    HeightTileFile (HeightTileFile const &) = delete;
+    HeightTileFile &operator= (HeightTileFile const &) = delete;
+
+    ~HeightTileFile ();
+
+    /// was the file successfully opened?
+    bool isValid () const { return this->_tiles != nullptr; }
+
+    /// the number of rows of samples in the height field
+    uint32_t numRows () const { return this->_nRows; }
+
+    /// the number of columns of samples in the height field
+    uint32_t numCols () const { return this->_nCols; }
+
+    /// the type of the samples (U8 or U16)
+    cs237::ChannelTy type () const { return this->_type; }
+
+    /// the size in bytes of a sample
+    uint32_t sampleBytes () const
+    {
+        return (this->_type == cs237::ChannelTy::U8) ? 1 : 2;
+    }
+
+    /// the smallest sample value in the height field
+    uint16_t minValue () const { return this->_minVal; }
+
+    /// the largest sample value in the height field
+    uint16_t maxValue () const { return this->_maxVal; }
+
+    /// the number of quads along the side of a tile
+    uint32_t tileQuads () const { return this->_tileQuads; }
+
+    /// the number of samples along the side of a tile, including its apron
+    uint32_t tileSamples () const { return this->_tileQuads + 3; }
+
+    /// the size in bytes of a tile's data
+    size_t tileBytes () const
+    {
+        return size_t(this->sampleBytes()) * size_t(this->tileSamples())
+            * size_t(this->tileSamples());
+    }
+
+    /// the number of tiles in each row of tiles
+    uint32_t tilesWide () const { return this->_tilesWide; }
+
+    /// the number of rows of tiles
+    uint32_t tilesHigh () const { return this->_tilesHigh; }
+
+    /// the total number of tiles
+    uint32_t numTiles () const { return this->_tilesWide * this->_tilesHigh; }
+
+    /// the index of the tile at position (`x`, `y`); the tiles are numbered in
+    /// row-major order
+    uint32_t tileId (uint32_t x, uint32_t y) const { return y * this->_tilesWide + x; }
+
+    /// the data for a tile, which is `tileSamples()` rows of `tileSamples()`
+    /// samples.  The first row and column are the apron, so sample (r, c) of
+    /// the tile at (x, y) is at row `r + 1` and column `c + 1` of the data, where
+    /// (r, c) is relative to sample (`y*tileQuads()`, `x*tileQuads()`) of the
+    /// height field.
+    const uint8_t *tileData (uint32_t id) const
+    {
+        assert (id < this->numTiles());
+        return this->_tiles + size_t(id) * this->tileBytes();
+    }
+
+    /// return the height-field value at the given row and column
+    uint16_t valueAt (uint32_t row, uint32_t col) const;
+
+private:
+    cs237::MappedFile *_file;           ///< the mapped file
+    const uint8_t *_tiles;              ///< the start of the tile data in the file
+                                        ///  (nullptr if the file is invalid)
+    uint32_t _nRows;                    ///< the number of rows of samples
+    uint32_t _nCols;                    ///< the number of columns of samples
+    cs237::ChannelTy _type;             ///< the sample type
+    uint16_t _minVal;                   ///< the smallest sample value
+    uint16_t _maxVal;                   ///< the largest sample value
+    uint32_t _tileQuads;                ///< the number of quads along a tile side
+    uint32_t _tilesWide;                ///< the number of tiles in a row of tiles
+    uint32_t _tilesHigh;                ///< the number of rows of tiles
+
+};
+
+#endif // !_HEIGHT_TILES_HPP_
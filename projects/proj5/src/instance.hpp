@@ -15,6 +15,11 @@
 
 #include "mesh.hpp"
 #include "shader-uniforms.hpp"
+#include <algorithm>
+
+/// the largest screen-space error (in pixels) that we allow when picking the
+/// level of detail of a mesh
+constexpr float kLODPixelError = 1.0f;
 
 //! An instance of a graphical object in the scene
 struct Instance {
@@ -34,8 +39,60 @@ struct Instance {
     : meshes{m}, toWorld(modelM), normToWorld(normM)
     { }
 
-    // add a mesh to the instance
-    void pushMesh (Mesh *m) { this->meshes.push_back(m); }
+    // add a mesh to the instance; meshes that share a descriptor set (see
+    // `MeshFactory::alloc`) are kept together, so that the set is only bound
+    // once per run of meshes
+    void pushMesh (Mesh *m)
+    {
+        auto it = std::find_if(this->meshes.rbegin(), this->meshes.rend(),
+            [m] (Mesh const *m2) { return m2->descSet == m->descSet; });
+        if (it == this->meshes.rend()) {
+            this->meshes.push_back(m);
+        } else {
+            this->meshes.insert(it.base(), m);
+        }
+    }
+
+    /// \brief pick the level of detail for one of the instance's meshes.  We use
+    ///        the coarsest level whose geometric error, when projected to the
+    ///        screen at the distance from the eye to the mesh's bounding box,
+    ///        is at most `kLODPixelError` pixels.
+    /// \param mesh        the mesh
+    /// \param eye         the position of the camera in world space
+    /// \param pixelScale  the number of pixels covered by an object of unit size at
+    ///                    unit distance from the camera (i.e., the viewport height
+    ///                    divided by 2*tan(fov/2))
+    /// \return the level of detail to use for the mesh
+    uint32_t selectLOD (Mesh const *mesh, glm::vec3 eye, float pixelScale) const
+    {
+        if (mesh->nLODs() < 2) {
+            return 0;
+        }
+        // the distance from the eye to the world-space bounding box of the mesh
+        cs237::AABBf_t bbox;
+        for (int i = 0;  i < 8;  ++i) {
+            glm::vec3 p(
+                (i & 1) ? mesh->aabb.maxX() : mesh->aabb.minX(),
+                (i & 2) ? mesh->aabb.maxY() : mesh->aabb.minY(),
+                (i & 4) ? mesh->aabb.maxZ() : mesh->aabb.minZ());
+            bbox.addPt (glm::vec3(this->toWorld * glm::vec4(p, 1.0f)));
+        }
+        float dist = bbox.distanceToPt (eye);
+        if (dist <= 0.0f) {
+            return 0;
+        }
+        // the errors are in model space, so we scale them by the largest scaling
+        // factor of the model-to-world transform
+        float scale = std::max(glm::length(glm::vec3(this->toWorld[0])),
+            std::max(glm::length(glm::vec3(this->toWorld[1])),
+                glm::length(glm::vec3(this->toWorld[2]))));
+        float maxError = kLODPixelError * dist / (scale * pixelScale);
+        uint32_t lod = 0;
+        while ((lod + 1 < mesh->nLODs()) && (mesh->lods[lod+1].error <= maxError)) {
+            ++lod;
+        }
+        return lod;
+    }
 
 };
 
@@ -17,13 +17,36 @@
 #include <array>
 #include <vector>
 
-Mesh::Mesh (Proj5 *app, OBJ::Model const *model, int grpId)
+/// the transform from a material's texture coordinates to the coordinates of
+/// its textures; this transform is the identity unless the textures were packed
+/// into a texture atlas, in which case they all have the same location (see
+/// `canUseAtlas` in `bake.cpp`)
+static glm::vec4 atlasXform (Scene const *scene, OBJ::Material const *mtl)
+{
+    SceneAtlasEntry entry;
+    for (auto const &map : { mtl->emissiveMap, mtl->diffuseMap, mtl->specularMap }) {
+        if (!map.empty() && scene->atlasEntry (map, entry)) {
+            return entry.uvXform;
+        }
+    }
+    return glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+
+}
+
+Mesh::Mesh (
+    Proj5 *app,
+    OBJ::Model const *model,
+    int grpId,
+    VertexFormat fmt,
+    Mesh const *shared)
 : device(app->device()),
-  vBuf(nullptr), iBuf(nullptr), prim(vk::PrimitiveTopology::eTriangleList), aabb(),
-  albedoSrc(MtlPropertySrc::eNone), albedoTexture(),
+  vFormat(fmt), vBuf(nullptr), cvBuf(nullptr), iBuf(nullptr),
+  meshletBuf(nullptr), nMeshlets(0), terrain(nullptr), streamer(nullptr),
+  prim(vk::PrimitiveTopology::eTriangleList), aabb(),
+  albedoSrc(MtlPropertySrc::eNone), albedoTexture(), albedoVT(nullptr),
   emissiveSrc(MtlPropertySrc::eNone), emissiveTexture(),
   specularSrc(MtlPropertySrc::eNone), specularTexture(),
-  nMap()
+  nMap(), mtl(nullptr)
 {
     auto grp = model->group(grpId);
 
@@ -37,22 +60,29 @@ Mesh::Mesh (Proj5 *app, OBJ::Model const *model, int grpId)
          ERROR("empty group");
     }
 
-    this->vBuf = new cs237::VertexBuffer<Vertex>(app, grp.nVerts);
-    this->iBuf = new cs237::IndexBuffer<uint32_t>(app, grp.nIndices);
+    // get the material for the group
+    this->mtl = &model->material(grp.material);
+
+    // the texture coordinates of the vertices, which are mapped to the atlas page
+    // when the material's textures are in an atlas
+    glm::vec4 xform = atlasXform (app->scene(), this->mtl);
+    auto txtCoord = [&grp, xform] (uint32_t i) {
+        return grp.txtCoords[i] * glm::vec2(xform.x, xform.y) + glm::vec2(xform.z, xform.w);
+    };
 
-    // vertex buffer initialization; first convert struct of arrays to array of structs
-    // at the same time, we update the bounding box
-    std::vector<Vertex> verts(grp.nVerts);
+    // compute the bounding box and the range of the texture coordinates
+    glm::vec2 tcMin(std::numeric_limits<float>::max());
+    glm::vec2 tcMax(-std::numeric_limits<float>::max());
     for (int i = 0;  i < grp.nVerts;  ++i) {
         this->aabb.addPt(grp.verts[i]);
-        verts[i].pos = grp.verts[i];
-        verts[i].norm = grp.norms[i];
-        verts[i].txtCoord = grp.txtCoords[i];
+        tcMin = glm::min(tcMin, txtCoord(i));
+        tcMax = glm::max(tcMax, txtCoord(i));
     }
 
     // compute tangent vectors; we do this by summing the tangent and bitangent
     // vectors for each occurrence of a vertex in a triangle and then normalizing
-    // the result.
+    // the result.  The atlas transform only scales the texture coordinates by
+    // positive factors, so it does not change the directions of the tangents.
     std::vector<glm::vec3> tan(grp.nVerts);
     std::vector<glm::vec3> bitan(grp.nVerts);
     uint32_t nTris = grp.nIndices / 3;
@@ -92,85 +122,70 @@ Mesh::Mesh (Proj5 *app, OBJ::Model const *model, int grpId)
         bitan[i2] += b;
         bitan[i3] += b;
     }
-    // compute extended tangents for vertices
-    for (int i = 0;  i < grp.nVerts;  i++) {
+    // convert the group's struct of arrays to interleaved vertices, which are
+    // written directly into the vertex buffer.  At the same time, we compute
+    // the extended tangents for the vertices.
+    this->_initVertexBuffer (app, grp.nVerts, tcMin, tcMax, [&] (uint32_t i) {
+        Vertex v;
+        v.pos = grp.verts[i];
+        v.norm = grp.norms[i];
+        v.txtCoord = txtCoord(i);
         glm::vec3 n = grp.norms[i];
         glm::vec3 t = glm::normalize(tan[i]);
         /* NOTE: we only care about the direction of bitan[i], so we do not normalize */
         // orthogonalize the tangent and normal
         t = glm::normalize(t - n * dot(n, t));
         float w = (glm::dot(glm::cross(n, t), bitan[i]) < 0.0f ? -1.0f : 1.0f);
-        verts[i].tan = glm::vec4(t, w);
-    }
-
-    // copy data
-    this->vBuf->copyTo(verts);
+        v.tan = glm::vec4(t, w);
+        return v;
+    });
 
     // index buffer initialization
-    this->iBuf->copyTo(vk::ArrayProxy<uint32_t>(grp.nIndices, grp.indices));
-
-    // get the material for the group
-    OBJ::Material mtl = model->material(grp.material);
-
-    // sampler-creation info
-    cs237::Application::SamplerInfo samplerInfo(
-        vk::Filter::eLinear,  /* magnification filter */
-        vk::Filter::eLinear,  /* minification filter */
-        vk::SamplerMipmapMode::eLinear,  /* mipmap mode */
-        vk::SamplerAddressMode::eClampToEdge,  /* addressing mode for U coordinates */
-        vk::SamplerAddressMode::eClampToEdge,  /* addressing mode for V coordinates */
-        vk::BorderColor::eFloatOpaqueBlack);  /* border color */
+    this->_initIndexBuffer (
+        app, grp.nIndices, grp.indices, grp.nVerts, grp.verts,
+        grp.nLODs, grp.lods, grp.nLODIndices, grp.lodIndices);
 
     // initialize the albedo info
-    if (mtl.diffuseC == 0) {
+    if (this->mtl->diffuseC == 0) {
         this->emissiveSrc = MtlPropertySrc::eNone;
         this->albedoColor = glm::vec3(1.0, 1.0, 1.0); /* default for wire-frame */
+    } else if ((this->mtl->diffuseC & OBJ::UniformComponent) != 0) {
+        this->albedoSrc = MtlPropertySrc::eConstant;
+        this->albedoColor = this->mtl->diffuse;
     } else {
-        if ((mtl.diffuseC & OBJ::UniformComponent) != 0) {
-            this->albedoSrc = MtlPropertySrc::eConstant;
-            this->albedoColor = mtl.diffuse;
-        } else {
-            this->albedoColor = glm::vec3(1.0, 1.0, 1.0); /* default for wire-frame */
-        }
-        if ((mtl.diffuseC & OBJ::MapComponent) != 0) {
-            this->albedoSrc = MtlPropertySrc::eTexture;
-            this->albedoTexture.define(app, mtl.diffuseMap);
-        }
+        // we use white as the placeholder until the texture is loaded
+        this->albedoSrc = MtlPropertySrc::eConstant;
+        this->albedoColor = glm::vec3(1.0, 1.0, 1.0); /* default for wire-frame */
     }
 
     // initialize the emissive info (if present)
-    if (mtl.emissiveC == 0) {
-        this->emissiveSrc = MtlPropertySrc::eNone;
+    if ((this->mtl->emissiveC & OBJ::UniformComponent) != 0) {
+        this->emissiveSrc = MtlPropertySrc::eConstant;
+        this->emissiveColor = this->mtl->emissive;
     } else {
-        if ((mtl.emissiveC & OBJ::UniformComponent) != 0) {
-            this->emissiveSrc = MtlPropertySrc::eConstant;
-            this->emissiveColor = mtl.emissive;
-        }
-        if ((mtl.emissiveC & OBJ::MapComponent) != 0) {
-            this->emissiveSrc = MtlPropertySrc::eTexture;
-            this->emissiveTexture.define(app, mtl.emissiveMap);
-        }
+        this->emissiveSrc = MtlPropertySrc::eNone;
     }
 
     // initialize the specular info (if present)
-    if (mtl.specularC == 0) {
-        this->specularSrc = MtlPropertySrc::eNone;
+    if ((this->mtl->specularC & OBJ::UniformComponent) != 0) {
+        this->specularSrc = MtlPropertySrc::eConstant;
+        this->specularColor = glm::vec4(this->mtl->specular, this->mtl->shininess);
     } else {
-        if ((mtl.specularC & OBJ::UniformComponent) != 0) {
-            this->specularSrc = MtlPropertySrc::eConstant;
-            this->specularColor = glm::vec4(mtl.specular, mtl.shininess);
-        }
-        if ((mtl.specularC & OBJ::MapComponent) != 0) {
-            this->specularSrc = MtlPropertySrc::eTexture;
-            this->specularTexture.define(app, mtl.specularMap);
-        }
+        this->specularSrc = MtlPropertySrc::eNone;
     }
 
-    // initialize the normal map (if present)
-    if (mtl.normalMap != "") {
-        this->nMap.define(app, mtl.normalMap);
+    if (shared != nullptr) {
+        // the textures, UBO, and descriptor set belong to `shared`, which keeps
+        // them up to date, so we do not need the material
+        this->mtl = nullptr;
+        this->ubo = nullptr;
+        this->descSet = shared->descSet;
+        return;
     }
 
+    // define the textures whose images have already been loaded
+    this->updateTextures (app);
+
     // create and initialize the UBO
     this->initUBO (app);
 }
@@ -178,6 +193,7 @@ Mesh::Mesh (Proj5 *app, OBJ::Model const *model, int grpId)
 Mesh::~Mesh ()
 {
     this->albedoTexture.destroy(this->device);
+    delete this->albedoVT;
     this->emissiveTexture.destroy(this->device);
     this->specularTexture.destroy(this->device);
     this->nMap.destroy(this->device);
@@ -185,42 +201,224 @@ Mesh::~Mesh ()
     delete this->ubo;
 
     delete this->vBuf;
+    delete this->cvBuf;
     delete this->iBuf;
+    delete this->meshletBuf;
+    delete this->terrain;
+    delete this->streamer;
+
+}
+
+void Mesh::_initIndexBuffer (
+    Proj5 *app,
+    uint32_t nIndices,
+    const uint32_t *indices,
+    uint32_t nVerts,
+    const glm::vec3 *pos,
+    uint32_t nLODs,
+    const cs237::mesh::LOD *lods,
+    uint32_t nLODIndices,
+    const uint32_t *lodIndices)
+{
+    // the indices are written directly into the mapped index buffer
+    this->iBuf = new cs237::IndexBuffer<uint32_t>(app, nIndices + nLODIndices);
+    auto dst = this->iBuf->map();
+
+    if (nIndices / 3 < kMeshletMinTris) {
+        std::copy (indices, indices + nIndices, dst.data());
+    } else {
+        // split the mesh into meshlets and reorder the indices to match
+        auto meshlets = cs237::mesh::buildMeshlets (nIndices, indices, pos, nVerts);
+        meshlets.indices (dst.data());
+
+        std::vector<MeshletInfo> info;
+        info.reserve(meshlets.size());
+        for (auto const &m : meshlets.meshlets) {
+            MeshletInfo mi;
+            mi.sphere = glm::vec4(m.center, m.radius);
+            mi.cone = glm::vec4(m.coneAxis, m.coneCutoff);
+            mi.firstIndex = 3 * m.firstTri;
+            mi.nIndices = 3 * m.nTris;
+            info.push_back(mi);
+        }
+        this->nMeshlets = meshlets.size();
+        this->meshletBuf = new cs237::StorageBuffer<MeshletInfo>(app, info);
+    }
+
+    // the levels of detail; the simplified levels share the vertex buffer, so
+    // we just append their indices
+    this->lods.clear();
+    this->lods.push_back(cs237::mesh::LOD{ 0, nIndices, 0.0f });
+    std::copy (lodIndices, lodIndices + nLODIndices, dst.data() + nIndices);
+    for (uint32_t i = 0;  i < nLODs;  ++i) {
+        cs237::mesh::LOD lod = lods[i];
+        lod.firstIndex += nIndices;
+        this->lods.push_back(lod);
+    }
+
+}
+
+bool Mesh::updateTextures (Proj5 *app)
+{
+    if (this->mtl == nullptr) {
+        return false;
+    }
+
+    auto scene = app->scene();
+    bool changed = false;
+    SceneTexture const *img;
+
+    if (((this->mtl->diffuseC & OBJ::MapComponent) != 0)
+    &&  !this->albedoTexture.isDefined()
+    &&  ((img = scene->textureByName(this->mtl->diffuseMap)) != nullptr)) {
+        this->albedoSrc = MtlPropertySrc::eTexture;
+        this->albedoTexture.define(app, img);
+        changed = true;
+    }
+    if (((this->mtl->emissiveC & OBJ::MapComponent) != 0)
+    &&  !this->emissiveTexture.isDefined()
+    &&  ((img = scene->textureByName(this->mtl->emissiveMap)) != nullptr)) {
+        this->emissiveSrc = MtlPropertySrc::eTexture;
+        this->emissiveTexture.define(app, img);
+        changed = true;
+    }
+    if (((this->mtl->specularC & OBJ::MapComponent) != 0)
+    &&  !this->specularTexture.isDefined()
+    &&  ((img = scene->textureByName(this->mtl->specularMap)) != nullptr)) {
+        this->specularSrc = MtlPropertySrc::eTexture;
+        this->specularTexture.define(app, img);
+        changed = true;
+    }
+    if ((this->mtl->normalMap != "")
+    &&  !this->nMap.isDefined()
+    &&  ((img = scene->textureByName(this->mtl->normalMap)) != nullptr)) {
+        this->nMap.define(app, img);
+        changed = true;
+    }
 
+    return changed;
+
+}
+
+bool Mesh::hasPendingTextures () const
+{
+    if (this->mtl == nullptr) {
+        return false;
+    }
+    return (((this->mtl->diffuseC & OBJ::MapComponent) != 0)
+            && !this->albedoTexture.isDefined())
+        || (((this->mtl->emissiveC & OBJ::MapComponent) != 0)
+            && !this->emissiveTexture.isDefined())
+        || (((this->mtl->specularC & OBJ::MapComponent) != 0)
+            && !this->specularTexture.isDefined())
+        || ((this->mtl->normalMap != "") && !this->nMap.isDefined());
+
+}
+
+/// fill in a material UB from a mesh's material state
+static void initMaterialUB (Mesh const *mesh, MaterialUB &ub)
+{
+    ub.albedoSrc = static_cast<int>(mesh->albedoSrc);
+    ub.albedo = mesh->albedoColor;
+    ub.emissiveSrc = static_cast<int>(mesh->emissiveSrc);
+    ub.emissive = mesh->emissiveColor;
+    ub.specularSrc = static_cast<int>(mesh->specularSrc);
+    ub.specular = mesh->specularColor;
+    ub.hasNormalMap = (mesh->nMap.isDefined() ? VK_TRUE : VK_FALSE);
 }
 
 void Mesh::initUBO (Proj5 *app)
 {
     MaterialUB ub;
 
-    ub.albedoSrc = static_cast<int>(this->albedoSrc);
-    ub.albedo = this->albedoColor;
-    ub.emissiveSrc = static_cast<int>(this->emissiveSrc);
-    ub.emissive = this->emissiveColor;
-    ub.specularSrc = static_cast<int>(this->specularSrc);
-    ub.specular = this->specularColor;
-    ub.hasNormalMap = (this->nMap.isDefined() ? VK_TRUE : VK_FALSE);
-
+    initMaterialUB (this, ub);
     this->ubo = new cs237::UniformBuffer<MaterialUB>(app, ub);
 
 }
 
-void Mesh::draw (vk::CommandBuffer cmdBuf)
+void Mesh::updateUBO ()
+{
+    MaterialUB ub;
+
+    initMaterialUB (this, ub);
+    this->ubo->copyTo(ub);
+
+}
+
+void Mesh::draw (vk::CommandBuffer cmdBuf, uint32_t lod)
+{
+    assert (lod < this->nLODs());
+
+    if (this->isCompact()) {
+        cmdBuf.bindVertexBuffers(0, this->cvBuf->vkBuffer(), {0});
+    } else {
+        cmdBuf.bindVertexBuffers(0, this->vBuf->vkBuffer(), {0});
+    }
+    cmdBuf.bindIndexBuffer(this->iBuf->vkBuffer(), 0, vk::IndexType::eUint32);
+
+    cmdBuf.drawIndexed(this->lods[lod].nIndices, 1, this->lods[lod].firstIndex, 0, 0);
+
+}
+
+void Mesh::drawMeshlets (
+    vk::CommandBuffer cmdBuf,
+    vk::Buffer cmds,
+    uint32_t firstCmd,
+    uint32_t maxDraws)
+{
+    assert (this->hasMeshlets());
+
+    if (this->isCompact()) {
+        cmdBuf.bindVertexBuffers(0, this->cvBuf->vkBuffer(), {0});
+    } else {
+        cmdBuf.bindVertexBuffers(0, this->vBuf->vkBuffer(), {0});
+    }
+    cmdBuf.bindIndexBuffer(this->iBuf->vkBuffer(), 0, vk::IndexType::eUint32);
+
+    // issue the draws in batches of at most `maxDraws` commands
+    constexpr uint32_t kStride = sizeof(vk::DrawIndexedIndirectCommand);
+    for (uint32_t i = 0;  i < this->nMeshlets;  i += maxDraws) {
+        uint32_t n = std::min(maxDraws, this->nMeshlets - i);
+        cmdBuf.drawIndexedIndirect(cmds, (firstCmd + i) * kStride, n, kStride);
+    }
+
+}
+
+void Mesh::drawChunks (vk::CommandBuffer cmdBuf, std::vector<Terrain::Chunk> const &chunks)
 {
-    cmdBuf.bindVertexBuffers(0, this->vBuf->vkBuffer(), {0});
+    assert (this->terrain != nullptr);
+
+    if (this->isCompact()) {
+        cmdBuf.bindVertexBuffers(0, this->cvBuf->vkBuffer(), {0});
+    } else {
+        cmdBuf.bindVertexBuffers(0, this->vBuf->vkBuffer(), {0});
+    }
     cmdBuf.bindIndexBuffer(this->iBuf->vkBuffer(), 0, vk::IndexType::eUint32);
 
-    cmdBuf.drawIndexed(static_cast<uint32_t>(this->nIndices()), 1, 0, 0, 0);
+    // the chunks share the index patterns, so each chunk is drawn with the
+    // offset of its first vertex
+    for (auto const &chunk : chunks) {
+        cmdBuf.drawIndexed(chunk.nIndices, 1, chunk.firstIndex, chunk.vertexOffset, 0);
+    }
 
 }
 
 /***** TextureProperty methods *****/
 
-void TextureProperty::define (Proj5 *app, cs237::Image2D *img)
+void TextureProperty::define (Proj5 *app, SceneTexture const *tex)
 {
-    assert (img != nullptr && "undefined image for texture property");
-
-    this->txt = new cs237::Texture2D(app, img);
+    assert (tex != nullptr && "undefined image for texture property");
+
+    // textures from a scene bundle come with pre-built mipmap levels, which
+    // may be block compressed; otherwise the levels are generated when the
+    // texture is created
+    if (tex->cImg != nullptr) {
+        this->txt = new cs237::Texture2D(app, tex->cImg);
+    } else if (tex->mips.empty()) {
+        this->txt = new cs237::Texture2D(app, tex->img, true);
+    } else {
+        this->txt = new cs237::Texture2D(app, tex->img, tex->mips);
+    }
 
     cs237::Application::SamplerInfo samplerInfo(
         vk::Filter::eLinear,  /* magnification filter */
@@ -236,26 +434,69 @@ void TextureProperty::define (Proj5 *app, cs237::Image2D *img)
 
 /***** MeshFactory methods *****/
 
-MeshFactory::MeshFactory (Proj5 *app, int nMeshes)
-: _app(app)
+/// a key that identifies the material state of a mesh; meshes with the same key
+/// have the same UBO contents and texture images, so they can share a descriptor
+/// set.  The texture names are mapped to their atlas pages, so materials whose
+/// textures are in the same atlas page have the same key.
+static std::string materialKey (Scene const *scene, OBJ::Material const &mtl)
 {
-    // allocate the descriptor pool; there is one UBO and at most 4 samplers per mesh
-    int nUBOs = nMeshes;
-    int nSamplers = 4 * nMeshes;
-    std::array<vk::DescriptorPoolSize, 2> poolSizes = {
-            vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, nUBOs),
-            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, nSamplers)
-        };
-    vk::DescriptorPoolCreateInfo poolInfo(
-        {}, /* flags */
-        nMeshes, /* max sets; one per mesh */
-        poolSizes); /* pool sizes */
+    std::string key;
+    auto addBytes = [&key] (const void *data, size_t sz) {
+        key.append (static_cast<const char *>(data), sz);
+    };
+    auto addMap = [&key, scene] (std::string const &map) {
+        SceneAtlasEntry entry;
+        key += (!map.empty() && scene->atlasEntry (map, entry)) ? entry.page : map;
+        key += '\0';
+    };
+
+    addBytes (&mtl.emissiveC, sizeof(mtl.emissiveC));
+    addBytes (&mtl.diffuseC, sizeof(mtl.diffuseC));
+    addBytes (&mtl.specularC, sizeof(mtl.specularC));
+    addBytes (&mtl.emissive, sizeof(mtl.emissive));
+    addBytes (&mtl.diffuse, sizeof(mtl.diffuse));
+    addBytes (&mtl.specular, sizeof(mtl.specular));
+    addBytes (&mtl.shininess, sizeof(mtl.shininess));
+    addMap (mtl.emissiveMap);
+    addMap (mtl.diffuseMap);
+    addMap (mtl.specularMap);
+    addMap (mtl.normalMap);
+
+    return key;
+
+}
 
-    this->_dsPool = app->device().createDescriptorPool(poolInfo);
+Mesh *MeshFactory::alloc (OBJ::Model const *model, int grpId, VertexFormat fmt)
+{
+    // the descriptor set of a mesh with meshlets holds its meshlet buffer, so
+    // such meshes cannot share their sets
+    OBJ::Group const &grp = model->group(grpId);
+    std::string key;
+    if (grp.nIndices / 3 < kMeshletMinTris) {
+        key = materialKey (this->_app->scene(), model->material(grp.material));
+        auto it = this->_shared.find(key);
+        if (it != this->_shared.end()) {
+            return new Mesh (this->_app, model, grpId, fmt, it->second);
+        }
+    }
+
+    auto mesh = new Mesh (this->_app, model, grpId, fmt);
+    this->_allocDS (mesh);
+    if (! key.empty()) {
+        this->_shared.insert ({key, mesh});
+    }
+    return mesh;
+
+}
+
+MeshFactory::MeshFactory (Proj5 *app, int nMeshes)
+: _app(app), _poolSize(nMeshes), _nAvail(0), _dsPools()
+{
+    assert (nMeshes > 0);
 
     // create the layout for the material descriptor sets
-    // 1 UBO + up to 4 samplers for a mesh
-    std::array<vk::DescriptorSetLayoutBinding, 5> layoutBindings = {
+    // 1 UBO + up to 4 samplers + the meshlet buffer for a mesh
+    std::array<vk::DescriptorSetLayoutBinding, 6> layoutBindings = {
         vk::DescriptorSetLayoutBinding(
             0, /* binding */
             vk::DescriptorType::eUniformBuffer, /* descriptor type */
@@ -271,16 +512,23 @@ MeshFactory::MeshFactory (Proj5 *app, int nMeshes)
             vk::ShaderStageFlagBits::eFragment, /* stages */
             nullptr); /* samplers */
     }
+    layoutBindings[Mesh::kMeshletBind] = vk::DescriptorSetLayoutBinding(
+        Mesh::kMeshletBind, /* binding */
+        vk::DescriptorType::eStorageBuffer, /* descriptor type */
+        1, /* descriptor count */
+        vk::ShaderStageFlagBits::eCompute, /* stages */
+        nullptr); /* samplers */
 
     // we allow undefined samplers, since not every object has every kind of
     // texture.  To enable this mode, we have to pass the address of a
     // DescriptorSetLayoutBindingFlagsCreateInfo struct as the pNext field
     // of the DescriptorSetLayoutCreateInfo struct
-    std::array<vk::DescriptorBindingFlags,5> bindingFlags = {
+    std::array<vk::DescriptorBindingFlags,6> bindingFlags = {
             vk::DescriptorBindingFlags{},
             vk::DescriptorBindingFlagBits::ePartiallyBound,
             vk::DescriptorBindingFlagBits::ePartiallyBound,
             vk::DescriptorBindingFlagBits::ePartiallyBound,
+            vk::DescriptorBindingFlagBits::ePartiallyBound,
             vk::DescriptorBindingFlagBits::ePartiallyBound
         };
     vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagInfo(bindingFlags);
@@ -295,15 +543,50 @@ MeshFactory::MeshFactory (Proj5 *app, int nMeshes)
 MeshFactory::~MeshFactory ()
 {
     this->_app->device().destroyDescriptorSetLayout(this->_layout);
-    this->_app->device().destroyDescriptorPool(this->_dsPool);
+    for (auto pool : this->_dsPools) {
+        this->_app->device().destroyDescriptorPool(pool);
+    }
+
+}
+
+void MeshFactory::_newPool ()
+{
+    // allocate the descriptor pool; there is one UBO, at most 4 samplers, and at
+    // most one meshlet buffer per mesh
+    int nUBOs = this->_poolSize;
+    int nSamplers = 4 * this->_poolSize;
+    int nStorage = this->_poolSize;
+    std::array<vk::DescriptorPoolSize, 3> poolSizes = {
+            vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, nUBOs),
+            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, nSamplers),
+            vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, nStorage)
+        };
+    vk::DescriptorPoolCreateInfo poolInfo(
+        {}, /* flags */
+        this->_poolSize, /* max sets; one per mesh */
+        poolSizes); /* pool sizes */
+
+    this->_dsPools.push_back(this->_app->device().createDescriptorPool(poolInfo));
+    this->_nAvail = this->_poolSize;
 
 }
 
 void MeshFactory::_allocDS (Mesh *mesh)
 {
-    vk::DescriptorSetAllocateInfo allocInfo(this->_dsPool, this->_layout);
+    if (this->_nAvail == 0) {
+        this->_newPool();
+    }
+    this->_nAvail--;
+
+    vk::DescriptorSetAllocateInfo allocInfo(this->_dsPools.back(), this->_layout);
     mesh->descSet = (this->_app->device().allocateDescriptorSets(allocInfo))[0];
 
+    this->_writeDS (mesh);
+
+}
+
+void MeshFactory::_writeDS (Mesh *mesh)
+{
     auto uboInfo = mesh->ubo->descInfo();
     std::vector<vk::WriteDescriptorSet> descWrites = {
             vk::WriteDescriptorSet(
@@ -316,8 +599,9 @@ void MeshFactory::_allocDS (Mesh *mesh)
                 nullptr) /* texel buffer view */
         };
 
+    // a virtual albedo texture has its own descriptor set (see window.cpp)
     vk::DescriptorImageInfo albedoInfo;
-    if (mesh->albedoSrc == MtlPropertySrc::eTexture) {
+    if (mesh->albedoTexture.isDefined()) {
         albedoInfo = mesh->albedoTexture.imageInfo();
         descWrites.push_back(
             vk::WriteDescriptorSet(
@@ -372,6 +656,21 @@ void MeshFactory::_allocDS (Mesh *mesh)
                 nullptr)); /* texel buffer view */
     }
 
+    vk::DescriptorBufferInfo meshletInfo;
+    if (mesh->hasMeshlets()) {
+        meshletInfo = vk::DescriptorBufferInfo(
+            mesh->meshletBuf->vkBuffer(), 0, VK_WHOLE_SIZE);
+        descWrites.push_back(
+            vk::WriteDescriptorSet(
+                mesh->descSet,
+                Mesh::kMeshletBind, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eStorageBuffer, /* descriptor type */
+                nullptr, /* image info */
+                meshletInfo, /* buffer info */
+                nullptr)); /* texel buffer view */
+    }
+
     this->_app->device().updateDescriptorSets (descWrites, nullptr);
 
 }
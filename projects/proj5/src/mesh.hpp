@@ -18,8 +18,14 @@
 #include "obj.hpp"
 #include "app.hpp"
 #include "shader-uniforms.hpp"
+#include "terrain-stream.hpp"
+#include "terrain.hpp"
 #include "vertex.hpp"
 
+/// meshes with at least this many triangles are split into meshlets, which are
+/// culled on the GPU before drawing; smaller meshes are drawn as a whole
+constexpr uint32_t kMeshletMinTris = 4096;
+
 /// source of information about a material component
 /// (also see the constants in shader-uniforms.hpp)
 enum class MtlPropertySrc {
@@ -41,7 +47,7 @@ struct TextureProperty {
     /// is this property defined?
     bool isDefined () const { return (this->txt != nullptr); }
 
-    void define (Proj5 *app, cs237::Image2D *img);
+    void define (Proj5 *app, SceneTexture const *tex);
 
     void define (Proj5 *app, std::string const &name)
     {
@@ -68,8 +74,30 @@ struct TextureProperty {
 /// the information needed to render a mesh
 struct Mesh {
     vk::Device device;                  ///< the Vulkan device
-    cs237::VertexBuffer<Vertex> *vBuf;  ///< vertex-array for this mesh
-    cs237::IndexBuffer<uint32_t> *iBuf; ///< the index array
+    VertexFormat vFormat;               ///< the format of the mesh's vertices
+    cs237::VertexBuffer<Vertex> *vBuf;  ///< vertex-array for this mesh (when
+                                        ///  vFormat == eFull)
+    cs237::VertexBuffer<CompactVertex> *cvBuf; ///< vertex-array for this mesh (when
+                                        ///  vFormat == eCompact)
+    VertexDecode decode;                ///< decoding parameters for compact vertices
+    cs237::IndexBuffer<uint32_t> *iBuf; ///< the index array, which holds the indices
+                                        ///  of each level of detail, one after the
+                                        ///  other; when the mesh has meshlets, the
+                                        ///  full-resolution indices are in meshlet order
+    std::vector<cs237::mesh::LOD> lods; ///< the levels of detail of the mesh, where
+                                        ///  level 0 is the full-resolution mesh and the
+                                        ///  offsets are relative to the start of `iBuf`
+    cs237::StorageBuffer<MeshletInfo> *meshletBuf; ///< the bounds of the mesh's
+                                        ///  meshlets (nullptr if the mesh is not
+                                        ///  split into meshlets)
+    uint32_t nMeshlets;                 ///< the number of meshlets
+    Terrain *terrain;                   ///< the chunks of a height-field mesh, which
+                                        ///  is drawn using `drawChunks` (nullptr
+                                        ///  for other meshes)
+    TerrainStreamer *streamer;          ///< the streamed tiles of a tiled height
+                                        ///  field, which are drawn by the streamer
+                                        ///  (nullptr for other meshes, which
+                                        ///  includes untiled height fields)
     vk::PrimitiveTopology prim;         ///< the primitive type for rendering the mesh
     cs237::AABBf_t aabb;                ///< model-space axis-aligned bounding box
                                         ///  for the mesh
@@ -78,6 +106,10 @@ struct Mesh {
     MtlPropertySrc albedoSrc;          ///< source of albedo
     glm::vec3 albedoColor;              ///< constant albedo (when albedoSrc == eConstant)
     TextureProperty albedoTexture;     ///< albedo texture (when albedoSrc == eTexture)
+    cs237::VirtualTexture *albedoVT;    ///< the albedo texture when it is a virtual
+                                        ///  texture (only for the ground; nullptr
+                                        ///  otherwise), in which case `albedoTexture`
+                                        ///  is undefined
     /* emissive color */
     MtlPropertySrc emissiveSrc;        ///< source of emissive color
     glm::vec3 emissiveColor;            ///< constant emissive
@@ -91,44 +123,119 @@ struct Mesh {
     /* normal map */
     TextureProperty nMap;              ///< normal-map information (when present)
 
+    const OBJ::Material *mtl;           ///< the material for the mesh (nullptr for
+                                        ///  the ground and for meshes that share
+                                        ///  another mesh's material state); used to
+                                        ///  define texture properties whose images
+                                        ///  are still loading
+
     vk::DescriptorSet descSet;          ///< the descriptor set for the material
                                         ///  UBO and samplers
-    MaterialUBO *ubo;                   ///< material-properties UBO
-
-    /// create a Mesh object by allocating and loading buffers for it.
-    /// \param app    the owning app
-    /// \param model  the `Model` that contains the mesh data
-    /// \param grpId  the index of the group in the model
-    Mesh (Proj5 *app, OBJ::Model const *model, int grpId);
-
-    /// create a Mesh object by triangulating a height field
+    MaterialUBO *ubo;                   ///< material-properties UBO (nullptr for
+                                        ///  meshes that share another mesh's
+                                        ///  descriptor set)
+
+    /// create a Mesh object by allocating and loading buffers for it.  If the
+    /// group's material textures were packed into a texture atlas, then the
+    /// texture coordinates are mapped to the atlas page.
+    /// \param app     the owning app
+    /// \param model   the `Model` that contains the mesh data
+    /// \param grpId   the index of the group in the model
+    /// \param fmt     the vertex format to use for the mesh
+    /// \param shared  if non-null, a mesh with the same material state whose
+    ///                textures, UBO, and descriptor set are used by this mesh;
+    ///                `shared` must outlive this mesh.
+    Mesh (
+        Proj5 *app,
+        OBJ::Model const *model,
+        int grpId,
+        VertexFormat fmt,
+        Mesh const *shared = nullptr);
+
+    /// create a Mesh object by triangulating a height field.  The mesh is
+    /// organized as a quadtree of chunks (see terrain.hpp) instead of meshlets.
+    /// If the height field's color map is a virtual texture, then its cache is
+    /// sized for the scene's viewport.  The mesh of a tiled height field only
+    /// holds the material state, since its geometry is streamed in by `streamer`.
     /// \param app    the owning app
     /// \param hf     the height-field
-    Mesh (Proj5 *app, HeightField const *hf);
+    /// \param fmt    the vertex format to use for the mesh (which must be
+    ///               `eCompact` for a tiled height field)
+    Mesh (Proj5 *app, HeightField const *hf, VertexFormat fmt);
 
     /// Mesh destuctor
     ~Mesh ();
 
-    /// return the number of indices in the mesh
-    uint32_t nIndices() const { return this->iBuf->nIndices(); }
+    /// return the number of indices in the full-resolution mesh
+    uint32_t nIndices() const { return this->lods[0].nIndices; }
+
+    /// return the number of levels of detail (including the full-resolution mesh)
+    uint32_t nLODs () const { return this->lods.size(); }
+
+    /// is the mesh represented using compact vertices?
+    bool isCompact () const { return (this->vFormat == VertexFormat::eCompact); }
+
+    /// the transform from the mesh's vertex positions to model space; this
+    /// transform is the identity for full vertices.
+    glm::mat4 posDecodeM () const
+    {
+        return this->isCompact() ? this->decode.posDecodeM() : glm::mat4(1.0f);
+    }
+
+    /// is the mesh split into meshlets?
+    bool hasMeshlets () const { return (this->meshletBuf != nullptr); }
 
     /// return the number of samplers required for this mesh
     int nSamplers () const
     {
         int n = 0;
-        if (this->albedoSrc == MtlPropertySrc::eTexture) { ++n; }
+        if (this->albedoTexture.isDefined()) { ++n; }
         if (this->emissiveSrc == MtlPropertySrc::eTexture) { ++n; }
         if (this->specularSrc == MtlPropertySrc::eTexture) { ++n; }
         if (this->nMap.txt != nullptr) { ++n; }
         return n;
     }
 
+    /// define the texture properties of the mesh's material whose images have
+    /// been loaded.  Until its image is loaded, a texture property is rendered
+    /// using the material's constant color (if any) as a placeholder.
+    /// \param app  the owning app
+    /// \return true if any texture properties were defined by this call
+    bool updateTextures (Proj5 *app);
+
+    /// are any of the mesh's texture images still being loaded?
+    bool hasPendingTextures () const;
+
     /// initialize the UBO for this mesh
     void initUBO (Proj5 *app);
 
+    /// update the contents of the UBO to reflect the current material state
+    void updateUBO ();
+
     /// record commands in the command buffer to draw the mesh using
     /// `vkCmdDrawIndexed`.
-    void draw (vk::CommandBuffer cmdBuf);
+    /// \param cmdBuf  the command buffer
+    /// \param lod     the level of detail to draw (0 is full resolution)
+    void draw (vk::CommandBuffer cmdBuf, uint32_t lod = 0);
+
+    /// record commands in the command buffer to draw the mesh's meshlets using
+    /// the indirect draw commands produced by the meshlet-culling shader.
+    /// \param cmdBuf    the command buffer
+    /// \param cmds      the buffer of draw commands
+    /// \param firstCmd  the index of the mesh's first command in `cmds`
+    /// \param maxDraws  the maximum number of draws per indirect-draw command
+    ///                  (1 if the device does not support multi-draw indirect)
+    void drawMeshlets (
+        vk::CommandBuffer cmdBuf,
+        vk::Buffer cmds,
+        uint32_t firstCmd,
+        uint32_t maxDraws);
+
+    /// record commands in the command buffer to draw the selected chunks of a
+    /// height-field mesh.
+    /// \param cmdBuf  the command buffer
+    /// \param chunks  the chunks to draw (see `Terrain::select`)
+    void drawChunks (vk::CommandBuffer cmdBuf, std::vector<Terrain::Chunk> const &chunks);
 
     /// binding indices for mesh uniforms
     static constexpr uint32_t kUBOBind = 0;
@@ -136,6 +243,62 @@ struct Mesh {
     static constexpr uint32_t kEmissiveBind = 2;
     static constexpr uint32_t kSpecularBind = 3;
     static constexpr uint32_t kNormalBind = 4;
+    static constexpr uint32_t kMeshletBind = 5;
+
+private:
+    /// create the vertex buffer and build the mesh's vertices in place using the
+    /// mesh's vertex format, which avoids a temporary vertex array.  Each vertex
+    /// is computed by `vertex(i)` and written to the mapped buffer exactly once.
+    /// The mesh's bounding box must already be set, since it is used to quantize
+    /// compact vertices.
+    /// \param app     the owning app
+    /// \param nVerts  the number of vertices
+    /// \param tcMin   the minimum texture coordinate of the vertices
+    /// \param tcMax   the maximum texture coordinate of the vertices
+    /// \param vertex  a function that maps an index i to the mesh's i'th vertex
+    template <typename VertexFn>
+    void _initVertexBuffer (
+        Proj5 *app,
+        uint32_t nVerts,
+        glm::vec2 tcMin,
+        glm::vec2 tcMax,
+        VertexFn const &vertex)
+    {
+        if (this->isCompact()) {
+            // quantize the vertices relative to the bounds of the mesh
+            this->decode = VertexDecode(this->aabb.min(), this->aabb.max(), tcMin, tcMax);
+            this->cvBuf = new cs237::VertexBuffer<CompactVertex>(app, nVerts);
+            auto dst = this->cvBuf->map();
+            for (uint32_t i = 0;  i < nVerts;  ++i) {
+                dst[i] = CompactVertex(vertex(i), this->decode);
+            }
+        } else {
+            this->vBuf = new cs237::VertexBuffer<Vertex>(app, nVerts);
+            auto dst = this->vBuf->map();
+            for (uint32_t i = 0;  i < nVerts;  ++i) {
+                dst[i] = vertex(i);
+            }
+        }
+    }
+
+    /// create and initialize the index buffer.  If the mesh is large enough,
+    /// then it is split into meshlets and the indices are reordered to match.
+    /// The indices of the simplified levels of detail (if any) follow the
+    /// full-resolution indices in the buffer.
+    void _initIndexBuffer (
+        Proj5 *app,
+        uint32_t nIndices,
+        const uint32_t *indices,
+        uint32_t nVerts,
+        const glm::vec3 *pos,
+        uint32_t nLODs = 0,
+        const cs237::mesh::LOD *lods = nullptr,
+        uint32_t nLODIndices = 0,
+        const uint32_t *lodIndices = nullptr);
+
+    /// build the chunked vertex and index buffers of a height field that is
+    /// held in memory (see ground.cpp)
+    void _initGround (Proj5 *app, HeightField const *hf);
 
 };
 
@@ -145,47 +308,73 @@ struct Mesh {
 class MeshFactory {
 public:
 
-    /// constructor for the factory
+    /// constructor for the factory.  Since meshes are created as the scene
+    /// streams in, the total number is not known in advance; the factory
+    /// allocates additional descriptor pools as needed.
     /// \param app      the owing application
-    /// \param nMeshes  the number of meshes in the scene
+    /// \param nMeshes  the number of meshes to allocate descriptor sets for in each pool
     MeshFactory (Proj5 *app, int nMeshes);
 
     /// destructor
     ~MeshFactory ();
 
-    /// create a Mesh object by allocating and loading buffers for it.
+    /// create a Mesh object by allocating and loading buffers for it.  Meshes
+    /// that are not split into meshlets share the textures and descriptor set of
+    /// the first such mesh with the same material state (i.e., the same material
+    /// constants and texture images), which allows the meshes of objects whose
+    /// textures were packed into an atlas to be drawn without rebinding.
     /// \param model  the `Model` that contains the mesh data
     /// \param grpId  the index of the group in the model
-    Mesh *alloc (OBJ::Model const *model, int grpId)
-    {
-        auto mesh = new Mesh (this->_app, model, grpId);
-        this->_allocDS (mesh);
-        return mesh;
-    }
+    /// \param fmt    the vertex format to use for the mesh
+    Mesh *alloc (OBJ::Model const *model, int grpId, VertexFormat fmt = VertexFormat::eFull);
 
     /// create a Mesh object by triangulating a height field
     /// \param hf     the height-field
-    Mesh *alloc (HeightField const *hf)
+    /// \param fmt    the vertex format to use for the mesh
+    Mesh *alloc (HeightField const *hf, VertexFormat fmt = VertexFormat::eFull)
     {
-        auto mesh = new Mesh (this->_app, hf);
+        auto mesh = new Mesh (this->_app, hf, fmt);
         this->_allocDS (mesh);
         return mesh;
     }
 
+    /// update a mesh's UBO and descriptor set after some of its texture
+    /// properties have been defined.  The caller is responsible for making sure
+    /// that the descriptor set is not in use by the GPU.
+    /// \param mesh  the mesh to update
+    void update (Mesh *mesh)
+    {
+        mesh->updateUBO ();
+        this->_writeDS (mesh);
+    }
+
     /// the descriptor layout for mesh material descriptor sets
     vk::DescriptorSetLayout materialLayout () const { return this->_layout; }
 
 private:
     Proj5 *_app;                        ///< the owning application
-    vk::DescriptorPool _dsPool;         ///< the pool for allocating the per-mesh
-                                        ///  descriptor sets
+    int _poolSize;                      ///< the number of descriptor sets per pool
+    int _nAvail;                        ///< the number of unallocated descriptor sets
+                                        ///  in the current pool
+    std::vector<vk::DescriptorPool> _dsPools; ///< the pools for allocating the per-mesh
+                                        ///  descriptor sets; the last pool is the
+                                        ///  current pool
 
     /// the descriptor-set layout for the per-mesh sampler descriptor sets.
     vk::DescriptorSetLayout _layout;
 
+    /// the meshes whose material state can be shared, keyed by their material state
+    std::map<std::string, Mesh *> _shared;
+
     /// allocate the descriptor set for the mesh
     void _allocDS (Mesh *mesh);
 
+    /// write the UBO and texture descriptors for a mesh to its descriptor set
+    void _writeDS (Mesh *mesh);
+
+    /// allocate a new descriptor pool and make it the current pool
+    void _newPool ();
+
 };
 
 #endif // !_MESH_HPP_
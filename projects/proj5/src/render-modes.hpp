@@ -30,6 +30,10 @@ struct RenderFlags {
     bool spotLights;            //< enable spot lights for Deferred rendering
     bool emissiveLighting;      //< enable emissive lighting for Deferred rendering
     bool shadows;               //< enable shadows for Deferred rendering (extra credit)
+    bool meshletCulling;        //< enable GPU culling of the meshlets of large meshes
+                                //  in textured mode
+    bool lodSelection;          //< enable picking the level of detail of meshes
+                                //  based on their screen-space error
 
 /** HINT: you may want to add additional components to specify which buffer gets
  ** displayed or to enable wire-frame rendering of the light volumes.
@@ -39,7 +43,8 @@ struct RenderFlags {
     RenderFlags ()
     : mode(RenderMode::eTextured),
       dirLight(true), spotLights(true), emissiveLighting(true),
-      shadows(false) // extra credit
+      shadows(false), // extra credit
+      meshletCulling(true), lodSelection(true)
     { }
 
     /// toggle the directional-lighting state
@@ -54,6 +59,12 @@ struct RenderFlags {
     /// toggle the shadow state (extra credit)
     void toggleShadows () { this->shadows = !this->shadows; }
 
+    /// toggle meshlet culling
+    void toggleMeshletCulling () { this->meshletCulling = !this->meshletCulling; }
+
+    /// toggle level-of-detail selection
+    void toggleLODSelection () { this->lodSelection = !this->lodSelection; }
+
 };
 
 #endif // !_RENDER_MODES_HPP_
@@ -15,465 +15,590 @@
 #include "cs237/cs237.hpp"
 #include "json.hpp"
 #include "scene.hpp"
+#include "bundle.hpp"
+#include "height-tiles.hpp"
 #include <map>
+#include <filesystem>
 #include <functional>
 #include <iostream>
 
-/* helper functions to make extracting values from the JSON easier */
+/* helper functions for binding the JSON scene description to values */
 
-/// load a floating-point value from a JSON object
-/// \return an optional float; None means the field did not exist or had the wrong
-///         type
-static std::optional<float> loadFloat (json::Object const *jv, std::string const &field)
+/// read a vec3f from a JSON object with "x", "y", and "z" fields
+/// \return false if there is an error
+static bool readVec3 (json::Reader &r, glm::vec3 &vec)
 {
-    const json::Number *f = jv->fieldAsNumber(field);
-    if (f == nullptr) {
-        return std::optional<float>();
-    } else {
-        return std::optional<float>(static_cast<float>(f->realVal()));
-    }
+    return r.readObject ({{"x", vec.x}, {"y", vec.y}, {"z", vec.z}});
 }
 
-//! load a vec3f from a JSON object.
-//! \return false if okay, true if there is an error.
-static bool loadVec3 (json::Object const *jv, glm::vec3 &vec)
+/// read a RGB color from a JSON object
+/// \return false if there is an error
+static bool readRGB (json::Reader &r, glm::vec3 &color)
 {
-    auto x = loadFloat(jv, "x");
-    auto y = loadFloat(jv, "y");
-    auto z = loadFloat(jv, "z");
-
-    if (x.has_value() && y.has_value() && z.has_value()) {
-        vec = glm::vec3(*x, *y, *z);
-        return false;
-    } else {
-        // error: missing or incorrectly typed field
-        return true;
-    }
+    return r.readObject ({{"r", color.r}, {"g", color.g}, {"b", color.b}});
 }
 
-static bool loadVec3 (json::Object const *jv, std::string const &field, glm::vec3 &vec)
+/// read a RGBA color from a JSON object
+/// \return false if there is an error
+static bool readRGBA (json::Reader &r, glm::vec4 &color)
 {
-    const json::Object *jVec = jv->fieldAsObject (field);
-
-    return (jVec == nullptr) || loadVec3(jVec, vec);
+    return r.readObject ({
+            {"r", color.r}, {"g", color.g}, {"b", color.b}, {"a", color.a}
+        });
 }
 
-static bool loadPlane (json::Object const *jv, cs237::Planef_t &plane)
+/// read a plane, which is specified by its normal and distance from the origin
+/// \return false if there is an error
+static bool readPlane (json::Reader &r, cs237::Planef_t &plane)
 {
-    auto nx = loadFloat(jv, "nx");
-    auto ny = loadFloat(jv, "ny");
-    auto nz = loadFloat(jv, "nz");
-    auto d = loadFloat(jv, "d");
-
-    if (nx.has_value() && ny.has_value() && nz.has_value() && d.has_value()) {
-        plane = cs237::Planef_t(glm::vec3(*nx, *ny, *nz), *d);
+    glm::vec3 n;
+    float d;
+    if (! r.readObject ({{"nx", n.x}, {"ny", n.y}, {"nz", n.z}, {"d", d}})) {
         return false;
-    } else {
-        // error: missing or incorrectly typed field
-        return true;
     }
+    plane = cs237::Planef_t(n, d);
+    return true;
 }
 
-static bool loadPlane (
-    json::Object const *jv,
-    std::string const &field,
-    cs237::Planef_t &plane)
+/// read a size from a JSON object with "wid" and "ht" fields
+/// \return false if there is an error
+static bool readSize (json::Reader &r, vk::Extent2D &size)
 {
-    const json::Object *jPlane = jv->fieldAsObject (field);
-
-    return (jPlane == nullptr) || loadPlane(jPlane, plane);
-}
-
-//! load a RGB color from a JSON object.
-//! \return false if okay, true if there is an error.
-static bool loadRGB (json::Object const *jv, glm::vec3 &color)
-{
-    auto r = loadFloat(jv, "r");
-    auto g = loadFloat(jv, "g");
-    auto b = loadFloat(jv, "b");
-    if (r.has_value() && g.has_value() && b.has_value()) {
-        color = glm::vec3(*r, *g, *b);
-        return false;
-    } else {
-        // error: missing or incorrectly typed field
-        return true;
-    }
+    return r.readObject ({{"wid", size.width}, {"ht", size.height}});
 }
 
-//! load a RGBA color from a JSON object.
-//! \return false if okay, true if there is an error.
-static bool loadRGBA (json::Object const *jv, glm::vec4 &color)
-{
-    auto r = loadFloat(jv, "r");
-    auto g = loadFloat(jv, "g");
-    auto b = loadFloat(jv, "b");
-    auto a = loadFloat(jv, "a");
-    if (r.has_value() && g.has_value() && b.has_value() && a.has_value()) {
-        color = glm::vec4(*r, *g, *b, *a);
-        return false;
-    } else {
-        // error: missing or incorrectly typed field
-        return true;
-    }
-}
-
-static bool loadRGBA (json::Object const *jv, std::string const &field, glm::vec4 &color)
-{
-    const json::Object *jVec = jv->fieldAsObject (field);
-
-    return (jVec == nullptr) || loadRGBA(jVec, color);
-}
-
-/// load an integer from a JSON object
-//! \return false if okay, true if there is an error.
-static bool loadInt (json::Object const *jv, std::string const &field, int &n)
-{
-    const json::Integer *jn = jv->fieldAsInteger (field);
-
-    if (jn == nullptr) {
-        return true;
-    } else {
-        n = static_cast<int>(jn->intVal());
-        return false;
-    }
-}
-
-/// load an unsigned integer from a JSON object
-//! \return false if okay, true if there is an error.
-static bool loadUInt (json::Object const *jv, std::string const &field, uint32_t &n)
-{
-    const json::Integer *jn = jv->fieldAsInteger (field);
-
-    if ((jn == nullptr) || (jn->intVal() < 0)) {
-        return true;
-    } else {
-        n = static_cast<uint32_t>(jn->intVal());
-        return false;
-    }
-}
-
-//! load a window size from a JSON object.
-//! \return false if okay, true if there is an error.
-static bool loadSize (json::Object const *jv, uint32_t &wid, uint32_t &ht)
-{
-    if (loadUInt(jv, "wid", wid) || loadUInt(jv, "ht", ht)) {
+/// the description of the ground in the scene file
+struct GroundDesc {
+    cs237::Planef_t plane;              ///< the ground plane
+    std::string hf;                     ///< the height-field file
+    std::string cmap;                   ///< the color-map file
+    std::optional<std::string> nmap;    ///< the normal-map file
+    float wid, ht;                      ///< the size of the ground
+    float vScale;                       ///< the vertical scale of the height field
+    glm::vec3 color;                    ///< the color of the ground
+};
+
+namespace json {
+
+template <>
+struct Binder<SpotLight> {
+    static bool read (Reader &r, SpotLight &light)
+    {
+        float aten[3];
+        if (! r.readObject ({
+                {"pos", light.pos, readVec3},
+                {"direction", light.dir, readVec3},
+                {"cutoff", light.cutoff},
+                {"exponent", light.exponent},
+                {"intensity", light.intensity, readRGB},
+                {"attenuation", aten}
+            })) {
+            return false;
+        }
+        light.k0 = aten[0];
+        light.k1 = aten[1];
+        light.k2 = aten[2];
+        // normalize the light's direction vector
+        light.dir = glm::normalize(light.dir);
+        // make sure that the light intensity is in 0..1 range
+        light.intensity = glm::clamp(light.intensity, 0.0f, 1.0f);
         return true;
-    } else {
-        return false;
     }
-
-}
-
-//! load a ground size from a JSON object.
-//! \return false if okay, true if there is an error.
-static bool loadGroundSize (json::Object const *jv, float &wid, float &ht)
+};
+
+template <>
+struct Binder<Rain> {
+    static bool read (Reader &r, Rain &rain)
+    {
+        auto readGen = [&rain] (Reader &r) {
+            return r.readObject ({
+                    {"size", rain.genExtent, readSize},
+                    {"origin", rain.genOrigin, readVec3},
+                    {"tan", rain.genTan, readVec3},
+                    {"bitan", rain.genBitan, readVec3}
+                });
+        };
+        return r.readObject ({
+                {"num-particles", rain.numParticles},
+                {"generator", readGen},
+                {"death-plane", rain.deathPlane, readPlane},
+                {"velocity", rain.initialVelocity, readVec3},
+                {"acceleration", rain.acceleration, readVec3},
+                {"color", rain.color, readRGBA}
+            });
+    }
+};
+
+template <>
+struct Binder<GroundDesc> {
+    static bool read (Reader &r, GroundDesc &ground)
+    {
+        auto readSize = [&ground] (Reader &r) {
+            return r.readObject ({{"wid", ground.wid}, {"ht", ground.ht}});
+        };
+        return r.readObject ({
+                {"plane", ground.plane, readPlane},
+                {"height-field", ground.hf},
+                {"color-map", ground.cmap},
+                {"normal-map", ground.nmap},
+                {"size", readSize},
+                {"v-scale", ground.vScale},
+                {"color", ground.color, readRGB}
+            });
+    }
+};
+
+} // namespace json
+
+/// the maximum number of loaded assets that can be waiting to be uploaded
+/// to the GPU; loading jobs block when the queue is full.
+constexpr size_t kAssetQueueSize = 32;
+
+/// ground maps that are larger than this size (in either dimension) are loaded
+/// as virtual textures (when enabled)
+constexpr uint32_t kVirtualTextureSize = 4096;
+
+/// load an image as a virtual texture.  The tiles are read from a page file
+/// that is stored next to the image ("<file>.vt"); the page file is built from
+/// the image when it is missing or older than the image.
+/// \param file      the path to the image file
+/// \param nMap      true if the image is a normal map
+/// \param jobs      the job system used to build the page file
+/// \param[out] img  set to the image when the texture is not virtual (i.e., it
+///                  is not large enough or the page file could not be written);
+///                  otherwise set to nullptr
+/// \return the page file or nullptr if the texture is not virtual
+static cs237::VTPageFile *loadPageFile (
+    std::string const &file,
+    bool nMap,
+    cs237::JobSystem *jobs,
+    cs237::Image2D *&img)
 {
-    if (jv == nullptr) {
-        return true;
+    std::string pageFile = file + ".vt";
+    img = nullptr;
+
+    std::error_code ec1, ec2;
+    auto imgTime = std::filesystem::last_write_time (file, ec1);
+    auto pageTime = std::filesystem::last_write_time (pageFile, ec2);
+    if (!ec1 && !ec2 && (imgTime <= pageTime)) {
+        auto pages = new cs237::VTPageFile (pageFile);
+        if (pages->isValid()) {
+            return pages;
+        }
+        delete pages;
+    }
+
+    // normal data should not be sRGB encoded!
+    img = nMap ? new cs237::DataImage2D(file) : new cs237::Image2D(file);
+    if (std::max(img->width(), img->height()) <= kVirtualTextureSize) {
+        return nullptr;
+    }
+
+    // build the page file; failure is not an error, since the scene directory
+    // might not be writable, in which case we use the image
+    if (cs237::VTPageFile::build (
+        img, pageFile,
+        cs237::VTPageFile::kTileSize, cs237::VTPageFile::kBorder,
+        jobs))
+    {
+        auto pages = new cs237::VTPageFile (pageFile);
+        if (pages->isValid()) {
+            delete img;
+            img = nullptr;
+            return pages;
+        }
+        delete pages;
     }
 
-    const json::Number *w = jv->fieldAsNumber ("wid");
-    const json::Number *h = jv->fieldAsNumber ("ht");
-
-    if ((w == nullptr) || (h == nullptr)) {
-        return true;
-    }
-    else {
-        wid = static_cast<float>(w->realVal());
-        ht = static_cast<float>(h->realVal());
-        return false;
-    }
+    return nullptr;
 
 }
 
-//! load a float from a JSON object.
-//! \return false if okay, true if there is an error.
-static bool loadFloat (json::Number const *jv, float &f)
+/// height fields that are larger than this size (in either dimension) are
+/// loaded as tile files (when enabled)
+constexpr uint32_t kTiledHeightFieldSize = 4096;
+
+/// load a height field as a tile file.  The tile file is stored next to the
+/// image ("<file>.hft"); it is built from the image when it is missing or older
+/// than the image, which is the only time that the whole image is loaded.
+/// \param file      the path to the height-field image
+/// \param jobs      the job system used to build the tile file
+/// \param[out] img  set to the image when the height field is not tiled (i.e.,
+///                  it is not large enough or the tile file could not be
+///                  written); otherwise set to nullptr
+/// \return the tile file or nullptr if the height field is not tiled
+static HeightTileFile *loadHeightTiles (
+    std::string const &file,
+    cs237::JobSystem *jobs,
+    cs237::Image2D *&img)
 {
-    if (jv == nullptr) {
-        return true;
-    }
-    else {
-        f = static_cast<float>(jv->realVal());
-        return false;
+    std::string tileFile = file + ".hft";
+    img = nullptr;
+
+    std::error_code ec1, ec2;
+    auto imgTime = std::filesystem::last_write_time (file, ec1);
+    auto tileTime = std::filesystem::last_write_time (tileFile, ec2);
+    if (!ec1 && !ec2 && (imgTime <= tileTime)) {
+        auto tiles = new HeightTileFile (tileFile);
+        if (tiles->isValid()) {
+            return tiles;
+        }
+        delete tiles;
     }
-}
 
-/// load information about the particle system
-/// \return false if okay, true if there is an error.
-static bool loadRain (json::Object const *jv, Rain &rain)
-{
-    const json::Object *jRain = jv->fieldAsObject ("rain");
-    if (jRain == nullptr) {
-        std::cerr << "Cannot find 'rain' field" << std::endl;
-        return true;
+    // the height field is not flipped (see `HeightField`)
+    img = new cs237::Image2D(file, false);
+    if (std::max(img->width(), img->height()) <= kTiledHeightFieldSize) {
+        return nullptr;
     }
 
-    const json::Object *jGen = jRain->fieldAsObject("generator");
-    if (jGen == nullptr) {
-        std::cerr << "Cannot find 'generator' field in 'rain' object" << std::endl;
-        return true;
+    // build the tile file; failure is not an error, since the scene directory
+    // might not be writable, in which case we use the image
+    if (HeightTileFile::build (img, tileFile, HeightTileFile::kTileQuads, jobs)) {
+        auto tiles = new HeightTileFile (tileFile);
+        if (tiles->isValid()) {
+            delete img;
+            img = nullptr;
+            return tiles;
+        }
+        delete tiles;
     }
 
-    const json::Object *jSize = jGen->fieldAsObject("size");
-
-    if (loadUInt(jRain, "num-particles", rain.numParticles)
-    ||  (jSize == nullptr)
-    ||  loadSize(jSize, rain.genExtent.width, rain.genExtent.height)
-    ||  loadVec3(jGen, "origin", rain.genOrigin)
-    ||  loadVec3(jGen, "tan", rain.genTan)
-    ||  loadVec3(jGen, "bitan", rain.genBitan)
-    ||  loadPlane(jRain, "death-plane", rain.deathPlane)
-    ||  loadVec3(jRain, "velocity", rain.initialVelocity)
-    ||  loadVec3(jRain, "acceleration", rain.acceleration)
-    ||  loadRGBA(jRain, "color", rain.color)) {
-        return true;
-    }
+    return nullptr;
 
-    return false;
 }
 
 /***** class Scene member functions *****/
 
-bool Scene::load (std::string const &path)
+bool Scene::load (std::string const &path, bool virtTex, bool tiledHF)
 {
     if (this->_loaded) {
         std::cerr << "Scene is already loaded" << std::endl;
         return true;
     }
     this->_loaded = true;
+    this->_loadStart = std::chrono::steady_clock::now();
+
+    // the scene description comes either from the bundle or from the
+    // "scene.json" file in the scene directory
+    std::string sceneDir;
+    json::Reader *rdr;
+    if (Bundle::isBundle (path)) {
+        this->_bundle = new Bundle (path);
+        if (! this->_bundle->isValid()) {
+            std::cerr << "Invalid scene bundle \"" << path << "\"\n";
+            return true;
+        }
+        std::string_view text = this->_bundle->sceneText();
+        rdr = new json::Reader (text.data(), text.size(), path);
+    } else {
+        sceneDir = path + "/";
+        rdr = new json::Reader (sceneDir + "scene.json");
+    }
 
-    std::string sceneDir = path + "/";
-
-    // load the scene description file
-    json::Value *root = json::parseFile(sceneDir + "scene.json");
+    // we use a map to keep track of which models have already been loaded
+    std::map<std::string, int> objMap;
+    std::vector<std::string> modelFiles;
+
+    auto readCamera = [this] (json::Reader &r) {
+        return r.readObject ({
+                {"size", [this] (json::Reader &r) {
+                        return r.readObject ({{"wid", this->_wid}, {"ht", this->_ht}});
+                    }},
+                {"fov", this->_fov},
+                {"pos", this->_camPos, readVec3},
+                {"look-at", this->_camAt, readVec3},
+                {"up", this->_camUp, readVec3}
+            });
+    };
+
+    auto readLighting = [this] (json::Reader &r) {
+        return r.readObject ({
+                {"direction", this->_lightDir, readVec3},
+                {"intensity", this->_lightI, readRGB},
+                {"ambient", this->_ambI, readRGB},
+                {"shadow", this->_shadowFactor},
+                {"lights", this->_spotLights}
+            });
+    };
+
+    // the objects are converted to instances as they are read, which avoids
+    // building an intermediate representation of large scenes
+    std::string objFile;
+    auto readObj = [&] (json::Reader &r) {
+        SceneObj obj;
+        glm::vec3 pos, xAxis, yAxis, zAxis;
+        auto readFrame = [&] (json::Reader &r) {
+            return r.readObject ({
+                    {"x-axis", xAxis, readVec3},
+                    {"y-axis", yAxis, readVec3},
+                    {"z-axis", zAxis, readVec3}
+                });
+        };
+        if (! r.readObject ({
+                {"file", objFile},
+                {"pos", pos, readVec3},
+                {"frame", readFrame},
+                {"color", obj.color, readRGB}
+            })) {
+            return false;
+        }
+        // have we already loaded this model?
+        auto it = objMap.find(objFile);
+        if (it != objMap.end()) {
+            obj.model = it->second;
+        }
+        else {
+            // add the model to the map; it gets loaded below
+            obj.model = static_cast<int>(modelFiles.size());
+            modelFiles.push_back(objFile);
+            objMap.insert (std::pair<std::string, int> (objFile, obj.model));
+        }
+        // set the object-space to world-space transform
+        obj.toWorld = glm::mat4 (
+            glm::vec4 (xAxis, 0.0f),
+            glm::vec4 (yAxis, 0.0f),
+            glm::vec4 (zAxis, 0.0f),
+            glm::vec4 (pos, 1.0f));
+        this->_objs.push_back (obj);
+        return true;
+    };
 
-    // check for errors
-    if (root == nullptr) {
+    // load the scene description
+    std::optional<GroundDesc> ground;
+    if (rdr->failed()) {
         std::cerr << "Unable to load scene \"" << path << "\"\n";
-        return true;
-    } else if (! root->isObject()) {
-        std::cerr << "Invalid scene description in \"" << path
-            << "\"; root is not an object" << std::endl;
+        delete rdr;
         return true;
     }
-    const json::Object *rootObj = root->asObject();
-
-    // load the camera info
-    const json::Object *cam = rootObj->fieldAsObject ("camera");
-    if ((cam == nullptr)
-    ||  loadSize (cam->fieldAsObject ("size"), this->_wid, this->_ht)
-    ||  loadFloat (cam->fieldAsNumber ("fov"), this->_fov)
-    ||  loadVec3 (cam->fieldAsObject ("pos"), this->_camPos)
-    ||  loadVec3 (cam->fieldAsObject ("look-at"), this->_camAt)
-    ||  loadVec3 (cam->fieldAsObject ("up"), this->_camUp)) {
-        std::cerr << "Invalid scene description in \"" << path
-            << "\"; bad camera" << std::endl;
+    if (! rdr->readObject ({
+            {"camera", readCamera},
+            {"lighting", readLighting},
+            {"objects", [&readObj] (json::Reader &r) { return r.readArray (readObj); }},
+            {"ground", ground},
+            {"rain", this->_rain}
+        })
+    ||  (rdr->next() != json::E_EOF)) {
+        std::cerr << "Invalid scene description in \"" << path << "\"\n";
+        delete rdr;
         return true;
     }
+    delete rdr;
 
-    // load the lighting information
-    const json::Object *lighting = rootObj->fieldAsObject ("lighting");
-    if ((lighting == nullptr)
-    ||  loadVec3 (lighting->fieldAsObject ("direction"), this->_lightDir)
-    ||  loadRGB (lighting->fieldAsObject ("intensity"), this->_lightI)
-    ||  loadRGB (lighting->fieldAsObject ("ambient"), this->_ambI)
-    ||  loadFloat (lighting->fieldAsNumber ("shadow"), this->_shadowFactor)) {
-        std::cerr << "Invalid scene description in \"" << path
-            << "\"; bad lighting\n";
-        return true;
-    }
     // make sure that the light direction is a unit vector
     this->_lightDir = glm::normalize(this->_lightDir);
     // make sure that color values are in 0..1 range
     this->_lightI = glm::clamp(this->_lightI, 0.0f, 1.0f);
     this->_ambI = glm::clamp(this->_ambI, 0.0f, 1.0f);
-    // get the array of spot lights; we allow at most 4 lights
-    json::Array const *lights = lighting->fieldAsArray("lights");
-    if ((lights == nullptr) || (lights->length() == 0)) {
+    if (this->_spotLights.empty()) {
         std::cerr << "Invalid scene description in \"" << path
             << "\"; bad lights array\n";
         return true;
     }
-    // allocate space for the lights in the scene
-    this->_spotLights.resize(lights->length());
-    for (int i = 0;  i < lights->length();  i++) {
-        json::Object const *light = (*lights)[i]->asObject();
-        if (loadVec3 (light->fieldAsObject("pos"), this->_spotLights[i].pos)
-        ||  loadVec3 (light->fieldAsObject("direction"), this->_spotLights[i].dir)
-        ||  loadFloat (light->fieldAsNumber("cutoff"), this->_spotLights[i].cutoff)
-        ||  loadFloat (light->fieldAsNumber("exponent"), this->_spotLights[i].exponent)
-        ||  loadRGB (light->fieldAsObject("intensity"), this->_spotLights[i].intensity)) {
-            std::cerr << "Invalid scene description in \"" << path
-                << "\"; bad lighting\n";
-            return true;
-        }
-        // get attenuation coefficients
-        json::Array const *aten = light->fieldAsArray("attenuation");
-        if ((aten == nullptr)
-        ||  (aten->length() != 3)
-        ||  loadFloat((*aten)[0]->asNumber(), this->_spotLights[i].k0)
-        ||  loadFloat((*aten)[1]->asNumber(), this->_spotLights[i].k1)
-        ||  loadFloat((*aten)[2]->asNumber(), this->_spotLights[i].k2)) {
-            std::cerr << "Invalid scene description in \"" << path
-                << "\"; bad attenuation array\n";
-            return true;
-        }
-        // normalize the light's direction vector
-        this->_spotLights[i].dir = glm::normalize(this->_spotLights[i].dir);
-        // make sure that the light intensity is in 0..1 range
-        this->_spotLights[i].intensity = glm::clamp(this->_spotLights[i].intensity, 0.0f, 1.0f);
-    }
-
-    // get the object array from the JSON tree and check that it is non-empty
-    json::Array const *objs = rootObj->fieldAsArray("objects");
-    if ((objs == nullptr) || (objs->length() == 0)) {
+    if (this->_objs.empty()) {
         std::cerr << "Invalid scene description in \"" << path
             << "\"; missing objects array\n";
         return true;
     }
 
-    // allocate space for the objects in the scene
-    this->_objs.resize(objs->length());
-
-    // we use a map to keep track of which models have already been loaded
-    std::map<std::string, int> objMap;
-    std::map<std::string, int>::iterator it;
-
-    // load the objects in the scene
-    int numModels = 0;
-    for (int i = 0;  i < objs->length();  i++) {
-        json::Object const *object = (*objs)[i]->asObject();
-        if (object == nullptr) {
-            std::cerr << "Expected array of JSON objects for field 'objects' in \""
-                << path << "\"\n";
-            return true;
-        }
-        json::String const *file = object->fieldAsString("file");
-        json::Object const *frame = object->fieldAsObject("frame");
-        glm::vec3 pos, xAxis, yAxis, zAxis;
-        if ((file == nullptr) || (frame == nullptr)
-        ||  loadVec3 (object->fieldAsObject("pos"), pos)
-        ||  loadVec3 (frame->fieldAsObject("x-axis"), xAxis)
-        ||  loadVec3 (frame->fieldAsObject("y-axis"), yAxis)
-        ||  loadVec3 (frame->fieldAsObject("z-axis"), zAxis)
-        ||  loadRGB (object->fieldAsObject("color"), this->_objs[i].color)) {
-            std::cerr << "Invalid objects description in \"" << path << "\"\n";
-            return true;
+    // the job system used to load the scene's assets in the background
+    this->_jobs = new cs237::JobSystem;
+
+    // Load the models in the background.  The material library for a model is
+    // read as part of loading the model, so once a model's job has its materials,
+    // it spawns the jobs that load the texture images used by the materials and
+    // then hands the model's groups off to the upload stage.
+    this->_models.resize(modelFiles.size(), nullptr);
+    for (int id = 0;  id < modelFiles.size();  id++) {
+        std::string file = modelFiles[id];
+        this->_spawnLoad ([this, sceneDir, file, id] () {
+            OBJ::Model *model;
+            if (this->_bundle != nullptr) {
+                model = this->_bundle->model (file);
+                if (model == nullptr) {
+                    ERROR("model \"" + file + "\" is missing from the scene bundle");
+                }
+            } else {
+                model = new OBJ::Model (sceneDir + file, this->_jobs);
+            }
+            this->_models[id] = model;
+            for (auto grpIt = model->beginGroups();  grpIt != model->endGroups();  grpIt++) {
+                const OBJ::Material *mat = &model->material((*grpIt).material);
+//              this->_loadTexture (sceneDir, mat->ambientMap);
+                this->_loadTexture (sceneDir, mat->emissiveMap);
+                this->_loadTexture (sceneDir, mat->diffuseMap);
+                this->_loadTexture (sceneDir, mat->specularMap);
+                this->_loadTexture (sceneDir, mat->normalMap, true);
+            }
+            for (int grp = 0;  grp < model->numGroups();  grp++) {
+                this->_ready.push (SceneAsset{SceneAsset::Kind::eGroup, id, grp, ""});
+            }
+        });
+    }
+
+    // load the ground (if present)
+    if (ground.has_value()) {
+        this->_groundPlane = ground->plane;
+        // load the color-map texture; the color map can be much larger than
+        // the screen, so it may be a virtual texture
+        std::string cmapName = ground->cmap;
+        std::vector<cs237::Job *> texJobs = {
+                this->_loadTexture (sceneDir, cmapName, false, virtTex)
+            };
+        // load the optional normal-map texture, which is always a regular
+        // texture, since only the color map is streamed
+        std::string nmapName = ground->nmap.value_or("");
+        if (! nmapName.empty()) {
+            texJobs.push_back (this->_loadTexture (sceneDir, nmapName, true));
         }
-        // have we already loaded this model?
-        it = objMap.find(file->value());
-        int modelId;
-        if (it != objMap.end()) {
-            modelId = it->second;
-        }
-        else {
-            // load the model from the file sytem and add it to the map
-            modelId = numModels++;
-            OBJ::Model *model = new OBJ::Model (sceneDir + file->value());
-            this->_models.push_back(model);
-            objMap.insert (std::pair<std::string, int> (file->value(), modelId));
-        }
-        this->_objs[i].model = modelId;
-        // set the object-space to world-space transform
-        this->_objs[i].toWorld = glm::mat4 (
-            glm::vec4 (xAxis, 0.0f),
-            glm::vec4 (yAxis, 0.0f),
-            glm::vec4 (zAxis, 0.0f),
-            glm::vec4 (pos, 1.0f));
+        // load the height field once its textures are available
+        std::string hfFile = ground->hf;
+        float wid = ground->wid;
+        float ht = ground->ht;
+        float vScale = ground->vScale;
+        glm::vec3 color = ground->color;
+        this->_spawnLoad ([=] () {
+            SceneTexture const *cmapImg = this->textureByName (cmapName);
+            SceneTexture const *nmapImg = this->textureByName (nmapName);
+            if (this->_bundle != nullptr) {
+                std::vector<cs237::Image2D *> levels;
+                if (! this->_bundle->images (BundleKind::eHeightField, hfFile, levels)) {
+                    ERROR("height field \"" + hfFile + "\" is missing from the scene bundle");
+                }
+                this->_hf = new HeightField (
+                    levels[0], wid, ht, vScale, color,
+                    cmapImg, nmapImg);
+            } else if (tiledHF) {
+                cs237::Image2D *img;
+                HeightTileFile *tiles = loadHeightTiles (sceneDir + hfFile, this->_jobs, img);
+                if (tiles != nullptr) {
+                    this->_hf = new HeightField (
+                        tiles, wid, ht, vScale, color,
+                        cmapImg, nmapImg);
+                } else {
+                    this->_hf = new HeightField (
+                        img, wid, ht, vScale, color,
+                        cmapImg, nmapImg);
+                }
+            } else {
+                this->_hf = new HeightField (
+                    sceneDir + hfFile, wid, ht, vScale, color,
+                    cmapImg, nmapImg);
+            }
+            this->_ready.push (SceneAsset{SceneAsset::Kind::eGround, -1, -1, ""});
+        }, texJobs);
     }
 
-    // load the texture images used by the materials in the models
-    for (auto modIt = this->_models.begin();  modIt != this->_models.end();  modIt++) {
-        const OBJ::Model *model = *modIt;
-        for (auto grpIt = model->beginGroups();  grpIt != model->endGroups();  grpIt++) {
-            const OBJ::Material *mat = &model->material((*grpIt).material);
-//            this->_loadTexture (sceneDir, mat->ambientMap);
-            this->_loadTexture (sceneDir, mat->emissiveMap);
-            this->_loadTexture (sceneDir, mat->diffuseMap);
-            this->_loadTexture (sceneDir, mat->specularMap);
-            this->_loadTexture (sceneDir, mat->normalMap, true);
-        }
-    }
+    return false;
+}
 
-    // load the ground information (if present)
-    const json::Object *ground = rootObj->fieldAsObject ("ground");
-    if (ground != nullptr) {
-        float wid, ht;
-        float vScale;
-        glm::vec3 color;
-        json::Object const *plane = ground->fieldAsObject("plane");
-        json::String const *hf = ground->fieldAsString("height-field");
-        json::String const *cmap = ground->fieldAsString("color-map");
-        json::String const *nmap = ground->fieldAsString("normal-map");
-        if ((plane == nullptr) || (hf == nullptr) || (cmap == nullptr)
-        ||  loadGroundSize (ground->fieldAsObject("size"), wid, ht)
-        ||  loadFloat (ground->fieldAsNumber ("v-scale"), vScale)
-        ||  loadRGB (ground->fieldAsObject("color"), color)) {
-            std::cerr << "Invalid ground description in \"" << path << "\"\n";
-            return true;
-        }
-        // extract the normal-distance representation of the ground plane
-        if (loadPlane(plane, this->_groundPlane)) {
-            std::cerr << "Invalid ground plane in \"" << path << "\"\n";
-            return true;
-        }
-        // load the color-map texture
-        this->_loadTexture (sceneDir, cmap->value());
-        cs237::Image2D *cmapImg = this->textureByName (cmap->value());
-        // load the optional normal-map texture
-        cs237::Image2D *nmapImg;
-        if (nmap != nullptr) {
-            this->_loadTexture (sceneDir, nmap->value(), true);
-            nmapImg = this->textureByName (nmap->value());
+cs237::Job *Scene::_loadTexture (std::string path, std::string name, bool nMap, bool virt)
+{
+    if (name.empty()) {
+        return nullptr;
+    }
+
+    // textures in an atlas are loaded as part of their atlas page
+    SceneAtlasEntry atlas;
+    if (this->atlasEntry (name, atlas)) {
+        name = atlas.page;
+    }
+
+    std::lock_guard<std::mutex> lk(this->_texLock);
+
+    // have we already loaded (or started loading) this texture?
+    auto it = this->_texJobs.find(name);
+    if (it != this->_texJobs.end()) {
+        return it->second;
+    }
+    // add a placeholder to the _texs map; the job fills it in
+    this->_texs.insert (std::pair<std::string, SceneTexture *>(name, nullptr));
+    // spawn a job to load the image data
+    cs237::Job *job = this->_spawnLoad ([this, path, name, nMap, virt] () {
+        SceneTexture *tex = new SceneTexture{nullptr, {}, nullptr, nullptr};
+        if (this->_bundle != nullptr) {
+            // the bundle records whether the image is sRGB encoded; the texture
+            // is either block compressed or an uncompressed image with its levels
+            tex->cImg = this->_bundle->compressedImage (name);
+            if (tex->cImg == nullptr) {
+                std::vector<cs237::Image2D *> levels;
+                if (! this->_bundle->images (BundleKind::eTexture, name, levels)) {
+                    ERROR("texture \"" + name + "\" is missing from the scene bundle");
+                }
+                tex->img = levels[0];
+                tex->mips.assign (levels.begin() + 1, levels.end());
+            }
+        } else if (virt) {
+            // either the page file or the image is loaded
+            tex->pages = loadPageFile (path + name, nMap, this->_jobs, tex->img);
+        } else if (nMap) {
+            // normal data should not be sRGB encoded!
+            tex->img = new cs237::DataImage2D(path + name);
         } else {
-            nmapImg = nullptr;
+            tex->img = new cs237::Image2D(path + name);
         }
-        this->_hf = new HeightField (
-            sceneDir + hf->value(), wid, ht, vScale, color,
-            cmapImg, nmapImg);
-    }
+        {
+            std::lock_guard<std::mutex> lk(this->_texLock);
+            this->_texs[name] = tex;
+        }
+        this->_ready.push (SceneAsset{SceneAsset::Kind::eTexture, -1, -1, name});
+    });
+    this->_texJobs.insert (std::pair<std::string, cs237::Job *>(name, job));
 
-    if ((ground == nullptr) && (objs->length() == 0)) {
-        std::cerr << "Invalid empty scene description in \"" << path << "\"\n";
-        return true;
-    }
+    return job;
 
-    if (loadRain(rootObj, this->_rain)) {
-        std::cerr << "Invalid rain description in \"" << path << "\"\n";
-        return true;
-    }
-    // free up the space used by the JSON object
-    delete rootObj;
+}
+
+cs237::Job *Scene::_spawnLoad (
+    std::function<void()> const &fn,
+    std::vector<cs237::Job *> const &deps)
+{
+    // the count is incremented before the job is spawned (and thus before the
+    // spawning job finishes), so it only reaches zero once all loads are done
+    this->_nLoading++;
+    return this->_jobs->spawn ([this, fn] () {
+        try {
+            fn();
+        } catch (...) {
+            // the job system rethrows the exception from `nextAsset`
+            this->_nLoading--;
+            throw;
+        }
+        this->_nLoading--;
+    }, deps);
 
-    return false;
 }
 
-void Scene::_loadTexture (std::string path, std::string name, bool nMap)
+bool Scene::nextAsset (SceneAsset &asset)
 {
-    if (name.empty()) {
-        return;
-    }
-    // have we already loaded this texture?
-    if (this->_texs.find(name) != this->_texs.end()) {
-        return;
+    if (this->_ready.tryPop(asset)) {
+        return true;
     }
-    // load the image data;
-    cs237::Image2D *img;
-    if (nMap) {
-        // normal data should not be sRGB encoded!
-        img = new cs237::DataImage2D(path + name);
-    } else {
-        img = new cs237::Image2D(path + name);
+    if ((this->_jobs != nullptr) && (this->_nLoading.load() == 0)) {
+        // the loading jobs push their assets before they finish, so we need to
+        // check the queue again after seeing that there are no active loads.
+        if (this->_ready.tryPop(asset)) {
+            return true;
+        }
+        // loading is complete, so we can shut down the job system; `waitAll`
+        // rethrows any error raised by a loading job.
+        this->_jobs->waitAll();
+        this->_texJobs.clear();
+        delete this->_jobs;
+        this->_jobs = nullptr;
     }
-    // add to _texs map
-    this->_texs.insert (std::pair<std::string, cs237::Image2D *>(name, img));
+    return false;
 
 }
 
-cs237::Image2D *Scene::textureByName (std::string name) const
+SceneTexture const *Scene::textureByName (std::string name) const
 {
     if (! name.empty()) {
+        SceneAtlasEntry atlas;
+        if (this->atlasEntry (name, atlas)) {
+            name = atlas.page;
+        }
+        std::lock_guard<std::mutex> lk(this->_texLock);
         auto it = this->_texs.find(name);
         if (it != this->_texs.end()) {
             return it->second;
@@ -483,16 +608,38 @@ cs237::Image2D *Scene::textureByName (std::string name) const
 
 }
 
+bool Scene::atlasEntry (std::string const &name, SceneAtlasEntry &entry) const
+{
+    // only bundles have atlases; the bundle is not modified after it is loaded,
+    // so no locking is required
+    return (this->_bundle != nullptr)
+        && this->_bundle->atlasEntry (name, entry.page, entry.uvXform);
+
+}
+
 Scene::Scene ()
     : _loaded(false), _wid(0), _ht(0), _fov(0),
       _camPos(), _camAt(), _camUp(), _hf(nullptr),
-      _models(), _objs(), _spotLights(), _texs()
+      _models(), _objs(), _spotLights(), _texs(),
+      _jobs(nullptr), _ready(kAssetQueueSize), _nLoading(0),
+      _bundle(nullptr)
 { }
 
 Scene::~Scene ()
 {
+    if (this->_jobs != nullptr) {
+        // unblock any loading jobs that are waiting to push an asset and then
+        // wait for them to finish
+        this->_ready.close();
+        try {
+            this->_jobs->waitAll();
+        } catch (...) { }
+        delete this->_jobs;
+    }
     if (this->_hf != nullptr) { delete this->_hf; }
     for (auto it : this->_models) {
         delete it;
     }
+    // the models and images refer to the bundle's data, so it is deleted last
+    if (this->_bundle != nullptr) { delete this->_bundle; }
 }
@@ -19,10 +19,39 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <chrono>
 #include "cs237/cs237.hpp"
 #include "obj.hpp"
 #include "height-field.hpp"
 
+class Bundle;
+
+/// a texture image that has been loaded by the scene.  Textures that are loaded
+/// from a scene bundle come with pre-built mipmap levels, which may be block
+/// compressed.  Large ground maps may be loaded as virtual textures, in which
+/// case the image is not kept in memory.
+struct SceneTexture {
+    cs237::Image2D *img;                        ///< the texture image (nullptr for
+                                                ///  compressed and virtual textures)
+    std::vector<cs237::Image2D const *> mips;   ///< the pre-built mipmap levels that
+                                                ///  follow `img` (may be empty)
+    cs237::CompressedImage2D *cImg;             ///< the block-compressed texture with
+                                                ///  its mipmap levels (or nullptr)
+    cs237::VTPageFile *pages;                   ///< the tiles of a virtual texture
+                                                ///  (or nullptr)
+};
+
+/// the location of a texture that has been packed into a texture atlas (see
+/// `proj5-bake -atlas`).  The texture is replaced by the atlas page, so meshes
+/// must map their texture coordinates to the page.
+struct SceneAtlasEntry {
+    std::string page;   ///< the name of the atlas page that holds the texture
+    glm::vec4 uvXform;  ///< maps the texture's coordinates to the page: uv * xy + zw
+};
+
 /// an instance of a model, which has its own position and color.
 struct SceneObj {
     int model;          ///< the ID of the model that defines the object's mesh
@@ -65,6 +94,21 @@ struct Rain {
     glm::vec4 color;            ///< the color of a particle
 };
 
+/// a notification that an asset has been loaded in the background and is
+/// ready to be uploaded to the GPU
+struct SceneAsset {
+    /// the different kinds of assets
+    enum class Kind {
+        eGroup,         ///< a group of a model
+        eTexture,       ///< a texture image
+        eGround         ///< the height field for the ground
+    };
+    Kind kind;          ///< the kind of asset
+    int model;          ///< the model ID (for `eGroup`)
+    int group;          ///< the index of the group in the model (for `eGroup`)
+    std::string name;   ///< the texture name (for `eTexture`)
+};
+
 /// a scene consisting of an initial camera configuration and some objects
 class Scene {
   public:
@@ -73,10 +117,39 @@ class Scene {
     Scene ();
     ~Scene ();
 
-    /// load a scene from the specified path
-    /// \param path  the path to the scene directory
-    /// \return true if there were any errors loading the scene and false otherwise
-    bool load (std::string const &path);
+    /// load a scene from the specified path.  The scene description is loaded
+    /// before this method returns, but the models, textures, and ground are
+    /// loaded in the background; use `nextAsset` to get them as they become
+    /// available.  The path can either be a scene directory or a scene bundle
+    /// (see `bundle.hpp`), in which case the assets refer directly to the
+    /// memory-mapped bundle file.
+    /// \param path     the path to the scene directory or bundle
+    /// \param virtTex  if true, then a ground color map that is too large to be a
+    ///                 regular texture is loaded as a virtual texture (only for
+    ///                 scene directories)
+    /// \param tiledHF  if true, then height fields that are too large to keep in
+    ///                 memory are loaded as tile files, whose ground meshes are
+    ///                 streamed (only for scene directories)
+    /// \return true if there were any errors loading the scene description and
+    ///         false otherwise
+    bool load (std::string const &path, bool virtTex = false, bool tiledHF = false);
+
+    /// is the scene still loading assets in the background?
+    bool isLoading () const { return (this->_jobs != nullptr); }
+
+    /// the time in seconds since `load` was called
+    double loadTime () const
+    {
+        std::chrono::duration<double> t = std::chrono::steady_clock::now() - this->_loadStart;
+        return t.count();
+    }
+
+    /// get the next asset that has finished loading (without blocking).  Errors
+    /// raised while loading assets are rethrown by this method once the
+    /// rest of the assets have been loaded.
+    /// \param[out] asset  set to the loaded asset
+    /// \return true if there was an asset and false otherwise
+    bool nextAsset (SceneAsset &asset);
 
     /// the width of the viewport as specified by the scene
     uint32_t width () const { return this->_wid; }
@@ -127,7 +200,7 @@ class Scene {
     float shadowFactor () const { return this->_shadowFactor; }
 
     /// return the height-field that represents the ground object,
-    /// or nullptr if there is no ground in the scene.
+    /// or nullptr if there is no ground in the scene (or it has not been loaded yet).
     const HeightField *ground () const { return this->_hf; }
 
     cs237::Planef_t const &groundPlane () const { return this->_groundPlane; }
@@ -159,12 +232,20 @@ class Scene {
         return this->_models.end();
     }
 
-    /// return the i'th model in the scene
+    /// return the i'th model in the scene, or nullptr if it has not been loaded yet
     const OBJ::Model *model (int idx) const { return this->_models[idx]; }
 
-    /// lookup a texture image by name
-    /// \returns a pointer to the image object or nullptr if the image is not found
-    cs237::Image2D *textureByName (std::string name) const;
+    /// lookup a texture by name; textures that have been packed into an atlas
+    /// are mapped to their atlas page
+    /// \returns a pointer to the texture or nullptr if the texture is not found
+    ///          (or has not been loaded yet)
+    SceneTexture const *textureByName (std::string name) const;
+
+    /// get the location of a texture that has been packed into a texture atlas
+    /// \param name        the name of the texture
+    /// \param[out] entry  set to the atlas page and texture-coordinate transform
+    /// \return false if the texture is not in an atlas
+    bool atlasEntry (std::string const &name, SceneAtlasEntry &entry) const;
 
     /// get information about the rain particle system
     const Rain & rain () const { return this->_rain; }
@@ -196,15 +277,44 @@ class Scene {
 
     std::vector<OBJ::Model const *> _models;            ///< the OBJ models in the scene
     std::vector<SceneObj> _objs;                        ///< the objects in the scene
-    std::map<std::string, cs237::Image2D *> _texs;      ///< the textures keyed by name
+    std::map<std::string, SceneTexture *> _texs;        ///< the textures keyed by name
+    std::map<std::string, cs237::Job *> _texJobs;       ///< the texture-loading jobs keyed
+                                                        ///  by name (only used while loading)
+    mutable std::mutex _texLock;                        ///< lock that protects `_texs`
+                                                        ///  and `_texJobs` during loading
 
     Rain _rain;                 ///< information about the rain simulation
 
-    /// helper function for loading textures into the _texs map
-    /// \param path  the path to the directory containing the image file
+    /* background loading */
+    cs237::JobSystem *_jobs;                    ///< the job system used to load the
+                                                ///  assets; nullptr once loading is done
+    cs237::BoundedQueue<SceneAsset> _ready;     ///< the loaded assets that have not
+                                                ///  been retrieved by `nextAsset`
+    std::atomic<int> _nLoading;                 ///< the number of outstanding loads
+    Bundle *_bundle;                            ///< the bundle that the scene was loaded
+                                                ///  from (nullptr for scene directories)
+    std::chrono::steady_clock::time_point _loadStart; ///< when `load` was called
+
+    /// helper function for loading textures into the _texs map.  The image is
+    /// loaded by a job, so this function may be called from other jobs.
+    /// \param path  the path to the directory containing the image file (unused
+    ///              when loading from a bundle)
     /// \param name  the name of the file
     /// \param nMap  optional argument specifying if the texture is a normal map (default false).
-    void _loadTexture (std::string path, std::string name, bool nMap = false);
+    /// \param virt  optional argument specifying if a large texture should be
+    ///              loaded as a virtual texture (default false).
+    /// \return the job that loads the texture or nullptr if `name` is empty
+    cs237::Job *_loadTexture (
+        std::string path, std::string name,
+        bool nMap = false, bool virt = false);
+
+    /// spawn a job that loads an asset and track it in the count of outstanding loads
+    /// \param fn    the function that loads the asset and pushes it on the `_ready` queue
+    /// \param deps  jobs that must finish before `fn` is run
+    /// \return the job
+    cs237::Job *_spawnLoad (
+        std::function<void()> const &fn,
+        std::vector<cs237::Job *> const &deps = {});
 
 };
 
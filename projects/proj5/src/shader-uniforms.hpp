@@ -30,7 +30,46 @@ struct TexturePushConsts {
     alignas(16) glm::mat4 normToWorld;  ///< model transform for normal vectors.  We
                                         ///  represent this transform as a 4x4 matrix
                                         ///  for alignment purposes, but only the upper
-                                        ///  3x3 is used in the shaders.
+                                        ///  3x3 is used in the shaders.  For meshes
+                                        ///  with compact vertices, the fourth column
+                                        ///  holds the texture-coordinate decoding
+                                        ///  parameters (see `VertexDecode::tcDecode`).
+};
+
+/// The push constants for the tessellated ground (see tess-ground.hpp).  The
+/// same block is used by all of the stages, but the fragment shader for
+/// wire-frame mode only declares `color`.
+struct TessGroundPushConsts {
+    alignas(16) glm::mat4 mvpM;         ///< model-view-projection transform
+    alignas(16) glm::vec4 eye;          ///< the eye position in model space (xyz)
+                                        ///  and the number of tessellated segments
+                                        ///  per unit of projected size (w)
+    alignas(16) glm::vec4 extent;       ///< the width and depth of the ground and
+                                        ///  its minimum and maximum elevation
+    alignas(16) glm::vec3 color;        ///< the ground color for wire-frame mode
+    float vScale;                       ///< the vertical scale of the height samples
+    glm::uvec2 nPatches;                ///< the number of patches in the X and Z
+                                        ///  dimensions
+};
+
+/// The push constants for the meshlet-culling compute shader.  The frustum
+/// planes and eye position are in the coordinate space of the mesh, so the
+/// shader does not need to transform the meshlet bounds.
+struct CullPushConsts {
+    alignas(16) glm::vec4 planes[6];    ///< the view-frustum planes; the normals
+                                        ///  point into the frustum
+    alignas(16) glm::vec4 eye;          ///< the eye position (w is unused)
+    uint32_t firstCmd;                  ///< index of the mesh's first draw command
+    uint32_t nMeshlets;                 ///< the number of meshlets in the mesh
+};
+
+/// The per-meshlet data that is read by the meshlet-culling compute shader
+struct MeshletInfo {
+    alignas(16) glm::vec4 sphere;       ///< bounding sphere (center and radius)
+    alignas(16) glm::vec4 cone;         ///< normal cone (axis and cutoff)
+    uint32_t firstIndex;                ///< the meshlet's first index in the
+                                        ///  mesh's index buffer
+    uint32_t nIndices;                  ///< the number of indices in the meshlet
 };
 
 /// The per-scene lighting uniform buffer
@@ -0,0 +1,373 @@
+/*! \file terrain-stream.cpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5.  This file implements the
+ * streaming of the ground mesh for tiled height fields.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "terrain-stream.hpp"
+#include "app.hpp"
+#include "ground-grid.hpp"
+#include "height-field.hpp"
+#include "height-tiles.hpp"
+#include <cstring>
+
+/// the maximum number of outstanding tile requests
+constexpr size_t kMaxTileRequests = 8;
+
+/// the maximum number of tiles that are uploaded per frame
+constexpr uint32_t kMaxTileUploadsPerFrame = 2;
+
+/// resident tiles are evicted when they are farther from the eye than this
+/// multiple of the streaming radius
+constexpr float kEvictScale = 1.25f;
+
+TerrainStreamer::TerrainStreamer (Proj5 *app, HeightField const *hf)
+  : _app(app), _tiles(hf->tiles()),
+    _origin(-0.5f * hf->width(), -0.5f * hf->height()),
+    _cellSize(
+        hf->width() / float(hf->numCols() - 1),
+        hf->height() / float(hf->numRows() - 1)),
+    _vScale(hf->vScale()),
+    _iBuf(nullptr),
+    _state(hf->tiles()->numTiles(), TileState::eAbsent),
+    _meshes(hf->tiles()->numTiles(), TileMesh{nullptr, VertexDecode(), nullptr}),
+    _frameNum(0), _nPending(0), _nResident(0),
+    _requests(kMaxTileRequests), _built(kMaxTileRequests)
+{
+    // the tiles have a single root chunk, so their size must be a power-of-two
+    // multiple of the chunk size
+    uint32_t q = this->_tiles->tileQuads();
+    uint32_t nLevels = 1;
+    while ((kChunkQuads << (nLevels - 1)) < q) {
+        ++nLevels;
+    }
+    if ((kChunkQuads << (nLevels - 1)) != q) {
+        ERROR("TerrainStreamer: tile size is not a power-of-two multiple of the chunk size");
+    }
+    this->_info.nLevels = nLevels;
+    this->_info.minY = hf->bbox().minY();
+    this->_info.maxY = hf->bbox().maxY();
+    this->_info.neighbors = 0;
+    this->_gridSize = q + 1;
+
+    // the index patterns only depend on the size of the vertex grid, so we get
+    // them from a flat tile
+    {
+        std::vector<float> flat(size_t(this->_gridSize) * this->_gridSize, 0.0f);
+        Terrain t(
+            this->_gridSize, this->_gridSize, this->_origin, this->_cellSize,
+            flat.data(), &this->_info);
+        this->_iBuf = new cs237::IndexBuffer<uint32_t>(app, t.numIndices());
+        auto dst = this->_iBuf->map();
+        t.indices (dst.data());
+    }
+
+    // start the streaming thread
+    this->_streamer = std::thread(&TerrainStreamer::_stream, this);
+
+}
+
+TerrainStreamer::~TerrainStreamer ()
+{
+    // stop the streaming thread and free any tiles that it has built
+    this->_requests.close();
+    this->_built.close();
+    this->_streamer.join();
+    BuiltTile tile;
+    while (this->_built.tryPop(tile)) {
+        _freeTile (tile);
+    }
+
+    for (auto id : this->_resident) {
+        delete this->_meshes[id].terrain;
+        delete this->_meshes[id].vBuf;
+    }
+    for (auto const &rb : this->_retired) {
+        delete rb.vBuf;
+    }
+    for (auto vBuf : this->_freeBufs) {
+        delete vBuf;
+    }
+    delete this->_iBuf;
+
+}
+
+void TerrainStreamer::update (glm::vec3 eye, float radius)
+{
+    this->_frameNum++;
+
+    // recycle the vertex buffers that are no longer used by any frame in flight
+    std::vector<RetiredBuffer> stillRetired;
+    for (auto const &rb : this->_retired) {
+        if (rb.frame + cs237::kMaxFrames <= this->_frameNum) {
+            this->_freeBufs.push_back(rb.vBuf);
+        } else {
+            stillRetired.push_back(rb);
+        }
+    }
+    this->_retired.swap(stillRetired);
+
+    // evict the tiles that are too far away; the eviction distance is larger
+    // than the streaming radius, so that the tiles near the boundary are not
+    // repeatedly streamed in and out as the camera moves
+    float evictDist = kEvictScale * radius;
+    std::vector<uint32_t> keep;
+    for (auto id : this->_resident) {
+        if (this->_distance(id, eye) > evictDist) {
+            TileMesh &mesh = this->_meshes[id];
+            this->_retired.push_back(RetiredBuffer{this->_frameNum, mesh.vBuf});
+            delete mesh.terrain;
+            mesh = TileMesh{nullptr, VertexDecode(), nullptr};
+            this->_state[id] = TileState::eAbsent;
+            this->_nResident--;
+        } else {
+            keep.push_back(id);
+        }
+    }
+    this->_resident.swap(keep);
+
+    // upload the tiles that have been built; tiles that have gone out of range
+    // while they were being built are dropped
+    BuiltTile tile;
+    uint32_t nUploads = 0;
+    size_t nVerts = size_t(this->_gridSize) * this->_gridSize;
+    while ((nUploads < kMaxTileUploadsPerFrame) && this->_built.tryPop(tile)) {
+        this->_nPending--;
+        if (this->_distance(tile.id, eye) > evictDist) {
+            this->_state[tile.id] = TileState::eAbsent;
+            _freeTile (tile);
+            continue;
+        }
+        cs237::VertexBuffer<CompactVertex> *vBuf;
+        if (this->_freeBufs.empty()) {
+            vBuf = new cs237::VertexBuffer<CompactVertex>(this->_app, nVerts);
+        } else {
+            vBuf = this->_freeBufs.back();
+            this->_freeBufs.pop_back();
+        }
+        {
+            auto dst = vBuf->map();
+            std::memcpy (dst.data(), tile.verts, nVerts * sizeof(CompactVertex));
+        }
+        delete[] tile.verts;
+        tile.mesh.vBuf = vBuf;
+        this->_meshes[tile.id] = tile.mesh;
+        this->_state[tile.id] = TileState::eResident;
+        this->_resident.push_back(tile.id);
+        this->_nResident++;
+        nUploads++;
+    }
+
+    // request the missing tiles within the radius, nearest first.  The number
+    // of pending requests is limited by the capacity of the queues, so `push`
+    // does not block.
+    if (this->_nPending >= this->_requests.capacity()) {
+        return;
+    }
+    glm::vec2 tileSize = float(this->_tiles->tileQuads()) * this->_cellSize;
+    auto tileRange = [] (float lo, float hi, float size, uint32_t n, int32_t &t0, int32_t &t1) {
+        t0 = std::max(int32_t(std::floor(lo / size)), 0);
+        t1 = std::min(int32_t(std::floor(hi / size)), int32_t(n) - 1);
+    };
+    int32_t tx0, tx1, ty0, ty1;
+    tileRange (
+        eye.x - radius - this->_origin.x, eye.x + radius - this->_origin.x,
+        tileSize.x, this->_tiles->tilesWide(), tx0, tx1);
+    tileRange (
+        eye.z - radius - this->_origin.y, eye.z + radius - this->_origin.y,
+        tileSize.y, this->_tiles->tilesHigh(), ty0, ty1);
+    std::vector<std::pair<float,uint32_t>> missing;
+    for (int32_t ty = ty0;  ty <= ty1;  ++ty) {
+        for (int32_t tx = tx0;  tx <= tx1;  ++tx) {
+            uint32_t id = this->_tiles->tileId (tx, ty);
+            if (this->_state[id] == TileState::eAbsent) {
+                float d = this->_distance(id, eye);
+                if (d <= radius) {
+                    missing.push_back(std::pair<float,uint32_t>(d, id));
+                }
+            }
+        }
+    }
+    std::sort (missing.begin(), missing.end());
+    for (auto const &m : missing) {
+        if (this->_nPending >= this->_requests.capacity()) {
+            break;
+        }
+        this->_state[m.second] = TileState::ePending;
+        this->_nPending++;
+        this->_requests.push(m.second);
+    }
+
+}
+
+void TerrainStreamer::draw (
+    vk::CommandBuffer cmdBuf,
+    const glm::vec4 planes[6],
+    glm::vec3 eye,
+    float pixelScale,
+    bool useLOD,
+    SetDecodeFn const &setDecode)
+{
+    cmdBuf.bindIndexBuffer(this->_iBuf->vkBuffer(), 0, vk::IndexType::eUint32);
+
+    for (auto id : this->_resident) {
+        TileMesh const &mesh = this->_meshes[id];
+        mesh.terrain->select (planes, eye, pixelScale, useLOD, this->_chunks);
+        if (this->_chunks.empty()) {
+            continue;
+        }
+        setDecode (mesh.decode);
+        cmdBuf.bindVertexBuffers(0, mesh.vBuf->vkBuffer(), {0});
+        for (auto const &chunk : this->_chunks) {
+            cmdBuf.drawIndexed(chunk.nIndices, 1, chunk.firstIndex, chunk.vertexOffset, 0);
+        }
+    }
+
+}
+
+void TerrainStreamer::_stream ()
+{
+    uint32_t id;
+    while (this->_requests.pop(id)) {
+        // reading the tile's samples is where the mapped file is actually read
+        BuiltTile tile = this->_buildTile (id);
+        if (! this->_built.push(tile)) {
+            _freeTile (tile);
+            return;
+        }
+    }
+
+}
+
+TerrainStreamer::BuiltTile TerrainStreamer::_buildTile (uint32_t id) const
+{
+    uint32_t q = this->_tiles->tileQuads();
+    uint32_t nr = this->_tiles->numRows();
+    uint32_t nc = this->_tiles->numCols();
+    uint32_t tx = id % this->_tiles->tilesWide();
+    uint32_t ty = id / this->_tiles->tilesWide();
+    uint32_t r0 = ty * q;
+    uint32_t c0 = tx * q;
+    // the number of samples in the tile, which is less than `q+1` for the last
+    // row and column of tiles
+    uint32_t tileRows = std::min(q, nr - 1 - r0) + 1;
+    uint32_t tileCols = std::min(q, nc - 1 - c0) + 1;
+
+    // the window of samples that the vertices are computed from, which adds the
+    // neighbors of the tile's samples (from the apron) except at the edges of
+    // the height field, so that the normals match those of the whole height field
+    uint32_t wr0 = (r0 > 0) ? r0 - 1 : 0;
+    uint32_t wc0 = (c0 > 0) ? c0 - 1 : 0;
+    uint32_t wRows = std::min(r0 + tileRows, nr - 1) - wr0 + 1;
+    uint32_t wCols = std::min(c0 + tileCols, nc - 1) - wc0 + 1;
+    std::vector<float> heights(size_t(wRows) * wCols);
+    {
+        const uint8_t *data = this->_tiles->tileData (id);
+        uint32_t stride = this->_tiles->tileSamples();
+        bool isU8 = (this->_tiles->type() == cs237::ChannelTy::U8);
+        for (uint32_t i = 0;  i < wRows;  ++i) {
+            // sample (r, c) of the height field is at (r - r0 + 1, c - c0 + 1)
+            // in the tile's data
+            size_t offset = size_t(wr0 + i + 1 - r0) * stride + (wc0 + 1 - c0);
+            if (isU8) {
+                loadHeights (data + offset, wCols, this->_vScale, &heights[i * wCols]);
+            } else {
+                loadHeights (reinterpret_cast<const uint16_t *>(data) + offset, wCols,
+                    this->_vScale, &heights[i * wCols]);
+            }
+        }
+    }
+
+    GroundGrid grid;
+    grid.heights = heights.data();
+    grid.nRows = wRows;
+    grid.nCols = wCols;
+    grid.origin = this->_origin + glm::vec2(float(wc0), float(wr0)) * this->_cellSize;
+    grid.cellSize = this->_cellSize;
+    grid.row0 = wr0;
+    grid.col0 = wc0;
+    grid.hfRows = nr;
+    grid.hfCols = nc;
+
+    /***** chunks *****/
+
+    // the elevations of the tile's samples
+    std::vector<float> tileHeights(size_t(tileRows) * tileCols);
+    for (uint32_t i = 0;  i < tileRows;  ++i) {
+        std::memcpy (
+            &tileHeights[size_t(i) * tileCols],
+            &heights[size_t(r0 - wr0 + i) * wCols + (c0 - wc0)],
+            tileCols * sizeof(float));
+    }
+    auto range = std::minmax_element (tileHeights.begin(), tileHeights.end());
+
+    glm::vec2 tileOrigin = this->_origin + glm::vec2(float(c0), float(r0)) * this->_cellSize;
+    Terrain::TileInfo info = this->_info;
+    info.neighbors = ((ty > 0) ? Terrain::kTop : 0)
+        | ((ty + 1 < this->_tiles->tilesHigh()) ? Terrain::kBottom : 0)
+        | ((tx > 0) ? Terrain::kLeft : 0)
+        | ((tx + 1 < this->_tiles->tilesWide()) ? Terrain::kRight : 0);
+
+    BuiltTile tile;
+    tile.id = id;
+    tile.mesh.terrain = new Terrain(
+        tileRows, tileCols, tileOrigin, this->_cellSize, tileHeights.data(), &info);
+    tile.mesh.vBuf = nullptr;
+
+    /***** vertices *****/
+
+    // quantize the vertices relative to the bounds of the tile, which gives the
+    // same precision for every tile no matter how large the height field is
+    glm::vec2 tileExtent = glm::vec2(float(tileCols - 1), float(tileRows - 1)) * this->_cellSize;
+    float tcX = 1.0f / float(nc - 1);
+    float tcY = 1.0f / float(nr - 1);
+    tile.mesh.decode = VertexDecode(
+        glm::vec3(tileOrigin.x, *range.first, tileOrigin.y),
+        glm::vec3(tileOrigin.x + tileExtent.x, *range.second, tileOrigin.y + tileExtent.y),
+        glm::vec2(float(c0) * tcX, float(nr - r0 - tileRows) * tcY),
+        glm::vec2(float(c0 + tileCols - 1) * tcX, float(nr - r0 - 1) * tcY));
+
+    // the vertex grid of a tile is always `_gridSize` x `_gridSize`; the padding
+    // vertices are copies of the last row or column of the tile
+    uint32_t n = this->_gridSize;
+    tile.verts = new CompactVertex[size_t(n) * n];
+    RowScratch tmp(wCols);
+    std::vector<Vertex> row(wCols);
+    uint32_t rowR = ~0u;
+    for (uint32_t i = 0;  i < n;  ++i) {
+        uint32_t r = std::min(i, tileRows - 1) + r0 - wr0;
+        if (r != rowR) {
+            groundRow (grid, r, tmp, row.data());
+            rowR = r;
+        }
+        CompactVertex *out = tile.verts + size_t(i) * n;
+        for (uint32_t j = 0;  j < n;  ++j) {
+            out[j] = CompactVertex(row[std::min(j, tileCols - 1) + c0 - wc0], tile.mesh.decode);
+        }
+    }
+
+    return tile;
+
+}
+
+float TerrainStreamer::_distance (uint32_t id, glm::vec3 eye) const
+{
+    uint32_t q = this->_tiles->tileQuads();
+    uint32_t tx = id % this->_tiles->tilesWide();
+    uint32_t ty = id / this->_tiles->tilesWide();
+    glm::vec2 lo = this->_origin + glm::vec2(float(tx * q), float(ty * q)) * this->_cellSize;
+    glm::vec2 hi = lo + float(q) * this->_cellSize;
+    glm::vec2 d(
+        std::max(std::max(lo.x - eye.x, eye.x - hi.x), 0.0f),
+        std::max(std::max(lo.y - eye.z, eye.z - hi.y), 0.0f));
+
+    return glm::length(d);
+
+}
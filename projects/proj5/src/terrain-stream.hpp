@@ -0,0 +1,156 @@
+/*! \file terrain-stream.hpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5
+ *
+ * This file defines the TerrainStreamer class, which streams the mesh of a
+ * tiled height field in and out of GPU memory around the camera.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _TERRAIN_STREAM_HPP_
+#define _TERRAIN_STREAM_HPP_
+
+#include "cs237/cs237.hpp"
+#include "terrain.hpp"
+#include "vertex.hpp"
+#include <functional>
+
+class Proj5;
+class HeightField;
+class HeightTileFile;
+
+/// A TerrainStreamer draws the ground of a height field that is too large to
+/// keep in memory.  The height field is stored as a tile file (see
+/// height-tiles.hpp) and each tile has its own mesh, which is a `Terrain` with a
+/// single root chunk and a buffer of compact vertices that are quantized
+/// relative to the bounds of the tile.  Since the tiles have the same size,
+/// they share the index patterns.
+///
+/// The tiles within a fixed distance of the eye are resident.  Each frame,
+/// `update` requests the missing tiles (nearest first) from a streaming thread,
+/// which reads their samples from the mapped tile file and computes their
+/// vertices and chunk bounds.  The tiles that it has built are uploaded a few
+/// at a time, so that streaming does not cause hitches, and tiles that are
+/// farther away are evicted.  Their vertex buffers are recycled once the
+/// frames that might use them have finished.  Tiles that are not resident yet
+/// are not drawn.
+class TerrainStreamer {
+public:
+
+    /// the function that is used to set the per-tile push constants; its
+    /// argument is the decoding of the tile's compact vertices
+    using SetDecodeFn = std::function<void(VertexDecode const &)>;
+
+    /// create the streamer for a tiled height field
+    /// \param app  the owning app
+    /// \param hf   the height field, which must be tiled (i.e., `hf->tiles()`
+    ///             is non-null)
+    TerrainStreamer (Proj5 *app, HeightField const *hf);
+
+    TerrainStreamer (TerrainStreamer const &) = delete;
+    TerrainStreamer &operator= (TerrainStreamer const &) = delete;
+
+    ~TerrainStreamer ();
+
+    /// update the resident tiles for a frame; this function must be called once
+    /// per frame before the frame's draw commands are recorded
+    /// \param eye     the position of the eye in model space
+    /// \param radius  the tiles within this distance of the eye (in the XZ
+    ///                plane) are made resident
+    void update (glm::vec3 eye, float radius);
+
+    /// draw the chunks of the resident tiles
+    /// \param cmdBuf      the command buffer
+    /// \param planes      the view-frustum planes in model space
+    /// \param eye         the position of the eye in model space
+    /// \param pixelScale  the number of pixels covered by an object of unit size at
+    ///                    unit distance from the camera
+    /// \param useLOD      if false, all of the visible chunks are drawn at full
+    ///                    resolution
+    /// \param setDecode   called before a tile's chunks are drawn to set the push
+    ///                    constants for the tile's vertex decoding
+    void draw (
+        vk::CommandBuffer cmdBuf,
+        const glm::vec4 planes[6],
+        glm::vec3 eye,
+        float pixelScale,
+        bool useLOD,
+        SetDecodeFn const &setDecode);
+
+    /// the number of resident tiles
+    uint32_t numResident () const { return this->_nResident; }
+
+private:
+    /// the state of a tile
+    enum class TileState { eAbsent, ePending, eResident };
+
+    /// the mesh of a tile
+    struct TileMesh {
+        Terrain *terrain;               ///< the chunks of the tile
+        VertexDecode decode;            ///< the decoding of the tile's vertices
+        cs237::VertexBuffer<CompactVertex> *vBuf; ///< the vertices (nullptr until
+                                        ///  the tile is uploaded)
+    };
+
+    /// a tile that has been built by the streaming thread
+    struct BuiltTile {
+        uint32_t id;                    ///< the tile
+        TileMesh mesh;                  ///< the tile's mesh (without vertex buffer)
+        CompactVertex *verts;           ///< the tile's vertices (allocated by `new[]`)
+    };
+
+    /// a vertex buffer that is waiting for the frames that use it to finish
+    struct RetiredBuffer {
+        uint64_t frame;                 ///< the update in which it was retired
+        cs237::VertexBuffer<CompactVertex> *vBuf;
+    };
+
+    Proj5 *_app;                        ///< the owning app
+    HeightTileFile const *_tiles;       ///< the tile file
+    glm::vec2 _origin;                  ///< the model-space XZ position of the
+                                        ///  first sample
+    glm::vec2 _cellSize;                ///< the model-space XZ distance between samples
+    float _vScale;                      ///< the scaling from samples to elevations
+    Terrain::TileInfo _info;            ///< the properties shared by the tiles
+    uint32_t _gridSize;                 ///< the number of vertices along a tile side
+    cs237::IndexBuffer<uint32_t> *_iBuf; ///< the shared index patterns
+    std::vector<TileState> _state;      ///< the state of each tile
+    std::vector<TileMesh> _meshes;      ///< the meshes of the resident tiles
+    std::vector<uint32_t> _resident;    ///< the resident tiles
+    std::vector<cs237::VertexBuffer<CompactVertex> *> _freeBufs; ///< vertex buffers
+                                        ///  that can be reused
+    std::vector<RetiredBuffer> _retired; ///< vertex buffers of evicted tiles
+    std::vector<Terrain::Chunk> _chunks; ///< the selected chunks of a tile
+    uint64_t _frameNum;                 ///< the number of calls to `update`
+    uint32_t _nPending;                 ///< the number of requested tiles that
+                                        ///  have not been uploaded
+    uint32_t _nResident;                ///< the number of resident tiles
+    cs237::BoundedQueue<uint32_t> _requests; ///< tiles to build
+    cs237::BoundedQueue<BuiltTile> _built; ///< tiles that have been built
+    std::thread _streamer;
+
+    /// the main loop of the streaming thread
+    void _stream ();
+
+    /// build the mesh of a tile (in the streaming thread)
+    BuiltTile _buildTile (uint32_t id) const;
+
+    /// the XZ distance from the eye to a tile
+    float _distance (uint32_t id, glm::vec3 eye) const;
+
+    /// free the resources of a built tile
+    static void _freeTile (BuiltTile &tile)
+    {
+        delete tile.mesh.terrain;
+        delete[] tile.verts;
+    }
+
+};
+
+#endif // !_TERRAIN_STREAM_HPP_
@@ -0,0 +1,305 @@
+/*! \file terrain.cpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5.  This file implements the
+ * chunked level-of-detail representation of the height-field mesh.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "terrain.hpp"
+
+/// the smallest ratio of distance to chunk size at which a chunk is not refined.
+/// Since the distance to a chunk differs from the distance to a neighbor of
+/// half its size by at most the neighbor's diagonal (sqrt(2) times its size),
+/// a ratio of at least sqrt(2) guarantees that the levels of neighboring chunks
+/// differ by at most one.
+constexpr float kMinRefineRatio = 1.5f;
+
+Terrain::Terrain (
+    uint32_t nRows, uint32_t nCols,
+    glm::vec2 origin, glm::vec2 cellSize,
+    const float *heights,
+    TileInfo const *tile)
+  : _origin(origin), _cellSize(cellSize),
+    _neighbors((tile != nullptr) ? tile->neighbors : 0), _nIndices(0)
+{
+    assert ((nRows >= 2) && (nCols >= 2));
+
+    // the roots are the largest chunks that fit in the smaller dimension of the
+    // height field, which bounds the amount of padding.  A tile has a single
+    // root, which is the same size for all of the tiles.
+    uint32_t rootLvl = 0;
+    if (tile != nullptr) {
+        assert (tile->nLevels > 0);
+        rootLvl = tile->nLevels - 1;
+        assert (std::max(nRows, nCols) - 1 <= (kChunkQuads << rootLvl));
+    } else {
+        uint32_t minQuads = std::min(nRows, nCols) - 1;
+        while ((kChunkQuads << (rootLvl + 1)) <= minQuads) {
+            ++rootLvl;
+        }
+    }
+    uint32_t rootQuads = kChunkQuads << rootLvl;
+    this->_nLevels = rootLvl + 1;
+    this->_rootsHigh = (nRows - 1 + rootQuads - 1) / rootQuads;
+    this->_rootsWide = (nCols - 1 + rootQuads - 1) / rootQuads;
+    this->_gridRows = this->_rootsHigh * rootQuads + 1;
+    this->_gridCols = this->_rootsWide * rootQuads + 1;
+
+    // compute the bounds of the full-resolution chunks from the samples that
+    // they cover
+    this->_bounds.resize(this->_nLevels);
+    {
+        uint32_t nr = this->_chunksHigh(0);
+        uint32_t nc = this->_chunksWide(0);
+        auto &bounds = this->_bounds[0];
+        bounds.resize(nr * nc);
+        for (uint32_t row = 0;  row < nr;  ++row) {
+            uint32_t r0 = row * kChunkQuads;
+            uint32_t r1 = std::min(r0 + kChunkQuads, nRows - 1);
+            for (uint32_t col = 0;  col < nc;  ++col) {
+                uint32_t c0 = col * kChunkQuads;
+                uint32_t c1 = std::min(c0 + kChunkQuads, nCols - 1);
+                if ((r0 >= nRows - 1) || (c0 >= nCols - 1)) {
+                    continue; // the chunk is in the padding
+                }
+                float minY = heights[r0 * nCols + c0];
+                float maxY = minY;
+                for (uint32_t r = r0;  r <= r1;  ++r) {
+                    const float *h = heights + r * nCols;
+                    for (uint32_t c = c0;  c <= c1;  ++c) {
+                        minY = std::min(minY, h[c]);
+                        maxY = std::max(maxY, h[c]);
+                    }
+                }
+                glm::vec2 lo = origin + glm::vec2(float(c0), float(r0)) * cellSize;
+                glm::vec2 hi = origin + glm::vec2(float(c1), float(r1)) * cellSize;
+                bounds[row * nc + col] = cs237::AABBf_t(
+                    glm::vec3(lo.x, minY, lo.y),
+                    glm::vec3(hi.x, maxY, hi.y));
+            }
+        }
+    }
+
+    // the bounds of the coarser chunks are the union of their children's bounds
+    for (uint32_t lvl = 1;  lvl < this->_nLevels;  ++lvl) {
+        uint32_t nr = this->_chunksHigh(lvl);
+        uint32_t nc = this->_chunksWide(lvl);
+        auto const &children = this->_bounds[lvl-1];
+        auto &bounds = this->_bounds[lvl];
+        bounds.resize(nr * nc);
+        for (uint32_t row = 0;  row < nr;  ++row) {
+            for (uint32_t col = 0;  col < nc;  ++col) {
+                auto &bb = bounds[row * nc + col];
+                for (uint32_t i = 0;  i < 4;  ++i) {
+                    auto const &child = children[(2*row + (i >> 1)) * 2*nc + 2*col + (i & 1)];
+                    if (! child.isEmpty()) {
+                        bb.addPt (child.min());
+                        bb.addPt (child.max());
+                    }
+                }
+            }
+        }
+    }
+
+    // the vertical extent of the height field; for a tile, we use the extent
+    // of the whole height field, so that the refinement test does not depend
+    // on which tile a chunk is in
+    if (tile != nullptr) {
+        this->_minY = tile->minY;
+        this->_maxY = tile->maxY;
+    } else {
+        this->_minY = this->_maxY = heights[0];
+        for (auto const &bb : this->_bounds[rootLvl]) {
+            if (! bb.isEmpty()) {
+                this->_minY = std::min(this->_minY, bb.minY());
+                this->_maxY = std::max(this->_maxY, bb.maxY());
+            }
+        }
+    }
+
+    // lay out the index patterns
+    this->_patterns.reserve(this->_nLevels * kNumMasks);
+    for (uint32_t lvl = 0;  lvl < this->_nLevels;  ++lvl) {
+        for (uint32_t mask = 0;  mask < kNumMasks;  ++mask) {
+            uint32_t n = this->_pattern (lvl, mask, nullptr);
+            this->_patterns.push_back(std::pair<uint32_t,uint32_t>(this->_nIndices, n));
+            this->_nIndices += n;
+        }
+    }
+
+}
+
+void Terrain::indices (uint32_t *dst) const
+{
+    for (uint32_t lvl = 0;  lvl < this->_nLevels;  ++lvl) {
+        for (uint32_t mask = 0;  mask < kNumMasks;  ++mask) {
+            auto pat = this->_patterns[lvl * kNumMasks + mask];
+            this->_pattern (lvl, mask, dst + pat.first);
+        }
+    }
+
+}
+
+void Terrain::select (
+    const glm::vec4 planes[6],
+    glm::vec3 eye,
+    float pixelScale,
+    bool useLOD,
+    std::vector<Chunk> &chunks) const
+{
+    // a chunk is refined when its quads would cover more than `kChunkQuadPixels`
+    // pixels, which happens when it is closer than `ratio` times its size
+    Traversal tr;
+    tr.planes = planes;
+    tr.eye = eye;
+    tr.ratio = std::max(kMinRefineRatio, pixelScale / (kChunkQuadPixels * float(kChunkQuads)));
+    tr.useLOD = useLOD;
+    tr.chunks = &chunks;
+
+    chunks.clear();
+    uint32_t rootLvl = this->_nLevels - 1;
+    for (uint32_t row = 0;  row < this->_rootsHigh;  ++row) {
+        for (uint32_t col = 0;  col < this->_rootsWide;  ++col) {
+            this->_select (tr, rootLvl, row, col);
+        }
+    }
+
+}
+
+bool Terrain::_refine (Traversal const &tr, uint32_t lvl, int32_t row, int32_t col) const
+{
+    float quads = float(kChunkQuads << lvl);
+    glm::vec2 lo = this->_origin + glm::vec2(float(col), float(row)) * quads * this->_cellSize;
+    glm::vec2 hi = lo + quads * this->_cellSize;
+    glm::vec3 d(
+        std::max(std::max(lo.x - tr.eye.x, tr.eye.x - hi.x), 0.0f),
+        std::max(std::max(this->_minY - tr.eye.y, tr.eye.y - this->_maxY), 0.0f),
+        std::max(std::max(lo.y - tr.eye.z, tr.eye.z - hi.y), 0.0f));
+    float size = quads * std::max(this->_cellSize.x, this->_cellSize.y);
+
+    return glm::length(d) < tr.ratio * size;
+
+}
+
+void Terrain::_select (Traversal const &tr, uint32_t lvl, uint32_t row, uint32_t col) const
+{
+    if (! this->_exists(lvl, row, col)) {
+        return;
+    }
+
+    // cull the chunk (and its subtree) if its bounding box is outside one of the
+    // frustum planes
+    auto const &bb = this->_bounds[lvl][row * this->_chunksWide(lvl) + col];
+    for (int i = 0;  i < 6;  ++i) {
+        glm::vec4 const &p = tr.planes[i];
+        glm::vec3 v(
+            (p.x > 0.0f) ? bb.maxX() : bb.minX(),
+            (p.y > 0.0f) ? bb.maxY() : bb.minY(),
+            (p.z > 0.0f) ? bb.maxZ() : bb.minZ());
+        if (glm::dot(glm::vec3(p), v) + p.w < 0.0f) {
+            return;
+        }
+    }
+
+    if ((lvl > 0) && (!tr.useLOD || this->_refine(tr, lvl, row, col))) {
+        for (uint32_t i = 0;  i < 4;  ++i) {
+            this->_select (tr, lvl - 1, 2*row + (i >> 1), 2*col + (i & 1));
+        }
+        return;
+    }
+
+    // determine which neighbors are coarser than this chunk.  A neighbor is
+    // coarser when its parent is not refined; since the levels of neighbors
+    // differ by at most one, it is then the parent itself.  Note that the parent
+    // of a sibling is this chunk's parent, which was refined.  The neighbors
+    // across a shared edge of a tile are in the neighboring tile, which makes
+    // the same decisions.
+    uint32_t mask = 0;
+    if (tr.useLOD && (lvl + 1 < this->_nLevels)) {
+        int32_t nr = int32_t(this->_chunksHigh(lvl));
+        int32_t nc = int32_t(this->_chunksWide(lvl));
+        auto isCoarser = [&] (int32_t r, int32_t c, uint32_t edge) -> bool {
+            bool outside = (r < 0) || (c < 0) || (r >= nr) || (c >= nc);
+            bool exists = outside
+                ? ((this->_neighbors & edge) != 0)
+                : this->_exists(lvl, r, c);
+            // we use floor division, since `r` or `c` may be -1
+            int32_t pr = (r < 0) ? -1 : (r >> 1);
+            int32_t pc = (c < 0) ? -1 : (c >> 1);
+            return exists
+                && ((pr != int32_t(row >> 1)) || (pc != int32_t(col >> 1)))
+                && !this->_refine(tr, lvl + 1, pr, pc);
+        };
+        int32_t r = int32_t(row), c = int32_t(col);
+        if (isCoarser(r - 1, c, kTop)) { mask |= kTop; }
+        if (isCoarser(r + 1, c, kBottom)) { mask |= kBottom; }
+        if (isCoarser(r, c - 1, kLeft)) { mask |= kLeft; }
+        if (isCoarser(r, c + 1, kRight)) { mask |= kRight; }
+    }
+
+    auto pat = this->_patterns[lvl * kNumMasks + mask];
+    uint32_t r0 = (row * kChunkQuads) << lvl;
+    uint32_t c0 = (col * kChunkQuads) << lvl;
+    tr.chunks->push_back(Chunk{
+            pat.first,
+            pat.second,
+            int32_t(r0 * this->_gridCols + c0)
+        });
+
+}
+
+uint32_t Terrain::_pattern (uint32_t lvl, uint32_t mask, uint32_t *dst) const
+{
+    uint32_t stride = 1 << lvl;
+
+    // the index of the vertex in row i and column j of the chunk relative to
+    // its first vertex; the odd vertices of the stitched edges are snapped to
+    // the preceding even vertex, which collapses one triangle of each pair of
+    // quads along the edge
+    auto vertex = [&] (uint32_t i, uint32_t j) -> uint32_t {
+        if (((i == 0) && (mask & kTop)) || ((i == kChunkQuads) && (mask & kBottom))) {
+            j &= ~1u;
+        }
+        if (((j == 0) && (mask & kLeft)) || ((j == kChunkQuads) && (mask & kRight))) {
+            i &= ~1u;
+        }
+        return (i * this->_gridCols + j) * stride;
+    };
+
+    // we use the same triangulation as the full height-field mesh, which
+    // alternates the diagonal of the quads
+    uint32_t n = 0;
+    auto triangle = [&] (uint32_t a, uint32_t b, uint32_t c) {
+        if ((a != b) && (b != c) && (a != c)) {
+            if (dst != nullptr) {
+                dst[n + 0] = a;
+                dst[n + 1] = b;
+                dst[n + 2] = c;
+            }
+            n += 3;
+        }
+    };
+    for (uint32_t r = 1;  r <= kChunkQuads;  r++) {
+        for (uint32_t c = 1;  c <= kChunkQuads;  c++) {
+            if ((c & 1) == (r & 1)) {
+              // triangulate from upper left to lower right
+                triangle (vertex(r, c-1), vertex(r, c), vertex(r-1, c-1));
+                triangle (vertex(r-1, c), vertex(r-1, c-1), vertex(r, c));
+            }
+            else {
+              // triangulate from lower left to upper right
+                triangle (vertex(r, c), vertex(r-1, c), vertex(r, c-1));
+                triangle (vertex(r-1, c-1), vertex(r, c-1), vertex(r-1, c));
+            }
+        }
+    }
+
+    return n;
+
+}
@@ -0,0 +1,206 @@
+/*! \file terrain.hpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5
+ *
+ * This file defines the Terrain class, which supports chunked level-of-detail
+ * rendering of the height-field mesh.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _TERRAIN_HPP_
+#define _TERRAIN_HPP_
+
+#include "cs237/cs237.hpp"
+
+/// the number of quads along each side of a terrain chunk
+constexpr uint32_t kChunkQuads = 32;
+
+/// the level of detail of the terrain is picked so that the quads of a chunk
+/// cover at most about this many pixels along a side
+constexpr float kChunkQuadPixels = 8.0f;
+
+/// The Terrain class organizes a height-field mesh as a quadtree of chunks
+/// (i.e., geomipmapping with a chunked level of detail).  Every chunk is a grid
+/// of `kChunkQuads` x `kChunkQuads` quads, where the vertices of a chunk at
+/// level L are every 2^L'th sample of the height field.  Thus, the chunks at
+/// level 0 are at full resolution and a chunk at level L+1 covers the area of
+/// its four children at half their resolution.  The height field is covered
+/// by a grid of root chunks at the coarsest level.
+///
+/// The chunks share a grid of vertices, which is the height field padded to a
+/// multiple of the root-chunk size by repeating its last row and column (the
+/// triangles in the padding are degenerate).  Since the indices of a chunk
+/// relative to its first vertex only depend on its level, a chunk is drawn using
+/// the index pattern for its level with a vertex offset.
+///
+/// The chunks to draw are selected each frame by traversing the quadtrees, which
+/// culls them against the view frustum and refines them based on their distance
+/// from the eye.  The refinement test guarantees that the levels of neighboring
+/// chunks differ by at most one; the finer chunk of such a pair uses a variant
+/// of its pattern that skips the odd vertices along the shared edge, so that
+/// the mesh does not have cracks.
+///
+/// A height field that is streamed in tiles (see terrain-stream.hpp) has one
+/// Terrain object per tile.  The tiles have a single root chunk of the same
+/// size and use the vertical extent of the whole height field in the refinement
+/// test, so the chunks of the tiles are selected as if they were one quadtree
+/// and the chunks along the edge of a tile are stitched to those of the
+/// neighboring tile.
+class Terrain {
+public:
+
+    /// the edges of a chunk, which are used as bits in the stitching mask
+    static constexpr uint32_t kTop = 1;         ///< the first row of the chunk
+    static constexpr uint32_t kBottom = 2;      ///< the last row of the chunk
+    static constexpr uint32_t kLeft = 4;        ///< the first column of the chunk
+    static constexpr uint32_t kRight = 8;       ///< the last column of the chunk
+
+    /// the drawing parameters for a selected chunk
+    struct Chunk {
+        uint32_t firstIndex;    ///< the first index of the chunk's pattern
+        uint32_t nIndices;      ///< the number of indices in the pattern
+        int32_t vertexOffset;   ///< the index of the chunk's first vertex
+    };
+
+    /// the properties of a tile of a larger height field
+    struct TileInfo {
+        uint32_t nLevels;       ///< the number of levels, which must be large
+                                ///  enough for the root chunk to cover the tile
+        float minY, maxY;       ///< the vertical extent of the whole height field
+        uint32_t neighbors;     ///< the edges of the tile that are shared with
+                                ///  another tile (a mask of `kTop` etc.)
+    };
+
+    /// build the chunk quadtrees for a height field
+    /// \param nRows     the number of rows of samples in the height field
+    /// \param nCols     the number of columns of samples in the height field
+    /// \param origin    the model-space XZ position of the first sample
+    /// \param cellSize  the model-space XZ distance between samples
+    /// \param heights   the elevations of the samples in row-major order
+    /// \param tile      if non-null, the height field is a tile of a larger
+    ///                  height field
+    Terrain (
+        uint32_t nRows, uint32_t nCols,
+        glm::vec2 origin, glm::vec2 cellSize,
+        const float *heights,
+        TileInfo const *tile = nullptr);
+
+    /// the number of rows in the vertex grid (including the padding)
+    uint32_t gridRows () const { return this->_gridRows; }
+
+    /// the number of columns in the vertex grid (including the padding)
+    uint32_t gridCols () const { return this->_gridCols; }
+
+    /// the number of vertices in the vertex grid
+    uint32_t numVerts () const { return this->_gridRows * this->_gridCols; }
+
+    /// the number of levels of detail
+    uint32_t numLevels () const { return this->_nLevels; }
+
+    /// the total number of indices in the index patterns
+    uint32_t numIndices () const { return this->_nIndices; }
+
+    /// write the index patterns, which are laid out as described by the
+    /// `Chunk` values returned by `select`
+    /// \param dst  the destination array, which must have room for `numIndices()`
+    ///             indices
+    void indices (uint32_t *dst) const;
+
+    /// select the chunks to draw
+    /// \param planes      the view-frustum planes in model space, with normals
+    ///                    pointing into the frustum
+    /// \param eye         the position of the eye in model space
+    /// \param pixelScale  the number of pixels covered by an object of unit size at
+    ///                    unit distance from the camera
+    /// \param useLOD      if false, all of the visible chunks are drawn at full
+    ///                    resolution
+    /// \param[out] chunks the selected chunks
+    void select (
+        const glm::vec4 planes[6],
+        glm::vec3 eye,
+        float pixelScale,
+        bool useLOD,
+        std::vector<Chunk> &chunks) const;
+
+private:
+    static constexpr uint32_t kNumMasks = 16;
+
+    /// the state of a traversal
+    struct Traversal {
+        const glm::vec4 *planes;
+        glm::vec3 eye;
+        float ratio;            ///< chunks closer than `ratio` times their size
+                                ///  are refined
+        bool useLOD;
+        std::vector<Chunk> *chunks;
+    };
+
+    uint32_t _gridRows;         ///< the number of rows in the vertex grid
+    uint32_t _gridCols;         ///< the number of columns in the vertex grid
+    uint32_t _nLevels;          ///< the number of levels; the roots are at
+                                ///  level `_nLevels-1`
+    uint32_t _rootsHigh;        ///< the number of rows of root chunks
+    uint32_t _rootsWide;        ///< the number of columns of root chunks
+    glm::vec2 _origin;          ///< the model-space XZ position of the first sample
+    glm::vec2 _cellSize;        ///< the model-space XZ size of a quad
+    float _minY, _maxY;         ///< the vertical extent of the height field
+    uint32_t _neighbors;        ///< the edges that are shared with other tiles
+    uint32_t _nIndices;         ///< the total number of indices
+    /// the first index and number of indices of the pattern for each
+    /// combination of level and stitching mask
+    std::vector<std::pair<uint32_t,uint32_t>> _patterns;
+    /// the bounding boxes of the chunks of each level in row-major order; the
+    /// boxes of chunks that are entirely in the padding are empty
+    std::vector<std::vector<cs237::AABBf_t>> _bounds;
+
+    /// the number of rows of chunks at a level
+    uint32_t _chunksHigh (uint32_t lvl) const
+    {
+        return this->_rootsHigh << (this->_nLevels - 1 - lvl);
+    }
+
+    /// the number of columns of chunks at a level
+    uint32_t _chunksWide (uint32_t lvl) const
+    {
+        return this->_rootsWide << (this->_nLevels - 1 - lvl);
+    }
+
+    /// does a chunk cover any of the height field?
+    bool _exists (uint32_t lvl, int32_t row, int32_t col) const
+    {
+        return (row >= 0) && (col >= 0)
+            && (row < int32_t(this->_chunksHigh(lvl)))
+            && (col < int32_t(this->_chunksWide(lvl)))
+            && !this->_bounds[lvl][row * this->_chunksWide(lvl) + col].isEmpty();
+    }
+
+    /// should a chunk be replaced by its children?  A chunk is refined when
+    /// the distance from the eye to it is less than `ratio` times its size.
+    /// The distance is measured to the chunk's (unclipped) footprint in the XZ
+    /// plane and to the vertical extent of the whole height field, which makes
+    /// it vary by at most the diagonal of the footprint between neighboring
+    /// chunks; this property is what limits the difference in level between
+    /// neighbors (see `select`).
+    /// The row and column may be outside the grid of chunks for the neighbors
+    /// of a tile's chunks.
+    bool _refine (Traversal const &tr, uint32_t lvl, int32_t row, int32_t col) const;
+
+    /// select the chunks of the subtree rooted at the given chunk
+    void _select (Traversal const &tr, uint32_t lvl, uint32_t row, uint32_t col) const;
+
+    /// generate the index pattern for a level and stitching mask
+    /// \param lvl   the level
+    /// \param mask  the edges that are adjacent to coarser chunks
+    /// \param dst   the destination for the indices, or nullptr to just count them
+    /// \return the number of indices in the pattern
+    uint32_t _pattern (uint32_t lvl, uint32_t mask, uint32_t *dst) const;
+
+};
+
+#endif // !_TERRAIN_HPP_
@@ -0,0 +1,127 @@
+/*! \file tess-ground.cpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5.  This file implements the
+ * tessellated ground.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "tess-ground.hpp"
+#include "app.hpp"
+
+TessGround::TessGround (
+    Proj5 *app,
+    HeightField const *hf,
+    vk::DescriptorPool pool,
+    vk::DescriptorSetLayout layout)
+  : _device(app->device()), _vScale(hf->vScale()), _color(hf->color())
+{
+    auto bbox = hf->bbox();
+    this->_extent = glm::vec4(hf->width(), hf->height(), bbox.minY(), bbox.maxY());
+
+    // each patch covers up to `kTessPatchSamples` quads of the height field in
+    // each dimension, so that it can be tessellated to full resolution
+    this->_nPatches = glm::uvec2(
+        (hf->numCols() - 1 + kTessPatchSamples - 1) / kTessPatchSamples,
+        (hf->numRows() - 1 + kTessPatchSamples - 1) / kTessPatchSamples);
+
+    // the height texture has the raw integer samples, which are fetched without
+    // filtering
+    this->_heightTxt = new cs237::Texture2D(app, hf->image());
+    cs237::Application::SamplerInfo samplerInfo(
+        vk::Filter::eNearest,  /* magnification filter */
+        vk::Filter::eNearest,  /* minification filter */
+        vk::SamplerMipmapMode::eNearest,  /* mipmap mode */
+        vk::SamplerAddressMode::eClampToEdge,  /* addressing mode for U coordinates */
+        vk::SamplerAddressMode::eClampToEdge,  /* addressing mode for V coordinates */
+        vk::BorderColor::eIntOpaqueBlack);  /* border color */
+    this->_heightSampler = app->createSampler (samplerInfo);
+
+    // the material properties for texture.frag
+    MaterialUB ub;
+    ub.albedo = hf->color();
+    ub.emissive = glm::vec3(0.0f);
+    ub.specular = glm::vec4(0.0f);
+    ub.albedoSrc = kUniformProperty;
+    ub.emissiveSrc = kNoProperty;
+    ub.specularSrc = kNoProperty;
+    ub.hasNormalMap = false;
+    if (hf->colorMap() != nullptr) {
+        this->_colorMap.define(app, hf->colorMap());
+        ub.albedoSrc = kSamplerProperty;
+    }
+    this->_ubo = new MaterialUBO(app, ub);
+
+    // allocate and write the descriptor set
+    vk::DescriptorSetAllocateInfo allocInfo(pool, layout);
+    this->_descSet = (this->_device.allocateDescriptorSets(allocInfo))[0];
+
+    auto uboInfo = this->_ubo->descInfo();
+    vk::DescriptorImageInfo heightInfo(
+        this->_heightSampler,
+        this->_heightTxt->view(),
+        vk::ImageLayout::eShaderReadOnlyOptimal);
+    std::vector<vk::WriteDescriptorSet> descWrites = {
+            vk::WriteDescriptorSet(
+                this->_descSet, /* descriptor set */
+                kUBOBind, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eUniformBuffer, /* descriptor type */
+                nullptr, /* image info */
+                uboInfo, /* buffer info */
+                nullptr), /* texel buffer view */
+            vk::WriteDescriptorSet(
+                this->_descSet, /* descriptor set */
+                kHeightBind, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                heightInfo, /* image info */
+                nullptr, /* buffer info */
+                nullptr) /* texel buffer view */
+        };
+    vk::DescriptorImageInfo albedoInfo;
+    if (this->_colorMap.isDefined()) {
+        albedoInfo = this->_colorMap.imageInfo();
+        descWrites.push_back(
+            vk::WriteDescriptorSet(
+                this->_descSet, /* descriptor set */
+                kAlbedoBind, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                albedoInfo, /* image info */
+                nullptr, /* buffer info */
+                nullptr)); /* texel buffer view */
+    }
+    this->_device.updateDescriptorSets (descWrites, nullptr);
+
+}
+
+TessGround::~TessGround ()
+{
+    this->_device.destroySampler(this->_heightSampler);
+    delete this->_heightTxt;
+    this->_colorMap.destroy(this->_device);
+    delete this->_ubo;
+
+}
+
+TessGroundPushConsts TessGround::pushConsts (
+    glm::mat4 const &mvpM,
+    glm::vec3 eye,
+    float pixelScale) const
+{
+    TessGroundPushConsts pc;
+    pc.mvpM = mvpM;
+    pc.eye = glm::vec4(eye, pixelScale / kTessSegmentPixels);
+    pc.extent = this->_extent;
+    pc.color = this->_color;
+    pc.vScale = this->_vScale;
+    pc.nPatches = this->_nPatches;
+    return pc;
+
+}
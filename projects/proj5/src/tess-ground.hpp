@@ -0,0 +1,100 @@
+/*! \file tess-ground.hpp
+ *
+ * CS23740 Autumn 2024 Sample Code for Project 5
+ *
+ * This file defines the TessGround class, which renders the height field
+ * using the GPU's tessellation stages.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2024 John Reppy (https://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _TESS_GROUND_HPP_
+#define _TESS_GROUND_HPP_
+
+#include "cs237/cs237.hpp"
+#include "height-field.hpp"
+#include "mesh.hpp"
+#include "shader-uniforms.hpp"
+
+class Proj5;
+
+/// the number of height samples along the side of a patch, which is the
+/// maximum tessellation level (see tess-ground.tesc)
+constexpr uint32_t kTessPatchSamples = 64;
+
+/// the tessellation levels are picked so that the tessellated segments cover
+/// about this many pixels
+constexpr float kTessSegmentPixels = 8.0f;
+
+/// The TessGround class renders a height field as a coarse grid of quad patches
+/// that are tessellated on the GPU.  The patches do not have any vertex data
+/// (their corners are computed from the vertex index) and the elevations are
+/// sampled from the height field's image in the tessellation-evaluation shader,
+/// so the only memory used for the ground is the height texture and there is
+/// nothing to build on the CPU.
+///
+/// The descriptor set has the material UBO and color map at the same bindings
+/// as the meshes' descriptor sets (so that texture.frag can be used to shade
+/// the ground), plus the height texture at binding 2.
+class TessGround {
+public:
+
+    /// the descriptor-set bindings
+    static constexpr uint32_t kUBOBind = 0;         ///< the material UBO
+    static constexpr uint32_t kAlbedoBind = 1;      ///< the color map
+    static constexpr uint32_t kHeightBind = 2;      ///< the height texture
+
+    /// create the ground for a height field
+    /// \param app     the application
+    /// \param hf      the height field
+    /// \param pool    the pool for allocating the descriptor set
+    /// \param layout  the descriptor-set layout
+    TessGround (
+        Proj5 *app,
+        HeightField const *hf,
+        vk::DescriptorPool pool,
+        vk::DescriptorSetLayout layout);
+
+    ~TessGround ();
+
+    /// the descriptor set for the material UBO, color map, and height texture
+    vk::DescriptorSet descSet () const { return this->_descSet; }
+
+    /// the ground color for wire-frame mode
+    glm::vec3 const &color () const { return this->_color; }
+
+    /// compute the push constants for drawing the ground
+    /// \param mvpM        the model-view-projection transform
+    /// \param eye         the position of the eye in model space
+    /// \param pixelScale  the number of pixels covered by an object of unit size at
+    ///                    unit distance from the camera
+    TessGroundPushConsts pushConsts (glm::mat4 const &mvpM, glm::vec3 eye, float pixelScale) const;
+
+    /// record the draw command for the patches
+    void draw (vk::CommandBuffer cmdBuf)
+    {
+        cmdBuf.draw(4 * this->_nPatches.x * this->_nPatches.y, 1, 0, 0);
+    }
+
+private:
+    vk::Device _device;                 ///< the owning logical device
+    glm::vec4 _extent;                  ///< the width and depth of the ground and
+                                        ///  its minimum and maximum elevation
+    float _vScale;                      ///< the vertical scale of the height samples
+    glm::vec3 _color;                   ///< the ground color
+    glm::uvec2 _nPatches;               ///< the number of patches in the X and Z
+                                        ///  dimensions
+    cs237::Texture2D *_heightTxt;       ///< the height samples
+    vk::Sampler _heightSampler;         ///< the sampler for the height texture
+    TextureProperty _colorMap;          ///< the color map (when defined)
+    MaterialUBO *_ubo;                  ///< the material UBO
+    vk::DescriptorSet _descSet;         ///< the descriptor set
+
+};
+
+#endif // !_TESS_GROUND_HPP_
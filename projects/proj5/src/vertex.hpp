@@ -2,8 +2,10 @@
  *
  * CS23740 Autumn 2024 Sample Code for Project 5
  *
- * The vertex representation for the vertex buffer used to represent
- * meshes.
+ * The vertex representations for the vertex buffers used to represent
+ * meshes.  There are two formats: `Vertex`, which uses 32-bit floats for all of
+ * the attributes, and `CompactVertex`, which uses 16-bit normalized integers and
+ * is less than half the size.
  *
  * \author John Reppy
  */
@@ -17,6 +19,8 @@
 #define _VERTEX_HPP_
 
 #include "cs237/cs237.hpp"
+#include <cmath>
+#include <limits>
 
 /*! The locations of the standard mesh attributes.  The layout directives in the shaders
  * should match these values.
@@ -27,6 +31,12 @@ constexpr int kTexCoordAttrLoc = 2;     //!< location of texture coordinates att
 constexpr int kTanAttrLoc = 3;          //!< location of extended tangent vector
 constexpr int kNumVertexAttrs = 4;      //!< number of vertex attributes
 
+/// the vertex formats that a mesh can use
+enum class VertexFormat {
+    eFull,              ///< `Vertex` (48 bytes per vertex)
+    eCompact            ///< `CompactVertex` (20 bytes per vertex)
+};
+
 //! 3D mesh vertices with normals, texture coordinates, and bitangent vectors
 //
 struct Vertex {
@@ -93,4 +103,155 @@ struct Vertex {
 
 };
 
+/// encode a unit vector using the octahedral mapping, which maps the unit sphere
+/// onto the square [-1,1]x[-1,1] (see "A Survey of Efficient Representations
+/// for Independent Unit Vectors" by Cigolle et al., JCGT 2014).  The shaders
+/// use `octDecode` to recover the vector.  A zero vector (e.g., the tangent of
+/// a degenerate triangle) is encoded as +Z.
+inline glm::vec2 octEncode (glm::vec3 v)
+{
+    float l1 = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+    if (l1 == 0.0f) {
+        return glm::vec2(0.0f, 0.0f);
+    }
+    glm::vec2 p = glm::vec2(v) / l1;
+    if (v.z < 0.0f) {
+        // fold the lower hemisphere over the diagonals
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x)))
+            * glm::vec2((p.x >= 0.0f) ? 1.0f : -1.0f, (p.y >= 0.0f) ? 1.0f : -1.0f);
+    }
+    return p;
+}
+
+/// convert a value in [0,1] to a 16-bit unsigned normalized integer
+inline uint16_t toUNorm16 (float x)
+{
+    return uint16_t(std::round(glm::clamp(x, 0.0f, 1.0f) * 65535.0f));
+}
+
+/// convert a value in [-1,1] to a 16-bit signed normalized integer
+inline int16_t toSNorm16 (float x)
+{
+    return int16_t(std::round(glm::clamp(x, -1.0f, 1.0f) * 32767.0f));
+}
+
+/// the information needed to decode the positions and texture coordinates of
+/// compact vertices, which are quantized relative to the bounds of the mesh.
+struct VertexDecode {
+    glm::vec3 posOffset;        //! the minimum corner of the mesh's bounding box
+    glm::vec3 posScale;         //! the extent of the mesh's bounding box
+    glm::vec2 tcOffset;         //! the minimum texture coordinate
+    glm::vec2 tcScale;          //! the extent of the texture coordinates
+
+    /// identity decoding (used for full vertices)
+    VertexDecode ()
+      : posOffset(0.0f), posScale(1.0f), tcOffset(0.0f), tcScale(1.0f)
+    { }
+
+    /// compute the decoding parameters for a mesh from the bounds of its
+    /// vertex data
+    /// \param pMin  the minimum corner of the mesh's bounding box
+    /// \param pMax  the maximum corner of the mesh's bounding box
+    /// \param tMin  the minimum texture coordinate
+    /// \param tMax  the maximum texture coordinate
+    VertexDecode (glm::vec3 pMin, glm::vec3 pMax, glm::vec2 tMin, glm::vec2 tMax)
+    {
+        this->posOffset = pMin;
+        this->tcOffset = tMin;
+        // avoid a zero scale for flat meshes, since we divide by it when encoding
+        this->posScale = glm::max(pMax - pMin, glm::vec3(1.0e-20f));
+        this->tcScale = glm::max(tMax - tMin, glm::vec2(1.0e-20f));
+    }
+
+    /// the affine transform that maps quantized positions in [0,1]^3 to
+    /// model space.  We fold this transform into the model matrix, so the
+    /// shaders do not need to decode positions.
+    glm::mat4 posDecodeM () const
+    {
+        return glm::scale(glm::translate(glm::mat4(1.0f), this->posOffset), this->posScale);
+    }
+
+    /// the texture-coordinate decoding parameters as a vector, where the xy
+    /// components are the scale and the zw components are the offset
+    glm::vec4 tcDecode () const
+    {
+        return glm::vec4(this->tcScale, this->tcOffset);
+    }
+
+};
+
+//! Compact mesh vertices.  The position and texture coordinates are quantized
+//! to 16 bits relative to the bounds of the mesh (see `VertexDecode`), and the
+//! normal and tangent vectors are octahedral encoded.
+//
+struct CompactVertex {
+    uint16_t pos[4];            //! quantized position in the xyz components; the w
+                                //! component holds the sign of the tangent vector's
+                                //! w component (0 for -1 and 0xffff for +1)
+    int16_t normTan[4];         //! the octahedral encoding of the normal (xy) and
+                                //! tangent (zw) vectors
+    uint16_t txtCoord[2];       //! quantized texture coordinates
+
+    /// default constructor
+    CompactVertex () { }
+
+    /// encode a vertex
+    /// \param v       the vertex
+    /// \param decode  the decoding parameters for the vertex's mesh
+    CompactVertex (Vertex const &v, VertexDecode const &decode)
+    {
+        glm::vec3 p = (v.pos - decode.posOffset) / decode.posScale;
+        this->pos[0] = toUNorm16(p.x);
+        this->pos[1] = toUNorm16(p.y);
+        this->pos[2] = toUNorm16(p.z);
+        this->pos[3] = (v.tan.w < 0.0f) ? 0 : 0xffff;
+        glm::vec2 n = octEncode(v.norm);
+        glm::vec2 t = octEncode(glm::vec3(v.tan));
+        this->normTan[0] = toSNorm16(n.x);
+        this->normTan[1] = toSNorm16(n.y);
+        this->normTan[2] = toSNorm16(t.x);
+        this->normTan[3] = toSNorm16(t.y);
+        glm::vec2 tc = (v.txtCoord - decode.tcOffset) / decode.tcScale;
+        this->txtCoord[0] = toUNorm16(tc.x);
+        this->txtCoord[1] = toUNorm16(tc.y);
+    }
+
+    static std::vector<vk::VertexInputBindingDescription> getBindingDescriptions()
+    {
+        std::vector<vk::VertexInputBindingDescription> bindings(1);
+        bindings[0].binding = 0;
+        bindings[0].stride = sizeof(CompactVertex);
+        bindings[0].inputRate = vk::VertexInputRate::eVertex;
+
+        return bindings;
+    }
+
+    static std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions()
+    {
+        // the tangent is packed with the normal, so there is no tangent attribute
+        std::vector<vk::VertexInputAttributeDescription> attrs(kNumVertexAttrs - 1);
+
+        // pos (plus tangent sign)
+        attrs[kCoordAttrLoc].binding = 0;
+        attrs[kCoordAttrLoc].location = kCoordAttrLoc;
+        attrs[kCoordAttrLoc].format = vk::Format::eR16G16B16A16Unorm;
+        attrs[kCoordAttrLoc].offset = offsetof(CompactVertex, pos);
+
+        // norm and tan
+        attrs[kNormAttrLoc].binding = 0;
+        attrs[kNormAttrLoc].location = kNormAttrLoc;
+        attrs[kNormAttrLoc].format = vk::Format::eR16G16B16A16Snorm;
+        attrs[kNormAttrLoc].offset = offsetof(CompactVertex, normTan);
+
+        // txtCoord
+        attrs[kTexCoordAttrLoc].binding = 0;
+        attrs[kTexCoordAttrLoc].location = kTexCoordAttrLoc;
+        attrs[kTexCoordAttrLoc].format = vk::Format::eR16G16Unorm;
+        attrs[kTexCoordAttrLoc].offset = offsetof(CompactVertex, txtCoord);
+
+        return attrs;
+    }
+
+};
+
 #endif // !_VERTEX_HPP_
@@ -32,7 +32,7 @@ Proj5Window::Proj5Window (Proj5 *app)
             app->scene()->width(),
             app->scene()->height(),
             "", true, true, false)),
-    _renderFlags()
+    _renderFlags(), _groundVT(nullptr), _groundStreamer(nullptr), _tessGround(nullptr)
 {
     auto scene = app->scene();
 
@@ -46,17 +46,22 @@ Proj5Window::Proj5Window (Proj5 *app)
     this->_setCameraPos ();
     this->_setProjMat();
 
+    // initialize the descriptor pool and layouts for the uniform buffers; the
+    // pool must exist before the meshes are initialized, since the tessellated
+    // ground allocates its descriptor set from it
+    this->_initDescriptorPools();
+
     // initialize the meshes for the scene objects
     this->_initMeshes(scene);
 
-    // initialize the descriptor pool and layouts for the uniform buffers
-    this->_initDescriptorPools();
-
     // initialize the lighting UBO
     this->_initLighting ();
 
     this->_initForwardRenderInfo ();
 
+    // initialize the compute pipeline for culling meshlets
+    this->_initCullInfo ();
+
     // create framebuffers for the swap chain
     this->_swap.initFramebuffers (this->_renderPass);
 
@@ -74,13 +79,24 @@ Proj5Window::~Proj5Window ()
 
     this->_wireFramePipeline.destroy (device);
     this->_texturePipeline.destroy (device);
+    this->_vtPipeline.destroy (device);
+    this->_cullPipeline.destroy (device);
+    if (reinterpret_cast<Proj5 *>(this->_app)->tessGround()) {
+        device.destroyPipeline(this->_tessWireFramePipe);
+        device.destroyPipeline(this->_tessTexturePipe);
+        device.destroyPipelineLayout(this->_tessLayout);
+        device.destroyDescriptorSetLayout(this->_tessDSLayout);
+    }
     device.destroyRenderPass(this->_renderPass);
 
     // clean up other resources
     device.destroyDescriptorPool(this->_descPool);
     device.destroyDescriptorSetLayout(this->_lightingLayout);
+    device.destroyDescriptorSetLayout(this->_cullLayout);
+    device.destroyDescriptorSetLayout(this->_vtLayout);
     delete this->_lightingUBO;
     delete this->_meshFactory;
+    delete this->_tessGround;
 
     // delete the mesh data
     for (auto inst : this->_objs) {
@@ -96,50 +112,105 @@ void Proj5Window::_initMeshes (const Scene *scene)
 {
     Proj5 *app = reinterpret_cast<Proj5 *>(this->_app);
 
-    // first we count the number of meshes so that we can create the factory
-    int nMeshes = 1; /* ground */
-    for (auto model = scene->beginModels();  model != scene->endModels();  ++model) {
-        nMeshes += (*model)->numGroups();
-    }
-    this->_meshFactory = new MeshFactory(app, nMeshes);
-
-    // create the meshes and record the start mesh index for each model
-    std::vector<int> modelFirstGrpIdx;
-    modelFirstGrpIdx.reserve(scene->numModels());
-    this->_meshes.reserve(scene->numModels());
-    for (auto model = scene->beginModels();  model != scene->endModels();  ++model) {
-        modelFirstGrpIdx.push_back(this->_meshes.size());
-        // load the meshes for the group
-        for (int i = 0;  i < (*model)->numGroups();  ++i) {
-            auto mesh = this->_meshFactory->alloc(*model, i);
-            this->_meshes.push_back(mesh);
-        }
-    }
+    // the number of meshes is not known until the models are loaded, so the
+    // factory allocates descriptor sets in fixed-size pools
+    this->_meshFactory = new MeshFactory(app, kMeshesPerPool);
 
-    // create the instances
+    // create the instances; their meshes are added as the models' groups are loaded
     this->_objs.reserve (scene->numObjects());
+    this->_modelInsts.resize (scene->numModels());
     for (auto it = scene->beginObjs();  it!= scene->endObjs();  ++it) {
-        int modelId = it->model;
-        const OBJ::Model *model = scene->model(modelId);
-        int firstMesh = modelFirstGrpIdx[modelId];
         Instance *inst = new Instance(it->toWorld, it->normToWorld());
-        for (int i = 0;  i < model->numGroups();  ++i) {
-            inst->pushMesh(this->_meshes[firstMesh+i]);
-        }
+        this->_modelInsts[it->model].push_back(inst);
         this->_objs.push_back(inst);
     }
 
-    if (scene->ground() != nullptr) {
-        // create the ground mesh
-        auto groundMesh = this->_meshFactory->alloc(scene->ground());
-        auto *groundInst = new Instance {
-                groundMesh,
-                glm::mat4(1), /* identity, since positions are in world space */
-                glm::mat3(1) /* identity, since normals are in world space */
-            };
-        // add the ground to the vectors
-        this->_meshes.push_back(groundMesh);
-        this->_objs.push_back(groundInst);
+    // upload whatever has already been loaded
+    this->_streamAssets ();
+
+}
+
+void Proj5Window::_streamAssets ()
+{
+    Proj5 *app = reinterpret_cast<Proj5 *>(this->_app);
+    const Scene *scene = this->_scene();
+
+    if (! scene->isLoading()) {
+        return;
+    }
+
+    bool newTextures = false;
+    SceneAsset asset;
+    for (int n = 0;  (n < kMaxUploadsPerFrame) && app->nextSceneAsset(asset);  ++n) {
+        switch (asset.kind) {
+        case SceneAsset::Kind::eGroup:
+            {
+                // create the mesh and add it to the model's instances
+                auto mesh = this->_meshFactory->alloc(
+                    scene->model(asset.model), asset.group,
+                    app->compactMeshes() ? VertexFormat::eCompact : VertexFormat::eFull);
+                this->_meshes.push_back(mesh);
+                for (auto inst : this->_modelInsts[asset.model]) {
+                    inst->pushMesh(mesh);
+                }
+                if (mesh->hasPendingTextures()) {
+                    this->_pendingMeshes.push_back(mesh);
+                }
+            }
+            break;
+        case SceneAsset::Kind::eTexture:
+            // the image is defined as a texture by the meshes that use it
+            newTextures = true;
+            break;
+        case SceneAsset::Kind::eGround:
+            if (app->tessGround()) {
+                // the tessellated ground is drawn separately from the meshes
+                // (see `_recordForwardCommands`)
+                this->_tessGround = new TessGround(
+                    app, scene->ground(), this->_descPool, this->_tessDSLayout);
+            } else {
+                // create the ground mesh; the ground is a large regular grid, so
+                // we always use compact vertices for it
+                auto groundMesh = this->_meshFactory->alloc(
+                    scene->ground(), VertexFormat::eCompact);
+                auto *groundInst = new Instance {
+                        groundMesh,
+                        glm::mat4(1), /* identity, since positions are in world space */
+                        glm::mat3(1) /* identity, since normals are in world space */
+                    };
+                // add the ground to the vectors
+                this->_meshes.push_back(groundMesh);
+                this->_objs.push_back(groundInst);
+                // the descriptor sets for a virtual color map are written when
+                // each frame is next recorded
+                this->_groundVT = groundMesh->albedoVT;
+                this->_groundStreamer = groundMesh->streamer;
+            }
+            break;
+        } /* switch */
+    }
+
+    // replace placeholder materials with the textures that have arrived
+    if (newTextures && !this->_pendingMeshes.empty()) {
+        // we are going to rewrite UBOs and descriptor sets that may be referenced
+        // by frames that are still in flight, so wait for the GPU to finish them
+        this->graphicsQ().waitIdle();
+        std::vector<Mesh *> stillPending;
+        for (auto mesh : this->_pendingMeshes) {
+            if (mesh->updateTextures(app)) {
+                this->_meshFactory->update(mesh);
+            }
+            if (mesh->hasPendingTextures()) {
+                stillPending.push_back(mesh);
+            }
+        }
+        this->_pendingMeshes.swap(stillPending);
+    }
+
+    if (! scene->isLoading() && this->app()->verbose()) {
+        std::cout << "# scene loaded: " << this->_meshes.size() << " meshes; "
+            << glfwGetTime() << " seconds after first frame; "
+            << scene->loadTime() << " seconds after start of load\n";
     }
 
 }
@@ -217,22 +288,54 @@ void Proj5Window::_initForwardRenderInfo ()
         this->_texturePipeline.layout = dev.createPipelineLayout(layoutInfo);
     }
 
-    // vertex info is the same for both pipelines
+    /* create the pipeline layout for the virtual-texture renderer; the first two
+     * sets and the push constants match the texture renderer's layout.
+     */
+    {
+        std::array<vk::DescriptorSetLayout, 3> dsLayouts = {
+                this->_lightingLayout, this->_meshFactory->materialLayout(),
+                this->_vtLayout
+            };
+
+        vk::PushConstantRange pcRange(
+            vk::ShaderStageFlagBits::eVertex, /* just used in vertex shader */
+            0, /* offset */
+            sizeof(TexturePushConsts));
+
+        vk::PipelineLayoutCreateInfo layoutInfo(
+            {}, /* flags */
+            dsLayouts, /* set layouts */
+            pcRange); /* push constant ranges */
+        this->_vtPipeline.layout = dev.createPipelineLayout(layoutInfo);
+    }
+
+    std::array<vk::DynamicState, 2> dynamicStates = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor,
+    };
+
+    // vertex info for the two vertex formats; the vertex info is the same for both
+    // renderers
     auto vertexInfo = cs237::vertexInputInfo (
         Vertex::getBindingDescriptions(),
         Vertex::getAttributeDescriptions());
+    auto compactVertexInfo = cs237::vertexInputInfo (
+        CompactVertex::getBindingDescriptions(),
+        CompactVertex::getAttributeDescriptions());
 
-    /* create the pipeline for the wire-frame renderers */
+    /* create the pipelines for the wire-frame renderers */
     {
         auto shaders = new cs237::Shaders(
             dev,
             std::string(kShaderDir) + "wire-frame",
             kStages);
-
-        std::array<vk::DynamicState, 2> dynamicStates = {
-            vk::DynamicState::eViewport,
-            vk::DynamicState::eScissor,
-        };
+        auto compactShaders = new cs237::Shaders(
+            dev,
+            std::vector<std::string>{
+                kShaderDir + "wire-frame-compact.vert.spv",
+                kShaderDir + "wire-frame.frag.spv"
+            },
+            kStages);
 
         this->_wireFramePipeline.pipe = this->_app->createPipeline (
             shaders,
@@ -250,20 +353,37 @@ void Proj5Window::_initForwardRenderInfo ()
             0,
             dynamicStates);
 
+        this->_wireFramePipeline.compactPipe = this->_app->createPipeline (
+            compactShaders,
+            compactVertexInfo,
+            vk::PrimitiveTopology::eTriangleList,
+            vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports */
+            vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissor rects */
+            vk::PolygonMode::eLine,
+            vk::CullModeFlagBits::eNone,
+            vk::FrontFace::eCounterClockwise,
+            this->_wireFramePipeline.layout,
+            this->_renderPass,
+            0,
+            dynamicStates);
+
         delete shaders;
+        delete compactShaders;
     }
 
-    /* create the pipeline for the texture renderers */
+    /* create the pipelines for the texture renderers */
     {
         auto shaders = new cs237::Shaders(
             dev,
             std::string(kShaderDir) + "texture",
             kStages);
-
-        std::array<vk::DynamicState, 2> dynamicStates = {
-            vk::DynamicState::eViewport,
-            vk::DynamicState::eScissor,
-        };
+        auto compactShaders = new cs237::Shaders(
+            dev,
+            std::vector<std::string>{
+                kShaderDir + "texture-compact.vert.spv",
+                kShaderDir + "texture.frag.spv"
+            },
+            kStages);
 
         this->_texturePipeline.pipe = this->_app->createPipeline (
             shaders,
@@ -281,33 +401,184 @@ void Proj5Window::_initForwardRenderInfo ()
             0,
             dynamicStates);
 
+        this->_texturePipeline.compactPipe = this->_app->createPipeline (
+            compactShaders,
+            compactVertexInfo,
+            vk::PrimitiveTopology::eTriangleList,
+            vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports */
+            vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissor rects */
+            vk::PolygonMode::eFill,
+            vk::CullModeFlagBits::eBack,
+            vk::FrontFace::eCounterClockwise,
+            this->_texturePipeline.layout,
+            this->_renderPass,
+            0,
+            dynamicStates);
+
         delete shaders;
+        delete compactShaders;
+    }
+
+    /* create the pipelines for the virtual-texture renderers */
+    {
+        auto shaders = new cs237::Shaders(
+            dev,
+            std::vector<std::string>{
+                kShaderDir + "texture.vert.spv",
+                kShaderDir + "texture-vt.frag.spv"
+            },
+            kStages);
+        auto compactShaders = new cs237::Shaders(
+            dev,
+            std::vector<std::string>{
+                kShaderDir + "texture-compact.vert.spv",
+                kShaderDir + "texture-vt.frag.spv"
+            },
+            kStages);
+
+        this->_vtPipeline.pipe = this->_app->createPipeline (
+            shaders,
+            vertexInfo,
+            vk::PrimitiveTopology::eTriangleList,
+            vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports */
+            vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissor rects */
+            vk::PolygonMode::eFill,
+            vk::CullModeFlagBits::eBack,
+            vk::FrontFace::eCounterClockwise,
+            this->_vtPipeline.layout,
+            this->_renderPass,
+            0,
+            dynamicStates);
+
+        this->_vtPipeline.compactPipe = this->_app->createPipeline (
+            compactShaders,
+            compactVertexInfo,
+            vk::PrimitiveTopology::eTriangleList,
+            vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports */
+            vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissor rects */
+            vk::PolygonMode::eFill,
+            vk::CullModeFlagBits::eBack,
+            vk::FrontFace::eCounterClockwise,
+            this->_vtPipeline.layout,
+            this->_renderPass,
+            0,
+            dynamicStates);
+
+        delete shaders;
+        delete compactShaders;
+    }
+
+    /* create the pipelines for the tessellated ground; the patches do not
+     * have any vertex data, so there is no vertex input.
+     */
+    if (reinterpret_cast<Proj5 *>(this->_app)->tessGround()) {
+        constexpr vk::ShaderStageFlags kTessStages =
+            vk::ShaderStageFlagBits::eVertex
+            | vk::ShaderStageFlagBits::eTessellationControl
+            | vk::ShaderStageFlagBits::eTessellationEvaluation
+            | vk::ShaderStageFlagBits::eFragment;
+
+        std::array<vk::DescriptorSetLayout, 2> dsLayouts = {
+                this->_lightingLayout, this->_tessDSLayout
+            };
+
+        vk::PushConstantRange pcRange(
+            kTessStages, /* the wire-frame color is used in the fragment shader */
+            0, /* offset */
+            sizeof(TessGroundPushConsts));
+
+        vk::PipelineLayoutCreateInfo layoutInfo(
+            {}, /* flags */
+            dsLayouts, /* set layouts */
+            pcRange); /* push constant ranges */
+        this->_tessLayout = dev.createPipelineLayout(layoutInfo);
+
+        auto wireShaders = new cs237::Shaders(
+            dev,
+            std::vector<std::string>{
+                kShaderDir + "tess-ground.vert.spv",
+                kShaderDir + "tess-ground.tesc.spv",
+                kShaderDir + "tess-ground.tese.spv",
+                kShaderDir + "tess-ground-wire.frag.spv"
+            },
+            kTessStages);
+        auto textureShaders = new cs237::Shaders(
+            dev,
+            std::vector<std::string>{
+                kShaderDir + "tess-ground.vert.spv",
+                kShaderDir + "tess-ground.tesc.spv",
+                kShaderDir + "tess-ground.tese.spv",
+                kShaderDir + "texture.frag.spv"
+            },
+            kTessStages);
+
+        vk::PipelineVertexInputStateCreateInfo noVertexInfo{};
+
+        this->_tessWireFramePipe = this->_app->createPipeline (
+            wireShaders,
+            noVertexInfo,
+            vk::PrimitiveTopology::ePatchList,
+            vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports */
+            vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissor rects */
+            vk::PolygonMode::eLine,
+            vk::CullModeFlagBits::eNone,
+            vk::FrontFace::eCounterClockwise,
+            this->_tessLayout,
+            this->_renderPass,
+            0,
+            dynamicStates,
+            4); /* quad patches */
+
+        this->_tessTexturePipe = this->_app->createPipeline (
+            textureShaders,
+            noVertexInfo,
+            vk::PrimitiveTopology::ePatchList,
+            vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports */
+            vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissor rects */
+            vk::PolygonMode::eFill,
+            vk::CullModeFlagBits::eBack,
+            vk::FrontFace::eCounterClockwise,
+            this->_tessLayout,
+            this->_renderPass,
+            0,
+            dynamicStates,
+            4); /* quad patches */
+
+        delete wireShaders;
+        delete textureShaders;
     }
 
     cs237::destroyVertexInputInfo (vertexInfo);
+    cs237::destroyVertexInputInfo (compactVertexInfo);
 
 }
 
 void Proj5Window::_initDescriptorPools ()
 {
     auto device = this->device();
-    int nObjs = this->_objs.size();
-    assert (nObjs > 0);
+    bool tess = reinterpret_cast<Proj5 *>(this->_app)->tessGround();
 
     /** HINT: redo this computation to account for the descriptors used in the
      ** deferred rendering passes.
      **/
 
     // allocate the descriptor-set pool.  For forward rendering, we have one UBO for
-    // the lighting state.  The mesh descriptors are handled by the mesh factory.
-    int nUBOs = 1;
-    int nSamplers = 0;
-    std::array<vk::DescriptorPoolSize, 1> poolSizes = {
-            vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, nUBOs)
+    // the lighting state and a storage buffer per frame for the meshlet draw
+    // commands.  Each frame also has a set for the ground's virtual texture (a
+    // UBO, two samplers, and a storage buffer).  The tessellated ground has a
+    // set with a UBO and two samplers.  The mesh descriptors are handled by the
+    // mesh factory.
+    int nUBOs = 1 + cs237::kMaxFrames + (tess ? 1 : 0);
+    int nSamplers = 2 * cs237::kMaxFrames + (tess ? 2 : 0);
+    int nStorage = 2 * cs237::kMaxFrames;
+    std::array<vk::DescriptorPoolSize, 3> poolSizes = {
+            vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, nUBOs),
+            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, nSamplers),
+            vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, nStorage)
         };
     vk::DescriptorPoolCreateInfo poolInfo(
         {}, /* flags */
-        1, /* max sets */
+        1 + 2 * cs237::kMaxFrames + (tess ? 1 : 0), /* max sets */
         poolSizes); /* pool sizes */
 
     this->_descPool = device.createDescriptorPool(poolInfo);
@@ -327,6 +598,139 @@ void Proj5Window::_initDescriptorPools ()
         this->_lightingLayout = device.createDescriptorSetLayout(layoutInfo);
     }
 
+    // create the layout for the meshlet draw commands
+    {
+        vk::DescriptorSetLayoutBinding layoutBinding(
+            0, /* binding */
+            vk::DescriptorType::eStorageBuffer, /* descriptor type */
+            1, /* descriptor count */
+            vk::ShaderStageFlagBits::eCompute, /* stages */
+            nullptr); /* samplers */
+
+        vk::DescriptorSetLayoutCreateInfo layoutInfo(
+            {}, /* flags */
+            layoutBinding); /* bindings */
+        this->_cullLayout = device.createDescriptorSetLayout(layoutInfo);
+    }
+
+    // create the layout for the virtual-texture resources (see texture-vt.frag)
+    {
+        std::array<vk::DescriptorSetLayoutBinding, 4> layoutBindings = {
+                vk::DescriptorSetLayoutBinding(
+                    0, /* binding */
+                    vk::DescriptorType::eUniformBuffer, /* descriptor type */
+                    1, /* descriptor count */
+                    vk::ShaderStageFlagBits::eFragment, /* stages */
+                    nullptr), /* samplers */
+                vk::DescriptorSetLayoutBinding(
+                    1, /* binding */
+                    vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                    1, /* descriptor count */
+                    vk::ShaderStageFlagBits::eFragment, /* stages */
+                    nullptr), /* samplers */
+                vk::DescriptorSetLayoutBinding(
+                    2, /* binding */
+                    vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                    1, /* descriptor count */
+                    vk::ShaderStageFlagBits::eFragment, /* stages */
+                    nullptr), /* samplers */
+                vk::DescriptorSetLayoutBinding(
+                    3, /* binding */
+                    vk::DescriptorType::eStorageBuffer, /* descriptor type */
+                    1, /* descriptor count */
+                    vk::ShaderStageFlagBits::eFragment, /* stages */
+                    nullptr) /* samplers */
+            };
+
+        vk::DescriptorSetLayoutCreateInfo layoutInfo(
+            {}, /* flags */
+            layoutBindings); /* bindings */
+        this->_vtLayout = device.createDescriptorSetLayout(layoutInfo);
+    }
+
+    // create the layout for the tessellated ground (see tess-ground.hpp); the
+    // color map is optional, so its binding may be undefined
+    if (tess) {
+        std::array<vk::DescriptorSetLayoutBinding, 3> layoutBindings = {
+                vk::DescriptorSetLayoutBinding(
+                    TessGround::kUBOBind, /* binding */
+                    vk::DescriptorType::eUniformBuffer, /* descriptor type */
+                    1, /* descriptor count */
+                    vk::ShaderStageFlagBits::eFragment, /* stages */
+                    nullptr), /* samplers */
+                vk::DescriptorSetLayoutBinding(
+                    TessGround::kAlbedoBind, /* binding */
+                    vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                    1, /* descriptor count */
+                    vk::ShaderStageFlagBits::eFragment, /* stages */
+                    nullptr), /* samplers */
+                vk::DescriptorSetLayoutBinding(
+                    TessGround::kHeightBind, /* binding */
+                    vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                    1, /* descriptor count */
+                    vk::ShaderStageFlagBits::eTessellationEvaluation, /* stages */
+                    nullptr) /* samplers */
+            };
+        std::array<vk::DescriptorBindingFlags, 3> bindingFlags = {
+                vk::DescriptorBindingFlags{},
+                vk::DescriptorBindingFlagBits::ePartiallyBound,
+                vk::DescriptorBindingFlags{}
+            };
+
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagInfo(bindingFlags);
+        vk::DescriptorSetLayoutCreateInfo layoutInfo(
+            {}, /* flags */
+            layoutBindings, /* bindings */
+            &bindingFlagInfo);
+        this->_tessDSLayout = device.createDescriptorSetLayout(layoutInfo);
+    }
+
+}
+
+void Proj5Window::_initCullInfo ()
+{
+    auto dev = this->_app->device();
+
+    /* create the pipeline layout */
+    {
+        std::array<vk::DescriptorSetLayout, 2> dsLayouts = {
+                this->_meshFactory->materialLayout(), this->_cullLayout
+            };
+
+        vk::PushConstantRange pcRange(
+            vk::ShaderStageFlagBits::eCompute,
+            0, /* offset */
+            sizeof(CullPushConsts));
+
+        vk::PipelineLayoutCreateInfo layoutInfo(
+            {}, /* flags */
+            dsLayouts, /* set layouts */
+            pcRange); /* push constant ranges */
+        this->_cullPipeline.layout = dev.createPipelineLayout(layoutInfo);
+    }
+
+    /* create the compute pipeline */
+    {
+        auto shaders = new cs237::Shaders(
+            dev,
+            std::string(kShaderDir) + "meshlet-cull",
+            vk::ShaderStageFlagBits::eCompute);
+
+        this->_cullPipeline.pipe = this->_app->createComputePipeline (
+            this->_cullPipeline.layout,
+            shaders);
+
+        delete shaders;
+    }
+
+    // without the multi-draw-indirect feature, each indirect-draw command can only
+    // draw one meshlet
+    if (this->_app->features()->multiDrawIndirect) {
+        this->_maxDraws = this->_app->limits()->maxDrawIndirectCount;
+    } else {
+        this->_maxDraws = 1;
+    }
+
 }
 
 void Proj5Window::_initLighting ()
@@ -379,6 +783,99 @@ void Proj5Window::_invalidateFrameUBOs ()
     /** HINT: update the cache for per-frame data */
 }
 
+/// extract the view-frustum planes from a model-view-projection matrix using the
+/// method of Gribb and Hartmann.  The planes are in model space, with normals
+/// pointing into the frustum.
+static void frustumPlanes (glm::mat4 const &mvpM, glm::vec4 planes[6])
+{
+    glm::mat4 rows = glm::transpose(mvpM);
+    planes[0] = rows[3] + rows[0];      // left
+    planes[1] = rows[3] - rows[0];      // right
+    planes[2] = rows[3] + rows[1];      // bottom
+    planes[3] = rows[3] - rows[1];      // top
+    planes[4] = rows[2];                // near (Vulkan's clip-space Z is 0..1)
+    planes[5] = rows[3] - rows[2];      // far
+    for (int i = 0;  i < 6;  ++i) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+void Proj5Window::_recordCullCommands (
+    Proj5Window::FrameData *frame,
+    std::vector<uint32_t> const &lods,
+    std::vector<uint32_t> &firstCmds)
+{
+    auto cmdBuf = frame->cmdBuf;
+
+    // assign the draw commands for the meshes; only the meshes that are drawn
+    // at full resolution use their meshlets
+    firstCmds.clear();
+    uint32_t nCmds = 0;
+    uint32_t i = 0;
+    for (auto it : this->_objs) {
+        for (auto mesh : it->meshes) {
+            firstCmds.push_back(nCmds);
+            if (lods[i++] == 0) {
+                nCmds += mesh->nMeshlets;
+            }
+        }
+    }
+    if (nCmds == 0) {
+        return;
+    }
+    frame->reserveCullCmds (nCmds);
+
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, this->_cullPipeline.pipe);
+    cmdBuf.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute,
+        this->_cullPipeline.layout,
+        1, /* second set */
+        frame->cullDS,
+        nullptr);
+
+    i = 0;
+    for (auto it : this->_objs) {
+        // since the meshlet bounds are in model space, we map the frustum and eye
+        // into model space
+        CullPushConsts pc;
+        frustumPlanes (this->_projM * this->_viewM * it->toWorld, pc.planes);
+        pc.eye = glm::inverse(it->toWorld) * glm::vec4(this->_camPos, 1.0f);
+        for (auto mesh : it->meshes) {
+            if (mesh->hasMeshlets() && (lods[i] == 0)) {
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eCompute,
+                    this->_cullPipeline.layout,
+                    0, /* first set */
+                    mesh->descSet,
+                    nullptr);
+                pc.firstCmd = firstCmds[i];
+                pc.nMeshlets = mesh->nMeshlets;
+                cmdBuf.pushConstants(
+                    this->_cullPipeline.layout,
+                    vk::ShaderStageFlagBits::eCompute,
+                    0,
+                    sizeof(CullPushConsts),
+                    &pc);
+                cmdBuf.dispatch((mesh->nMeshlets + 63) / 64, 1, 1);
+            }
+            ++i;
+        }
+    }
+
+    // the draw commands must be written before they are read
+    vk::MemoryBarrier barrier(
+        vk::AccessFlagBits::eShaderWrite, /* src access mask */
+        vk::AccessFlagBits::eIndirectCommandRead); /* dst access mask */
+    cmdBuf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, /* src stage mask */
+        vk::PipelineStageFlagBits::eDrawIndirect, /* dst stage mask */
+        {}, /* dependency flags */
+        barrier,
+        nullptr,
+        nullptr);
+
+}
+
 void Proj5Window::_recordForwardCommands (Proj5Window::FrameData *frame)
 {
     auto cmdBuf = frame->cmdBuf;
@@ -388,6 +885,41 @@ void Proj5Window::_recordForwardCommands (Proj5Window::FrameData *frame)
     vk::CommandBufferBeginInfo beginInfo;
     cmdBuf.begin(beginInfo);
 
+    // stream in the tiles of the ground's virtual color map; the copies into the
+    // cache and page table must be recorded before the render pass
+    if (this->_groundVT != nullptr) {
+        if (! frame->vtDSValid) {
+            this->_writeVTDescriptors (frame, this->_curFrameIdx);
+        }
+        this->_groundVT->update (cmdBuf, this->_curFrameIdx);
+    }
+
+    // stream the tiles of a tiled ground in and out around the camera; the
+    // ground is in world space and the tiles beyond the far plane are not needed
+    if (this->_groundStreamer != nullptr) {
+        this->_groundStreamer->update (this->_camPos, kFarZ);
+    }
+
+    // cull the meshlets of large meshes; we do not cull in wire-frame mode, since
+    // back faces are visible in that mode
+    bool cullMeshlets = this->_renderFlags.meshletCulling
+        && (this->_renderFlags.mode == RenderMode::eTextured);
+
+    // pick the level of detail for each mesh (in the order that they are drawn)
+    std::vector<uint32_t> lods;
+    for (auto it : this->_objs) {
+        for (auto mesh : it->meshes) {
+            lods.push_back(this->_renderFlags.lodSelection
+                ? it->selectLOD (mesh, this->_camPos, this->_lodScale)
+                : 0);
+        }
+    }
+
+    std::vector<uint32_t> firstCmds;
+    if (cullMeshlets) {
+        this->_recordCullCommands (frame, lods, firstCmds);
+    }
+
     std::array<vk::ClearValue,2> clearValues = {
             vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f), /* clear the window to black */
             vk::ClearDepthStencilValue(1.0f, 0.0f)
@@ -406,16 +938,18 @@ void Proj5Window::_recordForwardCommands (Proj5Window::FrameData *frame)
         // set the viewport using the OpenGL convention
         this->_setViewportCmd (cmdBuf, true);
 
+        // the pipelines for the current mode; the pipeline is bound for each mesh
+        // whose pipeline differs from that of the previous mesh.  Since the full
+        // and compact pipelines share a layout (and the virtual-texture layout
+        // extends the texture layout), rebinding does not disturb the bound
+        // descriptor sets.
+        PipelineInfo const *pipeline = nullptr;
         switch (this->_renderFlags.mode) {
         case RenderMode::eWireFrame:
-            cmdBuf.bindPipeline(
-                vk::PipelineBindPoint::eGraphics,
-                this->_wireFramePipeline.pipe);
+            pipeline = &this->_wireFramePipeline;
             break;
         case RenderMode::eTextured:
-            cmdBuf.bindPipeline(
-                vk::PipelineBindPoint::eGraphics,
-                this->_texturePipeline.pipe);
+            pipeline = &this->_texturePipeline;
             cmdBuf.bindDescriptorSets(
                 vk::PipelineBindPoint::eGraphics,
                 this->_texturePipeline.layout,
@@ -428,53 +962,220 @@ void Proj5Window::_recordForwardCommands (Proj5Window::FrameData *frame)
         } /* switch */
 
         // render the objects in the scene
+        uint32_t meshIdx = 0;
+        vk::Pipeline boundPipe = VK_NULL_HANDLE;
+        vk::DescriptorSet boundDS = VK_NULL_HANDLE;
+        bool vtBound = false;
+        std::vector<Terrain::Chunk> chunks;
         for (auto it : this->_objs) {
             for (auto mesh : it->meshes) {
-                // initialize the uniforms
-                if (this->_renderFlags.mode == RenderMode::eWireFrame) {
-                    WireFramePushConsts pc = {
-                            this->_projM * this->_viewM * it->toWorld,
-                            mesh->albedoColor
-                        };
-                    cmdBuf.pushConstants(
-                        this->_wireFramePipeline.layout,
-                        vk::ShaderStageFlagBits::eVertex,
-                        0,
-                        sizeof(WireFramePushConsts),
-                        &pc);
-                } else { // texture mode
-                    // bind the descriptors for the object
+                // in texture mode, meshes with a virtual albedo texture sample it
+                // using the virtual-texture pipelines
+                bool useVT = (this->_renderFlags.mode == RenderMode::eTextured)
+                    && (mesh->albedoVT != nullptr);
+                vk::Pipeline pipe = useVT
+                    ? this->_vtPipeline.pipeFor(mesh->vFormat)
+                    : pipeline->pipeFor(mesh->vFormat);
+                if (pipe != boundPipe) {
+                    cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, pipe);
+                    boundPipe = pipe;
+                }
+                if (useVT && !vtBound) {
+                    cmdBuf.bindDescriptorSets(
+                        vk::PipelineBindPoint::eGraphics,
+                        this->_vtPipeline.layout,
+                        2, /* third set */
+                        frame->vtDS,
+                        nullptr);
+                    vtBound = true;
+                }
+                // the model-view-projection transform; for compact vertices, this
+                // includes the decoding of the quantized positions.  The tiles
+                // of a streamed ground have their own decoding, so the push
+                // constants are set for each tile.
+                glm::mat4 projViewModelM = this->_projM * this->_viewM * it->toWorld;
+                auto pushConsts = [&] (VertexDecode const *decode) {
+                    glm::mat4 mvpM = projViewModelM;
+                    if (decode != nullptr) {
+                        mvpM = mvpM * decode->posDecodeM();
+                    }
+                    // initialize the uniforms
+                    if (this->_renderFlags.mode == RenderMode::eWireFrame) {
+                        WireFramePushConsts pc = {
+                                mvpM,
+                                mesh->albedoColor
+                            };
+                        cmdBuf.pushConstants(
+                            this->_wireFramePipeline.layout,
+                            vk::ShaderStageFlagBits::eVertex,
+                            0,
+                            sizeof(WireFramePushConsts),
+                            &pc);
+                    } else { // texture mode
+                        // push constants for the mesh
+                        TexturePushConsts pc = {
+                                mvpM,
+                                glm::mat4(it->normToWorld)
+                            };
+                        if (decode != nullptr) {
+                            // pass the texture-coordinate decoding in the unused column
+                            pc.normToWorld[3] = decode->tcDecode();
+                        }
+                        cmdBuf.pushConstants(
+                            this->_texturePipeline.layout,
+                            vk::ShaderStageFlagBits::eVertex,
+                            0,
+                            sizeof(TexturePushConsts),
+                            &pc);
+                    }
+                };
+                // bind the descriptors for the object; meshes that share
+                // their material state (e.g., because their textures are
+                // in the same atlas page) share the descriptor set
+                if ((this->_renderFlags.mode != RenderMode::eWireFrame)
+                && (mesh->descSet != boundDS)) {
                     cmdBuf.bindDescriptorSets(
                         vk::PipelineBindPoint::eGraphics,
                         this->_texturePipeline.layout,
                         1, /* second set */
                         mesh->descSet, /* descriptor sets */
                         nullptr);
-                    // push constants for the mesh
-                    TexturePushConsts pc = {
-                            this->_projM * this->_viewM * it->toWorld,
-                            glm::mat4(it->normToWorld)
-                        };
-                    cmdBuf.pushConstants(
-                        this->_texturePipeline.layout,
-                        vk::ShaderStageFlagBits::eVertex,
-                        0,
-                        sizeof(TexturePushConsts),
-                        &pc);
+                    boundDS = mesh->descSet;
+                }
+                if (mesh->streamer != nullptr) {
+                    // the tiles select their chunks like a single height field
+                    glm::vec4 planes[6];
+                    frustumPlanes (projViewModelM, planes);
+                    glm::vec3 eye = glm::inverse(it->toWorld) * glm::vec4(this->_camPos, 1.0f);
+                    mesh->streamer->draw (
+                        cmdBuf, planes, eye, this->_lodScale,
+                        this->_renderFlags.lodSelection,
+                        [&] (VertexDecode const &decode) { pushConsts (&decode); });
+                    ++meshIdx;
+                    continue;
+                }
+                pushConsts (mesh->isCompact() ? &mesh->decode : nullptr);
+                if (mesh->terrain != nullptr) {
+                    // select the chunks of the height field; like the meshlet
+                    // bounds, the chunk bounds are in model space
+                    glm::vec4 planes[6];
+                    frustumPlanes (projViewModelM, planes);
+                    glm::vec3 eye = glm::inverse(it->toWorld) * glm::vec4(this->_camPos, 1.0f);
+                    mesh->terrain->select (
+                        planes, eye, this->_lodScale,
+                        this->_renderFlags.lodSelection,
+                        chunks);
+                    mesh->drawChunks (cmdBuf, chunks);
+                } else if (cullMeshlets && mesh->hasMeshlets() && (lods[meshIdx] == 0)) {
+                    mesh->drawMeshlets (
+                        cmdBuf,
+                        frame->cullCmds->vkBuffer(),
+                        firstCmds[meshIdx],
+                        this->_maxDraws);
+                } else {
+                    mesh->draw (cmdBuf, lods[meshIdx]);
                 }
-                mesh->draw (cmdBuf);
+                ++meshIdx;
             }
         }
 
+        // render the tessellated ground, which is in world space
+        if (this->_tessGround != nullptr) {
+            bool wireFrame = (this->_renderFlags.mode == RenderMode::eWireFrame);
+            cmdBuf.bindPipeline(
+                vk::PipelineBindPoint::eGraphics,
+                wireFrame ? this->_tessWireFramePipe : this->_tessTexturePipe);
+            // the evaluation shader samples the height map in both modes, but
+            // only the textured mode uses the lighting
+            if (! wireFrame) {
+                cmdBuf.bindDescriptorSets(
+                    vk::PipelineBindPoint::eGraphics,
+                    this->_tessLayout,
+                    0, /* first set */
+                    this->_lightingDS,
+                    nullptr);
+            }
+            cmdBuf.bindDescriptorSets(
+                vk::PipelineBindPoint::eGraphics,
+                this->_tessLayout,
+                1, /* first set */
+                this->_tessGround->descSet(),
+                nullptr);
+            auto pc = this->_tessGround->pushConsts (
+                this->_projM * this->_viewM,
+                this->_camPos,
+                this->_lodScale);
+            cmdBuf.pushConstants(
+                this->_tessLayout,
+                vk::ShaderStageFlagBits::eVertex
+                    | vk::ShaderStageFlagBits::eTessellationControl
+                    | vk::ShaderStageFlagBits::eTessellationEvaluation
+                    | vk::ShaderStageFlagBits::eFragment,
+                0,
+                sizeof(TessGroundPushConsts),
+                &pc);
+            this->_tessGround->draw (cmdBuf);
+        }
+
     }
     /*** END COMMANDS ***/
 
     cmdBuf.endRenderPass();
 
+    // the host reads the ground's texture feedback once the frame has finished
+    if (this->_groundVT != nullptr) {
+        this->_groundVT->feedbackBarrier (cmdBuf, this->_curFrameIdx);
+    }
+
     cmdBuf.end();
 
 }
 
+void Proj5Window::_writeVTDescriptors (Proj5Window::FrameData *frame, uint32_t frameIdx)
+{
+    auto uboInfo = this->_groundVT->uboInfo(frameIdx);
+    auto pageTableInfo = this->_groundVT->pageTableInfo();
+    auto cacheInfo = this->_groundVT->cacheInfo();
+    auto feedbackInfo = this->_groundVT->feedbackInfo(frameIdx);
+    std::array<vk::WriteDescriptorSet, 4> descWrites = {
+            vk::WriteDescriptorSet(
+                frame->vtDS, /* descriptor set */
+                0, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eUniformBuffer, /* descriptor type */
+                nullptr, /* image info */
+                uboInfo, /* buffer info */
+                nullptr), /* texel buffer view */
+            vk::WriteDescriptorSet(
+                frame->vtDS, /* descriptor set */
+                1, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                pageTableInfo, /* image info */
+                nullptr, /* buffer info */
+                nullptr), /* texel buffer view */
+            vk::WriteDescriptorSet(
+                frame->vtDS, /* descriptor set */
+                2, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                cacheInfo, /* image info */
+                nullptr, /* buffer info */
+                nullptr), /* texel buffer view */
+            vk::WriteDescriptorSet(
+                frame->vtDS, /* descriptor set */
+                3, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eStorageBuffer, /* descriptor type */
+                nullptr, /* image info */
+                feedbackInfo, /* buffer info */
+                nullptr) /* texel buffer view */
+        };
+    this->_app->device().updateDescriptorSets (descWrites, nullptr);
+    frame->vtDSValid = true;
+
+}
+
 void Proj5Window::draw ()
 {
 /** HINT: you will need to restructure this function for the situation where
@@ -482,6 +1183,9 @@ void Proj5Window::draw ()
  ** where the code below is used when rain is disabled and a different code path
  ** is used when rain is enabled.
  **/
+    // upload any scene assets that have been loaded since the last frame
+    this->_streamAssets ();
+
     // next buffer from the swap chain
     auto sts = this->_acquireNextImage();
     if (sts != vk::Result::eSuccess) {
@@ -559,6 +1263,12 @@ void Proj5Window::key (int key, int scancode, int action, int mods)
                 break;
 
             /* Other controls */
+            case GLFW_KEY_C:  // 'c' or 'C' ==> toggle meshlet culling
+                this->_renderFlags.toggleMeshletCulling();
+                break;
+            case GLFW_KEY_O:  // 'o' or 'O' ==> toggle level-of-detail selection
+                this->_renderFlags.toggleLODSelection();
+                break;
             case GLFW_KEY_H:  // 'h' or 'H' ==> display help message
                 reinterpret_cast<Proj5 *>(this->_app)->controlsHelpMessage();
                 break;
@@ -603,6 +1313,18 @@ Proj5Window::FrameData::FrameData (cs237::Window *w)
 
     /** HINT: allocate the UBO and descriptor set for the scene-data UBO */
 
+    // allocate the descriptor set and buffer for the meshlet draw commands
+    vk::DescriptorSetAllocateInfo allocInfo(win->_descPool, win->_cullLayout);
+    this->cullDS = (device.allocateDescriptorSets(allocInfo))[0];
+    this->cullCmds = nullptr;
+    this->reserveCullCmds (kInitialCullCmds);
+
+    // allocate the descriptor set for the virtual-texture resources, which is
+    // written once the ground has been loaded
+    vk::DescriptorSetAllocateInfo vtAllocInfo(win->_descPool, win->_vtLayout);
+    this->vtDS = (device.allocateDescriptorSets(vtAllocInfo))[0];
+    this->vtDSValid = false;
+
     /** HINT: write the descriptor sets */
 }
 
@@ -610,4 +1332,34 @@ Proj5Window::FrameData::FrameData (cs237::Window *w)
 Proj5Window::FrameData::~FrameData ()
 {
     /** HINT: delete descriptor sets and UBOs */
+    delete this->cullCmds;
+}
+
+void Proj5Window::FrameData::reserveCullCmds (uint32_t n)
+{
+    if ((this->cullCmds != nullptr) && (n <= this->cullCmds->nCmds())) {
+        return;
+    }
+
+    // grow the buffer by doubling.  Since the frame's previous commands have
+    // completed, it is safe to replace the buffer and update the descriptor set.
+    uint32_t capacity = (this->cullCmds == nullptr) ? n : this->cullCmds->nCmds();
+    while (capacity < n) {
+        capacity *= 2;
+    }
+    delete this->cullCmds;
+    this->cullCmds = new cs237::IndirectBuffer<vk::DrawIndexedIndirectCommand>(
+        this->win->app(), capacity);
+
+    auto cmdsInfo = this->cullCmds->descInfo();
+    vk::WriteDescriptorSet descWrite(
+        this->cullDS, /* descriptor set */
+        0, /* binding */
+        0, /* array element */
+        vk::DescriptorType::eStorageBuffer, /* descriptor type */
+        nullptr, /* image info */
+        cmdsInfo, /* buffer info */
+        nullptr); /* texel buffer view */
+    this->win->device().updateDescriptorSets (descWrite, nullptr);
+
 }
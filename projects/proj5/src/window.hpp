@@ -19,6 +19,8 @@
 #include "scene.hpp"
 #include "shader-uniforms.hpp"
 #include "instance.hpp"
+#include "tess-ground.hpp"
+#include "vertex.hpp"
 
 /// constants to define the near and far planes of the view frustum
 constexpr float kNearZ = 0.5;   // how close to the origin you can get
@@ -29,14 +31,32 @@ constexpr float kCameraSpeed = 2.0f; ///< camera rotation speed (in degrees)
 /// the period between simulation steps (60 FPS)
 constexpr double kUpdatePeriod = 1.0 / 60.0;
 
+/// the maximum number of streamed assets that are uploaded to the GPU per frame
+constexpr int kMaxUploadsPerFrame = 8;
+
+/// the number of meshes per descriptor pool in the mesh factory
+constexpr int kMeshesPerPool = 64;
+
+/// the initial number of draw commands in the per-frame meshlet-command buffers
+constexpr uint32_t kInitialCullCmds = 4096;
+
 /// struct to collect pipeline info
 struct PipelineInfo {
     vk::PipelineLayout layout;  ///< pipeline layout
     vk::Pipeline pipe;          ///< pipeline
+    vk::Pipeline compactPipe;   ///< pipeline for meshes with compact vertices; it
+                                ///  shares the layout with `pipe`
+
+    /// get the pipeline for a mesh's vertex format
+    vk::Pipeline pipeFor (VertexFormat fmt) const
+    {
+        return (fmt == VertexFormat::eCompact) ? this->compactPipe : this->pipe;
+    }
 
     void destroy (vk::Device device)
     {
         device.destroyPipeline(this->pipe);
+        device.destroyPipeline(this->compactPipe);
         device.destroyPipelineLayout(this->layout);
     }
 };
@@ -62,6 +82,11 @@ private:
     // scene data
     std::vector<Mesh *> _meshes;                ///< the meshes in the scene
     std::vector<Instance *> _objs;              ///< the objects to render
+    std::vector<std::vector<Instance *>> _modelInsts; ///< the instances of each model;
+                                                ///  used to add meshes to instances
+                                                ///  as the model's groups are loaded
+    std::vector<Mesh *> _pendingMeshes;         ///< meshes with textures that are
+                                                ///  still being loaded
 
     // Current camera state
     glm::vec3 _camPos;                          ///< camera position in world space
@@ -72,6 +97,10 @@ private:
 
     glm::mat4 _viewM;                           ///< current view matrix
     glm::mat4 _projM;                           ///< current projection matrix
+    float _lodScale;                            ///< the scale factor from world-space
+                                                ///  error to pixels at unit distance,
+                                                ///  which is used to pick the levels
+                                                ///  of detail of meshes
 
     vk::DescriptorPool _descPool;               ///< the descriptor pool for uniforms
 
@@ -96,6 +125,35 @@ private:
     PipelineInfo _wireFramePipeline;
     /// Rendering information for textured-rendering mode
     PipelineInfo _texturePipeline;
+    /// Rendering information for meshes whose albedo is a virtual texture in
+    /// textured-rendering mode; the layout extends the texture layout with the
+    /// virtual-texture descriptors as set 2
+    PipelineInfo _vtPipeline;
+    vk::DescriptorSetLayout _vtLayout;          ///< layout for the virtual-texture
+                                                ///  descriptors
+    cs237::VirtualTexture *_groundVT;           ///< the ground's virtual color map
+                                                ///  (owned by the ground mesh), or
+                                                ///  nullptr
+    TerrainStreamer *_groundStreamer;           ///< the streamed tiles of a tiled
+                                                ///  ground (owned by the ground
+                                                ///  mesh), or nullptr
+
+    /// Rendering information for the tessellated ground (only defined when
+    /// the application's `tessGround()` is true).  The layout has the
+    /// lighting descriptor set as set 0 and the ground's descriptor set as set 1.
+    vk::PipelineLayout _tessLayout;
+    vk::Pipeline _tessWireFramePipe;            ///< the wire-frame-mode pipeline
+    vk::Pipeline _tessTexturePipe;              ///< the textured-mode pipeline
+    vk::DescriptorSetLayout _tessDSLayout;      ///< layout for the ground's
+                                                ///  descriptor set
+    TessGround *_tessGround;                    ///< the tessellated ground, or nullptr
+
+    /// The compute pipeline for meshlet culling; the layout has the mesh
+    /// descriptor set as set 0 and the per-frame draw commands as set 1.
+    PipelineInfo _cullPipeline;
+    vk::DescriptorSetLayout _cullLayout;        ///< layout for the draw commands
+    uint32_t _maxDraws;                         ///< maximum number of draws per
+                                                ///  indirect-draw command
 
     /** HINT: define resources for deferred rendering */
 
@@ -104,6 +162,12 @@ private:
         /** HINT: add per-fame UBOs etc */
         bool valid;                     ///< true when the contents of the UBO is
                                         ///  valid (i.e., equal to the _sceneUBCache)
+        cs237::IndirectBuffer<vk::DrawIndexedIndirectCommand> *cullCmds;
+                                        ///< the draw commands for the visible meshlets
+        vk::DescriptorSet cullDS;       ///< the descriptor set for `cullCmds`
+        vk::DescriptorSet vtDS;         ///< the descriptor set for the frame's
+                                        ///  virtual-texture resources
+        bool vtDSValid;                 ///< has `vtDS` been written?
 
         void refresh ()
         {
@@ -111,13 +175,23 @@ private:
             this->valid = true;
         }
 
+        /// make sure that the draw-command buffer can hold `n` commands
+        void reserveCullCmds (uint32_t n);
+
         FrameData (Window *w);
         virtual ~FrameData () override;
     };
 
-    /// allocate and initialize the meshes and drawables
+    /// allocate and initialize the drawables; the meshes are added as the
+    /// scene's assets are loaded (see `_streamAssets`).
     void _initMeshes (const Scene *scene);
 
+    /// upload the scene assets that have finished loading since the last frame.
+    /// Meshes are created as their groups arrive; meshes whose textures are
+    /// still loading are rendered with placeholder materials until the textures
+    /// arrive.
+    void _streamAssets ();
+
     /// initialize the rendering information for the forward renderers
     void _initForwardRenderInfo ();
 
@@ -131,9 +205,29 @@ private:
     /// allocate and initialize the lighting UBO
     void _initLighting ();
 
+    /// initialize the compute pipeline for meshlet culling
+    void _initCullInfo ();
+
+    /// record the compute commands that cull the meshlets of the meshes that
+    /// are split into meshlets and are drawn at full resolution.
+    /// \param frame      the frame data
+    /// \param lods       the level of detail of each instance's meshes (in the
+    ///                   order that they are drawn)
+    /// \param firstCmds  set to the index of the first draw command for each
+    ///                   instance's meshes (in the order that they are drawn)
+    void _recordCullCommands (
+        Proj5Window::FrameData *frame,
+        std::vector<uint32_t> const &lods,
+        std::vector<uint32_t> &firstCmds);
+
     /// record the rendering commands for the forward renderers
     void _recordForwardCommands (Proj5Window::FrameData *frame);
 
+    /// write the descriptor set for the ground's virtual texture for a frame
+    /// \param frame     the frame data
+    /// \param frameIdx  the index of the frame
+    void _writeVTDescriptors (Proj5Window::FrameData *frame, uint32_t frameIdx);
+
     /** HINT: define a method (or methods) for recording the deferred-rendering-mode
      ** commands into a command buffer.
      **/
@@ -163,6 +257,9 @@ private:
             glm::radians(kFOV),
             float(this->_wid), float(this->_ht),
             kNearZ, kFarZ);
+        // the field of view is vertical, so an object of unit size at unit distance
+        // covers _ht / (2 tan(fov/2)) pixels
+        this->_lodScale = float(this->_ht) / (2.0f * std::tan(0.5f * glm::radians(kFOV)));
     }
 
     /// invalidate the per-frame UBOs and update the per-frame cache